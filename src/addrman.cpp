@@ -350,6 +350,31 @@ void CAddrMan::Attempt_(const CService& addr, int64_t nTime)
     info.nAttempts++;
 }
 
+void CAddrMan::Latency_(const CService& addr, int64_t nLatencyMs)
+{
+    CAddrInfo* pinfo = Find(addr);
+
+    // if not found, bail out
+    if (!pinfo)
+        return;
+
+    CAddrInfo& info = *pinfo;
+
+    // check whether we are talking about the exact same CService (including same port)
+    if (info != addr)
+        return;
+
+    if (nLatencyMs < 0)
+        return;
+
+    // exponential moving average, weighted toward history so a single slow
+    // handshake does not dominate
+    if (info.nConnectLatency == 0)
+        info.nConnectLatency = (int)nLatencyMs;
+    else
+        info.nConnectLatency = (int)((3 * (int64_t)info.nConnectLatency + nLatencyMs) / 4);
+}
+
 CAddrInfo CAddrMan::Select_(bool newOnly)
 {
     if (size() == 0)
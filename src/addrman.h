@@ -32,6 +32,7 @@
 #include "hash.h"
 #include "netbase.h"
 
+#include <deque>
 #include <map>
 #include <set>
 #include <stdint.h>
@@ -58,6 +59,9 @@ private:
     //! connection attempts since last successful attempt
     int nAttempts;
 
+    //! smoothed connect latency in milliseconds, 0 when never measured
+    int nConnectLatency;
+
     //! reference count in new sets (memory only)
     int nRefCount;
 
@@ -86,6 +90,7 @@ public:
         nLastSuccess = 0;
         nLastTry = 0;
         nAttempts = 0;
+        nConnectLatency = 0;
         nRefCount = 0;
         fInTried = false;
         nRandomPos = -1;
@@ -116,6 +121,9 @@ public:
     //! Calculate in which position of a bucket to store this entry.
     int GetBucketPosition(const uint256 &nKey, bool fNew, int nBucket) const;
 
+    //! Smoothed time it took to establish previous connections, 0 when never measured
+    int GetConnectLatency() const { return nConnectLatency; }
+
     //! Determine whether the statistics about this entry are bad enough so that it can just be deleted
     bool IsTerrible(int64_t nNow = GetTime()) const;
 
@@ -124,6 +132,42 @@ public:
 
 };
 
+/**
+ * One journaled addrman change. Routine peers.dat dumps persist only the
+ * changes made since the previous dump as a sequence of these records;
+ * loading replays them over the last full dump through the normal Add_/
+ * Good_/Attempt_ paths, which recompute the same bucket placements.
+ */
+class CAddrJournalEntry
+{
+public:
+    enum EntryType {
+        JOURNAL_ADD = 'A',
+        JOURNAL_GOOD = 'G',
+        JOURNAL_ATTEMPT = 'T',
+        JOURNAL_LATENCY = 'L',
+    };
+
+    uint8_t nType;
+    CAddress addr;
+    CNetAddr source; //!< only meaningful for JOURNAL_ADD
+    int64_t nTime;   //!< event time, the time penalty for JOURNAL_ADD, or milliseconds for JOURNAL_LATENCY
+
+    CAddrJournalEntry() : nType(JOURNAL_ADD), nTime(0) {}
+    CAddrJournalEntry(uint8_t nTypeIn, const CAddress& addrIn, const CNetAddr& sourceIn, int64_t nTimeIn) :
+        nType(nTypeIn), addr(addrIn), source(sourceIn), nTime(nTimeIn) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nType);
+        READWRITE(addr);
+        READWRITE(source);
+        READWRITE(nTime);
+    }
+};
+
 /** Stochastic address manager
  *
  * Design goals:
@@ -220,6 +264,26 @@ private:
     //! list of "new" buckets
     int vvNew[ADDRMAN_NEW_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE];
 
+    //! changes made since the journal was last drained by DumpAddresses
+    std::deque<CAddrJournalEntry> dqJournalPending;
+
+    //! set when the pending journal overflowed and only a full dump can persist the state
+    bool fJournalOverflow;
+
+    //! cap on dqJournalPending; beyond this a full dump is cheaper anyway
+    static const size_t JOURNAL_PENDING_MAX = 100000;
+
+    //! queue a change for the incremental dump (requires cs)
+    void JournalChange(const CAddrJournalEntry& entry)
+    {
+        if (dqJournalPending.size() >= JOURNAL_PENDING_MAX) {
+            dqJournalPending.clear();
+            fJournalOverflow = true;
+            return;
+        }
+        dqJournalPending.push_back(entry);
+    }
+
 protected:
     //! secret key to randomize bucket select with
     uint256 nKey;
@@ -252,6 +316,9 @@ protected:
     //! Mark an entry as attempted to connect.
     void Attempt_(const CService &addr, int64_t nTime);
 
+    //! Fold a measured connect latency into an entry's smoothed latency.
+    void Latency_(const CService &addr, int64_t nLatencyMs);
+
     //! Select an address to connect to, if newOnly is set to true, only the new table is selected from.
     CAddrInfo Select_(bool newOnly);
 
@@ -283,6 +350,8 @@ protected:
         nNew = 0;
         mapInfo.clear();
         mapAddr.clear();
+        dqJournalPending.clear();
+        fJournalOverflow = false;
     }
 
 #ifdef DEBUG_ADDRMAN
@@ -319,7 +388,8 @@ public:
 
     /**
      * serialized format:
-     * * version byte (1 for pre-asmap files, 2 for files including asmap version)
+     * * version byte (1 for pre-asmap files, 2 for files including asmap version,
+     *   3 for files with connect latencies appended)
      * * 0x20 + nKey (serialized as if it were a vector, for backward compatibility)
      * * nNew
      * * nTried
@@ -351,7 +421,7 @@ public:
     {
         LOCK(cs);
 
-        unsigned char nVersion = 2;
+        unsigned char nVersion = 3;
         s << nVersion;
         s << ((unsigned char)32);
         s << nKey;
@@ -401,6 +471,16 @@ public:
             asmap_version = SerializeHash(m_asmap);
         }
         s << asmap_version;
+        // Store connect latencies after everything else, in the same order as
+        // the entries above, so that older clients simply leave them unread.
+        for (const auto& entry : mapInfo) {
+            if (entry.second.nRefCount)
+                s << entry.second.nConnectLatency;
+        }
+        for (const auto& entry : mapInfo) {
+            if (entry.second.fInTried)
+                s << entry.second.nConnectLatency;
+        }
     }
 
     template<typename Stream>
@@ -443,6 +523,7 @@ public:
 
         // Deserialize entries from the tried table.
         int nLost = 0;
+        std::vector<int> vTriedIds; // id each serialized tried entry ended up with, -1 if lost
         for (int n = 0; n < nTried; n++) {
             CAddrInfo info;
             s >> info;
@@ -455,8 +536,10 @@ public:
                 mapInfo[nIdCount] = info;
                 mapAddr[info] = nIdCount;
                 vvTried[nKBucket][nKBucketPos] = nIdCount;
+                vTriedIds.push_back(nIdCount);
                 nIdCount++;
             } else {
+                vTriedIds.push_back(-1);
                 nLost++;
             }
         }
@@ -486,6 +569,18 @@ public:
             s >> serialized_asmap_version;
         }
 
+        // Connect latencies follow in the same order the entries were stored.
+        if (nVersion > 2) {
+            for (int n = 0; n < nNew; n++)
+                s >> mapInfo[n].nConnectLatency;
+            for (size_t n = 0; n < vTriedIds.size(); n++) {
+                int nLatency = 0;
+                s >> nLatency;
+                if (vTriedIds[n] != -1)
+                    mapInfo[vTriedIds[n]].nConnectLatency = nLatency;
+            }
+        }
+
         for (int n = 0; n < nNew; n++) {
             CAddrInfo &info = mapInfo[n];
             int bucket = entryToBucket[n];
@@ -569,6 +664,8 @@ public:
             LOCK(cs);
             Check();
             fRet |= Add_(addr, source, nTimePenalty);
+            if (fRet)
+                JournalChange(CAddrJournalEntry(CAddrJournalEntry::JOURNAL_ADD, addr, source, nTimePenalty));
             Check();
         }
         if (fRet)
@@ -584,7 +681,10 @@ public:
             LOCK(cs);
             Check();
             for (std::vector<CAddress>::const_iterator it = vAddr.begin(); it != vAddr.end(); it++)
-                nAdd += Add_(*it, source, nTimePenalty) ? 1 : 0;
+                if (Add_(*it, source, nTimePenalty)) {
+                    JournalChange(CAddrJournalEntry(CAddrJournalEntry::JOURNAL_ADD, *it, source, nTimePenalty));
+                    nAdd++;
+                }
             Check();
         }
         if (nAdd)
@@ -599,6 +699,7 @@ public:
             LOCK(cs);
             Check();
             Good_(addr, nTime);
+            JournalChange(CAddrJournalEntry(CAddrJournalEntry::JOURNAL_GOOD, CAddress(addr), CNetAddr(), nTime));
             Check();
         }
     }
@@ -610,7 +711,58 @@ public:
             LOCK(cs);
             Check();
             Attempt_(addr, nTime);
+            JournalChange(CAddrJournalEntry(CAddrJournalEntry::JOURNAL_ATTEMPT, CAddress(addr), CNetAddr(), nTime));
+            Check();
+        }
+    }
+
+    //! Record how long a successful connection took to establish.
+    void Latency(const CService &addr, int64_t nLatencyMs)
+    {
+        {
+            LOCK(cs);
             Check();
+            Latency_(addr, nLatencyMs);
+            JournalChange(CAddrJournalEntry(CAddrJournalEntry::JOURNAL_LATENCY, CAddress(addr), CNetAddr(), nLatencyMs));
+            Check();
+        }
+    }
+
+    /**
+     * Hand over the changes journaled since the last call and clear the
+     * pending queue.
+     * @returns false if the queue overflowed, in which case only a full dump
+     *          can persist the current state
+     */
+    bool GetPendingJournal(std::vector<CAddrJournalEntry>& vEntries)
+    {
+        LOCK(cs);
+        vEntries.assign(dqJournalPending.begin(), dqJournalPending.end());
+        dqJournalPending.clear();
+        bool fOverflow = fJournalOverflow;
+        fJournalOverflow = false;
+        return !fOverflow;
+    }
+
+    //! Re-apply a journaled change loaded from disk (without re-journaling it).
+    void ReplayJournalEntry(const CAddrJournalEntry& entry)
+    {
+        LOCK(cs);
+        switch (entry.nType) {
+        case CAddrJournalEntry::JOURNAL_ADD:
+            Add_(entry.addr, entry.source, entry.nTime);
+            break;
+        case CAddrJournalEntry::JOURNAL_GOOD:
+            Good_(entry.addr, entry.nTime);
+            break;
+        case CAddrJournalEntry::JOURNAL_ATTEMPT:
+            Attempt_(entry.addr, entry.nTime);
+            break;
+        case CAddrJournalEntry::JOURNAL_LATENCY:
+            Latency_(entry.addr, entry.nTime);
+            break;
+        default:
+            break;
         }
     }
 
@@ -23,6 +23,7 @@
 #include <string>
 #include <atomic>
 #include <map>
+#include <set>
 #include <chrono>
 #include <memory>
 #include <thread>
@@ -79,6 +80,18 @@ public:
     // Override this method to add data to the default status object.
     virtual UniValue getStatus() const;
 
+    /**
+     * Identifiers of the wallet resources this operation will spend from,
+     * e.g. source addresses or pre-selected outpoints. The queue will not
+     * run two operations whose key sets intersect at the same time, so
+     * operations touching the same notes serialize while unrelated ones can
+     * execute on concurrent workers. Default is no keys (conflicts with
+     * nothing).
+     */
+    virtual std::set<std::string> getConflictKeys() const {
+        return std::set<std::string>();
+    }
+
     UniValue getError() const;
     
     UniValue getResult() const;
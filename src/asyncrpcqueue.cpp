@@ -43,35 +43,50 @@ AsyncRPCQueue::~AsyncRPCQueue() {
 void AsyncRPCQueue::run(size_t workerId) {
 
     while (true) {
-        AsyncRPCOperationId key;
         std::shared_ptr<AsyncRPCOperation> operation;
+        std::set<std::string> conflictKeys;
         {
             std::unique_lock<std::mutex> guard(lock_);
-            while (operation_id_queue_.empty() && !isClosed() && !isFinishing()) {
-                this->condition_.wait(guard);
-            }
+            bool fFound = false;
+            while (!fFound) {
+                // Exit if the queue is empty and we are finishing up
+                if (isFinishing() && operation_id_queue_.empty()) {
+                    return;
+                }
 
-            // Exit if the queue is empty and we are finishing up
-            if (isFinishing() && operation_id_queue_.empty()) {
-                break;
-            }
+                // Exit if the queue is closing.
+                if (isClosed()) {
+                    operation_id_queue_.clear();
+                    return;
+                }
 
-            // Exit if the queue is closing.
-            if (isClosed()) {
-                while (!operation_id_queue_.empty()) {
-                    operation_id_queue_.pop();
+                // Take the first queued operation that does not share a
+                // conflict key with an operation already executing; ones that
+                // do stay queued until the running operation releases its keys.
+                for (std::deque<AsyncRPCOperationId>::iterator it = operation_id_queue_.begin();
+                     it != operation_id_queue_.end(); ++it) {
+                    std::shared_ptr<AsyncRPCOperation> candidate;
+                    AsyncRPCOperationMap::const_iterator iter = operation_map_.find(*it);
+                    if (iter != operation_map_.end()) {
+                        candidate = iter->second;
+                    }
+                    if (candidate && conflictsWithExecuting(candidate)) {
+                        continue;
+                    }
+                    operation = candidate;
+                    operation_id_queue_.erase(it);
+                    fFound = true;
+                    break;
                 }
-                break;
-            }
 
-            // Get operation id
-            key = operation_id_queue_.front();
-            operation_id_queue_.pop();
+                if (!fFound) {
+                    this->condition_.wait(guard);
+                }
+            }
 
-            // Search operation map
-            AsyncRPCOperationMap::const_iterator iter = operation_map_.find(key);
-            if (iter != operation_map_.end()) {
-                operation = iter->second;
+            if (operation) {
+                conflictKeys = operation->getConflictKeys();
+                executing_keys_.insert(conflictKeys.begin(), conflictKeys.end());
             }
         }
 
@@ -82,7 +97,31 @@ void AsyncRPCQueue::run(size_t workerId) {
         } else {
             operation->main();
         }
+
+        if (!conflictKeys.empty()) {
+            std::lock_guard<std::mutex> guard(lock_);
+            for (const std::string& conflictKey : conflictKeys) {
+                executing_keys_.erase(executing_keys_.find(conflictKey));
+            }
+            // Wake workers that may have been blocked on our keys
+            this->condition_.notify_all();
+        }
+    }
+}
+
+/**
+ * Return true if the operation shares a conflict key with one currently executing.
+ */
+bool AsyncRPCQueue::conflictsWithExecuting(const std::shared_ptr<AsyncRPCOperation> &ptrOperation) const {
+    if (executing_keys_.empty()) {
+        return false;
+    }
+    for (const std::string& conflictKey : ptrOperation->getConflictKeys()) {
+        if (executing_keys_.count(conflictKey) > 0) {
+            return true;
+        }
     }
+    return false;
 }
 
 
@@ -106,7 +145,7 @@ void AsyncRPCQueue::addOperation(const std::shared_ptr<AsyncRPCOperation> &ptrOp
 
     AsyncRPCOperationId id = ptrOperation->getId();
     operation_map_.emplace(id, ptrOperation);
-    operation_id_queue_.push(id);
+    operation_id_queue_.push_back(id);
     this->condition_.notify_one();
 }
 
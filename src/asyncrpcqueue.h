@@ -25,7 +25,8 @@
 #include <iostream>
 #include <string>
 #include <chrono>
-#include <queue>
+#include <deque>
+#include <set>
 #include <unordered_map>
 #include <vector>
 #include <future>
@@ -70,13 +71,20 @@ private:
     void run(size_t workerId);
     void wait_for_worker_threads();
 
+    // Return true if any of the operation's conflict keys belongs to an
+    // operation currently executing on another worker. Caller must hold lock_.
+    bool conflictsWithExecuting(const std::shared_ptr<AsyncRPCOperation> &ptrOperation) const;
+
     // Why this is not a recursive lock: http://www.zaval.org/resources/library/butenhof1.html
     mutable std::mutex lock_;
     std::condition_variable condition_;
     std::atomic<bool> closed_;
     std::atomic<bool> finish_;
     AsyncRPCOperationMap operation_map_;
-    std::queue <AsyncRPCOperationId> operation_id_queue_;
+    std::deque <AsyncRPCOperationId> operation_id_queue_;
+    // Conflict keys of the operations currently being executed; an operation
+    // sharing a key with one of these stays queued until the key is released.
+    std::multiset<std::string> executing_keys_;
     std::vector<std::thread> workers_;
 };
 
@@ -33,6 +33,26 @@
 /** All alphanumeric characters except for "0", "I", "O", and "l" */
 static const char* pszBase58 = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
 
+/** Reverse of pszBase58: maps an ASCII code to its base58 value, -1 if invalid. */
+static const int8_t mapBase58[256] = {
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1, 0, 1, 2, 3, 4, 5, 6, 7, 8,-1,-1,-1,-1,-1,-1,
+    -1, 9,10,11,12,13,14,15,16,-1,17,18,19,20,21,-1,
+    22,23,24,25,26,27,28,29,30,31,32,-1,-1,-1,-1,-1,
+    -1,33,34,35,36,37,38,39,40,41,42,43,-1,44,45,46,
+    47,48,49,50,51,52,53,54,55,56,57,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+};
+
 bool DecodeBase58(const char* psz, std::vector<unsigned char>& vch)
 {
     // Skip leading spaces.
@@ -44,23 +64,37 @@ bool DecodeBase58(const char* psz, std::vector<unsigned char>& vch)
         zeroes++;
         psz++;
     }
-    // Allocate enough space in big-endian base256 representation.
-    std::vector<unsigned char> b256(strlen(psz) * 733 / 1000 + 1); // log(58) / log(256), rounded up.
-    // Process the characters.
+    // Allocate enough space in big-endian base256 representation. The
+    // scratch buffer is thread-local so the address-index RPCs, which decode
+    // and encode millions of addresses, do not pay a heap allocation each.
+    static thread_local std::vector<unsigned char> b256;
+    b256.assign(strlen(psz) * 733 / 1000 + 1, 0); // log(58) / log(256), rounded up.
+    // Process the characters in groups of up to nine digits, folding each
+    // group into a single 64-bit "b256 = b256 * 58^n + chunk" pass: one
+    // carry-propagation sweep (and one division per byte) covers nine input
+    // characters instead of one. 58^9 ~ 2^53 and each sweep step stays below
+    // 255 * 58^9 + 58^9, so the 64-bit carry cannot overflow.
     while (*psz && !isspace(*psz)) {
-        // Decode base58 character
-        const char* ch = strchr(pszBase58, *psz);
-        if (ch == NULL)
-            return false;
-        // Apply "b256 = b256 * 58 + ch".
-        int carry = ch - pszBase58;
+        uint64_t chunk = 0;
+        uint64_t multiplier = 1;
+        int digits = 0;
+        while (digits < 9 && *psz && !isspace(*psz)) {
+            // Decode base58 character
+            int8_t d = mapBase58[(uint8_t)*psz];
+            if (d == -1)
+                return false;
+            chunk = chunk * 58 + d;
+            multiplier *= 58;
+            digits++;
+            psz++;
+        }
+        uint64_t carry = chunk;
         for (std::vector<unsigned char>::reverse_iterator it = b256.rbegin(); it != b256.rend(); it++) {
-            carry += 58 * (*it);
-            *it = carry % 256;
-            carry /= 256;
+            carry += multiplier * (*it);
+            *it = carry & 0xff;
+            carry >>= 8;
         }
         assert(carry == 0);
-        psz++;
     }
     // Skip trailing spaces.
     while (isspace(*psz))
@@ -87,19 +121,32 @@ std::string EncodeBase58(const unsigned char* pbegin, const unsigned char* pend)
         pbegin++;
         zeroes++;
     }
-    // Allocate enough space in big-endian base58 representation.
-    std::vector<unsigned char> b58((pend - pbegin) * 138 / 100 + 1); // log(256) / log(58), rounded up.
-    // Process the bytes.
+    // Allocate enough space in big-endian base58 representation; see
+    // DecodeBase58 for why the scratch buffer is thread-local.
+    static thread_local std::vector<unsigned char> b58;
+    b58.assign((pend - pbegin) * 138 / 100 + 1, 0); // log(256) / log(58), rounded up.
+    // Process the bytes in groups of up to seven, folding each group into a
+    // single 64-bit "b58 = b58 * 2^(8n) + chunk" pass, so one sweep over the
+    // digits (and one division per digit) covers seven input bytes instead
+    // of one. Each sweep step stays below 57 * 2^56 + 2^56, so the 64-bit
+    // carry cannot overflow.
     while (pbegin != pend) {
-        int carry = *pbegin;
-        // Apply "b58 = b58 * 256 + ch".
+        uint64_t chunk = 0;
+        uint64_t factor = 1;
+        int nBytes = 0;
+        while (nBytes < 7 && pbegin != pend) {
+            chunk = (chunk << 8) | *pbegin;
+            factor <<= 8;
+            nBytes++;
+            pbegin++;
+        }
+        uint64_t carry = chunk;
         for (std::vector<unsigned char>::reverse_iterator it = b58.rbegin(); it != b58.rend(); it++) {
-            carry += 256 * (*it);
+            carry += factor * (*it);
             *it = carry % 58;
             carry /= 58;
         }
         assert(carry == 0);
-        pbegin++;
     }
     // Skip leading zeroes in base58 result.
     std::vector<unsigned char>::iterator it = b58.begin();
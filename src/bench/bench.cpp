@@ -0,0 +1,94 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "utiltime.h"
+
+#include <iostream>
+
+using namespace benchmark;
+
+std::map<std::string, BenchFunction>& BenchRunner::benchmarks()
+{
+    // Constructed on first use so BENCHMARK registrations in other translation
+    // units do not race static initialization order.
+    static std::map<std::string, BenchFunction> benchmarksMap;
+    return benchmarksMap;
+}
+
+BenchRunner::BenchRunner(std::string name, BenchFunction func)
+{
+    benchmarks().insert(std::make_pair(name, func));
+}
+
+void BenchRunner::RunAll(const std::string& filter, double elapsedTimeForOne, bool fJson)
+{
+    if (fJson)
+        std::cout << "[" << std::endl;
+    else
+        std::cout << "#Benchmark" << "," << "count" << "," << "min" << "," << "max" << "," << "average" << std::endl;
+
+    bool fFirst = true;
+    for (std::map<std::string, BenchFunction>::const_iterator it = benchmarks().begin();
+         it != benchmarks().end(); ++it) {
+        if (!filter.empty() && it->first.find(filter) == std::string::npos)
+            continue;
+        if (fJson && !fFirst)
+            std::cout << "," << std::endl;
+        fFirst = false;
+        State state(it->first, elapsedTimeForOne, fJson);
+        BenchFunction func = it->second;
+        func(state);
+    }
+
+    if (fJson)
+        std::cout << std::endl << "]" << std::endl;
+}
+
+bool State::KeepRunning()
+{
+    double now;
+    if (count == 0) {
+        beginTime = now = GetTimeMicros() * 0.000001;
+    } else {
+        // timing can be expensive, so perform it only every countMask iterations
+        if ((count & countMask) != 0) {
+            ++count;
+            return true;
+        }
+        now = GetTimeMicros() * 0.000001;
+        double elapsedOne = (now - lastTime) / double(countMask + 1);
+        if (elapsedOne < minTime)
+            minTime = elapsedOne;
+        if (elapsedOne > maxTime)
+            maxTime = elapsedOne;
+        if (elapsedOne * 16 < 0.01) {
+            // If the execution time is fast enough, increase the stride so the
+            // overhead of the clock reads stays out of the measurement.
+            countMask = ((countMask << 1) | 1) & ((1LL << 60) - 1);
+        }
+    }
+    lastTime = now;
+    // Keep going unless we have run long enough
+    if (now - beginTime < maxElapsed) {
+        ++count;
+        return true;
+    }
+
+    --count;
+
+    double average = (now - beginTime) / count;
+    if (fJson) {
+        std::cout << "  {\"name\": \"" << name << "\", \"iterations\": " << count
+                  << ", \"min\": " << minTime << ", \"max\": " << maxTime
+                  << ", \"average\": " << average << "}";
+        std::cout.flush();
+    } else {
+        std::cout << name << "," << count << "," << minTime << "," << maxTime << "," << average << std::endl;
+    }
+
+    // Once we're done, keep returning false
+    return false;
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BENCH_BENCH_H
+#define BITCOIN_BENCH_BENCH_H
+
+#include <limits>
+#include <map>
+#include <string>
+
+#include <stdint.h>
+
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+/*
+ * Micro-benchmark framework for komodo-bench.
+ *
+ * Usage:
+ *
+ * static void CODE_TO_TIME(benchmark::State& state)
+ * {
+ *     ... setup ...
+ *     while (state.KeepRunning()) {
+ *        ... do stuff you want to time ...
+ *     }
+ *     ... teardown ...
+ * }
+ *
+ * BENCHMARK(CODE_TO_TIME);
+ *
+ * KeepRunning() reads the clock only every few iterations (doubling the
+ * stride as iterations get cheap) so the timing overhead stays negligible
+ * even for nanosecond-scale bodies.
+ */
+namespace benchmark {
+
+class State
+{
+    std::string name;
+    double maxElapsed;
+    double beginTime;
+    double lastTime, minTime, maxTime;
+    uint64_t count;
+    uint64_t countMask;
+    bool fJson;
+
+public:
+    State(std::string nameIn, double maxElapsedIn, bool fJsonIn)
+        : name(nameIn), maxElapsed(maxElapsedIn), minTime(std::numeric_limits<double>::max()),
+          maxTime(std::numeric_limits<double>::min()), count(0), countMask(1), fJson(fJsonIn)
+    {
+        lastTime = beginTime = 0;
+    }
+    bool KeepRunning();
+};
+
+typedef void (*BenchFunction)(State&);
+
+class BenchRunner
+{
+    static std::map<std::string, BenchFunction>& benchmarks();
+
+public:
+    BenchRunner(std::string name, BenchFunction func);
+
+    //! Run every benchmark whose name contains filter ("" runs all).
+    //! With fJson the results are printed as one JSON array for CI ingestion.
+    static void RunAll(const std::string& filter = "", double elapsedTimeForOne = 1.0, bool fJson = false);
+};
+
+} // namespace benchmark
+
+// BENCHMARK(foo) expands to:  benchmark::BenchRunner bench_11foo("foo", foo);
+#define BENCHMARK(n) \
+    benchmark::BenchRunner BOOST_PP_CAT(bench_, BOOST_PP_CAT(__LINE__, n))(BOOST_PP_STRINGIZE(n), n);
+
+#endif // BITCOIN_BENCH_BENCH_H
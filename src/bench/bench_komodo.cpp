@@ -0,0 +1,42 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "assetchain.h"
+#include "chainparams.h"
+#include "crypto/common.h"
+#include "key.h"
+#include "util.h"
+
+#include <string>
+
+int main(int argc, char** argv)
+{
+    assert(init_and_check_sodium() != -1);
+    ECC_Start();
+    ECCVerifyHandle verifyHandle;
+    SetupEnvironment();
+    SelectParams(CBaseChainParams::MAIN);
+    chainName = assetchain(); // KMD by default
+
+    // komodo-bench [-json] [-filter=<substring>] [-time=<seconds per benchmark>]
+    bool fJson = false;
+    std::string filter;
+    double elapsedTimeForOne = 1.0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-json")
+            fJson = true;
+        else if (arg.compare(0, 8, "-filter=") == 0)
+            filter = arg.substr(8);
+        else if (arg.compare(0, 6, "-time=") == 0)
+            elapsedTimeForOne = atof(arg.substr(6).c_str());
+    }
+
+    benchmark::BenchRunner::RunAll(filter, elapsedTimeForOne, fJson);
+
+    ECC_Stop();
+    return 0;
+}
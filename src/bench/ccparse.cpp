@@ -0,0 +1,55 @@
+#include "bench.h"
+
+#include "cryptoconditions/include/cryptoconditions.h"
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+// Parsing condition/fulfillment binaries happens for every CC vout a node
+// validates or indexes, so the ASN.1 decode cost multiplies across blocks.
+
+//! A 1-of-2 threshold over an eval node and a secp256k1 key, the shape most
+//! Antara modules put on their vouts.
+static struct CC* MakeBenchCondition()
+{
+    char err[1024];
+    const char* json =
+        "{\"type\":\"threshold-sha-256\",\"threshold\":1,\"subfulfillments\":["
+        "{\"type\":\"eval-sha-256\",\"code\":\"5A\"},"
+        "{\"type\":\"secp256k1-sha-256\",\"publicKey\":\"02adf84e0e075cf90868bd4e3d34a03420e034719649c41f371fc70d8e33aa2702\"}"
+        "]}";
+    struct CC* cond = cc_conditionFromJSONString(json, err);
+    assert(cond != NULL);
+    return cond;
+}
+
+static void CCParseConditionBinary(benchmark::State& state)
+{
+    struct CC* cond = MakeBenchCondition();
+    std::vector<uint8_t> condBin(1000);
+    size_t condBinLen = cc_conditionBinary(cond, condBin.data());
+    assert(condBinLen > 0);
+    cc_free(cond);
+
+    while (state.KeepRunning()) {
+        struct CC* parsed = cc_readConditionBinary(condBin.data(), condBinLen);
+        assert(parsed != NULL);
+        cc_free(parsed);
+    }
+}
+
+static void CCConditionToBinary(benchmark::State& state)
+{
+    struct CC* cond = MakeBenchCondition();
+    std::vector<uint8_t> condBin(1000);
+
+    while (state.KeepRunning()) {
+        size_t condBinLen = cc_conditionBinary(cond, condBin.data());
+        assert(condBinLen > 0);
+    }
+    cc_free(cond);
+}
+
+BENCHMARK(CCParseConditionBinary);
+BENCHMARK(CCConditionToBinary);
@@ -0,0 +1,81 @@
+// Copyright (c) 2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "coins.h"
+#include "hash.h"
+#include "primitives/transaction.h"
+#include "script/script.h"
+#include "uint256.h"
+
+#include <vector>
+
+static const size_t NUM_COINS = 10000;
+
+static uint256 BenchTxid(size_t n)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << n;
+    return ss.GetHash();
+}
+
+//! Fill a cache with NUM_COINS single-output coins keyed by deterministic txids.
+static void FillCoinsCache(CCoinsViewCache& cache, std::vector<uint256>& vTxids)
+{
+    vTxids.reserve(NUM_COINS);
+    for (size_t i = 0; i < NUM_COINS; i++) {
+        CMutableTransaction mtx;
+        mtx.vout.resize(1);
+        mtx.vout[0].nValue = 1000 + (CAmount)i;
+        mtx.vout[0].scriptPubKey = CScript() << OP_DUP << OP_HASH160
+                                             << std::vector<unsigned char>(20, (unsigned char)i) << OP_EQUALVERIFY << OP_CHECKSIG;
+        uint256 txid = BenchTxid(i);
+        vTxids.push_back(txid);
+        CCoinsModifier coins = cache.ModifyCoins(txid);
+        coins->FromTx(mtx, 1);
+    }
+}
+
+// Warm-cache lookups: all hits stay in the top cache, so this measures the
+// CCoinsMap hashing and probing that every input fetch pays.
+static void CCoinsCacheAccess(benchmark::State& state)
+{
+    CCoinsView backend;
+    CCoinsViewCache cache(&backend);
+    std::vector<uint256> vTxids;
+    FillCoinsCache(cache, vTxids);
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const CCoins* coins = cache.AccessCoins(vTxids[i % NUM_COINS]);
+        assert(coins != NULL);
+        i++;
+    }
+}
+
+// Miss path: the child cache is empty, so every lookup walks to the parent
+// cache and copies the entry in, the same work FetchCoins does when a block's
+// inputs are cold.
+static void CCoinsCacheFetchMiss(benchmark::State& state)
+{
+    CCoinsView backend;
+    CCoinsViewCache base(&backend);
+    std::vector<uint256> vTxids;
+    FillCoinsCache(base, vTxids);
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        CCoinsViewCache cache(&base);
+        // pull a batch through the cold cache, roughly one block's worth of inputs
+        for (size_t j = 0; j < 100; j++) {
+            const CCoins* coins = cache.AccessCoins(vTxids[(i + j * 97) % NUM_COINS]);
+            assert(coins != NULL);
+        }
+        i++;
+    }
+}
+
+BENCHMARK(CCoinsCacheAccess);
+BENCHMARK(CCoinsCacheFetchMiss);
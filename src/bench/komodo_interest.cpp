@@ -0,0 +1,32 @@
+#include "bench.h"
+
+#include "amount.h"
+#include "komodo_interest.h"
+#include "script/script.h"
+
+// komodo_interest runs for every KMD input with a locktime, so it sits on the
+// hot path of block validation and getrawtransaction alike. Heights straddle
+// the 250000 and 1000000 rule changes to hit the different formula branches.
+
+static void KomodoInterest(benchmark::State& state)
+{
+    uint32_t nLockTime = LOCKTIME_THRESHOLD + 1000000;
+    uint32_t tiptime = nLockTime + 30 * 24 * 60 * 60; // a month of accrual
+    int32_t height = 200000;
+    while (state.KeepRunning()) {
+        komodo_interest(height, 100 * COIN, nLockTime, tiptime);
+        height = (height % 3000000) + 250000;
+    }
+}
+
+static void KomodoInterestNew(benchmark::State& state)
+{
+    uint32_t nLockTime = LOCKTIME_THRESHOLD + 1000000;
+    uint32_t tiptime = nLockTime + 30 * 24 * 60 * 60;
+    while (state.KeepRunning()) {
+        komodo_interestnew(2000000, 100 * COIN, nLockTime, tiptime);
+    }
+}
+
+BENCHMARK(KomodoInterest);
+BENCHMARK(KomodoInterestNew);
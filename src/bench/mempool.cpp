@@ -0,0 +1,62 @@
+// Copyright (c) 2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "amount.h"
+#include "chainparams.h"
+#include "consensus/upgrades.h"
+#include "policy/fees.h"
+#include "primitives/transaction.h"
+#include "txmempool.h"
+#include "utiltime.h"
+
+#include <list>
+#include <vector>
+
+//! Build a chain of simple transactions, each spending the previous one.
+static void MakeTxChain(std::vector<CTransaction>& vtx, size_t count)
+{
+    vtx.reserve(count);
+    uint256 prevHash;
+    for (size_t i = 0; i < count; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout.hash = prevHash;
+        mtx.vin[0].prevout.n = 0;
+        mtx.vin[0].scriptSig = CScript() << (int)i;
+        mtx.vout.resize(1);
+        mtx.vout[0].nValue = 11 * CENT;
+        mtx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+        CTransaction tx(mtx);
+        prevHash = tx.GetHash();
+        vtx.push_back(tx);
+    }
+}
+
+// The mempool bookkeeping AcceptToMemoryPool ends with: addUnchecked into the
+// indexed multi-container, then removal as if a block confirmed the chain.
+// The consensus checks ATMP performs before this are covered by the coins and
+// script benchmarks; this isolates the data-structure cost.
+static void MempoolAddRemove(benchmark::State& state)
+{
+    static const size_t CHAIN_LENGTH = 100;
+    std::vector<CTransaction> vtx;
+    MakeTxChain(vtx, CHAIN_LENGTH);
+
+    CTxMemPool pool(CFeeRate(1000));
+    uint32_t consensusBranchId = CurrentEpochBranchId(1, Params().GetConsensus());
+
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < vtx.size(); i++) {
+            CTxMemPoolEntry entry(vtx[i], 1000, GetTime(), 1.0, 1000000, false, i > 0, consensusBranchId);
+            pool.addUnchecked(vtx[i].GetHash(), entry, false);
+        }
+        std::list<CTransaction> removed;
+        pool.remove(vtx[0], removed, true);
+        assert(removed.size() == CHAIN_LENGTH);
+    }
+}
+
+BENCHMARK(MempoolAddRemove);
@@ -26,6 +26,8 @@
 #include "utilstrencodings.h"
 
 #include <boost/filesystem/operations.hpp>
+#include <fstream>
+#include <iostream>
 #include <stdio.h>
 
 #include <event2/buffer.h>
@@ -41,6 +43,7 @@ assetchain chainName;
 using namespace std;
 
 static const int DEFAULT_HTTP_CLIENT_TIMEOUT=900;
+static const int DEFAULT_RPC_PIPELINE=16;
 static const int CONTINUE_EXECUTION=-1;
 
 std::string HelpMessageCli()
@@ -60,6 +63,9 @@ std::string HelpMessageCli()
     strUsage += HelpMessageOpt("-rpcpassword=<pw>", _("Password for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcclienttimeout=<n>", strprintf(_("Timeout in seconds during HTTP requests, or 0 for no timeout. (default: %d)"), DEFAULT_HTTP_CLIENT_TIMEOUT));
     strUsage += HelpMessageOpt("-stdin", _("Read extra arguments from standard input, one per line until EOF/Ctrl-D (recommended for sensitive information such as passphrases)"));
+    strUsage += HelpMessageOpt("-stdinrpc", _("Read whole commands (method and arguments) from standard input, one per line, and execute them over a single kept-alive connection; results are written as one JSON object per line"));
+    strUsage += HelpMessageOpt("-cmdfile=<file>", _("Like -stdinrpc, but read the commands from <file>"));
+    strUsage += HelpMessageOpt("-rpcpipeline=<n>", strprintf(_("In -stdinrpc/-cmdfile mode, keep up to <n> requests in flight on the connection (default: %d)"), DEFAULT_RPC_PIPELINE));
 
     return strUsage;
 }
@@ -210,27 +216,9 @@ static void http_error_cb(enum evhttp_request_error err, void *ctx)
 }
 #endif
 
-UniValue CallRPC(const std::string& strMethod, const UniValue& params)
+// Get credentials
+static std::string GetRPCCredentials()
 {
-    std::string host = GetArg("-rpcconnect", "127.0.0.1");
-    int port = GetArg("-rpcport", BaseParams().RPCPort());
-    BITCOIND_RPCPORT = port;
-    // Obtain event base
-    raii_event_base base = obtain_event_base();
-
-    // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
-    evhttp_connection_set_timeout(evcon.get(), GetArg("-rpcclienttimeout", DEFAULT_HTTP_CLIENT_TIMEOUT));
-
-    HTTPReply response;
-    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
-    if (req == NULL)
-        throw std::runtime_error("create http request failed");
-#if LIBEVENT_VERSION_NUMBER >= 0x02010300
-    evhttp_request_set_error_cb(req.get(), http_error_cb);
-#endif
-
-    // Get credentials
     std::string strRPCUserColonPass;
     if (mapArgs["-rpcpassword"] == "") {
         // Try fall back to cookie-based authentication if no password is provided
@@ -244,27 +232,12 @@ UniValue CallRPC(const std::string& strMethod, const UniValue& params)
     } else {
         strRPCUserColonPass = mapArgs["-rpcuser"] + ":" + mapArgs["-rpcpassword"];
     }
+    return strRPCUserColonPass;
+}
 
-    struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
-    assert(output_headers);
-    evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
-    evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(strRPCUserColonPass)).c_str());
-
-    // Attach request data
-    std::string strRequest = JSONRPCRequest(strMethod, params, 1);
-    struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
-    assert(output_buffer);
-    evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
-
-    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, "/");
-    req.release(); // ownership moved to evcon in above call
-    if (r != 0) {
-        throw CConnectionFailed("send http request failed");
-    }
-
-    event_base_dispatch(base.get());
-
+// Validate an HTTP response and parse the JSON-RPC reply object out of it
+static UniValue ParseReply(const HTTPReply& response)
+{
     if (response.status == 0)
         throw CConnectionFailed(strprintf("couldn't connect to server: %s (code %d)\n(make sure server is running and you are connecting to the correct RPC port)", http_errorstring(response.error), response.error));
     else if (response.status == HTTP_UNAUTHORIZED)
@@ -285,6 +258,164 @@ UniValue CallRPC(const std::string& strMethod, const UniValue& params)
     return reply;
 }
 
+// Build a request carrying strRequest and queue it on evcon. In keep-alive
+// mode several requests can be in flight on the connection at once.
+static void SendRequest(struct evhttp_connection* evcon, const std::string& host,
+                        const std::string& strAuth, const std::string& strRequest,
+                        bool fKeepAlive, HTTPReply* response)
+{
+    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)response);
+    if (req == NULL)
+        throw std::runtime_error("create http request failed");
+#if LIBEVENT_VERSION_NUMBER >= 0x02010300
+    evhttp_request_set_error_cb(req.get(), http_error_cb);
+#endif
+
+    struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
+    assert(output_headers);
+    evhttp_add_header(output_headers, "Host", host.c_str());
+    evhttp_add_header(output_headers, "Connection", fKeepAlive ? "keep-alive" : "close");
+    evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(strAuth)).c_str());
+
+    // Attach request data
+    struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
+    assert(output_buffer);
+    evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
+
+    int r = evhttp_make_request(evcon, req.get(), EVHTTP_REQ_POST, "/");
+    req.release(); // ownership moved to evcon in above call
+    if (r != 0) {
+        throw CConnectionFailed("send http request failed");
+    }
+}
+
+UniValue CallRPC(const std::string& strMethod, const UniValue& params)
+{
+    std::string host = GetArg("-rpcconnect", "127.0.0.1");
+    int port = GetArg("-rpcport", BaseParams().RPCPort());
+    BITCOIND_RPCPORT = port;
+    // Obtain event base
+    raii_event_base base = obtain_event_base();
+
+    // Synchronously look up hostname
+    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
+    evhttp_connection_set_timeout(evcon.get(), GetArg("-rpcclienttimeout", DEFAULT_HTTP_CLIENT_TIMEOUT));
+
+    HTTPReply response;
+    SendRequest(evcon.get(), host, GetRPCCredentials(), JSONRPCRequest(strMethod, params, 1), false, &response);
+
+    event_base_dispatch(base.get());
+
+    return ParseReply(response);
+}
+
+// Split one streamed command line into method and arguments. Double quotes
+// group a token (and are stripped), so JSON arguments containing spaces
+// survive the split the same way they would in a shell.
+static std::vector<std::string> SplitCommandLine(const std::string& strLine)
+{
+    std::vector<std::string> vTokens;
+    std::string strToken;
+    bool fQuoted = false, fHaveToken = false;
+    for (size_t i = 0; i < strLine.size(); i++) {
+        char c = strLine[i];
+        if (c == '"') {
+            fQuoted = !fQuoted;
+            fHaveToken = true;
+        } else if (!fQuoted && (c == ' ' || c == '\t' || c == '\r')) {
+            if (fHaveToken)
+                vTokens.push_back(strToken);
+            strToken.clear();
+            fHaveToken = false;
+        } else {
+            strToken += c;
+            fHaveToken = true;
+        }
+    }
+    if (fHaveToken)
+        vTokens.push_back(strToken);
+    return vTokens;
+}
+
+// Execute commands read one per line from stream over a single kept-alive
+// connection, keeping up to -rpcpipeline requests in flight, and write the
+// raw JSON-RPC reply objects out one per line (-stdinrpc / -cmdfile mode).
+static int StreamRPC(std::istream& stream)
+{
+    std::string host = GetArg("-rpcconnect", "127.0.0.1");
+    int port = GetArg("-rpcport", BaseParams().RPCPort());
+    BITCOIND_RPCPORT = port;
+    int nPipeline = GetArg("-rpcpipeline", DEFAULT_RPC_PIPELINE);
+    if (nPipeline < 1)
+        nPipeline = 1;
+
+    raii_event_base base = obtain_event_base();
+    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
+    evhttp_connection_set_timeout(evcon.get(), GetArg("-rpcclienttimeout", DEFAULT_HTTP_CLIENT_TIMEOUT));
+
+    const std::string strAuth = GetRPCCredentials();
+
+    int nRet = 0;
+    std::string line;
+    bool fMore = true;
+    while (fMore) {
+        // collect the next window of commands
+        std::vector<std::string> vLines;
+        while ((int)vLines.size() < nPipeline) {
+            if (!std::getline(stream, line)) {
+                fMore = false;
+                break;
+            }
+            size_t nFirst = line.find_first_not_of(" \t\r");
+            if (nFirst == std::string::npos || line[nFirst] == '#')
+                continue;
+            vLines.push_back(line.substr(nFirst));
+        }
+        if (vLines.empty())
+            break;
+
+        // convert and queue the whole window before dispatching, so the
+        // requests travel the connection back to back
+        std::vector<HTTPReply> vReplies(vLines.size());
+        std::vector<std::string> vLocalErrors(vLines.size());
+        for (size_t i = 0; i < vLines.size(); i++) {
+            try {
+                std::vector<std::string> vTokens = SplitCommandLine(vLines[i]);
+                if (vTokens.empty())
+                    throw std::runtime_error("empty command");
+                UniValue params = RPCConvertValues(vTokens[0], std::vector<std::string>(vTokens.begin() + 1, vTokens.end()));
+                SendRequest(evcon.get(), host, strAuth, JSONRPCRequest(vTokens[0], params, (int)i + 1), true, &vReplies[i]);
+            } catch (const CConnectionFailed&) {
+                throw;
+            } catch (const std::exception& e) {
+                vLocalErrors[i] = e.what();
+            }
+        }
+
+        event_base_dispatch(base.get());
+
+        for (size_t i = 0; i < vLines.size(); i++) {
+            if (!vLocalErrors[i].empty()) {
+                UniValue errReply(UniValue::VOBJ);
+                UniValue err(UniValue::VOBJ);
+                err.push_back(Pair("code", RPC_PARSE_ERROR));
+                err.push_back(Pair("message", vLocalErrors[i]));
+                errReply.push_back(Pair("result", NullUniValue));
+                errReply.push_back(Pair("error", err));
+                fprintf(stdout, "%s\n", errReply.write().c_str());
+                nRet = EXIT_FAILURE;
+                continue;
+            }
+            const UniValue reply = ParseReply(vReplies[i]);
+            if (!find_value(reply, "error").isNull())
+                nRet = EXIT_FAILURE;
+            fprintf(stdout, "%s\n", reply.write().c_str());
+        }
+        fflush(stdout);
+    }
+    return nRet;
+}
+
 int CommandLineRPC(int argc, char *argv[])
 {
     std::string strPrint;
@@ -296,6 +427,14 @@ int CommandLineRPC(int argc, char *argv[])
             argv++;
         }
         std::vector<std::string> args = std::vector<std::string>(&argv[1], &argv[argc]);
+        if (mapArgs.count("-cmdfile")) {
+            std::ifstream file(GetArg("-cmdfile", "").c_str());
+            if (!file.good())
+                throw std::runtime_error(strprintf("cannot open command file %s", GetArg("-cmdfile", "")));
+            return StreamRPC(file);
+        }
+        if (GetBoolArg("-stdinrpc", false))
+            return StreamRPC(std::cin);
         if (GetBoolArg("-stdin", false)) {
             // Read one arg per line from stdin and append
             std::string line;
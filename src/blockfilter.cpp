@@ -0,0 +1,111 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+
+#include "crypto/siphash.h"
+#include "hash.h"
+#include "serialize.h"
+#include "streams.h"
+#include "version.h"
+
+#include <algorithm>
+#include <set>
+
+/** Append Golomb-Rice coded values to a byte vector, most significant bit first */
+class CBitWriter
+{
+private:
+    std::vector<unsigned char>& vch;
+    int nBitPos;
+
+public:
+    CBitWriter(std::vector<unsigned char>& vchIn) : vch(vchIn), nBitPos(0) {}
+
+    void WriteBit(bool bit)
+    {
+        if (nBitPos == 0)
+            vch.push_back(0);
+        if (bit)
+            vch.back() |= (1 << (7 - nBitPos));
+        nBitPos = (nBitPos + 1) % 8;
+    }
+
+    void WriteBits(uint64_t nValue, int nBits)
+    {
+        for (int i = nBits - 1; i >= 0; i--)
+            WriteBit((nValue >> i) & 1);
+    }
+
+    //! Unary quotient (q one-bits and a terminating zero), then P remainder bits
+    void WriteGolombRice(uint64_t nValue, int P)
+    {
+        uint64_t q = nValue >> P;
+        while (q > 0) {
+            WriteBit(true);
+            q--;
+        }
+        WriteBit(false);
+        WriteBits(nValue & ((uint64_t(1) << P) - 1), P);
+    }
+};
+
+/** Map a hashed element uniformly onto [0, nRange) without division */
+static uint64_t MapIntoRange(uint64_t nHash, uint64_t nRange)
+{
+    return (uint64_t)(((unsigned __int128)nHash * (unsigned __int128)nRange) >> 64);
+}
+
+CBlockFilter::CBlockFilter(const CBlock& block, const std::vector<CScript>& vSpentScripts)
+{
+    blockHash = block.GetHash();
+
+    // BIP158 basic filter contents: every output script plus every spent
+    // script, deduplicated; empty and OP_RETURN scripts carry no match
+    // value for a light client and are skipped
+    std::set<CScript> setScripts;
+    for (const CTransaction& tx : block.vtx) {
+        for (const CTxOut& txout : tx.vout) {
+            if (txout.scriptPubKey.empty() || txout.scriptPubKey[0] == OP_RETURN)
+                continue;
+            setScripts.insert(txout.scriptPubKey);
+        }
+    }
+    for (const CScript& script : vSpentScripts) {
+        if (script.empty() || script[0] == OP_RETURN)
+            continue;
+        setScripts.insert(script);
+    }
+
+    // the set is keyed by the block hash so elements hash differently in
+    // every block
+    uint64_t k0 = 0, k1 = 0;
+    memcpy(&k0, blockHash.begin(), 8);
+    memcpy(&k1, blockHash.begin() + 8, 8);
+
+    uint64_t nRange = (uint64_t)setScripts.size() * GCS_M;
+    std::vector<uint64_t> vHashed;
+    vHashed.reserve(setScripts.size());
+    for (const CScript& script : setScripts) {
+        uint64_t nHash = CSipHasher(k0, k1).Write(&script[0], script.size()).Finalize();
+        vHashed.push_back(MapIntoRange(nHash, nRange));
+    }
+    std::sort(vHashed.begin(), vHashed.end());
+
+    CDataStream ssCount(SER_NETWORK, PROTOCOL_VERSION);
+    WriteCompactSize(ssCount, setScripts.size());
+    vchFilter.assign(ssCount.begin(), ssCount.end());
+
+    CBitWriter writer(vchFilter);
+    uint64_t nLast = 0;
+    for (uint64_t nValue : vHashed) {
+        writer.WriteGolombRice(nValue - nLast, GCS_P);
+        nLast = nValue;
+    }
+}
+
+uint256 CBlockFilter::GetHash() const
+{
+    return Hash(vchFilter.begin(), vchFilter.end());
+}
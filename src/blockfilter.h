@@ -0,0 +1,57 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILTER_H
+#define BITCOIN_BLOCKFILTER_H
+
+#include "primitives/block.h"
+#include "script/script.h"
+#include "uint256.h"
+
+#include <vector>
+
+/**
+ * A compact per-block filter over the scripts a block touches, in the
+ * BIP158 "basic" construction: every output script of every transaction
+ * plus every script being spent, hashed into a Golomb-coded set keyed by
+ * the block hash. Light clients match their own scripts against the
+ * encoded filter and only fetch blocks that hit, so the per-peer CPU cost
+ * of BIP37 bloom filtering becomes a one-time per-block computation.
+ */
+class CBlockFilter
+{
+public:
+    //! Golomb-Rice coding parameter (bits in the remainder)
+    static const int GCS_P = 19;
+    //! False positive rate parameter; the hash domain is N * GCS_M
+    static const uint32_t GCS_M = 784931;
+
+    CBlockFilter() {}
+
+    /**
+     * Build the filter for a connected block.
+     * @param block the block
+     * @param vSpentScripts scriptPubKeys of the outputs the block spends,
+     *        collected by the caller while the prevouts were still in view
+     */
+    CBlockFilter(const CBlock& block, const std::vector<CScript>& vSpentScripts);
+
+    //! Reconstruct a filter from its stored encoding
+    CBlockFilter(const uint256& blockHashIn, const std::vector<unsigned char>& vchEncoded)
+        : blockHash(blockHashIn), vchFilter(vchEncoded) {}
+
+    //! The serialized filter: element count as CompactSize, then the coded set
+    const std::vector<unsigned char>& GetEncoded() const { return vchFilter; }
+
+    const uint256& GetBlockHash() const { return blockHash; }
+
+    //! Double-SHA256 of the encoded filter, as committed to by filter headers
+    uint256 GetHash() const;
+
+private:
+    uint256 blockHash;
+    std::vector<unsigned char> vchFilter;
+};
+
+#endif // BITCOIN_BLOCKFILTER_H
@@ -73,15 +73,37 @@ inline unsigned int CBloomFilter::Hash(unsigned int nHashNum, const std::vector<
     return MurmurHash3(nHashNum * 0xFBA4C795 + nTweak, vDataToHash) % (vData.size() * 8);
 }
 
+void CBloomFilter::HashAll(const std::vector<unsigned char>& vDataToHash, unsigned int* pnIndexes) const
+{
+    unsigned int nSeeds[MAX_HASH_FUNCS];
+    for (unsigned int i = 0; i < nHashFuncs; i++)
+        nSeeds[i] = i * 0xFBA4C795 + nTweak;
+    MurmurHash3Multi(nSeeds, nHashFuncs, vDataToHash, pnIndexes);
+    for (unsigned int i = 0; i < nHashFuncs; i++)
+        pnIndexes[i] %= vData.size() * 8;
+}
+
 void CBloomFilter::insert(const vector<unsigned char>& vKey)
 {
     if (isFull)
         return;
-    for (unsigned int i = 0; i < nHashFuncs; i++)
+    if (nHashFuncs <= MAX_HASH_FUNCS)
+    {
+        // all bit positions are needed anyway, so compute them in one pass
+        unsigned int nIndexes[MAX_HASH_FUNCS];
+        HashAll(vKey, nIndexes);
+        for (unsigned int i = 0; i < nHashFuncs; i++)
+            vData[nIndexes[i] >> 3] |= (1 << (7 & nIndexes[i]));
+    }
+    else
     {
-        unsigned int nIndex = Hash(i, vKey);
-        // Sets bit nIndex of vData
-        vData[nIndex >> 3] |= (1 << (7 & nIndex));
+        // rolling filters may exceed the protocol cap on hash functions
+        for (unsigned int i = 0; i < nHashFuncs; i++)
+        {
+            unsigned int nIndex = Hash(i, vKey);
+            // Sets bit nIndex of vData
+            vData[nIndex >> 3] |= (1 << (7 & nIndex));
+        }
     }
     isEmpty = false;
 }
@@ -106,12 +128,35 @@ bool CBloomFilter::contains(const vector<unsigned char>& vKey) const
         return true;
     if (isEmpty)
         return false;
-    for (unsigned int i = 0; i < nHashFuncs; i++)
+    // The first probe rejects most non-matching keys outright; only when it
+    // hits are the remaining probes computed, in a single shared pass over
+    // the data.
+    unsigned int nIndex = Hash(0, vKey);
+    if (!(vData[nIndex >> 3] & (1 << (7 & nIndex))))
+        return false;
+    if (nHashFuncs > 1 && nHashFuncs <= MAX_HASH_FUNCS)
     {
-        unsigned int nIndex = Hash(i, vKey);
-        // Checks bit nIndex of vData
-        if (!(vData[nIndex >> 3] & (1 << (7 & nIndex))))
-            return false;
+        unsigned int nSeeds[MAX_HASH_FUNCS];
+        unsigned int nIndexes[MAX_HASH_FUNCS];
+        for (unsigned int i = 1; i < nHashFuncs; i++)
+            nSeeds[i - 1] = i * 0xFBA4C795 + nTweak;
+        MurmurHash3Multi(nSeeds, nHashFuncs - 1, vKey, nIndexes);
+        for (unsigned int i = 0; i + 1 < nHashFuncs; i++)
+        {
+            nIndex = nIndexes[i] % (vData.size() * 8);
+            if (!(vData[nIndex >> 3] & (1 << (7 & nIndex))))
+                return false;
+        }
+    }
+    else
+    {
+        for (unsigned int i = 1; i < nHashFuncs; i++)
+        {
+            nIndex = Hash(i, vKey);
+            // Checks bit nIndex of vData
+            if (!(vData[nIndex >> 3] & (1 << (7 & nIndex))))
+                return false;
+        }
     }
     return true;
 }
@@ -148,7 +193,48 @@ bool CBloomFilter::IsWithinSizeConstraints() const
     return vData.size() <= MAX_BLOOM_FILTER_SIZE && nHashFuncs <= MAX_HASH_FUNCS;
 }
 
+CTxBloomDigest::CTxBloomDigest(const CTransaction& tx) : hash(tx.GetHash())
+{
+    for (unsigned int i = 0; i < tx.vout.size(); i++)
+    {
+        const CTxOut& txout = tx.vout[i];
+        CScript::const_iterator pc = txout.scriptPubKey.begin();
+        vector<unsigned char> data;
+        while (pc < txout.scriptPubKey.end())
+        {
+            opcodetype opcode;
+            if (!txout.scriptPubKey.GetOp(pc, opcode, data))
+                break;
+            if (data.size() != 0)
+                vOutElements.push_back(make_pair(i, data));
+        }
+    }
+    BOOST_FOREACH(const CTxIn& txin, tx.vin)
+    {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << txin.prevout;
+        vPrevOuts.push_back(vector<unsigned char>(stream.begin(), stream.end()));
+
+        CScript::const_iterator pc = txin.scriptSig.begin();
+        vector<unsigned char> data;
+        while (pc < txin.scriptSig.end())
+        {
+            opcodetype opcode;
+            if (!txin.scriptSig.GetOp(pc, opcode, data))
+                break;
+            if (data.size() != 0)
+                vInElements.push_back(data);
+        }
+    }
+}
+
 bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
+{
+    CTxBloomDigest digest(tx);
+    return IsRelevantAndUpdate(tx, digest);
+}
+
+bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx, const CTxBloomDigest& digest)
 {
     bool fFound = false;
     // Match if the filter contains the hash of tx
@@ -157,38 +243,33 @@ bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
         return true;
     if (isEmpty)
         return false;
-    const uint256& hash = tx.GetHash();
+    const uint256& hash = digest.hash;
     if (contains(hash))
         fFound = true;
 
-    for (unsigned int i = 0; i < tx.vout.size(); i++)
+    unsigned int nMatchedOut = ~0U;
+    for (size_t n = 0; n < digest.vOutElements.size(); n++)
     {
-        const CTxOut& txout = tx.vout[i];
         // Match if the filter contains any arbitrary script data element in any scriptPubKey in tx
         // If this matches, also add the specific output that was matched.
-        // This means clients don't have to update the filter themselves when a new relevant tx 
+        // This means clients don't have to update the filter themselves when a new relevant tx
         // is discovered in order to find spending transactions, which avoids round-tripping and race conditions.
-        CScript::const_iterator pc = txout.scriptPubKey.begin();
-        vector<unsigned char> data;
-        while (pc < txout.scriptPubKey.end())
+        unsigned int i = digest.vOutElements[n].first;
+        if (i == nMatchedOut)
+            continue; // this output already matched on an earlier element
+        if (contains(digest.vOutElements[n].second))
         {
-            opcodetype opcode;
-            if (!txout.scriptPubKey.GetOp(pc, opcode, data))
-                break;
-            if (data.size() != 0 && contains(data))
+            fFound = true;
+            nMatchedOut = i;
+            if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_ALL)
+                insert(COutPoint(hash, i));
+            else if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_P2PUBKEY_ONLY)
             {
-                fFound = true;
-                if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_ALL)
+                txnouttype type;
+                vector<vector<unsigned char> > vSolutions;
+                if (Solver(tx.vout[i].scriptPubKey, type, vSolutions) &&
+                        (type == TX_PUBKEY || type == TX_MULTISIG))
                     insert(COutPoint(hash, i));
-                else if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_P2PUBKEY_ONLY)
-                {
-                    txnouttype type;
-                    vector<vector<unsigned char> > vSolutions;
-                    if (Solver(txout.scriptPubKey, type, vSolutions) &&
-                            (type == TX_PUBKEY || type == TX_MULTISIG))
-                        insert(COutPoint(hash, i));
-                }
-                break;
             }
         }
     }
@@ -196,24 +277,15 @@ bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
     if (fFound)
         return true;
 
-    BOOST_FOREACH(const CTxIn& txin, tx.vin)
-    {
-        // Match if the filter contains an outpoint tx spends
-        if (contains(txin.prevout))
+    // Match if the filter contains an outpoint tx spends
+    BOOST_FOREACH(const vector<unsigned char>& data, digest.vPrevOuts)
+        if (contains(data))
             return true;
 
-        // Match if the filter contains any arbitrary script data element in any scriptSig in tx
-        CScript::const_iterator pc = txin.scriptSig.begin();
-        vector<unsigned char> data;
-        while (pc < txin.scriptSig.end())
-        {
-            opcodetype opcode;
-            if (!txin.scriptSig.GetOp(pc, opcode, data))
-                break;
-            if (data.size() != 0 && contains(data))
-                return true;
-        }
-    }
+    // Match if the filter contains any arbitrary script data element in any scriptSig in tx
+    BOOST_FOREACH(const vector<unsigned char>& data, digest.vInElements)
+        if (contains(data))
+            return true;
 
     return false;
 }
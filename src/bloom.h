@@ -21,12 +21,13 @@
 #define BITCOIN_BLOOM_H
 
 #include "serialize.h"
+#include "uint256.h"
 
+#include <utility>
 #include <vector>
 
 class COutPoint;
 class CTransaction;
-class uint256;
 
 //! 20,000 items with fp rate < 0.1% or 10,000 items and <0.0001%
 static const unsigned int MAX_BLOOM_FILTER_SIZE = 36000; // bytes
@@ -45,6 +46,27 @@ enum bloomflags
     BLOOM_UPDATE_MASK = 3,
 };
 
+/**
+ * The data elements of a transaction that bloom matching probes, extracted
+ * once. A relay node serving many filter-loaded peers builds this per
+ * transaction and tests it against every peer's filter, instead of re-parsing
+ * the same scripts for each peer.
+ */
+class CTxBloomDigest
+{
+public:
+    explicit CTxBloomDigest(const CTransaction& tx);
+
+    //! the transaction hash
+    uint256 hash;
+    //! pushed data elements of the output scripts, with their output index
+    std::vector<std::pair<unsigned int, std::vector<unsigned char> > > vOutElements;
+    //! serialized prevouts spent by the inputs
+    std::vector<std::vector<unsigned char> > vPrevOuts;
+    //! pushed data elements of the input scripts
+    std::vector<std::vector<unsigned char> > vInElements;
+};
+
 /**
  * BloomFilter is a probabilistic filter which SPV clients provide
  * so that we can filter the transactions we send them.
@@ -68,6 +90,9 @@ private:
 
     unsigned int Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const;
 
+    //! Compute all nHashFuncs bit indexes for vDataToHash in one pass over the data
+    void HashAll(const std::vector<unsigned char>& vDataToHash, unsigned int* pnIndexes) const;
+
     // Private constructor for CRollingBloomFilter, no restrictions on size
     CBloomFilter(unsigned int nElements, double nFPRate, unsigned int nTweak);
     friend class CRollingBloomFilter;
@@ -113,6 +138,9 @@ public:
     //! Also adds any outputs which match the filter to the filter (to match their spending txes)
     bool IsRelevantAndUpdate(const CTransaction& tx);
 
+    //! Same, probing a pre-extracted digest so one digest serves many filters
+    bool IsRelevantAndUpdate(const CTransaction& tx, const CTxBloomDigest& digest);
+
     //! Checks for empty and full filters to avoid wasting cpu
     void UpdateEmptyFull();
 };
@@ -18,6 +18,10 @@
 // This code was moved to a separate source file to enable linking libcommon.so (with importcoin.cpp which depends on some token functions)
 
 #include "CCtokens.h"
+#include "../hash.h"
+
+#include <deque>
+#include <map>
 
 #ifndef IS_CHARINSTR
 #define IS_CHARINSTR(c, str) (std::string(str).find((char)(c)) != std::string::npos)
@@ -175,10 +179,10 @@ uint8_t DecodeTokenCreateOpRet(const CScript &scriptPubKey, std::vector<uint8_t>
     return (uint8_t)0;
 }
 
-// decode token opret: 
-// for 't' returns all data from opret, vopretExtra contains other contract's data (currently only assets'). 
+// decode token opret:
+// for 't' returns all data from opret, vopretExtra contains other contract's data (currently only assets').
 // for 'c' returns only funcid. NOTE: nonfungible data is not returned
-uint8_t DecodeTokenOpRet(const CScript scriptPubKey, uint8_t &evalCodeTokens, uint256 &tokenid, std::vector<CPubKey> &voutPubkeys, std::vector<std::pair<uint8_t, vscript_t>>  &oprets)
+static uint8_t DecodeTokenOpRetUncached(const CScript scriptPubKey, uint8_t &evalCodeTokens, uint256 &tokenid, std::vector<CPubKey> &voutPubkeys, std::vector<std::pair<uint8_t, vscript_t>>  &oprets)
 {
     vscript_t vopret, vblob, dummyPubkey, vnonfungibleDummy;
     uint8_t funcId = 0, *script, dummyEvalCode, dummyFuncId, ccType, opretId = 0;
@@ -276,6 +280,61 @@ uint8_t DecodeTokenOpRet(const CScript scriptPubKey, uint8_t &evalCodeTokens, ui
     return (uint8_t)0;
 }
 
+// Decoded token oprets are requested for the same transaction by mempool
+// acceptance, block validation and the token RPCs, each attempting several
+// E_UNMARSHAL layouts. Memoize the decoded structure keyed by the opret
+// script hash so every path after the first is a map lookup; failures are
+// cached too so malformed oprets are not re-parsed either.
+struct CCTokenOpRetCacheEntry
+{
+    uint8_t evalcode, funcid;
+    uint256 tokenid;
+    std::vector<CPubKey> voutPubkeys;
+    std::vector<std::pair<uint8_t, vscript_t>> oprets;
+};
+#define TOKEN_OPRET_CACHE_SIZE 8192
+static CCriticalSection cs_tokenOpRetCache;
+static std::map<uint256, CCTokenOpRetCacheEntry> tokenOpRetCache;
+static std::deque<uint256> tokenOpRetCacheOrder; // FIFO eviction
+
+uint8_t DecodeTokenOpRet(const CScript scriptPubKey, uint8_t &evalCodeTokens, uint256 &tokenid, std::vector<CPubKey> &voutPubkeys, std::vector<std::pair<uint8_t, vscript_t>>  &oprets)
+{
+    uint256 key = Hash(scriptPubKey.begin(), scriptPubKey.end());
+    {
+        LOCK(cs_tokenOpRetCache);
+        std::map<uint256, CCTokenOpRetCacheEntry>::const_iterator it = tokenOpRetCache.find(key);
+        if (it != tokenOpRetCache.end())
+        {
+            evalCodeTokens = it->second.evalcode;
+            tokenid = it->second.tokenid;
+            voutPubkeys = it->second.voutPubkeys;
+            oprets = it->second.oprets;
+            return(it->second.funcid);
+        }
+    }
+    evalCodeTokens = 0;
+    uint8_t funcid = DecodeTokenOpRetUncached(scriptPubKey, evalCodeTokens, tokenid, voutPubkeys, oprets);
+    {
+        LOCK(cs_tokenOpRetCache);
+        if (tokenOpRetCache.count(key) == 0)
+        {
+            CCTokenOpRetCacheEntry &entry = tokenOpRetCache[key];
+            entry.evalcode = evalCodeTokens;
+            entry.funcid = funcid;
+            entry.tokenid = tokenid;
+            entry.voutPubkeys = voutPubkeys;
+            entry.oprets = oprets;
+            tokenOpRetCacheOrder.push_back(key);
+            while (tokenOpRetCacheOrder.size() > TOKEN_OPRET_CACHE_SIZE)
+            {
+                tokenOpRetCache.erase(tokenOpRetCacheOrder.front());
+                tokenOpRetCacheOrder.pop_front();
+            }
+        }
+    }
+    return(funcid);
+}
+
 
 // make three-eval (token+evalcode+evalcode2) 1of2 cryptocondition:
 CC *MakeTokensCCcond1of2(uint8_t evalcode, uint8_t evalcode2, CPubKey pk1, CPubKey pk2)
@@ -24,6 +24,10 @@
 #include "key_io.h"
 #include "komodo_bitcoind.h"
 
+#include <atomic>
+#include <deque>
+#include <set>
+
 #ifdef TESTMODE           
     #define MIN_NON_NOTARIZED_CONFIRMS 2
 #else
@@ -306,14 +310,106 @@ CPubKey CCCustomtxidaddr(char *txidaddr,uint256 txid,uint8_t taddr,uint8_t prefi
     return(pk);
 }
 
+// Lock-free cache of derived CC addresses. Deriving one builds a
+// cryptocondition, serializes it and hashes to an address; validation asks
+// for the same (evalcode, pubkey) pairs endlessly, so memoize the result.
+// Slots are claimed with a CAS and published with a release store; entries
+// are immutable once published since derivation is deterministic. A full
+// probe window just means callers re-derive, which is always correct.
+#define CCADDR_CACHE_SLOTS 512   // power of two
+#define CCADDR_CACHE_PROBES 8
+
+struct CCaddrCacheSlot
+{
+    std::atomic<uint32_t> state; // 0 empty, 1 claimed, 2 published
+    uint8_t type,evalcode,evalcode2;
+    uint8_t pub33[33];
+    char destaddr[64];
+};
+static CCaddrCacheSlot CCaddrCache[CCADDR_CACHE_SLOTS];
+
+static uint32_t CCaddrCacheHash(uint8_t type,uint8_t evalcode,uint8_t evalcode2,CPubKey pk)
+{
+    uint32_t i,hash = 0x811c9dc5 ^ type ^ (evalcode << 8) ^ (evalcode2 << 16);
+    for (i=0; i<33; i++)
+        hash = (hash ^ pk.begin()[i]) * 0x01000193;
+    return(hash);
+}
+
+static bool CCaddrCacheLookup(uint8_t type,uint8_t evalcode,uint8_t evalcode2,CPubKey pk,char *destaddr)
+{
+    uint32_t i,hash;
+    if ( pk.size() != 33 )
+        return(false);
+    hash = CCaddrCacheHash(type,evalcode,evalcode2,pk);
+    for (i=0; i<CCADDR_CACHE_PROBES; i++)
+    {
+        struct CCaddrCacheSlot &slot = CCaddrCache[(hash + i) & (CCADDR_CACHE_SLOTS - 1)];
+        uint32_t state = slot.state.load(std::memory_order_acquire);
+        if ( state == 0 ) // first free slot ends the probe chain
+            break;
+        if ( state == 2 && slot.type == type && slot.evalcode == evalcode && slot.evalcode2 == evalcode2 && memcmp(slot.pub33,pk.begin(),33) == 0 )
+        {
+            strcpy(destaddr,slot.destaddr);
+            return(true);
+        }
+    }
+    return(false);
+}
+
+static void CCaddrCacheInsert(uint8_t type,uint8_t evalcode,uint8_t evalcode2,CPubKey pk,const char *destaddr)
+{
+    uint32_t i,hash;
+    if ( pk.size() != 33 || destaddr[0] == 0 )
+        return;
+    hash = CCaddrCacheHash(type,evalcode,evalcode2,pk);
+    for (i=0; i<CCADDR_CACHE_PROBES; i++)
+    {
+        struct CCaddrCacheSlot &slot = CCaddrCache[(hash + i) & (CCADDR_CACHE_SLOTS - 1)];
+        uint32_t expected = 0;
+        if ( slot.state.compare_exchange_strong(expected,1,std::memory_order_acq_rel) )
+        {
+            slot.type = type, slot.evalcode = evalcode, slot.evalcode2 = evalcode2;
+            memcpy(slot.pub33,pk.begin(),33);
+            strcpy(slot.destaddr,destaddr);
+            slot.state.store(2,std::memory_order_release);
+            return;
+        }
+        if ( expected == 2 && slot.type == type && slot.evalcode == evalcode && slot.evalcode2 == evalcode2 && memcmp(slot.pub33,pk.begin(),33) == 0 )
+            return; // another thread already cached it
+    }
+}
+
+//! Seed the cache with each contract's global CC address straight from the
+//! static tables behind CCinit, so the hottest entries never derive at all.
+static void CCaddrCacheWarmup()
+{
+    static const uint8_t evalcodes[] = { EVAL_ASSETS, EVAL_FAUCET, EVAL_REWARDS, EVAL_DICE, EVAL_FSM, EVAL_AUCTION, EVAL_LOTTO, EVAL_HEIR, EVAL_CHANNELS, EVAL_ORACLES, EVAL_PAYMENTS, EVAL_GATEWAYS, EVAL_TOKENS, EVAL_IMPORTGATEWAY };
+    struct CCcontract_info *cp,C; uint8_t pub33[33]; int32_t i;
+    for (i=0; i<(int32_t)sizeof(evalcodes); i++)
+    {
+        cp = CCinit(&C,evalcodes[i]);
+        if ( cp == 0 || cp->CChexstr[0] == 0 || cp->unspendableCCaddr[0] == 0 )
+            continue;
+        decode_hex(pub33,33,cp->CChexstr);
+        CCaddrCacheInsert(0,evalcodes[i],0,buf2pk(pub33),cp->unspendableCCaddr);
+    }
+}
+
 bool _GetCCaddress(char *destaddr,uint8_t evalcode,CPubKey pk)
 {
+    static std::atomic<int32_t> fWarmed(0);
     CC *payoutCond;
+    if ( fWarmed.exchange(1) == 0 )
+        CCaddrCacheWarmup();
     destaddr[0] = 0;
+    if ( CCaddrCacheLookup(0,evalcode,0,pk,destaddr) )
+        return(true);
     if ( (payoutCond= MakeCCcond1(evalcode,pk)) != 0 )
     {
         Getscriptaddress(destaddr,CCPubKey(payoutCond));
         cc_free(payoutCond);
+        CCaddrCacheInsert(0,evalcode,0,pk,destaddr);
     }
     return(destaddr[0] != 0);
 }
@@ -330,10 +426,13 @@ bool _GetTokensCCaddress(char *destaddr, uint8_t evalcode, uint8_t evalcode2, CP
 {
 	CC *payoutCond;
 	destaddr[0] = 0;
+	if (CCaddrCacheLookup(1, evalcode, evalcode2, pk, destaddr))
+		return(true);
 	if ((payoutCond = MakeTokensCCcond1(evalcode, evalcode2, pk)) != 0)
 	{
 		Getscriptaddress(destaddr, CCPubKey(payoutCond));
 		cc_free(payoutCond);
+		CCaddrCacheInsert(1, evalcode, evalcode2, pk, destaddr);
 	}
 	return(destaddr[0] != 0);
 }
@@ -671,15 +770,30 @@ int32_t komodo_get_current_height()
     else return chainActive.Tip()->nHeight;
 }
 
+// a tx confirmed under a notarization stays confirmed: the notarized height cannot be
+// reorged away, so a positive answer for such a txid is final and CC validation paths
+// that gate on it repeatedly (gateways, channels, oracles) can skip the tx and block
+// index lookups. answers for txs above the last notarized height are not remembered.
+#define TXNOTARIZED_CACHE_SIZE 8192
+static CSharedCriticalSection cs_txnotarizedCache; // read-mostly: lookups vastly outnumber inserts
+static std::set<uint256> setTxNotarizedConfirmed;
+static std::deque<uint256> txnotarizedCacheOrder; // FIFO eviction
+
 bool komodo_txnotarizedconfirmed(uint256 txid)
 {
     char str[65];
     int32_t confirms,notarized=0,txheight=0,currentheight=0;;
     CTransaction tx;
     uint256 hashBlock;
-    CBlockIndex *pindex;    
+    CBlockIndex *pindex;
     char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN]; struct komodo_state *sp;
 
+    {
+        READ_LOCK(cs_txnotarizedCache);
+        if ( setTxNotarizedConfirmed.count(txid) != 0 )
+            return (true);
+    }
+
     if ( KOMODO_NSPV_SUPERLITE )
     {
         if ( NSPV_myGetTransaction(txid,tx,hashBlock,txheight,currentheight) == 0 )
@@ -729,7 +843,19 @@ bool komodo_txnotarizedconfirmed(uint256 txid)
     notarized=0;
 #endif //TESTMODE
     if (notarized>0 && confirms > 1)
+    {
+        WRITE_LOCK(cs_txnotarizedCache);
+        if ( setTxNotarizedConfirmed.insert(txid).second )
+        {
+            txnotarizedCacheOrder.push_back(txid);
+            while ( txnotarizedCacheOrder.size() > TXNOTARIZED_CACHE_SIZE )
+            {
+                setTxNotarizedConfirmed.erase(txnotarizedCacheOrder.front());
+                txnotarizedCacheOrder.pop_front();
+            }
+        }
         return (true);
+    }
     else if (notarized==0 && confirms >= MIN_NON_NOTARIZED_CONFIRMS)
         return (true);
     return (false);
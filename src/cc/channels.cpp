@@ -182,6 +182,24 @@ bool ChannelsExactAmounts(struct CCcontract_info *cp,Eval* eval,const CTransacti
     return(false);
 }
 
+// Verified hashchain anchors per channel. Validating the Nth payment of a
+// channel hashes its secret (numpayments - depth) times to reach the open
+// tx's final hashchain, making payment N cost O(N). But once a payment at
+// depth d with secret s has been verified, sha^(numpayments-d)(s) == hashchain
+// is established, so the next payment at depth d' < d only needs to hash its
+// secret (d - d') times and compare against s. The relation is pure math on
+// the channel's immutable hashchain, so anchors stay correct across reorgs
+// and losing block candidates and never need invalidating.
+struct CChannelAnchor
+{
+    int32_t depth,numpayments;
+    uint256 secret,hashchain;
+    CChannelAnchor() : depth(0),numpayments(0) {}
+};
+#define CHANNEL_ANCHORS_MAX 8192
+static CCriticalSection cs_channelAnchors;
+static std::map<uint256,CChannelAnchor> mapChannelAnchors; // keyed by opentxid
+
 bool ChannelsValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &tx, uint32_t nIn)
 {
     int32_t numvins,numvouts,preventCCvins,preventCCvouts,i,numpayments,p1,param1; bool retval;
@@ -264,15 +282,26 @@ bool ChannelsValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &
                         else if ( param1 > CHANNELS_MAXPAYMENTS)
                             return eval->Invalid("too many payment increments!");
                         else
-                        {                           
+                        {
+                            uint256 target = hashchain; int32_t numhashes = numpayments-param1;
+                            {
+                                LOCK(cs_channelAnchors);
+                                std::map<uint256,CChannelAnchor>::iterator it = mapChannelAnchors.find(opentxid);
+                                if ( it != mapChannelAnchors.end() && it->second.numpayments == numpayments && it->second.hashchain == hashchain && param1 <= it->second.depth )
+                                {
+                                    // only need to reach the nearest verified anchor
+                                    numhashes = it->second.depth - param1;
+                                    target = it->second.secret;
+                                }
+                            }
                             endiancpy(hash, (uint8_t * ) & param3, 32);
-                            for (i = 0; i < numpayments-param1; i++)
+                            for (i = 0; i < numhashes; i++)
                             {
                                 vcalc_sha256(0, hashdest, hash, 32);
                                 memcpy(hash, hashdest, 32);
                             }
-                            endiancpy((uint8_t*)&genhashchain,hashdest,32);
-                            if (hashchain!=genhashchain)
+                            endiancpy((uint8_t*)&genhashchain,hash,32);
+                            if (target!=genhashchain)
                                 return eval->Invalid("invalid secret for payment, does not reach final hashchain!");
                             else if (tx.vout[3].nValue != param2*payment)
                                 return eval->Invalid("vout amount does not match number_of_payments*payment!");
@@ -289,6 +318,20 @@ bool ChannelsValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &
                                 else if (tx.vout[3].nValue > prevTx.vout[0].nValue)
                                     return eval->Invalid("not enough funds in channel for that amount!");
                             }
+                            {
+                                // remember the deepest verified secret for this channel
+                                LOCK(cs_channelAnchors);
+                                CChannelAnchor &anchor = mapChannelAnchors[opentxid];
+                                if ( anchor.numpayments == 0 || anchor.numpayments != numpayments || anchor.hashchain != hashchain || param1 < anchor.depth )
+                                {
+                                    anchor.depth = param1;
+                                    anchor.secret = param3;
+                                    anchor.numpayments = numpayments;
+                                    anchor.hashchain = hashchain;
+                                }
+                                if ( mapChannelAnchors.size() > CHANNEL_ANCHORS_MAX )
+                                    mapChannelAnchors.erase(mapChannelAnchors.begin());
+                            }
                         }
                         break;
                     case 'C':
@@ -98,6 +98,9 @@ What is needed is for the dealer node to track the entropy tx that was already b
 
 #include "../compat/endian.h"
 
+#include <map>
+#include <set>
+
 #define MAX_ENTROPYUSED 8192
 #define DICE_MINUTXOS 15000
 
@@ -199,6 +202,103 @@ struct dice_entropy *_dicerevealed_add(uint256 entropyused,uint256 bettxid,CTran
     return(ptr);
 }
 
+// pending bet index: DiceStatus scans used to rediscover every open bet by walking the whole
+// global CC address utxo set and refetching the bet and entropy txs for each one on every call,
+// so the dealer finish loop cost grew with the square of open bets. bets are registered here the
+// first time they are decoded, keyed by bettxid with an expiry height ordering, so later scans
+// only pay the full decode for bets that are new or past their timeout
+pthread_mutex_t DICEPENDING_MUTEX = PTHREAD_MUTEX_INITIALIZER;
+
+struct dice_pendingbet
+{
+    UT_hash_handle hh;
+    uint256 bettxid,fundingtxid;
+    uint64_t sbits;
+    int32_t expiryht;
+} *DICE_PENDING;
+static std::multimap<int32_t,uint256> DICE_PENDING_EXPIRY; // expiry height -> bettxid
+
+void _dicepending_remove(struct dice_pendingbet *ptr)
+{
+    std::multimap<int32_t,uint256>::iterator it;
+    for (it=DICE_PENDING_EXPIRY.lower_bound(ptr->expiryht); it!=DICE_PENDING_EXPIRY.end() && it->first == ptr->expiryht; it++)
+    {
+        if ( it->second == ptr->bettxid )
+        {
+            DICE_PENDING_EXPIRY.erase(it);
+            break;
+        }
+    }
+    HASH_DELETE(hh,DICE_PENDING,ptr);
+    free(ptr);
+}
+
+int32_t DicePendingAdd(uint64_t sbits,uint256 fundingtxid,uint256 bettxid,int32_t expiryht)
+{
+    struct dice_pendingbet *ptr; int32_t added = 0;
+    pthread_mutex_lock(&DICEPENDING_MUTEX);
+    HASH_FIND(hh,DICE_PENDING,&bettxid,sizeof(bettxid),ptr);
+    if ( ptr == 0 )
+    {
+        ptr = (struct dice_pendingbet *)calloc(1,sizeof(*ptr));
+        ptr->bettxid = bettxid;
+        ptr->fundingtxid = fundingtxid;
+        ptr->sbits = sbits;
+        ptr->expiryht = expiryht;
+        HASH_ADD(hh,DICE_PENDING,bettxid,sizeof(bettxid),ptr);
+        DICE_PENDING_EXPIRY.insert(std::make_pair(expiryht,bettxid));
+        added = 1;
+    }
+    pthread_mutex_unlock(&DICEPENDING_MUTEX);
+    return(added);
+}
+
+void DicePendingRemove(uint256 bettxid)
+{
+    struct dice_pendingbet *ptr;
+    pthread_mutex_lock(&DICEPENDING_MUTEX);
+    HASH_FIND(hh,DICE_PENDING,&bettxid,sizeof(bettxid),ptr);
+    if ( ptr != 0 )
+        _dicepending_remove(ptr);
+    pthread_mutex_unlock(&DICEPENDING_MUTEX);
+}
+
+int32_t DicePendingFind(uint256 bettxid)
+{
+    struct dice_pendingbet *ptr;
+    pthread_mutex_lock(&DICEPENDING_MUTEX);
+    HASH_FIND(hh,DICE_PENDING,&bettxid,sizeof(bettxid),ptr);
+    pthread_mutex_unlock(&DICEPENDING_MUTEX);
+    return(ptr != 0);
+}
+
+int32_t DicePendingExpired(std::vector<uint256> &expired,uint256 fundingtxid,int32_t height)
+{
+    struct dice_pendingbet *ptr; std::multimap<int32_t,uint256>::iterator it;
+    pthread_mutex_lock(&DICEPENDING_MUTEX);
+    for (it=DICE_PENDING_EXPIRY.begin(); it!=DICE_PENDING_EXPIRY.end() && it->first <= height; it++)
+    {
+        HASH_FIND(hh,DICE_PENDING,&(it->second),sizeof(uint256),ptr);
+        if ( ptr != 0 && ptr->fundingtxid == fundingtxid )
+            expired.push_back(it->second);
+    }
+    pthread_mutex_unlock(&DICEPENDING_MUTEX);
+    return((int32_t)expired.size());
+}
+
+void DicePendingPrune(std::set<uint256> &live)
+{
+    struct dice_pendingbet *ptr,*tmp;
+    pthread_mutex_lock(&DICEPENDING_MUTEX);
+    HASH_ITER(hh,DICE_PENDING,ptr,tmp)
+    {
+        // the CC address is global, so any indexed utxo missing from it has been spent
+        if ( live.count(ptr->bettxid) == 0 )
+            _dicepending_remove(ptr);
+    }
+    pthread_mutex_unlock(&DICEPENDING_MUTEX);
+}
+
 int32_t DiceEntropyUsed(CTransaction &oldbetTx,uint256 &oldbettxid,int32_t &oldentropyvout,uint256 entropyused,uint256 bettxid,CTransaction betTx,int32_t entropyvout)
 {
     int32_t retval;
@@ -316,6 +416,7 @@ void dicefinish_delete(struct dicefinish_info *ptr)
     pthread_mutex_lock(&DICE_MUTEX);
     _dicehash_clear(ptr->bettxid);
     pthread_mutex_unlock(&DICE_MUTEX);
+    DicePendingRemove(ptr->bettxid); // orphaned bets get reindexed by the next scan
     DL_DELETE(DICEFINISH_LIST,ptr);
     free(ptr);
 }
@@ -1774,6 +1875,7 @@ double DiceStatus(uint64_t txfee,char *planstr,uint256 fundingtxid,uint256 bettx
             return(0.);
         }
         std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+        std::set<uint256> liveBets; std::vector<uint256> dueBets; uint256 reffundingtxid = fundingtxid; int32_t curht = KOMODO_INSYNC;
         SetCCunspents(unspentOutputs,coinaddr,true);
         for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
         {
@@ -1782,10 +1884,16 @@ double DiceStatus(uint64_t txfee,char *planstr,uint256 fundingtxid,uint256 bettx
             if ( vout != 0 )
                 continue;
             sum += it->second.satoshis;
+            liveBets.insert(txid);
+            // utxos classified by a previous scan were queued then; due bets are redriven below in expiry order
+            if ( IS_KOMODO_DEALERNODE && scriptPubKey == fundingPubKey && DicePendingFind(txid) != 0 )
+                continue;
             if ( myGetTransaction(txid,betTx,hashBlock) != 0 && betTx.vout.size() >= 4 && betTx.vout[vout].scriptPubKey.IsPayToCryptoCondition() != 0 )
             {
                 if ( DecodeDiceOpRet(txid,betTx.vout[betTx.vout.size()-1].scriptPubKey,sbits,fundingtxid,hash,proof) == 'B' && sbits == refsbits )
                 {
+                    if ( IS_KOMODO_DEALERNODE && scriptPubKey == fundingPubKey )
+                        DicePendingAdd(sbits,fundingtxid,txid,it->second.blockHeight+(int32_t)timeoutblocks);
                     if ( myGetTransaction(betTx.vin[0].prevout.hash,entropyTx,hashBlock) != 0 )
                     {
                         if ( IS_KOMODO_DEALERNODE && scriptPubKey == fundingPubKey )
@@ -1815,6 +1923,33 @@ double DiceStatus(uint64_t txfee,char *planstr,uint256 fundingtxid,uint256 bettx
                         }
                     } else fprintf(stderr,"bettxid.%s cant find entropyTx.%s\n",txid.GetHex().c_str(),betTx.vin[0].prevout.hash.GetHex().c_str());
                 }
+                else if ( IS_KOMODO_DEALERNODE && scriptPubKey == fundingPubKey )
+                    DicePendingAdd(0,zeroid,txid,0x7fffffff); // funding/entropy utxo, skip it on later scans
+            }
+        }
+        if ( IS_KOMODO_DEALERNODE && scriptPubKey == fundingPubKey )
+        {
+            DicePendingPrune(liveBets);
+            // bets that reached their timeout height are reprocessed in expiry order so the oldest get a finish first
+            if ( DicePendingExpired(dueBets,reffundingtxid,curht) > 0 )
+            {
+                for (std::vector<uint256>::iterator dit=dueBets.begin(); dit!=dueBets.end(); dit++)
+                {
+                    txid = *dit;
+                    if ( myGetTransaction(txid,betTx,hashBlock) != 0 && betTx.vout.size() >= 4 && DecodeDiceOpRet(txid,betTx.vout[betTx.vout.size()-1].scriptPubKey,sbits,fundingtxid,hash,proof) == 'B' && myGetTransaction(betTx.vin[0].prevout.hash,entropyTx,hashBlock) != 0 )
+                    {
+                        bettorentropy = DiceGetEntropy(betTx,'B');
+                        if ( (iswin= DiceIsWinner(hentropyproof,entropyvout,txid,betTx,entropyTx,bettorentropy,sbits,minbet,maxbet,maxodds,timeoutblocks,reffundingtxid)) != 0 )
+                        {
+                            if ( iswin > 0 )
+                                win++;
+                            else if ( iswin < 0 )
+                                loss++;
+                            n++;
+                            DiceQueue(iswin,sbits,reffundingtxid,txid,betTx,entropyvout);
+                        }
+                    }
+                }
             }
         }
         if ( didinit == 0 && !IS_KOMODO_DEALERNODE && scriptPubKey == fundingPubKey )
@@ -30,6 +30,9 @@
 #include "komodo_notary.h"
 #include "komodo_globals.h"
 
+#include <deque>
+#include <set>
+
 bool CClib_Dispatch(const CC *cond,Eval *eval,std::vector<uint8_t> paramsNull,const CTransaction &txTo,unsigned int nIn);
 char *CClib_name();
 
@@ -37,8 +40,79 @@ Eval* EVAL_TEST = 0;
 struct CCcontract_info CCinfos[0x100];
 extern pthread_mutex_t KOMODO_CC_mutex;
 
+// Dense dispatch tables resolved once after the chain args are parsed:
+// whether an evalcode can ever run on this chain and from which height.
+// Dispatch rejects spends of codes the chain never enabled with two array
+// loads, before taking KOMODO_CC_mutex or copying the condition params, and
+// the contract table entries for the codes a chain does enable are filled in
+// up front instead of under the mutex on first spend.
+uint8_t CC_EVAL_ENABLED[0x100];
+int32_t CC_EVAL_ACTIVATES[0x100];
+static int32_t didCCdispatchinit;
+
+void CCDispatchInit()
+{
+    static const uint8_t builtins[] = {
+        EVAL_ASSETS, EVAL_FAUCET, EVAL_REWARDS, EVAL_DICE, EVAL_LOTTO,
+        EVAL_FSM, EVAL_AUCTION, EVAL_HEIR, EVAL_CHANNELS, EVAL_ORACLES,
+        EVAL_PAYMENTS, EVAL_GATEWAYS, EVAL_TOKENS, EVAL_IMPORTGATEWAY };
+    int32_t i;
+    for (i=0; i<0x100; i++)
+    {
+        CC_EVAL_ENABLED[i] = (ASSETCHAINS_CCDISABLES[i] == 0);
+        CC_EVAL_ACTIVATES[i] = mapHeightEvalActivate[(int8_t)i];
+    }
+    if ( ASSETCHAINS_CC != 0 )
+    {
+        for (i=0; i<(int32_t)sizeof(builtins); i++)
+        {
+            uint8_t ecode = builtins[i];
+            struct CCcontract_info *cp = &CCinfos[(int32_t)ecode];
+            if ( CC_EVAL_ENABLED[ecode] != 0 && cp->didinit == 0 && CCinit(cp,ecode) != 0 )
+                cp->didinit = 1;
+        }
+    }
+    didCCdispatchinit = 1;
+}
+
+// A spend is CC-validated when it enters the mempool, again in any block
+// candidate and again in the block that finally connects, each time against
+// the same chain context. Remember the successful evaluations keyed by
+// (txid, nIn, condition bytes, tip hash) so the repeats are a set lookup;
+// keying by the tip means stale entries can never validate against a new
+// context, and the set is dropped outright when a block disconnects.
+#define CC_EVAL_CACHE_SIZE 16384
+static CCriticalSection cs_ccEvalCache;
+static std::set<uint256> setCCEvalValid;
+static std::deque<uint256> ccEvalCacheOrder; // FIFO eviction
+
+void CCEvalCacheClear()
+{
+    LOCK(cs_ccEvalCache);
+    setCCEvalValid.clear();
+    ccEvalCacheOrder.clear();
+}
+
+static uint256 CCEvalCacheEntry(const CC *cond, const CTransaction &tx, unsigned int nIn, const uint256 &tiphash)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << tx.GetHash() << nIn << tiphash;
+    ss.write((const char *)cond->code, cond->codeLength);
+    return ss.GetHash();
+}
+
 bool RunCCEval(const CC *cond, const CTransaction &tx, unsigned int nIn)
 {
+    uint256 entry; bool fCacheable = false;
+    CBlockIndex *tip = chainActive.Tip();
+    if ( tip != 0 )
+    {
+        entry = CCEvalCacheEntry(cond, tx, nIn, tip->GetBlockHash());
+        fCacheable = true;
+        LOCK(cs_ccEvalCache);
+        if ( setCCEvalValid.count(entry) != 0 )
+            return true;
+    }
     EvalRef eval;
     pthread_mutex_lock(&KOMODO_CC_mutex);
     bool out = eval->Dispatch(cond, tx, nIn);
@@ -47,7 +121,23 @@ bool RunCCEval(const CC *cond, const CTransaction &tx, unsigned int nIn)
         fprintf(stderr,"out %d vs %d isValid\n",(int32_t)out,(int32_t)eval->state.IsValid());
     //assert(eval->state.IsValid() == out);
 
-    if (eval->state.IsValid()) return true;
+    if (eval->state.IsValid())
+    {
+        if ( fCacheable )
+        {
+            LOCK(cs_ccEvalCache);
+            if ( setCCEvalValid.insert(entry).second )
+            {
+                ccEvalCacheOrder.push_back(entry);
+                while ( ccEvalCacheOrder.size() > CC_EVAL_CACHE_SIZE )
+                {
+                    setCCEvalValid.erase(ccEvalCacheOrder.front());
+                    ccEvalCacheOrder.pop_front();
+                }
+            }
+        }
+        return true;
+    }
 
     std::string lvl = eval->state.IsInvalid() ? "Invalid" : "Error!";
     fprintf(stderr, "CC Eval %s %s: %s spending tx %s\n",
@@ -62,8 +152,7 @@ bool RunCCEval(const CC *cond, const CTransaction &tx, unsigned int nIn)
         // This is to remove a payments airdrop if it gets stuck in the mempool. 
         // Miner will mine 1 invalid block, but doesnt stop them mining until a restart.
         // This would almost never happen in normal use.
-        std::list<CTransaction> dummy;
-        mempool.remove(tx,dummy,true);
+        mempool.remove(tx,true);
     }
     return false;
 }
@@ -79,13 +168,15 @@ bool Eval::Dispatch(const CC *cond, const CTransaction &txTo, unsigned int nIn)
         return Invalid("empty-eval");
 
     uint8_t ecode = cond->code[0];
-    if ( ASSETCHAINS_CCDISABLES[ecode] != 0 )
+    if ( didCCdispatchinit == 0 ) // tools that skip komodo_args resolve lazily
+        CCDispatchInit();
+    if ( CC_EVAL_ENABLED[ecode] == 0 )
     {
-        // check if a height activation has been set. 
-        if ( mapHeightEvalActivate[ecode] == 0 || this->GetCurrentHeight() == 0 || mapHeightEvalActivate[ecode] > this->GetCurrentHeight() )
+        // check if a height activation has been set.
+        if ( CC_EVAL_ACTIVATES[ecode] == 0 || this->GetCurrentHeight() == 0 || CC_EVAL_ACTIVATES[ecode] > this->GetCurrentHeight() )
         {
             fprintf(stderr,"%s evalcode.%d %02x\n",txTo.GetHash().GetHex().c_str(),ecode,ecode);
-            fprintf(stderr, "ac_ccactivateht: evalcode.%i activates at height.%i vs current height.%i\n", ecode, mapHeightEvalActivate[ecode], this->GetCurrentHeight());
+            fprintf(stderr, "ac_ccactivateht: evalcode.%i activates at height.%i vs current height.%i\n", ecode, CC_EVAL_ACTIVATES[ecode], this->GetCurrentHeight());
             return Invalid("disabled-code, -ac_ccenables didnt include this ecode");
         }
     }
@@ -132,6 +132,17 @@ public:
 
 bool RunCCEval(const CC *cond, const CTransaction &tx, unsigned int nIn);
 
+/** Drop all cached CC eval results; called when a block disconnects */
+void CCEvalCacheClear();
+
+/** Per-evalcode enable flags and activation heights, dense for dispatch */
+extern uint8_t CC_EVAL_ENABLED[0x100];
+extern int32_t CC_EVAL_ACTIVATES[0x100];
+
+/** Resolve the dispatch tables from the chain's -ac_ccenable/-ac_ccactivateht
+ *  settings and pre-initialize the enabled contracts; called from komodo_args */
+void CCDispatchInit();
+
 
 /*
  * Virtual machine to use in the case of on-chain app evaluation
@@ -17,6 +17,9 @@
 #include "key_io.h"
 #include "komodo_bitcoind.h"
 
+#include <deque>
+#include <map>
+
 /*
  prevent duplicate bindtxid via mempool scan
  wait for notarization for oraclefeed and validation of gatewaysdeposit
@@ -413,7 +416,7 @@ bool GatewaysExactAmounts(struct CCcontract_info *cp,Eval* eval,const CTransacti
     else return(true);
 }
 
-int64_t GatewaysVerify(char *refdepositaddr,uint256 oracletxid,int32_t claimvout,std::string refcoin,uint256 cointxid,const std::string deposithex,std::vector<uint8_t>proof,uint256 merkleroot,CPubKey destpub,uint8_t taddr,uint8_t prefix,uint8_t prefix2)
+static int64_t GatewaysVerifyUncached(char *refdepositaddr,uint256 oracletxid,int32_t claimvout,std::string refcoin,uint256 cointxid,const std::string deposithex,std::vector<uint8_t>proof,uint256 merkleroot,CPubKey destpub,uint8_t taddr,uint8_t prefix,uint8_t prefix2)
 {
     std::vector<uint256> txids; uint256 proofroot,hashBlock,txid = zeroid; CTransaction tx; std::string name,description,format;
     char destaddr[64],destpubaddr[64],claimaddr[64]; int32_t i,numvouts; int64_t nValue = 0;
@@ -465,6 +468,46 @@ int64_t GatewaysVerify(char *refdepositaddr,uint256 oracletxid,int32_t claimvout
     return(0);
 }
 
+// a deposit claim is validated in the mempool, in block candidates and again on block connect,
+// and each run redid the full merkle proof and deposit tx decode. the verification is a pure
+// function of the claim parameters (the merkle branches for every txid in the proof are checked
+// in the single BitcoinGetProofMerkleRoot pass), so successful results are remembered keyed by
+// a hash of all inputs and repeat validations become a map lookup
+#define GATEWAYS_VERIFY_CACHE_SIZE 4096
+static CCriticalSection cs_gatewaysVerifyCache;
+static std::map<uint256,int64_t> mapGatewaysVerifyCache;
+static std::deque<uint256> gatewaysVerifyCacheOrder; // FIFO eviction
+
+int64_t GatewaysVerify(char *refdepositaddr,uint256 oracletxid,int32_t claimvout,std::string refcoin,uint256 cointxid,const std::string deposithex,std::vector<uint8_t>proof,uint256 merkleroot,CPubKey destpub,uint8_t taddr,uint8_t prefix,uint8_t prefix2)
+{
+    int64_t nValue;
+    CHashWriter ss(SER_GETHASH,0);
+    ss << oracletxid << claimvout << refcoin << cointxid << deposithex << proof << merkleroot << destpub;
+    ss.write(refdepositaddr,strlen(refdepositaddr));
+    ss << taddr << prefix << prefix2;
+    uint256 entry = ss.GetHash();
+    {
+        LOCK(cs_gatewaysVerifyCache);
+        std::map<uint256,int64_t>::iterator it = mapGatewaysVerifyCache.find(entry);
+        if ( it != mapGatewaysVerifyCache.end() )
+            return(it->second);
+    }
+    if ( (nValue= GatewaysVerifyUncached(refdepositaddr,oracletxid,claimvout,refcoin,cointxid,deposithex,proof,merkleroot,destpub,taddr,prefix,prefix2)) != 0 )
+    {
+        LOCK(cs_gatewaysVerifyCache);
+        if ( mapGatewaysVerifyCache.insert(std::make_pair(entry,nValue)).second )
+        {
+            gatewaysVerifyCacheOrder.push_back(entry);
+            while ( gatewaysVerifyCacheOrder.size() > GATEWAYS_VERIFY_CACHE_SIZE )
+            {
+                mapGatewaysVerifyCache.erase(gatewaysVerifyCacheOrder.front());
+                gatewaysVerifyCacheOrder.pop_front();
+            }
+        }
+    }
+    return(nValue);
+}
+
 int64_t GatewaysDepositval(CTransaction tx,CPubKey mypk)
 {
     int32_t numvouts,claimvout,height; int64_t amount; std::string coin,deposithex; std::vector<CPubKey> publishers; std::vector<uint256>txids; uint256 bindtxid,cointxid; std::vector<uint8_t> proof; CPubKey claimpubkey;
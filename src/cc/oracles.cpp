@@ -16,6 +16,7 @@
 #include "CCOracles.h"
 #include "komodo.h"
 #include "komodo_bitcoind.h"
+#include "../oraclesdb.h"
 
 #include <secp256k1.h>
 
@@ -1064,39 +1065,66 @@ UniValue OracleDataSample(uint256 reforacletxid,uint256 txid)
     return(result);
 }
 
-UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num)
+UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num,std::string cursor)
 {
-    UniValue result(UniValue::VOBJ),b(UniValue::VARR); CTransaction tx,oracletx; uint256 txid,hashBlock,btxid,oracletxid; 
-    CPubKey pk; std::string name,description,format; int32_t numvouts,n=0,vout; std::vector<uint8_t> data; char *formatstr = 0, addr[64];
+    UniValue result(UniValue::VOBJ),b(UniValue::VARR); CTransaction tx,oracletx; uint256 txid,hashBlock,btxid,oracletxid;
+    CPubKey pk; std::string name,description,format,nextcursor; int32_t numvouts,n=0,vout; std::vector<uint8_t> data; char *formatstr = 0, addr[64];
     std::vector<uint256> txids; int64_t nValue;
-    
+
+    if ( cursor.empty() == 0 && fOracleIndex == 0 )
+        CCERR_RESULT("oraclescc",CCLOG_INFO, stream << "cursor pagination requires -oracleindex");
     result.push_back(Pair("result","success"));
     if ( myGetTransaction(reforacletxid,oracletx,hashBlock) != 0 && (numvouts=oracletx.vout.size()) > 0 )
     {
         if ( DecodeOraclesCreateOpRet(oracletx.vout[numvouts-1].scriptPubKey,name,description,format) == 'C' )
         {
-            std::vector<CTransaction> tmp_txs;
-            myGet_mempool_txs(tmp_txs,EVAL_ORACLES,'D');
-            for (std::vector<CTransaction>::const_iterator it=tmp_txs.begin(); it!=tmp_txs.end(); it++)
+            if ( cursor.empty() != 0 )
+            {
+                // mempool samples are newer than anything confirmed; a cursor
+                // resumes inside the confirmed history, so skip them then
+                std::vector<CTransaction> tmp_txs;
+                myGet_mempool_txs(tmp_txs,EVAL_ORACLES,'D');
+                for (std::vector<CTransaction>::const_iterator it=tmp_txs.begin(); it!=tmp_txs.end(); it++)
+                {
+                    const CTransaction &txmempool = *it;
+                    const uint256 &hash = txmempool.GetHash();
+                    if ((numvouts=txmempool.vout.size())>0 && txmempool.vout[1].nValue==CC_MARKER_VALUE && DecodeOraclesData(txmempool.vout[numvouts-1].scriptPubKey,oracletxid,btxid,pk,data) == 'D' && reforacletxid == oracletxid )
+                    {
+                        Getscriptaddress(addr,txmempool.vout[1].scriptPubKey);
+                        if (strcmp(addr,batonaddr)!=0) continue;
+                        if ( (formatstr= (char *)format.c_str()) == 0 )
+                            formatstr = (char *)"";
+                        UniValue a(UniValue::VOBJ);
+                        a.push_back(Pair("txid",hash.GetHex()));
+                        a.push_back(Pair("data",OracleFormat((uint8_t *)data.data(),(int32_t)data.size(),formatstr,(int32_t)format.size())));
+                        b.push_back(a);
+                        if ( ++n >= num && num != 0)
+                        {
+                            result.push_back(Pair("samples",b));
+                            return(result);
+                        }
+                    }
+                }
+            }
+            if ( fOracleIndex != 0 )
             {
-                const CTransaction &txmempool = *it;
-                const uint256 &hash = txmempool.GetHash();
-                if ((numvouts=txmempool.vout.size())>0 && txmempool.vout[1].nValue==CC_MARKER_VALUE && DecodeOraclesData(txmempool.vout[numvouts-1].scriptPubKey,oracletxid,btxid,pk,data) == 'D' && reforacletxid == oracletxid )
+                // height-ordered index: read just the requested page instead of
+                // walking the baton address history
+                std::vector<std::pair<COracleDataKey, std::vector<uint8_t>>> samples;
+                ListOracleSamples(reforacletxid,batonaddr,num != 0 ? num - n : 0,cursor,samples,nextcursor);
+                for (std::vector<std::pair<COracleDataKey, std::vector<uint8_t>>>::const_iterator it=samples.begin(); it!=samples.end(); it++)
                 {
-                    Getscriptaddress(addr,txmempool.vout[1].scriptPubKey);
-                    if (strcmp(addr,batonaddr)!=0) continue;
                     if ( (formatstr= (char *)format.c_str()) == 0 )
                         formatstr = (char *)"";
                     UniValue a(UniValue::VOBJ);
-                    a.push_back(Pair("txid",hash.GetHex()));
-                    a.push_back(Pair("data",OracleFormat((uint8_t *)data.data(),(int32_t)data.size(),formatstr,(int32_t)format.size())));            
+                    a.push_back(Pair("txid",it->first.txhash.GetHex()));
+                    a.push_back(Pair("data",OracleFormat((uint8_t *)it->second.data(),(int32_t)it->second.size(),formatstr,(int32_t)format.size())));
                     b.push_back(a);
-                    if ( ++n >= num && num != 0)
-                    {
-                        result.push_back(Pair("samples",b));
-                        return(result);
-                    }
                 }
+                result.push_back(Pair("samples",b));
+                if ( nextcursor.empty() == 0 )
+                    result.push_back(Pair("cursor",nextcursor));
+                return(result);
             }
             SetCCtxids(txids,batonaddr,true,EVAL_ORACLES,reforacletxid,'D');
             if (txids.size()>0)
@@ -1133,6 +1161,28 @@ UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num)
     return(result);
 }
 
+UniValue OracleLatestSample(uint256 reforacletxid,char* batonaddr)
+{
+    UniValue result(UniValue::VOBJ); CTransaction oracletx; uint256 hashBlock;
+    std::string name,description,format; int32_t numvouts; char *formatstr = 0; COracleLatestValue latest;
+
+    if ( fOracleIndex == 0 )
+        CCERR_RESULT("oraclescc",CCLOG_INFO, stream << "oracleslatest requires -oracleindex");
+    if ( myGetTransaction(reforacletxid,oracletx,hashBlock) == 0 || (numvouts=oracletx.vout.size()) <= 0 )
+        CCERR_RESULT("oraclescc",CCLOG_INFO, stream << "cant find oracletxid " << reforacletxid.GetHex());
+    if ( DecodeOraclesCreateOpRet(oracletx.vout[numvouts-1].scriptPubKey,name,description,format) != 'C' )
+        CCERR_RESULT("oraclescc",CCLOG_INFO, stream << "invalid oracletxid " << reforacletxid.GetHex());
+    if ( GetOracleLatestData(reforacletxid,batonaddr,latest) == 0 )
+        CCERR_RESULT("oraclescc",CCLOG_INFO, stream << "no indexed samples for baton address " << batonaddr);
+    if ( (formatstr= (char *)format.c_str()) == 0 )
+        formatstr = (char *)"";
+    result.push_back(Pair("result","success"));
+    result.push_back(Pair("txid",latest.txhash.GetHex()));
+    result.push_back(Pair("height",(int64_t)latest.blockHeight));
+    result.push_back(Pair("data",OracleFormat((uint8_t *)latest.data.data(),(int32_t)latest.data.size(),formatstr,(int32_t)format.size())));
+    return(result);
+}
+
 UniValue OracleInfo(uint256 origtxid)
 {
     UniValue result(UniValue::VOBJ),a(UniValue::VARR);
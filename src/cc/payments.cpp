@@ -16,6 +16,9 @@
 #include "CCPayments.h"
 #include "komodo_bitcoind.h"
 
+#include <atomic>
+#include <thread>
+
 /* 
  0) txidopret <- allocation, scriptPubKey, opret
  1) create <-  locked_blocks, minrelease, list of txidopret
@@ -874,26 +877,54 @@ UniValue PaymentsRelease(struct CCcontract_info *cp,char *jsonstr)
                 newamount = amount;
                 int64_t totalamountsent = 0;
                 int64_t amtAmount = amount;
-                for (i=0; i<m; i++)
+                // evaluate the per-recipient splits on worker threads; the
+                // bignum math for multi-thousand recipient plans otherwise
+                // pins the RPC thread. The minimum/truncation pass below is
+                // order dependent and stays serial.
+                std::vector<int64_t> vSplits(m, 0);
+                std::atomic<int32_t> fOverflow(0);
+                int32_t nThreads = GetNumCores();
+                if ( nThreads < 1 || m < 256 )
+                    nThreads = 1;
+                else if ( nThreads > m )
+                    nThreads = m;
+                auto splitworker = [&](int32_t start, int32_t end)
                 {
-                    arith_uint256 auValue(0);
-                    if ( fFixedAmount )
-                        mtx.vout[i+1].nValue = amount / (top-bottom);
-                    else 
+                    for (int32_t k = start; k < end; k++)
                     {
-                        auValue = (mtx.vout[i+1].nValue * amtAmount) / amtTotalAllocations;
-                        if ( BnFitsCAmount(auValue) )
-                            mtx.vout[i+1].nValue = auValue.GetLow64();
+                        if ( fFixedAmount )
+                            vSplits[k] = amount / (top-bottom);
                         else
                         {
-                            result.push_back(Pair("result","error"));
-                            result.push_back(Pair("error","value too big, try releasing a smaller amount"));
-                            if ( params != 0 )
-                                free_json(params);
-                            return(result);
-                        } 
+                            arith_uint256 auValue = (mtx.vout[k+1].nValue * amtAmount) / amtTotalAllocations;
+                            if ( BnFitsCAmount(auValue) )
+                                vSplits[k] = auValue.GetLow64();
+                            else fOverflow = 1;
+                        }
                     }
-
+                };
+                if ( nThreads == 1 )
+                    splitworker(0, m);
+                else
+                {
+                    std::vector<std::thread> vWorkers;
+                    int32_t chunk = (m + nThreads - 1) / nThreads;
+                    for (i=0; i<nThreads; i++)
+                        vWorkers.push_back(std::thread(splitworker, i*chunk, std::min(m, (i+1)*chunk)));
+                    for (auto &worker : vWorkers)
+                        worker.join();
+                }
+                if ( fOverflow != 0 )
+                {
+                    result.push_back(Pair("result","error"));
+                    result.push_back(Pair("error","value too big, try releasing a smaller amount"));
+                    if ( params != 0 )
+                        free_json(params);
+                    return(result);
+                }
+                for (i=0; i<m; i++)
+                {
+                    mtx.vout[i+1].nValue = vSplits[i];
                     //LogPrintf( "[%i] nValue.%li minimum.%i scriptpubkey.%s\n", i, mtx.vout[i+1].nValue, minimum, HexStr(mtx.vout[i+1].scriptPubKey.begin(),mtx.vout[i+1].scriptPubKey.end()).c_str());
                     if ( mtx.vout[i+1].nValue < minimum )
                     {
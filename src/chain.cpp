@@ -147,8 +147,31 @@ CBlockIndex* CBlockIndex::GetAncestor(int height)
     if (height > nHeight || height < 0)
         return NULL;
 
+    // Fast path: when this entry is on the active chain (checked in O(1)
+    // against vChain), the ancestor is a bounds-checked array index instead
+    // of a skiplist walk through cold index entries.
+    if (chainActive[nHeight] == this)
+    {
+        CBlockIndex *pindex = chainActive[height];
+        if (pindex != NULL)
+            return pindex;
+    }
+
+    // Off-chain bases (notarization checks against forks, header trees during
+    // sync) tend to issue bursts of queries at decreasing heights for the
+    // same base. Resume from the previous answer in that case: an ancestor of
+    // the last result is an ancestor of the base. Block index entries are
+    // never freed while the node runs, so the cached pointers stay valid.
+    thread_local const CBlockIndex* pindexLastBase = NULL;
+    thread_local CBlockIndex* pindexLastAncestor = NULL;
+
     CBlockIndex* pindexWalk = this;
     int heightWalk = nHeight;
+    if (pindexLastBase == this && pindexLastAncestor != NULL && pindexLastAncestor->nHeight >= height)
+    {
+        pindexWalk = pindexLastAncestor;
+        heightWalk = pindexWalk->nHeight;
+    }
     while ( heightWalk > height && pindexWalk != 0 )
     {
         int heightSkip = GetSkipHeight(heightWalk);
@@ -166,6 +189,8 @@ CBlockIndex* CBlockIndex::GetAncestor(int height)
             heightWalk--;
         }
     }
+    pindexLastBase = this;
+    pindexLastAncestor = pindexWalk;
     return pindexWalk;
 }
 
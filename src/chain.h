@@ -159,15 +159,11 @@ public:
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
-    int64_t newcoins,zfunds,sproutfunds,nNotaryPay; int8_t segid; // jl777 fields
-    //! Which # file this block is stored in (blk?????.dat)
-    int nFile;
-
-    //! Byte offset within blk?????.dat where this block's data is stored
-    unsigned int nDataPos;
-
-    //! Byte offset within rev?????.dat where this block's undo data is stored
-    unsigned int nUndoPos;
+    //! Verification status of this block. See enum BlockStatus
+    //! Kept next to nHeight and nChainWork so the fields every chain
+    //! traversal touches (pprev/pskip/nHeight/nStatus/nChainWork) share the
+    //! first cache line of the entry; everything below is colder.
+    unsigned int nStatus;
 
     //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
     arith_uint256 nChainWork;
@@ -181,8 +177,25 @@ public:
     //! Change to 64-bit type when necessary; won't happen before 2030
     unsigned int nChainTx;
 
-    //! Verification status of this block. See enum BlockStatus
-    unsigned int nStatus;
+    //! Which # file this block is stored in (blk?????.dat)
+    int nFile;
+
+    //! Byte offset within blk?????.dat where this block's data is stored
+    unsigned int nDataPos;
+
+    //! Byte offset within rev?????.dat where this block's undo data is stored
+    unsigned int nUndoPos;
+
+    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
+    uint32_t nSequenceId;
+
+    int8_t segid; // jl777 field, packed here so it does not pad out the 8-byte fields below
+    int64_t newcoins,zfunds,sproutfunds,nNotaryPay; // jl777 fields
+
+    //! (memory only) Memoized GetMedianTimePast() result, 0 until computed.
+    //! Header times are immutable once the entry is linked, so the median
+    //! over the trailing window never changes for a given block.
+    mutable int64_t nCachedMedianTimePast;
 
     //! Branch ID corresponding to the consensus rules used to validate this block.
     //! Only cached if block validity is BLOCK_VALID_CONSENSUS.
@@ -266,15 +279,13 @@ protected:
     std::vector<unsigned char> nSolution;
 
 public:
-    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
-    uint32_t nSequenceId;
-    
     void SetNull()
     {
         phashBlock = NULL;
         newcoins = zfunds = 0;
         segid = -2;
         nNotaryPay = 0;
+        nCachedMedianTimePast = 0;
         pprev = NULL;
         pskip = NULL;
         nHeight = 0;
@@ -373,6 +384,12 @@ public:
      */
     int64_t GetMedianTimePast() const
     {
+        // Tip-window walks (validation, dpowconfs, locktime checks) ask for
+        // the same medians over and over; serve repeats from the memo instead
+        // of chasing pprev through eleven scattered index entries each time.
+        if (nCachedMedianTimePast != 0)
+            return nCachedMedianTimePast;
+
         int64_t pmedian[nMedianTimeSpan];
         int64_t* pbegin = &pmedian[nMedianTimeSpan];
         int64_t* pend = &pmedian[nMedianTimeSpan];
@@ -383,7 +400,8 @@ public:
             *(--pbegin) = pindex->GetBlockTime();
 
         std::sort(pbegin, pend);
-        return pbegin[(pend - pbegin)/2];
+        nCachedMedianTimePast = pbegin[(pend - pbegin)/2];
+        return nCachedMedianTimePast;
     }
 
     std::string ToString() const
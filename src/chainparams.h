@@ -181,6 +181,11 @@ public:
     const std::vector<SeedSpec6>& FixedSeeds() const { return vFixedSeeds; }
     const std::vector<std::pair<std::string, std::string> > GenesisNotaries() const { return genesisNotaries; }
     const CCheckpointData& Checkpoints() const { return checkpointData; }
+    /****
+     * @returns the published content hash of a trusted chainstate snapshot
+     *          for -loadsnapshot (null when none has been published)
+     */
+    const uint256& ChainstateSnapshotHash() const { return hashChainstateSnapshot; }
     /** 
      * @returns the founder's reward address for a given block height 
      */
@@ -250,6 +255,7 @@ protected:
     bool fMineBlocksOnDemand = false;
     bool fTestnetToBeDeprecatedFieldRPC = false;
     CCheckpointData checkpointData;
+    uint256 hashChainstateSnapshot; // content hash of a published chainstate snapshot, if any
     std::vector<std::string> vFoundersRewardAddress;
     mutable uint32_t coinbaseMaturity = 100; // allow to modify by -ac_cbmaturity
     std::vector< std::pair<std::string, std::string> > genesisNotaries;
@@ -21,6 +21,7 @@
 #define BITCOIN_CHECKQUEUE_H
 
 #include <algorithm>
+#include <atomic>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -31,7 +32,7 @@
 template <typename T>
 class CCheckQueueControl;
 
-/** 
+/**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
   * operator(), returning a bool.
@@ -40,12 +41,37 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Work is distributed through a bounded lock-free MPMC ring (per-slot
+  * sequence numbers, Vyukov style), so workers claim checks with a pair of
+  * atomic operations instead of serializing on a mutex. The mutex and the
+  * condition variables below are only used to park idle workers and to wake
+  * the master; they are never held while work is handed out.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! A single ring slot. The sequence number encodes whether the slot is
+    //! free to produce into or holds an element ready to consume.
+    struct CQueueSlot {
+        std::atomic<size_t> nSequence;
+        T data;
+    };
+
+    //! The lock-free ring holding queued elements. Size is a power of two.
+    std::vector<CQueueSlot> vRing;
+
+    //! Mask for mapping positions onto ring slots (ring size - 1)
+    size_t nRingMask;
+
+    //! Next position a producer will write to
+    std::atomic<size_t> nEnqueuePos;
+
+    //! Next position a consumer will read from
+    std::atomic<size_t> nDequeuePos;
+
+    //! Mutex used only to park idle workers / the waiting master
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -54,99 +80,136 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
-
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
-
-    //! The total number of workers (including the master).
-    int nTotal;
-
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk;
 
     /**
      * Number of verifications that haven't completed yet.
-     * This includes elements that are no longer queued, but still in the
-     * worker's own batches.
+     * This includes elements that are no longer queued, but still being
+     * executed by a worker.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo;
 
     //! Whether we're shutting down.
-    bool fQuit;
+    std::atomic<bool> fQuit;
 
-    //! The maximum number of elements to be processed in one batch
+    //! The maximum number of elements a worker claims before re-checking state
     unsigned int nBatchSize;
 
+    //! Try to push one element into the ring without blocking.
+    //! Returns false when the ring is momentarily full.
+    bool TryEnqueue(T& check)
+    {
+        size_t pos = nEnqueuePos.load(std::memory_order_relaxed);
+        do {
+            CQueueSlot& slot = vRing[pos & nRingMask];
+            size_t seq = slot.nSequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (nEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.data.swap(check);
+                    slot.nSequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = nEnqueuePos.load(std::memory_order_relaxed);
+            }
+        } while (true);
+    }
+
+    //! Try to pop one element from the ring without blocking.
+    bool TryDequeue(T& check)
+    {
+        size_t pos = nDequeuePos.load(std::memory_order_relaxed);
+        do {
+            CQueueSlot& slot = vRing[pos & nRingMask];
+            size_t seq = slot.nSequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (nDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    check.swap(slot.data);
+                    slot.data = T();
+                    slot.nSequence.store(pos + nRingMask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = nDequeuePos.load(std::memory_order_relaxed);
+            }
+        } while (true);
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
-        std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
+        T check;
         do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if ((fMaster || fQuit) && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
+            unsigned int nDone = 0;
+            // Drain up to nBatchSize elements before looking at global state
+            // again, so a burst of completions is folded into one nTodo update.
+            while (nDone < nBatchSize && TryDequeue(check)) {
+                if (fAllOk.load(std::memory_order_relaxed) && !check())
+                    fAllOk.store(false, std::memory_order_relaxed);
+                check = T();
+                nDone++;
+            }
+            if (nDone) {
+                if (nTodo.fetch_sub(nDone, std::memory_order_acq_rel) == nDone) {
+                    // We processed the last element; inform the master it can
+                    // exit and return the result
+                    boost::unique_lock<boost::mutex> lock(mutex);
+                    condMaster.notify_one();
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
+                continue;
+            }
+            // Out of work: decide whether to exit or to park.
+            if (nTodo.load(std::memory_order_acquire) == 0) {
+                if (fMaster) {
+                    bool fRet = fAllOk.load(std::memory_order_relaxed);
+                    // reset the status for new work later
+                    fAllOk.store(true, std::memory_order_relaxed);
+                    return fRet;
                 }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                if (fQuit.load(std::memory_order_relaxed))
+                    return fAllOk.load(std::memory_order_relaxed);
+            }
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+                // Re-check under the mutex: Add() notifies while holding it,
+                // so an element enqueued after our drain cannot be missed.
+                if (Empty() && !fQuit.load(std::memory_order_relaxed) &&
+                    !(fMaster && nTodo.load(std::memory_order_acquire) == 0))
+                    cond.wait(lock);
             }
-            // execute work
-            BOOST_FOREACH (T& check, vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
         } while (true);
     }
 
+    //! Whether the ring looks empty (approximate, used only for parking)
+    bool Empty() const
+    {
+        return nDequeuePos.load(std::memory_order_acquire) >=
+               nEnqueuePos.load(std::memory_order_acquire);
+    }
+
 public:
     //! Mutex to ensure only one concurrent CCheckQueueControl
     boost::mutex ControlMutex;
 
-    //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    //! Create a new check queue. nRingSizeIn must be a power of two and large
+    //! enough to hold the checks of a worst-case block; producers help drain
+    //! the ring if it ever fills up, so this is not a correctness limit.
+    CCheckQueue(unsigned int nBatchSizeIn, size_t nRingSizeIn = 0x10000) :
+        vRing(nRingSizeIn), nRingMask(nRingSizeIn - 1), nEnqueuePos(0), nDequeuePos(0),
+        fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn)
+    {
+        assert((nRingSizeIn & (nRingSizeIn - 1)) == 0);
+        for (size_t i = 0; i < nRingSizeIn; i++)
+            vRing[i].nSequence.store(i, std::memory_order_relaxed);
+    }
 
     //! Worker thread
     void Thread()
@@ -163,15 +226,29 @@ public:
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
+        if (vChecks.empty())
+            return;
+        nTodo.fetch_add(vChecks.size(), std::memory_order_release);
         BOOST_FOREACH (T& check, vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+            while (!TryEnqueue(check)) {
+                // Ring is full: execute one check inline instead of spinning,
+                // which guarantees forward progress for the producer.
+                T own;
+                if (TryDequeue(own)) {
+                    if (fAllOk.load(std::memory_order_relaxed) && !own())
+                        fAllOk.store(false, std::memory_order_relaxed);
+                    nTodo.fetch_sub(1, std::memory_order_acq_rel);
+                }
+            }
+        }
+        {
+            // Taking the mutex pairs with the re-check in Loop() and prevents
+            // a worker from sleeping through this wakeup.
+            boost::unique_lock<boost::mutex> lock(mutex);
         }
-        nTodo += vChecks.size();
         if (vChecks.size() == 1)
             condWorker.notify_one();
-        else if (vChecks.size() > 1)
+        else
             condWorker.notify_all();
     }
 
@@ -181,7 +258,7 @@ public:
 
 };
 
-/** 
+/**
  * RAII-style controller object for a CCheckQueue that guarantees the passed
  * queue is finished before continuing.
  */
@@ -21,6 +21,8 @@
 
 #include "memusage.h"
 #include "random.h"
+
+#include <limits>
 #include "version.h"
 #include "policy/fees.h"
 #include "komodo_defs.h"
@@ -64,6 +66,11 @@ bool CCoins::Spend(uint32_t nPos)
 }
 bool CCoinsView::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const { return false; }
 bool CCoinsView::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const { return false; }
+bool CCoinsView::HaveSaplingAnchorAt(const uint256 &rt) const
+{
+    SaplingMerkleTree tree;
+    return GetSaplingAnchorAt(rt, tree);
+}
 bool CCoinsView::GetNullifier(const uint256 &nullifier, ShieldedType type) const { return false; }
 bool CCoinsView::GetCoins(const uint256 &txid, CCoins &coins) const { return false; }
 bool CCoinsView::HaveCoins(const uint256 &txid) const { return false; }
@@ -78,12 +85,14 @@ bool CCoinsView::BatchWrite(CCoinsMap &mapCoins,
                             CNullifiersMap &mapSproutNullifiers,
                             CNullifiersMap &mapSaplingNullifiers) { return false; }
 bool CCoinsView::GetStats(CCoinsStats &stats) const { return false; }
+bool CCoinsView::WriteSnapshot(CAutoFile &fileout, CHashWriter &hasher, uint64_t &nRecords) const { return false; }
 
 
 CCoinsViewBacked::CCoinsViewBacked(CCoinsView *viewIn) : base(viewIn) { }
 
 bool CCoinsViewBacked::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const { return base->GetSproutAnchorAt(rt, tree); }
 bool CCoinsViewBacked::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const { return base->GetSaplingAnchorAt(rt, tree); }
+bool CCoinsViewBacked::HaveSaplingAnchorAt(const uint256 &rt) const { return base->HaveSaplingAnchorAt(rt); }
 bool CCoinsViewBacked::GetNullifier(const uint256 &nullifier, ShieldedType type) const { return base->GetNullifier(nullifier, type); }
 bool CCoinsViewBacked::GetCoins(const uint256 &txid, CCoins &coins) const { return base->GetCoins(txid, coins); }
 bool CCoinsViewBacked::HaveCoins(const uint256 &txid) const { return base->HaveCoins(txid); }
@@ -99,8 +108,9 @@ bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins,
                                   CNullifiersMap &mapSproutNullifiers,
                                   CNullifiersMap &mapSaplingNullifiers) { return base->BatchWrite(mapCoins, hashBlock, hashSproutAnchor, hashSaplingAnchor, mapSproutAnchors, mapSaplingAnchors, mapSproutNullifiers, mapSaplingNullifiers); }
 bool CCoinsViewBacked::GetStats(CCoinsStats &stats) const { return base->GetStats(stats); }
+bool CCoinsViewBacked::WriteSnapshot(CAutoFile &fileout, CHashWriter &hasher, uint64_t &nRecords) const { return base->WriteSnapshot(fileout, hasher, nRecords); }
 
-CCoinsKeyHasher::CCoinsKeyHasher() : salt(GetRandHash()) {}
+CCoinsKeyHasher::CCoinsKeyHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
 CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), hasModifier(false), cachedCoinsUsage(0) { }
 
@@ -183,6 +193,16 @@ bool CCoinsViewCache::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &t
     return true;
 }
 
+bool CCoinsViewCache::HaveSaplingAnchorAt(const uint256 &rt) const {
+    CAnchorsSaplingMap::const_iterator it = cacheSaplingAnchors.find(rt);
+    if (it != cacheSaplingAnchors.end()) {
+        return it->second.entered;
+    }
+    // Deliberately does not pull the tree into this cache: membership checks
+    // for shielded spends would fill it with trees nothing ever appends to.
+    return base->HaveSaplingAnchorAt(rt);
+}
+
 bool CCoinsViewCache::GetNullifier(const uint256 &nullifier, ShieldedType type) const {
     CNullifiersMap* cacheToUse;
     switch (type) {
@@ -546,6 +566,63 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins,
     return true;
 }
 
+bool CCoinsViewCache::Sync() {
+    assert(!hasModifier);
+    // Collect copies of the dirty subset; the originals stay in place so the
+    // cache remains warm for subsequent lookups.
+    CCoinsMap mapDirty;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            CCoinsCacheEntry& entry = mapDirty[it->first];
+            entry.coins = it->second.coins;
+            entry.flags = it->second.flags;
+        }
+    }
+    CAnchorsSproutMap mapDirtySproutAnchors;
+    for (CAnchorsSproutMap::iterator it = cacheSproutAnchors.begin(); it != cacheSproutAnchors.end(); it++)
+        if (it->second.flags & CAnchorsSproutCacheEntry::DIRTY)
+            mapDirtySproutAnchors[it->first] = it->second;
+    CAnchorsSaplingMap mapDirtySaplingAnchors;
+    for (CAnchorsSaplingMap::iterator it = cacheSaplingAnchors.begin(); it != cacheSaplingAnchors.end(); it++)
+        if (it->second.flags & CAnchorsSaplingCacheEntry::DIRTY)
+            mapDirtySaplingAnchors[it->first] = it->second;
+    CNullifiersMap mapDirtySproutNullifiers;
+    for (CNullifiersMap::iterator it = cacheSproutNullifiers.begin(); it != cacheSproutNullifiers.end(); it++)
+        if (it->second.flags & CNullifiersCacheEntry::DIRTY)
+            mapDirtySproutNullifiers[it->first] = it->second;
+    CNullifiersMap mapDirtySaplingNullifiers;
+    for (CNullifiersMap::iterator it = cacheSaplingNullifiers.begin(); it != cacheSaplingNullifiers.end(); it++)
+        if (it->second.flags & CNullifiersCacheEntry::DIRTY)
+            mapDirtySaplingNullifiers[it->first] = it->second;
+
+    if (!base->BatchWrite(mapDirty, hashBlock, hashSproutAnchor, hashSaplingAnchor, mapDirtySproutAnchors, mapDirtySaplingAnchors, mapDirtySproutNullifiers, mapDirtySaplingNullifiers))
+        return false;
+
+    // Everything dirty is now in the base: clear DIRTY (and FRESH, since the
+    // parent has the entry from here on) and drop spent coins entirely.
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end();) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            if (it->second.coins.IsPruned()) {
+                cachedCoinsUsage -= it->second.coins.DynamicMemoryUsage();
+                CCoinsMap::iterator itOld = it++;
+                cacheCoins.erase(itOld);
+                continue;
+            }
+            it->second.flags = 0;
+        }
+        it++;
+    }
+    for (CAnchorsSproutMap::iterator it = cacheSproutAnchors.begin(); it != cacheSproutAnchors.end(); it++)
+        it->second.flags &= ~CAnchorsSproutCacheEntry::DIRTY;
+    for (CAnchorsSaplingMap::iterator it = cacheSaplingAnchors.begin(); it != cacheSaplingAnchors.end(); it++)
+        it->second.flags &= ~CAnchorsSaplingCacheEntry::DIRTY;
+    for (CNullifiersMap::iterator it = cacheSproutNullifiers.begin(); it != cacheSproutNullifiers.end(); it++)
+        it->second.flags &= ~CNullifiersCacheEntry::DIRTY;
+    for (CNullifiersMap::iterator it = cacheSaplingNullifiers.begin(); it != cacheSaplingNullifiers.end(); it++)
+        it->second.flags &= ~CNullifiersCacheEntry::DIRTY;
+    return true;
+}
+
 bool CCoinsViewCache::Flush() {
     bool fOk = base->BatchWrite(cacheCoins, hashBlock, hashSproutAnchor, hashSaplingAnchor, cacheSproutAnchors, cacheSaplingAnchors, cacheSproutNullifiers, cacheSaplingNullifiers);
     cacheCoins.clear();
@@ -603,26 +680,23 @@ CAmount CCoinsViewCache::GetTransparentValueIn(int32_t nHeight,int64_t &interest
         return GetCoinImportValue(tx);
     if ( tx.IsCoinBase() != 0 )
         return 0;
+    std::vector<uint64_t> vValues;
+    vValues.reserve(tx.vin.size());
     for (unsigned int i = 0; i < tx.vin.size(); i++)
     {
         value = GetOutputFor(tx.vin[i]).nValue;
         nResult += value;
+        vValues.push_back(value);
+    }
 #ifdef KOMODO_ENABLE_INTEREST
-        if ( chainName.isKMD() && nHeight >= 60000 )
-        {
-            if ( value >= 10*COIN )
-            {
-                int64_t interest; 
-                int32_t txheight; 
-                uint32_t locktime;
-                interest = komodo_accrued_interest(&txheight,&locktime,tx.vin[i].prevout.hash,
-                        tx.vin[i].prevout.n,0,value,nHeight);
-                nResult += interest;
-                interestp += interest;
-            }
-        }
-#endif
+    if ( chainName.isKMD() && nHeight >= 60000 )
+    {
+        std::vector<uint64_t> vInterest;
+        uint64_t interest = komodo_interest_batch(vInterest,tx,nHeight,vValues);
+        nResult += interest;
+        interestp += interest;
     }
+#endif
 
     return nResult;
 }
@@ -663,8 +737,9 @@ bool CCoinsViewCache::HaveJoinSplitRequirements(const CTransaction& tx) const
         if (GetNullifier(spendDescription.nullifier, SAPLING)) // Prevent double spends
             return false;
 
-        SaplingMerkleTree tree;
-        if (!GetSaplingAnchorAt(spendDescription.anchor, tree)) {
+        // Only membership matters here; the tree itself is never used, so
+        // skip deserializing it from the backing view.
+        if (!HaveSaplingAnchorAt(spendDescription.anchor)) {
             return false;
         }
     }
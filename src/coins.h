@@ -25,6 +25,7 @@
 
 #include "compressor.h"
 #include "core_memusage.h"
+#include "crypto/siphash.h"
 #include "memusage.h"
 #include "serialize.h"
 #include "uint256.h"
@@ -276,7 +277,7 @@ public:
 class CCoinsKeyHasher
 {
 private:
-    uint256 salt;
+    uint64_t k0, k1;
 
 public:
     CCoinsKeyHasher();
@@ -287,7 +288,7 @@ public:
      * uint64_t, resulting in failures when syncing the chain (#4634).
      */
     size_t operator()(const uint256& key) const {
-        return key.GetHash(salt);
+        return SipHashUint256(k0, k1, key);
     }
 };
 
@@ -353,6 +354,9 @@ typedef boost::unordered_map<uint256, CAnchorsSproutCacheEntry, CCoinsKeyHasher>
 typedef boost::unordered_map<uint256, CAnchorsSaplingCacheEntry, CCoinsKeyHasher> CAnchorsSaplingMap;
 typedef boost::unordered_map<uint256, CNullifiersCacheEntry, CCoinsKeyHasher> CNullifiersMap;
 
+class CAutoFile;
+class CHashWriter;
+
 struct CCoinsStats
 {
     int nHeight;
@@ -377,6 +381,10 @@ public:
     //! Retrieve the tree (Sapling) at a particular anchored root in the chain
     virtual bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
 
+    //! Membership-only variant for spend validation, which checks an anchor
+    //! exists but never uses the tree itself
+    virtual bool HaveSaplingAnchorAt(const uint256 &rt) const;
+
     //! Determine whether a nullifier is spent or not
     virtual bool GetNullifier(const uint256 &nullifier, ShieldedType type) const;
 
@@ -407,6 +415,10 @@ public:
     //! Calculate statistics about the unspent transaction output set
     virtual bool GetStats(CCoinsStats &stats) const;
 
+    //! Stream every raw chainstate record into a snapshot file, feeding the
+    //! same bytes to the hasher; only the database-backed view implements this
+    virtual bool WriteSnapshot(CAutoFile &fileout, CHashWriter &hasher, uint64_t &nRecords) const;
+
     //! As we use CCoinsViews polymorphically, have a virtual destructor
     virtual ~CCoinsView() {}
 };
@@ -422,12 +434,16 @@ public:
     CCoinsViewBacked(CCoinsView *viewIn);
     bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
+    bool HaveSaplingAnchorAt(const uint256 &rt) const;
     bool GetNullifier(const uint256 &nullifier, ShieldedType type) const;
     bool GetCoins(const uint256 &txid, CCoins &coins) const;
     bool HaveCoins(const uint256 &txid) const;
     uint256 GetBestBlock() const;
     uint256 GetBestAnchor(ShieldedType type) const;
     void SetBackend(CCoinsView &viewIn);
+    //! Access the backing view, e.g. for read-only prefetching that must not
+    //! mutate this cache.
+    CCoinsView *GetBackend() const { return base; }
     bool BatchWrite(CCoinsMap &mapCoins,
                     const uint256 &hashBlock,
                     const uint256 &hashSproutAnchor,
@@ -437,6 +453,7 @@ public:
                     CNullifiersMap &mapSproutNullifiers,
                     CNullifiersMap &mapSaplingNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+    bool WriteSnapshot(CAutoFile &fileout, CHashWriter &hasher, uint64_t &nRecords) const;
 };
 
 
@@ -499,9 +516,14 @@ public:
     CCoinsViewCache(CCoinsView *baseIn);
     ~CCoinsViewCache();
 
+    //! Pre-size the coin map's bucket array for the expected number of
+    //! entries, so a cache warmed during sync never pauses to rehash.
+    void ReserveCoins(size_t nEntries) { cacheCoins.reserve(nEntries); }
+
     // Standard CCoinsView methods
     bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
+    bool HaveSaplingAnchorAt(const uint256 &rt) const;
     bool GetNullifier(const uint256 &nullifier, ShieldedType type) const;
     bool GetCoins(const uint256 &txid, CCoins &coins) const;
     bool HaveCoins(const uint256 &txid) const;
@@ -550,6 +572,16 @@ public:
      */
     bool Flush();
 
+    /**
+     * Push the modifications applied to this cache to its base while keeping
+     * the cache itself intact and warm. Only dirty entries are written; their
+     * DIRTY/FRESH flags are cleared afterwards (spent entries are dropped).
+     * Used for incremental flushes, which bound the amount of unwritten state
+     * without paying the post-flush cache-miss storm of a full Flush().
+     * If false is returned, the state of the backing view is undefined.
+     */
+    bool Sync();
+
     //! Calculate the size of the cache (in number of transactions)
     unsigned int GetCacheSize() const;
 
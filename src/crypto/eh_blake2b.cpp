@@ -0,0 +1,291 @@
+// Copyright (c) 2016-2019 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/eh_blake2b.h"
+
+#include "crypto/common.h"
+
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(__GNUC__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define EH_BLAKE2B_HAVE_AVX2_PATH 1
+#endif
+
+namespace eh_blake2b
+{
+
+namespace
+{
+
+const uint64_t blake2b_IV[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+    0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+const uint8_t blake2b_sigma[12][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+uint64_t inline rotr64(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+#define EH_B2B_G(r, i, a, b, c, d)                           \
+    do {                                                     \
+        a = a + b + m[blake2b_sigma[r][2 * i + 0]];          \
+        d = rotr64(d ^ a, 32);                               \
+        c = c + d;                                           \
+        b = rotr64(b ^ c, 24);                               \
+        a = a + b + m[blake2b_sigma[r][2 * i + 1]];          \
+        d = rotr64(d ^ a, 16);                               \
+        c = c + d;                                           \
+        b = rotr64(b ^ c, 63);                               \
+    } while (0)
+
+/** Scalar BLAKE2b compression of one 128-byte block. */
+void Compress(uint64_t h[8], const unsigned char block[128], uint64_t t, bool fLast)
+{
+    uint64_t m[16];
+    uint64_t v[16];
+    for (int i = 0; i < 16; i++)
+        m[i] = ReadLE64(block + 8 * i);
+    for (int i = 0; i < 8; i++) {
+        v[i] = h[i];
+        v[i + 8] = blake2b_IV[i];
+    }
+    v[12] ^= t;
+    // v[13] ^= high word of t: inputs here are far below 2^64 bytes.
+    if (fLast)
+        v[14] = ~v[14];
+    for (int r = 0; r < 12; r++) {
+        EH_B2B_G(r, 0, v[0], v[4], v[8], v[12]);
+        EH_B2B_G(r, 1, v[1], v[5], v[9], v[13]);
+        EH_B2B_G(r, 2, v[2], v[6], v[10], v[14]);
+        EH_B2B_G(r, 3, v[3], v[7], v[11], v[15]);
+        EH_B2B_G(r, 4, v[0], v[5], v[10], v[15]);
+        EH_B2B_G(r, 5, v[1], v[6], v[11], v[12]);
+        EH_B2B_G(r, 6, v[2], v[7], v[8], v[13]);
+        EH_B2B_G(r, 7, v[3], v[4], v[9], v[14]);
+    }
+    for (int i = 0; i < 8; i++)
+        h[i] ^= v[i] ^ v[i + 8];
+}
+
+/** Finalize one index the portable way. */
+void Hash1(const MidState& mid, uint32_t g, unsigned char* out)
+{
+    uint64_t h[8];
+    memcpy(h, mid.h, sizeof(h));
+    unsigned char block[128];
+    memset(block, 0, sizeof(block));
+    memcpy(block, mid.buf, mid.buflen);
+    WriteLE32(block + mid.buflen, g);
+    size_t nFinal = mid.buflen + 4;
+    if (nFinal > 128) {
+        // The index straddles a block boundary; compress the full buffer
+        // first, then the spilled remainder as the final block. (Cannot
+        // happen for standard block headers, but keep the generic case
+        // correct.)
+        unsigned char full[132];
+        memset(full, 0, sizeof(full));
+        memcpy(full, mid.buf, mid.buflen);
+        WriteLE32(full + mid.buflen, g);
+        Compress(h, full, mid.t + 128, false);
+        memset(block, 0, sizeof(block));
+        memcpy(block, full + 128, nFinal - 128);
+        Compress(h, block, mid.t + nFinal, true);
+    } else {
+        Compress(h, block, mid.t + nFinal, true);
+    }
+    unsigned char digest[64];
+    for (int i = 0; i < 8; i++)
+        WriteLE64(digest + 8 * i, h[i]);
+    memcpy(out, digest, mid.hLen);
+}
+
+#ifdef EH_BLAKE2B_HAVE_AVX2_PATH
+
+__attribute__((target("avx2")))
+inline __m256i Rotr64x4(__m256i x, int n)
+{
+    return _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - n));
+}
+
+#define EH_B2B_G4(r, i, a, b, c, d)                                             \
+    do {                                                                        \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), m[blake2b_sigma[r][2 * i + 0]]); \
+        d = Rotr64x4(_mm256_xor_si256(d, a), 32);                               \
+        c = _mm256_add_epi64(c, d);                                             \
+        b = Rotr64x4(_mm256_xor_si256(b, c), 24);                               \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), m[blake2b_sigma[r][2 * i + 1]]); \
+        d = Rotr64x4(_mm256_xor_si256(d, a), 16);                               \
+        c = _mm256_add_epi64(c, d);                                             \
+        b = Rotr64x4(_mm256_xor_si256(b, c), 63);                               \
+    } while (0)
+
+/** Finalize four indices at once, one per 64-bit lane. Requires the final
+ *  block (buffered bytes plus the 4-byte index) to fit in 128 bytes. */
+__attribute__((target("avx2")))
+void Hash4(const MidState& mid, const uint32_t g[4], unsigned char* out, size_t outStride)
+{
+    // Build the four final blocks; they differ only in the 4 index bytes,
+    // but assembling them per-lane keeps the message load trivially correct.
+    unsigned char blocks[4][128];
+    for (int lane = 0; lane < 4; lane++) {
+        memset(blocks[lane], 0, 128);
+        memcpy(blocks[lane], mid.buf, mid.buflen);
+        WriteLE32(blocks[lane] + mid.buflen, g[lane]);
+    }
+    __m256i m[16];
+    for (int i = 0; i < 16; i++)
+        m[i] = _mm256_set_epi64x(
+            (long long)ReadLE64(blocks[3] + 8 * i), (long long)ReadLE64(blocks[2] + 8 * i),
+            (long long)ReadLE64(blocks[1] + 8 * i), (long long)ReadLE64(blocks[0] + 8 * i));
+
+    __m256i v[16];
+    for (int i = 0; i < 8; i++) {
+        v[i] = _mm256_set1_epi64x((long long)mid.h[i]);
+        v[i + 8] = _mm256_set1_epi64x((long long)blake2b_IV[i]);
+    }
+    uint64_t t = mid.t + mid.buflen + 4;
+    v[12] = _mm256_xor_si256(v[12], _mm256_set1_epi64x((long long)t));
+    v[14] = _mm256_xor_si256(v[14], _mm256_set1_epi64x(-1LL)); // last block
+
+    for (int r = 0; r < 12; r++) {
+        EH_B2B_G4(r, 0, v[0], v[4], v[8], v[12]);
+        EH_B2B_G4(r, 1, v[1], v[5], v[9], v[13]);
+        EH_B2B_G4(r, 2, v[2], v[6], v[10], v[14]);
+        EH_B2B_G4(r, 3, v[3], v[7], v[11], v[15]);
+        EH_B2B_G4(r, 4, v[0], v[5], v[10], v[15]);
+        EH_B2B_G4(r, 5, v[1], v[6], v[11], v[12]);
+        EH_B2B_G4(r, 6, v[2], v[7], v[8], v[13]);
+        EH_B2B_G4(r, 7, v[3], v[4], v[9], v[14]);
+    }
+
+    uint64_t lanes[4];
+    unsigned char digest[64];
+    for (int lane = 0; lane < 4; lane++) {
+        for (int i = 0; i < 8; i++) {
+            __m256i hv = _mm256_xor_si256(_mm256_set1_epi64x((long long)mid.h[i]),
+                                          _mm256_xor_si256(v[i], v[i + 8]));
+            _mm256_storeu_si256((__m256i*)lanes, hv);
+            WriteLE64(digest + 8 * i, lanes[lane]);
+        }
+        memcpy(out + lane * outStride, digest, mid.hLen);
+    }
+}
+
+bool DetectAVX2()
+{
+    uint32_t eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+    bool have_xsave = (ecx >> 27) & 1;
+    bool have_avx = (ecx >> 28) & 1;
+    if (!(have_xsave && have_avx))
+        return false;
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__ volatile (".byte 0x0f, 0x01, 0xd0" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6)
+        return false;
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx) || eax < 7)
+        return false;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx >> 5) & 1;
+}
+
+const bool fHaveAVX2 = DetectAVX2();
+
+#endif // EH_BLAKE2B_HAVE_AVX2_PATH
+
+} // namespace
+
+void InitMidState(MidState& mid, size_t hLen, const unsigned char* personal,
+                  const unsigned char* input, size_t inputLen)
+{
+    // BLAKE2b parameter block: digest_length, key_length, fanout, depth,
+    // leaf_length, node_offset, node_depth, inner_length, reserved, salt,
+    // personal.
+    unsigned char param[64];
+    memset(param, 0, sizeof(param));
+    param[0] = (unsigned char)hLen;
+    param[2] = 1; // fanout
+    param[3] = 1; // depth
+    memcpy(param + 48, personal, 16);
+    for (int i = 0; i < 8; i++)
+        mid.h[i] = blake2b_IV[i] ^ ReadLE64(param + 8 * i);
+    mid.t = 0;
+    mid.hLen = hLen;
+    // Absorb all blocks that are guaranteed not to be the last; keep 1..128
+    // bytes buffered (an empty buffer is only possible for empty input).
+    while (inputLen > 128) {
+        mid.t += 128;
+        Compress(mid.h, input, mid.t, false);
+        input += 128;
+        inputLen -= 128;
+    }
+    memcpy(mid.buf, input, inputLen);
+    mid.buflen = inputLen;
+}
+
+void HashMany(const MidState& mid, const uint32_t* g, size_t count,
+              unsigned char* out, size_t outStride)
+{
+#ifdef EH_BLAKE2B_HAVE_AVX2_PATH
+    if (fHaveAVX2 && mid.buflen + 4 <= 128) {
+        while (count >= 4) {
+            Hash4(mid, g, out, outStride);
+            g += 4;
+            out += 4 * outStride;
+            count -= 4;
+        }
+    }
+#endif
+    while (count) {
+        Hash1(mid, *g, out);
+        g++;
+        out += outStride;
+        count--;
+    }
+}
+
+bool SelfTest()
+{
+    // Cross-check the dispatched (possibly AVX2) path against the portable
+    // finalizer on a header-shaped input; agreement with libsodium itself is
+    // covered by the unit tests.
+    unsigned char input[140];
+    for (int i = 0; i < 140; i++)
+        input[i] = (unsigned char)(i * 7 + 1);
+    unsigned char personal[16];
+    memcpy(personal, "ZcashPoW", 8);
+    WriteLE32(personal + 8, 200);
+    WriteLE32(personal + 12, 9);
+    MidState mid;
+    InitMidState(mid, 50, personal, input, sizeof(input));
+    uint32_t g[8] = {0, 1, 2, 42, 1000, 123456, 0x1fffff, 7};
+    unsigned char out1[8][64], out2[8][64];
+    for (int i = 0; i < 8; i++)
+        Hash1(mid, g[i], out1[i]);
+    HashMany(mid, g, 8, out2[0], 64);
+    for (int i = 0; i < 8; i++)
+        if (memcmp(out1[i], out2[i], 50))
+            return false;
+    return true;
+}
+
+} // namespace eh_blake2b
@@ -0,0 +1,50 @@
+// Copyright (c) 2016-2019 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_EH_BLAKE2B_H
+#define BITCOIN_CRYPTO_EH_BLAKE2B_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Minimal BLAKE2b tailored to Equihash index-hash generation.
+ *
+ * Equihash hashes H(I||V||le32(g)) for hundreds of consecutive-ish g per
+ * solution, where I||V (the block header minus solution) is fixed. This
+ * module absorbs I||V once into a midstate and then finalizes many g values
+ * in one call, four at a time through an AVX2 lane-parallel compression
+ * function when the CPU supports it. Results are bit-identical to libsodium's
+ * crypto_generichash_blake2b with the same personalization.
+ */
+namespace eh_blake2b
+{
+
+/** Hash state after absorbing the common input prefix. */
+struct MidState {
+    uint64_t h[8];           //!< chain value after all full blocks
+    uint64_t t;              //!< bytes compressed so far
+    unsigned char buf[128];  //!< buffered tail of the input
+    size_t buflen;           //!< number of valid bytes in buf
+    size_t hLen;             //!< digest length in bytes (<= 64)
+};
+
+/** Initialise a midstate for digest length hLen (1..64) with a 16-byte
+ *  personalization, then absorb inputLen bytes of input. */
+void InitMidState(MidState& mid, size_t hLen, const unsigned char* personal,
+                  const unsigned char* input, size_t inputLen);
+
+/** Finalize the hash of input||le32(g) for count values of g, writing hLen
+ *  bytes per result at out + n*outStride. Dispatches to the 4-way AVX2
+ *  path internally when available. */
+void HashMany(const MidState& mid, const uint32_t* g, size_t count,
+              unsigned char* out, size_t outStride);
+
+/** Cross-check the dispatched path against the portable finalizer on a
+ *  header-shaped input; exercised by the unit tests. */
+bool SelfTest();
+
+} // namespace eh_blake2b
+
+#endif // BITCOIN_CRYPTO_EH_BLAKE2B_H
@@ -17,6 +17,7 @@
 #endif
 
 #include "compat/endian.h"
+#include "crypto/eh_blake2b.h"
 #include "crypto/equihash.h"
 #include "util.h"
 #ifndef __linux__
@@ -25,6 +26,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <map>
 #include <stdexcept>
 
 #include <boost/optional.hpp>
@@ -410,6 +412,53 @@ std::shared_ptr<eh_trunc> TruncatedStepRow<WIDTH>::GetTruncatedIndices(size_t le
 }
 
 #ifdef ENABLE_MINING
+// Cache-blocked replacement for sorting the whole row list in one std::sort.
+// Rows compare by a memcmp over their leading bytes, so the first hash byte is
+// the most significant sort key: a single counting pass splits the list into
+// 256 runs that are permuted into place (American flag style), and each run is
+// then sorted independently with the full comparator. The per-run working sets
+// fit in cache, which matters because moving these rows dominates the sort for
+// the wide (200,9) instantiation. Small lists fall back to a plain std::sort.
+template<typename ROW>
+static void SortListByHash(std::vector<ROW>& X, size_t len)
+{
+    if (X.size() < 4096) {
+        std::sort(X.begin(), X.end(), CompareSR(len));
+        return;
+    }
+
+    size_t count[256] = {0};
+    for (size_t i = 0; i < X.size(); i++)
+        count[X[i].SortBucket()]++;
+    size_t start[256], next[256], stop[256];
+    size_t pos = 0;
+    for (int b = 0; b < 256; b++) {
+        start[b] = next[b] = pos;
+        pos += count[b];
+        stop[b] = pos;
+    }
+
+    // Swap each out-of-place row towards its bucket; a row only moves once
+    // into its final bucket, so this pass is linear in the list size.
+    for (int b = 0; b < 256; b++) {
+        size_t i = next[b];
+        while (i < stop[b]) {
+            unsigned char dest = X[i].SortBucket();
+            if (dest == static_cast<unsigned char>(b)) {
+                next[b] = ++i;
+            } else {
+                std::swap(X[i], X[next[dest]]);
+                next[dest]++;
+            }
+        }
+    }
+
+    for (int b = 0; b < 256; b++) {
+        if (stop[b] - start[b] > 1)
+            std::sort(X.begin()+start[b], X.begin()+stop[b], CompareSR(len));
+    }
+}
+
 template<unsigned int N, unsigned int K>
 bool Equihash<N,K>::BasicSolve(const eh_HashState& base_state,
                                const std::function<bool(const std::vector<unsigned char>&)> validBlock,
@@ -438,7 +487,7 @@ bool Equihash<N,K>::BasicSolve(const eh_HashState& base_state,
         LogPrint("pow", "Round %d:\n", r);
         // 2a) Sort the list
         LogPrint("pow", "- Sorting list\n");
-        std::sort(X.begin(), X.end(), CompareSR(CollisionByteLength));
+        SortListByHash(X, CollisionByteLength);
         if (cancelled(ListSorting)) throw solver_cancelled;
 
         LogPrint("pow", "- Finding collisions\n");
@@ -496,7 +545,7 @@ bool Equihash<N,K>::BasicSolve(const eh_HashState& base_state,
     LogPrint("pow", "Final round:\n");
     if (X.size() > 1) {
         LogPrint("pow", "- Sorting list\n");
-        std::sort(X.begin(), X.end(), CompareSR(hashLen));
+        SortListByHash(X, hashLen);
         if (cancelled(FinalSorting)) throw solver_cancelled;
         LogPrint("pow", "- Finding collisions\n");
         size_t i = 0;
@@ -618,7 +667,7 @@ bool Equihash<N,K>::OptimisedSolve(const eh_HashState& base_state,
             LogPrint("pow", "Round %d:\n", r);
             // 2a) Sort the list
             LogPrint("pow", "- Sorting list\n");
-            std::sort(Xt.begin(), Xt.end(), CompareSR(CollisionByteLength));
+            SortListByHash(Xt, CollisionByteLength);
             if (cancelled(ListSorting)) throw solver_cancelled;
 
             LogPrint("pow", "- Finding collisions\n");
@@ -683,7 +732,7 @@ bool Equihash<N,K>::OptimisedSolve(const eh_HashState& base_state,
         LogPrint("pow", "Final round:\n");
         if (Xt.size() > 1) {
             LogPrint("pow", "- Sorting list\n");
-            std::sort(Xt.begin(), Xt.end(), CompareSR(hashLen));
+            SortListByHash(Xt, hashLen);
             if (cancelled(FinalSorting)) throw solver_cancelled;
             LogPrint("pow", "- Finding collisions\n");
             size_t i = 0;
@@ -823,6 +872,67 @@ bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, std::vector<
                        GetSizeInBytes(N), HashLength, CollisionBitLength, i);
     }
 
+    return CheckCollisionTree(X);
+}
+
+template<unsigned int N, unsigned int K>
+bool Equihash<N,K>::IsValidSolution(const unsigned char* input, size_t inputLen,
+                                    std::vector<unsigned char> soln)
+{
+    if (ASSETCHAINS_NK[0] != 0 || ASSETCHAINS_NK[1] != 0) {
+        // The NandKPoW personalization sums a window of neighbouring hashes
+        // per index (see GenerateHash); keep it on the generic path.
+        eh_HashState base_state;
+        InitialiseState(base_state);
+        crypto_generichash_blake2b_update(&base_state, input, inputLen);
+        return IsValidSolution(base_state, soln);
+    }
+
+    if (soln.size() != SolutionWidth) {
+        LogPrint("pow", "Invalid solution length: %d (expected %d)\n",
+                 soln.size(), SolutionWidth);
+        return false;
+    }
+
+    uint32_t le_N = htole32(N);
+    uint32_t le_K = htole32(K);
+    unsigned char personalization[crypto_generichash_blake2b_PERSONALBYTES] = {};
+    memcpy(personalization, "ZcashPoW", 8);
+    memcpy(personalization+8,  &le_N, 4);
+    memcpy(personalization+12, &le_K, 4);
+
+    eh_blake2b::MidState mid;
+    eh_blake2b::InitMidState(mid, HashOutput, personalization, input, inputLen);
+
+    std::vector<eh_index> vIndices = GetIndicesFromMinimal(soln, CollisionBitLength);
+
+    // Each hash output covers IndicesPerHashOutput indices; hash each distinct
+    // block number once, then finalize them all in one batched call.
+    std::vector<eh_index> vG;
+    std::map<eh_index, size_t> mapG;
+    vG.reserve(vIndices.size());
+    for (eh_index i : vIndices) {
+        eh_index g = i / IndicesPerHashOutput;
+        if (mapG.insert(std::make_pair(g, vG.size())).second)
+            vG.push_back(g);
+    }
+    std::vector<unsigned char> vHashes(vG.size() * HashOutput);
+    eh_blake2b::HashMany(mid, vG.data(), vG.size(), vHashes.data(), HashOutput);
+
+    std::vector<FullStepRow<FinalFullWidth>> X;
+    X.reserve(1 << K);
+    for (eh_index i : vIndices) {
+        const unsigned char* hash = &vHashes[mapG[i / IndicesPerHashOutput] * HashOutput];
+        X.emplace_back(hash+((i % IndicesPerHashOutput) * GetSizeInBytes(N)),
+                       GetSizeInBytes(N), HashLength, CollisionBitLength, i);
+    }
+
+    return CheckCollisionTree(X);
+}
+
+template<unsigned int N, unsigned int K>
+bool Equihash<N,K>::CheckCollisionTree(std::vector<FullStepRow<FinalFullWidth>>& X)
+{
     size_t hashLen = HashLength;
     size_t lenIndices = sizeof(eh_index);
     while (X.size() > 1) {
@@ -864,6 +974,7 @@ template bool Equihash<200,9>::OptimisedSolve(const eh_HashState& base_state,
                                               const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
 template bool Equihash<200,9>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<200,9>::IsValidSolution(const unsigned char* input, size_t inputLen, std::vector<unsigned char> soln);
                                               
 // Explicit instantiations for Equihash<96,3>
 template int Equihash<150,5>::InitialiseState(eh_HashState& base_state);
@@ -876,6 +987,7 @@ template bool Equihash<150,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
 template bool Equihash<150,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<150,5>::IsValidSolution(const unsigned char* input, size_t inputLen, std::vector<unsigned char> soln);
 
 // Explicit instantiations for Equihash<48,5>
 template int Equihash<144,5>::InitialiseState(eh_HashState& base_state);
@@ -888,6 +1000,7 @@ template bool Equihash<144,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
 template bool Equihash<144,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<144,5>::IsValidSolution(const unsigned char* input, size_t inputLen, std::vector<unsigned char> soln);
 
 // Explicit instantiations for Equihash<96,5>
 template int Equihash<ASSETCHAINS_N,ASSETCHAINS_K>::InitialiseState(eh_HashState& base_state);
@@ -900,6 +1013,7 @@ template bool Equihash<ASSETCHAINS_N,ASSETCHAINS_K>::OptimisedSolve(const eh_Has
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
 template bool Equihash<ASSETCHAINS_N,ASSETCHAINS_K>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<ASSETCHAINS_N,ASSETCHAINS_K>::IsValidSolution(const unsigned char* input, size_t inputLen, std::vector<unsigned char> soln);
 
 // Explicit instantiations for Equihash<96,5>
 template int Equihash<48,5>::InitialiseState(eh_HashState& base_state);
@@ -912,6 +1026,7 @@ template bool Equihash<48,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
 template bool Equihash<48,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<48,5>::IsValidSolution(const unsigned char* input, size_t inputLen, std::vector<unsigned char> soln);
 
 // Explicit instantiations for Equihash<48,5>
 template int Equihash<210,9>::InitialiseState(eh_HashState& base_state);
@@ -924,3 +1039,4 @@ template bool Equihash<210,9>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
 template bool Equihash<210,9>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<210,9>::IsValidSolution(const unsigned char* input, size_t inputLen, std::vector<unsigned char> soln);
@@ -65,6 +65,9 @@ public:
     bool IsZero(size_t len);
     std::string GetHex(size_t len) { return HexStr(hash, hash+len); }
 
+    //! Leading hash byte; the solver's bucketed sort partitions rows on it.
+    unsigned char SortBucket() const { return hash[0]; }
+
     template<size_t W>
     friend bool HasCollision(StepRow<W>& a, StepRow<W>& b, size_t l);
 };
@@ -201,6 +204,14 @@ public:
                         const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
     bool IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+    //! Batch-hashing variant: absorbs the I||V prefix once and finalizes all
+    //! solution indices through eh_blake2b::HashMany. Bit-identical to the
+    //! base_state overload.
+    bool IsValidSolution(const unsigned char* input, size_t inputLen,
+                         std::vector<unsigned char> soln);
+
+private:
+    bool CheckCollisionTree(std::vector<FullStepRow<FinalFullWidth>>& X);
 };
 
 #include "equihash.tcc"
@@ -311,4 +322,21 @@ inline bool EhOptimisedSolveUncancellable(unsigned int n, unsigned int k, const
         throw std::invalid_argument("Unsupported Equihash parameters"); \
     }
 
+#define EhIsValidSolutionBatch(n, k, input, inputLen, soln, ret)   \
+    if (n == 200 && k == 9) {                             \
+        ret = Eh200_9.IsValidSolution(input, inputLen, soln);  \
+    } else if (n == 150 && k == 5) {                     \
+        ret = Eh150_5.IsValidSolution(input, inputLen, soln); \
+    } else if (n == 144 && k == 5) {                      \
+        ret = Eh144_5.IsValidSolution(input, inputLen, soln);  \
+    } else if (n == ASSETCHAINS_N && k == ASSETCHAINS_K) { \
+        ret = Eh96_5.IsValidSolution(input, inputLen, soln);  \
+    } else if (n == 48 && k == 5) {                      \
+        ret = Eh48_5.IsValidSolution(input, inputLen, soln);  \
+    } else if (n == 210 && k == 9) {                    \
+        ret = Eh210_9.IsValidSolution(input, inputLen, soln);  \
+    } else {                                             \
+        throw std::invalid_argument("Unsupported Equihash parameters"); \
+    }
+
 #endif // BITCOIN_EQUIHASH_H
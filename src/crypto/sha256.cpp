@@ -16,6 +16,16 @@ namespace sha256_sse4
 {
 void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 }
+#if defined(__GNUC__)
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+}
+namespace sha256_avx2
+{
+void Transform_8way(unsigned char* out, const unsigned char* in);
+}
+#endif
 #endif
 #endif
 
@@ -174,21 +184,130 @@ bool SelfTest(TransformType tr) {
 
 TransformType Transform = sha256::Transform;
 
+/** Compute double-SHA256 of a single 64-byte input using whatever Transform
+ *  is selected; generic fallback for SHA256D64. */
+void TransformD64(unsigned char* out, const unsigned char* in)
+{
+    uint32_t s[8];
+    static const unsigned char padding1[64] = {
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0
+    };
+    unsigned char buffer2[64] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0
+    };
+    sha256::Initialize(s);
+    Transform(s, in, 1);
+    Transform(s, padding1, 1);
+    WriteBE32(buffer2 + 0, s[0]);
+    WriteBE32(buffer2 + 4, s[1]);
+    WriteBE32(buffer2 + 8, s[2]);
+    WriteBE32(buffer2 + 12, s[3]);
+    WriteBE32(buffer2 + 16, s[4]);
+    WriteBE32(buffer2 + 20, s[5]);
+    WriteBE32(buffer2 + 24, s[6]);
+    WriteBE32(buffer2 + 28, s[7]);
+    sha256::Initialize(s);
+    Transform(s, buffer2, 1);
+    WriteBE32(out + 0, s[0]);
+    WriteBE32(out + 4, s[1]);
+    WriteBE32(out + 8, s[2]);
+    WriteBE32(out + 12, s[3]);
+    WriteBE32(out + 16, s[4]);
+    WriteBE32(out + 20, s[5]);
+    WriteBE32(out + 24, s[6]);
+    WriteBE32(out + 28, s[7]);
+}
+
+//! 8-way double-SHA256, set when an AVX2-capable CPU is detected.
+void (*TransformD64_8way)(unsigned char*, const unsigned char*) = nullptr;
+
+bool SelfTestD64()
+{
+    // Compare the parallel path, if any, against the generic one on eight
+    // distinct messages.
+    unsigned char in[512];
+    for (int i = 0; i < 512; i++)
+        in[i] = (unsigned char)(i * 251 + 13);
+    unsigned char out1[256], out2[256];
+    for (int i = 0; i < 8; i++)
+        TransformD64(out1 + 32 * i, in + 64 * i);
+    if (TransformD64_8way) {
+        TransformD64_8way(out2, in);
+        if (memcmp(out1, out2, 256))
+            return false;
+    }
+    return true;
+}
+
 } // namespace
 
 std::string SHA256AutoDetect()
 {
+    std::string ret = "standard";
 #if defined(EXPERIMENTAL_ASM) && (defined(__x86_64__) || defined(__amd64__))
     uint32_t eax, ebx, ecx, edx;
-    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx >> 19) & 1) {
-        Transform = sha256_sse4::Transform;
-        assert(SelfTest(Transform));
-        return "sse4";
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        bool have_sse4 = (ecx >> 19) & 1;
+        bool have_xsave = (ecx >> 27) & 1;
+        bool have_avx = (ecx >> 28) & 1;
+        bool enabled_avx = false;
+        if (have_xsave && have_avx) {
+            // Check that the OS saves the ymm state.
+            uint32_t xcr0_lo, xcr0_hi;
+            __asm__ volatile (".byte 0x0f, 0x01, 0xd0" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+            enabled_avx = (xcr0_lo & 6) == 6;
+        }
+        bool have_avx2 = false;
+        bool have_shani = false;
+        if (__get_cpuid(0, &eax, &ebx, &ecx, &edx) && eax >= 7) {
+            __cpuid_count(7, 0, eax, ebx, ecx, edx);
+            have_avx2 = (ebx >> 5) & 1;
+            have_shani = (ebx >> 29) & 1;
+        }
+        if (have_sse4) {
+            Transform = sha256_sse4::Transform;
+            ret = "sse4";
+        }
+#if defined(__GNUC__)
+        if (have_shani) {
+            Transform = sha256_shani::Transform;
+            ret = "shani";
+        }
+        if (have_avx2 && enabled_avx) {
+            TransformD64_8way = sha256_avx2::Transform_8way;
+            ret += ",avx2_8way";
+        }
+#endif
     }
 #endif
 
     assert(SelfTest(Transform));
-    return "standard";
+    assert(SelfTestD64());
+    return ret;
+}
+
+void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    if (TransformD64_8way) {
+        while (blocks >= 8) {
+            TransformD64_8way(out, in);
+            out += 256;
+            in += 512;
+            blocks -= 8;
+        }
+    }
+    while (blocks) {
+        TransformD64(out, in);
+        out += 32;
+        in += 64;
+        blocks--;
+    }
 }
 
 ////// SHA-256
@@ -0,0 +1,173 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This file is only compiled when --enable-experimental-asm is set on an
+// x86_64 host (see Makefile.am); the function target attributes let it build
+// without -mavx2 so dispatch can stay a pure runtime decision.
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(__GNUC__)
+
+#include <immintrin.h>
+#include <stdint.h>
+
+#include "crypto/common.h"
+
+namespace sha256_avx2
+{
+namespace
+{
+
+/* SHA-256 round constants */
+const uint32_t K256[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul,
+    0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul,
+    0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul,
+    0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul,
+    0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul,
+    0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul,
+    0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul,
+    0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul,
+    0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+};
+
+__attribute__((target("avx2")))
+inline __m256i K(uint32_t x) { return _mm256_set1_epi32((int)x); }
+
+__attribute__((target("avx2")))
+inline __m256i Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__attribute__((target("avx2")))
+inline __m256i Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__attribute__((target("avx2")))
+inline __m256i And(__m256i x, __m256i y) { return _mm256_and_si256(x, y); }
+__attribute__((target("avx2")))
+inline __m256i Or(__m256i x, __m256i y) { return _mm256_or_si256(x, y); }
+__attribute__((target("avx2")))
+inline __m256i ShR(__m256i x, int n) { return _mm256_srli_epi32(x, n); }
+__attribute__((target("avx2")))
+inline __m256i Rotr(__m256i x, int n) { return Or(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n)); }
+
+__attribute__((target("avx2")))
+inline __m256i Ch(__m256i x, __m256i y, __m256i z) { return Xor(z, And(x, Xor(y, z))); }
+__attribute__((target("avx2")))
+inline __m256i Maj(__m256i x, __m256i y, __m256i z) { return Or(And(x, y), And(z, Or(x, y))); }
+__attribute__((target("avx2")))
+inline __m256i Sigma0(__m256i x) { return Xor(Xor(Rotr(x, 2), Rotr(x, 13)), Rotr(x, 22)); }
+__attribute__((target("avx2")))
+inline __m256i Sigma1(__m256i x) { return Xor(Xor(Rotr(x, 6), Rotr(x, 11)), Rotr(x, 25)); }
+__attribute__((target("avx2")))
+inline __m256i sigma0(__m256i x) { return Xor(Xor(Rotr(x, 7), Rotr(x, 18)), ShR(x, 3)); }
+__attribute__((target("avx2")))
+inline __m256i sigma1(__m256i x) { return Xor(Xor(Rotr(x, 17), Rotr(x, 19)), ShR(x, 10)); }
+
+/** Gather big-endian word `offset` of eight 64-byte messages into the eight
+ *  32-bit lanes of a vector (lane i = message i). */
+__attribute__((target("avx2")))
+inline __m256i Read8(const unsigned char* chunk, int offset)
+{
+    return _mm256_set_epi32(
+        (int)ReadBE32(chunk + 448 + offset), (int)ReadBE32(chunk + 384 + offset),
+        (int)ReadBE32(chunk + 320 + offset), (int)ReadBE32(chunk + 256 + offset),
+        (int)ReadBE32(chunk + 192 + offset), (int)ReadBE32(chunk + 128 + offset),
+        (int)ReadBE32(chunk + 64 + offset), (int)ReadBE32(chunk + 0 + offset));
+}
+
+/** Scatter the eight lanes of a vector into word `offset` of eight 32-byte
+ *  outputs (lane i = output i). */
+__attribute__((target("avx2")))
+inline void Write8(unsigned char* out, int offset, __m256i v)
+{
+    WriteBE32(out + 0 + offset, (uint32_t)_mm256_extract_epi32(v, 0));
+    WriteBE32(out + 32 + offset, (uint32_t)_mm256_extract_epi32(v, 1));
+    WriteBE32(out + 64 + offset, (uint32_t)_mm256_extract_epi32(v, 2));
+    WriteBE32(out + 96 + offset, (uint32_t)_mm256_extract_epi32(v, 3));
+    WriteBE32(out + 128 + offset, (uint32_t)_mm256_extract_epi32(v, 4));
+    WriteBE32(out + 160 + offset, (uint32_t)_mm256_extract_epi32(v, 5));
+    WriteBE32(out + 192 + offset, (uint32_t)_mm256_extract_epi32(v, 6));
+    WriteBE32(out + 224 + offset, (uint32_t)_mm256_extract_epi32(v, 7));
+}
+
+/** One 64-round SHA-256 compression of eight lanes. The message schedule is
+ *  in w[0..15] on entry; s[0..7] is updated in place (feed-forward applied
+ *  by the caller). */
+__attribute__((target("avx2")))
+void Compress8(__m256i s[8], __m256i w[16])
+{
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+    __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+
+    for (int t = 0; t < 64; t++) {
+        __m256i wt;
+        if (t < 16) {
+            wt = w[t];
+        } else {
+            wt = Add(Add(sigma1(w[(t - 2) & 15]), w[(t - 7) & 15]),
+                     Add(sigma0(w[(t - 15) & 15]), w[t & 15]));
+            w[t & 15] = wt;
+        }
+        __m256i t1 = Add(Add(Add(h, Sigma1(e)), Ch(e, f, g)), Add(K(K256[t]), wt));
+        __m256i t2 = Add(Sigma0(a), Maj(a, b, c));
+        h = g; g = f; f = e;
+        e = Add(d, t1);
+        d = c; c = b; b = a;
+        a = Add(t1, t2);
+    }
+
+    s[0] = Add(s[0], a); s[1] = Add(s[1], b); s[2] = Add(s[2], c); s[3] = Add(s[3], d);
+    s[4] = Add(s[4], e); s[5] = Add(s[5], f); s[6] = Add(s[6], g); s[7] = Add(s[7], h);
+}
+
+__attribute__((target("avx2")))
+inline void Init8(__m256i s[8])
+{
+    s[0] = K(0x6a09e667ul); s[1] = K(0xbb67ae85ul); s[2] = K(0x3c6ef372ul); s[3] = K(0xa54ff53aul);
+    s[4] = K(0x510e527ful); s[5] = K(0x9b05688cul); s[6] = K(0x1f83d9abul); s[7] = K(0x5be0cd19ul);
+}
+
+} // namespace
+
+/** Compute double-SHA256 of eight independent 64-byte inputs (in, 512 bytes
+ *  total), writing eight 32-byte hashes to out. */
+__attribute__((target("avx2")))
+void Transform_8way(unsigned char* out, const unsigned char* in)
+{
+    __m256i s[8], w[16];
+
+    // Transform 1: the eight 64-byte messages.
+    Init8(s);
+    for (int t = 0; t < 16; t++)
+        w[t] = Read8(in, t * 4);
+    Compress8(s, w);
+
+    // Transform 2: the (shared) padding block of a 64-byte message,
+    // completing the inner hash in s.
+    w[0] = K(0x80000000ul);
+    for (int t = 1; t < 15; t++)
+        w[t] = K(0);
+    w[15] = K(512);
+    Compress8(s, w);
+
+    // Transform 3: hash the 32-byte inner hash, pre-padded.
+    for (int t = 0; t < 8; t++)
+        w[t] = s[t];
+    w[8] = K(0x80000000ul);
+    for (int t = 9; t < 15; t++)
+        w[t] = K(0);
+    w[15] = K(256);
+    __m256i s2[8];
+    Init8(s2);
+    Compress8(s2, w);
+
+    for (int t = 0; t < 8; t++)
+        Write8(out, t * 4, s2[t]);
+}
+
+} // namespace sha256_avx2
+
+#endif
@@ -14,12 +14,26 @@
 #include <memenv.h>
 #include <stdint.h>
 
+#include <algorithm>
+
 static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxOpenFiles)
 {
     leveldb::Options options;
     options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    // up to two write buffers may be held in memory simultaneously; -dbwritebuffer overrides
+    // the cache-derived size (in bytes) for write-heavy workloads like a reindex
+    int64_t nWriteBuffer = GetArg("-dbwritebuffer", 0);
+    options.write_buffer_size = nWriteBuffer > 0 ? (size_t)nWriteBuffer : nCacheSize / 4;
+    // bloom filters keep negative point lookups (txindex, address index probes)
+    // from touching every table file; -dbbloombits=0 disables them
+    int64_t nBloomBits = GetArg("-dbbloombits", DEFAULT_DB_BLOOM_BITS);
+    if (nBloomBits > 0)
+        options.filter_policy = leveldb::NewBloomFilterPolicy((int)std::min<int64_t>(nBloomBits, 32));
+    // larger uncompressed blocks (-dbblocksize, in bytes) trade point-lookup
+    // latency for better scan throughput and compression ratio
+    int64_t nBlockSize = GetArg("-dbblocksize", 0);
+    if (nBlockSize > 0)
+        options.block_size = (size_t)nBlockSize;
     options.compression = compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
     options.max_open_files = maxOpenFiles;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
@@ -13,11 +13,18 @@
 
 #include <boost/filesystem/path.hpp>
 
+#include <atomic>
+
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
+//! Stack capacity of CDBKeyWriter; the largest key family is the address
+//! index at 67 bytes including its prefix byte.
+static const size_t DBWRAPPER_MAX_KEY_SIZE = 96;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
+//! Bits per key for the leveldb bloom filter policy (-dbbloombits, 0 = off)
+static const int DEFAULT_DB_BLOOM_BITS = 10;
 
 class dbwrapper_error : public std::runtime_error
 {
@@ -37,6 +44,44 @@ void HandleError(const leveldb::Status& status);
 
 };
 
+/** Serializes a database key into a fixed stack buffer.
+ *
+ *  Every key family (block index, txindex, addressindex, spentindex, ...) has
+ *  a small layout known at compile time, yet point lookups built each key
+ *  through a fresh heap-backed CDataStream. Iteration-heavy workloads such as
+ *  address index scans turn that into millions of tiny allocations. The
+ *  capacity assert bounds the largest family (address index, ~70 bytes) with
+ *  headroom.
+ */
+class CDBKeyWriter
+{
+private:
+    char buf[DBWRAPPER_MAX_KEY_SIZE];
+    size_t nSize;
+
+public:
+    CDBKeyWriter() : nSize(0) {}
+
+    int GetType() const { return SER_DISK; }
+    int GetVersion() const { return CLIENT_VERSION; }
+
+    void write(const char* pch, size_t size)
+    {
+        assert(nSize + size <= sizeof(buf));
+        memcpy(buf + nSize, pch, size);
+        nSize += size;
+    }
+
+    template <typename T>
+    CDBKeyWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+
+    leveldb::Slice GetSlice() const { return leveldb::Slice(buf, nSize); }
+};
+
 /** Batch of changes queued to be written to a CDBWrapper */
 class CDBBatch
 {
@@ -46,33 +91,56 @@ private:
     const CDBWrapper &parent;
     leveldb::WriteBatch batch;
 
+    //! Serialization scratch space, reused across Write()/Erase() calls;
+    //! leveldb copies the slices into the batch before returning.
+    CDataStream ssKey;
+    CDataStream ssValue;
+
 public:
     /**
      * @param[in] _parent   CDBWrapper that this batch is to be submitted to
      */
-    CDBBatch(const CDBWrapper &_parent) : parent(_parent) { };
+    CDBBatch(const CDBWrapper &_parent) : parent(_parent),
+        ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION)
+    {
+        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssValue.reserve(DBWRAPPER_PREALLOC_VALUE_SIZE);
+    };
+
+    //! Drop the accumulated operations but keep the scratch buffers, so the
+    //! batch object can be reused for a subsequent chunk.
+    void Clear()
+    {
+        batch.Clear();
+    }
 
     template <typename K, typename V>
     void Write(const K& key, const V& value)
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey.clear();
         ssKey << key;
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        ssValue.reserve(DBWRAPPER_PREALLOC_VALUE_SIZE);
+        ssValue.clear();
         ssValue << value;
         leveldb::Slice slValue(&ssValue[0], ssValue.size());
 
         batch.Put(slKey, slValue);
     }
 
+    //! Queue a record whose key and value are already in serialized form,
+    //! e.g. when copying records between databases or importing a snapshot.
+    void WriteRaw(const std::vector<unsigned char>& key, const std::vector<unsigned char>& value)
+    {
+        leveldb::Slice slKey((const char*)key.data(), key.size());
+        leveldb::Slice slValue((const char*)value.data(), value.size());
+        batch.Put(slKey, slValue);
+    }
+
     template <typename K>
     void Erase(const K& key)
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey.clear();
         ssKey << key;
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
@@ -102,11 +170,9 @@ public:
     void SeekToLast();
 
     template<typename K> void Seek(const K& key) {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(GetSerializeSize(ssKey, key));
+        CDBKeyWriter ssKey;
         ssKey << key;
-        leveldb::Slice slKey(&ssKey[0], ssKey.size());
-        piter->Seek(slKey);
+        piter->Seek(ssKey.GetSlice());
     }
 
     void Next();
@@ -148,6 +214,16 @@ public:
         return true;
     }
 
+    bool GetValueDataStream(CDataStream &ssValue) {
+        leveldb::Slice slValue = piter->value();
+        try {
+            ssValue = CDataStream(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        } catch(std::exception &e) {
+            return false;
+        }
+        return true;
+    }
+
     unsigned int GetValueSize() {
         return piter->value().size();
     }
@@ -181,6 +257,11 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! point lookups (Read/Exists) served, and how many found their key;
+    //! consumed by the dbcache governor to compare per-database traffic
+    mutable std::atomic<uint64_t> nReadCount{0};
+    mutable std::atomic<uint64_t> nReadFoundCount{0};
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -203,13 +284,12 @@ public:
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        CDBKeyWriter ssKey;
         ssKey << key;
-        leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
+        nReadCount++;
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(readoptions, ssKey.GetSlice(), &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -222,6 +302,7 @@ public:
         } catch (const std::exception&) {
             return false;
         }
+        nReadFoundCount++;
         return true;
     }
 
@@ -248,19 +329,19 @@ public:
     template <typename K>
     bool Exists(const K& key) const
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        CDBKeyWriter ssKey;
         ssKey << key;
-        leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
+        nReadCount++;
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(readoptions, ssKey.GetSlice(), &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
+        nReadFoundCount++;
         return true;
     }
 
@@ -319,6 +400,11 @@ public:
      * @returns true if the database managed by this class contains no entries.
      */
     bool IsEmpty();
+
+    //! Number of point lookups (Read/Exists) served since startup
+    uint64_t GetReadCount() const { return nReadCount; }
+    //! How many of those lookups found their key
+    uint64_t GetReadFoundCount() const { return nReadFoundCount; }
 };
 
 #endif // BITCOIN_DBWRAPPER_H
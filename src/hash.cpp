@@ -87,6 +87,76 @@ unsigned int MurmurHash3(unsigned int nHashSeed, const std::vector<unsigned char
     return h1;
 }
 
+void MurmurHash3Multi(const unsigned int* pnSeeds, unsigned int nSeeds, const std::vector<unsigned char>& vDataToHash, unsigned int* pnHashesOut)
+{
+    // Same x86_32 MurmurHash3 as above, but keeping one h1 state per seed.
+    // k1 only depends on the data, so each block is read and pre-mixed once;
+    // the inner loop over the states is branch-free and auto-vectorizes.
+    for (unsigned int n = 0; n < nSeeds; n++)
+        pnHashesOut[n] = pnSeeds[n];
+
+    if (vDataToHash.size() > 0)
+    {
+        const uint32_t c1 = 0xcc9e2d51;
+        const uint32_t c2 = 0x1b873593;
+
+        const int nblocks = vDataToHash.size() / 4;
+
+        //----------
+        // body
+        const uint8_t* blocks = &vDataToHash[0] + nblocks * 4;
+
+        for (int i = -nblocks; i; i++) {
+            uint32_t k1 = ReadLE32(blocks + i*4);
+
+            k1 *= c1;
+            k1 = ROTL32(k1, 15);
+            k1 *= c2;
+
+            for (unsigned int n = 0; n < nSeeds; n++) {
+                uint32_t h1 = pnHashesOut[n];
+                h1 ^= k1;
+                h1 = ROTL32(h1, 13);
+                h1 = h1 * 5 + 0xe6546b64;
+                pnHashesOut[n] = h1;
+            }
+        }
+
+        //----------
+        // tail
+        const uint8_t* tail = (const uint8_t*)(&vDataToHash[0] + nblocks * 4);
+
+        uint32_t k1 = 0;
+
+        switch (vDataToHash.size() & 3) {
+        case 3:
+            k1 ^= tail[2] << 16;
+        case 2:
+            k1 ^= tail[1] << 8;
+        case 1:
+            k1 ^= tail[0];
+            k1 *= c1;
+            k1 = ROTL32(k1, 15);
+            k1 *= c2;
+            for (unsigned int n = 0; n < nSeeds; n++)
+                pnHashesOut[n] ^= k1;
+        };
+    }
+
+    //----------
+    // finalization
+    for (unsigned int n = 0; n < nSeeds; n++) {
+        uint32_t h1 = pnHashesOut[n];
+        h1 ^= vDataToHash.size();
+        h1 ^= h1 >> 16;
+        h1 *= 0x85ebca6b;
+        h1 ^= h1 >> 13;
+        h1 *= 0xc2b2ae35;
+        h1 ^= h1 >> 16;
+        pnHashesOut[n] = h1;
+    }
+}
+
 void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char header, const unsigned char data[32], unsigned char output[64])
 {
     unsigned char num[4];
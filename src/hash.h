@@ -231,6 +231,12 @@ uint256 SerializeHash(const T& obj, int nType=SER_GETHASH, int nVersion=PROTOCOL
 
 unsigned int MurmurHash3(unsigned int nHashSeed, const std::vector<unsigned char>& vDataToHash);
 
+/** Compute MurmurHash3 of the same data under nSeeds different seeds at once.
+ *  The data-dependent block mixing is shared between all seeds, so the data is
+ *  read once and the per-seed work reduces to a few vectorizable ALU ops per
+ *  block, instead of nSeeds full passes. */
+void MurmurHash3Multi(const unsigned int* pnSeeds, unsigned int nSeeds, const std::vector<unsigned char>& vDataToHash, unsigned int* pnHashesOut);
+
 void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char header, const unsigned char data[32], unsigned char output[64]);
 
 #endif // BITCOIN_HASH_H
@@ -90,6 +90,28 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     req->WriteReply(nStatus, strReply);
 }
 
+/** Methods whose non-verbose result is a single hex-encoded blob. When the
+ * client sends Accept: application/octet-stream for one of these, the raw
+ * bytes are returned instead of JSON, so a block fetch no longer ships (and
+ * the consumer no longer decodes) twice the block size in hex. */
+static const char *rpcBinaryMethods[] = {
+    "getblock",
+    "getblockheader",
+    "getrawtransaction",
+    "gettxoutproof",
+};
+
+static bool BinaryResultRequested(HTTPRequest* req, const std::string& strMethod)
+{
+    std::pair<bool, std::string> accept = req->GetHeader("accept");
+    if (!accept.first || accept.second.find("application/octet-stream") == std::string::npos)
+        return false;
+    for (unsigned int i = 0; i < ARRAYLEN(rpcBinaryMethods); i++)
+        if (strMethod == rpcBinaryMethods[i])
+            return true;
+    return false;
+}
+
 static bool RPCAuthorized(const std::string& strAuth)
 {
     if (strRPCUserColonPass.empty()) // Belt-and-suspenders measure if InitRPCAuthentication was not called
@@ -153,6 +175,15 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 
             UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
 
+            // negotiated binary framing: ship the decoded bytes of a hex
+            // blob result directly (verbose results still go out as JSON)
+            if (BinaryResultRequested(req, jreq.strMethod) && result.isStr() && IsHex(result.get_str())) {
+                std::vector<unsigned char> data = ParseHex(result.get_str());
+                req->WriteHeader("Content-Type", "application/octet-stream");
+                req->WriteReply(HTTP_OK, std::string(data.begin(), data.end()));
+                return true;
+            }
+
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
 
@@ -191,6 +222,17 @@ static bool InitRPCAuthentication()
     return true;
 }
 
+static bool HTTPReq_PrometheusMetrics(HTTPRequest* req, const std::string &)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "metrics endpoint handles only GET requests");
+        return false;
+    }
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, RPCMetricsPrometheusText());
+    return true;
+}
+
 bool StartHTTPRPC()
 {
     LogPrint("rpc", "Starting HTTP RPC server\n");
@@ -198,6 +240,9 @@ bool StartHTTPRPC()
         return false;
 
     RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    // scrapers do not send credentials, so the endpoint is strictly opt-in
+    if (GetBoolArg("-prometheusmetrics", false))
+        RegisterHTTPHandler("/metrics", true, HTTPReq_PrometheusMetrics);
 
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
@@ -214,6 +259,8 @@ void StopHTTPRPC()
 {
     LogPrint("rpc", "Stopping HTTP RPC server\n");
     UnregisterHTTPHandler("/", true);
+    if (GetBoolArg("-prometheusmetrics", false))
+        UnregisterHTTPHandler("/metrics", true);
     if (httpRPCTimerInterface) {
         RPCUnregisterTimerInterface(httpRPCTimerInterface);
         delete httpRPCTimerInterface;
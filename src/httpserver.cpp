@@ -44,20 +44,25 @@
 class HTTPWorkItem : public HTTPClosure
 {
 public:
-    HTTPWorkItem(HTTPRequest* req, const std::string &path, const HTTPRequestHandler& func):
-        req(req), path(path), func(func)
+    HTTPWorkItem(HTTPRequest* req, const std::string &path, const HTTPRequestHandler& func, bool light):
+        req(req), path(path), func(func), light(light)
     {
     }
     void operator()()
     {
         func(req.get(), path);
     }
+    bool IsLight() const
+    {
+        return light;
+    }
 
     boost::scoped_ptr<HTTPRequest> req;
 
 private:
     std::string path;
     HTTPRequestHandler func;
+    bool light;
 };
 
 /** Simple work queue for distributing work over multiple threads.
@@ -74,8 +79,27 @@ private:
     std::deque<WorkItem*> queue;
     bool running;
     size_t maxDepth;
+    size_t lightDepth;
+    size_t heavyDepth;
     int numThreads;
 
+    /** Take the first queued item this worker may run (requires cs) */
+    WorkItem* Dequeue(bool fLightOnly)
+    {
+        for (typename std::deque<WorkItem*>::iterator it = queue.begin(); it != queue.end(); ++it) {
+            if (!fLightOnly || (*it)->IsLight()) {
+                WorkItem* i = *it;
+                queue.erase(it);
+                if (i->IsLight())
+                    lightDepth -= 1;
+                else
+                    heavyDepth -= 1;
+                return i;
+            }
+        }
+        return 0;
+    }
+
     /** RAII object to keep track of number of running worker threads */
     class ThreadCounter
     {
@@ -97,6 +121,8 @@ private:
 public:
     WorkQueue(size_t maxDepth) : running(true),
                                  maxDepth(maxDepth),
+                                 lightDepth(0),
+                                 heavyDepth(0),
                                  numThreads(0)
     {
     }
@@ -114,27 +140,31 @@ public:
     bool Enqueue(WorkItem* item)
     {
         boost::unique_lock<boost::mutex> lock(cs);
-        if (queue.size() >= maxDepth) {
+        // Light and heavy items are capped separately, so a flood of
+        // expensive queries cannot crowd cheap ones out of the queue
+        if ((item->IsLight() ? lightDepth : heavyDepth) >= maxDepth) {
             return false;
         }
+        if (item->IsLight())
+            lightDepth += 1;
+        else
+            heavyDepth += 1;
         queue.push_back(item);
-        cond.notify_one();
+        cond.notify_all();
         return true;
     }
-    /** Thread function */
-    void Run()
+    /** Thread function; workers with fLightOnly set skip heavy items */
+    void Run(bool fLightOnly = false)
     {
         ThreadCounter count(*this);
         while (running) {
             WorkItem* i = 0;
             {
                 boost::unique_lock<boost::mutex> lock(cs);
-                while (running && queue.empty())
+                while (running && (i = Dequeue(fLightOnly)) == 0)
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = queue.front();
-                queue.pop_front();
             }
             (*i)();
             delete i;
@@ -249,6 +279,44 @@ static std::string RequestMethodString(HTTPRequest::RequestMethod m)
 }
 
 /** HTTP request callback */
+/** RPC methods cheap enough for the reserved worker lane; anything else
+ * (including batches) may hold a general worker for a long time */
+static const char* rpcLightMethods[] = {
+    "getbestblockhash", "getblockchaininfo", "getblockcount",
+    "getconnectioncount", "getinfo", "getnetworkinfo", "getwalletinfo",
+    "help", "ping", "stop"
+};
+
+/** Classify a request by peeking at the JSON-RPC body for its method name,
+ * without consuming the body (the handler reads it on the worker thread).
+ * Batches and unrecognized methods are treated as heavy.
+ */
+static bool IsLightRequest(HTTPRequest* req)
+{
+    std::string body = req->PeekBody(256);
+    size_t pos = body.find_first_not_of(" \t\r\n");
+    if (pos == std::string::npos || body[pos] != '{')
+        return false;
+    pos = body.find("\"method\"");
+    if (pos == std::string::npos)
+        return false;
+    pos = body.find(':', pos + 8);
+    if (pos == std::string::npos)
+        return false;
+    size_t start = body.find('"', pos + 1);
+    if (start == std::string::npos)
+        return false;
+    size_t end = body.find('"', start + 1);
+    if (end == std::string::npos)
+        return false;
+    std::string method = body.substr(start + 1, end - start - 1);
+    for (size_t n = 0; n < ARRAYLEN(rpcLightMethods); n++) {
+        if (method == rpcLightMethods[n])
+            return true;
+    }
+    return false;
+}
+
 static void http_request_cb(struct evhttp_request* req, void* arg)
 {
     // Disable reading to work around a libevent bug, fixed in 2.2.0.
@@ -301,7 +369,8 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
-        std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(hreq.release(), path, i->handler));
+        bool fLight = IsLightRequest(hreq.get());
+        std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(hreq.release(), path, i->handler, fLight));
         assert(workQueue);
         if (workQueue->Enqueue(item.get()))
             item.release(); /* if true, queue took ownership */
@@ -368,11 +437,16 @@ static bool HTTPBindAddresses(struct evhttp* http)
     return !boundSockets.empty();
 }
 
+size_t HTTPWorkQueueDepth()
+{
+    return workQueue ? workQueue->Depth() : 0;
+}
+
 /** Simple wrapper to set thread name and run work queue */
-static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue)
+static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, bool fLightOnly)
 {
-    RenameThread("zcash-httpworker");
-    queue->Run();
+    RenameThread(fLightOnly ? "zcash-httplight" : "zcash-httpworker");
+    queue->Run(fLightOnly);
 }
 
 /** libevent event log callback */
@@ -460,11 +534,19 @@ bool StartHTTPServer()
 {
     LogPrint("http", "Starting HTTP server\n");
     int rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
+    // Workers in the reserved lane only serve cheap calls like getinfo, so
+    // health checks keep answering while heavy queries occupy the others
+    int rpcReservedThreads = std::max((long)GetArg("-rpcreservedthreads", 1L), 0L);
+    LogPrintf("HTTP: starting %d worker threads (%d reserved for light requests)\n",
+              rpcThreads, rpcReservedThreads);
     threadHTTP = boost::thread(boost::bind(&ThreadHTTP, eventBase, eventHTTP));
 
     for (int i = 0; i < rpcThreads; i++) {
-        boost::thread rpc_worker(HTTPWorkQueueRun, workQueue);
+        boost::thread rpc_worker(boost::bind(&HTTPWorkQueueRun, workQueue, false));
+        rpc_worker.detach();
+    }
+    for (int i = 0; i < rpcReservedThreads; i++) {
+        boost::thread rpc_worker(boost::bind(&HTTPWorkQueueRun, workQueue, true));
         rpc_worker.detach();
     }
     return true;
@@ -596,6 +678,18 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+std::string HTTPRequest::PeekBody(size_t nMaxSize)
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    size_t size = std::min(evbuffer_get_length(buf), nMaxSize);
+    const char* data = (const char*)evbuffer_pullup(buf, size);
+    if (!data) // returns NULL in case of empty buffer
+        return "";
+    return std::string(data, size);
+}
+
 void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
 {
     struct evkeyvalq* headers = evhttp_request_get_output_headers(req);
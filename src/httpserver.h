@@ -47,6 +47,9 @@ void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPR
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Current number of requests waiting in the work queue (0 when not running) */
+size_t HTTPWorkQueueDepth();
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -102,6 +105,12 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Peek at up to nMaxSize bytes of the request body without consuming it,
+     * e.g. to classify a request before dispatching it to a worker.
+     */
+    std::string PeekBody(size_t nMaxSize);
+
     /**
      * Write output header.
      *
@@ -126,6 +135,8 @@ class HTTPClosure
 {
 public:
     virtual void operator()() = 0;
+    //! Whether this item is cheap enough for the reserved worker lane
+    virtual bool IsLight() const { return false; }
     virtual ~HTTPClosure() {}
 };
 
@@ -34,6 +34,7 @@
 #include "consensus/validation.h"
 #include "httpserver.h"
 #include "httprpc.h"
+#include "stratum.h"
 #include "key.h"
 #include "notarisationdb.h"
 #include "komodo.h"
@@ -53,6 +54,8 @@
 #include "rpc/register.h"
 #include "script/standard.h"
 #include "scheduler.h"
+#include "oraclesdb.h"
+#include "tokensdb.h"
 #include "txdb.h"
 #include "torcontrol.h"
 #include "ui_interface.h"
@@ -81,11 +84,14 @@
 #include <boost/interprocess/sync/file_lock.hpp>
 #include <boost/thread.hpp>
 #include <chrono>
+#include <future>
+#include <mutex>
 #include <openssl/crypto.h>
 #include <thread>
 
 #if ENABLE_ZMQ
 #include "zmq/zmqnotificationinterface.h"
+#include "zmq/zmqreplication.h"
 #endif
 
 #if ENABLE_PROTON
@@ -113,6 +119,7 @@ assetchain chainName;
 #ifdef ENABLE_WALLET
 CWallet* pwalletMain = NULL;
 #endif
+CScheduler* ptaskScheduler = NULL;
 bool fFeeEstimatesInitialized = false;
 
 #if ENABLE_ZMQ
@@ -203,17 +210,21 @@ public:
     // Writes do not need similar protection, as failure to write is handled by the caller.
 };
 
-static CCoinsViewDB *pcoinsdbview = NULL;
+CCoinsViewDB *pcoinsdbview = NULL;
 static CCoinsViewErrorCatcher *pcoinscatcher = NULL;
 static boost::scoped_ptr<ECCVerifyHandle> globalVerifyHandle;
 
 void Interrupt(boost::thread_group& threadGroup)
 {
     InterruptHTTPServer();
+    InterruptStratumServer();
     InterruptHTTPRPC();
     InterruptRPC();
     InterruptREST();
     InterruptTorControl();
+#if ENABLE_ZMQ
+    InterruptZMQReplication();
+#endif
     threadGroup.interrupt_all();
 }
 
@@ -239,6 +250,7 @@ void Shutdown()
     StopREST();
     StopRPC();
     StopHTTPServer();
+    StopStratumServer();
 #ifdef ENABLE_WALLET
     if (pwalletMain)
         pwalletMain->Flush(false);
@@ -254,17 +266,36 @@ void Shutdown()
     StopTorControl();
     UnregisterNodeSignals(GetNodeSignals());
 
+    // The mempool dump, fee estimates and final wallet flush write disjoint
+    // files and none of them need cs_main, so they run in parallel with the
+    // chainstate flush below, which dominates shutdown time; everything is
+    // joined before the globals are torn down.
+    int64_t nShutdownFlushStart = GetTimeMillis();
+    std::vector<std::future<void>> vFlushTasks;
+
+    // Save the mempool once the node is stopped, so a restart rejoins relay
+    // warm instead of waiting for re-propagation
+    if (GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL) && pcoinsTip != NULL)
+        vFlushTasks.push_back(std::async(std::launch::async, []() { DumpMempool(); }));
+
     if (fFeeEstimatesInitialized)
     {
-        boost::filesystem::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
-        CAutoFile est_fileout(fopen(est_path.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
-        if (!est_fileout.IsNull())
-            mempool.WriteFeeEstimates(est_fileout);
-        else
-            LogPrintf("%s: Failed to write fee estimates to %s\n", __func__, est_path.string());
+        vFlushTasks.push_back(std::async(std::launch::async, []() {
+            boost::filesystem::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
+            CAutoFile est_fileout(fopen(est_path.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+            if (!est_fileout.IsNull())
+                mempool.WriteFeeEstimates(est_fileout);
+            else
+                LogPrintf("Shutdown: Failed to write fee estimates to %s\n", est_path.string());
+        }));
         fFeeEstimatesInitialized = false;
     }
 
+#ifdef ENABLE_WALLET
+    if (pwalletMain)
+        vFlushTasks.push_back(std::async(std::launch::async, []() { pwalletMain->Flush(true); }));
+#endif
+
     {
         LOCK(cs_main);
         if (pcoinsTip != NULL) {
@@ -280,11 +311,16 @@ void Shutdown()
         pblocktree = nullptr;
         delete pnotarisations;
         pnotarisations = nullptr;
+        delete ptokensdb;
+        ptokensdb = nullptr;
+        delete poraclesdb;
+        poraclesdb = nullptr;
     }
-#ifdef ENABLE_WALLET
-    if (pwalletMain)
-        pwalletMain->Flush(true);
-#endif
+
+    // collect the mempool/fee-estimate/wallet writers started above
+    for (std::future<void> &task : vFlushTasks)
+        task.get();
+    LogPrintf("%s: state flushed in %dms\n", __func__, GetTimeMillis() - nShutdownFlushStart);
 
 #if ENABLE_ZMQ
     if (pzmqNotificationInterface) {
@@ -310,6 +346,7 @@ void Shutdown()
     }
 #endif
     UnregisterAllValidationInterfaces();
+    ptaskScheduler = NULL;
 #ifdef ENABLE_WALLET
     delete pwalletMain;
     pwalletMain = NULL;
@@ -319,6 +356,7 @@ void Shutdown()
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    StopAsyncDebugLog();
 }
 
 /**
@@ -397,10 +435,15 @@ std::string HelpMessage(HelpMessageMode mode)
     }
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
+    strUsage += HelpMessageOpt("-fleet", _("Shrink cache and thread defaults for hosts running one daemon per asset chain; explicitly set options still take effect (default: 0)"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-loadsnapshot=<file>", _("Bootstrap an empty chainstate from a snapshot file created with dumpchainstate; requires -prune, since the snapshot carries no historical block files"));
+    strUsage += HelpMessageOpt("-snapshothash=<hash>", _("Expected content hash of the -loadsnapshot file, obtained from a trusted source; overrides the hash built into the chain parameters"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-mempooltxinputlimit=<n>", _("[DEPRECATED FROM OVERWINTER] Set the maximum number of transparent inputs in a transaction that the mempool will accept (default: 0 = no limit applied)"));
+    strUsage += HelpMessageOpt("-maxmempool=<n>", _("Keep the resident memory of the transaction pool below <n> megabytes by storing the lowest fee-rate entries in serialized form (default: 0 = keep everything deserialized)"));
+    strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -(int)boost::thread::hardware_concurrency(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef _WIN32
@@ -415,8 +458,12 @@ std::string HelpMessage(HelpMessageMode mode)
 #endif
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
+    strUsage += HelpMessageOpt("-addressheightindex", strprintf(_("Additionally mirror the address index partitioned by height, so block-range queries over many addresses scan sequentially (default: %u)"), DEFAULT_ADDRESSHEIGHTINDEX));
+    strUsage += HelpMessageOpt("-blockfilterindex", strprintf(_("Maintain a compact Golomb-coded filter per block, served via the getblockfilter rpc call and getcfilter p2p message (default: %u)"), DEFAULT_BLOCKFILTERINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-tokenindex", strprintf(_("Maintain a token balance index, used by the tokenbalancebatch rpc call (default: %u)"), 0));
+    strUsage += HelpMessageOpt("-oracleindex", strprintf(_("Maintain a height-ordered oracle data index, used by the oraclessamples and oracleslatest rpc calls (default: %u)"), 0));
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
     strUsage += HelpMessageOpt("-asmap=<file>", strprintf("Specify asn mapping used for bucketing of the peers (default: %s). Relative paths will be prefixed by the net-specific datadir location.", DEFAULT_ASMAP_FILENAME));
@@ -434,6 +481,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), 5000));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), 1000));
+    strUsage += HelpMessageOpt("-bulksendrate=<n>", _("Limit bulk block serving to <n> MiB/s across all peers so headers, pings and tx relay are never starved by syncing peers (default: 0 = unlimited)"));
+    strUsage += HelpMessageOpt("-connectworkers=<n>", strprintf(_("Number of outbound connection attempts to run concurrently (default: %d, maximum: %d)"), DEFAULT_CONNECT_WORKERS, MAX_CONNECT_WORKERS));
+    strUsage += HelpMessageOpt("-msghandlerthreads=<n>", strprintf(_("Number of message handler threads; each serves a disjoint subset of peers (default: %d, maximum: %d)"), DEFAULT_MSGHANDLER_THREADS, MAX_MSGHANDLER_THREADS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), 1));
@@ -484,6 +534,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubblockpos=<address>", _("Enable publish block disk location (hash, height, file, offset) in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubrawtxbatch=<address>", _("Enable publish all transactions of a connected block as one message in <address>"));
+    strUsage += HelpMessageOpt("-zmqreplicationsource=<address>", _("Subscribe to an active node's rawblock/rawtx publishers at <address> and mirror its chainstate and mempool (hot standby)"));
 #endif
 
 #if ENABLE_PROTON
@@ -497,6 +550,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
     if (showDebug)
     {
+        strUsage += HelpMessageOpt("-assumenotarized", strprintf("Skip script verification for blocks below the last notarized height, which dPoW makes final (default: %u)", 1));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", 1));
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf("Flush database activity from memory pool to disk log every <n> megabytes (default: %u)", 100));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", 0));
@@ -520,10 +574,14 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", 15));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", 0));
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> entries (default: %u)", 50000));
+        strUsage += HelpMessageOpt("-sigcachesize=<n>", strprintf("Limit each of the %u signature cache shards to <n> entries (default: -maxsigcachesize / %u)", 16, 16));
+        strUsage += HelpMessageOpt("-coinsprefetchthreads=<n>", strprintf("Number of threads prefetching spent coins from the coin database while blocks wait for validation, 0 to disable (default: %u)", 2));
         strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying (default: %s)"),
         CURRENCY_UNIT, FormatMoney(::minRelayTxFee.GetFeePerK())));
+    strUsage += HelpMessageOpt("-lockstats", _("Collect per-call-site lock wait and hold times, readable via the getlockstats RPC (default: 0)"));
+    strUsage += HelpMessageOpt("-logasync", _("Write debug.log from a dedicated thread so logging never blocks the caller; messages are dropped (and counted) instead of queued without bound (default: 1)"));
     strUsage += HelpMessageOpt("-printtoconsole", _("Send trace/debug info to console instead of debug.log file"));
     if (showDebug)
     {
@@ -571,13 +629,21 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 7771, 17771));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpcreservedthreads=<n>", _("Set the number of additional RPC threads reserved for cheap status calls such as getinfo (default: 1)"));
+    strUsage += HelpMessageOpt("-prometheusmetrics", _("Serve per-method RPC call and latency metrics in Prometheus text format on /metrics of the RPC port, without authentication (default: 0)"));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
 
-    // Disabled until we can lock notes and also tune performance of the prover which by default uses multiple threads
-    //strUsage += HelpMessageOpt("-rpcasyncthreads=<n>", strprintf(_("Set the number of threads to service Async RPC calls (default: %d)"), 1));
+    strUsage += HelpMessageOpt("-rpcasyncthreads=<n>", strprintf(_("Set the number of threads to service Async RPC calls (default: %d)"), 1));
+
+    strUsage += HelpMessageGroup(_("Stratum server options:"));
+    strUsage += HelpMessageOpt("-stratum", _("Run a native stratum mining server that pushes jobs on tip change (default: 0)"));
+    strUsage += HelpMessageOpt("-stratumaddress=<addr>", _("Address paid by the coinbase of stratum work (required with -stratum)"));
+    strUsage += HelpMessageOpt("-stratumbind=<addr>", _("Bind the stratum server to the given address. Use [host]:port notation for IPv6. This option can be specified multiple times (default: loopback)"));
+    strUsage += HelpMessageOpt("-stratumport=<port>", strprintf(_("Listen for stratum connections on <port> (default: %d)"), DEFAULT_STRATUM_PORT));
+    strUsage += HelpMessageOpt("-stratumdiff=<n>", strprintf(_("Initial share difficulty for stratum connections (default: %d)"), DEFAULT_STRATUM_DIFF));
 
     if (mode == HMM_BITCOIND) {
         strUsage += HelpMessageGroup(_("Metrics Options (only if -daemon and -printtoconsole are not set):"));
@@ -669,6 +735,8 @@ void CleanupBlockRevFiles()
     }
     path komodostate = GetDataDir() / KOMODO_STATE_FILENAME;
     remove(komodostate);
+    remove(path(komodostate.string() + ".ind"));
+    remove(path(komodostate.string() + ".ckpt"));
     path minerids = GetDataDir() / "minerids";
     remove(minerids);
     // Remove all block files that aren't part of a contiguous set starting at
@@ -742,6 +810,13 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
         LogPrintf("Stopping after block import\n");
         StartShutdown();
     }
+
+    // Reload the saved mempool here, off the main startup path: each
+    // transaction goes back through AcceptToMemoryPool, so the node warms up
+    // relay in the background without delaying init
+    if (GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
+        LoadMempool();
+    }
 }
 
 void ThreadNotifyRecentlyAdded()
@@ -847,8 +922,6 @@ static void ZC_LoadParams(
         return;
     }
 
-    pzcashParams = ZCJoinSplit::Prepared();
-
     static_assert(
         sizeof(boost::filesystem::path::value_type) == sizeof(codeunit),
         "librustzcash not configured correctly");
@@ -878,6 +951,13 @@ static void ZC_LoadParams(
     LogPrintf("Loaded Sapling parameters in %fs seconds.\n", elapsed);
 }
 
+static std::once_flag zkParamsLoaded;
+
+void ZC_LoadParamsOnDemand()
+{
+    std::call_once(zkParamsLoaded, []() { ZC_LoadParams(Params()); });
+}
+
 bool AppInitServers(boost::thread_group& threadGroup)
 {
     RPCServer::OnStopped(&OnRPCStopped);
@@ -892,6 +972,12 @@ bool AppInitServers(boost::thread_group& threadGroup)
         return false;
     if (!StartHTTPServer())
         return false;
+    if (GetBoolArg("-stratum", false)) {
+        if (!InitStratumServer())
+            return false;
+        if (!StartStratumServer())
+            return false;
+    }
     return true;
 }
 
@@ -923,13 +1009,43 @@ bool AttemptDatabaseOpen(size_t nBlockTreeDBCache, bool dbCompression, size_t db
         delete pcoinscatcher;
         delete pblocktree;
         delete pnotarisations;
+        delete ptokensdb;
+        ptokensdb = nullptr;
+        delete poraclesdb;
+        poraclesdb = nullptr;
 
         pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
         pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
         pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
         pcoinsTip = new CCoinsViewCache(pcoinscatcher);
+        // ~300 bytes per cached coin entry; sizing the buckets up front avoids
+        // repeated rehashes of a multi-gigabyte map while the cache fills.
+        pcoinsTip->ReserveCoins(nCoinCacheUsage / 300);
         pnotarisations = new NotarisationDB(100*1024*1024, false, fReindex);
-
+        fTokenIndex = GetBoolArg("-tokenindex", false);
+        if (fTokenIndex)
+            ptokensdb = new TokensDB(16*1024*1024, false, fReindex);
+        fOracleIndex = GetBoolArg("-oracleindex", false);
+        if (fOracleIndex)
+            poraclesdb = new OraclesDB(16*1024*1024, false, fReindex);
+
+        // Bootstrap empty databases from a chainstate snapshot before the
+        // block index is loaded (see the dumpchainstate RPC).
+        if (!fReindex && mapArgs.count("-loadsnapshot") && pcoinsdbview->GetBestBlock().IsNull()) {
+            boost::filesystem::path pathSnapshot(GetArg("-loadsnapshot", ""));
+            if (!pathSnapshot.is_complete())
+                pathSnapshot = GetDataDir() / pathSnapshot;
+            uint256 hashExpected = Params().ChainstateSnapshotHash();
+            if (mapArgs.count("-snapshothash"))
+                hashExpected = uint256S(GetArg("-snapshothash", ""));
+            if (hashExpected.IsNull())
+                LogPrintf("Warning: no expected content hash for -loadsnapshot; pass -snapshothash=<hash> to verify the snapshot against a trusted source\n");
+            std::string strSnapshotError;
+            if (!LoadChainstateSnapshot(pathSnapshot, pcoinsdbview, pblocktree, hashExpected, strSnapshotError)) {
+                strLoadError = _("Error loading chainstate snapshot: ") + strSnapshotError;
+                return false;
+            }
+        }
 
         if (fReindex) {
             boost::filesystem::remove(GetDataDir() / KOMODO_STATE_FILENAME);
@@ -1100,6 +1216,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     fPrintToConsole = GetBoolArg("-printtoconsole", false);
     fLogTimestamps = GetBoolArg("-logtimestamps", true);
     fLogIPs = GetBoolArg("-logips", false);
+    fLockStats = GetBoolArg("-lockstats", false);
 
     LogPrintf("\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n");
     LogPrintf("Zcash version %s (%s)\n", FormatFullVersion(), CLIENT_DATE);
@@ -1171,6 +1288,25 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         LogPrintf("Using /16 prefix for IP bucketing\n");
     }
 
+    // A host running one daemon per asset chain pays for every cache and
+    // thread pool once per chain; -fleet trims each daemon's defaults so a
+    // fleet of mostly-idle chains fits in memory. Only defaults change:
+    // any option set explicitly still wins.
+    if (GetBoolArg("-fleet", false)) {
+        if (SoftSetArg("-dbcache", "32"))
+            LogPrintf("%s: parameter interaction: -fleet -> setting -dbcache=32\n", __func__);
+        if (SoftSetArg("-maxsigcachesize", "10000"))
+            LogPrintf("%s: parameter interaction: -fleet -> setting -maxsigcachesize=10000\n", __func__);
+        if (SoftSetArg("-par", "2"))
+            LogPrintf("%s: parameter interaction: -fleet -> setting -par=2\n", __func__);
+        if (SoftSetArg("-maxconnections", "16"))
+            LogPrintf("%s: parameter interaction: -fleet -> setting -maxconnections=16\n", __func__);
+        if (SoftSetArg("-maxmempool", "64"))
+            LogPrintf("%s: parameter interaction: -fleet -> setting -maxmempool=64\n", __func__);
+        if (SoftSetArg("-rpcthreads", "2"))
+            LogPrintf("%s: parameter interaction: -fleet -> setting -rpcthreads=2\n", __func__);
+    }
+
     if (GetBoolArg("-salvagewallet", false)) {
         // Rewrite just private keys: rescan to find transactions
         if (SoftSetBoolArg("-rescan", true))
@@ -1210,6 +1346,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 #endif
     }
 
+    // A snapshot-bootstrapped node has no historical block files, so it must
+    // run as a pruned node from the start.
+    if (mapArgs.count("-loadsnapshot") && !GetArg("-prune", 0))
+        return InitError(_("-loadsnapshot requires -prune, since a snapshot carries no historical block files."));
+
     // ********************************************************* Step 3: parameter-to-internal-flags
 
     fDebug = !mapMultiArgs["-debug"].empty();
@@ -1247,6 +1388,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", true);
+    fAssumeNotarized = GetBoolArg("-assumenotarized", true);
 
     // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
     nScriptCheckThreads = GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
@@ -1388,6 +1530,17 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
     }
 
+    if (mapArgs.count("-maxmempool")) {
+        int64_t nMaxMempool = GetArg("-maxmempool", 0);
+        if (nMaxMempool < 0) {
+            return InitError(_("Mempool memory budget cannot be negative"));
+        }
+        mempool.SetMaxMemoryUsage((size_t)nMaxMempool * 1000000);
+        if (nMaxMempool > 0) {
+            LogPrintf("Mempool configured to demote low fee-rate entries above %lld MB resident\n", nMaxMempool);
+        }
+    }
+
     if (!mapMultiArgs["-nuparams"].empty()) {
         // Allow overriding network upgrade parameters for testing
         if (Params().NetworkIDString() != "regtest") {
@@ -1465,8 +1618,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n");
     LogPrintf("Komodo version %s (%s)\n", FormatFullVersion(), CLIENT_DATE);
 
-    if (fPrintToDebugLog)
+    if (fPrintToDebugLog) {
         OpenDebugLog();
+        if (GetBoolArg("-logasync", true))
+            StartAsyncDebugLog();
+    }
     LogPrintf("Using OpenSSL version %s\n", SSLeay_version(SSLEAY_VERSION));
 #ifdef ENABLE_WALLET
     LogPrintf("Using BerkeleyDB version %s\n", DbEnv::version(0, 0, 0));
@@ -1485,9 +1641,17 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
 
+    int64_t nCoinsPrefetchThreads = GetArg("-coinsprefetchthreads", 2);
+    if (nCoinsPrefetchThreads > 0) {
+        LogPrintf("Using %d threads for coin database prefetch\n", (int)nCoinsPrefetchThreads);
+        for (int64_t i = 0; i < nCoinsPrefetchThreads; i++)
+            threadGroup.create_thread(&ThreadCoinsPrefetch);
+    }
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    ptaskScheduler = &scheduler;
 
     // Count uptime
     MarkStartTime();
@@ -1502,8 +1666,22 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     if ( KOMODO_NSPV_FULLNODE )
     {
-        // Initialize Zcash circuit parameters
-        ZC_LoadParams(chainparams);
+        // The JoinSplit object itself is cheap and several wallet paths only
+        // need it for h_sig, so it is always created here.
+        pzcashParams = ZCJoinSplit::Prepared();
+        if ( ASSETCHAINS_PUBLIC != 0 )
+        {
+            // Transparent-only asset chain: shielded transactions are
+            // consensus-forbidden from genesis, so the multi-hundred-MB
+            // zk-SNARK parameters are only loaded if a proving or
+            // verification path ever asks for them.
+            LogPrintf("Deferring zk-SNARK parameter load on -ac_public chain\n");
+        }
+        else
+        {
+            // Initialize Zcash circuit parameters
+            ZC_LoadParamsOnDemand();
+        }
     }
     /* Start the RPC server already.  It will be started in "warmup" mode
      * and not really process calls already (but it will signify connections
@@ -1521,21 +1699,23 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // ********************************************************* Step 5: verify wallet database integrity
 #ifdef ENABLE_WALLET
+    // The BDB verification pass only needs the wallet file, so run it in the
+    // background and overlap it with network initialization and the block
+    // index load; the result is collected right before the wallet itself is
+    // loaded in Step 8. Nothing touches the wallet database in between.
+    std::future<bool> walletVerified;
+    std::string walletWarningString;
+    std::string walletErrorString;
     if (!fDisableWallet) {
         LogPrintf("Using wallet %s\n", strWalletFile);
         uiInterface.InitMessage(_("Verifying wallet..."));
 
-        std::string warningString;
-        std::string errorString;
-
-        if (!CWallet::Verify(strWalletFile, warningString, errorString))
-            return false;
-
-        if (!warningString.empty())
-            InitWarning(warningString);
-        if (!errorString.empty())
-            return InitError(warningString);
-
+        walletVerified = std::async(std::launch::async, [&]() {
+            int64_t nVerifyStart = GetTimeMillis();
+            bool ret = CWallet::Verify(strWalletFile, walletWarningString, walletErrorString);
+            LogPrintf(" wallet verify %12dms (overlapped with block index load)\n", GetTimeMillis() - nVerifyStart);
+            return ret;
+        });
     } // (!fDisableWallet)
 #endif // ENABLE_WALLET
     // ********************************************************* Step 6: network initialization
@@ -1725,6 +1905,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
+    nCoinCacheUsageConfigured = nCoinCacheUsage; // upper bound for the dbcache governor
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Max cache setting possible %.1fMiB\n", nMaxDbCache);
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
@@ -1751,6 +1932,22 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             fprintf(stderr,"set spentindex, will reindex. could take a while.\n");
             fReindex = true;
         }
+        bool fAddressHeightIndex = GetBoolArg("-addressheightindex", DEFAULT_ADDRESSHEIGHTINDEX);
+        pblocktree->ReadFlag("addressheightindex", checkval);
+        if ( checkval != fAddressHeightIndex && fAddressHeightIndex != 0 )
+        {
+            pblocktree->WriteFlag("addressheightindex", fAddressHeightIndex);
+            fprintf(stderr,"set addressheightindex, will reindex. could take a while.\n");
+            fReindex = true;
+        }
+        bool fBlockFilterIndex = GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+        pblocktree->ReadFlag("blockfilterindex", checkval);
+        if ( checkval != fBlockFilterIndex && fBlockFilterIndex != 0 )
+        {
+            pblocktree->WriteFlag("blockfilterindex", fBlockFilterIndex);
+            fprintf(stderr,"set blockfilterindex, will reindex. could take a while.\n");
+            fReindex = true;
+        }
     }
 
     // ************
@@ -1824,6 +2021,15 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         LogPrintf("Wallet disabled!\n");
     } else {
 
+        // collect the verification result from Step 5 before opening the wallet
+        if (!walletVerified.get())
+            return false;
+
+        if (!walletWarningString.empty())
+            InitWarning(walletWarningString);
+        if (!walletErrorString.empty())
+            return InitError(walletWarningString);
+
         // needed to restore wallet transaction meta data after -zapwallettxes
         std::vector<CWalletTx> vWtx;
 
@@ -2010,6 +2216,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             nLocalServices |= NODE_ADDRINDEX;
         if ( GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) != 0 )
             nLocalServices |= NODE_SPENTINDEX;
+        nLocalServices |= NODE_COMPACT_BLOCKS;
         fprintf(stderr,"nLocalServices %llx %d, %d\n",(long long)nLocalServices,GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX),GetBoolArg("-spentindex", DEFAULT_SPENTINDEX));
     }
     // ********************************************************* Step 10: import blocks
@@ -2083,6 +2290,13 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     StartNode(threadGroup, scheduler);
 
+#if ENABLE_ZMQ
+    // hot-standby replication: mirror an active node's blocks and mempool
+    std::string zmqReplicationSource = GetArg("-zmqreplicationsource", "");
+    if (!zmqReplicationSource.empty())
+        StartZMQReplication(zmqReplicationSource, threadGroup);
+#endif
+
 #ifdef ENABLE_MINING
     // Generate coins in the background
  #ifdef ENABLE_WALLET
@@ -2103,8 +2317,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         // Add wallet transactions that aren't already in a block to mapTransactions
         pwalletMain->ReacceptWalletTransactions();
 
-        // Run a thread to flush wallet periodically
-        threadGroup.create_thread(boost::bind(&ThreadFlushWalletDB, boost::ref(pwalletMain->strWalletFile)));
+        // Flush the wallet periodically from the task scheduler
+        ScheduleWalletDBFlush(scheduler, pwalletMain->strWalletFile);
     }
 #endif
 
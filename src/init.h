@@ -35,6 +35,10 @@ class thread_group;
 
 extern CWallet* pwalletMain;
 extern ZCJoinSplit* pzcashParams;
+/** Task scheduler servicing periodic background work (wallet flush, addrman
+ *  dumps); valid between AppInit2 starting its thread and Shutdown. CC modules
+ *  may use it for timeout processing instead of spawning polling threads. */
+extern CScheduler* ptaskScheduler;
 
 void StartShutdown();
 bool ShutdownRequested();
@@ -50,6 +54,14 @@ void Shutdown();
  */
 bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler);
 
+/***
+ * Load the zk-SNARK parameters if they have not been loaded yet. On
+ * transparent-only asset chains (-ac_public) the load is deferred from
+ * startup to the first proving or verification request, which normally
+ * never comes; other chains load eagerly during AppInit2.
+ */
+void ZC_LoadParamsOnDemand();
+
 /** The help message mode determines what help message to show */
 enum HelpMessageMode {
     HMM_BITCOIND
@@ -34,6 +34,8 @@
 
 #include <stdio.h>
 
+#include <iostream>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/assign/list_of.hpp>
 
@@ -90,6 +92,7 @@ static int AppInitRawTx(int argc, char* argv[])
 
         strUsage = HelpMessageGroup(_("Options:"));
         strUsage += HelpMessageOpt("-?", _("This help message"));
+        strUsage += HelpMessageOpt("-batch", _("Read newline-delimited command sets from stdin, one transaction per line, and emit one result line each; initialization happens once for the whole stream"));
         strUsage += HelpMessageOpt("-create", _("Create new, empty TX."));
         strUsage += HelpMessageOpt("-json", _("Select JSON output"));
         strUsage += HelpMessageOpt("-txid", _("Output only the hex-encoded transaction id of the resultant transaction."));
@@ -581,11 +584,13 @@ public:
     }
 };
 
+// Started lazily on the first sign command and kept for the life of the
+// process, so batch mode pays for ECC_Start once rather than per line
+static boost::scoped_ptr<Secp256k1Init> ecc;
+
 static void MutateTx(CMutableTransaction& tx, const std::string& command,
                      const std::string& commandVal)
 {
-    boost::scoped_ptr<Secp256k1Init> ecc;
-
     if (command == "nversion")
         MutateTxVersion(tx, commandVal);
     else if (command == "locktime")
@@ -625,7 +630,8 @@ static void OutputTxJSON(const CTransaction& tx)
     UniValue entry(UniValue::VOBJ);
     TxToUniv(tx, uint256(), entry);
 
-    std::string jsonOutput = entry.write(4);
+    // batch mode keeps the one-line-per-transaction protocol intact
+    std::string jsonOutput = GetBoolArg("-batch", false) ? entry.write() : entry.write(4);
     fprintf(stdout, "%s\n", jsonOutput.c_str());
 }
 
@@ -742,6 +748,64 @@ static int CommandLineRawTx(int argc, char* argv[])
     return nRet;
 }
 
+static int CommandLineBatch()
+{
+    // Every stdin line is a complete command set: "-create" or a hex
+    // transaction first, then the usual command=value tokens separated by
+    // whitespace (register values therefore must not contain literal
+    // whitespace). Each input line produces exactly one output line — the
+    // transaction, or "error: ..." — so a driving process can pipeline
+    // requests and match replies by line without re-paying process startup,
+    // chain parameter selection and ECC initialization per transaction.
+    std::string line;
+    int nRet = EXIT_SUCCESS;
+    while (std::getline(std::cin, line)) {
+        boost::algorithm::trim(line);
+        try {
+            if (line.empty())
+                throw std::runtime_error("empty command set");
+
+            std::vector<std::string> args;
+            boost::split(args, line, boost::algorithm::is_any_of(" \t"), boost::algorithm::token_compress_on);
+
+            // registers are per-transaction state
+            registers.clear();
+
+            size_t startArg = 1;
+            CTransaction txDecodeTmp;
+            if (args[0] != "-create") {
+                if (!DecodeHexTx(txDecodeTmp, args[0]))
+                    throw std::runtime_error("invalid transaction encoding");
+            }
+
+            CMutableTransaction tx(txDecodeTmp);
+            for (size_t i = startArg; i < args.size(); i++) {
+                std::string key, value;
+                size_t eqpos = args[i].find('=');
+                if (eqpos == std::string::npos)
+                    key = args[i];
+                else {
+                    key = args[i].substr(0, eqpos);
+                    value = args[i].substr(eqpos + 1);
+                }
+
+                MutateTx(tx, key, value);
+            }
+
+            OutputTx(tx);
+        }
+        catch (const boost::thread_interrupted&) {
+            throw;
+        }
+        catch (const std::exception& e) {
+            fprintf(stdout, "error: %s\n", e.what());
+            nRet = EXIT_FAILURE;
+        }
+        fflush(stdout);
+    }
+    return nRet;
+}
+
 int main(int argc, char* argv[])
 {
     SetupEnvironment();
@@ -761,7 +825,10 @@ int main(int argc, char* argv[])
 
     int ret = EXIT_FAILURE;
     try {
-        ret = CommandLineRawTx(argc, argv);
+        if (GetBoolArg("-batch", false))
+            ret = CommandLineBatch();
+        else
+            ret = CommandLineRawTx(argc, argv);
     }
     catch (const std::exception& e) {
         PrintExceptionContinue(&e, "CommandLineRawTx()");
@@ -21,6 +21,9 @@
 #include "mem_read.h"
 #include "notaries_staked.h"
 
+#include <deque>
+#include <map>
+
 static FILE *fp; // for stateupdate
 //int32_t KOMODO_EXTERNAL_NOTARIES = 0; //todo remove
 #include "komodo_gateway.h"
@@ -380,8 +383,8 @@ int32_t komodo_voutupdate(bool fJustCheck,int32_t *isratificationp,int32_t notar
         int32_t *specialtxp,int32_t *notarizedheightp,uint64_t value,int32_t notarized,
         uint64_t signedmask,uint32_t timestamp)
 {
-    static uint256 zero; static FILE *signedfp;
-    int32_t opretlen,nid,offset,k,MoMdepth,matched,len = 0; uint256 MoM,srchash,desttxid; uint8_t crypto777[33]; struct komodo_state *sp; char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN];
+    static uint256 zero; static FILE *signedfp; static uint8_t crypto777[33];
+    int32_t opretlen,nid,offset,k,MoMdepth,matched,len = 0; uint256 MoM,srchash,desttxid; struct komodo_state *sp; char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN];
     if ( (sp= komodo_stateptr(symbol,dest)) == 0 )
         return(-1);
     if ( scriptlen == 35 && scriptbuf[0] == 33 && scriptbuf[34] == 0xac )
@@ -392,7 +395,8 @@ int32_t komodo_voutupdate(bool fJustCheck,int32_t *isratificationp,int32_t notar
             prevKOMODO_LASTMINED = KOMODO_LASTMINED;
             KOMODO_LASTMINED = height;
         }
-        decode_hex(crypto777,33,CRYPTO777_PUBSECPSTR);
+        if ( crypto777[0] == 0 ) // a compressed pubkey never starts with 0, decode once
+            decode_hex(crypto777,33,CRYPTO777_PUBSECPSTR);
         /*for (k=0; k<33; k++)
             printf("%02x",crypto777[k]);
         printf(" crypto777 ");
@@ -679,6 +683,16 @@ static int32_t hwmheight;
 void adjust_hwmheight(int32_t newHeight) { hwmheight = newHeight; }
 void clear_fp_stateupdate() { fp = nullptr; } // tests should clear fp, before new call(s) to komodo_stateupdate if datadir is changed
 
+// Cache of the notary signedmask per candidate notarization tx. The vin scan
+// in komodo_connectblock resolves every input's scriptPubKey via
+// GetTransaction, and the same tx is scanned by both CheckBlock (fJustCheck)
+// and ConnectBlock; entries are only reused at the height they were computed
+// for, so era boundaries and reorgs recompute.
+#define SIGNEDMASK_CACHE_SIZE 4096
+static CCriticalSection cs_signedmaskCache;
+static std::map<uint256,std::pair<int32_t,uint64_t>> mapSignedMaskCache; // txid -> {height, signedmask}
+static std::deque<uint256> signedmaskCacheOrder;
+
 int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block)
 {
     int32_t staked_era; static int32_t lastStakedEra;
@@ -751,22 +765,52 @@ int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block)
             voutmask = specialtx = notarizedheight = isratification = notarized = 0;
             signedmask = (height < 91400) ? 1 : 0;
             numvins = block.vtx[i].vin.size();
-            for (j=0; j<numvins; j++)
+            bool maskCached = false;
+            if ( i > 0 ) // the coinbase skips its own vin0, keep it out of the cache
+            {
+                LOCK(cs_signedmaskCache);
+                auto it = mapSignedMaskCache.find(txhash);
+                if ( it != mapSignedMaskCache.end() && it->second.first == height )
+                {
+                    signedmask = it->second.second;
+                    maskCached = true;
+                }
+            }
+            if ( !maskCached )
             {
-                if ( i == 0 && j == 0 )
-                    continue;
-                if ( (scriptlen= gettxout_scriptPubKey(scriptPubKey,sizeof(scriptPubKey),block.vtx[i].vin[j].prevout.hash,block.vtx[i].vin[j].prevout.n)) > 0 )
+                for (j=0; j<numvins; j++)
                 {
-                    if ( (k= komodo_notarycmp(scriptPubKey,scriptlen,pubkeys,numnotaries,rmd160)) >= 0 )
-                        signedmask |= (1LL << k);
-                    else if ( 0 && numvins >= 17 )
+                    if ( i == 0 && j == 0 )
+                        continue;
+                    if ( (scriptlen= gettxout_scriptPubKey(scriptPubKey,sizeof(scriptPubKey),block.vtx[i].vin[j].prevout.hash,block.vtx[i].vin[j].prevout.n)) > 0 )
                     {
-                        int32_t k;
-                        for (k=0; k<scriptlen; k++)
-                            printf("%02x",scriptPubKey[k]);
-                        printf(" scriptPubKey doesnt match any notary vini.%d of %d\n",j,numvins);
+                        if ( (k= komodo_notarycmp(scriptPubKey,scriptlen,pubkeys,numnotaries,rmd160)) >= 0 )
+                            signedmask |= (1LL << k);
+                        else if ( 0 && numvins >= 17 )
+                        {
+                            int32_t k;
+                            for (k=0; k<scriptlen; k++)
+                                printf("%02x",scriptPubKey[k]);
+                            printf(" scriptPubKey doesnt match any notary vini.%d of %d\n",j,numvins);
+                        }
+                    } //else printf("cant get scriptPubKey for ht.%d txi.%d vin.%d\n",height,i,j);
+                }
+                if ( i > 0 )
+                {
+                    LOCK(cs_signedmaskCache);
+                    auto ins = mapSignedMaskCache.insert(std::make_pair(txhash,std::make_pair(height,signedmask)));
+                    if ( ins.second )
+                    {
+                        signedmaskCacheOrder.push_back(txhash);
+                        if ( signedmaskCacheOrder.size() > SIGNEDMASK_CACHE_SIZE )
+                        {
+                            mapSignedMaskCache.erase(signedmaskCacheOrder.front());
+                            signedmaskCacheOrder.pop_front();
+                        }
                     }
-                } //else printf("cant get scriptPubKey for ht.%d txi.%d vin.%d\n",height,i,j);
+                    else
+                        ins.first->second = std::make_pair(height,signedmask); // same tx reconnected at a new height
+                }
             }
             numvalid = bitweight(signedmask);
             if ( ((height < 90000 || (signedmask & 1) != 0) && numvalid >= KOMODO_MINRATIFY) 
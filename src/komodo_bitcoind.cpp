@@ -20,6 +20,10 @@
 #include "komodo.h"
 #include "rpc/net.h"
 #include "init.h"
+#include "sync.h"
+
+#include <map>
+#include <string>
 
 
 /************************************************************************
@@ -169,8 +173,14 @@ char *bitcoind_RPC(char **retstrp,char *debugstr,char *url,char *userpass,char *
 try_again:
     if ( retstrp != 0 )
         *retstrp = 0;
+    // One keep-alive handle per thread: libcurl holds the connection to the
+    // local daemon open across calls, so repeat queries skip the TCP (and for
+    // https, TLS) setup instead of reconnecting per request.
+    static thread_local CURL *curl_handle_tl;
     starttime = OS_milliseconds();
-    curl_handle = curl_easy_init();
+    if ( (curl_handle= curl_handle_tl) == 0 )
+        curl_handle_tl = curl_handle = curl_easy_init();
+    else curl_easy_reset(curl_handle);
     init_string(&s);
     headers = curl_slist_append(0,"Expect:");
 
@@ -222,7 +232,12 @@ try_again:
     //laststart = milliseconds();
     res = curl_easy_perform(curl_handle);
     curl_slist_free_all(headers);
-    curl_easy_cleanup(curl_handle);
+    if ( res != CURLE_OK )
+    {
+        // drop the pooled handle so any retry opens a fresh connection
+        curl_easy_cleanup(curl_handle);
+        curl_handle_tl = 0;
+    }
     if ( databuf != 0 ) // clean up temporary buffer
     {
         free(databuf);
@@ -344,17 +359,56 @@ char *curl_post(CURL **cHandlep,char *url,char *userpass,char *postfields,char *
     return(chunk.memory);
 }
 
+/**
+ * Short-TTL cache of cross-chain RPC responses. The notarization checks issue
+ * the same getrawtransaction/getinfo queries against the KMD (or dest) daemon
+ * from several validation paths in quick succession; replaying the response
+ * saves a full local HTTP round trip per duplicate. Only successful responses
+ * are kept, and only for methods whose answers are stable over a few seconds.
+ */
+#define ISSUEMETHOD_CACHE_TTL 10
+#define ISSUEMETHOD_CACHE_MAX 64
+
+static CCriticalSection cs_issuemethodCache;
+static std::map<std::string,std::pair<int64_t,std::string> > mapIssuemethodCache;
+
+static int32_t issuemethod_cacheable(char *method)
+{
+    return(strcmp(method,"getrawtransaction") == 0 || strcmp(method,"getinfo") == 0 || strcmp(method,"getblockchaininfo") == 0);
+}
+
 char *komodo_issuemethod(char *userpass,char *method,char *params,uint16_t port)
 {
     //static void *cHandle;
-    char url[512],*retstr=0,*retstr2=0,postdata[8192];
+    char url[512],keybuf[16],*retstr=0,*retstr2=0,postdata[8192]; std::string key; int32_t cacheable;
     if ( params == 0 || params[0] == 0 )
         params = (char *)"[]";
     if ( strlen(params) < sizeof(postdata)-128 )
     {
+        cacheable = issuemethod_cacheable(method);
+        if ( cacheable != 0 )
+        {
+            sprintf(keybuf,"%u:",port);
+            key = std::string(keybuf) + method + ":" + params;
+            LOCK(cs_issuemethodCache);
+            std::map<std::string,std::pair<int64_t,std::string> >::iterator it = mapIssuemethodCache.find(key);
+            if ( it != mapIssuemethodCache.end() )
+            {
+                if ( GetTime() - it->second.first < ISSUEMETHOD_CACHE_TTL )
+                    return(strdup(it->second.second.c_str()));
+                mapIssuemethodCache.erase(it);
+            }
+        }
         sprintf(url,(char *)"http://127.0.0.1:%u",port);
         sprintf(postdata,"{\"method\":\"%s\",\"params\":%s}",method,params);
         retstr2 = bitcoind_RPC(&retstr,(char *)"debug",url,userpass,method,params);
+        if ( cacheable != 0 && retstr2 != 0 && strstr(retstr2,"\"error\":null") != 0 )
+        {
+            LOCK(cs_issuemethodCache);
+            if ( mapIssuemethodCache.size() >= ISSUEMETHOD_CACHE_MAX )
+                mapIssuemethodCache.clear();
+            mapIssuemethodCache[key] = std::make_pair(GetTime(),std::string(retstr2));
+        }
     }
     return(retstr2);
 }
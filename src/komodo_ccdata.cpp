@@ -18,12 +18,34 @@
 #include "komodo_extern_globals.h"
 #include "komodo_utils.h"
 
+#include <map>
+#include <mutex>
+#include <vector>
+
 struct komodo_ccdata *CC_data;
 //int32_t CC_firstheight;
-pthread_mutex_t KOMODO_CC_mutex; 
+pthread_mutex_t KOMODO_CC_mutex;
 
 //uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves, std::vector<uint256> &vMerkleTree);
 
+/***
+ * Memoized merkle work for the cross-chain RPCs. The same (height, depth)
+ * and (starti, endi) ranges are requested over and over by migration
+ * tooling, and the underlying headers and CC_data entries only change for
+ * a committed range when the chain reorgs past it, so komodo_purge_ccdata
+ * is the sole invalidation point.
+ */
+struct komodo_MoMoM_cached
+{
+    uint256 MoMoM;
+    std::vector<komodo_ccdata_entry> entries;
+};
+static std::mutex MoM_cache_mutex;
+static std::map<std::pair<int32_t,int32_t>,uint256> MoM_cache; // (height, MoMdepth) -> MoM
+static std::map<std::pair<int32_t,int32_t>,komodo_MoMoM_cached> MoMoM_cache; // (kmdstarti, kmdendi)
+static const size_t MOM_CACHE_MAXSIZE = 8192;
+static const size_t MOMOM_CACHE_MAXSIZE = 512;
+
 uint256 komodo_calcMoM(int32_t height,int32_t MoMdepth)
 {
     static uint256 zero; CBlockIndex *pindex; int32_t i; std::vector<uint256> tree, leaves;
@@ -31,6 +53,12 @@ uint256 komodo_calcMoM(int32_t height,int32_t MoMdepth)
     MoMdepth &= 0xffff;  // In case it includes the ccid
     if ( MoMdepth >= height )
         return(zero);
+    {
+        std::lock_guard<std::mutex> lock(MoM_cache_mutex);
+        auto it = MoM_cache.find(std::make_pair(height,MoMdepth));
+        if ( it != MoM_cache.end() )
+            return(it->second);
+    }
     for (i=0; i<MoMdepth; i++)
     {
         if ( (pindex= komodo_chainactive(height - i)) != 0 )
@@ -38,7 +66,14 @@ uint256 komodo_calcMoM(int32_t height,int32_t MoMdepth)
         else
             return(zero);
     }
-    return BuildMerkleTree(&fMutated, leaves, tree);
+    uint256 MoM = BuildMerkleTree(&fMutated, leaves, tree);
+    {
+        std::lock_guard<std::mutex> lock(MoM_cache_mutex);
+        if ( MoM_cache.size() >= MOM_CACHE_MAXSIZE )
+            MoM_cache.clear();
+        MoM_cache[std::make_pair(height,MoMdepth)] = MoM;
+    }
+    return MoM;
 }
 
 struct komodo_ccdata_entry *komodo_allMoMs(int32_t *nump,uint256 *MoMoMp,int32_t kmdstarti,int32_t kmdendi)
@@ -46,6 +81,19 @@ struct komodo_ccdata_entry *komodo_allMoMs(int32_t *nump,uint256 *MoMoMp,int32_t
     struct komodo_ccdata_entry *allMoMs=0; struct komodo_ccdata *ccdata,*tmpptr; int32_t i,num,max;
     bool fMutated; std::vector<uint256> tree, leaves;
     num = max = 0;
+    {
+        std::lock_guard<std::mutex> lock(MoM_cache_mutex);
+        auto it = MoMoM_cache.find(std::make_pair(kmdstarti,kmdendi));
+        if ( it != MoMoM_cache.end() )
+        {
+            // serve the memoized range; callers free() the array they get back
+            *nump = (int32_t)it->second.entries.size();
+            *MoMoMp = it->second.MoMoM;
+            allMoMs = (struct komodo_ccdata_entry *)malloc(it->second.entries.size() * sizeof(*allMoMs));
+            memcpy(allMoMs,it->second.entries.data(),it->second.entries.size() * sizeof(*allMoMs));
+            return(allMoMs);
+        }
+    }
     portable_mutex_lock(&KOMODO_CC_mutex);
     DL_FOREACH_SAFE(CC_data,ccdata,tmpptr)
     {
@@ -72,6 +120,14 @@ struct komodo_ccdata_entry *komodo_allMoMs(int32_t *nump,uint256 *MoMoMp,int32_t
         for (i=0; i<num; i++)
             leaves.push_back(allMoMs[i].MoM);
         *MoMoMp = BuildMerkleTree(&fMutated, leaves, tree);
+        {
+            std::lock_guard<std::mutex> lock(MoM_cache_mutex);
+            if ( MoMoM_cache.size() >= MOMOM_CACHE_MAXSIZE )
+                MoMoM_cache.clear();
+            komodo_MoMoM_cached &cached = MoMoM_cache[std::make_pair(kmdstarti,kmdendi)];
+            cached.MoMoM = *MoMoMp;
+            cached.entries.assign(allMoMs,allMoMs+num);
+        }
     }
     else
     {
@@ -182,6 +238,17 @@ int32_t komodo_MoMoMdata(char *hexstr,int32_t hexsize,struct komodo_ccdataMoMoM
 void komodo_purge_ccdata(int32_t height)
 {
     struct komodo_ccdata *ccdata,*tmpptr;
+    {
+        // drop memoized merkle work whose range the reorg reaches into
+        std::lock_guard<std::mutex> lock(MoM_cache_mutex);
+        MoM_cache.erase(MoM_cache.lower_bound(std::make_pair(height,0)),MoM_cache.end());
+        for (auto it = MoMoM_cache.begin(); it != MoMoM_cache.end(); )
+        {
+            if ( it->first.second >= height )
+                it = MoMoM_cache.erase(it);
+            else ++it;
+        }
+    }
     if ( chainName.isKMD() )
     {
         portable_mutex_lock(&KOMODO_CC_mutex);
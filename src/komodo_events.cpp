@@ -18,6 +18,12 @@
 #include "komodo_notary.h" // komodo_notarized_update
 #include "komodo_kv.h"
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
 #define KOMODO_EVENT_RATIFY 'P'
 #define KOMODO_EVENT_NOTARIZED 'N'
 #define KOMODO_EVENT_KMDHEIGHT 'K'
@@ -25,6 +31,111 @@
 #define KOMODO_EVENT_PRICEFEED 'V'
 #define KOMODO_EVENT_OPRETURN 'R'
 
+namespace {
+
+/*****
+ * One worker stream of the parallel replay mode. Jobs are applied in the
+ * order they were pushed; drain() blocks until everything pushed so far
+ * (queued or in flight) has been applied.
+ */
+class event_replay_worker
+{
+public:
+    void start()
+    {
+        fStop = false;
+        nPending = 0;
+        thread = std::thread(&event_replay_worker::run, this);
+    }
+    void push(std::function<void()> job)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+        nPending++;
+        cond.notify_all();
+    }
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return nPending == 0; });
+    }
+    void stop()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            fStop = true;
+            cond.notify_all();
+        }
+        if (thread.joinable())
+            thread.join();
+    }
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            cond.wait(lock, [this] { return !jobs.empty() || fStop; });
+            if (jobs.empty())
+            {
+                if (fStop)
+                    return;
+                continue;
+            }
+            std::function<void()> job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            job();
+            lock.lock();
+            nPending--;
+            cond.notify_all();
+        }
+    }
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::function<void()>> jobs;
+    size_t nPending = 0;
+    bool fStop = false;
+};
+
+bool fEventReplayActive = false;
+event_replay_worker notary_stream;     // 'P' pubkey events -> komodo_notarysinit
+event_replay_worker checkpoint_stream; // 'N'/'M' events -> komodo_notarized_update
+
+} // namespace
+
+void komodo_event_replay_start()
+{
+    if ( !fEventReplayActive )
+    {
+        notary_stream.start();
+        checkpoint_stream.start();
+        fEventReplayActive = true;
+    }
+}
+
+void komodo_event_replay_barrier()
+{
+    if ( fEventReplayActive )
+    {
+        notary_stream.drain();
+        checkpoint_stream.drain();
+    }
+}
+
+void komodo_event_replay_finish()
+{
+    if ( fEventReplayActive )
+    {
+        notary_stream.drain();
+        checkpoint_stream.drain();
+        notary_stream.stop();
+        checkpoint_stream.stop();
+        fEventReplayActive = false;
+    }
+}
+
 /*****
  * Add a notarized event to the collection
  * @param sp the state to add to
@@ -52,7 +163,15 @@ void komodo_eventadd_notarized( komodo_state *sp, const char *symbol, int32_t he
         if (sp != nullptr)
         {
             sp->add_event(symbol, height, ntz);
-            komodo_notarized_update(sp, height, ntz.notarizedheight, ntz.blockhash, ntz.desttxid, ntz.MoM, ntz.MoMdepth);
+            if ( fEventReplayActive )
+            {
+                komodo::event_notarized copy = ntz;
+                checkpoint_stream.push([sp, height, copy] {
+                    komodo_notarized_update(sp, height, copy.notarizedheight, copy.blockhash, copy.desttxid, copy.MoM, copy.MoMdepth);
+                });
+            }
+            else
+                komodo_notarized_update(sp, height, ntz.notarizedheight, ntz.blockhash, ntz.desttxid, ntz.MoM, ntz.MoMdepth);
         } else {
             LogPrintf("could not update notarisation event: komodo_state is null");
         }
@@ -73,13 +192,23 @@ void komodo_eventadd_pubkeys(komodo_state *sp, const char *symbol, int32_t heigh
     if (sp != nullptr)
     {
         sp->add_event(symbol, height, pk);
-        komodo_notarysinit(height, pk.pubkeys, pk.num);
+        if ( fEventReplayActive )
+        {
+            komodo::event_pubkeys copy = pk;
+            notary_stream.push([height, copy]() mutable {
+                komodo_notarysinit(height, copy.pubkeys, copy.num);
+            });
+        }
+        else
+            komodo_notarysinit(height, pk.pubkeys, pk.num);
     }
 }
 
 /********
  * Add a pricefeed event to the collection
- * @note was for PAX, deprecated
+ * @note was for PAX, deprecated; the price table (PVALS) and lookup side
+ *       (komodo_paxprice) were removed with the rest of PAX, so the event
+ *       is only retained in the list for statefile replay and rewind
  * @param sp where to add
  * @param symbol
  * @param height
@@ -187,6 +316,7 @@ void komodo_eventadd_kmdheight(struct komodo_state *sp, const char *symbol,int32
         }
         else // rewinding
         {
+            komodo_event_replay_barrier(); // let the worker streams catch up before undoing
             komodo::event_rewind e(height);
             sp->add_event(symbol, height, e);
             komodo_event_rewind(sp,symbol,height);
@@ -29,3 +29,18 @@ void komodo_eventadd_kmdheight(komodo_state *sp, const char *symbol,int32_t heig
 void komodo_event_rewind(komodo_state *sp, const char *symbol,int32_t height);
 
 void komodo_setkmdheight(komodo_state *sp,int32_t kmdheight,uint32_t timestamp);
+
+/*****
+ * Parallel replay mode for statefile initialization. While active, the
+ * notary pubkey and notarization side effects of the event handlers are
+ * applied on per-type worker threads (they touch disjoint structures),
+ * while the ordered event list is still maintained on the calling thread.
+ * Rewind events drain both streams first, acting as a height barrier.
+ */
+void komodo_event_replay_start();
+
+// wait until both worker streams have applied everything queued so far
+void komodo_event_replay_barrier();
+
+// drain the worker streams and leave parallel replay mode
+void komodo_event_replay_finish();
@@ -17,6 +17,16 @@
 #include "komodo_utils.h" // komodo_stateptrget
 #include "komodo_bitcoind.h" // komodo_checkcommission
 #include "komodo_notary.h"
+#include "komodo_events.h"
+#include "mem_read.h"
+#include "crypto/sha256.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 const char *banned_txids[] =
 {
@@ -439,6 +449,289 @@ long komodo_indfile_update(FILE *indfp,uint32_t *prevpos100p,long lastfpos,long
     return newfpos;
 }
 
+/***
+ * @brief map the komodostate file into memory read-only
+ * @param[in] fname the filename
+ * @param[out] lenp the file length
+ * @param[out] fmappedp nonzero if the pointer came from mmap rather than malloc
+ * @return pointer to the file bytes, or nullptr
+ */
+static uint8_t *komodo_mapstatefile(const char *fname,long *lenp,int32_t *fmappedp)
+{
+    *lenp = 0;
+    *fmappedp = 0;
+#ifndef _WIN32
+    int fd = open(fname,O_RDONLY);
+    if ( fd >= 0 )
+    {
+        struct stat sb;
+        if ( fstat(fd,&sb) == 0 && sb.st_size > 0 )
+        {
+            void *ptr = mmap(NULL,sb.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+            close(fd);
+            if ( ptr != MAP_FAILED )
+            {
+                *lenp = (long)sb.st_size;
+                *fmappedp = 1;
+                return (uint8_t *)ptr;
+            }
+        }
+        else
+            close(fd);
+    }
+#endif
+    return OS_fileptr(lenp,fname);
+}
+
+static void komodo_unmapstatefile(uint8_t *filedata,long datalen,int32_t fmapped)
+{
+    if ( filedata == nullptr )
+        return;
+#ifndef _WIN32
+    if ( fmapped != 0 )
+    {
+        munmap(filedata,datalen);
+        return;
+    }
+#endif
+    free(filedata);
+}
+
+static const uint8_t KOMODO_CKPT_MAGIC[8] = { 'K','M','D','c','k','p','t',0 };
+static const uint32_t KOMODO_CKPT_VERSION = 1;
+
+static void komodo_ckpt_writenpoint(FILE *fp,const notarized_checkpoint &np)
+{
+    fwrite(np.notarized_hash.begin(),1,32,fp);
+    fwrite(np.notarized_desttxid.begin(),1,32,fp);
+    fwrite(np.MoM.begin(),1,32,fp);
+    fwrite(np.MoMoM.begin(),1,32,fp);
+    fwrite(&np.nHeight,1,sizeof(np.nHeight),fp);
+    fwrite(&np.notarized_height,1,sizeof(np.notarized_height),fp);
+    fwrite(&np.MoMdepth,1,sizeof(np.MoMdepth),fp);
+    fwrite(&np.MoMoMdepth,1,sizeof(np.MoMoMdepth),fp);
+    fwrite(&np.MoMoMoffset,1,sizeof(np.MoMoMoffset),fp);
+    fwrite(&np.kmdstarti,1,sizeof(np.kmdstarti),fp);
+    fwrite(&np.kmdendi,1,sizeof(np.kmdendi),fp);
+}
+
+static bool komodo_ckpt_readnpoint(FILE *fp,notarized_checkpoint &np)
+{
+    if ( fread(np.notarized_hash.begin(),1,32,fp) != 32 ||
+         fread(np.notarized_desttxid.begin(),1,32,fp) != 32 ||
+         fread(np.MoM.begin(),1,32,fp) != 32 ||
+         fread(np.MoMoM.begin(),1,32,fp) != 32 ||
+         fread(&np.nHeight,1,sizeof(np.nHeight),fp) != sizeof(np.nHeight) ||
+         fread(&np.notarized_height,1,sizeof(np.notarized_height),fp) != sizeof(np.notarized_height) ||
+         fread(&np.MoMdepth,1,sizeof(np.MoMdepth),fp) != sizeof(np.MoMdepth) ||
+         fread(&np.MoMoMdepth,1,sizeof(np.MoMoMdepth),fp) != sizeof(np.MoMoMdepth) ||
+         fread(&np.MoMoMoffset,1,sizeof(np.MoMoMoffset),fp) != sizeof(np.MoMoMoffset) ||
+         fread(&np.kmdstarti,1,sizeof(np.kmdstarti),fp) != sizeof(np.kmdstarti) ||
+         fread(&np.kmdendi,1,sizeof(np.kmdendi),fp) != sizeof(np.kmdendi) )
+        return false;
+    return true;
+}
+
+/***
+ * @brief write a versioned checkpoint snapshot of the replayed KMD state
+ *
+ * The snapshot covers the statefile prefix [0, coveredlen): the scalar fields
+ * and notarization checkpoints of sp, plus the offsets of the notary pubkey
+ * ('P') records inside the prefix so their side effects can be re-applied on
+ * load. A SHA256 of the covered prefix binds the snapshot to the (append-only)
+ * statefile contents.
+ *
+ * @param sp the replayed state
+ * @param ckptfname the checkpoint filename
+ * @param filedata the statefile bytes
+ * @param coveredlen how much of the statefile the snapshot covers
+ * @param pubkeypos offsets of 'P' records within the covered prefix
+ * @return true on success
+ */
+static bool komodo_checkpoint_write(const komodo_state *sp,const std::string &ckptfname,
+        const uint8_t *filedata,long coveredlen,const std::vector<uint64_t> &pubkeypos)
+{
+    FILE *fp = fopen(ckptfname.c_str(),"wb");
+    if ( fp == nullptr )
+        return false;
+    fwrite(KOMODO_CKPT_MAGIC,1,sizeof(KOMODO_CKPT_MAGIC),fp);
+    fwrite(&KOMODO_CKPT_VERSION,1,sizeof(KOMODO_CKPT_VERSION),fp);
+    uint64_t covered = (uint64_t)coveredlen;
+    fwrite(&covered,1,sizeof(covered),fp);
+    uint8_t prefixhash[32];
+    CSHA256().Write(filedata,coveredlen).Finalize(prefixhash);
+    fwrite(prefixhash,1,sizeof(prefixhash),fp);
+    fwrite(&sp->SAVEDHEIGHT,1,sizeof(sp->SAVEDHEIGHT),fp);
+    fwrite(&sp->CURRENT_HEIGHT,1,sizeof(sp->CURRENT_HEIGHT),fp);
+    fwrite(&sp->SAVEDTIMESTAMP,1,sizeof(sp->SAVEDTIMESTAMP),fp);
+    fwrite(&sp->deposited,1,sizeof(sp->deposited),fp);
+    fwrite(&sp->issued,1,sizeof(sp->issued),fp);
+    fwrite(&sp->withdrawn,1,sizeof(sp->withdrawn),fp);
+    fwrite(&sp->approved,1,sizeof(sp->approved),fp);
+    fwrite(&sp->redeemed,1,sizeof(sp->redeemed),fp);
+    fwrite(&sp->shorted,1,sizeof(sp->shorted),fp);
+    notarized_checkpoint last;
+    last.notarized_hash = sp->LastNotarizedHash();
+    last.notarized_desttxid = sp->LastNotarizedDestTxId();
+    last.MoM = sp->LastNotarizedMoM();
+    last.notarized_height = sp->LastNotarizedHeight();
+    last.MoMdepth = sp->LastNotarizedMoMDepth();
+    komodo_ckpt_writenpoint(fp,last);
+    uint64_t n = sp->Checkpoints().size();
+    fwrite(&n,1,sizeof(n),fp);
+    for (const notarized_checkpoint &np : sp->Checkpoints())
+        komodo_ckpt_writenpoint(fp,np);
+    uint64_t npubkeys = pubkeypos.size();
+    fwrite(&npubkeys,1,sizeof(npubkeys),fp);
+    for (uint64_t pos : pubkeypos)
+        fwrite(&pos,1,sizeof(pos),fp);
+    bool fOk = (ferror(fp) == 0);
+    fclose(fp);
+    return fOk;
+}
+
+/***
+ * @brief restore state from a checkpoint snapshot, if one matches the statefile
+ *
+ * Everything is read and validated (including the prefix hash and the pubkey
+ * records) before sp or any global notary state is touched, so a stale or
+ * corrupt snapshot leaves the caller free to do a full replay instead.
+ *
+ * @param sp the state to restore into
+ * @param ckptfname the checkpoint filename
+ * @param filedata the statefile bytes
+ * @param datalen the statefile length
+ * @param symbol the chain symbol
+ * @param dest the "parent" chain
+ * @param[out] pubkeypos offsets of 'P' records within the covered prefix
+ * @return the statefile offset to resume replay from, or -1
+ */
+static long komodo_checkpoint_load(komodo_state *sp,const std::string &ckptfname,
+        uint8_t *filedata,long datalen,const char *symbol,const char *dest,
+        std::vector<uint64_t> &pubkeypos)
+{
+    FILE *fp = fopen(ckptfname.c_str(),"rb");
+    if ( fp == nullptr )
+        return -1;
+    uint8_t magic[8];
+    uint32_t version = 0;
+    uint64_t covered = 0;
+    uint8_t storedhash[32];
+    if ( fread(magic,1,sizeof(magic),fp) != sizeof(magic) ||
+         memcmp(magic,KOMODO_CKPT_MAGIC,sizeof(magic)) != 0 ||
+         fread(&version,1,sizeof(version),fp) != sizeof(version) ||
+         version != KOMODO_CKPT_VERSION ||
+         fread(&covered,1,sizeof(covered),fp) != sizeof(covered) ||
+         covered > (uint64_t)datalen ||
+         fread(storedhash,1,sizeof(storedhash),fp) != sizeof(storedhash) )
+    {
+        fclose(fp);
+        return -1;
+    }
+    uint8_t prefixhash[32];
+    CSHA256().Write(filedata,covered).Finalize(prefixhash);
+    if ( memcmp(prefixhash,storedhash,sizeof(prefixhash)) != 0 )
+    {
+        fprintf(stderr,"%s does not match %ldKB statefile prefix, ignoring\n",ckptfname.c_str(),(long)covered/1024);
+        fclose(fp);
+        return -1;
+    }
+    int32_t savedheight,currentheight;
+    uint32_t savedtimestamp;
+    uint64_t deposited,issued,withdrawn,approved,redeemed,shorted;
+    notarized_checkpoint last;
+    uint64_t n = 0;
+    if ( fread(&savedheight,1,sizeof(savedheight),fp) != sizeof(savedheight) ||
+         fread(&currentheight,1,sizeof(currentheight),fp) != sizeof(currentheight) ||
+         fread(&savedtimestamp,1,sizeof(savedtimestamp),fp) != sizeof(savedtimestamp) ||
+         fread(&deposited,1,sizeof(deposited),fp) != sizeof(deposited) ||
+         fread(&issued,1,sizeof(issued),fp) != sizeof(issued) ||
+         fread(&withdrawn,1,sizeof(withdrawn),fp) != sizeof(withdrawn) ||
+         fread(&approved,1,sizeof(approved),fp) != sizeof(approved) ||
+         fread(&redeemed,1,sizeof(redeemed),fp) != sizeof(redeemed) ||
+         fread(&shorted,1,sizeof(shorted),fp) != sizeof(shorted) ||
+         !komodo_ckpt_readnpoint(fp,last) ||
+         fread(&n,1,sizeof(n),fp) != sizeof(n) )
+    {
+        fclose(fp);
+        return -1;
+    }
+    std::vector<notarized_checkpoint> npoints;
+    npoints.reserve(n);
+    for (uint64_t i=0; i<n; i++)
+    {
+        notarized_checkpoint np;
+        if ( !komodo_ckpt_readnpoint(fp,np) )
+        {
+            fclose(fp);
+            return -1;
+        }
+        npoints.push_back(np);
+    }
+    uint64_t npubkeys = 0;
+    if ( fread(&npubkeys,1,sizeof(npubkeys),fp) != sizeof(npubkeys) )
+    {
+        fclose(fp);
+        return -1;
+    }
+    std::vector<uint64_t> vpos;
+    vpos.reserve(npubkeys);
+    for (uint64_t i=0; i<npubkeys; i++)
+    {
+        uint64_t pos = 0;
+        if ( fread(&pos,1,sizeof(pos),fp) != sizeof(pos) || pos >= covered || filedata[pos] != 'P' )
+        {
+            fclose(fp);
+            return -1;
+        }
+        vpos.push_back(pos);
+    }
+    fclose(fp);
+    // Parse the pubkey records before mutating anything; the event
+    // constructors throw on malformed data.
+    std::vector<std::pair<int32_t,komodo::event_pubkeys>> pkevents;
+    try
+    {
+        for (uint64_t pos : vpos)
+        {
+            long fpos = (long)pos + 1;
+            int32_t ht;
+            if ( mem_read(ht,filedata,fpos,datalen) != sizeof(ht) )
+                return -1;
+            pkevents.push_back(std::make_pair(ht,komodo::event_pubkeys(filedata,fpos,datalen,ht)));
+        }
+    }
+    catch ( const komodo::parse_error &pe )
+    {
+        return -1;
+    }
+    sp->SAVEDHEIGHT = savedheight;
+    sp->CURRENT_HEIGHT = currentheight;
+    sp->SAVEDTIMESTAMP = savedtimestamp;
+    sp->deposited = deposited;
+    sp->issued = issued;
+    sp->withdrawn = withdrawn;
+    sp->approved = approved;
+    sp->redeemed = redeemed;
+    sp->shorted = shorted;
+    sp->RestoreCheckpoints(npoints,last);
+    bool matched = false;
+    if ( chainName.isKMD() && strcmp(symbol,"KMD") == 0 )
+        matched = true;
+    else
+        matched = chainName.isSymbol(symbol);
+    for (auto &pk : pkevents)
+    {
+        if ( (KOMODO_EXTERNAL_NOTARIES && matched) || (strcmp(symbol,"KMD") == 0 && !KOMODO_EXTERNAL_NOTARIES) )
+            komodo_eventadd_pubkeys(sp,symbol,pk.first,pk.second);
+    }
+    // Hand the covered prefix's 'P' offsets back to the caller: the replay
+    // loop only appends offsets found after the resume point, and the
+    // rewritten checkpoint must keep the earlier eras too.
+    pubkeypos.swap(vpos);
+    return (long)covered;
+}
+
 /***
  * @brief read the komodostate file
  * @param sp the komodo_state struct
@@ -453,36 +746,77 @@ bool komodo_faststateinit(komodo_state *sp,const char *fname,char *symbol, const
 
     uint8_t *filedata = nullptr;
     long datalen;
-    if ( (filedata= OS_fileptr(&datalen,fname)) != 0 )
+    int32_t fmapped = 0;
+    if ( (filedata= komodo_mapstatefile(fname,&datalen,&fmapped)) != 0 )
     {
         long fpos = 0;
         long lastfpos = 0;
         uint32_t indcounter = 0;
         uint32_t prevpos100 = 0;
+        std::vector<uint64_t> pubkeypos;
 
+        std::string ckptfname(fname);
+        ckptfname += ".ckpt";
         std::string indfname(fname);
         indfname += ".ind";
-        FILE *indfp = fopen(indfname.c_str(), "wb");
-        if ( indfp != nullptr )
-            fwrite(&prevpos100,1,sizeof(prevpos100),indfp), indcounter++;
 
-        fprintf(stderr,"processing %s %ldKB, validated.%d\n",fname,datalen/1024,-1);
+        // KMD keeps no in-memory event list, so the replayed state is fully
+        // captured by the scalar fields, the notarization checkpoints and the
+        // notary pubkey records; a checkpoint snapshot lets a restart resume
+        // from the covered offset and replay only the tail of the statefile.
+        bool fFromCheckpoint = false;
+        if ( chainName.isKMD() )
+        {
+            long resume = komodo_checkpoint_load(sp,ckptfname,filedata,datalen,symbol,dest,pubkeypos);
+            if ( resume >= 0 )
+            {
+                fpos = lastfpos = resume;
+                fFromCheckpoint = true;
+                fprintf(stderr,"resuming %s from checkpointed fpos.%ld of %ldKB\n",fname,fpos,datalen/1024);
+            }
+        }
+
+        FILE *indfp = nullptr;
+        if ( !fFromCheckpoint )
+        {
+            indfp = fopen(indfname.c_str(), "wb");
+            if ( indfp != nullptr )
+                fwrite(&prevpos100,1,sizeof(prevpos100),indfp), indcounter++;
+            fprintf(stderr,"processing %s %ldKB, validated.%d\n",fname,datalen/1024,-1);
+        }
         int32_t func;
-        while (!ShutdownRequested() && (func= komodo_parsestatefiledata(sp,filedata,&fpos,datalen,symbol,dest)) >= 0)
+        komodo_event_replay_start(); // apply notary and checkpoint records on worker streams
+        while (!ShutdownRequested() && fpos < datalen)
         {
+            if ( filedata[fpos] == 'P' )
+                pubkeypos.push_back((uint64_t)fpos);
+            if ( (func= komodo_parsestatefiledata(sp,filedata,&fpos,datalen,symbol,dest)) < 0 )
+                break;
             lastfpos = komodo_indfile_update(indfp,&prevpos100,lastfpos,fpos,func,&indcounter);
         }
-        if (ShutdownRequested()) { fclose(indfp); return false; }
+        komodo_event_replay_finish(); // height barrier: all queued side effects are applied
+        if (ShutdownRequested())
+        {
+            if ( indfp != nullptr )
+                fclose(indfp);
+            komodo_unmapstatefile(filedata,datalen,fmapped);
+            return false;
+        }
         if ( indfp != nullptr )
         {
             fclose(indfp);
             if ( (fpos= komodo_stateind_validate(0,indfname,filedata,datalen,&prevpos100,&indcounter,symbol,dest)) < 0 )
                 printf("unexpected komodostate.ind validate failure %s datalen.%ld\n",indfname.c_str(),datalen);
-            else 
+            else
                 printf("%s validated fpos.%ld\n",indfname.c_str(),fpos);
         }
+        if ( chainName.isKMD() )
+        {
+            if ( !komodo_checkpoint_write(sp,ckptfname,filedata,datalen,pubkeypos) )
+                fprintf(stderr,"unable to write state checkpoint %s\n",ckptfname.c_str());
+        }
         fprintf(stderr,"took %d seconds to process %s %ldKB\n",(int32_t)(time(NULL)-starttime),fname,datalen/1024);
-        free(filedata);
+        komodo_unmapstatefile(filedata,datalen,fmapped);
         return true;
     }
     return false;
@@ -17,6 +17,8 @@
 #include "komodo_utils.h" // dstr()
 #include "komodo_hardfork.h"
 
+#include <map>
+
 #define KOMODO_INTEREST ((uint64_t)5000000) //((uint64_t)(0.05 * COIN))   // 5%
 
 uint64_t _komodo_interestnew(int32_t txheight,uint64_t nValue,uint32_t nLockTime,uint32_t tiptime)
@@ -230,9 +232,117 @@ uint64_t komodo_accrued_interest(int32_t *txheightp,uint32_t *locktimep,uint256
     {
         if ( (checkvalue == 0 || value == checkvalue) && (checkheight == 0 || *txheightp == checkheight) )
             return komodo_interest(*txheightp,value,*locktimep,tiptime);
-        else 
+        else
             fprintf(stderr,"komodo_accrued_interest value mismatch %llu vs %llu or height mismatch %d vs %d\n",(long long)value,(long long)checkvalue,*txheightp,checkheight);
     }
     return 0;
 }
 
+/****
+ * @brief get accrued interest for all transparent inputs of a transaction
+ *
+ * Equivalent to calling komodo_accrued_interest per input, but takes cs_main
+ * and resolves the tip time once for the whole transaction.
+ *
+ * @param[out] vInterest per-input interest, zero for non-qualifying inputs
+ * @param[in] tx the spending transaction
+ * @param[in] tipheight the height to accrue to
+ * @param[in] vValues input values already known to the caller; inputs below
+ *            the 10 coin minimum are skipped without a tx lookup (pass an
+ *            empty vector if unknown)
+ * @return the total interest over all inputs
+ */
+uint64_t komodo_interest_batch(std::vector<uint64_t> &vInterest,const CTransaction &tx,
+        int32_t tipheight,const std::vector<uint64_t> &vValues)
+{
+    vInterest.assign(tx.vin.size(),0);
+    uint64_t total = 0;
+
+    LOCK(cs_main);
+    uint32_t tiptime = 0;
+    CBlockIndex *tipindex = chainActive[tipheight];
+    if ( tipindex != nullptr )
+        tiptime = (uint32_t)tipindex->nTime;
+    else if ( (tipindex= chainActive.Tip()) != nullptr )
+        tiptime = (uint32_t)tipindex->nTime;
+
+    for (size_t i = 0; i < tx.vin.size(); i++)
+    {
+        if ( i < vValues.size() && vValues[i] < 10*COIN )
+            continue;
+        CTransaction vintx;
+        uint256 hashBlock;
+        if ( !GetTransaction(tx.vin[i].prevout.hash,vintx,hashBlock,true) )
+            continue;
+        if ( tx.vin[i].prevout.n >= vintx.vout.size() )
+            continue;
+        CBlockIndex *pindex = komodo_getblockindex(hashBlock);
+        if ( pindex == nullptr )
+            continue;
+        uint64_t value = vintx.vout[tx.vin[i].prevout.n].nValue;
+        if ( i < vValues.size() && value != vValues[i] )
+        {
+            fprintf(stderr,"komodo_interest_batch value mismatch %llu vs %llu at input %d\n",(long long)value,(long long)vValues[i],(int32_t)i);
+            continue;
+        }
+        uint64_t interest = komodo_interest(pindex->nHeight,value,vintx.nLockTime,tiptime);
+        vInterest[i] = interest;
+        total += interest;
+    }
+    return total;
+}
+
+/****
+ * @brief get accrued interest for a list of unspent outputs
+ *
+ * Companion to the per-transaction batch above for callers that hold utxos
+ * rather than a spending transaction. Resolves the tip time once and fetches
+ * each funding transaction only once when several utxos share a txid.
+ *
+ * @param[out] vInterest per-utxo interest, zero for non-qualifying utxos
+ * @param[in] vOutPoints the utxos to accrue
+ * @param[in] vHeights the block height of each utxo
+ * @param[in] vValues the value of each utxo; entries below the 10 coin
+ *            minimum are skipped without a tx lookup
+ * @param[in] tipheight the height to accrue to
+ * @return the total interest over all utxos
+ */
+uint64_t komodo_interest_batch_utxos(std::vector<uint64_t> &vInterest,const std::vector<COutPoint> &vOutPoints,
+        const std::vector<int32_t> &vHeights,const std::vector<uint64_t> &vValues,int32_t tipheight)
+{
+    vInterest.assign(vOutPoints.size(),0);
+    uint64_t total = 0;
+    std::map<uint256,uint32_t> mapLockTimes; // funding txs fetched so far
+
+    LOCK(cs_main);
+    uint32_t tiptime = 0;
+    CBlockIndex *tipindex = chainActive[tipheight];
+    if ( tipindex != nullptr )
+        tiptime = (uint32_t)tipindex->nTime;
+    else if ( (tipindex= chainActive.Tip()) != nullptr )
+        tiptime = (uint32_t)tipindex->nTime;
+
+    for (size_t i = 0; i < vOutPoints.size(); i++)
+    {
+        if ( i >= vHeights.size() || i >= vValues.size() || vValues[i] < 10*COIN )
+            continue;
+        uint32_t nLockTime;
+        auto it = mapLockTimes.find(vOutPoints[i].hash);
+        if ( it != mapLockTimes.end() )
+            nLockTime = it->second;
+        else
+        {
+            CTransaction vintx;
+            uint256 hashBlock;
+            if ( !GetTransaction(vOutPoints[i].hash,vintx,hashBlock,true) )
+                continue;
+            nLockTime = vintx.nLockTime;
+            mapLockTimes[vOutPoints[i].hash] = nLockTime;
+        }
+        uint64_t interest = komodo_interest(vHeights[i],vValues[i],nLockTime,tiptime);
+        vInterest[i] = interest;
+        total += interest;
+    }
+    return total;
+}
+
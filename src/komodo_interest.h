@@ -14,6 +14,10 @@
  ******************************************************************************/
 #include "uint256.h"
 #include <cstdint>
+#include <vector>
+
+class CTransaction;
+class COutPoint;
 
 // each era of this many blocks reduces block reward from 3 to 2 to 1
 #define KOMODO_ENDOFERA 7777777
@@ -51,3 +55,38 @@ uint64_t komodo_interest(int32_t txheight,uint64_t nValue,uint32_t nLockTime,uin
  */
 uint64_t komodo_accrued_interest(int32_t *txheightp,uint32_t *locktimep,uint256 hash,int32_t n,
         int32_t checkheight,uint64_t checkvalue,int32_t tipheight);
+
+/****
+ * @brief get accrued interest for all transparent inputs of a transaction
+ *
+ * Equivalent to calling komodo_accrued_interest per input, but takes cs_main
+ * and resolves the tip time once for the whole transaction.
+ *
+ * @param[out] vInterest per-input interest, zero for non-qualifying inputs
+ * @param[in] tx the spending transaction
+ * @param[in] tipheight the height to accrue to
+ * @param[in] vValues input values already known to the caller; inputs below
+ *            the 10 coin minimum are skipped without a tx lookup (pass an
+ *            empty vector if unknown)
+ * @return the total interest over all inputs
+ */
+uint64_t komodo_interest_batch(std::vector<uint64_t> &vInterest,const CTransaction &tx,
+        int32_t tipheight,const std::vector<uint64_t> &vValues);
+
+/****
+ * @brief get accrued interest for a list of unspent outputs
+ *
+ * Companion to the per-transaction batch above for callers that hold utxos
+ * rather than a spending transaction. Resolves the tip time once and fetches
+ * each funding transaction only once when several utxos share a txid.
+ *
+ * @param[out] vInterest per-utxo interest, zero for non-qualifying utxos
+ * @param[in] vOutPoints the utxos to accrue
+ * @param[in] vHeights the block height of each utxo
+ * @param[in] vValues the value of each utxo; entries below the 10 coin
+ *            minimum are skipped without a tx lookup
+ * @param[in] tipheight the height to accrue to
+ * @return the total interest over all utxos
+ */
+uint64_t komodo_interest_batch_utxos(std::vector<uint64_t> &vInterest,const std::vector<COutPoint> &vOutPoints,
+        const std::vector<int32_t> &vHeights,const std::vector<uint64_t> &vValues,int32_t tipheight);
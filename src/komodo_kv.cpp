@@ -16,23 +16,65 @@
 #include "komodo_globals.h"
 #include "komodo_utils.h" // portable_mutex_lock
 #include "komodo_curve25519.h" // for komodo_kvsigverify
+#include <boost/thread/shared_mutex.hpp>
+#include <map>
 #include <mutex>
+#include <vector>
 
-std::mutex kv_mutex;
+struct komodo_kv
+{
+    bits256 pubkey;
+    std::vector<uint8_t> value;
+    int32_t height;
+    uint32_t flags;
+};
 
-struct komodo_kv 
-{ 
-    UT_hash_handle hh; 
-    bits256 pubkey; 
-    uint8_t *key;
-    uint8_t *value; 
-    int32_t height; 
-    uint32_t flags; 
-    uint16_t keylen;
-    uint16_t valuesize; 
+/***
+ * KV entries live in a sharded key -> entry map. Searches take the shard
+ * lock shared, so lookups on different keys (and concurrent lookups on the
+ * same key) no longer serialize behind one global mutex; only updates and
+ * expiry removal take it exclusive.
+ */
+struct komodo_kv_shard
+{
+    boost::shared_mutex mutex;
+    std::map<std::vector<uint8_t>,komodo_kv> entries;
 };
+static const uint32_t KOMODO_KV_SHARDS = 16;
+static komodo_kv_shard KV_shards[KOMODO_KV_SHARDS];
 
-komodo_kv *KOMODO_KV;
+// secondary index ordered by update height, for range queries; maintained
+// under its own mutex whenever a shard entry is added, rewritten or expired
+static std::mutex kv_heightindex_mutex;
+static std::multimap<int32_t,std::vector<uint8_t>> KV_heightindex;
+
+static komodo_kv_shard &komodo_kvshard(const uint8_t *key,int32_t keylen)
+{
+    uint32_t h = 5381;
+    for (int32_t i=0; i<keylen; i++)
+        h = (h << 5) + h + key[i];
+    return KV_shards[h % KOMODO_KV_SHARDS];
+}
+
+static void komodo_kvheightindex_add(const std::vector<uint8_t> &key,int32_t height)
+{
+    std::lock_guard<std::mutex> lock(kv_heightindex_mutex);
+    KV_heightindex.insert(std::make_pair(height,key));
+}
+
+static void komodo_kvheightindex_erase(const std::vector<uint8_t> &key,int32_t height)
+{
+    std::lock_guard<std::mutex> lock(kv_heightindex_mutex);
+    auto range = KV_heightindex.equal_range(height);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if ( it->second == key )
+        {
+            KV_heightindex.erase(it);
+            break;
+        }
+    }
+}
 
 /****
  * @brief build a private key from the public key and passphrase
@@ -158,37 +200,48 @@ int32_t komodo_kvsearch(uint256 *pubkeyp, int32_t current_height, uint32_t *flag
     *heightp = -1;
     *flagsp = 0;
 
-    komodo_kv *ptr; 
     int32_t retval = -1;
+    bool expired = false;
     memset(pubkeyp,0,sizeof(*pubkeyp));
-    std::lock_guard<std::mutex> lock(kv_mutex);
-    // look in hashtable for key
-    HASH_FIND(hh,KOMODO_KV,key,keylen,ptr);
-    if ( ptr != nullptr )
+    std::vector<uint8_t> vkey(key,key+keylen);
+    komodo_kv_shard &shard = komodo_kvshard(key,keylen);
     {
-        int32_t duration = komodo_kvduration(ptr->flags);
-        if ( current_height > (ptr->height + duration) )
-        {
-            // entry has expired, remove it
-            HASH_DELETE(hh,KOMODO_KV,ptr);
-            if ( ptr->value != 0 )
-                free(ptr->value);
-            if ( ptr->key != 0 )
-                free(ptr->key);
-            free(ptr);
-        }
-        else
+        boost::shared_lock<boost::shared_mutex> lock(shard.mutex);
+        auto it = shard.entries.find(vkey);
+        if ( it != shard.entries.end() )
         {
-            // place values into parameters
-            *heightp = ptr->height;
-            *flagsp = ptr->flags;
-            for (int32_t i=0; i<32; i++)
+            const komodo_kv &entry = it->second;
+            int32_t duration = komodo_kvduration(entry.flags);
+            if ( current_height > (entry.height + duration) )
             {
-                ((uint8_t *)pubkeyp)[i] = ((uint8_t *)&ptr->pubkey)[31-i];
+                // entry has expired, remove it below under the exclusive lock
+                expired = true;
             }
-            memcpy(pubkeyp,&ptr->pubkey,sizeof(*pubkeyp));
-            if ( (retval= ptr->valuesize) > 0 )
-                memcpy(value,ptr->value,retval);
+            else
+            {
+                // place values into parameters
+                *heightp = entry.height;
+                *flagsp = entry.flags;
+                for (int32_t i=0; i<32; i++)
+                {
+                    ((uint8_t *)pubkeyp)[i] = ((uint8_t *)&entry.pubkey)[31-i];
+                }
+                memcpy(pubkeyp,&entry.pubkey,sizeof(*pubkeyp));
+                if ( (retval= (int32_t)entry.value.size()) > 0 )
+                    memcpy(value,entry.value.data(),retval);
+            }
+        }
+    }
+    if ( expired )
+    {
+        boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+        auto it = shard.entries.find(vkey);
+        // recheck: another thread may have refreshed or removed the entry
+        if ( it != shard.entries.end() && current_height > (it->second.height + komodo_kvduration(it->second.flags)) )
+        {
+            int32_t expiredheight = it->second.height;
+            shard.entries.erase(it);
+            komodo_kvheightindex_erase(vkey,expiredheight);
         }
     }
     if ( retval < 0 )
@@ -274,11 +327,12 @@ void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value)
                 }
             }
             // with validation complete, update internal storage
-            std::lock_guard<std::mutex> lock(kv_mutex);
-            komodo_kv *ptr;
+            std::vector<uint8_t> vkey(key,key+keylen);
+            komodo_kv_shard &shard = komodo_kvshard(key,keylen);
+            boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
             bool newflag = false;
-            HASH_FIND(hh,KOMODO_KV,key,keylen,ptr);
-            if ( ptr != 0 )
+            auto it = shard.entries.find(vkey);
+            if ( it != shard.entries.end() )
             {
                 // We are updating an existing entry
                 // if we are doing a transfer, log it and insert the pubkey
@@ -290,38 +344,29 @@ void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value)
                     for (uint8_t i=0; i<32; i++)
                         ((uint8_t *)&pubkey)[31-i] = _decode_hex(&transferpubstr[i*2]);
                 }
+                komodo_kvheightindex_erase(vkey,it->second.height); // reindexed at the new height below
             }
-            else if ( ptr == 0 )
+            else
             {
-                // add a new entry to the hashtable
-                ptr = (komodo_kv *)calloc(1,sizeof(*ptr));
-                ptr->key = (uint8_t *)calloc(1,keylen);
-                ptr->keylen = keylen;
-                memcpy(ptr->key,key,keylen);
+                // add a new entry
+                it = shard.entries.insert(std::make_pair(vkey,komodo_kv())).first;
+                memset(&it->second.pubkey,0,sizeof(it->second.pubkey));
+                it->second.height = 0;
+                it->second.flags = 0;
                 newflag = true;
-                HASH_ADD_KEYPTR(hh,KOMODO_KV,ptr->key,ptr->keylen,ptr);
             }
-            if ( newflag || (ptr->flags & KOMODO_KVPROTECTED) == 0 ) // can we edit the value?
+            komodo_kv &entry = it->second;
+            if ( newflag || (entry.flags & KOMODO_KVPROTECTED) == 0 ) // can we edit the value?
             {
-                if ( ptr->value != nullptr )
-                {
-                    // clear out old value
-                    free(ptr->value);
-                    ptr->value = nullptr;
-                }
-                if ( (ptr->valuesize= valuesize) != 0 )
-                {
-                    // add value
-                    ptr->value = (uint8_t *)calloc(1,valuesize);
-                    memcpy(ptr->value,valueptr,valuesize);
-                }
-            } 
-            else 
+                entry.value.assign(valueptr,valueptr+valuesize);
+            }
+            else
                 fprintf(stderr,"newflag.%d zero or protected %d\n",(uint16_t)newflag,
-                        (ptr->flags & KOMODO_KVPROTECTED));
-            memcpy(&ptr->pubkey,&pubkey,sizeof(ptr->pubkey));
-            ptr->height = height;
-            ptr->flags = flags; // jl777 used to or in KVPROTECTED
+                        (entry.flags & KOMODO_KVPROTECTED));
+            memcpy(&entry.pubkey,&pubkey,sizeof(entry.pubkey));
+            entry.height = height;
+            entry.flags = flags; // jl777 used to or in KVPROTECTED
+            komodo_kvheightindex_add(vkey,height);
         } 
         else 
             fprintf(stderr,"KV update size mismatch %d vs %d\n",opretlen,coresize);
@@ -329,3 +374,19 @@ void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value)
     else 
         fprintf(stderr,"not enough fee\n");
 }
+
+/****
+ * @brief collect keys last updated within a height range
+ * @param[out] keys the matching keys, in update-height order
+ * @param minheight lowest update height to include
+ * @param maxheight highest update height to include
+ * @return the number of keys found
+ */
+int32_t komodo_kvkeysbyheight(std::vector<std::vector<uint8_t>> &keys,int32_t minheight,int32_t maxheight)
+{
+    keys.clear();
+    std::lock_guard<std::mutex> lock(kv_heightindex_mutex);
+    for (auto it = KV_heightindex.lower_bound(minheight); it != KV_heightindex.end() && it->first <= maxheight; ++it)
+        keys.push_back(it->second);
+    return (int32_t)keys.size();
+}
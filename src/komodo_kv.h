@@ -16,6 +16,7 @@
 #include "uint256.h"
 #include "komodo_defs.h"
 #include <cstdint>
+#include <vector>
 
 /***
  * @brief calculate the duration in minutes
@@ -55,6 +56,15 @@ int32_t komodo_kvsearch(uint256 *pubkeyp,int32_t current_height,uint32_t *flagsp
  */
 void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value);
 
+/****
+ * @brief collect keys last updated within a height range
+ * @param[out] keys the matching keys, in update-height order
+ * @param minheight lowest update height to include
+ * @param maxheight highest update height to include
+ * @return the number of keys found
+ */
+int32_t komodo_kvkeysbyheight(std::vector<std::vector<uint8_t>> &keys,int32_t minheight,int32_t maxheight);
+
 /****
  * @brief build a private key from the public key and passphrase
  * @param pubkeyp the public key
@@ -53,6 +53,8 @@
 #define NSPV_CC_TXIDS 16
 #define NSPV_REMOTERPC 0x14
 #define NSPV_REMOTERPCRESP 0x15
+#define NSPV_MAXUTXOS_PAGE 2000 // utxo entries per NSPV_UTXOSRESP; page with skipcount
+#define NSPV_ADDRESSUTXOS_SUMMARY 0x80 // NSPV_UTXOS filter bit: totals only, no utxo entries
 
 extern int32_t KOMODO_NSPV;
 
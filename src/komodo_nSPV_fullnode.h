@@ -29,6 +29,115 @@ static std::map<std::string,bool> nspv_remote_commands =  {{"channelsopen", true
 {"gatewayspartialsign", true},{"gatewayscompletesigning", true},{"gatewaysmarkdone", true},{"gatewayspendingdeposits", true},{"gatewayspendingwithdraws", true},
 {"gatewaysprocessed", true},{"gatewaysinfo", false},{"gatewayslist", false},{"faucetfund", true},{"faucetget", true}};
 
+// guards the nSPV caches and token buckets below: komodo_nSPVreq runs on the
+// message handling threads, and with -msghandlerthreads different peers'
+// requests arrive concurrently
+static CCriticalSection cs_nspvcache;
+
+// assembled ntzsproof responses keyed by (prev,next) notarization txid. the
+// bracketed headers sit below a notarization, which dPoW protects from reorg,
+// so the blobs never go stale; repeat requests from superlite clients are a
+// map lookup instead of block loads plus header reconstruction.
+#define NSPV_MAXNTZSPROOFCACHE 64
+static std::map<std::pair<uint256,uint256>,std::vector<uint8_t>> nspv_ntzsproofcache;
+static std::list<std::pair<uint256,uint256>> nspv_ntzsprooflru;
+
+int32_t NSPV_ntzsproofcache_find(const uint256 &prevtxid,const uint256 &nexttxid,std::vector<uint8_t> &response)
+{
+    LOCK(cs_nspvcache);
+    auto it = nspv_ntzsproofcache.find(std::make_pair(prevtxid,nexttxid));
+    if ( it == nspv_ntzsproofcache.end() )
+        return(0);
+    nspv_ntzsprooflru.remove(it->first); // move to the back of the eviction order
+    nspv_ntzsprooflru.push_back(it->first);
+    response = it->second; // copied out so another peer's eviction cant invalidate it
+    return(1);
+}
+
+void NSPV_ntzsproofcache_add(const uint256 &prevtxid,const uint256 &nexttxid,const std::vector<uint8_t> &response)
+{
+    LOCK(cs_nspvcache);
+    std::pair<uint256,uint256> key(prevtxid,nexttxid);
+    if ( nspv_ntzsproofcache.count(key) != 0 )
+        return;
+    while ( nspv_ntzsproofcache.size() >= NSPV_MAXNTZSPROOFCACHE ) // evict the least recently served
+    {
+        nspv_ntzsproofcache.erase(nspv_ntzsprooflru.front());
+        nspv_ntzsprooflru.pop_front();
+    }
+    nspv_ntzsproofcache[key] = response;
+    nspv_ntzsprooflru.push_back(key);
+}
+
+// chain-dependent responses keyed by (request bytes, tip height). a fleet of
+// superlite clients polling the same balances between blocks walks the address
+// index once and every identical request until the next block is served from
+// here. stale-tip entries age out of the eviction order on their own.
+#define NSPV_MAXRESPCACHE 128
+static std::map<std::pair<uint256,int32_t>,std::vector<uint8_t>> nspv_respcache;
+static std::list<std::pair<uint256,int32_t>> nspv_resplru;
+
+int32_t NSPV_respcache_find(const std::vector<uint8_t> &request,int32_t tipheight,std::vector<uint8_t> &response)
+{
+    LOCK(cs_nspvcache);
+    auto it = nspv_respcache.find(std::make_pair(Hash(request.begin(),request.end()),tipheight));
+    if ( it == nspv_respcache.end() )
+        return(0);
+    nspv_resplru.remove(it->first); // move to the back of the eviction order
+    nspv_resplru.push_back(it->first);
+    response = it->second; // copied out so another peer's eviction cant invalidate it
+    return(1);
+}
+
+void NSPV_respcache_add(const std::vector<uint8_t> &request,int32_t tipheight,const std::vector<uint8_t> &response)
+{
+    LOCK(cs_nspvcache);
+    std::pair<uint256,int32_t> key(Hash(request.begin(),request.end()),tipheight);
+    if ( nspv_respcache.count(key) != 0 )
+        return;
+    while ( nspv_respcache.size() >= NSPV_MAXRESPCACHE ) // evict the least recently served
+    {
+        nspv_respcache.erase(nspv_resplru.front());
+        nspv_resplru.pop_front();
+    }
+    nspv_respcache[key] = response;
+    nspv_resplru.push_back(key);
+}
+
+// per-peer token bucket on top of the per-reqtype one second throttle: a peer can
+// burst NSPV_TOKENBUCKET_SIZE requests and then earns NSPV_TOKENBUCKET_RATE per
+// second, so one misbehaving superlite client cannot monopolise the message loop.
+#define NSPV_TOKENBUCKET_SIZE 50.
+#define NSPV_TOKENBUCKET_RATE 10.
+struct NSPV_tokenbucket { double tokens; uint32_t lasttime; };
+static std::map<NodeId,struct NSPV_tokenbucket> nspv_tokenbuckets;
+
+int32_t NSPV_tokenbucket_allow(NodeId id,uint32_t timestamp)
+{
+    LOCK(cs_nspvcache);
+    struct NSPV_tokenbucket &b = nspv_tokenbuckets[id];
+    if ( b.lasttime == 0 )
+        b.tokens = NSPV_TOKENBUCKET_SIZE;
+    else if ( timestamp > b.lasttime )
+        b.tokens = std::min(NSPV_TOKENBUCKET_SIZE,b.tokens + NSPV_TOKENBUCKET_RATE*(timestamp - b.lasttime));
+    b.lasttime = timestamp;
+    if ( nspv_tokenbuckets.size() > 512 ) // drop idle peers so disconnects dont accumulate
+    {
+        for (auto it=nspv_tokenbuckets.begin(); it!=nspv_tokenbuckets.end();)
+        {
+            if ( it->first != id && timestamp > it->second.lasttime + 600 )
+                it = nspv_tokenbuckets.erase(it);
+            else it++;
+        }
+    }
+    if ( b.tokens >= 1. )
+    {
+        b.tokens -= 1.;
+        return(1);
+    }
+    return(0);
+}
+
 struct NSPV_ntzargs
 {
     uint256 txid,desttxid,blockhash;
@@ -154,59 +263,97 @@ int32_t NSPV_getinfo(struct NSPV_inforesp *ptr,int32_t reqheight)
     } else return(-1);
 }
 
+// responses are paged: at most NSPV_MAXUTXOS_PAGE entries (or fewer if the block
+// size limit binds) per call, with skipcount as the page origin, so a whale
+// address no longer gets an empty reply or a multi-second serial walk. interest
+// is accrued through the batch helper, which resolves the tip time once and
+// fetches each funding tx only once. the NSPV_ADDRESSUTXOS_SUMMARY filter bit
+// returns only the totals over all utxos, with the utxo count in skipcount.
 int32_t NSPV_getaddressutxos(struct NSPV_utxosresp *ptr,char *coinaddr,bool isCC,int32_t skipcount,uint32_t filter)
 {
-    int64_t total = 0,interest=0; uint32_t locktime; int32_t ind=0,tipheight,maxlen,txheight,n = 0,len = 0;
+    int64_t total = 0,interest=0; int32_t ind=0,tipheight,maxlen,pagesize,numunspent,n = 0,len = 0;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    std::vector<COutPoint> vOutPoints; std::vector<int32_t> vHeights,vIndexes; std::vector<uint64_t> vValues,vInterest;
     SetCCunspents(unspentOutputs,coinaddr,isCC);
+    tipheight = chainActive.Tip()->nHeight;
     maxlen = MAX_BLOCK_SIZE(tipheight) - 512;
     maxlen /= sizeof(*ptr->utxos);
+    if ( (pagesize= maxlen) > NSPV_MAXUTXOS_PAGE )
+        pagesize = NSPV_MAXUTXOS_PAGE;
     strncpy(ptr->coinaddr,coinaddr,sizeof(ptr->coinaddr)-1);
     ptr->CCflag = isCC;
     ptr->filter = filter;
+    ptr->nodeheight = tipheight;
     if ( skipcount < 0 )
         skipcount = 0;
-    if ( (ptr->numutxos= (int32_t)unspentOutputs.size()) >= 0 && ptr->numutxos < maxlen )
+    numunspent = (int32_t)unspentOutputs.size();
+    if ( (filter & NSPV_ADDRESSUTXOS_SUMMARY) != 0 )
+    {
+        for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
+        {
+            if ( myIsutxo_spentinmempool(ignoretxid,ignorevin,it->first.txhash,(int32_t)it->first.index) != 0 )
+                continue;
+            total += it->second.satoshis;
+            n++;
+            if ( chainName.isKMD() && it->second.satoshis >= 10*COIN )
+            {
+                vOutPoints.push_back(COutPoint(it->first.txhash,(int32_t)it->first.index));
+                vHeights.push_back(it->second.blockHeight);
+                vValues.push_back(it->second.satoshis);
+            }
+        }
+        if ( vOutPoints.size() > 0 )
+            interest = komodo_interest_batch_utxos(vInterest,vOutPoints,vHeights,vValues,tipheight);
+        ptr->numutxos = 0;
+        ptr->skipcount = n; // stands in for the utxo count in a summary reply
+        ptr->total = total;
+        ptr->interest = interest;
+        return((int32_t)(sizeof(*ptr) - sizeof(ptr->utxos)));
+    }
+    if ( numunspent >= 0 )
     {
-        tipheight = chainActive.Tip()->nHeight;
-        ptr->nodeheight = tipheight;
-        if ( skipcount >= ptr->numutxos )
-            skipcount = ptr->numutxos-1;
+        if ( skipcount >= numunspent )
+            skipcount = numunspent > 0 ? numunspent-1 : 0;
         ptr->skipcount = skipcount;
-        if ( ptr->numutxos-skipcount > 0 )
+        if ( numunspent-skipcount > 0 )
         {
-            ptr->utxos = (struct NSPV_utxoresp *)calloc(ptr->numutxos-skipcount,sizeof(*ptr->utxos));
-            for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
+            if ( (len= numunspent-skipcount) > pagesize )
+                len = pagesize;
+            ptr->utxos = (struct NSPV_utxoresp *)calloc(len,sizeof(*ptr->utxos));
+            for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end() && ind<len; it++)
             {
                 // if gettxout is != null to handle mempool
+                if ( n >= skipcount && myIsutxo_spentinmempool(ignoretxid,ignorevin,it->first.txhash,(int32_t)it->first.index) == 0  )
                 {
-                    if ( n >= skipcount && myIsutxo_spentinmempool(ignoretxid,ignorevin,it->first.txhash,(int32_t)it->first.index) == 0  )
+                    ptr->utxos[ind].txid = it->first.txhash;
+                    ptr->utxos[ind].vout = (int32_t)it->first.index;
+                    ptr->utxos[ind].satoshis = it->second.satoshis;
+                    ptr->utxos[ind].height = it->second.blockHeight;
+                    if ( chainName.isKMD() && it->second.satoshis >= 10*COIN )
                     {
-                        ptr->utxos[ind].txid = it->first.txhash;
-                        ptr->utxos[ind].vout = (int32_t)it->first.index;
-                        ptr->utxos[ind].satoshis = it->second.satoshis;
-                        ptr->utxos[ind].height = it->second.blockHeight;
-                        if ( chainName.isKMD() && it->second.satoshis >= 10*COIN )
-                        {
-                            ptr->utxos[n].extradata = komodo_accrued_interest(&txheight,&locktime,ptr->utxos[ind].txid,ptr->utxos[ind].vout,ptr->utxos[ind].height,ptr->utxos[ind].satoshis,tipheight);
-                            interest += ptr->utxos[ind].extradata;
-                        }
-                        ind++;
-                        total += it->second.satoshis;
+                        vOutPoints.push_back(COutPoint(ptr->utxos[ind].txid,ptr->utxos[ind].vout));
+                        vHeights.push_back(ptr->utxos[ind].height);
+                        vValues.push_back(ptr->utxos[ind].satoshis);
+                        vIndexes.push_back(ind);
                     }
-                    n++;
+                    ind++;
+                    total += it->second.satoshis;
                 }
+                n++;
+            }
+            if ( vOutPoints.size() > 0 )
+            {
+                interest = (int64_t)komodo_interest_batch_utxos(vInterest,vOutPoints,vHeights,vValues,tipheight);
+                for (n=0; n<(int32_t)vIndexes.size(); n++)
+                    ptr->utxos[vIndexes[n]].extradata = vInterest[n];
             }
         }
         ptr->numutxos = ind;
-        if ( len < maxlen )
-        {
-            len = (int32_t)(sizeof(*ptr) + sizeof(*ptr->utxos)*ptr->numutxos - sizeof(ptr->utxos));
-            //fprintf(stderr,"getaddressutxos for %s -> n.%d:%d total %.8f interest %.8f len.%d\n",coinaddr,n,ptr->numutxos,dstr(total),dstr(interest),len);
-            ptr->total = total;
-            ptr->interest = interest;
-            return(len);
-        }
+        len = (int32_t)(sizeof(*ptr) + sizeof(*ptr->utxos)*ptr->numutxos - sizeof(ptr->utxos));
+        //fprintf(stderr,"getaddressutxos for %s -> n.%d:%d total %.8f interest %.8f len.%d\n",coinaddr,n,ptr->numutxos,dstr(total),dstr(interest),len);
+        ptr->total = total;
+        ptr->interest = interest;
+        return(len);
     }
     if ( ptr->utxos != 0 )
         free(ptr->utxos);
@@ -878,9 +1025,12 @@ int32_t NSPV_getspentinfo(struct NSPV_spentinfo *ptr,uint256 txid,int32_t vout)
 
 void komodo_nSPVreq(CNode *pfrom,std::vector<uint8_t> request) // received a request
 {
-    int32_t len,slen,ind,reqheight,n; std::vector<uint8_t> response; uint32_t timestamp = (uint32_t)time(NULL);
+    int32_t len,slen,ind,reqheight,n,tipheight; std::vector<uint8_t> response,cachedresp; uint32_t timestamp = (uint32_t)time(NULL);
     if ( (len= request.size()) > 0 )
     {
+        if ( NSPV_tokenbucket_allow(pfrom->id,timestamp) == 0 )
+            return;
+        tipheight = chainActive.Height();
         if ( (ind= request[0]>>1) >= sizeof(pfrom->prevtimes)/sizeof(*pfrom->prevtimes) )
             ind = (int32_t)(sizeof(pfrom->prevtimes)/sizeof(*pfrom->prevtimes)) - 1;
         if ( pfrom->prevtimes[ind] > timestamp )
@@ -917,7 +1067,12 @@ void komodo_nSPVreq(CNode *pfrom,std::vector<uint8_t> request) // received a req
             if ( timestamp > pfrom->prevtimes[ind] )
             {
                 struct NSPV_utxosresp U;
-                if ( len < 64+5 && (request[1] == len-3 || request[1] == len-7 || request[1] == len-11) )
+                if ( NSPV_respcache_find(request,tipheight,cachedresp) != 0 )
+                {
+                    pfrom->PushMessage("nSPV",cachedresp);
+                    pfrom->prevtimes[ind] = timestamp;
+                }
+                else if ( len < 64+5 && (request[1] == len-3 || request[1] == len-7 || request[1] == len-11) )
                 {
                     int32_t skipcount = 0; char coinaddr[64]; uint8_t filter; uint8_t isCC = 0;
                     memcpy(coinaddr,&request[2],request[1]);
@@ -944,6 +1099,7 @@ void komodo_nSPVreq(CNode *pfrom,std::vector<uint8_t> request) // received a req
                         response[0] = NSPV_UTXOSRESP;
                         if ( NSPV_rwutxosresp(1,&response[1],&U) == slen )
                         {
+                            NSPV_respcache_add(request,tipheight,response);
                             pfrom->PushMessage("nSPV",response);
                             pfrom->prevtimes[ind] = timestamp;
                         }
@@ -957,7 +1113,12 @@ void komodo_nSPVreq(CNode *pfrom,std::vector<uint8_t> request) // received a req
             if ( timestamp > pfrom->prevtimes[ind] )
             {
                 struct NSPV_txidsresp T;
-                if ( len < 64+5 && (request[1] == len-3 || request[1] == len-7 || request[1] == len-11) )
+                if ( NSPV_respcache_find(request,tipheight,cachedresp) != 0 )
+                {
+                    pfrom->PushMessage("nSPV",cachedresp);
+                    pfrom->prevtimes[ind] = timestamp;
+                }
+                else if ( len < 64+5 && (request[1] == len-3 || request[1] == len-7 || request[1] == len-11) )
                 {
                     int32_t skipcount = 0; char coinaddr[64]; uint32_t filter; uint8_t isCC = 0;
                     memcpy(coinaddr,&request[2],request[1]);
@@ -985,6 +1146,7 @@ void komodo_nSPVreq(CNode *pfrom,std::vector<uint8_t> request) // received a req
                         response[0] = NSPV_TXIDSRESP;
                         if ( NSPV_rwtxidsresp(1,&response[1],&T) == slen )
                         {
+                            NSPV_respcache_add(request,tipheight,response);
                             pfrom->PushMessage("nSPV",response);
                             pfrom->prevtimes[ind] = timestamp;
                         }
@@ -1057,24 +1219,33 @@ void komodo_nSPVreq(CNode *pfrom,std::vector<uint8_t> request) // received a req
         {
             if ( timestamp > pfrom->prevtimes[ind] )
             {
-                struct NSPV_ntzsproofresp P; uint256 prevntz,nextntz;
+                struct NSPV_ntzsproofresp P; uint256 prevntz,nextntz; std::vector<uint8_t> cached;
                 if ( len == 1+sizeof(prevntz)+sizeof(nextntz) )
                 {
                     iguana_rwbignum(0,&request[1],sizeof(prevntz),(uint8_t *)&prevntz);
                     iguana_rwbignum(0,&request[1+sizeof(prevntz)],sizeof(nextntz),(uint8_t *)&nextntz);
-                    memset(&P,0,sizeof(P));
-                    if ( (slen= NSPV_getntzsproofresp(&P,prevntz,nextntz)) > 0 )
+                    if ( NSPV_ntzsproofcache_find(prevntz,nextntz,cached) != 0 )
                     {
-                        // fprintf(stderr,"slen.%d msg prev.%s next.%s\n",slen,prevntz.GetHex().c_str(),nextntz.GetHex().c_str());
-                        response.resize(1 + slen);
-                        response[0] = NSPV_NTZSPROOFRESP;
-                        if ( NSPV_rwntzsproofresp(1,&response[1],&P) == slen )
+                        pfrom->PushMessage("nSPV",cached);
+                        pfrom->prevtimes[ind] = timestamp;
+                    }
+                    else
+                    {
+                        memset(&P,0,sizeof(P));
+                        if ( (slen= NSPV_getntzsproofresp(&P,prevntz,nextntz)) > 0 )
                         {
-                            pfrom->PushMessage("nSPV",response);
-                            pfrom->prevtimes[ind] = timestamp;
-                        }
-                        NSPV_ntzsproofresp_purge(&P);
-                    } else fprintf(stderr,"err.%d\n",slen);
+                            // fprintf(stderr,"slen.%d msg prev.%s next.%s\n",slen,prevntz.GetHex().c_str(),nextntz.GetHex().c_str());
+                            response.resize(1 + slen);
+                            response[0] = NSPV_NTZSPROOFRESP;
+                            if ( NSPV_rwntzsproofresp(1,&response[1],&P) == slen )
+                            {
+                                NSPV_ntzsproofcache_add(prevntz,nextntz,response);
+                                pfrom->PushMessage("nSPV",response);
+                                pfrom->prevtimes[ind] = timestamp;
+                            }
+                            NSPV_ntzsproofresp_purge(&P);
+                        } else fprintf(stderr,"err.%d\n",slen);
+                    }
                 }
             }
         }
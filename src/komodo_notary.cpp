@@ -19,15 +19,81 @@
 #include "komodo_structs.h" // KOMODO_NOTARIES_HARDCODED
 #include "komodo_utils.h" // komodo_stateptr
 #include "komodo_bitcoind.h"
+#include "trace.h"
+
+#include <atomic>
+#include <mutex>
 
 //struct knotaries_entry *Pubkeys;  // todo remove
 
 // statics used within this .cpp for caching purposes
 static int didinit; // see komodo_init
-static uint8_t kmd_pubkeys[NUM_KMD_SEASONS][64][33]; // see komodo_notaries
 static int32_t hwmheight; // highest height ever passed to komodo_notariesinit
 static int32_t hadnotarization; // used in komodo_dpowconfs
-static bool didinit_NOTARIES[NUM_KMD_SEASONS]; // komodo_notaries()
+
+namespace {
+
+/***
+ * Immutable per-season table of the elected notary pubkeys, decoded once from
+ * notaries_elected and published through an atomic pointer. Validation
+ * threads and nSPV requests read it without taking a mutex or re-parsing hex.
+ */
+struct notary_season_table
+{
+    uint8_t pubkeys[64][33];
+    knotary_entry *lookup = nullptr; // pubkey -> notaryid, uthash keyed on the 33 bytes
+};
+
+std::atomic<const notary_season_table*> elected_tables(nullptr);
+std::once_flag elected_tables_once;
+
+const notary_season_table *komodo_elected_tables()
+{
+    const notary_season_table *tables = elected_tables.load(std::memory_order_acquire);
+    if ( tables != nullptr )
+        return tables;
+    std::call_once(elected_tables_once, []() {
+        static notary_season_table built[NUM_KMD_SEASONS];
+        memset(built,0,sizeof(built));
+        for (int32_t season = 0; season < NUM_KMD_SEASONS; season++)
+        {
+            for (int32_t i = 0; i < NUM_KMD_NOTARIES; i++)
+            {
+                decode_hex(built[season].pubkeys[i],33,(char *)notaries_elected[season][i][1]);
+                knotary_entry *kp = (knotary_entry *)calloc(1,sizeof(*kp));
+                memcpy(kp->pubkey,built[season].pubkeys[i],33);
+                kp->notaryid = i;
+                HASH_ADD_KEYPTR(hh,built[season].lookup,kp->pubkey,33,kp);
+            }
+            if ( ASSETCHAINS_PRIVATE != 0 )
+            {
+                // this is PIRATE, we need to populate the address array for the notary exemptions.
+                for (int32_t i = 0; i < NUM_KMD_NOTARIES; i++)
+                    pubkey2addr((char *)NOTARY_ADDRESSES[season][i],(uint8_t *)built[season].pubkeys[i]);
+            }
+        }
+        elected_tables.store(built,std::memory_order_release);
+    });
+    return elected_tables.load(std::memory_order_acquire);
+}
+
+/***
+ * @brief hash-probe an elected season table for a pubkey
+ * @param[out] numnotariesp the season's notary count
+ * @param[in] pubkey33 the key to look up
+ * @param[in] season the 1-based season from getkmdseason/getacseason
+ * @returns the notaryid or -1 if the key is not a notary that season
+ */
+int32_t komodo_season_notaryid(int32_t *numnotariesp,uint8_t *pubkey33,int32_t season)
+{
+    const notary_season_table *tables = komodo_elected_tables();
+    knotary_entry *kp;
+    *numnotariesp = NUM_KMD_NOTARIES;
+    HASH_FIND(hh,tables[season-1].lookup,pubkey33,33,kp);
+    return kp != nullptr ? kp->notaryid : -1;
+}
+
+} // namespace
 
 
 /****
@@ -154,22 +220,8 @@ int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestam
         }
         if ( kmd_season != 0 )
         {
-            if ( !didinit_NOTARIES[kmd_season-1] )
-            {
-                for (int32_t i=0; i<NUM_KMD_NOTARIES; i++) 
-                    decode_hex(kmd_pubkeys[kmd_season-1][i],33,(char *)notaries_elected[kmd_season-1][i][1]);
-                if ( ASSETCHAINS_PRIVATE != 0 )
-                {
-                    // this is PIRATE, we need to populate the address array for the notary exemptions. 
-                    for (int32_t i = 0; i<NUM_KMD_NOTARIES; i++) {
-                        pubkey2addr((char *)NOTARY_ADDRESSES[kmd_season-1][i],(uint8_t *)kmd_pubkeys[kmd_season-1][i]);
-                    }
-                    LogPrint("dpow", "komodo_notaries ASSETCHAINS_PRIVATE kmd_season=%d NOTARY_ADDRESSES set (addr0=%s)\n", kmd_season, NOTARY_ADDRESSES[kmd_season-1][0]);
-                }
-                didinit_NOTARIES[kmd_season-1] = true;
-                LogPrint("dpow", "komodo_notaries didinit_NOTARIES kmd_season=%d set to true chainName=%s timestamp=%lld height=%d\n", kmd_season, chainName.symbol().c_str(), timestamp, height);
-            }
-            memcpy(pubkeys,kmd_pubkeys[kmd_season-1],NUM_KMD_NOTARIES * 33);
+            const notary_season_table *tables = komodo_elected_tables();
+            memcpy(pubkeys,tables[kmd_season-1].pubkeys,NUM_KMD_NOTARIES * 33);
             return(NUM_KMD_NOTARIES);
         }
     }
@@ -214,6 +266,26 @@ int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestam
 int32_t komodo_electednotary(int32_t *numnotariesp,uint8_t *pubkey33,int32_t height,uint32_t timestamp)
 {
     int32_t i,n; uint8_t pubkeys[64][33];
+    // fast path: when the era resolves to a hardcoded season, probe its hash
+    // index instead of copying out the whole table and scanning it; this runs
+    // once per P2PK vout of every connected block
+    if ( is_STAKED(chainName.symbol()) == 0 )
+    {
+        int32_t kmd_season = 0;
+        if ( chainName.isKMD() )
+        {
+            if ( height >= KOMODO_NOTARIES_HARDCODED )
+                kmd_season = getkmdseason(height);
+        }
+        else
+        {
+            if ( timestamp == 0 )
+                timestamp = komodo_heightstamp(height);
+            kmd_season = getacseason(timestamp);
+        }
+        if ( kmd_season != 0 )
+            return komodo_season_notaryid(numnotariesp,pubkey33,kmd_season);
+    }
     n = komodo_notaries(pubkeys,height,timestamp);
     *numnotariesp = n;
     for (i=0; i<n; i++)
@@ -391,20 +463,34 @@ int32_t komodo_notarized_height(int32_t *prevMoMheightp,uint256 *hashp,uint256 *
 int32_t komodo_dpowconfs(int32_t txheight,int32_t numconfs)
 {
     AssertLockHeld(cs_main);
-    
-    static int32_t hadnotarization;
-    char symbol[KOMODO_ASSETCHAIN_MAXLEN];
-    char dest[KOMODO_ASSETCHAIN_MAXLEN];
-    komodo_state *sp;
 
-    int nHeightTip = chainActive.Height();
-    int64_t timestamp = komodo_heightstamp(nHeightTip);
-    if ( !IsSunsettingActive(nHeightTip, timestamp) && KOMODO_DPOWCONFS != 0 && txheight > 0 && numconfs > 0 && (sp= komodo_stateptr(symbol,dest)) != nullptr )
+    static int32_t hadnotarization;
+    // the tip-dependent inputs (timestamp, sunset check, chain state lookup)
+    // are identical for every call until the tip moves, so resolve them once
+    // per tip; RPC loops annotating whole result sets hit the cached path
+    static const CBlockIndex *cachedTip;
+    static int32_t cachedNotarizedHeight;
+    static bool cachedActive;
+
+    const CBlockIndex *tip = chainActive.Tip();
+    if ( tip != cachedTip || cachedTip == nullptr )
+    {
+        char symbol[KOMODO_ASSETCHAIN_MAXLEN];
+        char dest[KOMODO_ASSETCHAIN_MAXLEN];
+        komodo_state *sp = nullptr;
+
+        int nHeightTip = chainActive.Height();
+        int64_t timestamp = komodo_heightstamp(nHeightTip);
+        cachedActive = ( !IsSunsettingActive(nHeightTip, timestamp) && KOMODO_DPOWCONFS != 0 && (sp= komodo_stateptr(symbol,dest)) != nullptr );
+        cachedNotarizedHeight = cachedActive ? sp->LastNotarizedHeight() : 0;
+        cachedTip = tip;
+    }
+    if ( cachedActive && txheight > 0 && numconfs > 0 )
     {
-        if ( sp->LastNotarizedHeight() > 0 )
+        if ( cachedNotarizedHeight > 0 )
         {
             hadnotarization = 1;
-            if ( txheight < sp->LastNotarizedHeight() )
+            if ( txheight < cachedNotarizedHeight )
                 return(numconfs);
             else return(1);
         }
@@ -414,6 +500,20 @@ int32_t komodo_dpowconfs(int32_t txheight,int32_t numconfs)
     return(numconfs);
 }
 
+/****
+ * @brief dPoW-adjust a whole set of (txheight, confirmations) pairs
+ * @note same semantics as calling komodo_dpowconfs per entry; the
+ *       tip-dependent state is resolved once for the whole batch
+ * @param[in,out] vHeightConfs pairs of tx height and raw confirmation count,
+ *        the confirmation side is replaced with the dPoW-adjusted value
+ */
+void komodo_dpowconfs_batch(std::vector<std::pair<int32_t,int32_t>> &vHeightConfs)
+{
+    AssertLockHeld(cs_main);
+    for (auto &entry : vHeightConfs)
+        entry.second = komodo_dpowconfs(entry.first, entry.second);
+}
+
 int32_t komodo_MoMdata(int32_t *notarized_htp,uint256 *MoMp,uint256 *kmdtxidp,int32_t height,uint256 *MoMoMp,int32_t *MoMoMoffsetp,int32_t *MoMoMdepthp,int32_t *kmdstartip,int32_t *kmdendip)
 {
     const notarized_checkpoint *np = komodo_npptr(height);
@@ -487,6 +587,11 @@ void komodo_notarized_update(struct komodo_state *sp,int32_t nHeight,int32_t not
     new_cp.MoMdepth = MoMdepth;
     std::lock_guard<std::mutex> lock(komodo_mutex);
     sp->AddCheckpoint(new_cp);
+    TRACE4(notarization, notarized_update,
+           nHeight,
+           notarized_height,
+           notarized_hash.begin(),
+           MoMdepth);
 }
 
 /****
@@ -528,8 +633,8 @@ void komodo_notaries_uninit()
     didinit = 0;
     hwmheight = 0;
     hadnotarization = 0;
-    memset(&didinit_NOTARIES[0], 0, sizeof(uint8_t) * NUM_KMD_SEASONS);
-    memset(&kmd_pubkeys[0], 0, sizeof(uint8_t) * NUM_KMD_SEASONS * 64 * 33);
+    // the elected-season pubkey table is immutable once decoded and does not
+    // need resetting here
     if (Pubkeys != nullptr)
     {
         // extern knotaries_entry *Pubkeys;
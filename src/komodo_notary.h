@@ -87,6 +87,15 @@ int32_t komodo_notarized_height(int32_t *prevMoMheightp,uint256 *hashp,uint256 *
 
 int32_t komodo_dpowconfs(int32_t txheight,int32_t numconfs);
 
+/****
+ * @brief dPoW-adjust a whole set of (txheight, confirmations) pairs
+ * @note same semantics as calling komodo_dpowconfs per entry; the
+ *       tip-dependent state is resolved once for the whole batch
+ * @param[in,out] vHeightConfs pairs of tx height and raw confirmation count,
+ *        the confirmation side is replaced with the dPoW-adjusted value
+ */
+void komodo_dpowconfs_batch(std::vector<std::pair<int32_t,int32_t>> &vHeightConfs);
+
 int32_t komodo_MoMdata(int32_t *notarized_htp,uint256 *MoMp,uint256 *kmdtxidp,int32_t height,uint256 *MoMoMp,int32_t *MoMoMoffsetp,int32_t *MoMoMdepthp,int32_t *kmdstartip,int32_t *kmdendip);
 
 /****
@@ -17,6 +17,8 @@
 #include "komodo_bitcoind.h"
 #include "mem_read.h"
 
+#include <algorithm>
+
 namespace komodo {
 
 /***
@@ -351,8 +353,52 @@ std::ostream& operator<<(std::ostream& os, const event_pricefeed& in)
  */
 void komodo_state::AddCheckpoint(const notarized_checkpoint &in)
 {
+    if ( !NPOINTS.empty() && NPOINTS.back().nHeight > in.nHeight )
+        NPOINTS_sorted = false; // out-of-order insert, lookups fall back to the linear scan
     NPOINTS.push_back(in);
+    static const uint256 zero;
+    if ( in.MoM != zero )
+        NPOINTS_MoMheight = in.notarized_height;
     last = in;
+    PublishLastSnapshot();
+}
+
+/***
+ * @brief rebuild the last-notarization snapshot from the current members
+ * @note call after every mutation of `last` or NPOINTS_MoMheight
+ */
+void komodo_state::PublishLastSnapshot()
+{
+    static const uint256 zero;
+    auto snap = std::make_shared<last_notarized_snapshot>();
+    snap->last = last;
+    snap->prevMoMheight = (last.MoM != zero) ? last.notarized_height : NPOINTS_MoMheight;
+    std::atomic_store(&lastSnapshot, std::shared_ptr<const last_notarized_snapshot>(snap));
+}
+
+/*****
+ * @brief replace the checkpoint collection from a snapshot
+ * @param in the checkpoints, in insertion order
+ * @param lastIn the last notarization values at snapshot time
+ */
+void komodo_state::RestoreCheckpoints(const std::vector<notarized_checkpoint> &in, const notarized_checkpoint &lastIn)
+{
+    NPOINTS = in;
+    NPOINTS_last_index = 0;
+    NPOINTS_sorted = std::is_sorted(NPOINTS.begin(), NPOINTS.end(),
+            [](const notarized_checkpoint &a, const notarized_checkpoint &b) { return a.nHeight < b.nHeight; });
+    static const uint256 zero;
+    NPOINTS_MoMheight = 0;
+    for (auto itr = NPOINTS.rbegin(); itr != NPOINTS.rend(); ++itr)
+    {
+        if ( itr->MoM != zero )
+        {
+            NPOINTS_MoMheight = itr->notarized_height;
+            break;
+        }
+    }
+    last = lastIn;
+    PublishLastSnapshot();
 }
 
 /****
@@ -370,6 +416,27 @@ int32_t komodo_state::NotarizedData(int32_t nHeight,uint256 *notarized_hashp,uin
     if ( NPOINTS.size() > 0 )
     {
         const notarized_checkpoint* np = nullptr;
+        if ( NPOINTS_sorted ) // the normal case: checkpoints arrive in increasing nHeight order
+        {
+            // binary search for the first checkpoint at or above nHeight; its
+            // predecessor is the latest notarization below the desired height
+            auto itr = std::lower_bound(NPOINTS.begin(), NPOINTS.end(), nHeight,
+                    [](const notarized_checkpoint &chk, int32_t height) { return chk.nHeight < height; });
+            if ( itr != NPOINTS.begin() )
+            {
+                np = &*(itr - 1);
+                NPOINTS_last_index = itr - NPOINTS.begin() - 1;
+            }
+            if ( np != nullptr )
+            {
+                *notarized_hashp = np->notarized_hash;
+                *notarized_desttxidp = np->notarized_desttxid;
+                return(np->notarized_height);
+            }
+            memset(notarized_hashp,0,sizeof(*notarized_hashp));
+            memset(notarized_desttxidp,0,sizeof(*notarized_desttxidp));
+            return 0;
+        }
         if ( NPOINTS_last_index < NPOINTS.size() && NPOINTS_last_index > 0 ) // if we cached an NPOINT index
         {
             np = &NPOINTS[NPOINTS_last_index-1]; // grab the previous
@@ -426,20 +493,31 @@ int32_t komodo_state::NotarizedData(int32_t nHeight,uint256 *notarized_hashp,uin
 int32_t komodo_state::NotarizedHeight(int32_t *prevMoMheightp,uint256 *hashp,uint256 *txidp)
 {
     CBlockIndex *pindex;
-    if ( (pindex= komodo_blockindex(last.notarized_hash)) == 0 || pindex->nHeight < 0 )
+    // pin the current snapshot; the writer publishing a newer one does not
+    // block us and we do not block the writer
+    auto snap = std::atomic_load(&lastSnapshot);
+    if ( snap == nullptr )
+        return 0; // no notarization seen yet
+    if ( (pindex= komodo_blockindex(snap->last.notarized_hash)) == 0 || pindex->nHeight < 0 )
     {
-        // found orphaned notarization, adjust the values in the komodo_state object
-        last.notarized_hash.SetNull();
-        last.notarized_desttxid.SetNull();
-        last.notarized_height = 0;
-    }
-    else
-    {
-        *hashp = last.notarized_hash;
-        *txidp = last.notarized_desttxid;
-        *prevMoMheightp = PrevMoMHeight();
+        if ( !snap->last.notarized_hash.IsNull() )
+        {
+            // found orphaned notarization, adjust the values in the komodo_state object
+            std::lock_guard<std::mutex> lock(komodo_mutex);
+            if ( last.notarized_hash == snap->last.notarized_hash )
+            {
+                last.notarized_hash.SetNull();
+                last.notarized_desttxid.SetNull();
+                last.notarized_height = 0;
+                PublishLastSnapshot();
+            }
+        }
+        return 0;
     }
-    return last.notarized_height;
+    *hashp = snap->last.notarized_hash;
+    *txidp = snap->last.notarized_desttxid;
+    *prevMoMheightp = snap->prevMoMheight;
+    return snap->last.notarized_height;
 }
 
 /****
@@ -448,18 +526,11 @@ int32_t komodo_state::NotarizedHeight(int32_t *prevMoMheightp,uint256 *hashp,uin
  */
 int32_t komodo_state::PrevMoMHeight() const
 {
-    static uint256 zero;
-    // shortcut
-    if (last.MoM != zero)
-    {
-        return last.notarized_height;
-    }
-
-    for(auto itr = NPOINTS.rbegin(); itr != NPOINTS.rend(); ++itr)
-    {
-        if( itr->MoM != zero)
-            return itr->notarized_height;
-    }
+    // read from the published snapshot so we neither scan NPOINTS nor race
+    // a concurrent AddCheckpoint
+    auto snap = std::atomic_load(&lastSnapshot);
+    if ( snap != nullptr )
+        return snap->prevMoMheight;
     return 0;
 }
 
@@ -486,17 +557,17 @@ const notarized_checkpoint *komodo_state::CheckpointAtHeight(int32_t height) con
     return nullptr;
 }
 
-void komodo_state::clear_checkpoints() { NPOINTS.clear(); }
+void komodo_state::clear_checkpoints() { NPOINTS.clear(); NPOINTS_MoMheight = 0; PublishLastSnapshot(); }
 const uint256& komodo_state::LastNotarizedHash() const { return last.notarized_hash; }
-void komodo_state::SetLastNotarizedHash(const uint256 &in) { last.notarized_hash = in; }
+void komodo_state::SetLastNotarizedHash(const uint256 &in) { last.notarized_hash = in; PublishLastSnapshot(); }
 const uint256& komodo_state::LastNotarizedDestTxId() const { return last.notarized_desttxid; }
-void komodo_state::SetLastNotarizedDestTxId(const uint256 &in) { last.notarized_desttxid = in; }
+void komodo_state::SetLastNotarizedDestTxId(const uint256 &in) { last.notarized_desttxid = in; PublishLastSnapshot(); }
 const uint256& komodo_state::LastNotarizedMoM() const { return last.MoM; }
-void komodo_state::SetLastNotarizedMoM(const uint256 &in) { last.MoM = in; }
+void komodo_state::SetLastNotarizedMoM(const uint256 &in) { last.MoM = in; PublishLastSnapshot(); }
 const int32_t& komodo_state::LastNotarizedHeight() const { return last.notarized_height; }
-void komodo_state::SetLastNotarizedHeight(const int32_t in) { last.notarized_height = in; }
+void komodo_state::SetLastNotarizedHeight(const int32_t in) { last.notarized_height = in; PublishLastSnapshot(); }
 const int32_t& komodo_state::LastNotarizedMoMDepth() const { return last.MoMdepth; }
-void komodo_state::SetLastNotarizedMoMDepth(const int32_t in) { last.MoMdepth =in; }
+void komodo_state::SetLastNotarizedMoMDepth(const int32_t in) { last.MoMdepth = in; PublishLastSnapshot(); }
 uint64_t komodo_state::NumCheckpoints() const { return NPOINTS.size(); }
 
 bool operator==(const notarized_checkpoint& lhs, const notarized_checkpoint& rhs)
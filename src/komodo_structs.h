@@ -268,6 +268,19 @@ struct komodo_ccdata
     char symbol[65];
 };
 
+/***
+ * Immutable snapshot of the latest notarization, published RCU-style:
+ * writers build a fresh copy under komodo_mutex and swap the pointer in,
+ * readers pin the current copy with an atomic shared_ptr load and never
+ * take the state lock; a superseded copy is reclaimed when its last
+ * reader releases it.
+ */
+struct last_notarized_snapshot
+{
+    notarized_checkpoint last;
+    int32_t prevMoMheight = 0;
+};
+
 class komodo_state
 {
 public:
@@ -304,7 +317,16 @@ protected:
     void clear_checkpoints();
     std::vector<notarized_checkpoint> NPOINTS; // collection of notarizations
     mutable size_t NPOINTS_last_index = 0; // caches checkpoint linear search position
+    bool NPOINTS_sorted = true; // whether NPOINTS is ordered by nHeight (enables binary search)
+    int32_t NPOINTS_MoMheight = 0; // latest checkpoint height with a MoM, maintained incrementally
     notarized_checkpoint last;
+    std::shared_ptr<const last_notarized_snapshot> lastSnapshot; // see last_notarized_snapshot
+
+    /***
+     * @brief rebuild the last-notarization snapshot from the current members
+     * @note call after every mutation of `last` or NPOINTS_MoMheight
+     */
+    void PublishLastSnapshot();
 
 public:
     const uint256 &LastNotarizedHash() const;
@@ -326,6 +348,16 @@ public:
 
     uint64_t NumCheckpoints() const;
 
+    /** Read-only view of the notarization checkpoints, for state snapshots. */
+    const std::vector<notarized_checkpoint> &Checkpoints() const { return NPOINTS; }
+
+    /*****
+     * @brief replace the checkpoint collection from a snapshot
+     * @param in the checkpoints, in insertion order
+     * @param lastIn the last notarization values at snapshot time
+     */
+    void RestoreCheckpoints(const std::vector<notarized_checkpoint> &in, const notarized_checkpoint &lastIn);
+
     /****
      * Get the notarization data below a particular height
      * @param[in] nHeight the height desired
@@ -995,6 +995,18 @@ void set_kmd_user_password_port(const std::string& ltc_config_filename)
     }
 }
 
+void CCDispatchInit(); // cc/eval.cpp
+
+/****
+ * @brief derive this chain's parameters (magic, ports, supply, CC flags) from
+ *        the -ac_ arguments
+ * @note runs exactly once per process before init; the magic/port derivation
+ *       is a single hash over the packed parameters, so there is nothing to
+ *       cache across restarts, and the old PAX price tables this used to
+ *       allocate are gone entirely
+ * @param argv0 the executable name, used to infer a chain name from renamed
+ *        binaries
+ */
 void komodo_args(char *argv0)
 {
     uint8_t extrabuf[32756];
@@ -1686,13 +1698,14 @@ void komodo_args(char *argv0)
     else 
         BITCOIND_RPCPORT = GetArg("-rpcport", BaseParams().RPCPort());
     KOMODO_DPOWCONFS = GetArg("-dpowconfs",dpowconfs);
-    if ( chainName.isKMD() 
-            || chainName.isSymbol("SUPERNET") 
-            || chainName.isSymbol("DEX") 
-            || chainName.isSymbol("COQUI") 
-            || chainName.isSymbol("PIRATE") 
+    if ( chainName.isKMD()
+            || chainName.isSymbol("SUPERNET")
+            || chainName.isSymbol("DEX")
+            || chainName.isSymbol("COQUI")
+            || chainName.isSymbol("PIRATE")
             || chainName.isSymbol("KMDICE") )
         KOMODO_EXTRASATOSHI = 1;
+    CCDispatchInit(); // the enable/activation args are final, resolve the CC dispatch tables
 }
 
 /***
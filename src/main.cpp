@@ -26,12 +26,15 @@
 #include "addrman.h"
 #include "alert.h"
 #include "arith_uint256.h"
+#include "blockencodings.h"
+#include "blockfilter.h"
 #include "importcoin.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "Gulden/auto_checkpoints.h"
 #include "checkqueue.h"
 #include "consensus/upgrades.h"
+#include "crypto/common.h"
 #include "consensus/validation.h"
 #include "deprecation.h"
 #include "init.h"
@@ -41,6 +44,9 @@
 #include "net.h"
 #include "pow.h"
 #include "script/interpreter.h"
+#include "oraclesdb.h"
+#include "tokensdb.h"
+#include "trace.h"
 #include "txdb.h"
 #include "txmempool.h"
 #include "ui_interface.h"
@@ -65,11 +71,20 @@
 #include <cstring>
 #include <algorithm>
 #include <atomic>
+#include <deque>
+#include <limits>
+#include <list>
 #include <sstream>
 #include <map>
 #include <unordered_map>
 #include <vector>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
@@ -94,8 +109,46 @@ CCriticalSection cs_main;
 int32_t KOMODO_NEWBLOCKS;
 
 BlockMap mapBlockIndex;
+
+/** Backing storage for every CBlockIndex reachable from mapBlockIndex.
+ * Deques give chunked, mostly contiguous placement (better locality than one
+ * malloc per entry) and stable element addresses; entries are never freed
+ * individually, UnloadBlockIndex drops them all at once. */
+static std::list<std::deque<CBlockIndex> > vBlockIndexArenas;
+
+CBlockIndex* NewBlockIndex()
+{
+    if (vBlockIndexArenas.empty())
+        vBlockIndexArenas.push_back(std::deque<CBlockIndex>());
+    vBlockIndexArenas.back().emplace_back();
+    return &vBlockIndexArenas.back().back();
+}
+
+CBlockIndex* NewBlockIndex(const CBlockHeader& block)
+{
+    if (vBlockIndexArenas.empty())
+        vBlockIndexArenas.push_back(std::deque<CBlockIndex>());
+    vBlockIndexArenas.back().emplace_back(block);
+    return &vBlockIndexArenas.back().back();
+}
+
+void AdoptBlockIndexArena(std::deque<CBlockIndex>& arena)
+{
+    // Moving the deque keeps every element where it is, so pointers handed
+    // out by the loader stay valid.
+    vBlockIndexArenas.push_back(std::deque<CBlockIndex>());
+    vBlockIndexArenas.back().swap(arena);
+}
+
+void FreeBlockIndexArenas()
+{
+    vBlockIndexArenas.clear();
+}
+
 CChain chainActive;
 CBlockIndex *pindexBestHeader = NULL;
+std::atomic<uint64_t> nChainTipSequence{0};
+std::atomic<CBlockIndex*> pindexPublishedTip{NULL};
 static int64_t nTimeBestReceived = 0;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
@@ -105,6 +158,8 @@ bool fImporting = false;
 bool fReindex = false;
 bool fTxIndex = false;
 bool fAddressIndex = false;
+bool fAddressHeightIndex = false;
+bool fBlockFilterIndex = false;
 bool fTimestampIndex = false;
 bool fSpentIndex = false;
 bool fHavePruned = false;
@@ -112,8 +167,10 @@ bool fPruneMode = false;
 bool fIsBareMultisigStd = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = true;
+bool fAssumeNotarized = true;
 bool fCoinbaseEnforcedProtectionEnabled = true;
 size_t nCoinCacheUsage = 5000 * 300;
+size_t nCoinCacheUsageConfigured = 0;
 uint64_t nPruneTarget = 0;
 bool fAlerts = DEFAULT_ALERTS;
 /* If the tip is older than this (in seconds), the node is considered to be in initial block download.
@@ -131,11 +188,25 @@ CTxMemPool tmpmempool(::minRelayTxFee);
 struct COrphanTx {
     CTransaction tx;
     NodeId fromPeer;
+    int64_t nTimeExpire;
 };
 map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(cs_main);;
-map<uint256, set<uint256> > mapOrphanTransactionsByPrev GUARDED_BY(cs_main);;
+map<COutPoint, set<uint256> > mapOrphanTransactionsByPrev GUARDED_BY(cs_main);;
+map<NodeId, set<uint256> > mapOrphanTransactionsByPeer GUARDED_BY(cs_main);;
 void EraseOrphansFor(NodeId peer) REQUIRES(cs_main);
 
+/** Expire orphan transactions whose parents have not shown up within this long */
+static const int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
+/** Minimum time between orphan expiry sweeps */
+static const int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
+/** No single peer may occupy more than this many orphan slots */
+static const unsigned int ORPHAN_TX_PER_PEER_LIMIT = 25;
+
+/** Compact blocks waiting for their blocktxn response, by block hash */
+map<uint256, pair<NodeId, PartiallyDownloadedBlock> > mapPartialBlocks GUARDED_BY(cs_main);
+/** Version of the compact block protocol we negotiate via sendcmpct */
+static const uint64_t CMPCTBLOCK_VERSION = 1;
+
 /**
  * Returns true if there are nRequired or more blocks of minVersion or above
  * in the last Consensus::Params::nMajorityWindow blocks, starting at pstart and going backwards.
@@ -259,6 +330,17 @@ namespace {
     std::unique_ptr<CRollingBloomFilter> recentRejects;
     uint256 hashRecentRejectsChainTip;
 
+    /**
+     * Outpoints spent by recently accepted transactions and recently
+     * connected blocks. The tx message handler consults this before
+     * validation: a hit is confirmed against mempool.mapNextTx under the
+     * mempool lock only, so floods of conflicting transactions are dropped
+     * without ever contending for cs_main. Guarded by its own leaf lock.
+     * Sized for roughly four worst-case blocks of inputs.
+     */
+    CCriticalSection cs_recentlySpent;
+    std::unique_ptr<CRollingBloomFilter> recentlySpentFilter;
+
     /** Blocks that are in flight, and that are in the queue to be downloaded. Protected by cs_main. */
     struct QueuedBlock {
         uint256 hash;
@@ -327,8 +409,24 @@ namespace {
         list<QueuedBlock> vBlocksInFlight;
         int nBlocksInFlight;
         int nBlocksInFlightValidHeaders;
+        //! Adaptive in-flight block window, scaled with the measured bandwidth-delay product.
+        int nDownloadWindow;
+        //! Smoothed request-to-receipt latency of block downloads (microseconds), 0 when unmeasured.
+        int64_t nBlockLatencyUsec;
+        //! Smoothed block arrival rate (blocks per second), 0 when unmeasured.
+        double dBlockRate;
+        //! Arrival time of the previous block from this peer (microseconds), for rate estimation.
+        int64_t nLastBlockReceived;
         //! Whether we consider this a preferred download peer.
         bool fPreferredDownload;
+        //! Whether this peer is an inbound connection.
+        bool fInbound;
+        //! Txids this peer has announced (for cleanup on disconnect).
+        std::set<uint256> setTxAnnounced;
+        //! Transaction requests in flight to this peer, with send time.
+        std::map<uint256, int64_t> mapTxInFlight;
+        //! Transaction requests assigned to this peer but not yet sent.
+        std::vector<uint256> vTxGetData;
 
         CNodeState() {
             fCurrentlyConnected = false;
@@ -341,7 +439,12 @@ namespace {
             nStallingSince = 0;
             nBlocksInFlight = 0;
             nBlocksInFlightValidHeaders = 0;
+            nDownloadWindow = MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+            nBlockLatencyUsec = 0;
+            dBlockRate = 0.0;
+            nLastBlockReceived = 0;
             fPreferredDownload = false;
+            fInbound = false;
         }
     };
 
@@ -384,11 +487,121 @@ namespace {
         return nTime + 500000 * consensusParams.nPowTargetSpacing * (4 + nValidatedQueuedBefore);
     }
 
+    /** Limit on transaction getdata requests in flight to a single peer. */
+    static const size_t MAX_PEER_TX_IN_FLIGHT = 100;
+    /** Limit on announced txids tracked per peer for disconnect cleanup. */
+    static const size_t MAX_PEER_TX_ANNOUNCEMENTS = 5000;
+    /** A peer that sat on a transaction request this long loses it. */
+    static const int64_t TX_REQUEST_TIMEOUT_MICROS = 60 * 1000000;
+
+    /** Download state of one announced transaction. */
+    struct CTxRequest {
+        //! Peers that have announced the transaction.
+        std::set<NodeId> announcers;
+        //! Peer the request is assigned to, or -1.
+        NodeId nRequestedFrom;
+
+        CTxRequest() : nRequestedFrom(-1) {}
+    };
+
+    /** Per-txid transaction request tracker. Requires cs_main. */
+    map<uint256, CTxRequest> mapTxRequests;
+
+    //! Assign a pending transaction request to the best announcer: outbound
+    //! peers are preferred over inbound, the least loaded peer breaks ties,
+    //! and peers at their in-flight cap are passed over entirely.
+    void RequestTxFrom(const uint256& hash, CTxRequest& req)
+    {
+        NodeId best = -1;
+        bool fBestOutbound = false;
+        size_t nBestLoad = 0;
+        BOOST_FOREACH(NodeId nodeid, req.announcers)
+        {
+            CNodeState* s = State(nodeid);
+            if (s == NULL)
+                continue;
+            size_t nLoad = s->mapTxInFlight.size() + s->vTxGetData.size();
+            if (nLoad >= MAX_PEER_TX_IN_FLIGHT)
+                continue;
+            bool fOutbound = !s->fInbound;
+            if (best == -1 || (fOutbound && !fBestOutbound) ||
+                (fOutbound == fBestOutbound && nLoad < nBestLoad))
+            {
+                best = nodeid;
+                fBestOutbound = fOutbound;
+                nBestLoad = nLoad;
+            }
+        }
+        req.nRequestedFrom = best;
+        if (best != -1)
+            State(best)->vTxGetData.push_back(hash);
+    }
+
+    //! Record that a peer announced a transaction; request it at once if no
+    //! request is in flight elsewhere.
+    void TxRequestAnnounced(NodeId nodeid, const uint256& hash)
+    {
+        CNodeState* s = State(nodeid);
+        if (s == NULL)
+            return;
+        CTxRequest& req = mapTxRequests[hash];
+        if (s->setTxAnnounced.size() < MAX_PEER_TX_ANNOUNCEMENTS)
+        {
+            req.announcers.insert(nodeid);
+            s->setTxAnnounced.insert(hash);
+        }
+        else if (req.announcers.empty())
+            req.announcers.insert(nodeid); // over cap: still usable, just untracked
+        if (req.nRequestedFrom == -1)
+            RequestTxFrom(hash, req);
+    }
+
+    //! Drop tracking for a transaction we received or no longer want.
+    void TxRequestCompleted(const uint256& hash)
+    {
+        map<uint256, CTxRequest>::iterator it = mapTxRequests.find(hash);
+        if (it == mapTxRequests.end())
+            return;
+        if (it->second.nRequestedFrom != -1)
+        {
+            CNodeState* s = State(it->second.nRequestedFrom);
+            if (s)
+                s->mapTxInFlight.erase(hash);
+        }
+        // Stale hashes left in announcers' setTxAnnounced miss the map on
+        // disconnect and are skipped there
+        mapTxRequests.erase(it);
+    }
+
+    //! A peer failed to deliver (notfound, timeout or disconnect): fail over
+    //! to another announcer immediately instead of waiting out a retry timer.
+    void TxRequestFailed(NodeId nodeid, const uint256& hash)
+    {
+        map<uint256, CTxRequest>::iterator it = mapTxRequests.find(hash);
+        if (it == mapTxRequests.end())
+            return;
+        CTxRequest& req = it->second;
+        req.announcers.erase(nodeid);
+        if (req.nRequestedFrom != nodeid)
+            return;
+        CNodeState* s = State(nodeid);
+        if (s)
+            s->mapTxInFlight.erase(hash);
+        req.nRequestedFrom = -1;
+        if (req.announcers.empty())
+        {
+            mapTxRequests.erase(it);
+            return;
+        }
+        RequestTxFrom(hash, req);
+    }
+
     void InitializeNode(NodeId nodeid, const CNode *pnode) {
         LOCK(cs_main);
         CNodeState &state = mapNodeState.insert(std::make_pair(nodeid, CNodeState())).first->second;
         state.name = pnode->addrName;
         state.address = pnode->addr;
+        state.fInbound = pnode->fInbound;
     }
 
     void FinalizeNode(NodeId nodeid) {
@@ -405,6 +618,21 @@ namespace {
         BOOST_FOREACH(const QueuedBlock& entry, state->vBlocksInFlight)
         mapBlocksInFlight.erase(entry.hash);
         EraseOrphansFor(nodeid);
+        {
+            // Reassign this peer's transaction requests before dropping it
+            std::vector<uint256> vCleanup(state->setTxAnnounced.begin(), state->setTxAnnounced.end());
+            for (map<uint256, int64_t>::iterator it = state->mapTxInFlight.begin(); it != state->mapTxInFlight.end(); ++it)
+                vCleanup.push_back(it->first);
+            vCleanup.insert(vCleanup.end(), state->vTxGetData.begin(), state->vTxGetData.end());
+            BOOST_FOREACH(const uint256& hash, vCleanup)
+                TxRequestFailed(nodeid, hash);
+        }
+        for (map<uint256, pair<NodeId, PartiallyDownloadedBlock> >::iterator it = mapPartialBlocks.begin(); it != mapPartialBlocks.end();) {
+            if (it->second.first == nodeid)
+                mapPartialBlocks.erase(it++);
+            else
+                ++it;
+        }
         nPreferredDownload -= state->fPreferredDownload;
 
         mapNodeState.erase(nodeid);
@@ -422,12 +650,40 @@ namespace {
          pcoinsTip->Uncache(removed);*/
     }
 
+    // Requires cs_main.
+    // Fold one completed block download into the peer's latency and rate
+    // estimates, and rescale its in-flight window toward the measured
+    // bandwidth-delay product so high-bandwidth, high-latency links are kept
+    // full during IBD instead of idling between fixed-size batches.
+    void UpdateBlockDownloadWindow(CNodeState* state, int64_t nRequestTime)
+    {
+        int64_t nNow = GetTimeMicros();
+        int64_t nLatency = nNow - nRequestTime;
+        if (nLatency > 0)
+            state->nBlockLatencyUsec = state->nBlockLatencyUsec == 0 ? nLatency : (7 * state->nBlockLatencyUsec + nLatency) / 8;
+        if (state->nLastBlockReceived > 0 && nNow > state->nLastBlockReceived) {
+            double dRate = 1000000.0 / (nNow - state->nLastBlockReceived);
+            state->dBlockRate = state->dBlockRate == 0.0 ? dRate : (7 * state->dBlockRate + dRate) / 8;
+        }
+        state->nLastBlockReceived = nNow;
+
+        // Chase 1.5x the bandwidth-delay product in blocks, within fixed bounds.
+        if (state->nBlockLatencyUsec > 0 && state->dBlockRate > 0.0) {
+            int nWindow = (int)(state->dBlockRate * (state->nBlockLatencyUsec / 1000000.0) * 3 / 2);
+            state->nDownloadWindow = std::max(MAX_BLOCKS_IN_TRANSIT_PER_PEER, std::min(nWindow, MAX_BLOCKS_IN_TRANSIT_DYNAMIC));
+        }
+    }
+
     // Requires cs_main.
     // Returns a bool indicating whether we requested this block.
-    bool MarkBlockAsReceived(const uint256& hash) {
+    // fMeasure is cleared when a stalled request is being taken back, so the
+    // stall does not pollute the peer's latency estimate.
+    bool MarkBlockAsReceived(const uint256& hash, bool fMeasure = true) {
         map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
         if (itInFlight != mapBlocksInFlight.end()) {
             CNodeState *state = State(itInFlight->second.first);
+            if (fMeasure)
+                UpdateBlockDownloadWindow(state, itInFlight->second.second->nTime);
             nQueuedValidatedHeaders -= itInFlight->second.second->fValidatedHeaders;
             state->nBlocksInFlightValidHeaders -= itInFlight->second.second->fValidatedHeaders;
             state->vBlocksInFlight.erase(itInFlight->second.second);
@@ -654,7 +910,7 @@ CBlockTreeDB *pblocktree = nullptr;
 
 #include "komodo.h"
 
-UniValue komodo_snapshot(int top)
+UniValue komodo_snapshot(int top, int from)
 {
     LOCK(cs_main);
     int64_t total = -1;
@@ -662,7 +918,7 @@ UniValue komodo_snapshot(int top)
 
     if (fAddressIndex) {
 	    if ( pblocktree != nullptr ) {
-		result = pblocktree->Snapshot(top);
+		result = pblocktree->Snapshot(top, from);
 	    } else {
 		fprintf(stderr,"null pblocktree start with -addressindex=1\n");
 	    }
@@ -683,6 +939,36 @@ bool komodo_snapshot2(std::map <std::string, CAmount> &addressAmounts)
 
 int32_t lastSnapShotHeight = 0;
 std::vector <std::pair<CAmount, CTxDestination>> vAddressSnapshot;
+//! full address->balance table as of lastSnapShotHeight, rolled forward one
+//! interval at a time so repeat snapshots skip the full UTXO walk
+static std::map <std::string, int64_t> snapshotAddressAmounts;
+
+//! apply one connected block's balance deltas to a snapshot table
+static bool komodo_snapshot_applyblock(std::map <std::string, int64_t> &addressAmounts, int32_t nHeight)
+{
+    CBlockIndex *pindex; CBlock block; CTxDestination vDest;
+    if ( (pindex= komodo_chainactive(nHeight)) == 0 || komodo_blockload(block, pindex) != 0 )
+        return false;
+    for (const CTransaction &tx : block.vtx)
+    {
+        for (unsigned int j = 0; j < tx.vin.size(); j++)
+        {
+            uint256 blockhash; CTransaction txin;
+            if ( !tx.IsCoinImport() && !tx.IsCoinBase() && myGetTransaction(tx.vin[j].prevout.hash,txin,blockhash) )
+            {
+                int vout = tx.vin[j].prevout.n;
+                if ( ExtractDestination(txin.vout[vout].scriptPubKey, vDest) )
+                    addressAmounts[CBitcoinAddress(vDest).ToString()] -= txin.vout[vout].nValue;
+            }
+        }
+        for (unsigned int k = 0; k < tx.vout.size(); k++)
+        {
+            if ( ExtractDestination(tx.vout[k].scriptPubKey, vDest) )
+                addressAmounts[CBitcoinAddress(vDest).ToString()] += tx.vout[k].nValue;
+        }
+    }
+    return true;
+}
 
 bool komodo_dailysnapshot(int32_t height)
 {
@@ -714,46 +1000,68 @@ bool komodo_dailysnapshot(int32_t height)
     if ( undo_height == lastSnapShotHeight )
         return true;
     std::map <std::string, int64_t> addressAmounts;
-    if ( !komodo_snapshot2(addressAmounts) )
-        return false;
-
-    // undo blocks in reverse order
-    for (int32_t n = height; n > undo_height; n--) 
+    if ( lastSnapShotHeight > 0 && undo_height > lastSnapShotHeight && !snapshotAddressAmounts.empty() )
+    {
+        // roll the previous snapshot forward one interval instead of walking
+        // the whole UTXO set again; blocks at or below undo_height are behind
+        // the last notarization or the reorg limit, so their deltas are final
+        addressAmounts = snapshotAddressAmounts;
+        for (int32_t n = lastSnapShotHeight+1; n <= undo_height; n++)
+        {
+            if ( !komodo_snapshot_applyblock(addressAmounts, n) )
+                return false;
+        }
+        for (std::map <std::string, int64_t>::iterator it = addressAmounts.begin(); it != addressAmounts.end(); )
+        {
+            if ( it->second < 1 )
+                it = addressAmounts.erase(it);
+            else it++;
+        }
+    }
+    else
     {
-        CBlockIndex *pindex; CBlock block;
-        if ( (pindex= komodo_chainactive(n)) == 0 || komodo_blockload(block, pindex) != 0 ) 
+        if ( !komodo_snapshot2(addressAmounts) )
             return false;
-        // undo transactions in reverse order
-        for (int32_t i = block.vtx.size() - 1; i >= 0; i--) 
+
+        // undo blocks in reverse order
+        for (int32_t n = height; n > undo_height; n--)
         {
-            const CTransaction &tx = block.vtx[i];
-            CTxDestination vDest; 
-            // loop vouts reverse order, remove value recieved.
-            for (unsigned int k = tx.vout.size(); k-- > 0;) 
+            CBlockIndex *pindex; CBlock block;
+            if ( (pindex= komodo_chainactive(n)) == 0 || komodo_blockload(block, pindex) != 0 )
+                return false;
+            // undo transactions in reverse order
+            for (int32_t i = block.vtx.size() - 1; i >= 0; i--)
             {
-                const CTxOut &out = tx.vout[k];
-                if ( ExtractDestination(out.scriptPubKey, vDest) )
+                const CTransaction &tx = block.vtx[i];
+                CTxDestination vDest;
+                // loop vouts reverse order, remove value recieved.
+                for (unsigned int k = tx.vout.size(); k-- > 0;)
                 {
-                    addressAmounts[CBitcoinAddress(vDest).ToString()] -= out.nValue;
-                    if ( addressAmounts[CBitcoinAddress(vDest).ToString()] < 1 )
-                        addressAmounts.erase(CBitcoinAddress(vDest).ToString());
-                } 
-            }
-            // loop vins in reverse order, get prevout and return the sent balance.
-            for (unsigned int j = tx.vin.size(); j-- > 0;) 
-            {
-                uint256 blockhash; CTransaction txin;
-                if ( !tx.IsCoinImport() && !tx.IsCoinBase() && myGetTransaction(tx.vin[j].prevout.hash,txin,blockhash) ) 
+                    const CTxOut &out = tx.vout[k];
+                    if ( ExtractDestination(out.scriptPubKey, vDest) )
+                    {
+                        addressAmounts[CBitcoinAddress(vDest).ToString()] -= out.nValue;
+                        if ( addressAmounts[CBitcoinAddress(vDest).ToString()] < 1 )
+                            addressAmounts.erase(CBitcoinAddress(vDest).ToString());
+                    }
+                }
+                // loop vins in reverse order, get prevout and return the sent balance.
+                for (unsigned int j = tx.vin.size(); j-- > 0;)
                 {
-                    int vout = tx.vin[j].prevout.n;
-                    if ( ExtractDestination(txin.vout[vout].scriptPubKey, vDest) )
+                    uint256 blockhash; CTransaction txin;
+                    if ( !tx.IsCoinImport() && !tx.IsCoinBase() && myGetTransaction(tx.vin[j].prevout.hash,txin,blockhash) )
                     {
-                        addressAmounts[CBitcoinAddress(vDest).ToString()] += txin.vout[vout].nValue;
+                        int vout = tx.vin[j].prevout.n;
+                        if ( ExtractDestination(txin.vout[vout].scriptPubKey, vDest) )
+                        {
+                            addressAmounts[CBitcoinAddress(vDest).ToString()] += txin.vout[vout].nValue;
+                        }
                     }
                 }
             }
         }
     }
+    snapshotAddressAmounts = addressAmounts; // base for the next incremental roll
     vAddressSnapshot.clear(); // clear existing snapshot
     // convert address string to destination for easier conversion to what ever is required, eg, scriptPubKey. 
     for ( auto element : addressAmounts)
@@ -772,6 +1080,30 @@ bool komodo_dailysnapshot(int32_t height)
 // mapOrphanTransactions
 //
 
+void static EraseOrphanTx(uint256 hash) REQUIRES(cs_main)
+{
+    map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.find(hash);
+    if (it == mapOrphanTransactions.end())
+        return;
+    BOOST_FOREACH(const CTxIn& txin, it->second.tx.vin)
+    {
+        map<COutPoint, set<uint256> >::iterator itPrev = mapOrphanTransactionsByPrev.find(txin.prevout);
+        if (itPrev == mapOrphanTransactionsByPrev.end())
+            continue;
+        itPrev->second.erase(hash);
+        if (itPrev->second.empty())
+            mapOrphanTransactionsByPrev.erase(itPrev);
+    }
+    map<NodeId, set<uint256> >::iterator itPeer = mapOrphanTransactionsByPeer.find(it->second.fromPeer);
+    if (itPeer != mapOrphanTransactionsByPeer.end())
+    {
+        itPeer->second.erase(hash);
+        if (itPeer->second.empty())
+            mapOrphanTransactionsByPeer.erase(itPeer);
+    }
+    mapOrphanTransactions.erase(it);
+}
+
 bool AddOrphanTx(const CTransaction& tx, NodeId peer) REQUIRES(cs_main)
 {
     uint256 hash = tx.GetHash();
@@ -792,43 +1124,51 @@ bool AddOrphanTx(const CTransaction& tx, NodeId peer) REQUIRES(cs_main)
         return false;
     }
 
-    mapOrphanTransactions[hash].tx = tx;
-    mapOrphanTransactions[hash].fromPeer = peer;
+    // Per-peer quota: a peer flooding orphans evicts its own oldest entry,
+    // instead of pushing other peers' orphans out of the shared pool
+    {
+        map<NodeId, set<uint256> >::iterator itPeer = mapOrphanTransactionsByPeer.find(peer);
+        if (itPeer != mapOrphanTransactionsByPeer.end() && itPeer->second.size() >= ORPHAN_TX_PER_PEER_LIMIT)
+        {
+            uint256 oldest;
+            int64_t nOldestExpire = std::numeric_limits<int64_t>::max();
+            BOOST_FOREACH(const uint256& orphanHash, itPeer->second)
+            {
+                const COrphanTx& orphan = mapOrphanTransactions[orphanHash];
+                if (orphan.nTimeExpire < nOldestExpire)
+                {
+                    nOldestExpire = orphan.nTimeExpire;
+                    oldest = orphanHash;
+                }
+            }
+            EraseOrphanTx(oldest);
+        }
+    }
+
+    COrphanTx& orphan = mapOrphanTransactions[hash];
+    orphan.tx = tx;
+    orphan.fromPeer = peer;
+    orphan.nTimeExpire = GetTime() + ORPHAN_TX_EXPIRE_TIME;
     BOOST_FOREACH(const CTxIn& txin, tx.vin)
-    mapOrphanTransactionsByPrev[txin.prevout.hash].insert(hash);
+    mapOrphanTransactionsByPrev[txin.prevout].insert(hash);
+    mapOrphanTransactionsByPeer[peer].insert(hash);
 
     LogPrint("mempool", "stored orphan tx %s (mapsz %u prevsz %u)\n", hash.ToString(),
              mapOrphanTransactions.size(), mapOrphanTransactionsByPrev.size());
     return true;
 }
 
-void static EraseOrphanTx(uint256 hash) REQUIRES(cs_main)
-{
-    map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.find(hash);
-    if (it == mapOrphanTransactions.end())
-        return;
-    BOOST_FOREACH(const CTxIn& txin, it->second.tx.vin)
-    {
-        map<uint256, set<uint256> >::iterator itPrev = mapOrphanTransactionsByPrev.find(txin.prevout.hash);
-        if (itPrev == mapOrphanTransactionsByPrev.end())
-            continue;
-        itPrev->second.erase(hash);
-        if (itPrev->second.empty())
-            mapOrphanTransactionsByPrev.erase(itPrev);
-    }
-    mapOrphanTransactions.erase(it);
-}
-
 void EraseOrphansFor(NodeId peer)
 {
     int nErased = 0;
-    map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
-    while (iter != mapOrphanTransactions.end())
+    map<NodeId, set<uint256> >::iterator itPeer = mapOrphanTransactionsByPeer.find(peer);
+    if (itPeer != mapOrphanTransactionsByPeer.end())
     {
-        map<uint256, COrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
-        if (maybeErase->second.fromPeer == peer)
+        // take a copy: EraseOrphanTx edits the per-peer set underneath us
+        vector<uint256> vErase(itPeer->second.begin(), itPeer->second.end());
+        BOOST_FOREACH(const uint256& hash, vErase)
         {
-            EraseOrphanTx(maybeErase->second.tx.GetHash());
+            EraseOrphanTx(hash);
             ++nErased;
         }
     }
@@ -839,6 +1179,29 @@ void EraseOrphansFor(NodeId peer)
 unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans) REQUIRES(cs_main)
 {
     unsigned int nEvicted = 0;
+    static int64_t nNextSweep;
+    int64_t nNow = GetTime();
+    if (nNextSweep <= nNow)
+    {
+        // Sweep out expired orphans, no more than once per interval
+        int nErased = 0;
+        int64_t nMinExpTime = nNow + ORPHAN_TX_EXPIRE_TIME - ORPHAN_TX_EXPIRE_INTERVAL;
+        map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
+        while (iter != mapOrphanTransactions.end())
+        {
+            map<uint256, COrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
+            if (maybeErase->second.nTimeExpire <= nNow)
+            {
+                EraseOrphanTx(maybeErase->first);
+                ++nErased;
+            }
+            else
+                nMinExpTime = std::min(maybeErase->second.nTimeExpire, nMinExpTime);
+        }
+        // Sweep again 5 minutes after the next entry that expires, to batch the linear scan
+        nNextSweep = nMinExpTime + ORPHAN_TX_EXPIRE_INTERVAL;
+        if (nErased > 0) LogPrint("mempool", "Erased %d orphan tx due to expiration\n", nErased);
+    }
     while (mapOrphanTransactions.size() > nMaxOrphans)
     {
         // Evict a random orphan:
@@ -846,8 +1209,8 @@ unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans) REQUIRES(cs_main)
         map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.lower_bound(randomhash);
         if (it == mapOrphanTransactions.end())
             it = mapOrphanTransactions.begin();
-            EraseOrphanTx(it->first);
-            ++nEvicted;
+        EraseOrphanTx(it->first);
+        ++nEvicted;
     }
     return nEvicted;
 }
@@ -1322,6 +1685,7 @@ bool ContextualCheckTransaction(int32_t slowflag,const CBlock *block, CBlockInde
     if (!tx.vShieldedSpend.empty() ||
         !tx.vShieldedOutput.empty())
     {
+        ZC_LoadParamsOnDemand(); // no-op unless the load was deferred on an -ac_public chain
         auto ctx = librustzcash_sapling_verification_ctx_init();
 
         for (const SpendDescription &spend : tx.vShieldedSpend) {
@@ -1421,6 +1785,8 @@ bool CheckTransaction(uint32_t tiptime,const CTransaction& tx, CValidationState
         return false;
     } else {
         // Ensure that zk-SNARKs v|| y
+        if (!tx.vjoinsplit.empty())
+            ZC_LoadParamsOnDemand(); // no-op unless the load was deferred on an -ac_public chain
         BOOST_FOREACH(const JSDescription &joinsplit, tx.vjoinsplit) {
             if (!joinsplit.Verify(*pzcashParams, verifier, tx.joinSplitPubKey)) {
                 return state.DoS(100, error("CheckTransaction(): joinsplit does not verify"),
@@ -1776,8 +2142,196 @@ CAmount GetMinRelayFee(const CTransaction& tx, unsigned int nBytes, bool fAllowF
     return nMinFee;
 }
 
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+
+/**
+ * Script-validated transaction cache. A transaction accepted to the mempool
+ * has already had every input script verified; when the block carrying it
+ * arrives minutes later, ConnectBlock can skip those CScriptChecks entirely.
+ * Entries record the flags a txid verified under for a consensus branch;
+ * since verification flags are soft-forking (each flag only adds failure
+ * cases), a pass under a superset of the requested flags covers the request.
+ */
+static CCriticalSection cs_scriptExecutionCache;
+static std::map<std::pair<uint256, uint32_t>, unsigned int> mapScriptExecutionCache;
+
+/**
+ * Whether a transaction's script verification verdict may be memoized by
+ * txid. Spends of crypto-condition outputs are excluded: their Eval nodes
+ * consult chain state through RunCCEval, so the verdict is not a pure
+ * function of the transaction.
+ */
+static bool ScriptCheckCacheable(const CTransaction& tx, const CCoinsViewCache& inputs)
+{
+    BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+        const CCoins* coins = inputs.AccessCoins(txin.prevout.hash);
+        if (!coins || txin.prevout.n >= coins->vout.size())
+            return false;
+        if (coins->vout[txin.prevout.n].scriptPubKey.IsPayToCryptoCondition())
+            return false;
+    }
+    return true;
+}
+
+static bool ScriptExecutionCacheContains(const uint256& txid, uint32_t consensusBranchId, unsigned int flags)
+{
+    LOCK(cs_scriptExecutionCache);
+    std::map<std::pair<uint256, uint32_t>, unsigned int>::const_iterator it =
+        mapScriptExecutionCache.find(std::make_pair(txid, consensusBranchId));
+    return it != mapScriptExecutionCache.end() && (it->second & flags) == flags;
+}
+
+static void ScriptExecutionCacheInsert(const uint256& txid, uint32_t consensusBranchId, unsigned int flags)
+{
+    // Entries are a txid plus two words; the sigcache default bound keeps
+    // this under a few MB.
+    int64_t nMaxCacheSize = GetArg("-maxscriptcachesize", 50000);
+    if (nMaxCacheSize <= 0) return;
+
+    LOCK(cs_scriptExecutionCache);
+
+    while (static_cast<int64_t>(mapScriptExecutionCache.size()) >= nMaxCacheSize)
+    {
+        // Evict a random entry, for the same DoS reasons as the signature
+        // cache: an attacker must not be able to predict what stays cached.
+        std::map<std::pair<uint256, uint32_t>, unsigned int>::iterator it =
+            mapScriptExecutionCache.lower_bound(std::make_pair(GetRandHash(), 0));
+        if (it == mapScriptExecutionCache.end())
+            it = mapScriptExecutionCache.begin();
+        mapScriptExecutionCache.erase(it);
+    }
+
+    std::map<std::pair<uint256, uint32_t>, unsigned int>::iterator it =
+        mapScriptExecutionCache.find(std::make_pair(txid, consensusBranchId));
+    if (it == mapScriptExecutionCache.end())
+        mapScriptExecutionCache[std::make_pair(txid, consensusBranchId)] = flags;
+    else if ((flags & it->second) == it->second)
+        // Only widen an entry to a superset of what it already recorded;
+        // a union of two separately verified flag sets is not itself verified.
+        it->second = flags;
+}
+
+/**
+ * Speculative next-block script verification. When a block extending the
+ * current tip arrives, its input scripts can be verified before
+ * ActivateBestChain ever runs: the verdict of a cacheable script check
+ * depends only on the transaction, the spent outputs and the verification
+ * flags, none of which change with the outcome of the tip race. A single
+ * background thread verifies the block's transactions that the mempool has
+ * not already covered and records passing txids in the script execution
+ * cache, overlapping the ECDSA work with CheckBlock's proof-of-work and
+ * AcceptBlock's disk write. ConnectBlock picks up whatever finished in time
+ * and verifies the rest itself; if the block loses the race the cache
+ * entries are simply never consulted, so no chain state is ever touched.
+ */
+struct CSpeculativeCheckJob {
+    CBlock block;
+    //! Spent outputs per transaction, parallel to block.vtx; an empty inner
+    //! vector means the transaction is skipped (mint, uncacheable, or the
+    //! mempool already verified it).
+    std::vector<std::vector<CCoins> > vCoins;
+    unsigned int nFlags;
+    uint32_t consensusBranchId;
+};
+
+static std::atomic<bool> fSpeculativeCheckRunning(false);
+
+static void SpeculativeScriptCheckThread(std::shared_ptr<CSpeculativeCheckJob> job)
+{
+    RenameThread("zcash-specck");
+    for (size_t i = 0; i < job->block.vtx.size(); i++) {
+        const CTransaction &tx = job->block.vtx[i];
+        const std::vector<CCoins> &vCoins = job->vCoins[i];
+        if (vCoins.empty())
+            continue;
+        PrecomputedTransactionData txdata(tx);
+        bool fOk = true;
+        for (unsigned int n = 0; n < tx.vin.size() && fOk; n++) {
+            CScriptCheck check(vCoins[n], tx, n, job->nFlags, false, job->consensusBranchId, &txdata);
+            fOk = check();
+        }
+        if (fOk)
+            ScriptExecutionCacheInsert(tx.GetHash(), job->consensusBranchId, job->nFlags);
+        // Failures are left uncached: ConnectBlock owns rejection and the
+        // associated DoS handling.
+    }
+    fSpeculativeCheckRunning = false;
+}
+
+/**
+ * Kick off speculative script verification for a block that extends the
+ * current tip. Caller must hold cs_main; the snapshot of spent outputs is
+ * taken here so the worker thread never touches pcoinsTip.
+ */
+static void SpeculativeVerifyBlockScripts(const CBlock &block)
+{
+    AssertLockHeld(cs_main);
+    if (chainActive.Tip() == NULL || IsInitialBlockDownload())
+        return;
+    if (block.hashPrevBlock != chainActive.Tip()->GetBlockHash())
+        return;
+    bool fExpected = false;
+    if (!fSpeculativeCheckRunning.compare_exchange_strong(fExpected, true))
+        return; // one speculative block at a time
+    std::shared_ptr<CSpeculativeCheckJob> job = std::make_shared<CSpeculativeCheckJob>();
+    job->block = block;
+    // Same flags ConnectBlock verifies under, so the cache entries match.
+    job->nFlags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
+    job->consensusBranchId = CurrentEpochBranchId(chainActive.Tip()->nHeight + 1, Params().GetConsensus());
+    job->vCoins.resize(block.vtx.size());
+    size_t nQueued = 0;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction &tx = block.vtx[i];
+        if (tx.IsMint() || tx.IsCoinImport())
+            continue;
+        // Covers CC spends (chain-state dependent verdicts) and prevouts not
+        // in the tip's view, including ones created earlier in this block.
+        if (!ScriptCheckCacheable(tx, *pcoinsTip))
+            continue;
+        if (ScriptExecutionCacheContains(tx.GetHash(), job->consensusBranchId, job->nFlags))
+            continue;
+        std::vector<CCoins> &vCoins = job->vCoins[i];
+        vCoins.reserve(tx.vin.size());
+        BOOST_FOREACH(const CTxIn &txin, tx.vin)
+            vCoins.push_back(*pcoinsTip->AccessCoins(txin.prevout.hash));
+        nQueued++;
+    }
+    if (nQueued == 0) {
+        fSpeculativeCheckRunning = false;
+        return;
+    }
+    boost::thread t(SpeculativeScriptCheckThread, job);
+    t.detach();
+}
+
+/*****
+ * @brief The stage of transaction validation that needs no chain state
+ *
+ * Runs the purely syntactic consensus checks - CheckTransaction (including
+ * shielded proof verification) and the loose-coinbase rejection - so callers
+ * can filter garbage off the network before ever taking cs_main.
+ * AcceptToMemoryPool repeats these checks under the lock; this is a
+ * prefilter, not a replacement.
+ * @param tx the transaction
+ * @param state receives the rejection reason
+ * @returns true if the transaction passes the lock-free checks
+ */
+bool PrevalidateTransaction(const CTransaction &tx, CValidationState &state)
+{
+    // unsynchronized tip read: CheckTransaction only uses the time for coarse
+    // cutoffs and AcceptToMemoryPool re-runs everything under cs_main
+    CBlockIndex *tip = chainActive.Tip();
+    uint32_t tiptime = (tip != nullptr) ? (uint32_t)tip->nTime : (uint32_t)time(NULL);
+    auto verifier = libzcash::ProofVerifier::Strict();
+    if (!CheckTransaction(tiptime, tx, state, verifier, 0, 0))
+        return error("PrevalidateTransaction: CheckTransaction failed");
+    if (tx.IsCoinBase())
+        return state.DoS(100, error("PrevalidateTransaction: coinbase as individual tx"), REJECT_INVALID, "coinbase");
+    return true;
+}
+
 /*****
- * @brief Try to add transaction to memory pool 
+ * @brief Try to add transaction to memory pool
  * @param pool
  * @param state
  * @param tx
@@ -1785,9 +2339,10 @@ CAmount GetMinRelayFee(const CTransaction& tx, unsigned int nBytes, bool fAllowF
  * @param pfMissingInputs
  * @param fRejectAbsurdFee
  * @param dosLevel
+ * @param nAcceptTime entry timestamp to record (0 = now), set when reloading a saved mempool
  * @returns true on success
  */
-bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,bool* pfMissingInputs, bool fRejectAbsurdFee, int dosLevel)
+static bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,bool* pfMissingInputs, bool fRejectAbsurdFee, int dosLevel, int64_t nAcceptTime)
 {
     AssertLockHeld(cs_main);
     if (pfMissingInputs != nullptr)
@@ -1852,9 +2407,9 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
     {
         return state.DoS(0, false, REJECT_NONSTANDARD, "non-final");
     }
-    // is it already in the memory pool?
+    // is it already in the memory pool (hot or cold tier)?
     uint256 hash = tx.GetHash();
-    if (pool.exists(hash))
+    if (pool.exists(hash) || pool.existsCold(hash))
     {
         return state.Invalid(false, REJECT_DUPLICATE, "already in mempool");
     }
@@ -1865,7 +2420,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
         for (unsigned int i = 0; i < tx.vin.size(); i++)
         {
             COutPoint outpoint = tx.vin[i].prevout;
-            if (pool.mapNextTx.count(outpoint))
+            if (pool.mapNextTx.count(outpoint) || pool.mapColdNextTx.count(outpoint))
             {
                 // Disable replacement feature for now
                 return state.Invalid(false, REJECT_INVALID, "mempool conflict");
@@ -1985,7 +2540,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
         // it has passed ContextualCheckInputs and therefore this is correct.
         auto consensusBranchId = CurrentEpochBranchId(chainActive.Height() + 1, Params().GetConsensus());
         
-        CTxMemPoolEntry entry(tx, nFees, GetTime(), dPriority, chainActive.Height(), mempool.HasNoInputsOf(tx), fSpendsCoinbase, consensusBranchId);
+        CTxMemPoolEntry entry(tx, nFees, nAcceptTime ? nAcceptTime : GetTime(), dPriority, chainActive.Height(), mempool.HasNoInputsOf(tx), fSpendsCoinbase, consensusBranchId);
         unsigned int nSize = entry.GetTxSize();
         
         // Accept a tx if it contains joinsplits and has at least the default fee specified by z_sendmany.
@@ -2044,13 +2599,34 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
 
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
+        // The inputs were copied into the standalone view above, so the script
+        // checks themselves touch no shared state: hand them to the script
+        // verification worker pool instead of grinding through them serially
+        // on the message thread. ConnectBlock is the only other user of the
+        // queue and also runs under cs_main, so the queue is idle here.
         PrecomputedTransactionData txdata(tx);
-        if (!ContextualCheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId))
+        txdata.PrepareSighash(tx, consensusBranchId);
+        bool fParallelScripts = (nScriptCheckThreads != 0);
+        std::vector<CScriptCheck> vChecks;
+        if (!ContextualCheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId, fParallelScripts ? &vChecks : NULL))
         {
             //fprintf(stderr,"accept failure.9\n");
             return error("AcceptToMemoryPool: ConnectInputs failed %s", hash.ToString());
         }
-        
+        if (fParallelScripts && !vChecks.empty())
+        {
+            CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+            control.Add(vChecks);
+            if (!control.Wait())
+            {
+                // The parallel path can't attribute the failure to an input;
+                // repeat serially to recover the exact reason and DoS level
+                if (!ContextualCheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId))
+                    return error("AcceptToMemoryPool: ConnectInputs failed %s", hash.ToString());
+                return state.DoS(100, error("AcceptToMemoryPool: parallel script check failed %s", hash.ToString()),REJECT_INVALID, "mandatory-script-verify-flag-failed");
+            }
+        }
+
         // Check again against just the consensus-critical mandatory script
         // verification flags, in case of bugs in the standard flags that cause
         // transactions to pass as valid when they're actually invalid. For
@@ -2069,15 +2645,33 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
             KOMODO_CONNECTING = (1<<30) + (int32_t)chainActive.Tip()->nHeight + 1;
         }
 
-        if (!ContextualCheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId))
+        vChecks.clear();
+        if (!ContextualCheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId, fParallelScripts ? &vChecks : NULL))
         {
             if ( komodoConnectingSet ) // undo what we did
                 KOMODO_CONNECTING = -1;
             return error("AcceptToMemoryPool: BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s", hash.ToString());
         }
+        if (fParallelScripts && !vChecks.empty())
+        {
+            CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+            control.Add(vChecks);
+            if (!control.Wait())
+            {
+                if ( komodoConnectingSet )
+                    KOMODO_CONNECTING = -1;
+                return error("AcceptToMemoryPool: BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s", hash.ToString());
+            }
+        }
         if ( komodoConnectingSet )
             KOMODO_CONNECTING = -1;
 
+        // The parallel path hands its checks back through pvChecks, so the
+        // memoization inside ContextualCheckInputs never saw the verdict;
+        // record it now that both flag sets have verified.
+        if (fParallelScripts && ScriptCheckCacheable(tx, view))
+            ScriptExecutionCacheInsert(hash, consensusBranchId, STANDARD_SCRIPT_VERIFY_FLAGS);
+
         {
             LOCK(pool.cs);
             // Store transaction in memory
@@ -2099,6 +2693,44 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
     return true;
 }
 
+/** 36-byte filter key for an outpoint: txid followed by the output index */
+static std::vector<unsigned char> SpentFilterKey(const COutPoint &outpoint)
+{
+    std::vector<unsigned char> vKey(36);
+    memcpy(&vKey[0], outpoint.hash.begin(), 32);
+    memcpy(&vKey[32], &outpoint.n, 4);
+    return vKey;
+}
+
+/** Record the outpoints a transaction spends in the recently-spent filter */
+static void SpentFilterAdd(const CTransaction &tx)
+{
+    LOCK(cs_recentlySpent);
+    if (recentlySpentFilter)
+    {
+        BOOST_FOREACH(const CTxIn &txin, tx.vin)
+            recentlySpentFilter->insert(SpentFilterKey(txin.prevout));
+    }
+}
+
+bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,bool* pfMissingInputs, bool fRejectAbsurdFee, int dosLevel, int64_t nAcceptTime)
+{
+    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, fRejectAbsurdFee, dosLevel, nAcceptTime);
+    if (res) {
+        SpentFilterAdd(tx);
+        pool.TrimToBudget();
+        TRACE2(mempool, accepted,
+               tx.GetHash().begin(),
+               (uint64_t)pool.size());
+    } else {
+        TRACE3(mempool, rejected,
+               tx.GetHash().begin(),
+               (int32_t)state.GetRejectCode(),
+               state.GetRejectReason().c_str());
+    }
+    return res;
+}
+
 /****
  * @brief Add a transaction to the memory pool without the checks of AcceptToMemoryPool
  * @param pool the memory pool to add the transaction to
@@ -2115,6 +2747,99 @@ bool CCTxFixAcceptToMemPoolUnchecked(CTxMemPool& pool, const CTransaction &tx)
     return true;
 }
 
+//! Version byte of the mempool.dat format written by DumpMempool
+static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+
+bool LoadMempool()
+{
+    FILE* filestr = fopen((GetDataDir() / "mempool.dat").string().c_str(), "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open mempool file from disk. Continuing anyway.\n");
+        return false;
+    }
+    int64_t count = 0, failed = 0;
+    try {
+        uint64_t version;
+        file >> version;
+        if (version != MEMPOOL_DUMP_VERSION) {
+            return false;
+        }
+        uint64_t num;
+        file >> num;
+        std::vector<std::pair<CTransaction, int64_t> > vtx;
+        vtx.reserve(num);
+        while (num--) {
+            CTransaction tx;
+            int64_t nTime;
+            file >> tx;
+            file >> nTime;
+            vtx.push_back(std::make_pair(tx, nTime));
+        }
+        // restore the fee/priority deltas before re-accepting, so the fee
+        // checks in AcceptToMemoryPool see the prioritisation again
+        std::map<uint256, std::pair<double, CAmount> > mapDeltasLoaded;
+        file >> mapDeltasLoaded;
+        for (std::map<uint256, std::pair<double, CAmount> >::const_iterator it = mapDeltasLoaded.begin(); it != mapDeltasLoaded.end(); ++it) {
+            if (it->second.first != 0 || it->second.second != 0)
+                mempool.PrioritiseTransaction(it->first, it->first.ToString(), it->second.first, it->second.second);
+        }
+        BOOST_FOREACH(const PAIRTYPE(CTransaction, int64_t)& txinfo, vtx) {
+            if (ShutdownRequested())
+                return false;
+            CValidationState state;
+            LOCK(cs_main);
+            if (AcceptToMemoryPool(mempool, state, txinfo.first, true, NULL, false, -1, txinfo.second))
+                ++count;
+            else
+                ++failed;
+            boost::this_thread::interruption_point();
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    LogPrintf("Imported mempool transactions from disk: %i successes, %i failed\n", count, failed);
+    return true;
+}
+
+void DumpMempool()
+{
+    int64_t start = GetTimeMicros();
+    std::map<uint256, std::pair<double, CAmount> > mapDeltasCopy;
+    std::vector<std::pair<CTransaction, int64_t> > vtx;
+    {
+        LOCK(mempool.cs);
+        mapDeltasCopy = mempool.mapDeltas;
+        vtx.reserve(mempool.mapTx.size());
+        for (CTxMemPool::indexed_transaction_set::const_iterator mi = mempool.mapTx.begin(); mi != mempool.mapTx.end(); ++mi)
+            vtx.push_back(std::make_pair(mi->GetTx(), mi->GetTime()));
+    }
+    int64_t mid = GetTimeMicros();
+    try {
+        FILE* filestr = fopen((GetDataDir() / "mempool.dat.new").string().c_str(), "wb");
+        if (!filestr) {
+            LogPrintf("Failed to open mempool file for writing. Continuing anyway.\n");
+            return;
+        }
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        file << MEMPOOL_DUMP_VERSION;
+        file << (uint64_t)vtx.size();
+        BOOST_FOREACH(const PAIRTYPE(CTransaction, int64_t)& txinfo, vtx) {
+            file << txinfo.first;
+            file << txinfo.second;
+        }
+        file << mapDeltasCopy;
+        FileCommit(file.Get());
+        file.fclose();
+        RenameOver(GetDataDir() / "mempool.dat.new", GetDataDir() / "mempool.dat");
+        int64_t last = GetTimeMicros();
+        LogPrintf("Dumped mempool: %gs to copy, %gs to dump\n", (mid-start)*0.000001, (last-mid)*0.000001);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump mempool: %s. Continuing anyway.\n", e.what());
+    }
+}
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes)
 {
     if (!fTimestampIndex)
@@ -2141,17 +2866,54 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 }
 
 bool GetAddressIndex(uint160 addressHash, int type,
-                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end,
+                     size_t nMaxEntries)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end, nMaxEntries))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressIndex(const std::vector<std::pair<uint160, int> > &addresses,
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end,
+                     size_t nMaxEntries)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    if (!pblocktree->ReadAddressIndex(addresses, addressIndex, start, end, nMaxEntries))
         return error("unable to get txids for address");
 
     return true;
 }
 
+bool GetAddressHeightIndex(int start, int end,
+                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex)
+{
+    if (!fAddressHeightIndex)
+        return error("address height index not enabled");
+
+    if (!pblocktree->ReadAddressHeightIndex(start, end, addressIndex))
+        return error("unable to read address height index");
+
+    return true;
+}
+
+bool GetBlockFilter(const uint256 &blockhash, std::vector<unsigned char> &vchFilter)
+{
+    if (!fBlockFilterIndex)
+        return error("block filter index not enabled");
+
+    if (!pblocktree->ReadBlockFilter(blockhash, vchFilter))
+        return error("no block filter for %s", blockhash.ToString());
+
+    return true;
+}
+
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
 {
@@ -2164,6 +2926,72 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     return true;
 }
 
+/** Addresses registered with the watch index (hash/type -> registration time).
+ *  Works without -addressindex and without the wallet; consulted while
+ *  connecting blocks, so membership changes only affect blocks from then on. */
+static CCriticalSection cs_watchedAddresses;
+static std::map<std::pair<uint160, int>, int64_t> mapWatchedAddresses;
+
+static bool IsWatchedAddress(const uint160 &addrHash, int keyType)
+{
+    LOCK(cs_watchedAddresses);
+    return mapWatchedAddresses.count(std::make_pair(addrHash, keyType)) != 0;
+}
+
+static bool HaveWatchedAddresses()
+{
+    LOCK(cs_watchedAddresses);
+    return !mapWatchedAddresses.empty();
+}
+
+bool WatchAddress(const uint160 &addressHash, int type)
+{
+    int64_t nRegistered = GetTime();
+    if (!pblocktree->WriteWatchAddress(addressHash, type, nRegistered))
+        return error("unable to register watch address");
+
+    LOCK(cs_watchedAddresses);
+    mapWatchedAddresses[std::make_pair(addressHash, type)] = nRegistered;
+    return true;
+}
+
+bool UnwatchAddress(const uint160 &addressHash, int type)
+{
+    {
+        LOCK(cs_watchedAddresses);
+        if (mapWatchedAddresses.erase(std::make_pair(addressHash, type)) == 0)
+            return false;
+    }
+    return pblocktree->EraseWatchAddress(addressHash, type);
+}
+
+void GetWatchedAddresses(std::map<std::pair<uint160, int>, int64_t> &addresses)
+{
+    LOCK(cs_watchedAddresses);
+    addresses = mapWatchedAddresses;
+}
+
+bool GetWatchIndex(const std::vector<std::pair<uint160, int> > &addresses,
+                   std::vector<std::pair<CAddressIndexKey, CAmount> > &watchIndex, int start, int end,
+                   size_t nMaxEntries)
+{
+    if (!pblocktree->ReadWatchIndex(addresses, watchIndex, start, end, nMaxEntries))
+        return error("unable to read watch index");
+
+    return true;
+}
+
+bool LoadWatchedAddresses()
+{
+    LOCK(cs_watchedAddresses);
+    mapWatchedAddresses.clear();
+    if (!pblocktree->LoadWatchAddresses(mapWatchedAddresses))
+        return false;
+    if (!mapWatchedAddresses.empty())
+        LogPrintf("%s: watching %u addresses\n", __func__, mapWatchedAddresses.size());
+    return true;
+}
+
 /****
  * @brief add a transaction to the mempool
  * @param[in] tx the transaction
@@ -2343,6 +3171,90 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
     return false;
 }
 
+int GetTransactions(const std::vector<uint256> &vtxid, std::vector<CTransaction> &vtxOut, std::vector<uint256> &vhashBlock)
+{
+    int nFound = 0;
+
+    vtxOut.clear();
+    vtxOut.resize(vtxid.size());
+    vhashBlock.assign(vtxid.size(), uint256());
+
+    LOCK(cs_main);
+
+    // (position, request index) of every transaction that needs a disk read
+    std::vector<std::pair<CDiskTxPos, size_t> > vIndexed;
+    for (size_t i = 0; i < vtxid.size(); i++)
+    {
+        if (mempool.lookup(vtxid[i], vtxOut[i]))
+        {
+            nFound++;
+            continue;
+        }
+        CDiskTxPos postx;
+        if (fTxIndex && pblocktree->ReadTxIndex(vtxid[i], postx))
+            vIndexed.push_back(std::make_pair(postx, i));
+    }
+    std::sort(vIndexed.begin(), vIndexed.end(),
+              [](const std::pair<CDiskTxPos, size_t>& a, const std::pair<CDiskTxPos, size_t>& b) {
+        if (a.first.nFile != b.first.nFile)
+            return a.first.nFile < b.first.nFile;
+        if (a.first.nPos != b.first.nPos)
+            return a.first.nPos < b.first.nPos;
+        return a.first.nTxOffset < b.first.nTxOffset;
+    });
+
+    size_t i = 0;
+    while (i < vIndexed.size())
+    {
+        int nFile = vIndexed[i].first.nFile;
+        CAutoFile file(OpenBlockFile(vIndexed[i].first, true), SER_DISK, CLIENT_VERSION);
+        if (file.IsNull())
+        {
+            error("%s: OpenBlockFile(%d) failed", __func__, nFile);
+            while (i < vIndexed.size() && vIndexed[i].first.nFile == nFile)
+                i++;
+            continue;
+        }
+        // transactions from the same block reuse its header read
+        int64_t nLastBlockPos = -1;
+        long nTxBase = 0;
+        uint256 hashLastBlock;
+        for (; i < vIndexed.size() && vIndexed[i].first.nFile == nFile; i++)
+        {
+            const CDiskTxPos &postx = vIndexed[i].first;
+            size_t idx = vIndexed[i].second;
+            try {
+                if ((int64_t)postx.nPos != nLastBlockPos)
+                {
+                    if (fseek(file.Get(), postx.nPos, SEEK_SET) != 0)
+                        continue;
+                    CBlockHeader header;
+                    file >> header;
+                    nLastBlockPos = postx.nPos;
+                    nTxBase = ftell(file.Get());
+                    hashLastBlock = header.GetHash();
+                }
+                if (fseek(file.Get(), nTxBase + postx.nTxOffset, SEEK_SET) != 0)
+                    continue;
+                CTransaction tx;
+                file >> tx;
+                if (tx.GetHash() != vtxid[idx])
+                {
+                    error("%s: txid mismatch", __func__);
+                    continue;
+                }
+                vtxOut[idx] = tx;
+                vhashBlock[idx] = hashLastBlock;
+                nFound++;
+            } catch (const std::exception& e) {
+                error("%s: Deserialize or I/O error - %s", __func__, e.what());
+                nLastBlockPos = -1;
+            }
+        }
+    }
+    return nFound;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // CBlock and CBlockIndex
@@ -2369,11 +3281,164 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
     return true;
 }
 
+#ifndef WIN32
+/** Default for -maxmappedblockfiles, the number of blk?????.dat files kept
+ * memory-mapped for reads at any one time. */
+static const int DEFAULT_MAX_MAPPED_BLOCK_FILES = 8;
+
+/** A read-only mapping of one block file. Handed out by shared_ptr so a
+ * reader deserializing from the mapping keeps it alive even if it gets
+ * evicted or replaced concurrently; munmap happens when the last user lets
+ * go. */
+struct CMappedBlockFile
+{
+    const unsigned char* data;
+    size_t size;
+    uint64_t nLastUse;
+
+    CMappedBlockFile() : data(NULL), size(0), nLastUse(0) {}
+    ~CMappedBlockFile() {
+        if (data)
+            munmap((void*)data, size);
+    }
+};
+
+static CCriticalSection cs_mappedBlockFiles;
+static std::map<int, std::shared_ptr<CMappedBlockFile> > mapMappedBlockFiles;
+static uint64_t nMappedBlockFileUses = 0;
+
+/** Return a mapping of the given block file covering at least nMinSize
+ * bytes, remapping if the file has grown since it was last mapped. Least
+ * recently used mappings are dropped beyond -maxmappedblockfiles. Returns
+ * NULL if the file cannot be mapped that far (caller falls back to stdio). */
+static std::shared_ptr<CMappedBlockFile> GetMappedBlockFile(const CDiskBlockPos& pos, size_t nMinSize)
+{
+    LOCK(cs_mappedBlockFiles);
+    std::map<int, std::shared_ptr<CMappedBlockFile> >::iterator it = mapMappedBlockFiles.find(pos.nFile);
+    if (it != mapMappedBlockFiles.end() && it->second->size >= nMinSize) {
+        it->second->nLastUse = ++nMappedBlockFileUses;
+        return it->second;
+    }
+    boost::filesystem::path path = GetBlockPosFilename(pos, "blk");
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < nMinSize) {
+        close(fd);
+        return NULL;
+    }
+    void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return NULL;
+    std::shared_ptr<CMappedBlockFile> entry = std::make_shared<CMappedBlockFile>();
+    entry->data = (const unsigned char*)addr;
+    entry->size = st.st_size;
+    entry->nLastUse = ++nMappedBlockFileUses;
+    mapMappedBlockFiles[pos.nFile] = entry;
+    static const size_t nMaxMapped = (size_t)GetArg("-maxmappedblockfiles", DEFAULT_MAX_MAPPED_BLOCK_FILES);
+    while (mapMappedBlockFiles.size() > std::max<size_t>(nMaxMapped, 1)) {
+        std::map<int, std::shared_ptr<CMappedBlockFile> >::iterator itOldest = mapMappedBlockFiles.begin();
+        for (it = mapMappedBlockFiles.begin(); it != mapMappedBlockFiles.end(); it++) {
+            if (it->second->nLastUse < itOldest->second->nLastUse)
+                itOldest = it;
+        }
+        mapMappedBlockFiles.erase(itOldest);
+    }
+    return entry;
+}
+
+/** Deserialize the block at pos straight out of a memory-mapped block file,
+ * avoiding the open/seek/read/copy cycle per access. The record's size
+ * prefix (written by WriteBlockToDisk just before nPos) bounds the read.
+ * Returns false if the region cannot be mapped or the record looks
+ * inconsistent, in which case the caller retries through stdio. */
+static bool ReadBlockFromMappedFile(CBlock& block, const CDiskBlockPos& pos)
+{
+    if (pos.nPos < 8)
+        return false;
+    std::shared_ptr<CMappedBlockFile> file = GetMappedBlockFile(pos, pos.nPos);
+    if (!file)
+        return false;
+    uint32_t nBlockSize = ReadLE32(file->data + pos.nPos - 4);
+    if (nBlockSize == 0 || nBlockSize > (uint32_t)MAX_BLOCK_SIZE(0))
+        return false;
+    if ((uint64_t)pos.nPos + nBlockSize > file->size) {
+        // The file may have grown past the cached mapping; remap once.
+        file = GetMappedBlockFile(pos, (size_t)pos.nPos + nBlockSize);
+        if (!file)
+            return false;
+    }
+    try {
+        CMemoryReadStream stream(file->data + pos.nPos, nBlockSize, SER_DISK, CLIENT_VERSION);
+        stream >> block;
+    } catch (const std::exception&) {
+        block.SetNull();
+        return false;
+    }
+    return true;
+}
+#endif // !WIN32
+
+/** Copy the serialized bytes of the block at pos into ssBlock without
+ * deserializing. Disk and wire serialization of a block are identical, so
+ * the record written by WriteBlockToDisk can be relayed as-is; the size
+ * prefix written just before nPos bounds the read. Prefers the mapped
+ * block file (one copy, disk page cache to send buffer) and falls back to
+ * stdio. Returns false on any inconsistency, in which case the caller
+ * takes the deserialize/re-serialize path. */
+static bool ReadRawBlockFromDisk(CDataStream& ssBlock, const CDiskBlockPos& pos)
+{
+    if (pos.nPos < 8)
+        return false;
+#ifndef WIN32
+    {
+        std::shared_ptr<CMappedBlockFile> file = GetMappedBlockFile(pos, pos.nPos);
+        if (file) {
+            uint32_t nBlockSize = ReadLE32(file->data + pos.nPos - 4);
+            if (nBlockSize != 0 && nBlockSize <= (uint32_t)MAX_BLOCK_SIZE(0)) {
+                if ((uint64_t)pos.nPos + nBlockSize > file->size)
+                    file = GetMappedBlockFile(pos, (size_t)pos.nPos + nBlockSize);
+                if (file) {
+                    ssBlock.write((const char*)(file->data + pos.nPos), nBlockSize);
+                    return true;
+                }
+            }
+        }
+    }
+#endif
+    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return false;
+    try {
+        if (fseek(filein.Get(), -4, SEEK_CUR) != 0)
+            return false;
+        uint32_t nBlockSize = 0;
+        filein >> nBlockSize;
+        if (nBlockSize == 0 || nBlockSize > (uint32_t)MAX_BLOCK_SIZE(0))
+            return false;
+        std::vector<char> buf(nBlockSize);
+        if (fread(&buf[0], 1, nBlockSize, filein.Get()) != nBlockSize)
+            return false;
+        ssBlock.write(&buf[0], nBlockSize);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
 bool ReadBlockFromDisk(int32_t height,CBlock& block, const CDiskBlockPos& pos,bool checkPOW)
 {
     uint8_t pubkey33[33];
     block.SetNull();
 
+#ifndef WIN32
+    if (ReadBlockFromMappedFile(block, pos))
+        return true;
+    block.SetNull();
+#endif
+
     // Open history file to read
     CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
@@ -2832,7 +3897,12 @@ bool ContextualCheckInputs(
         // before the last block chain checkpoint. This is safe because block merkle hashes are
         // still computed and checked, and any change will be caught at the next checkpoint.
         if (fScriptChecks) {
-            for (unsigned int i = 0; i < tx.vin.size(); i++) {
+            const uint256 txid = tx.GetHash();
+            const bool fCacheable = ScriptCheckCacheable(tx, inputs);
+            // Already fully verified at mempool acceptance under (at least)
+            // these flags for this branch: nothing to re-check.
+            const bool fCached = fCacheable && ScriptExecutionCacheContains(txid, consensusBranchId, flags);
+            for (unsigned int i = 0; !fCached && i < tx.vin.size(); i++) {
                 const COutPoint &prevout = tx.vin[i].prevout;
                 const CCoins* coins = inputs.AccessCoins(prevout.hash);
                 assert(coins);
@@ -2865,6 +3935,10 @@ bool ContextualCheckInputs(
                     return state.DoS(100,false, REJECT_INVALID, strprintf("mandatory-script-verify-flag-failed (%s)", ScriptErrorString(check.GetScriptError())));
                 }
             }
+            // Serial checks succeeded right here; deferred (pvChecks) ones
+            // are recorded by the caller once its check queue drains.
+            if (!fCached && fCacheable && cacheStore && pvChecks == NULL)
+                ScriptExecutionCacheInsert(txid, consensusBranchId, flags);
         }
     }
 
@@ -2887,8 +3961,14 @@ namespace {
         if (fileout.IsNull())
             return error("%s: OpenUndoFile failed", __func__);
 
+        // Serialize the undo data once; the same bytes feed the size field,
+        // the file write and the checksum instead of running the compressing
+        // serializer three times per block.
+        CDataStream& ssUndo = GetScratchStream(SER_DISK, CLIENT_VERSION);
+        ssUndo << blockundo;
+
         // Write index header
-        unsigned int nSize = GetSerializeSize(fileout, blockundo);
+        unsigned int nSize = ssUndo.size();
         fileout << FLATDATA(messageStart) << nSize;
 
         // Write undo data
@@ -2896,12 +3976,12 @@ namespace {
         if (fileOutPos < 0)
             return error("%s: ftell failed", __func__);
         pos.nPos = (unsigned int)fileOutPos;
-        fileout << blockundo;
+        fileout.write(&ssUndo[0], ssUndo.size());
 
         // calculate & write checksum
         CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
         hasher << hashBlock;
-        hasher << blockundo;
+        hasher.write(&ssUndo[0], ssUndo.size());
         fileout << hasher.GetHash();
         return true;
     }
@@ -3025,6 +4105,41 @@ int8_t GetAddressType(const CScript &scriptPubKey, CTxDestination &vDest, txnout
     return keyType;
 }
 
+/** Undo data preloaded for an in-progress chain rewind by PrefetchUndoData.
+ *  Only touched with cs_main held; entries are consumed by DisconnectBlock. */
+static std::map<uint256, CBlockUndo> mapUndoPrefetch;
+
+/**
+ * Read the undo data of every block between pindexFrom (inclusive) and
+ * pindexFork (exclusive) in file order, so a deep reorg does one forward
+ * sweep over the undo files instead of a random read per disconnected tip.
+ */
+static void PrefetchUndoData(const CBlockIndex* pindexFrom, const CBlockIndex* pindexFork)
+{
+    AssertLockHeld(cs_main);
+    mapUndoPrefetch.clear();
+    std::vector<std::pair<CDiskBlockPos, const CBlockIndex*> > vToRead;
+    for (const CBlockIndex* pindex = pindexFrom; pindex && pindex != pindexFork; pindex = pindex->pprev) {
+        CDiskBlockPos pos = pindex->GetUndoPos();
+        if (!pos.IsNull() && pindex->pprev)
+            vToRead.push_back(std::make_pair(pos, pindex));
+    }
+    std::sort(vToRead.begin(), vToRead.end(),
+              [](const std::pair<CDiskBlockPos, const CBlockIndex*>& a,
+                 const std::pair<CDiskBlockPos, const CBlockIndex*>& b) {
+        if (a.first.nFile != b.first.nFile)
+            return a.first.nFile < b.first.nFile;
+        return a.first.nPos < b.first.nPos;
+    });
+    for (const std::pair<CDiskBlockPos, const CBlockIndex*>& entry : vToRead) {
+        CBlockUndo undo;
+        // Failures are not fatal here: DisconnectBlock re-reads and reports
+        // any block missing from the prefetch map.
+        if (UndoReadFromDisk(undo, entry.first, entry.second->pprev->GetBlockHash()))
+            mapUndoPrefetch[entry.second->GetBlockHash()] = std::move(undo);
+    }
+}
+
 bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean)
 {
     assert(pindex->GetBlockHash() == view.GetBestBlock());
@@ -3034,23 +4149,37 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
 
     bool fClean = true;
     CBlockUndo blockUndo;
-    CDiskBlockPos pos = pindex->GetUndoPos();
-    if (pos.IsNull())
-        return error("DisconnectBlock(): no undo data available");
-    if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash()))
-        return error("DisconnectBlock(): failure reading undo data");
+    bool fPrefetched = false;
+    {
+        std::map<uint256, CBlockUndo>::iterator it = mapUndoPrefetch.find(pindex->GetBlockHash());
+        if (it != mapUndoPrefetch.end()) {
+            // checksum was already verified when the rewind prefetched it
+            blockUndo = std::move(it->second);
+            mapUndoPrefetch.erase(it);
+            fPrefetched = true;
+        }
+    }
+    if (!fPrefetched) {
+        CDiskBlockPos pos = pindex->GetUndoPos();
+        if (pos.IsNull())
+            return error("DisconnectBlock(): no undo data available");
+        if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash()))
+            return error("DisconnectBlock(): failure reading undo data");
+    }
 
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size())
         return error("DisconnectBlock(): block and undo data inconsistent");
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    std::vector<std::pair<CAddressIndexKey, CAmount> > watchIndex;
+    const bool fWatchActive = HaveWatchedAddresses();
 
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = block.vtx[i];
         uint256 hash = tx.GetHash();
-        if (fAddressIndex) {
+        if (fAddressIndex || fWatchActive) {
 
             for (unsigned int k = tx.vout.size(); k-- > 0;) {
                 const CTxOut &out = tx.vout[k];
@@ -3064,8 +4193,13 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
                     for (auto addr : vSols)
                     {
                         uint160 addrHash = addr.size() == 20 ? uint160(addr) : Hash160(addr);
-                        addressIndex.push_back(make_pair(CAddressIndexKey(keyType, addrHash, pindex->nHeight, i, hash, k, false), out.nValue));
-                        addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(keyType, addrHash, hash, k), CAddressUnspentValue()));
+                        if (fAddressIndex)
+                        {
+                            addressIndex.push_back(make_pair(CAddressIndexKey(keyType, addrHash, pindex->nHeight, i, hash, k, false), out.nValue));
+                            addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(keyType, addrHash, hash, k), CAddressUnspentValue()));
+                        }
+                        if (fWatchActive && IsWatchedAddress(addrHash, keyType))
+                            watchIndex.push_back(make_pair(CAddressIndexKey(keyType, addrHash, pindex->nHeight, i, hash, k, false), out.nValue));
                     }
                 }
             }
@@ -3111,7 +4245,7 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
                     spentIndex.push_back(make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue()));
                 }
 
-                if (fAddressIndex) {
+                if (fAddressIndex || fWatchActive) {
                     const CTxOut &prevout = view.GetOutputFor(tx.vin[j]);
 
                     vector<vector<unsigned char>> vSols;
@@ -3123,10 +4257,15 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
                         for (auto addr : vSols)
                         {
                             uint160 addrHash = addr.size() == 20 ? uint160(addr) : Hash160(addr);
-                            // undo spending activity
-                            addressIndex.push_back(make_pair(CAddressIndexKey(keyType, addrHash, pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-                            // restore unspent index
-                            addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(keyType, addrHash, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight)));
+                            if (fAddressIndex)
+                            {
+                                // undo spending activity
+                                addressIndex.push_back(make_pair(CAddressIndexKey(keyType, addrHash, pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
+                                // restore unspent index
+                                addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(keyType, addrHash, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight)));
+                            }
+                            if (fWatchActive && IsWatchedAddress(addrHash, keyType))
+                                watchIndex.push_back(make_pair(CAddressIndexKey(keyType, addrHash, pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
                         }
                     }
                 }
@@ -3161,11 +4300,15 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
     }
 
     if (fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to delete address index");
+        // Revert both address indexes with a single batch commit.
+        if (!pblocktree->EraseIndexUpdates(addressIndex, addressUnspentIndex)) {
+            return AbortNode(state, "Failed to revert address indexes");
         }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
+    }
+
+    if (!watchIndex.empty()) {
+        if (!pblocktree->EraseWatchIndex(watchIndex)) {
+            return AbortNode(state, "Failed to revert watch index");
         }
     }
 
@@ -3178,11 +4321,18 @@ void static FlushBlockFile(bool fFinalize = false)
 
     CDiskBlockPos posOld(nLastBlockFile, 0);
 
+    // During IBD the blk/rev data just written is effectively write-once, and
+    // letting it pile up in the page cache evicts the chainstate working set;
+    // drop it once it is safely on disk.
+    bool fEvict = IsInitialBlockDownload();
+
     FILE *fileOld = OpenBlockFile(posOld);
     if (fileOld) {
         if (fFinalize)
             TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nSize);
         FileCommit(fileOld);
+        if (fEvict)
+            FileEvictCache(fileOld);
         fclose(fileOld);
     }
 
@@ -3191,19 +4341,84 @@ void static FlushBlockFile(bool fFinalize = false)
         if (fFinalize)
             TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nUndoSize);
         FileCommit(fileOld);
+        if (fEvict)
+            FileEvictCache(fileOld);
         fclose(fileOld);
     }
 }
 
 bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
-
 void ThreadScriptCheck() {
     RenameThread("zcash-scriptch");
     scriptcheckqueue.Thread();
 }
 
+/**
+ * Coin prefetch: as soon as a block arrives, the txids of its inputs are
+ * queued here and a small thread pool issues read-only GetCoins() lookups
+ * against the coin database (bypassing pcoinsTip, which may only be touched
+ * under cs_main). This pulls the spent coins into the LevelDB block cache and
+ * the OS page cache while the block is still waiting on cs_main, hiding most
+ * of the random-read latency ConnectBlock would otherwise eat serially.
+ */
+static boost::mutex cs_coinsPrefetch;
+static boost::condition_variable condCoinsPrefetch;
+static std::deque<uint256> queueCoinsPrefetch;
+static bool fCoinsPrefetchRunning = false;
+//! Cap on outstanding prefetch requests; beyond this we just drop, since the
+//! synchronous path will read the coins anyway.
+static const size_t MAX_COINS_PREFETCH_QUEUE = 200000;
+
+void ThreadCoinsPrefetch() {
+    RenameThread("zcash-coinspf");
+    {
+        boost::unique_lock<boost::mutex> lock(cs_coinsPrefetch);
+        fCoinsPrefetchRunning = true;
+    }
+    while (true) {
+        uint256 txid;
+        {
+            boost::unique_lock<boost::mutex> lock(cs_coinsPrefetch);
+            while (queueCoinsPrefetch.empty())
+                condCoinsPrefetch.wait(lock); // interruption point for shutdown
+            txid = queueCoinsPrefetch.front();
+            queueCoinsPrefetch.pop_front();
+        }
+        if (pcoinsTip == nullptr)
+            continue;
+        CCoins coins;
+        // The result is discarded; the read itself warms the caches. The
+        // database view is safe for concurrent readers.
+        pcoinsTip->GetBackend()->GetCoins(txid, coins);
+    }
+}
+
+/** Queue read-only coin database lookups for all inputs of a block. */
+static void PrefetchBlockInputs(const CBlock &block)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs_coinsPrefetch);
+        if (!fCoinsPrefetchRunning || queueCoinsPrefetch.size() > MAX_COINS_PREFETCH_QUEUE)
+            return;
+        uint256 hashLast;
+        for (const CTransaction &tx : block.vtx) {
+            if (tx.IsCoinBase())
+                continue;
+            for (const CTxIn &txin : tx.vin) {
+                // Inputs spending the same tx usually come consecutively;
+                // skipping immediate repeats avoids most duplicate reads
+                // without keeping a set.
+                if (txin.prevout.hash == hashLast)
+                    continue;
+                hashLast = txin.prevout.hash;
+                queueCoinsPrefetch.push_back(hashLast);
+            }
+        }
+    }
+    condCoinsPrefetch.notify_all();
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -3275,6 +4490,81 @@ static int64_t nTimeConnect = 0;
 static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
+
+/** Always-on stage timing behind the bench timestamps. There is a single
+ * writer (block connection under cs_main); getvalidationstats reads the
+ * atomics without taking any lock, so recording is a handful of relaxed
+ * increments per block and the bench log lines stay purely optional. */
+static const int VSTAGE_BUCKETS = 32;
+static const int VSTAGE_WINDOW = 128;
+namespace {
+struct ValidationStageData {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> buckets[VSTAGE_BUCKETS];
+    std::atomic<uint32_t> samples[VSTAGE_WINDOW];
+    ValidationStageData() : count(0), sum(0) {
+        for (int i = 0; i < VSTAGE_BUCKETS; i++)
+            buckets[i] = 0;
+        for (int i = 0; i < VSTAGE_WINDOW; i++)
+            samples[i] = 0;
+    }
+};
+} // anon namespace
+static ValidationStageData vstageData[NUM_VALIDATION_STAGES];
+
+static void RecordValidationStage(int stage, int64_t usec)
+{
+    if (usec < 0)
+        usec = 0;
+    ValidationStageData& d = vstageData[stage];
+    uint64_t n = d.count.fetch_add(1, std::memory_order_relaxed);
+    d.sum.fetch_add(usec, std::memory_order_relaxed);
+    int bucket = 0;
+    for (uint64_t v = usec; v > 1 && bucket < VSTAGE_BUCKETS - 1; v >>= 1)
+        bucket++;
+    d.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    d.samples[n % VSTAGE_WINDOW].store(
+        (uint32_t)std::min<int64_t>(usec, std::numeric_limits<uint32_t>::max()),
+        std::memory_order_relaxed);
+}
+
+const char* ValidationStageName(int stage)
+{
+    switch (stage) {
+        case VSTAGE_CONNECT:     return "connect";
+        case VSTAGE_VERIFY:      return "verify";
+        case VSTAGE_INDEX:       return "index";
+        case VSTAGE_CALLBACKS:   return "callbacks";
+        case VSTAGE_READBLOCK:   return "readblock";
+        case VSTAGE_FLUSH:       return "flush";
+        case VSTAGE_CHAINSTATE:  return "chainstate";
+        case VSTAGE_POSTCONNECT: return "postconnect";
+        case VSTAGE_TOTAL:       return "total";
+    }
+    return "unknown";
+}
+
+void GetValidationStageStats(int stage, uint64_t& count, uint64_t& sumUsec,
+                             std::vector<uint64_t>& buckets, std::vector<uint32_t>& samplesUsec)
+{
+    buckets.clear();
+    samplesUsec.clear();
+    if (stage < 0 || stage >= NUM_VALIDATION_STAGES) {
+        count = sumUsec = 0;
+        return;
+    }
+    const ValidationStageData& d = vstageData[stage];
+    count = d.count.load(std::memory_order_relaxed);
+    sumUsec = d.sum.load(std::memory_order_relaxed);
+    buckets.resize(VSTAGE_BUCKETS);
+    for (int i = 0; i < VSTAGE_BUCKETS; i++)
+        buckets[i] = d.buckets[i].load(std::memory_order_relaxed);
+    size_t nSamples = (size_t)std::min<uint64_t>(count, VSTAGE_WINDOW);
+    samplesUsec.reserve(nSamples);
+    for (size_t i = 0; i < nSamples; i++)
+        samplesUsec.push_back(d.samples[i].load(std::memory_order_relaxed));
+}
 bool FindBlockPos(int32_t tmpflag,CValidationState &state, CDiskBlockPos &pos, unsigned int nAddSize, unsigned int nHeight, uint64_t nTime, bool fKnown = false);
 bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBlockIndex *pindexNew, const CDiskBlockPos& pos);
 
@@ -3306,6 +4596,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     if ( KOMODO_STOPAT != 0 && pindex->nHeight > KOMODO_STOPAT )
         return(false);
     AssertLockHeld(cs_main);
+    TRACE3(validation, block_connect_start,
+           pindex->nHeight,
+           (uint64_t)block.vtx.size(),
+           fJustCheck);
     bool fExpensiveChecks = true;
     if (fCheckpointsEnabled) {
         CBlockIndex *pindexLastCheckpoint = Checkpoints::GetLastCheckpoint(chainparams.Checkpoints());
@@ -3314,7 +4608,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             fExpensiveChecks = false;
         }
     }
-    auto verifier = libzcash::ProofVerifier::Strict();
+    auto verifier = libzcash::ProofVerifier::Batched();
     auto disabledVerifier = libzcash::ProofVerifier::Disabled();
     int32_t futureblock;
     CAmount blockReward = GetBlockSubsidy(pindex->nHeight, chainparams.GetConsensus());
@@ -3324,6 +4618,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     {
         return false;
     }
+    // The batching verifier queued the block's joinsplit proofs instead of
+    // checking them inline; verify them all at once across worker threads.
+    if (!verifier.VerifyBatch())
+    {
+        return state.DoS(100, error("ConnectBlock(): joinsplit does not verify"),
+                         REJECT_INVALID, "bad-txns-joinsplit-verification-failed");
+    }
     if ( fCheckPOW != 0 && (pindex->nStatus & BLOCK_VALID_CONTEXT) != BLOCK_VALID_CONTEXT ) // Activate Jan 15th, 2019
     {
         if ( !ContextualCheckBlock(1,block, state, pindex->pprev) )
@@ -3403,6 +4704,21 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     }
 
     bool fScriptChecks = (!fCheckpointsEnabled || pindex->nHeight >= Checkpoints::GetTotalBlocksEstimate(chainparams.Checkpoints()));
+    if (fScriptChecks && fAssumeNotarized) {
+        // dPoW finality: komodo_checkpoint forbids reorging below the last
+        // notarized height, so input scripts of blocks at notarized depth are
+        // treated as assumed valid, the way -assumevalid works upstream. The
+        // block must actually lead to the notarized block; UTXO accounting,
+        // amount checks and proof-of-work validation still run in full.
+        int32_t prevMoMheight; uint256 notarized_hash, notarized_desttxid;
+        int32_t notarized_height = komodo_notarized_height(&prevMoMheight, &notarized_hash, &notarized_desttxid);
+        if (notarized_height > 0 && pindex->nHeight <= notarized_height) {
+            BlockMap::iterator it = mapBlockIndex.find(notarized_hash);
+            if (it != mapBlockIndex.end() && it->second != nullptr &&
+                it->second->GetAncestor(pindex->nHeight) == pindex)
+                fScriptChecks = false;
+        }
+    }
     // Do not allow blocks that contain transactions which 'overwrite' older transactions,
     // unless those are already completely spent.
     BOOST_FOREACH(const CTransaction& tx, block.vtx) {
@@ -3442,6 +4758,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    std::vector<std::pair<CAddressIndexKey, CAmount> > watchIndex;
+    std::vector<CScript> vSpentScripts; // prevout scripts for the block filter
+    // snapshot so registrations mid-block take effect at the next block
+    const bool fWatchActive = HaveWatchedAddresses();
     // Construct the incremental merkle tree at the current
     // block position,
     auto old_sprout_tree_root = view.GetBestAnchor(SPROUT);
@@ -3494,6 +4814,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             for (const auto& input : tx.vin) {
                 const auto prevout = view.GetOutputFor(input);
                 transparentValueDelta -= prevout.nValue;
+                if (fBlockFilterIndex)
+                    vSpentScripts.push_back(prevout.scriptPubKey);
             }
 
             // are the JoinSplit's requirements met?
@@ -3501,9 +4823,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 return state.DoS(100, error("ConnectBlock(): JoinSplit requirements not met"),
                                  REJECT_INVALID, "bad-txns-joinsplit-requirements-not-met");
 
-            if (fAddressIndex || fSpentIndex)
+            if (fAddressIndex || fSpentIndex || fWatchActive)
             {
-                for (size_t j = 0; j < tx.vin.size(); j++) 
+                for (size_t j = 0; j < tx.vin.size(); j++)
                 {
                     const CTxIn input = tx.vin[j];
                     const CTxOut &prevout = view.GetOutputFor(tx.vin[j]);
@@ -3518,11 +4840,16 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                         for (auto addr : vSols)
                         {
                             addrHash = addr.size() == 20 ? uint160(addr) : Hash160(addr);
-                            // record spending activity
-                            addressIndex.push_back(make_pair(CAddressIndexKey(keyType, addrHash, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
+                            if (fAddressIndex)
+                            {
+                                // record spending activity
+                                addressIndex.push_back(make_pair(CAddressIndexKey(keyType, addrHash, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
 
-                            // remove address from unspent index
-                            addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(keyType, addrHash, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
+                                // remove address from unspent index
+                                addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(keyType, addrHash, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
+                            }
+                            if (fWatchActive && IsWatchedAddress(addrHash, keyType))
+                                watchIndex.push_back(make_pair(CAddressIndexKey(keyType, addrHash, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
                         }
 
                         if (fSpentIndex) {
@@ -3543,6 +4870,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
 
         txdata.emplace_back(tx);
+        // Prime the SIGHASH_ALL midstate before the parallel checks share
+        // this entry, so per-input sighashing skips the common prefix.
+        txdata.back().PrepareSighash(tx, consensusBranchId);
 
         valueout = tx.GetValueOut();
         if ( KOMODO_VALUETOOBIG(valueout) != 0 )
@@ -3573,7 +4903,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             control.Add(vChecks);
         }
 
-        if (fAddressIndex) {
+        if (fAddressIndex || fWatchActive) {
             for (unsigned int k = 0; k < tx.vout.size(); k++) {
                 const CTxOut &out = tx.vout[k];
 
@@ -3588,11 +4918,16 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                     for (auto addr : vSols)
                     {
                         addrHash = addr.size() == 20 ? uint160(addr) : Hash160(addr);
-                        // record receiving activity
-                        addressIndex.push_back(make_pair(CAddressIndexKey(keyType, addrHash, pindex->nHeight, i, txhash, k, false), out.nValue));
+                        if (fAddressIndex)
+                        {
+                            // record receiving activity
+                            addressIndex.push_back(make_pair(CAddressIndexKey(keyType, addrHash, pindex->nHeight, i, txhash, k, false), out.nValue));
 
-                        // record unspent output
-                        addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(keyType, addrHash, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
+                            // record unspent output
+                            addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(keyType, addrHash, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
+                        }
+                        if (fWatchActive && IsWatchedAddress(addrHash, keyType))
+                            watchIndex.push_back(make_pair(CAddressIndexKey(keyType, addrHash, pindex->nHeight, i, txhash, k, false), out.nValue));
                     }
                 }
             }
@@ -3679,6 +5014,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
     }
     int64_t nTime1 = GetTimeMicros(); nTimeConnect += nTime1 - nTimeStart;
+    if (!fJustCheck)
+        RecordValidationStage(VSTAGE_CONNECT, nTime1 - nTimeStart);
     LogPrint("bench", "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime1 - nTimeStart) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime1 - nTimeStart) / (nInputs-1), nTimeConnect * 0.000001);
 
     blockReward += nFees + sum;
@@ -3715,6 +5052,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     if (!control.Wait())
         return state.DoS(100, false);
     int64_t nTime2 = GetTimeMicros(); nTimeVerify += nTime2 - nTimeStart;
+    if (!fJustCheck)
+        RecordValidationStage(VSTAGE_VERIFY, nTime2 - nTime1);
     LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime2 - nTimeStart), nInputs <= 1 ? 0 : 0.001 * (nTime2 - nTimeStart) / (nInputs-1), nTimeVerify * 0.000001);
 
     if (fJustCheck)
@@ -3754,49 +5093,67 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     ConnectNotarisations(block, pindex->nHeight); // MoMoM notarisation DB.
 
-    if (fTxIndex)
-        if (!pblocktree->WriteTxIndex(vPos))
-            return AbortNode(state, "Failed to write transaction index");
-    if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-    }
+    if (fTokenIndex)
+        ConnectTokenIndex(block, pindex->nHeight);
 
-    if (fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
+    if (fOracleIndex)
+        ConnectOracleIndex(block, pindex->nHeight);
 
-    if (fTimestampIndex)
+    // All index updates the block produced go to disk in one batch commit,
+    // instead of one LevelDB batch per index against the same database.
+    if (fTxIndex || fAddressIndex || fSpentIndex || fTimestampIndex)
     {
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
+        CTimestampIndexKey timestampIndex;
+        CTimestampBlockIndexKey blockhashIndex;
+        CTimestampBlockIndexValue logicalts;
+        bool fHaveTimestampIndex = false;
+        if (fTimestampIndex)
+        {
+            unsigned int logicalTS = pindex->nTime;
+            unsigned int prevLogicalTS = 0;
 
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
+            // retrieve logical timestamp of the previous block
+            if (pindex->pprev)
+                if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
+                    LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
+
+            if (logicalTS <= prevLogicalTS) {
+                logicalTS = prevLogicalTS + 1;
+                LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
+            }
 
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-            LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
+            timestampIndex = CTimestampIndexKey(logicalTS, pindex->GetBlockHash());
+            blockhashIndex = CTimestampBlockIndexKey(pindex->GetBlockHash());
+            logicalts = CTimestampBlockIndexValue(logicalTS);
+            fHaveTimestampIndex = true;
         }
 
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
+        if (!fTxIndex)
+            vPos.clear();
+        if (!pblocktree->WriteIndexUpdates(vPos, addressIndex, addressUnspentIndex, spentIndex,
+                                           fHaveTimestampIndex ? &timestampIndex : nullptr,
+                                           fHaveTimestampIndex ? &blockhashIndex : nullptr,
+                                           fHaveTimestampIndex ? &logicalts : nullptr))
+            return AbortNode(state, "Failed to write block indexes");
+
+        if (fBlockFilterIndex)
+        {
+            CBlockFilter filter(block, vSpentScripts);
+            if (!pblocktree->WriteBlockFilter(pindex->GetBlockHash(), filter.GetEncoded()))
+                return AbortNode(state, "Failed to write block filter");
+        }
+    }
 
-        if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
+    if (!watchIndex.empty()) {
+        if (!pblocktree->WriteWatchIndex(watchIndex))
+            return AbortNode(state, "Failed to write watch index");
     }
 
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
     int64_t nTime3 = GetTimeMicros(); nTimeIndex += nTime3 - nTime2;
+    RecordValidationStage(VSTAGE_INDEX, nTime3 - nTime2);
     LogPrint("bench", "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeIndex * 0.000001);
 
     // Watch for changes to the previous coinbase transaction.
@@ -3805,6 +5162,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     hashPrevBestCoinBase = block.vtx[0].GetHash();
 
     int64_t nTime4 = GetTimeMicros(); nTimeCallbacks += nTime4 - nTime3;
+    RecordValidationStage(VSTAGE_CALLBACKS, nTime4 - nTime3);
     LogPrint("bench", "    - Callbacks: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeCallbacks * 0.000001);
 
     komodo_connectblock(false,pindex,*(CBlock *)&block);  // dPoW state update.
@@ -3813,6 +5171,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
       // Update the notary pay with the latest payment.
       pindex->nNotaryPay = pindex->pprev->nNotaryPay + notarypaycheque;
     }
+    TRACE3(validation, block_connected,
+           pindex->nHeight,
+           (uint64_t)block.vtx.size(),
+           (uint64_t)(GetTimeMicros() - nTimeStart));
     return true;
 }
 
@@ -3829,6 +5191,59 @@ enum FlushStateMode {
  * if they're too large, if it's been a while since the last write,
  * or always and in all cases if we're in prune mode and are deleting files.
  */
+/** Seconds between dbcache governor evaluations */
+static const int64_t DBCACHE_ADJUST_INTERVAL = 300;
+
+/**
+ * Rebalance the in-memory coins budget against index database traffic.
+ *
+ * The leveldb block caches are fixed when the databases open, so the one
+ * knob that can move at runtime is nCoinCacheUsage, which FlushStateToDisk
+ * consults on every periodic call. When explorer-style lookups (txindex,
+ * address index, spent index — all served by the block tree database)
+ * dominate reads, shrinking the coins view hands memory back to the OS page
+ * cache that serves those index files; validation-heavy periods grow it
+ * back. Bounded to [half, full] of the configured budget. Caller holds
+ * cs_main.
+ */
+static void AdjustCoinCacheBudget()
+{
+    static int64_t nLastAdjust = 0;
+    static uint64_t nLastIndexReads = 0;
+    static uint64_t nLastCoinReads = 0;
+
+    if (nCoinCacheUsageConfigured == 0 || pblocktree == NULL || pcoinsdbview == NULL)
+        return;
+    int64_t nNow = GetTimeMicros();
+    if (nLastAdjust == 0) {
+        nLastAdjust = nNow;
+        nLastIndexReads = pblocktree->GetReadCount();
+        nLastCoinReads = pcoinsdbview->GetDbReadCount();
+        return;
+    }
+    if (nNow < nLastAdjust + DBCACHE_ADJUST_INTERVAL * 1000000)
+        return;
+    uint64_t nIndexReads = pblocktree->GetReadCount();
+    uint64_t nCoinReads = pcoinsdbview->GetDbReadCount();
+    uint64_t nIndexDelta = nIndexReads - nLastIndexReads;
+    uint64_t nCoinDelta = nCoinReads - nLastCoinReads;
+    nLastIndexReads = nIndexReads;
+    nLastCoinReads = nCoinReads;
+    nLastAdjust = nNow;
+
+    // too little traffic to conclude anything about the workload
+    if (nIndexDelta + nCoinDelta < 1000)
+        return;
+    double dIndexShare = (double)nIndexDelta / (nIndexDelta + nCoinDelta);
+    size_t nTarget = (size_t)(nCoinCacheUsageConfigured * (1.0 - dIndexShare / 2));
+    if (nTarget != nCoinCacheUsage)
+    {
+        LogPrint("bench", "dbcache governor: index read share %.0f%%, coins budget %.1f -> %.1f MiB\n",
+                 dIndexShare * 100, nCoinCacheUsage * (1.0 / 1024 / 1024), nTarget * (1.0 / 1024 / 1024));
+        nCoinCacheUsage = nTarget;
+    }
+}
+
 bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
     LOCK2(cs_main, cs_LastBlockFile);
     static int64_t nLastWrite = 0;
@@ -3859,6 +5274,8 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         if (nLastSetChain == 0) {
             nLastSetChain = nNow;
         }
+        if (mode == FLUSH_STATE_PERIODIC)
+            AdjustCoinCacheBudget();
         size_t cacheSize = pcoinsTip->DynamicMemoryUsage();
         // The cache is large and close to the limit, but we have time now (not in the middle of a block processing).
         bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize * (10.0/9) > nCoinCacheUsage;
@@ -3868,6 +5285,10 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         bool fPeriodicWrite = mode == FLUSH_STATE_PERIODIC && nNow > nLastWrite + (int64_t)DATABASE_WRITE_INTERVAL * 1000000;
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
         bool fPeriodicFlush = mode == FLUSH_STATE_PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
+        // It's been a while since the dirty part of the cache was written out. Syncing
+        // it incrementally keeps each write small and leaves the cache warm, instead of
+        // accumulating a full flush that stalls validation for tens of seconds.
+        bool fPeriodicSync = mode == FLUSH_STATE_PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_SYNC_INTERVAL * 1000000;
         // Combine all conditions that result in a full cache flush.
         bool fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
         // Write blocks and block index to disk.
@@ -3920,6 +5341,26 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
+            TRACE4(utxocache, flush,
+                   (int32_t)mode,
+                   (uint64_t)cacheSize,
+                   (uint64_t)(GetTimeMicros() - nNow),
+                   fFlushForPrune);
+        } else if (fPeriodicSync && fPeriodicWrite) {
+            // Incrementally write out the dirty subset of the chainstate while
+            // keeping the cache intact. This is only safe after the block
+            // index write above, since the coin database's best block may
+            // refer to new block index entries.
+            if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
+                return state.Error("out of disk space");
+            if (!pcoinsTip->Sync())
+                return AbortNode(state, "Failed to sync coin database");
+            nLastFlush = nNow;
+            TRACE4(utxocache, sync,
+                   (int32_t)mode,
+                   (uint64_t)cacheSize,
+                   (uint64_t)(GetTimeMicros() - nNow),
+                   fFlushForPrune);
         }
         if ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000) {
             // Update best block in wallet (so we can detect restored wallets).
@@ -3944,6 +5385,109 @@ void PruneAndFlush() {
     FlushStateToDisk(state, FLUSH_STATE_NONE);
 }
 
+/** Measured sync progress estimation. GuessVerificationProgress extrapolates
+ *  from per-chain constants baked in at release time, which go badly stale on
+ *  asset chains; these estimates are derived from the block index itself (the
+ *  chain's own recent tx rate) and from the node's measured verification
+ *  throughput, persisted across restarts. */
+static CCriticalSection cs_syncRate;
+static double dSyncTxPerSec = 0.0;      //!< verification throughput, tx per wall-clock second (EWMA)
+static int64_t nSyncRateLastSample = 0; //!< wall clock (ms) of the last throughput sample
+static uint64_t nSyncRateLastChainTx = 0;
+static int64_t nSyncRateLastPersist = 0;
+
+//! Sample the connect throughput on tip updates; cheap enough to run on
+//! every new best block, persisted at most once a minute
+static void UpdateSyncTxRate(const CBlockIndex *pindexNew)
+{
+    LOCK(cs_syncRate);
+    const int64_t nNow = GetTimeMillis();
+    if (nSyncRateLastSample == 0 || pindexNew->nChainTx < nSyncRateLastChainTx) {
+        nSyncRateLastSample = nNow;
+        nSyncRateLastChainTx = pindexNew->nChainTx;
+        return;
+    }
+    const int64_t nElapsed = nNow - nSyncRateLastSample;
+    if (nElapsed < 5000)
+        return;
+    const double dRate = (pindexNew->nChainTx - nSyncRateLastChainTx) * 1000.0 / nElapsed;
+    dSyncTxPerSec = (dSyncTxPerSec <= 0.0) ? dRate : 0.75 * dSyncTxPerSec + 0.25 * dRate;
+    nSyncRateLastSample = nNow;
+    nSyncRateLastChainTx = pindexNew->nChainTx;
+    if (pblocktree != nullptr && nNow - nSyncRateLastPersist > 60 * 1000) {
+        pblocktree->WriteSyncTxRate((uint64_t)(dSyncTxPerSec * 1000.0));
+        nSyncRateLastPersist = nNow;
+    }
+}
+
+void LoadSyncTxRate()
+{
+    uint64_t nMilliTxPerSec = 0;
+    if (pblocktree != nullptr && pblocktree->ReadSyncTxRate(nMilliTxPerSec) && nMilliTxPerSec > 0) {
+        LOCK(cs_syncRate);
+        dSyncTxPerSec = nMilliTxPerSec / 1000.0;
+        LogPrintf("%s: seeded verification throughput estimate: %.1f tx/s\n", __func__, dSyncTxPerSec);
+    }
+}
+
+//! The chain's recent transaction rate (tx per second of chain time),
+//! measured over roughly the last month of chain time ending at pindex
+static double MeasuredChainTxRate(const CBlockIndex *pindex)
+{
+    // a month of one-minute blocks; much shorter windows get noisy on
+    // quiet asset chains
+    static const int RATE_WINDOW_BLOCKS = 43200;
+    const CBlockIndex *panchor = pindex->GetAncestor(std::max(0, pindex->nHeight - RATE_WINDOW_BLOCKS));
+    if (panchor == NULL || panchor == pindex || panchor->nChainTx == 0 ||
+        pindex->GetBlockTime() <= panchor->GetBlockTime())
+        return 0.0;
+    return (double)(pindex->nChainTx - panchor->nChainTx) /
+           (double)(pindex->GetBlockTime() - panchor->GetBlockTime());
+}
+
+//! Expected transactions between pindex and the network tip, extrapolated
+//! from the chain's own recent tx rate; 0.0 when it cannot be estimated
+static double EstimateRemainingChainTx(const CBlockIndex *pindex)
+{
+    const double dChainRate = MeasuredChainTxRate(pindex);
+    if (dChainRate <= 0.0)
+        return 0.0;
+    const int64_t nBehind = GetTime() - pindex->GetBlockTime();
+    if (nBehind <= 0)
+        return 0.0;
+    return nBehind * dChainRate;
+}
+
+double EstimateVerificationProgress(CBlockIndex *pindex)
+{
+    if (pindex == NULL || pindex->nChainTx == 0)
+        return 0.0;
+    const double dRemaining = EstimateRemainingChainTx(pindex);
+    if (dRemaining <= 0.0) {
+        // too little index data to measure (fresh chain, or caught up):
+        // fall back to the checkpoint-based guess
+        return Checkpoints::GuessVerificationProgress(Params().Checkpoints(), pindex);
+    }
+    return std::min((double)pindex->nChainTx / ((double)pindex->nChainTx + dRemaining), 1.0);
+}
+
+int64_t EstimateSyncTimeLeft(CBlockIndex *pindex)
+{
+    if (pindex == NULL || pindex->nChainTx == 0)
+        return -1;
+    const double dRemaining = EstimateRemainingChainTx(pindex);
+    if (dRemaining <= 0.0)
+        return 0;
+    double dRate;
+    {
+        LOCK(cs_syncRate);
+        dRate = dSyncTxPerSec;
+    }
+    if (dRate <= 0.0)
+        return -1;
+    return (int64_t)(dRemaining / dRate);
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew) {
     const CChainParams& chainParams = Params();
@@ -3953,9 +5497,12 @@ void static UpdateTip(CBlockIndex *pindexNew) {
     nTimeBestReceived = GetTime();
     mempool.AddTransactionsUpdated(1);
     KOMODO_NEWBLOCKS++;
+    nChainTipSequence.fetch_add(1);
+    pindexPublishedTip.store(pindexNew);
+    UpdateSyncTxRate(pindexNew);
     double progress;
     if ( chainName.isKMD() ) {
-        progress = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip());
+        progress = EstimateVerificationProgress(chainActive.Tip());
     } else {
 	    int32_t longestchain = komodo_longestchain();
 	    progress = (longestchain > 0 ) ? (double) chainActive.Height() / longestchain : 1.0;
@@ -4029,6 +5576,18 @@ bool static DisconnectTip(CValidationState &state, bool fBare = false) {
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         assert(view.Flush());
         DisconnectNotarisations(block);
+        if (fTokenIndex)
+            DisconnectTokenIndex(block);
+        if (fOracleIndex)
+            DisconnectOracleIndex(block, pindexDelete->nHeight);
+    }
+    CCEvalCacheClear(); // cached CC eval results are only valid against the old tip
+    {
+        // the disconnected block's outpoints become spendable again, so the
+        // recently-spent filter must not reject their respends
+        LOCK(cs_recentlySpent);
+        if (recentlySpentFilter)
+            recentlySpentFilter->reset();
     }
     pindexDelete->segid = -2;
     pindexDelete->nNotaryPay = 0; 
@@ -4048,13 +5607,12 @@ bool static DisconnectTip(CValidationState &state, bool fBare = false) {
         {
             // ignore validation errors in resurrected transactions
             CTransaction &tx = block.vtx[i];
-            list<CTransaction> removed;
             CValidationState stateDummy;
-            
+
             // don't keep staking or invalid transactions
             if (tx.IsCoinBase() || (i == block.vtx.size()-1 && komodo_newStakerActive(0, pindexDelete->nTime) == 0 && komodo_isPoS((CBlock *)&block,pindexDelete->nHeight,0) != 0) || !AcceptToMemoryPool(mempool, stateDummy, tx, false, NULL))
             {
-                mempool.remove(tx, removed, true);
+                mempool.remove(tx, true);
             }
         }
         if (sproutAnchorBeforeDisconnect != sproutAnchorAfterDisconnect) {
@@ -4199,6 +5757,7 @@ bool ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *pblock)
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros(); 
     nTimeReadFromDisk += nTime2 - nTime1;
+    RecordValidationStage(VSTAGE_READBLOCK, nTime2 - nTime1);
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
     int64_t nTime3;
     {
@@ -4220,6 +5779,7 @@ bool ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *pblock)
             assert(view.Flush());
     }
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
+    RecordValidationStage(VSTAGE_FLUSH, nTime4 - nTime3);
     LogPrint("bench", "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
     // Write the chain state to disk, if necessary.
     if ( KOMODO_NSPV_FULLNODE )
@@ -4228,11 +5788,23 @@ bool ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *pblock)
             return false;
     }
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
+    RecordValidationStage(VSTAGE_CHAINSTATE, nTime5 - nTime4);
     LogPrint("bench", "  - Writing chainstate: %.2fms [%.2fs]\n", (nTime5 - nTime4) * 0.001, nTimeChainState * 0.000001);
     // Remove conflicting transactions from the mempool.
     list<CTransaction> txConflicted;
     mempool.removeForBlock(pblock->vtx, pindexNew->nHeight, txConflicted, !IsInitialBlockDownload());
 
+    // Record the block's spends so late relay of conflicting transactions is
+    // dropped at the network edge
+    if (!IsInitialBlockDownload())
+    {
+        BOOST_FOREACH(const CTransaction &tx, pblock->vtx)
+        {
+            if (!tx.IsCoinBase())
+                SpentFilterAdd(tx);
+        }
+    }
+
     // Remove transactions that expire at new block height from mempool
     mempool.removeExpired(pindexNew->nHeight);
 
@@ -4245,10 +5817,9 @@ bool ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *pblock)
         BOOST_FOREACH(const CTransaction &tx, txConflicted) {
             SyncWithWallets(tx, NULL);
         }
-        // ... and about transactions that got confirmed:
-        BOOST_FOREACH(const CTransaction &tx, pblock->vtx) {
-            SyncWithWallets(tx, pblock);
-        }
+        // ... and about transactions that got confirmed, as one batch so the
+        // wallet takes its lock and opens its database once per block:
+        SyncWithWallets(pblock->vtx, pblock);
     }
     // Update cached incremental witnesses
     GetMainSignals().ChainTip(pindexNew, pblock, oldSproutTree, oldSaplingTree, true);
@@ -4256,6 +5827,8 @@ bool ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *pblock)
     EnforceNodeDeprecation(pindexNew->nHeight);
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
+    RecordValidationStage(VSTAGE_POSTCONNECT, nTime6 - nTime5);
+    RecordValidationStage(VSTAGE_TOTAL, nTime6 - nTime1);
     LogPrint("bench", "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
     LogPrint("bench", "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
     if ( KOMODO_LONGESTCHAIN != 0 && (pindexNew->nHeight == KOMODO_LONGESTCHAIN || pindexNew->nHeight == KOMODO_LONGESTCHAIN+1) )
@@ -4436,6 +6009,12 @@ static bool ActivateBestChainStep(bool fSkipdpow, CValidationState &state, CBloc
     // Disconnect active blocks which are no longer in the best chain.
     bool fBlocksDisconnected = false;
 
+    // Preload the undo data of every block about to be disconnected
+    // (notarization-induced reorgs regularly rewind dozens of blocks), so the
+    // rewind does not stall on serial undo file reads while cs_main is held.
+    if (chainActive.Tip() && chainActive.Tip() != pindexFork)
+        PrefetchUndoData(chainActive.Tip(), pindexFork);
+
     while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
         if (!DisconnectTip(state))
             return false;
@@ -4557,17 +6136,32 @@ bool ActivateBestChain(bool fSkipdpow, CValidationState &state, CBlock *pblock)
                 nBlockEstimate = Checkpoints::GetTotalBlocksEstimate(chainParams.Checkpoints());
             // Don't relay blocks if pruning -- could cause a peer to try to download, resulting
             // in a stalled download if the block file is pruned before the request.
-            if (nLocalServices & NODE_NETWORK) 
+            if (nLocalServices & NODE_NETWORK)
             {
                 int ht = 0;
+                CBlockHeaderAndShortTxIDs cmpctblock;
+                bool fHaveCmpct = false;
                 {
                     LOCK(cs_main);
                     ht = chainActive.Height();
+                    // Build the compact announcement once for every peer that
+                    // negotiated sendcmpct, saving them the inv/getdata trip
+                    CBlock block;
+                    if (ReadBlockFromDisk(block, pindexNewTip, 1))
+                    {
+                        cmpctblock = CBlockHeaderAndShortTxIDs(block);
+                        fHaveCmpct = true;
+                    }
                 }
                 LOCK(cs_vNodes);
                 for(CNode* pnode : vNodes)
                     if (ht > (pnode->nStartingHeight != -1 ? pnode->nStartingHeight - 2000 : nBlockEstimate))
-                        pnode->PushInventory(CInv(MSG_BLOCK, hashNewTip));
+                    {
+                        if (fHaveCmpct && pnode->fPreferCmpctBlocks)
+                            pnode->PushMessage("cmpctblock", cmpctblock);
+                        else
+                            pnode->PushInventory(CInv(MSG_BLOCK, hashNewTip));
+                    }
             }
             // Notify external listeners about the new tip.
             GetMainSignals().UpdatedBlockTip(pindexNewTip);
@@ -4592,6 +6186,9 @@ bool InvalidateBlock(CValidationState& state, CBlockIndex *pindex) {
     setDirtyBlockIndex.insert(pindex);
     setBlockIndexCandidates.erase(pindex);
 
+    if (chainActive.Contains(pindex))
+        PrefetchUndoData(chainActive.Tip(), pindex->pprev);
+
     while (chainActive.Contains(pindex)) {
         CBlockIndex *pindexWalk = chainActive.Tip();
         pindexWalk->nStatus |= BLOCK_FAILED_CHILD;
@@ -4694,7 +6291,7 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
         }
     }
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
+    CBlockIndex* pindexNew = NewBlockIndex(block);
     assert(pindexNew);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
@@ -5217,14 +6814,12 @@ bool CheckBlock(int32_t *futureblockp, int32_t height, CBlockIndex *pindex, cons
             }
         }
         for(const CTransaction& tx : transactionsToRemove) {
-            list<CTransaction> removed;
-            mempool.remove(tx, removed, false);
+            mempool.remove(tx, false);
         }
         // add all the txs in the block to the (somewhat) empty mempool.
         // CC validation shouldn't (can't) depend on the state of mempool!
         while ( true )
         {
-            list<CTransaction> removed;
             for (i=0; i<block.vtx.size(); i++)
             {
                 CValidationState state; CTransaction Tx; 
@@ -5241,7 +6836,7 @@ bool CheckBlock(int32_t *futureblockp, int32_t height, CBlockIndex *pindex, cons
                     rejects++;
                 }
                 // here we remove any txs in the temp mempool that were included in the block.
-                tmpmempool.remove(tx, removed, false);
+                tmpmempool.remove(tx, false);
             }
             if ( rejects == 0 || rejects == lastrejects )
             {
@@ -5726,7 +7321,7 @@ CBlockIndex *oldkomodo_ensure(CBlock *pblock, uint256 hash)
     CBlockIndex *pindex=0,*previndex=0;
     if ( (pindex = komodo_getblockindex(hash)) == 0 )
     {
-        pindex = new CBlockIndex();
+        pindex = NewBlockIndex();
         if (!pindex)
             throw runtime_error("komodo_ensure: new CBlockIndex failed");
         BlockMap::iterator mi = mapBlockIndex.insert(make_pair(hash, pindex)).first;
@@ -5793,14 +7388,21 @@ bool ProcessNewBlock(bool from_miner, int32_t height, CValidationState &state, C
         CBlock* pblock, bool fForceProcessing, CDiskBlockPos *dbp)
 {
     // Preliminary checks
-    bool checked; 
+    bool checked;
     int32_t futureblock=0;
     auto verifier = libzcash::ProofVerifier::Disabled();
     uint256 hash = pblock->GetHash();
+    // Start pulling this block's spent coins into the database caches while
+    // we wait for cs_main below.
+    PrefetchBlockInputs(*pblock);
     {
         LOCK(cs_main);
         if ( chainActive.Tip() != 0 )
             komodo_currentheight_set(chainActive.Tip()->nHeight);
+        // If this block extends the tip, verify its scripts in the background
+        // while the proof-of-work check and AcceptBlock's disk write run below;
+        // ConnectBlock then finds the verdicts in the script execution cache.
+        SpeculativeVerifyBlockScripts(*pblock);
         checked = CheckBlock(&futureblock,height!=0?height:komodo_block2height(pblock),0,*pblock, state, verifier,0);
         bool fRequested = MarkBlockAsReceived(hash);
         fRequested |= fForceProcessing;
@@ -5985,6 +7587,16 @@ void FindFilesToPrune(std::set<int>& setFilesToPrune)
         return;
     }
     unsigned int nLastBlockWeCanPrune = chainActive.Tip()->nHeight - MIN_BLOCKS_TO_KEEP;
+    // A chain can reorg arbitrarily deep until a notarization pins it on the
+    // parent chain, so never prune at or past the last notarized height; the
+    // notarized block itself stays available for MoM proofs. Chains that have
+    // not been notarized yet keep the MIN_BLOCKS_TO_KEEP window only.
+    {
+        int32_t prevMoMheight; uint256 notarized_hash,notarized_desttxid;
+        int32_t notarized_height = komodo_notarized_height(&prevMoMheight,&notarized_hash,&notarized_desttxid);
+        if (notarized_height > 0 && (unsigned int)notarized_height <= nLastBlockWeCanPrune)
+            nLastBlockWeCanPrune = notarized_height - 1;
+    }
     uint64_t nCurrentUsage = CalculateCurrentUsage();
     // We don't check to prune until after we've allocated new space for files
     // So we should leave a buffer under our target to account for another allocation
@@ -6115,7 +7727,7 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
+    CBlockIndex* pindexNew = NewBlockIndex();
     if (!pindexNew)
         throw runtime_error("LoadBlockIndex(): new CBlockIndex failed");
     mi = mapBlockIndex.insert(make_pair(hash, pindexNew)).first;
@@ -6285,6 +7897,15 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
+    // Check whether we have a height-partitioned address index mirror
+    pblocktree->ReadFlag("addressheightindex", fAddressHeightIndex);
+    pblocktree->SetAddressHeightIndexing(fAddressHeightIndex);
+    LogPrintf("%s: address height index %s\n", __func__, fAddressHeightIndex ? "enabled" : "disabled");
+
+    // Check whether we have a compact block filter index
+    pblocktree->ReadFlag("blockfilterindex", fBlockFilterIndex);
+    LogPrintf("%s: block filter index %s\n", __func__, fBlockFilterIndex ? "enabled" : "disabled");
+
     // Check whether we have a timestamp index
     pblocktree->ReadFlag("timestampindex", fTimestampIndex);
     LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
@@ -6293,6 +7914,9 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
+    // Seed the watch index address set
+    LoadWatchedAddresses();
+
     // Fill in-memory data
     for(const auto& item : mapBlockIndex)
     {
@@ -6320,9 +7944,11 @@ bool static LoadBlockIndexDB()
 
     PruneBlockIndexCandidates();
 
+    LoadSyncTxRate();
+
     double progress;
     if ( chainName.isKMD() ) {
-        progress = Checkpoints::GuessVerificationProgress(chainparams.Checkpoints(), chainActive.Tip());
+        progress = EstimateVerificationProgress(chainActive.Tip());
     } else {
         int32_t longestchain = komodo_longestchain();
         // TODO: komodo_longestchain does not have the data it needs at the time LoadBlockIndexDB
@@ -6387,47 +8013,137 @@ bool CVerifyDB::VerifyDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth
     CBlockIndex* pindexFailure = NULL;
     int nGoodTransactions = 0;
     CValidationState state;
-    // No need to verify JoinSplits twice
-    auto verifier = libzcash::ProofVerifier::Disabled();
     //fprintf(stderr,"start VerifyDB %u\n",(uint32_t)time(NULL));
-    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev)
-    {
-        boost::this_thread::interruption_point();
-        uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100)))));
+
+    // Collect the blocks to verify, tip first, so workers can read and
+    // check-verify them ahead of the sequential undo/disconnect walk below.
+    // Levels 0 and 1 are non-contextual and independent per block.
+    std::vector<CBlockIndex*> vBlocks;
+    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev) {
         if (pindex->nHeight < chainActive.Height()-nCheckDepth)
             break;
+        vBlocks.push_back(pindex);
+    }
+
+    struct CVerifyDBItem {
         CBlock block;
-        // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex,0))
+        bool fDone;
+        bool fReadFailed;
+        bool fCheckFailed;
+        CVerifyDBItem() : fDone(false), fReadFailed(false), fCheckFailed(false) {}
+    };
+    std::vector<CVerifyDBItem> vItems(vBlocks.size());
+    boost::mutex mutexVerify;
+    boost::condition_variable condVerify;
+    size_t nNextWork = 0;   // next unclaimed slot
+    size_t nConsumed = 0;   // first slot the consumer still needs
+    bool fWorkersAbort = false;
+    static const size_t nLookahead = 64; // bounds decoded-block memory
+
+    int nWorkers = std::max(1, nScriptCheckThreads != 0 ? nScriptCheckThreads : (int)boost::thread::hardware_concurrency());
+    boost::thread_group workers;
+    for (int t = 0; t < nWorkers; t++) {
+        workers.create_thread([&]() {
+            RenameThread("zcash-verifydb");
+            // No need to verify JoinSplits twice
+            auto verifier = libzcash::ProofVerifier::Disabled();
+            while (true) {
+                size_t i;
+                {
+                    boost::unique_lock<boost::mutex> lock(mutexVerify);
+                    while (!fWorkersAbort && nNextWork < vItems.size() && nNextWork >= nConsumed + nLookahead)
+                        condVerify.wait(lock);
+                    if (fWorkersAbort || nNextWork >= vItems.size())
+                        return;
+                    i = nNextWork++;
+                }
+                CVerifyDBItem& item = vItems[i];
+                CBlockIndex* pindex = vBlocks[i];
+                // check level 0: read from disk
+                if (!ReadBlockFromDisk(item.block, pindex, 0)) {
+                    item.fReadFailed = true;
+                // check level 1: verify block validity
+                } else if (nCheckLevel >= 1) {
+                    int32_t futureblock;
+                    CValidationState stateWorker;
+                    if (!CheckBlock(&futureblock, pindex->nHeight, pindex, item.block, stateWorker, verifier, 0))
+                        item.fCheckFailed = true;
+                }
+                boost::unique_lock<boost::mutex> lock(mutexVerify);
+                item.fDone = true;
+                condVerify.notify_all();
+            }
+        });
+    }
+    bool fStopped = false;
+    auto StopWorkers = [&]() {
+        if (fStopped) return;
+        fStopped = true;
+        {
+            boost::unique_lock<boost::mutex> lock(mutexVerify);
+            fWorkersAbort = true;
+            condVerify.notify_all();
+        }
+        workers.join_all();
+    };
+
+    for (size_t i = 0; i < vItems.size(); i++)
+    {
+        boost::this_thread::interruption_point();
+        CBlockIndex* pindex = vBlocks[i];
+        uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100)))));
+        CVerifyDBItem& item = vItems[i];
+        {
+            boost::unique_lock<boost::mutex> lock(mutexVerify);
+            while (!item.fDone)
+                condVerify.wait(lock);
+        }
+        if (item.fReadFailed) {
+            StopWorkers();
             return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-        // check level 1: verify block validity
-        int32_t futureblock;
-        if (nCheckLevel >= 1 && !CheckBlock(&futureblock,pindex->nHeight,pindex,block, state, verifier,0) )
+        }
+        if (item.fCheckFailed) {
+            StopWorkers();
             return error("VerifyDB(): *** found bad block at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+        }
         // check level 2: verify undo validity
         if (nCheckLevel >= 2 && pindex) {
             CBlockUndo undo;
             CDiskBlockPos pos = pindex->GetUndoPos();
             if (!pos.IsNull()) {
-                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash()))
+                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash())) {
+                    StopWorkers();
                     return error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+                }
             }
         }
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
         if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
             bool fClean = true;
-            if (!DisconnectBlock(block, state, pindex, coins, &fClean))
+            if (!DisconnectBlock(item.block, state, pindex, coins, &fClean)) {
+                StopWorkers();
                 return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+            }
             pindexState = pindex->pprev;
             if (!fClean) {
                 nGoodTransactions = 0;
                 pindexFailure = pindex;
             } else
-                nGoodTransactions += block.vtx.size();
+                nGoodTransactions += item.block.vtx.size();
+        }
+        // Release the decoded block and let workers advance the window.
+        {
+            boost::unique_lock<boost::mutex> lock(mutexVerify);
+            item.block = CBlock();
+            nConsumed = i + 1;
+            condVerify.notify_all();
         }
-        if (ShutdownRequested())
+        if (ShutdownRequested()) {
+            StopWorkers();
             return true;
+        }
     }
+    StopWorkers();
     //fprintf(stderr,"end VerifyDB %u\n",(uint32_t)time(NULL));
     if (pindexFailure)
         return error("VerifyDB(): *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", chainActive.Height() - pindexFailure->nHeight + 1, nGoodTransactions);
@@ -6617,6 +8333,7 @@ void UnloadBlockIndex()
     mempool.clear();
     mapOrphanTransactions.clear();
     mapOrphanTransactionsByPrev.clear();
+    mapOrphanTransactionsByPeer.clear();
     nSyncStarted = 0;
     mapBlocksUnlinked.clear();
     vinfoBlockFile.clear();
@@ -6631,12 +8348,13 @@ void UnloadBlockIndex()
     setDirtyFileInfo.clear();
     mapNodeState.clear();
     recentRejects.reset(NULL);
-
-    for(BlockMap::value_type& entry : mapBlockIndex) 
     {
-        delete entry.second;
+        LOCK(cs_recentlySpent);
+        recentlySpentFilter.reset(NULL);
     }
+
     mapBlockIndex.clear();
+    FreeBlockIndexArenas();
     fHavePruned = false;
 }
 
@@ -6670,6 +8388,10 @@ bool InitBlockIndex()
 
     // Initialize global variables that cannot be constructed at startup.
     recentRejects.reset(new CRollingBloomFilter(120000, 0.000001));
+    {
+        LOCK(cs_recentlySpent);
+        recentlySpentFilter.reset(new CRollingBloomFilter(50000, 0.000001));
+    }
     // Check whether we're already initialized
     if (chainActive.Genesis() != NULL)
     {
@@ -6683,7 +8405,16 @@ bool InitBlockIndex()
         // Use the provided setting for -addressindex in the new database
         fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
         pblocktree->WriteFlag("addressindex", fAddressIndex);
-        
+
+        // Use the provided setting for -addressheightindex in the new database
+        fAddressHeightIndex = GetBoolArg("-addressheightindex", DEFAULT_ADDRESSHEIGHTINDEX);
+        pblocktree->WriteFlag("addressheightindex", fAddressHeightIndex);
+        pblocktree->SetAddressHeightIndexing(fAddressHeightIndex);
+
+        // Use the provided setting for -blockfilterindex in the new database
+        fBlockFilterIndex = GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+        pblocktree->WriteFlag("blockfilterindex", fBlockFilterIndex);
+
         // Use the provided setting for -timestampindex in the new database
         fTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
         pblocktree->WriteFlag("timestampindex", fTimestampIndex);
@@ -7112,6 +8843,7 @@ bool static AlreadyHave(const CInv& inv) REQUIRES(cs_main)
 
             return recentRejects->contains(inv.hash) ||
             mempool.exists(inv.hash) ||
+            mempool.existsCold(inv.hash) ||
             mapOrphanTransactions.count(inv.hash) ||
             pcoinsTip->HaveCoins(inv.hash);
         }
@@ -7122,6 +8854,13 @@ bool static AlreadyHave(const CInv& inv) REQUIRES(cs_main)
     return true;
 }
 
+/** Serialized "block" messages recently served in response to getdata, shared
+ *  between the send queues of all requesting peers (protected by cs_main). A
+ *  freshly announced block is requested by most of our peers in a short
+ *  window, so a handful of entries covers nearly all repeat requests. */
+static std::map<uint256, std::shared_ptr<const CSerializeData> > mapBlockMsgCache;
+static const size_t MAX_BLOCK_MSG_CACHE = 8;
+
 void static ProcessGetData(CNode* pfrom)
 {
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
@@ -7140,7 +8879,7 @@ void static ProcessGetData(CNode* pfrom)
             boost::this_thread::interruption_point();
             it++;
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
             {
                 bool send = false;
                 BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
@@ -7165,6 +8904,39 @@ void static ProcessGetData(CNode* pfrom)
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
                 {
+                    // When a block is first announced most peers request the
+                    // identical bytes; serve repeat requests from the shared
+                    // message cache instead of re-reading and re-serializing
+                    // the block once per peer
+                    std::map<uint256, std::shared_ptr<const CSerializeData> >::iterator bmi =
+                        inv.type == MSG_BLOCK ? mapBlockMsgCache.find(inv.hash) : mapBlockMsgCache.end();
+                    if (bmi != mapBlockMsgCache.end())
+                    {
+                        LogPrint("net1", "sending cached block %s to %d in resp to getdata\n", inv.hash.ToString(), pfrom->id);
+                        pfrom->PushSharedMessage("block", (*bmi).second);
+                    }
+                    else if (inv.type == MSG_BLOCK)
+                    {
+                        // Full blocks go out as the raw on-disk record: the
+                        // bytes move from the mapped block file into the
+                        // message without ever being deserialized
+                        LogPrint("net1", "sending block %s to %d in resp to getdata\n", inv.hash.ToString(), pfrom->id);
+                        CDataStream& ssBlock = GetScratchStream(SER_NETWORK, PROTOCOL_VERSION);
+                        if (!ReadRawBlockFromDisk(ssBlock, (*mi).second->GetBlockPos()))
+                        {
+                            CBlock block;
+                            if (!ReadBlockFromDisk(block, (*mi).second,1))
+                                assert(!"cannot load block from disk");
+                            ssBlock << block;
+                        }
+                        std::shared_ptr<const CSerializeData> msg = BuildNetMessage("block", ssBlock);
+                        if (mapBlockMsgCache.size() >= MAX_BLOCK_MSG_CACHE)
+                            mapBlockMsgCache.clear();
+                        mapBlockMsgCache[inv.hash] = msg;
+                        pfrom->PushSharedMessage("block", msg);
+                    }
+                    else
+                    {
                     // Send block from disk
                     CBlock block;
                     if (!ReadBlockFromDisk(block, (*mi).second,1))
@@ -7173,14 +8945,18 @@ void static ProcessGetData(CNode* pfrom)
                     }
                     else
                     {
-                        if (inv.type == MSG_BLOCK)
+                        if (inv.type == MSG_CMPCT_BLOCK)
                         {
-                            //uint256 hash; int32_t z;
-                            //hash = block.GetHash();
-                            //for (z=31; z>=0; z--)
-                            //    fprintf(stderr,"%02x",((uint8_t *)&hash)[z]);
-                            LogPrint("net1", "sending block %s to %d in resp to getdata\n", block.GetHash().ToString(), pfrom->id);
-                            pfrom->PushMessage("block", block);
+                            // Only blocks near the tip stand a chance of
+                            // reconstructing from the peer's mempool; anything
+                            // deeper goes out in full
+                            if (mi->second->nHeight >= chainActive.Height() - 10)
+                            {
+                                CBlockHeaderAndShortTxIDs cmpctblock(block);
+                                pfrom->PushMessage("cmpctblock", cmpctblock);
+                            }
+                            else
+                                pfrom->PushMessage("block", block);
                         }
                         else // MSG_FILTERED_BLOCK)
                         {
@@ -7204,6 +8980,7 @@ void static ProcessGetData(CNode* pfrom)
                             // no response
                         }
                     }
+                    }
                     // Trigger the peer node to send a getblocks (correction: getheaders) request for the next batch of inventory
                     if (inv.hash == pfrom->hashContinue)
                     {
@@ -7223,16 +9000,16 @@ void static ProcessGetData(CNode* pfrom)
                 bool pushed = false;
                 {
                     LOCK(cs_mapRelay);
-                    map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
-                    if (mi != mapRelay.end()) {
-                        pfrom->PushMessage(inv.GetCommand(), (*mi).second);
+                    std::shared_ptr<const CSerializeData>* pdata = mapRelay.find(inv);
+                    if (pdata != NULL) {
+                        pfrom->PushSharedMessage(inv.GetCommand(), *pdata);
                         pushed = true;
                     }
                 }
                 if (!pushed && inv.type == MSG_TX) {
                     CTransaction tx;
-                    if (mempool.lookup(inv.hash, tx)) {
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+                    if (mempool.lookup(inv.hash, tx) || mempool.lookupCold(inv.hash, tx)) {
+                        CDataStream& ss = GetScratchStream(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
                         ss << tx;
                         pfrom->PushMessage("tx", ss);
@@ -7244,7 +9021,7 @@ void static ProcessGetData(CNode* pfrom)
                 }
             }
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
                 break;
         }
     }
@@ -7271,6 +9048,39 @@ void static ProcessGetData(CNode* pfrom)
 
 void komodo_netevent(std::vector<uint8_t> payload);
 
+static void CheckHeaderSolutionsWorker(const std::vector<CBlockHeader>* pheaders, size_t nStart, size_t nStride, std::atomic<int>* pnFirstInvalid)
+{
+    for (size_t i = nStart; i < pheaders->size(); i += nStride) {
+        int nBad = pnFirstInvalid->load();
+        if (nBad != -1 && (size_t)nBad < i)
+            break; // an earlier header already failed, the rest is moot
+        if (!CheckEquihashSolution(&(*pheaders)[i], Params())) {
+            // record the earliest failure
+            while ((nBad == -1 || (int)i < nBad) && !pnFirstInvalid->compare_exchange_weak(nBad, (int)i)) {}
+        }
+    }
+}
+
+/**
+ * @brief Verify the Equihash solutions of a batch of headers on worker threads
+ * @param headers the headers, oldest first
+ * @returns the index of the first header with an invalid solution, or -1 if all are valid
+ */
+static int BatchCheckHeaderSolutions(const std::vector<CBlockHeader>& headers)
+{
+    std::atomic<int> nFirstInvalid(-1);
+    int nThreads = std::max(1, std::min(GetNumCores(), 8));
+    if (headers.size() > 1 && nThreads > 1) {
+        boost::thread_group group;
+        for (int i = 0; i < nThreads; i++)
+            group.create_thread(boost::bind(&CheckHeaderSolutionsWorker, &headers, (size_t)i, (size_t)nThreads, &nFirstInvalid));
+        group.join_all();
+    } else {
+        CheckHeaderSolutionsWorker(&headers, 0, 1, &nFirstInvalid);
+    }
+    return nFirstInvalid.load();
+}
+
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
 {
     int32_t nProtocolVersion;
@@ -7466,6 +9276,13 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             LOCK(cs_main);
             State(pfrom->GetId())->fCurrentlyConnected = true;
         }
+
+        if (pfrom->nServices & NODE_COMPACT_BLOCKS) {
+            // Ask a capable peer to announce new blocks to us as compact
+            // blocks instead of inv
+            bool fAnnounceUsingCMPCTBLOCK = true;
+            pfrom->PushMessage("sendcmpct", fAnnounceUsingCMPCTBLOCK, CMPCTBLOCK_VERSION);
+        }
     }
 
 
@@ -7729,7 +9546,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             LogPrint("net", "got inv: %s  %s peer=%d\n", inv.ToString(), fAlreadyHave ? "have" : "new", pfrom->id);
 
             if (!fAlreadyHave && !fImporting && !fReindex && inv.type != MSG_BLOCK)
-                pfrom->AskFor(inv);
+                TxRequestAnnounced(pfrom->GetId(), inv.hash);
 
             if (inv.type == MSG_BLOCK) {
                 UpdateBlockAvailability(pfrom->GetId(), inv.hash);
@@ -7745,8 +9562,13 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     pfrom->PushMessage("getheaders", chainActive.GetLocator(pindexBestHeader), inv.hash);
                     CNodeState *nodestate = State(pfrom->GetId());
                     if (chainActive.Tip()->GetBlockTime() > GetTime() - chainparams.GetConsensus().nPowTargetSpacing * 20 &&
-                        nodestate->nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
-                        vToFetch.push_back(inv);
+                        nodestate->nBlocksInFlight < nodestate->nDownloadWindow) {
+                        // Near the tip a compact-block capable peer can skip
+                        // shipping transactions we already have in the mempool
+                        if (pfrom->nServices & NODE_COMPACT_BLOCKS)
+                            vToFetch.push_back(CInv(MSG_CMPCT_BLOCK, inv.hash));
+                        else
+                            vToFetch.push_back(inv);
                         // Mark block as in flight already, even though the actual "getdata" message only goes out
                         // later (within the same cs_main lock, though).
                         MarkBlockAsInFlight(pfrom->GetId(), inv.hash, chainparams.GetConsensus());
@@ -7877,12 +9699,25 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
 
+    else if (strCommand == "getcfilter")
+    {
+        uint256 blockhash;
+        vRecv >> blockhash;
+
+        // Filters are only served when the local index is enabled; peers
+        // asking without it just get no reply, same as an unknown block.
+        std::vector<unsigned char> vchFilter;
+        if (fBlockFilterIndex && GetBlockFilter(blockhash, vchFilter))
+            pfrom->PushMessage("cfilter", blockhash, vchFilter);
+    }
+
+
     else if (strCommand == "tx")
     {
         if (IsInitialBlockDownload())
             return true;
 
-        vector<uint256> vWorkQueue;
+        vector<COutPoint> vWorkQueue;
         vector<uint256> vEraseQueue;
         CTransaction tx;
         vRecv >> tx;
@@ -7890,30 +9725,90 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         CInv inv(MSG_TX, tx.GetHash());
         pfrom->AddInventoryKnown(inv);
 
-        LOCK(cs_main);
+        // Fast-reject relay of double spends before any validation: a hit on
+        // the recently-spent filter is confirmed against mempool.mapNextTx
+        // under the mempool lock only, so dust-wave conflict floods never
+        // contend for cs_main. False positives fall through to the confirm
+        // step and are never dropped on the filter's word alone.
+        bool fMaybeSpent = false;
+        {
+            LOCK(cs_recentlySpent);
+            if (recentlySpentFilter)
+            {
+                BOOST_FOREACH(const CTxIn &txin, tx.vin)
+                {
+                    if (recentlySpentFilter->contains(SpentFilterKey(txin.prevout)))
+                    {
+                        fMaybeSpent = true;
+                        break;
+                    }
+                }
+            }
+        }
+        if (fMaybeSpent)
+        {
+            LOCK(mempool.cs);
+            BOOST_FOREACH(const CTxIn &txin, tx.vin)
+            {
+                std::map<COutPoint, CInPoint>::iterator mi = mempool.mapNextTx.find(txin.prevout);
+                if (mi != mempool.mapNextTx.end() && mi->second.ptx->GetHash() != inv.hash)
+                {
+                    LogPrint("mempool", "dropping double-spend relay %s from peer=%d (conflicts with pool tx %s)\n",
+                             inv.hash.ToString(), pfrom->id, mi->second.ptx->GetHash().ToString());
+                    return true;
+                }
+            }
+        }
 
         bool fMissingInputs = false;
         CValidationState state;
 
-        pfrom->setAskFor.erase(inv.hash);
-        mapAlreadyAskedFor.erase(inv);
+        // Pre-validate before taking cs_main: syntactic rejects and bad
+        // shielded proofs are thrown out without contending for the lock, so
+        // a flood of invalid transactions can't stall the message thread
+        // behind block validation
+        if (!PrevalidateTransaction(tx, state))
+        {
+            LOCK(cs_main);
+            TxRequestCompleted(inv.hash);
+            assert(recentRejects);
+            recentRejects->insert(tx.GetHash());
+            int nDoS = 0;
+            if (state.IsInvalid(nDoS))
+            {
+                LogPrint("mempool", "%s from peer=%d %s was not accepted into the memory pool: %s\n", tx.GetHash().ToString(),
+                         pfrom->id, pfrom->cleanSubVer,
+                         state.GetRejectReason());
+                pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
+                                   state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash);
+                if (nDoS > 0)
+                    Misbehaving(pfrom->GetId(), nDoS);
+            }
+            return true;
+        }
+
+        LOCK(cs_main);
+
+        TxRequestCompleted(inv.hash);
 
         if (!AlreadyHave(inv) && AcceptToMemoryPool(mempool, state, tx, true, &fMissingInputs))
         {
             mempool.check(pcoinsTip);
             RelayTransaction(tx);
-            vWorkQueue.push_back(inv.hash);
+            for (unsigned int i = 0; i < tx.vout.size(); i++)
+                vWorkQueue.push_back(COutPoint(inv.hash, i));
 
             LogPrint("mempool", "AcceptToMemoryPool: peer=%d %s: accepted %s (poolsz %u)\n",
                      pfrom->id, pfrom->cleanSubVer,
                      tx.GetHash().ToString(),
                      mempool.mapTx.size());
 
-            // Recursively process any orphan transactions that depended on this one
+            // Recursively process any orphan transactions that depended on this
+            // one; each newly spendable outpoint is a single indexed lookup
             set<NodeId> setMisbehaving;
             for (unsigned int i = 0; i < vWorkQueue.size(); i++)
             {
-                map<uint256, set<uint256> >::iterator itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue[i]);
+                map<COutPoint, set<uint256> >::iterator itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue[i]);
                 if (itByPrev == mapOrphanTransactionsByPrev.end())
                     continue;
                 for (set<uint256>::iterator mi = itByPrev->second.begin();
@@ -7936,7 +9831,8 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     {
                         LogPrint("mempool", "   accepted orphan tx %s\n", orphanHash.ToString());
                         RelayTransaction(orphanTx);
-                        vWorkQueue.push_back(orphanHash);
+                        for (unsigned int j = 0; j < orphanTx.vout.size(); j++)
+                            vWorkQueue.push_back(COutPoint(orphanHash, j));
                         vEraseQueue.push_back(orphanHash);
                     }
                     else if (!fMissingInputs2)
@@ -8035,6 +9931,17 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         }
         LogPrint("net1", "]\n");
 
+        // Verify the whole batch's Equihash solutions on worker threads
+        // before taking cs_main: the expensive per-header work happens in
+        // parallel and without the lock, and AcceptBlockHeader commits the
+        // pre-verified batch in one critical section below.
+        int nFirstInvalid = BatchCheckHeaderSolutions(headers);
+        if (nFirstInvalid != -1) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 100);
+            return error("invalid Equihash solution in header %d of headers message", nFirstInvalid);
+        }
+
         LOCK(cs_main);
 
         if (nCount == 0) {
@@ -8144,6 +10051,187 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
     }
 
+    else if (strCommand == "sendcmpct")
+    {
+        bool fAnnounceUsingCMPCTBLOCK = false;
+        uint64_t nCMPCTBLOCKVersion = 0;
+        vRecv >> fAnnounceUsingCMPCTBLOCK >> nCMPCTBLOCKVersion;
+        if (nCMPCTBLOCKVersion == CMPCTBLOCK_VERSION)
+            pfrom->fPreferCmpctBlocks = fAnnounceUsingCMPCTBLOCK;
+    }
+
+    else if (strCommand == "cmpctblock" && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
+
+        uint256 hash = cmpctblock.header.GetHash();
+        LogPrint("cmpctblock", "received cmpctblock %s peer=%d\n", hash.ToString(), pfrom->id);
+
+        bool fBlockReconstructed = false;
+        CBlock block;
+        {
+            LOCK(cs_main);
+
+            if (mapBlockIndex.count(hash) != 0 && (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA))
+                return true; // Nothing to do: we already have this block
+
+            if (mapBlockIndex.count(cmpctblock.header.hashPrevBlock) == 0) {
+                // We don't know the parent; a compact block is useless without
+                // connected headers, so just catch up headers-first.
+                if (!IsInitialBlockDownload())
+                    pfrom->PushMessage("getheaders", chainActive.GetLocator(pindexBestHeader), uint256());
+                return true;
+            }
+
+            PartiallyDownloadedBlock partialBlock(&mempool);
+            ReadStatus status = partialBlock.InitData(cmpctblock);
+            if (status == READ_STATUS_INVALID) {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("invalid cmpctblock %s from peer=%d", hash.ToString(), pfrom->id);
+            }
+            if (status == READ_STATUS_FAILED) {
+                // Short id collisions or a malformed hash table; fall back to a
+                // normal block download rather than penalizing the peer.
+                std::vector<CInv> vGetData;
+                vGetData.push_back(CInv(MSG_BLOCK, hash));
+                pfrom->PushMessage("getdata", vGetData);
+                return true;
+            }
+
+            BlockTransactionsRequest req;
+            for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
+                if (!partialBlock.IsTxAvailable(i))
+                    req.indexes.push_back(i);
+            }
+            if (req.indexes.empty()) {
+                std::vector<CTransaction> dummy;
+                status = partialBlock.FillBlock(block, dummy);
+                if (status == READ_STATUS_OK)
+                    fBlockReconstructed = true;
+                else {
+                    std::vector<CInv> vGetData;
+                    vGetData.push_back(CInv(MSG_BLOCK, hash));
+                    pfrom->PushMessage("getdata", vGetData);
+                    return true;
+                }
+            } else {
+                // Track at most one partial block per peer; a new announcement
+                // replaces whatever the peer had outstanding.
+                for (map<uint256, pair<NodeId, PartiallyDownloadedBlock> >::iterator it = mapPartialBlocks.begin(); it != mapPartialBlocks.end();) {
+                    if (it->second.first == pfrom->GetId())
+                        mapPartialBlocks.erase(it++);
+                    else
+                        ++it;
+                }
+                req.blockhash = hash;
+                mapPartialBlocks.insert(std::make_pair(hash, std::make_pair(pfrom->GetId(), partialBlock)));
+                pfrom->PushMessage("getblocktxn", req);
+            }
+        }
+
+        if (fBlockReconstructed) {
+            // Note that ProcessNewBlock must not be called while cs_main is held
+            CValidationState state;
+            ProcessNewBlock(0, 0, state, pfrom, &block, true, NULL);
+            int nDoS;
+            if (state.IsInvalid(nDoS)) {
+                pfrom->PushMessage("reject", std::string("block"), state.GetRejectCode(),
+                                   state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), hash);
+                if (nDoS > 0) {
+                    LOCK(cs_main);
+                    Misbehaving(pfrom->GetId(), nDoS);
+                }
+            }
+        }
+    }
+
+    else if (strCommand == "getblocktxn")
+    {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        LOCK(cs_main);
+
+        BlockMap::iterator mi = mapBlockIndex.find(req.blockhash);
+        if (mi == mapBlockIndex.end() || !(mi->second->nStatus & BLOCK_HAVE_DATA)) {
+            LogPrint("cmpctblock", "peer=%d sent getblocktxn for block we don't have\n", pfrom->id);
+            return true;
+        }
+
+        if (mi->second->nHeight < chainActive.Height() - 15) {
+            // Deep blocks won't have their transactions in anyone's mempool
+            // anyway; just serve the whole thing.
+            LogPrint("cmpctblock", "peer=%d sent getblocktxn for a block > 15 deep, sending full block\n", pfrom->id);
+            CBlock block;
+            if (ReadBlockFromDisk(block, mi->second, 1))
+                pfrom->PushMessage("block", block);
+            return true;
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, mi->second, 1))
+            return error("%s: cannot load block %s from disk", __func__, req.blockhash.ToString());
+
+        BlockTransactions resp(req);
+        for (size_t i = 0; i < req.indexes.size(); i++) {
+            if (req.indexes[i] >= block.vtx.size()) {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("peer=%d sent getblocktxn with out-of-bounds tx indexes", pfrom->id);
+            }
+            resp.txn[i] = block.vtx[req.indexes[i]];
+        }
+        pfrom->PushMessage("blocktxn", resp);
+    }
+
+    else if (strCommand == "blocktxn" && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        bool fBlockRead = false;
+        CBlock block;
+        {
+            LOCK(cs_main);
+
+            map<uint256, pair<NodeId, PartiallyDownloadedBlock> >::iterator it = mapPartialBlocks.find(resp.blockhash);
+            if (it == mapPartialBlocks.end() || it->second.first != pfrom->GetId()) {
+                LogPrint("cmpctblock", "peer=%d sent us blocktxn for block we weren't expecting\n", pfrom->id);
+                return true;
+            }
+
+            ReadStatus status = it->second.second.FillBlock(block, resp.txn);
+            mapPartialBlocks.erase(it);
+            if (status == READ_STATUS_INVALID) {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("invalid blocktxn %s from peer=%d", resp.blockhash.ToString(), pfrom->id);
+            }
+            if (status == READ_STATUS_FAILED) {
+                // Reconstruction failed (likely a short id collision); get the
+                // full block from the same peer.
+                std::vector<CInv> vGetData;
+                vGetData.push_back(CInv(MSG_BLOCK, resp.blockhash));
+                pfrom->PushMessage("getdata", vGetData);
+                return true;
+            }
+            fBlockRead = true;
+        }
+
+        if (fBlockRead) {
+            // Note that ProcessNewBlock must not be called while cs_main is held
+            CValidationState state;
+            ProcessNewBlock(0, 0, state, pfrom, &block, true, NULL);
+            int nDoS;
+            if (state.IsInvalid(nDoS)) {
+                pfrom->PushMessage("reject", std::string("block"), state.GetRejectCode(),
+                                   state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), resp.blockhash);
+                if (nDoS > 0) {
+                    LOCK(cs_main);
+                    Misbehaving(pfrom->GetId(), nDoS);
+                }
+            }
+        }
+    }
 
     else if (strCommand == "mempool")
     {
@@ -8318,8 +10406,19 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         }
     }
     else if (strCommand == "notfound") {
-        // We do not care about the NOTFOUND message, but logging an Unknown Command
-        // message would be undesirable as we transmit it ourselves.
+        // A peer telling us it doesn't have a transaction we asked for lets
+        // us fail over to another announcer right away
+        vector<CInv> vInv;
+        vRecv >> vInv;
+        if (vInv.size() <= MAX_INV_SZ)
+        {
+            LOCK(cs_main);
+            BOOST_FOREACH(const CInv& inv, vInv)
+            {
+                if (inv.type == MSG_TX)
+                    TxRequestFailed(pfrom->GetId(), inv.hash);
+            }
+        }
     }
 
     else {
@@ -8394,21 +10493,40 @@ bool ProcessMessages(CNode* pfrom)
         // Message size
         unsigned int nMessageSize = hdr.nMessageSize;
 
-        // Checksum
+        // Checksum. Whitelisted peers that negotiated FAST_CHECKSUM_VERSION
+        // may checksum with SipHash instead of SHA256d; try the cheap scheme
+        // first and fall back to SHA256d so legacy senders on the same link
+        // still verify.
         CDataStream& vRecv = msg.vRecv;
-        uint256 hash = Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
-        unsigned int nChecksum = ReadLE32((unsigned char*)&hash);
-        if (nChecksum != hdr.nChecksum)
+        bool fChecksumOk = false;
+        if (pfrom->fWhitelisted && pfrom->nVersion >= FAST_CHECKSUM_VERSION)
         {
-            LogPrintf("%s(%s, %u bytes): CHECKSUM ERROR nChecksum=%08x hdr.nChecksum=%08x\n", __func__,
-                      SanitizeString(strCommand), nMessageSize, nChecksum, hdr.nChecksum);
-            continue;
+            unsigned int nFastChecksum = FastMessageChecksum(Params().MessageStart(),
+                nMessageSize ? (const unsigned char*)&vRecv[0] : NULL, nMessageSize);
+            fChecksumOk = (nFastChecksum == hdr.nChecksum);
+        }
+        if (!fChecksumOk)
+        {
+            // The payload was hashed incrementally on the socket thread as it
+            // was received; only the finalization round happens here.
+            const uint256& hash = msg.GetMessageHash();
+            unsigned int nChecksum = ReadLE32((unsigned char*)&hash);
+            if (nChecksum != hdr.nChecksum)
+            {
+                LogPrintf("%s(%s, %u bytes): CHECKSUM ERROR nChecksum=%08x hdr.nChecksum=%08x\n", __func__,
+                          SanitizeString(strCommand), nMessageSize, nChecksum, hdr.nChecksum);
+                continue;
+            }
         }
 
         // Process message
         bool fRet = false;
         try
         {
+            TRACE3(net, inbound_message,
+                   pfrom->GetId(),
+                   strCommand.c_str(),
+                   (uint64_t)nMessageSize);
             fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
             boost::this_thread::interruption_point();
         }
@@ -8446,8 +10564,12 @@ bool ProcessMessages(CNode* pfrom)
     }
 
     // In case the connection got shut down, its receive buffer was wiped
-    if (!pfrom->fDisconnect)
+    if (!pfrom->fDisconnect) {
+        // hand processed payload buffers back to the shared pool
+        for (std::deque<CNetMessage>::iterator jt = pfrom->vRecvMsg.begin(); jt != it; ++jt)
+            jt->ReturnBuffer();
         pfrom->vRecvMsg.erase(pfrom->vRecvMsg.begin(), it);
+    }
 
     return fOk;
 }
@@ -8588,47 +10710,48 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         //
         // Message: inventory
         //
+        // Block announcements always go out at once. Transaction invs batch
+        // per peer: each peer gets its own announcement window scaled by its
+        // measured round trip, instead of one random trickle node per
+        // message-handler pass, so the pending list is drained once per
+        // window rather than rescanned on every loop.
         vector<CInv> vInv;
-        vector<CInv> vInvWait;
         {
             LOCK(pto->cs_inventory);
-            vInv.reserve(pto->vInventoryToSend.size());
-            vInvWait.reserve(pto->vInventoryToSend.size());
-            BOOST_FOREACH(const CInv& inv, pto->vInventoryToSend)
+            BOOST_FOREACH(const CInv& inv, pto->vBlockInvToSend)
             {
-                if (pto->setInventoryKnown.count(inv))
-                    continue;
-
-                // trickle out tx inv to protect privacy
-                if (inv.type == MSG_TX && !fSendTrickle)
-                {
-                    // 1/4 of tx invs blast to all immediately
-                    static uint256 hashSalt;
-                    if (hashSalt.IsNull())
-                        hashSalt = GetRandHash();
-                    uint256 hashRand = ArithToUint256(UintToArith256(inv.hash) ^ UintToArith256(hashSalt));
-                    hashRand = Hash(BEGIN(hashRand), END(hashRand));
-                    bool fTrickleWait = ((UintToArith256(hashRand) & 3) != 0);
-
-                    if (fTrickleWait)
-                    {
-                        vInvWait.push_back(inv);
-                        continue;
-                    }
-                }
-
-                // returns true if wasn't already contained in the set
                 if (pto->setInventoryKnown.insert(inv).second)
-                {
                     vInv.push_back(inv);
-                    if (vInv.size() >= 1000)
+            }
+            pto->vBlockInvToSend.clear();
+
+            bool fSendTxInv = fSendTrickle || pto->fWhitelisted;
+            int64_t nInvSendTime = GetTimeMicros();
+            if (pto->nNextInvSend < nInvSendTime)
+            {
+                fSendTxInv = true;
+                // Batch for at least half a second, at most a slow peer's
+                // round trip; a peer can't act on announcements any faster
+                // than it can answer them
+                pto->nNextInvSend = nInvSendTime + std::max((int64_t)500000, std::min((int64_t)5000000, pto->nPingUsecTime));
+            }
+            if (fSendTxInv && !pto->vInventoryToSend.empty())
+            {
+                BOOST_FOREACH(const CInv& inv, pto->vInventoryToSend)
+                {
+                    // returns true if wasn't already contained in the set
+                    if (pto->setInventoryKnown.insert(inv).second)
                     {
-                        pto->PushMessage("inv", vInv);
-                        vInv.clear();
+                        vInv.push_back(inv);
+                        if (vInv.size() >= 1000)
+                        {
+                            pto->PushMessage("inv", vInv);
+                            vInv.clear();
+                        }
                     }
                 }
+                pto->vInventoryToSend.clear();
             }
-            pto->vInventoryToSend = vInvWait;
         }
         if (!vInv.empty())
             pto->PushMessage("inv", vInv);
@@ -8664,16 +10787,30 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
                 pto->fDisconnect = true;
             }
         }
+        // A block that has been in flight for much longer than this peer's own
+        // smoothed download latency is stuck; hand it back to the scheduler so
+        // a faster peer can fetch it, and shrink this peer's window.
+        if (!pto->fDisconnect && state.vBlocksInFlight.size() > 0 && state.nBlockLatencyUsec > 0 && mapNodeState.size() > 1) {
+            const QueuedBlock &queuedBlock = state.vBlocksInFlight.front();
+            int64_t nStallThreshold = std::max((int64_t)10 * 1000000, 10 * state.nBlockLatencyUsec);
+            if (nNow - queuedBlock.nTime > nStallThreshold) {
+                uint256 hashStalled = queuedBlock.hash;
+                LogPrint("net", "Block %s stalled with peer=%d for %.1fs, reassigning\n",
+                         hashStalled.ToString(), pto->id, (nNow - queuedBlock.nTime) / 1000000.0);
+                state.nDownloadWindow = std::max(MAX_BLOCKS_IN_TRANSIT_PER_PEER, state.nDownloadWindow / 2);
+                MarkBlockAsReceived(hashStalled, false);
+            }
+        }
 
         //
         // Message: getdata (blocks)
         //
         static uint256 zero;
         vector<CInv> vGetData;
-        if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload()) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload()) && state.nBlocksInFlight < state.nDownloadWindow) {
             vector<CBlockIndex*> vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
+            FindNextBlocksToDownload(pto->GetId(), state.nDownloadWindow - state.nBlocksInFlight, vToDownload, staller);
             BOOST_FOREACH(CBlockIndex *pindex, vToDownload) {
                 vGetData.push_back(CInv(MSG_BLOCK, pindex->GetBlockHash()));
                 MarkBlockAsInFlight(pto->GetId(), pindex->GetBlockHash(), consensusParams, pindex);
@@ -8702,6 +10839,50 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             }
         }*/
 
+        //
+        // Message: getdata (transactions)
+        //
+        if (!pto->fDisconnect && !state.vTxGetData.empty())
+        {
+            BOOST_FOREACH(const uint256& hash, state.vTxGetData)
+            {
+                map<uint256, CTxRequest>::iterator it = mapTxRequests.find(hash);
+                if (it == mapTxRequests.end() || it->second.nRequestedFrom != pto->GetId())
+                    continue; // completed or reassigned while queued
+                CInv inv(MSG_TX, hash);
+                if (AlreadyHave(inv))
+                {
+                    TxRequestCompleted(hash);
+                    continue;
+                }
+                if (fDebug)
+                    LogPrint("net", "Requesting %s peer=%d\n", inv.ToString(), pto->id);
+                vGetData.push_back(inv);
+                state.mapTxInFlight[hash] = nNow;
+                if (vGetData.size() >= 1000)
+                {
+                    pto->PushMessage("getdata", vGetData);
+                    vGetData.clear();
+                }
+            }
+            state.vTxGetData.clear();
+        }
+        // Requests this peer has been sitting on go to another announcer
+        if (!state.mapTxInFlight.empty())
+        {
+            std::vector<uint256> vTimedOut;
+            for (map<uint256, int64_t>::iterator it = state.mapTxInFlight.begin(); it != state.mapTxInFlight.end(); ++it)
+            {
+                if (it->second < nNow - TX_REQUEST_TIMEOUT_MICROS)
+                    vTimedOut.push_back(it->first);
+            }
+            BOOST_FOREACH(const uint256& hash, vTimedOut)
+            {
+                LogPrint("net", "timeout for tx %s peer=%d\n", hash.ToString(), pto->id);
+                TxRequestFailed(pto->GetId(), hash);
+            }
+        }
+
         //
         // Message: getdata (non-blocks)
         //
@@ -8751,6 +10932,7 @@ public:
         // orphan transactions
         mapOrphanTransactions.clear();
         mapOrphanTransactionsByPrev.clear();
+        mapOrphanTransactionsByPeer.clear();
     }
 } instance_of_cmaincleanup;
 
@@ -34,6 +34,7 @@
 #include "net.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
+#include "random.h"
 #include "script/script.h"
 #include "script/serverchecker.h"
 #include "script/standard.h"
@@ -45,6 +46,8 @@
 #include "uint256.h"
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <exception>
 #include <map>
 #include <set>
@@ -57,6 +60,7 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CCoinsViewDB;
 class CBloomFilter;
 class CInv;
 class CScriptCheck;
@@ -99,8 +103,12 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
-/** Number of blocks that can be requested at any given time from a single peer. */
+/** Number of blocks that can be requested at any given time from a single peer.
+ *  This is the floor of the adaptive per-peer window, which grows toward the
+ *  measured bandwidth-delay product of the link. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Upper bound for the adaptive per-peer block download window. */
+static const int MAX_BLOCKS_IN_TRANSIT_DYNAMIC = 256;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
 static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
@@ -115,6 +123,9 @@ static unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
 static const unsigned int DATABASE_FLUSH_INTERVAL = 24 * 60 * 60;
+/** Time to wait (in seconds) between incrementally syncing the dirty part of
+ *  the chainstate cache to disk (keeps full flushes small and the cache warm). */
+static const unsigned int DATABASE_SYNC_INTERVAL = 60 * 60;
 /** Maximum length of reject messages. */
 static const unsigned int MAX_REJECT_MESSAGE_LENGTH = 111;
 static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
@@ -127,7 +138,11 @@ static const bool DEFAULT_TXINDEX = true;
 //static const bool DEFAULT_SPENTINDEX = false;
 #define DEFAULT_ADDRESSINDEX (GetArg("-ac_cc",0) != 0 || GetArg("-ac_ccactivate",0) != 0)
 #define DEFAULT_SPENTINDEX (GetArg("-ac_cc",0) != 0 || GetArg("-ac_ccactivate",0) != 0)
+static const bool DEFAULT_ADDRESSHEIGHTINDEX = false;
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
+/** Default for -persistmempool, saving the mempool on shutdown and reloading it on start */
+static const bool DEFAULT_PERSIST_MEMPOOL = true;
 static const unsigned int DEFAULT_DB_MAX_OPEN_FILES = 1000;
 static const bool DEFAULT_DB_COMPRESSION = true;
 
@@ -141,7 +156,11 @@ BOOST_STATIC_ASSERT(DEFAULT_BLOCK_PRIORITY_SIZE <= DEFAULT_BLOCK_MAX_SIZE);
 
 struct BlockHasher
 {
-    size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+    // Block hashes are already uniformly distributed, but salt the hash so a
+    // peer grinding header hashes cannot steer entries into a single bucket.
+    uint256 salt;
+    BlockHasher() : salt(GetRandHash()) {}
+    size_t operator()(const uint256& hash) const { return (size_t)hash.GetHash(salt); }
 };
 
 extern unsigned int expiryDelta;
@@ -163,10 +182,13 @@ extern bool fTxIndex;
 extern bool fIsBareMultisigStd;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+//! Treat input scripts of blocks at notarized depth as assumed valid (see ConnectBlock)
+extern bool fAssumeNotarized;
 // TODO: remove this flag by structuring our code such that
 // it is unneeded for testing
 extern bool fCoinbaseEnforcedProtectionEnabled;
 extern size_t nCoinCacheUsage;
+extern size_t nCoinCacheUsageConfigured;
 extern CFeeRate minRelayTxFee;
 extern bool fAlerts;
 extern int64_t nMaxTipAge;
@@ -174,6 +196,39 @@ extern int64_t nMaxTipAge;
 /** Best header we've seen so far (used for getheaders queries' starting points). */
 extern CBlockIndex *pindexBestHeader;
 
+/** Bumped by UpdateTip on every tip change (connect and disconnect), so
+ * status RPCs can detect a stale cached summary without taking cs_main. */
+extern std::atomic<uint64_t> nChainTipSequence;
+
+/** Last tip published by UpdateTip. The pointed-to CBlockIndex and its
+ * pprev/pskip ancestry are immutable once published (block index entries are
+ * never freed while running), so read-only RPC handlers may walk a loaded
+ * tip without taking cs_main. NULL until the first tip is set. */
+extern std::atomic<CBlockIndex*> pindexPublishedTip;
+
+/** Stages of block connection timed for the getvalidationstats RPC. The
+ * timers sit behind the existing bench timestamps and are always on. */
+enum ValidationStage {
+    VSTAGE_CONNECT = 0,   //!< fetch inputs and connect transactions
+    VSTAGE_VERIFY,        //!< wait for script/CC check completion
+    VSTAGE_INDEX,         //!< txindex/addressindex batch writes
+    VSTAGE_CALLBACKS,     //!< per-block callbacks (notarisations etc.)
+    VSTAGE_READBLOCK,     //!< load block from disk in ConnectTip
+    VSTAGE_FLUSH,         //!< coins cache flush to the backing view
+    VSTAGE_CHAINSTATE,    //!< periodic chainstate write to disk
+    VSTAGE_POSTCONNECT,   //!< mempool update and wallet/zmq sync
+    VSTAGE_TOTAL,         //!< whole ConnectTip
+    NUM_VALIDATION_STAGES
+};
+/** Display name of a ValidationStage. */
+const char* ValidationStageName(int stage);
+/** Copy one stage's accumulated timing: total count and microsecond sum,
+ * log2 histogram (bucket b counts durations below 2^(b+1) microseconds) and
+ * the rolling window of the most recent per-block durations. Reads atomics
+ * only; does not take cs_main. */
+void GetValidationStageStats(int stage, uint64_t& count, uint64_t& sumUsec,
+                             std::vector<uint64_t>& buckets, std::vector<uint32_t>& samplesUsec);
+
 /** Minimum disk space required - used in CheckDiskSpace() */
 static const uint64_t nMinDiskSpace = 52428800;
 
@@ -254,10 +309,22 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto, bool fSendTrickle);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the coin database prefetch thread */
+void ThreadCoinsPrefetch();
 /** Try to detect Partition (network isolation) attacks against us */
 void PartitionCheck(bool (*initialDownloadCheck)(), CCriticalSection& cs, const CBlockIndex *const &bestHeader, int64_t nPowTargetSpacing);
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
+/** Measured verification progress estimate for pindex: extrapolates the
+ *  remaining work from the chain's own recent tx rate instead of release-time
+ *  constants; falls back to the checkpoint guess when the index is too short
+ *  to measure. */
+double EstimateVerificationProgress(CBlockIndex *pindex);
+/** Seconds of syncing left from pindex at the measured verification
+ *  throughput; 0 when caught up, -1 when no estimate is available yet. */
+int64_t EstimateSyncTimeLeft(CBlockIndex *pindex);
+/** Seed the verification throughput estimate from the block tree db. */
+void LoadSyncTxRate();
 /** Check if the daemon is in sync, if not, it returns 1 or if due to best header only, the difference in best
  * header and activeChain tip
  */
@@ -273,6 +340,19 @@ std::string GetWarnings(const std::string& strFor);
  * @returns true if found
  */
 bool GetTransaction(const uint256 &hash, CTransaction &tx, uint256 &hashBlock, bool fAllowSlow = false);
+/**
+ * @brief Find several transactions in one pass (uses locks)
+ *
+ * Disk lookups are sorted by block file and offset so each block file is
+ * opened once and read front to back; transactions sharing a block reuse its
+ * header read. Results are returned in request order.
+ *
+ * @param[in] vtxid the transactions to look for
+ * @param[out] vtxOut one entry per txid; null where not found
+ * @param[out] vhashBlock matching containing-block hashes (all zeros for mempool or missing entries)
+ * @returns the number of transactions found
+ */
+int GetTransactions(const std::vector<uint256> &vtxid, std::vector<CTransaction> &vtxOut, std::vector<uint256> &vhashBlock);
 /** Find the best known block, and make it the tip of the block chain */
 bool ActivateBestChain(bool fSkipdpow, CValidationState &state, CBlock *pblock = NULL);
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
@@ -301,6 +381,15 @@ void UnlinkPrunedFiles(std::set<int>& setFilesToPrune);
 
 /** Create a new block index entry for a given block hash */
 CBlockIndex * InsertBlockIndex(uint256 hash);
+/** Allocate a CBlockIndex from the process-wide arena */
+CBlockIndex * NewBlockIndex();
+/** Allocate a CBlockIndex initialized from a block header */
+CBlockIndex * NewBlockIndex(const CBlockHeader& block);
+/** Take ownership of a shard of CBlockIndex objects built off-thread during
+ *  index load; element addresses are preserved */
+void AdoptBlockIndexArena(std::deque<CBlockIndex>& arena);
+/** Drop the storage behind every arena-allocated CBlockIndex */
+void FreeBlockIndexArenas();
 /** Get statistics from node state */
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 /** Increase a node's misbehavior score. */
@@ -319,10 +408,28 @@ void PruneAndFlush();
  * @param pfMissingInputs
  * @param fRejectAbsurdFee
  * @param dosLevel
+ * @param nAcceptTime entry timestamp to record (0 = now), set when reloading a saved mempool
  * @returns true on success
  */
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
-                        bool* pfMissingInputs, bool fRejectAbsurdFee=false, int dosLevel=-1);
+                        bool* pfMissingInputs, bool fRejectAbsurdFee=false, int dosLevel=-1, int64_t nAcceptTime=0);
+
+/**
+ * @brief Lock-free prefilter for AcceptToMemoryPool
+ *
+ * Runs the purely syntactic consensus checks without cs_main, so network
+ * threads can reject malformed transactions before queueing for the lock
+ * @param tx the transaction
+ * @param state receives the rejection reason
+ * @returns true if the transaction passes the lock-free checks
+ */
+bool PrevalidateTransaction(const CTransaction &tx, CValidationState &state);
+
+/** Reload a mempool saved by DumpMempool, re-accepting each transaction with its original entry time */
+bool LoadMempool();
+
+/** Save the current mempool (transactions, entry times and fee/priority deltas) to mempool.dat */
+void DumpMempool();
 
 
 struct CNodeStateStats {
@@ -664,6 +771,103 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+/** Height-first mirror of CAddressIndexKey, kept under its own prefix when
+ *  -addressheightindex is enabled. Sorting by (height, txindex) first turns
+ *  "all address activity between heights X and Y" into one sequential scan
+ *  instead of a seek per address. */
+struct CAddressHeightIndexKey {
+    int blockHeight;
+    unsigned int txindex;
+    unsigned int type;
+    uint160 hashBytes;
+    uint256 txhash;
+    size_t index;
+    bool spending;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 66;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        // Heights are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txindex);
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+        char f = spending;
+        ser_writedata8(s, f);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        blockHeight = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+        char f = ser_readdata8(s);
+        spending = f;
+    }
+
+    explicit CAddressHeightIndexKey(const CAddressIndexKey &key) {
+        blockHeight = key.blockHeight;
+        txindex = key.txindex;
+        type = key.type;
+        hashBytes = key.hashBytes;
+        txhash = key.txhash;
+        index = key.index;
+        spending = key.spending;
+    }
+
+    CAddressHeightIndexKey() {
+        SetNull();
+    }
+
+    CAddressIndexKey ToAddressIndexKey() const {
+        return CAddressIndexKey(type, hashBytes, blockHeight, txindex, txhash, index, spending);
+    }
+
+    void SetNull() {
+        blockHeight = 0;
+        txindex = 0;
+        type = 0;
+        hashBytes.SetNull();
+        txhash.SetNull();
+        index = 0;
+        spending = false;
+    }
+};
+
+struct CAddressHeightIndexIteratorKey {
+    int blockHeight;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 4;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata32be(s, blockHeight);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        blockHeight = ser_readdata32be(s);
+    }
+
+    CAddressHeightIndexIteratorKey(int height) {
+        blockHeight = height;
+    }
+
+    CAddressHeightIndexIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        blockHeight = 0;
+    }
+};
+
 struct CDiskTxPos : public CDiskBlockPos
 {
     unsigned int nTxOffset; // after header
@@ -834,9 +1038,30 @@ bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool GetAddressIndex(uint160 addressHash, int type,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                     int start = 0, int end = 0);
+                     int start = 0, int end = 0, size_t nMaxEntries = 0);
+bool GetAddressIndex(const std::vector<std::pair<uint160, int> > &addresses,
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                     int start = 0, int end = 0, size_t nMaxEntries = 0);
+bool GetAddressHeightIndex(int start, int end,
+                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex);
+bool GetBlockFilter(const uint256 &blockhash, std::vector<unsigned char> &vchFilter);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+/** Register an address with the watch index; its confirmed activity is
+ *  recorded from the next connected block onward, with no wallet involvement
+ *  and no rescan. */
+bool WatchAddress(const uint160 &addressHash, int type);
+/** Stop watching an address; already recorded history is kept. */
+bool UnwatchAddress(const uint160 &addressHash, int type);
+/** Fetch the registered watch addresses and their registration times. */
+void GetWatchedAddresses(std::map<std::pair<uint160, int>, int64_t> &addresses);
+/** Read watch index records for a set of addresses; same height-range and
+ *  pagination semantics as GetAddressIndex. */
+bool GetWatchIndex(const std::vector<std::pair<uint160, int> > &addresses,
+                   std::vector<std::pair<CAddressIndexKey, CAmount> > &watchIndex,
+                   int start = 0, int end = 0, size_t nMaxEntries = 0);
+/** Seed the in-memory watch set from the block tree db at startup. */
+bool LoadWatchedAddresses();
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
@@ -980,6 +1205,9 @@ extern CCoinsViewCache *pcoinsTip;
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
+/** Global variable that points to the coins database (protected by cs_main) */
+extern CCoinsViewDB *pcoinsdbview;
+
 /**
  * Return the spend height, which is one more than the inputs.GetBestBlock().
  * While checking, GetBestBlock() refers to the parent block. (protected by cs_main)
@@ -22,57 +22,92 @@
 
 #include "hash.h"
 #include "consensus/consensus.h"
+#include "sync.h"
 #include "utilstrencodings.h"
 #include "komodo_defs.h"
 using namespace std;
 
+/** Full merkle tree of one block in the flattened BuildMerkleTree layout,
+ *  cached so that repeated proof requests for the same block (filtered peers,
+ *  gettxoutproof) reuse both the leaf txids and all interior hashes. */
+struct CBlockMerkleTree
+{
+    unsigned int nLeaves;
+    std::vector<uint256> vTree;
+};
+
+static CCriticalSection cs_merkleTreeCache;
+static map<uint256, std::shared_ptr<const CBlockMerkleTree> > mapMerkleTreeCache;
+/** A tree costs roughly 64 bytes per transaction; a handful of entries covers
+ *  the popular-block case without a meaningful memory footprint. */
+static const size_t MAX_CACHED_MERKLE_TREES = 8;
+
+static std::shared_ptr<const CBlockMerkleTree> GetBlockMerkleTree(const CBlock& block)
+{
+    const uint256 hashBlock = block.GetHash();
+    {
+        LOCK(cs_merkleTreeCache);
+        map<uint256, std::shared_ptr<const CBlockMerkleTree> >::iterator it = mapMerkleTreeCache.find(hashBlock);
+        if (it != mapMerkleTreeCache.end())
+            return it->second;
+    }
+
+    std::shared_ptr<CBlockMerkleTree> tree = std::make_shared<CBlockMerkleTree>();
+    tree->nLeaves = block.vtx.size();
+    vector<uint256> vLeaves;
+    vLeaves.reserve(block.vtx.size());
+    for (unsigned int i = 0; i < block.vtx.size(); i++)
+        vLeaves.push_back(block.vtx[i].GetHash());
+    BuildMerkleTree(NULL, vLeaves, tree->vTree);
+
+    LOCK(cs_merkleTreeCache);
+    if (mapMerkleTreeCache.size() >= MAX_CACHED_MERKLE_TREES && !mapMerkleTreeCache.count(hashBlock))
+        mapMerkleTreeCache.erase(mapMerkleTreeCache.begin()); // evict an arbitrary entry
+    mapMerkleTreeCache[hashBlock] = tree;
+    return tree;
+}
+
 CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter& filter)
 {
     header = block.GetBlockHeader();
 
-    vector<bool> vMatch;
-    vector<uint256> vHashes;
+    std::shared_ptr<const CBlockMerkleTree> tree = GetBlockMerkleTree(block);
 
+    vector<bool> vMatch;
     vMatch.reserve(block.vtx.size());
-    vHashes.reserve(block.vtx.size());
 
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
-        const uint256& hash = block.vtx[i].GetHash();
         if (filter.IsRelevantAndUpdate(block.vtx[i]))
         {
             vMatch.push_back(true);
-            vMatchedTxn.push_back(make_pair(i, hash));
+            vMatchedTxn.push_back(make_pair(i, tree->vTree[i]));
         }
         else
             vMatch.push_back(false);
-        vHashes.push_back(hash);
     }
 
-    txn = CPartialMerkleTree(vHashes, vMatch);
+    txn = CPartialMerkleTree(tree->vTree, tree->nLeaves, vMatch);
 }
 
 CMerkleBlock::CMerkleBlock(const CBlock& block, const std::set<uint256>& txids)
 {
     header = block.GetBlockHeader();
 
-    vector<bool> vMatch;
-    vector<uint256> vHashes;
+    std::shared_ptr<const CBlockMerkleTree> tree = GetBlockMerkleTree(block);
 
+    vector<bool> vMatch;
     vMatch.reserve(block.vtx.size());
-    vHashes.reserve(block.vtx.size());
 
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
-        const uint256& hash = block.vtx[i].GetHash();
-        if (txids.count(hash))
+        if (txids.count(tree->vTree[i]))
             vMatch.push_back(true);
         else
             vMatch.push_back(false);
-        vHashes.push_back(hash);
     }
 
-    txn = CPartialMerkleTree(vHashes, vMatch);
+    txn = CPartialMerkleTree(tree->vTree, tree->nLeaves, vMatch);
 }
 
 uint256 CPartialMerkleTree::CalcHash(int height, unsigned int pos, const std::vector<uint256> &vTxid) {
@@ -160,6 +195,54 @@ CPartialMerkleTree::CPartialMerkleTree(const std::vector<uint256> &vTxid, const
     TraverseAndBuild(nHeight, 0, vTxid, vMatch);
 }
 
+CPartialMerkleTree::CPartialMerkleTree(const std::vector<uint256> &vTree, unsigned int nLeaves, const std::vector<bool> &vMatch) : nTransactions(nLeaves), fBad(false) {
+    // reset state
+    vBits.clear();
+    vHash.clear();
+    vBits.reserve(2 * nLeaves);
+
+    // calculate height of tree
+    int nHeight = 0;
+    while (CalcTreeWidth(nHeight) > 1)
+        nHeight++;
+
+    // per-level offsets into the flattened tree (leaves first, root last);
+    // BuildMerkleTree pairs the odd last node with itself exactly like
+    // CalcHash, so the node at (height, pos) is vTree[vOffset[height] + pos]
+    std::vector<unsigned int> vOffset(nHeight + 1);
+    vOffset[0] = 0;
+    for (int h = 0; h < nHeight; h++)
+        vOffset[h+1] = vOffset[h] + CalcTreeWidth(h);
+
+    // iterative depth-first traversal emitting bits and hashes in the same
+    // order as TraverseAndBuild
+    std::vector<std::pair<int, unsigned int> > vStack;
+    vStack.reserve(nHeight + 2);
+    vStack.push_back(std::make_pair(nHeight, 0u));
+    while (!vStack.empty()) {
+        int height = vStack.back().first;
+        unsigned int pos = vStack.back().second;
+        vStack.pop_back();
+
+        // determine whether this node is the parent of at least one matched txid
+        bool fParentOfMatch = false;
+        for (unsigned int p = pos << height; p < (pos+1) << height && p < nTransactions; p++)
+            fParentOfMatch |= vMatch[p];
+        // store as flag bit
+        vBits.push_back(fParentOfMatch);
+        if (height==0 || !fParentOfMatch) {
+            // if at height 0, or nothing interesting below, store hash and stop
+            vHash.push_back(vTree[vOffset[height] + pos]);
+        } else {
+            // otherwise descend; the right child is pushed first so the left
+            // subtree is emitted first
+            if (pos*2+1 < CalcTreeWidth(height-1))
+                vStack.push_back(std::make_pair(height-1, pos*2+1));
+            vStack.push_back(std::make_pair(height-1, pos*2));
+        }
+    }
+}
+
 CPartialMerkleTree::CPartialMerkleTree() : nTransactions(0), fBad(true) {}
 
 uint256 CPartialMerkleTree::ExtractMatches(std::vector<uint256> &vMatch) {
@@ -122,6 +122,15 @@ public:
     /** Construct a partial merkle tree from a list of transaction ids, and a mask that selects a subset of them */
     CPartialMerkleTree(const std::vector<uint256> &vTxid, const std::vector<bool> &vMatch);
 
+    /**
+     * Construct a partial merkle tree from a prebuilt full tree in the
+     * flattened level-by-level layout produced by BuildMerkleTree (leaves
+     * first, root last). Every node hash is read straight out of the tree,
+     * so repeated proofs for the same block do no hashing at all; the
+     * traversal is iterative and writes directly into vBits/vHash.
+     */
+    CPartialMerkleTree(const std::vector<uint256> &vTree, unsigned int nLeaves, const std::vector<bool> &vMatch);
+
     CPartialMerkleTree();
 
     /**
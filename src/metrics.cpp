@@ -117,6 +117,31 @@ static bool loaded = false;
 
 extern int64_t GetNetworkHashPS(int lookup, int height);
 
+// Chain-tip snapshot for the metrics screen. It is pushed from the new-tip
+// signal so the once-a-second display refresh reads plain atomics instead of
+// taking cs_main and recomputing the network solution rate itself.
+static std::atomic<int> nMetricsHeight(0);
+static std::atomic<int64_t> nMetricsTipMedianTime(0);
+static std::atomic<int64_t> nMetricsNetSolps(0);
+static std::atomic<int64_t> nMetricsTipRefreshTime(0);
+
+static void UpdateChainTipMetrics()
+{
+    AssertLockHeld(cs_main);
+    if (chainActive.Tip() == NULL)
+        return;
+    nMetricsHeight = chainActive.Height();
+    nMetricsTipMedianTime = chainActive.Tip()->GetMedianTimePast();
+    nMetricsNetSolps = GetNetworkHashPS(120, -1);
+    nMetricsTipRefreshTime = GetTime();
+}
+
+static void metrics_NotifyBlockTip(const uint256& hash)
+{
+    LOCK(cs_main);
+    UpdateChainTipMetrics();
+}
+
 void TrackMinedBlock(uint256 hash)
 {
     LOCK(cs_metrics);
@@ -227,6 +252,9 @@ void ConnectMetricsScreen()
     uiInterface.ThreadSafeQuestion.connect(metrics_ThreadSafeQuestion);
     uiInterface.InitMessage.disconnect_all_slots();
     uiInterface.InitMessage.connect(metrics_InitMessage);
+    // Other listeners (e.g. the miner's solver cancellation) share this
+    // signal, so connect without clearing the existing slots.
+    uiInterface.NotifyBlockTip.connect(metrics_NotifyBlockTip);
 }
 
 int printStats(bool mining)
@@ -234,16 +262,22 @@ int printStats(bool mining)
     // Number of lines that are always displayed
     int lines = 4;
 
-    int height;
-    int64_t tipmediantime;
+    // The new-tip signal is not fired during initial block download, so the
+    // snapshot can go stale there; refresh it opportunistically, but never
+    // wait on validation for a cosmetic update.
+    if (nMetricsTipRefreshTime.load() + 10 < GetTime()) {
+        TRY_LOCK(cs_main, lockMain);
+        if (lockMain)
+            UpdateChainTipMetrics();
+    }
+
+    int height = nMetricsHeight.load();
+    int64_t tipmediantime = nMetricsTipMedianTime.load();
+    int64_t netsolps = nMetricsNetSolps.load();
     size_t connections;
-    int64_t netsolps;
     {
-        LOCK2(cs_main, cs_vNodes);
-        height = chainActive.Height();
-        tipmediantime = chainActive.Tip()->GetMedianTimePast();
+        LOCK(cs_vNodes);
         connections = vNodes.size();
-        netsolps = GetNetworkHashPS(120, -1);
     }
     auto localsolps = GetLocalSolPS();
 
@@ -348,50 +382,63 @@ int printMetrics(size_t cols, bool mining)
         int orphaned = 0;
         CAmount immature {0};
         CAmount mature {0};
+        bool fHaveDetails = false;
         {
-            LOCK2(cs_main, cs_metrics);
-            boost::strict_lock_ptr<std::list<uint256>> u = trackedBlocks.synchronize();
-            auto consensusParams = Params().GetConsensus();
-            auto tipHeight = chainActive.Height();
-
-            // Update orphans and calculate subsidies
-            std::list<uint256>::iterator it = u->begin();
-            while (it != u->end()) {
-                auto hash = *it;
-                if (mapBlockIndex.count(hash) > 0 &&
-                        chainActive.Contains(mapBlockIndex[hash])) {
-                    int height = mapBlockIndex[hash]->nHeight;
-                    CAmount subsidy = GetBlockSubsidy(height, consensusParams);
-                    if ((height > 0) && (height <= consensusParams.GetLastFoundersRewardBlockHeight())) {
-                        subsidy -= subsidy/5;
-                    }
-
-                    if ((static_cast<int32_t>(Params().CoinbaseMaturity() - (tipHeight - height)) > 0) ||
-                        (tipHeight < komodo_block_unlocktime(height) && subsidy >= ASSETCHAINS_TIMELOCKGTE)) {
-                        immature += subsidy;
+            // The orphan/subsidy breakdown needs the chain state; when
+            // validation holds cs_main just show the raw mined count this
+            // refresh instead of waiting.
+            TRY_LOCK(cs_main, lockMain);
+            if (!lockMain) {
+                mined = minedBlocks.get();
+            } else {
+                LOCK(cs_metrics);
+                boost::strict_lock_ptr<std::list<uint256>> u = trackedBlocks.synchronize();
+                auto consensusParams = Params().GetConsensus();
+                auto tipHeight = chainActive.Height();
+
+                // Update orphans and calculate subsidies
+                std::list<uint256>::iterator it = u->begin();
+                while (it != u->end()) {
+                    auto hash = *it;
+                    if (mapBlockIndex.count(hash) > 0 &&
+                            chainActive.Contains(mapBlockIndex[hash])) {
+                        int height = mapBlockIndex[hash]->nHeight;
+                        CAmount subsidy = GetBlockSubsidy(height, consensusParams);
+                        if ((height > 0) && (height <= consensusParams.GetLastFoundersRewardBlockHeight())) {
+                            subsidy -= subsidy/5;
+                        }
+
+                        if ((static_cast<int32_t>(Params().CoinbaseMaturity() - (tipHeight - height)) > 0) ||
+                            (tipHeight < komodo_block_unlocktime(height) && subsidy >= ASSETCHAINS_TIMELOCKGTE)) {
+                            immature += subsidy;
+                        } else {
+                            mature += subsidy;
+                        }
+                        it++;
                     } else {
-                        mature += subsidy;
+                        it = u->erase(it);
                     }
-                    it++;
-                } else {
-                    it = u->erase(it);
                 }
-            }
 
-            mined = minedBlocks.get();
-            orphaned = mined - u->size();
+                mined = minedBlocks.get();
+                orphaned = mined - u->size();
+                fHaveDetails = true;
+            }
         }
 
         if (mined > 0) {
             std::string units = Params().CurrencyUnits();
             std::cout << "- " << strprintf(_("You have mined %d blocks!"), mined) << std::endl;
-            std::cout << "  "
-                      << strprintf(_("Orphaned: %d blocks, Immature: %u %s, Mature: %u %s"),
-                                     orphaned,
-                                     FormatMoney(immature), units,
-                                     FormatMoney(mature), units)
-                      << std::endl;
-            lines += 2;
+            lines++;
+            if (fHaveDetails) {
+                std::cout << "  "
+                          << strprintf(_("Orphaned: %d blocks, Immature: %u %s, Mature: %u %s"),
+                                         orphaned,
+                                         FormatMoney(immature), units,
+                                         FormatMoney(mature), units)
+                          << std::endl;
+                lines++;
+            }
         }
     }
     std::cout << std::endl;
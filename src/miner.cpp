@@ -40,6 +40,7 @@
 #include "crypto/equihash.h"
 #endif
 #include "hash.h"
+#include "init.h"
 #include "key_io.h"
 #include "main.h"
 #include "metrics.h"
@@ -72,7 +73,12 @@
 #ifdef ENABLE_MINING
 #include <functional>
 #endif
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <set>
+#include <thread>
 
 using namespace std;
 
@@ -81,56 +87,9 @@ using namespace std;
 // BitcoinMiner
 //
 
-//
-// Unconfirmed transactions in the memory pool often depend on other
-// transactions in the memory pool. When we select transactions from the
-// pool, we select by highest priority or fee rate, so we might consider
-// transactions that depend on transactions that aren't yet in the block.
-// The COrphan class keeps track of these 'temporary orphans' while
-// CreateBlock is figuring out which transactions to include.
-//
-class COrphan
-{
-public:
-    const CTransaction* ptx;
-    set<uint256> setDependsOn;
-    CFeeRate feeRate;
-    double dPriority;
-
-    COrphan(const CTransaction* ptxIn) : ptx(ptxIn), feeRate(0), dPriority(0)
-    {
-    }
-};
-
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockSize = 0;
 
-// We want to sort transactions by priority and fee rate, so:
-typedef boost::tuple<double, CFeeRate, const CTransaction*> TxPriority;
-class TxPriorityCompare
-{
-    bool byFee;
-
-public:
-    TxPriorityCompare(bool _byFee) : byFee(_byFee) { }
-
-    bool operator()(const TxPriority& a, const TxPriority& b)
-    {
-        if (byFee)
-        {
-            if (a.get<1>() == b.get<1>())
-                return a.get<0>() < b.get<0>();
-            return a.get<1>() < b.get<1>();
-        }
-        else
-        {
-            if (a.get<0>() == b.get<0>())
-                return a.get<1>() < b.get<1>();
-            return a.get<0>() < b.get<0>();
-        }
-    }
-};
-
 void UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
 {
     if ( ASSETCHAINS_ADAPTIVEPOW <= 0 )
@@ -292,226 +251,75 @@ CBlockTemplate* CreateNewBlock(const CPubKey _pk, const CScript& _scriptPubKeyIn
         SaplingMerkleTree sapling_tree;
         assert(view.GetSaplingAnchorAt(view.GetBestAnchor(SAPLING), sapling_tree));
 
-        // Priority order to process transactions
-        list<COrphan> vOrphan; // list memory doesn't move
-        map<uint256, vector<COrphan*> > mapDependers;
         bool fPrintPriority = GetBoolArg("-printpriority", false);
 
-        // This vector will be sorted into a priority queue:
-        vector<TxPriority> vecPriority;
-        vecPriority.reserve(mempool.mapTx.size() + 1);
-
-        // now add transactions from the mem pool
-        int32_t Notarisations = 0; uint64_t txvalue;
-        for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
-             mi != mempool.mapTx.end(); ++mi)
+        // Collect transactions into block. The mempool keeps a fee-rate
+        // ordered index up to date as transactions enter and leave, so the
+        // miner consumes it directly instead of rebuilding a priority heap
+        // over the whole pool on every template.
+        uint64_t nBlockSize = 1000;
+        uint64_t nBlockTx = 0;
+        int64_t interest;
+        int nBlockSigOps = 100;
+        int32_t Notarisations = 0;
+
+        CAmount opretMinFee = 0;
+        if (mapArgs.count("-opretmintxfee") && !(ParseMoney(mapArgs["-opretmintxfee"], opretMinFee) && opretMinFee > 0))
+            opretMinFee = 400000; // default opretMinFeeRate (1 KMD per 250 Kb = 0.004 per 1 Kb = 400000 sat per 1 Kb)
+        CFeeRate opretMinFeeRate(mapArgs.count("-opretmintxfee") ? opretMinFee : 0);
+
+        std::set<uint256> setAdded;
+        // Transactions whose in-mempool parents have not been added yet wait
+        // here keyed by the missing parent, and re-enter via qCleared once it
+        // lands in the block
+        std::multimap<uint256, const CTxMemPoolEntry*> mapWaiting;
+        std::deque<const CTxMemPoolEntry*> qCleared;
+
+        // Attempt to place one mempool entry into the block; returns true if
+        // it was appended. fFeePhase applies the free-transaction cutoff that
+        // only makes sense once selection is fee-ordered.
+        auto TryAddTransaction = [&](const CTxMemPoolEntry* pentry, bool fFeePhase) -> bool
         {
-            //break; // dont add any tx to block.. debug for KMD fix. Disabled. 
-            const CTransaction& tx = mi->GetTx();
+            const CTransaction& tx = pentry->GetTx();
+            const uint256 hash = tx.GetHash();
+            if (setAdded.count(hash))
+                return false;
 
             int64_t nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
             ? nMedianTimePast
             : pblock->GetBlockTime();
 
             if (tx.IsCoinBase() || !IsFinalTx(tx, nHeight, nLockTimeCutoff) || IsExpiredTx(tx, nHeight))
-            {
-                continue;
-            }
-            txvalue = tx.GetValueOut();
-            if ( KOMODO_VALUETOOBIG(txvalue) != 0 )
-                continue;
+                return false;
+            if ( KOMODO_VALUETOOBIG(tx.GetValueOut()) != 0 )
+                return false;
 
             /* HF22 - check interest validation against pindexPrev->GetMedianTimePast() + 777 */
             uint32_t cmptime = (uint32_t)pblock->nTime;
-
             if (chainName.isKMD() &&
-                consensusParams.nHF22Height != boost::none && nHeight > consensusParams.nHF22Height.get()
-            ) {
+                consensusParams.nHF22Height != boost::none && nHeight > consensusParams.nHF22Height.get())
+            {
                 uint32_t cmptime_old = cmptime;
                 cmptime = nMedianTimePast + 777;
                 LogPrint("hfnet","%s[%d]: cmptime.%lu -> %lu\n", __func__, __LINE__, cmptime_old, cmptime);
-                LogPrint("hfnet","%s[%d]: ht.%ld\n", __func__, __LINE__, nHeight);
             }
-
             if (chainName.isKMD() && !komodo_validate_interest(tx, nHeight, cmptime))
             {
                 LogPrintf("%s: komodo_validate_interest failure txid.%s nHeight.%d nTime.%u vs locktime.%u (cmptime.%lu)\n", __func__, tx.GetHash().ToString(), nHeight, (uint32_t)pblock->nTime, (uint32_t)tx.nLockTime, cmptime);
-                continue;
+                return false;
             }
 
-            COrphan* porphan = NULL;
-            double dPriority = 0;
-            CAmount nTotalIn = 0;
-            bool fMissingInputs = false;
-            bool fNotarisation = false;
-            std::vector<int8_t> TMP_NotarisationNotaries;
-            if (tx.IsCoinImport())
-            {
-                CAmount nValueIn = GetCoinImportValue(tx); // burn amount
-                nTotalIn += nValueIn;
-                dPriority += (double)nValueIn * 1000;  // flat multiplier... max = 1e16.
-            } else {
-                TMP_NotarisationNotaries.clear();
-                bool fToCryptoAddress = false;
-                if ( numSN != 0 && notarypubkeys[0][0] != 0 && komodo_is_notarytx(tx) == 1 )
-                    fToCryptoAddress = true;
-
-                BOOST_FOREACH(const CTxIn& txin, tx.vin)
-                {
-                    // Read prev transaction
-                    if (!view.HaveCoins(txin.prevout.hash))
-                    {
-                        // This should never happen; all transactions in the memory
-                        // pool should connect to either transactions in the chain
-                        // or other transactions in the memory pool.
-                        if (!mempool.mapTx.count(txin.prevout.hash))
-                        {
-                            LogPrintf("ERROR: mempool transaction missing input\n");
-                            // if (fDebug) assert("mempool transaction missing input" == 0);
-                            fMissingInputs = true;
-                            if (porphan)
-                                vOrphan.pop_back();
-                            break;
-                        }
-
-                        // Has to wait for dependencies
-                        if (!porphan)
-                        {
-                            // Use list for automatic deletion
-                            vOrphan.push_back(COrphan(&tx));
-                            porphan = &vOrphan.back();
-                        }
-                        mapDependers[txin.prevout.hash].push_back(porphan);
-                        porphan->setDependsOn.insert(txin.prevout.hash);
-                        nTotalIn += mempool.mapTx.find(txin.prevout.hash)->GetTx().vout[txin.prevout.n].nValue;
-                        continue;
-                    }
-                    const CCoins* coins = view.AccessCoins(txin.prevout.hash);
-                    assert(coins);
-
-                    CAmount nValueIn = coins->vout[txin.prevout.n].nValue;
-                    nTotalIn += nValueIn;
-
-                    int nConf = nHeight - coins->nHeight;
-                    
-                    uint8_t *script; int32_t scriptlen; uint256 hash; CTransaction tx1;
-                    // loop over notaries array and extract index of signers.
-                    if ( fToCryptoAddress && myGetTransaction(txin.prevout.hash,tx1,hash) )
-                    {
-                        for (int8_t i = 0; i < numSN; i++) 
-                        {
-                            script = (uint8_t *)&tx1.vout[txin.prevout.n].scriptPubKey[0];
-                            scriptlen = (int32_t)tx1.vout[txin.prevout.n].scriptPubKey.size();
-                            if ( scriptlen == 35 && script[0] == 33 && script[34] == OP_CHECKSIG && memcmp(script+1,notarypubkeys[i],33) == 0 )
-                            {
-                                // We can add the index of each notary to vector, and clear it if this notarisation is not valid later on.
-                                TMP_NotarisationNotaries.push_back(i);                          
-                            }
-                        }
-                    }
-                    dPriority += (double)nValueIn * nConf;
-                }
-                if ( numSN != 0 && notarypubkeys[0][0] != 0 && TMP_NotarisationNotaries.size() >= numSN / 5 )
-                {
-                    // check a notary didnt sign twice (this would be an invalid notarisation later on and cause problems)
-                    std::set<int> checkdupes( TMP_NotarisationNotaries.begin(), TMP_NotarisationNotaries.end() );
-                    if ( checkdupes.size() != TMP_NotarisationNotaries.size() ) 
-                    {
-                        fprintf(stderr, "possible notarisation is signed multiple times by same notary, passed as normal transaction.\n");
-                    } else fNotarisation = true;
-                }
-                nTotalIn += tx.GetShieldedValueIn();
-            }
-
-            if (fMissingInputs) continue;
-
-            // Priority is sum(valuein * age) / modified_txsize
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-            dPriority = tx.ComputePriority(dPriority, nTxSize);
-
-            uint256 hash = tx.GetHash();
-            mempool.ApplyDeltas(hash, dPriority, nTotalIn);
+            // A notarisation needs to lead its own block; any that was worth
+            // including was already placed by the pre-pass below.
+            if ( Notarisations > 0 && komodo_is_notarytx(tx) == 1 && tx.vout.size() == 2 && tx.vout[1].nValue == 0 &&
+                 tx.vout[1].scriptPubKey.size() > 0 && tx.vout[1].scriptPubKey[0] == OP_RETURN )
+                return false;
 
-            CFeeRate feeRate(nTotalIn-tx.GetValueOut(), nTxSize);
-
-            if ( fNotarisation ) 
-            {
-                // Special miner for notary pay chains. Can only enter this if numSN/notarypubkeys is set higher up.
-                if ( tx.vout.size() == 2 && tx.vout[1].nValue == 0 )
-                {
-                    // Get the OP_RETURN for the notarisation
-                    uint8_t *script = (uint8_t *)&tx.vout[1].scriptPubKey[0];
-                    int32_t scriptlen = (int32_t)tx.vout[1].scriptPubKey.size();
-                    if ( script[0] == OP_RETURN )
-                    {
-                        Notarisations++;
-                        if ( Notarisations > 1 ) 
-                        {
-                            fprintf(stderr, "skipping notarization.%d\n",Notarisations);
-                            // Any attempted notarization needs to be in its own block!
-                            continue;
-                        }
-                        int32_t notarizedheight = komodo_getnotarizedheight(pblock->nTime, nHeight, script, scriptlen);
-                        if ( notarizedheight != 0 )
-                        {
-                            // this is the first one we see, add it to the block as TX1 
-                            NotarisationNotaries = TMP_NotarisationNotaries;
-                            dPriority = 1e16;
-                            fNotarisationBlock = true;
-                            //fprintf(stderr, "Notarisation %s set to maximum priority\n",hash.ToString().c_str());
-                        }
-                    }
-                }
-            }
-            else if ( dPriority == 1e16 )
-            {
-                dPriority -= 10;
-                // make sure notarisation is tx[1] in block. 
-            }
-            if (porphan)
-            {
-                porphan->dPriority = dPriority;
-                porphan->feeRate = feeRate;
-            }
-            else
-                vecPriority.push_back(TxPriority(dPriority, feeRate, &(mi->GetTx())));
-        }
-
-        // Collect transactions into block
-        uint64_t nBlockSize = 1000;
-        uint64_t nBlockTx = 0;
-        int64_t interest;
-        int nBlockSigOps = 100;
-        bool fSortedByFee = (nBlockPrioritySize <= 0);
-
-        TxPriorityCompare comparer(fSortedByFee);
-        std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
-
-        while (!vecPriority.empty())
-        {
-            // Take highest priority transaction off the priority queue:
-            double dPriority = vecPriority.front().get<0>();
-            CFeeRate feeRate = vecPriority.front().get<1>();
-            const CTransaction& tx = *(vecPriority.front().get<2>());
-
-            std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
-            vecPriority.pop_back();
-
-            // Size limits
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+            unsigned int nTxSize = pentry->GetTxSize();
 
             // Opret spam limits
             if (mapArgs.count("-opretmintxfee"))
             {
-                CAmount n = 0;
-                CFeeRate opretMinFeeRate;
-                if (ParseMoney(mapArgs["-opretmintxfee"], n) && n > 0)
-                    opretMinFeeRate = CFeeRate(n);
-                else
-                    opretMinFeeRate = CFeeRate(400000); // default opretMinFeeRate (1 KMD per 250 Kb = 0.004 per 1 Kb = 400000 sat per 1 Kb)
-
-                bool fSpamTx = false;
-                unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
                 unsigned int nTxOpretSize = 0;
 
                 // calc total oprets size
@@ -521,74 +329,59 @@ CBlockTemplate* CreateNewBlock(const CPubKey _pk, const CScript& _scriptPubKeyIn
                         opcodetype op;
                         std::vector<uint8_t> opretData;
                         if (txout.scriptPubKey.GetOp(it, op, opretData)) {
-                            //std::cerr << HexStr(opretData.begin(), opretData.end()) << std::endl;
                             nTxOpretSize += opretData.size();
                         }
                     }
                 }
 
-                if ((nTxOpretSize > 256) && (feeRate < opretMinFeeRate)) fSpamTx = true;
-                // std::cerr << tx.GetHash().ToString() << " nTxSize." << nTxSize << " nTxOpretSize." << nTxOpretSize << " feeRate." << feeRate.ToString() << " opretMinFeeRate." << opretMinFeeRate.ToString() << " fSpamTx." << fSpamTx << std::endl;
-                if (fSpamTx) continue;
-                // std::cerr << tx.GetHash().ToString() << " vecPriority.size() = " << vecPriority.size() << std::endl;
+                if ((nTxOpretSize > 256) && (pentry->GetFeeRate() < opretMinFeeRate))
+                    return false;
             }
 
             if (nBlockSize + nTxSize >= nBlockMaxSize-512) // room for extra autotx
-            {
-                //fprintf(stderr,"nBlockSize %d + %d nTxSize >= %d nBlockMaxSize\n",(int32_t)nBlockSize,(int32_t)nTxSize,(int32_t)nBlockMaxSize);
-                continue;
-            }
+                return false;
 
             // Legacy limits on sigOps:
             unsigned int nTxSigOps = GetLegacySigOpCount(tx);
             if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS-1)
+                return false;
+
+            if (!view.HaveInputs(tx))
             {
-                //fprintf(stderr,"A nBlockSigOps %d + %d nTxSigOps >= %d MAX_BLOCK_SIGOPS-1\n",(int32_t)nBlockSigOps,(int32_t)nTxSigOps,(int32_t)MAX_BLOCK_SIGOPS);
-                continue;
+                // If an input is an in-mempool transaction that simply has not
+                // been added yet, park this entry until the parent lands
+                BOOST_FOREACH(const CTxIn& txin, tx.vin)
+                {
+                    if (!view.HaveCoins(txin.prevout.hash) && mempool.mapTx.count(txin.prevout.hash) != 0 &&
+                        setAdded.count(txin.prevout.hash) == 0)
+                    {
+                        mapWaiting.insert(std::make_pair(txin.prevout.hash, pentry));
+                        return false;
+                    }
+                }
+                LogPrint("mining", "%s: mempool transaction %s missing inputs\n", __func__, hash.ToString());
+                return false;
             }
+            CAmount nTxFees = view.GetValueIn(chainActive.Tip()->nHeight,interest,tx)-tx.GetValueOut();
+
             // Skip free transactions if we're past the minimum block size:
-            const uint256& hash = tx.GetHash();
             double dPriorityDelta = 0;
             CAmount nFeeDelta = 0;
             mempool.ApplyDeltas(hash, dPriorityDelta, nFeeDelta);
-            if (fSortedByFee && (dPriorityDelta <= 0) && (nFeeDelta <= 0) && (feeRate < ::minRelayTxFee) && (nBlockSize + nTxSize >= nBlockMinSize))
-            {
-                //fprintf(stderr,"fee rate skip\n");
-                continue;
-            }
-            // Prioritise by fee once past the priority size or we run out of high-priority
-            // transactions:
-            if (!fSortedByFee &&
-                ((nBlockSize + nTxSize >= nBlockPrioritySize) || !AllowFree(dPriority)))
-            {
-                fSortedByFee = true;
-                comparer = TxPriorityCompare(fSortedByFee);
-                std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
-            }
-
-            if (!view.HaveInputs(tx))
-            {
-                //fprintf(stderr,"dont have inputs\n");
-                continue;
-            }
-            CAmount nTxFees = view.GetValueIn(chainActive.Tip()->nHeight,interest,tx)-tx.GetValueOut();
+            if (fFeePhase && (dPriorityDelta <= 0) && (nFeeDelta <= 0) && (pentry->GetFeeRate() < ::minRelayTxFee) && (nBlockSize + nTxSize >= nBlockMinSize))
+                return false;
 
             nTxSigOps += GetP2SHSigOpCount(tx, view);
             if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS-1)
-            {
-                //fprintf(stderr,"B nBlockSigOps %d + %d nTxSigOps >= %d MAX_BLOCK_SIGOPS-1\n",(int32_t)nBlockSigOps,(int32_t)nTxSigOps,(int32_t)MAX_BLOCK_SIGOPS);
-                continue;
-            }
+                return false;
+
             // Note that flags: we don't want to set mempool/IsStandard()
             // policy here, but we still have to ensure that the block we
             // create only contains transactions that are valid in new blocks.
             CValidationState state;
             PrecomputedTransactionData txdata(tx);
             if (!ContextualCheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId))
-            {
-                //fprintf(stderr,"context failure\n");
-                continue;
-            }
+                return false;
             UpdateCoins(tx, view, nHeight);
 
             BOOST_FOREACH(const OutputDescription &outDescription, tx.vShieldedOutput) {
@@ -603,28 +396,115 @@ CBlockTemplate* CreateNewBlock(const CPubKey _pk, const CScript& _scriptPubKeyIn
             ++nBlockTx;
             nBlockSigOps += nTxSigOps;
             nFees += nTxFees;
+            setAdded.insert(hash);
 
             if (fPrintPriority)
             {
-                LogPrintf("priority %.1f fee %s txid %s\n",dPriority, feeRate.ToString(), tx.GetHash().ToString());
+                LogPrintf("feerate %s txid %s\n", pentry->GetFeeRate().ToString(), hash.ToString());
             }
 
-            // Add transactions that depend on this one to the priority queue
-            if (mapDependers.count(hash))
+            // Release anything that was waiting on this transaction
+            std::pair<std::multimap<uint256, const CTxMemPoolEntry*>::iterator,
+                      std::multimap<uint256, const CTxMemPoolEntry*>::iterator> range = mapWaiting.equal_range(hash);
+            for (std::multimap<uint256, const CTxMemPoolEntry*>::iterator wi = range.first; wi != range.second; ++wi)
+                qCleared.push_back(wi->second);
+            mapWaiting.erase(range.first, range.second);
+            return true;
+        };
+
+        // On notary pay chains the notarisation has to be tx[1] and shapes
+        // the coinbase, so it is placed before any fee-ordered selection.
+        // This is also the only path that still inspects input transactions.
+        if ( numSN != 0 && notarypubkeys[0][0] != 0 )
+        {
+            for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
+                 mi != mempool.mapTx.end(); ++mi)
             {
-                BOOST_FOREACH(COrphan* porphan, mapDependers[hash])
+                const CTransaction& tx = mi->GetTx();
+                if ( komodo_is_notarytx(tx) != 1 || tx.vout.size() != 2 || tx.vout[1].nValue != 0 )
+                    continue;
+                uint8_t *script = (uint8_t *)&tx.vout[1].scriptPubKey[0];
+                int32_t scriptlen = (int32_t)tx.vout[1].scriptPubKey.size();
+                if ( scriptlen == 0 || script[0] != OP_RETURN )
+                    continue;
+                if ( komodo_getnotarizedheight(pblock->nTime, nHeight, script, scriptlen) == 0 )
+                    continue;
+
+                // loop over notaries array and extract index of signers.
+                std::vector<int8_t> TMP_NotarisationNotaries;
+                BOOST_FOREACH(const CTxIn& txin, tx.vin)
                 {
-                    if (!porphan->setDependsOn.empty())
+                    uint256 hashTx; CTransaction tx1;
+                    if ( myGetTransaction(txin.prevout.hash,tx1,hashTx) && txin.prevout.n < tx1.vout.size() )
                     {
-                        porphan->setDependsOn.erase(hash);
-                        if (porphan->setDependsOn.empty())
+                        for (int8_t i = 0; i < numSN; i++)
                         {
-                            vecPriority.push_back(TxPriority(porphan->dPriority, porphan->feeRate, porphan->ptx));
-                            std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
+                            uint8_t *spk = (uint8_t *)&tx1.vout[txin.prevout.n].scriptPubKey[0];
+                            int32_t spklen = (int32_t)tx1.vout[txin.prevout.n].scriptPubKey.size();
+                            if ( spklen == 35 && spk[0] == 33 && spk[34] == OP_CHECKSIG && memcmp(spk+1,notarypubkeys[i],33) == 0 )
+                                TMP_NotarisationNotaries.push_back(i);
                         }
                     }
                 }
+                if ( TMP_NotarisationNotaries.size() < numSN / 5 )
+                    continue;
+                // check a notary didnt sign twice (this would be an invalid notarisation later on and cause problems)
+                std::set<int> checkdupes( TMP_NotarisationNotaries.begin(), TMP_NotarisationNotaries.end() );
+                if ( checkdupes.size() != TMP_NotarisationNotaries.size() )
+                {
+                    fprintf(stderr, "possible notarisation is signed multiple times by same notary, passed as normal transaction.\n");
+                    continue;
+                }
+                if ( TryAddTransaction(&*mi, false) )
+                {
+                    NotarisationNotaries = TMP_NotarisationNotaries;
+                    fNotarisationBlock = true;
+                    Notarisations = 1;
+                    break;
+                }
+            }
+        }
+
+        // How much of the block should be dedicated to high-priority
+        // transactions. Entry priority is cached in the pool and aged by
+        // height, so no coin lookups are needed here.
+        if ( nBlockPrioritySize > 0 )
+        {
+            std::vector<std::pair<double, const CTxMemPoolEntry*> > vecPriority;
+            for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
+                 mi != mempool.mapTx.end(); ++mi)
+            {
+                double dPriority = mi->GetPriority(nHeight);
+                CAmount nFeeDelta = 0;
+                mempool.ApplyDeltas(mi->GetTx().GetHash(), dPriority, nFeeDelta);
+                if (AllowFree(dPriority))
+                    vecPriority.push_back(std::make_pair(dPriority, &*mi));
+            }
+            std::sort(vecPriority.begin(), vecPriority.end(),
+                      [](const std::pair<double, const CTxMemPoolEntry*>& a, const std::pair<double, const CTxMemPoolEntry*>& b) {
+                          return a.first > b.first;
+                      });
+            for (size_t i = 0; i < vecPriority.size() && nBlockSize < nBlockPrioritySize; i++)
+                TryAddTransaction(vecPriority[i].second, false);
+        }
+
+        // Main selection: walk the persistent fee-rate index, interleaving
+        // any children freed up by their parents landing in the block
+        CTxMemPool::indexed_transaction_set::nth_index<1>::type::iterator fi = mempool.mapTx.get<1>().begin();
+        while (fi != mempool.mapTx.get<1>().end() || !qCleared.empty())
+        {
+            const CTxMemPoolEntry* pentry;
+            if (!qCleared.empty())
+            {
+                pentry = qCleared.front();
+                qCleared.pop_front();
+            }
+            else
+            {
+                pentry = &*fi;
+                ++fi;
             }
+            TryAddTransaction(pentry, true);
         }
 
         nLastBlockTx = nBlockTx;
@@ -892,6 +772,156 @@ CBlockTemplate* CreateNewBlock(const CPubKey _pk, const CScript& _scriptPubKeyIn
     return pblocktemplate.release();
 }
 
+/*****
+ * @brief Refresh a cached block template in place after mempool-only changes
+ *
+ * Appends newly arrived mempool transactions to a template that was built on
+ * the current tip, re-checking inputs only for the new transactions instead of
+ * re-sorting the whole mempool the way CreateNewBlock does. The coinbase keeps
+ * the fee total it was built with, so fees of appended transactions go
+ * unclaimed until the next full rebuild; that is harmless for consensus and
+ * bounded by how often the caller forces a rebuild.
+ *
+ * @param pblocktemplate the cached template; modified in place
+ * @param pindexPrev the tip the template was built on
+ * @returns false if only a full CreateNewBlock rebuild can produce a correct
+ *          template (tip moved, a template tx left the mempool, or a new
+ *          notarisation arrived that has to lead the block)
+ */
+bool UpdateBlockTemplate(CBlockTemplate* pblocktemplate, CBlockIndex* pindexPrev)
+{
+    AssertLockHeld(cs_main);
+    LOCK(mempool.cs);
+
+    if (chainActive.Tip() != pindexPrev)
+        return false;
+
+    CBlock *pblock = &pblocktemplate->block;
+    const Consensus::Params &consensusParams = Params().GetConsensus();
+    const int nHeight = pindexPrev->nHeight + 1;
+    uint32_t consensusBranchId = CurrentEpochBranchId(nHeight, consensusParams);
+    const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
+
+    unsigned int nBlockMaxSize = GetArg("-blockmaxsize", MAX_BLOCK_SIZE(nHeight));
+    nBlockMaxSize = std::max((unsigned int)1000, std::min((unsigned int)(MAX_BLOCK_SIZE(nHeight)-1000), nBlockMaxSize));
+
+    // Anything that left the mempool without a tip change (a conflict, or a
+    // manual removal) invalidates the fee accounting in ways an append-only
+    // update can't express; hand those cases back to CreateNewBlock.
+    std::set<uint256> setInBlock;
+    uint64_t nBlockSize = 1000;
+    int nBlockSigOps = 100;
+    for (size_t i = 1; i < pblock->vtx.size(); i++)
+    {
+        const uint256 &hash = pblock->vtx[i].GetHash();
+        if (!mempool.exists(hash))
+            return false;
+        setInBlock.insert(hash);
+        nBlockSize += ::GetSerializeSize(pblock->vtx[i], SER_NETWORK, PROTOCOL_VERSION);
+        nBlockSigOps += pblocktemplate->vTxSigOps[i];
+    }
+
+    // Replay the template's transactions on a fresh view so appended
+    // transactions may spend outputs of transactions already in the block
+    CCoinsViewCache view(pcoinsTip);
+    for (size_t i = 1; i < pblock->vtx.size(); i++)
+        UpdateCoins(pblock->vtx[i], view, nHeight);
+
+    int8_t numSN = 0; uint8_t notarypubkeys[64][33] = {0};
+    if ( ASSETCHAINS_NOTARY_PAY[0] != 0 )
+        numSN = komodo_notaries(notarypubkeys, nHeight, pblock->nTime);
+
+    int64_t interest;
+    unsigned int nAdded = 0;
+    bool fProgress = true;
+    while (fProgress)
+    {
+        fProgress = false;
+        for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
+             mi != mempool.mapTx.end(); ++mi)
+        {
+            const CTransaction& tx = mi->GetTx();
+            const uint256 &hash = tx.GetHash();
+            if (setInBlock.count(hash))
+                continue;
+
+            int64_t nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+            ? nMedianTimePast
+            : pblock->GetBlockTime();
+            if (tx.IsCoinBase() || !IsFinalTx(tx, nHeight, nLockTimeCutoff) || IsExpiredTx(tx, nHeight))
+                continue;
+            if ( KOMODO_VALUETOOBIG(tx.GetValueOut()) != 0 )
+                continue;
+
+            // A fresh notarisation has to be tx[1] and reshapes the coinbase;
+            // only a full rebuild can place it correctly.
+            if ( numSN != 0 && notarypubkeys[0][0] != 0 && komodo_is_notarytx(tx) == 1 )
+                return false;
+
+            // Shielded outputs would move hashFinalSaplingRoot, which was
+            // fixed when the header was built; leave those for the rebuild.
+            if (!tx.vShieldedOutput.empty())
+                continue;
+
+            /* HF22 - check interest validation against pindexPrev->GetMedianTimePast() + 777 */
+            uint32_t cmptime = (uint32_t)pblock->nTime;
+            if (chainName.isKMD() &&
+                consensusParams.nHF22Height != boost::none && nHeight > consensusParams.nHF22Height.get())
+            {
+                cmptime = nMedianTimePast + 777;
+            }
+            if (chainName.isKMD() && !komodo_validate_interest(tx, nHeight, cmptime))
+                continue;
+
+            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+            if (nBlockSize + nTxSize >= nBlockMaxSize-512) // room for extra autotx
+                continue;
+
+            unsigned int nTxSigOps = GetLegacySigOpCount(tx);
+            if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS-1)
+                continue;
+
+            // An unavailable input may be a parent appended on a later pass
+            if (!view.HaveInputs(tx))
+                continue;
+            CAmount nTxFees = view.GetValueIn(pindexPrev->nHeight,interest,tx)-tx.GetValueOut();
+
+            double dPriorityDelta = 0;
+            CAmount nFeeDelta = 0;
+            mempool.ApplyDeltas(hash, dPriorityDelta, nFeeDelta);
+            if (dPriorityDelta <= 0 && nFeeDelta <= 0 && CFeeRate(nTxFees, nTxSize) < ::minRelayTxFee)
+                continue;
+
+            nTxSigOps += GetP2SHSigOpCount(tx, view);
+            if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS-1)
+                continue;
+
+            CValidationState state;
+            PrecomputedTransactionData txdata(tx);
+            if (!ContextualCheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, txdata, consensusParams, consensusBranchId))
+                continue;
+            UpdateCoins(tx, view, nHeight);
+
+            pblock->vtx.push_back(tx);
+            pblocktemplate->vTxFees.push_back(nTxFees);
+            pblocktemplate->vTxSigOps.push_back(nTxSigOps);
+            nBlockSize += nTxSize;
+            nBlockSigOps += nTxSigOps;
+            setInBlock.insert(hash);
+            nAdded++;
+            fProgress = true;
+        }
+    }
+
+    if (nAdded > 0)
+    {
+        nLastBlockTx = pblock->vtx.size() - 1;
+        nLastBlockSize = nBlockSize;
+        LogPrint("mining", "UpdateBlockTemplate: appended %u mempool transactions\n", nAdded);
+    }
+    return true;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // Internal miner
@@ -915,7 +945,7 @@ void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int&
     assert(txCoinbase.vin[0].scriptSig.size() <= 100);
 
     pblock->vtx[0] = txCoinbase;
-    pblock->hashMerkleRoot = pblock->BuildMerkleTree();
+    pblock->hashMerkleRoot = pblock->UpdateCoinbaseMerkleRoot();
 }
 
 #ifdef ENABLE_WALLET
@@ -978,24 +1008,83 @@ CBlockTemplate* CreateNewBlockWithKey(CReserveKey& reservekey, int32_t nHeight,
     return CreateNewBlock(pubkey, scriptPubKey, gpucount, isStake);
 }
 
-void komodo_sendmessage(int32_t minpeers,int32_t maxpeers,const char *message,std::vector<uint8_t> payload)
+// komodo_sendmessage used to lock cs_vNodes and push to peers inline from
+// the calling context; game CCs broadcast bursts of moves this way and every
+// send stalled the caller on the network lock. Sends are now queued and a
+// background thread drains the queue on a 100ms flush interval, taking
+// cs_vNodes once per batch and dropping payloads already queued in the same
+// window so a burst of identical relays costs one send.
+struct komodo_queuedmessage
+{
+    int32_t minpeers,maxpeers;
+    std::string message;
+    std::vector<uint8_t> payload;
+};
+static CCriticalSection cs_sendmessagequeue;
+static std::deque<komodo_queuedmessage> sendmessagequeue;
+static std::set<uint256> sendmessagequeuehashes; // payloads queued but not yet flushed
+
+static void komodo_sendmessage_flush(std::deque<komodo_queuedmessage> &batch)
 {
-    int32_t numsent = 0;
     LOCK(cs_vNodes);
-    BOOST_FOREACH(CNode* pnode, vNodes)
+    for (const komodo_queuedmessage &qm : batch)
+    {
+        int32_t numsent = 0;
+        BOOST_FOREACH(CNode* pnode, vNodes)
+        {
+            if ( pnode->hSocket == INVALID_SOCKET )
+                continue;
+            if ( numsent < qm.minpeers || (rand() % 10) == 0 )
+            {
+                //fprintf(stderr,"pushmessage\n");
+                pnode->PushMessage(qm.message.c_str(),qm.payload);
+                if ( numsent++ > qm.maxpeers )
+                    break;
+            }
+        }
+    }
+}
+
+static void komodo_sendmessage_thread()
+{
+    RenameThread("komodo-sendmsg");
+    while ( !ShutdownRequested() )
     {
-        if ( pnode->hSocket == INVALID_SOCKET )
-            continue;
-        if ( numsent < minpeers || (rand() % 10) == 0 )
+        MilliSleep(100);
+        std::deque<komodo_queuedmessage> batch;
         {
-            //fprintf(stderr,"pushmessage\n");
-            pnode->PushMessage(message,payload);
-            if ( numsent++ > maxpeers )
-                break;
+            LOCK(cs_sendmessagequeue);
+            if ( sendmessagequeue.empty() )
+                continue;
+            batch.swap(sendmessagequeue);
+            sendmessagequeuehashes.clear();
         }
+        komodo_sendmessage_flush(batch);
     }
 }
 
+void komodo_sendmessage(int32_t minpeers,int32_t maxpeers,const char *message,std::vector<uint8_t> payload)
+{
+    static std::atomic<int32_t> fThreadStarted(0);
+    komodo_queuedmessage qm;
+    qm.minpeers = minpeers;
+    qm.maxpeers = maxpeers;
+    qm.message = message;
+    qm.payload = payload;
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << qm.message << qm.payload;
+    uint256 hash = ss.GetHash();
+    {
+        LOCK(cs_sendmessagequeue);
+        if ( sendmessagequeuehashes.count(hash) != 0 )
+            return; // identical payload already waiting in this flush window
+        sendmessagequeuehashes.insert(hash);
+        sendmessagequeue.push_back(qm);
+    }
+    if ( fThreadStarted.exchange(1) == 0 )
+        std::thread(komodo_sendmessage_thread).detach();
+}
+
 void komodo_broadcast(CBlock *pblock,int32_t limit)
 {
     if (IsInitialBlockDownload())
@@ -1157,6 +1246,51 @@ bool check_tromp_solution(equi &eq, std::function<bool(std::vector<unsigned char
     return false;
 }
 
+//! Shared block template state. All -genproclimit solver threads mine the
+//! same template over disjoint nonce ranges instead of each rebuilding its
+//! own template under cs_main, which is what capped throughput around a
+//! dozen threads. Staking templates embed a per-thread stake and still go
+//! through CreateNewBlockWithKey directly.
+static CCriticalSection cs_minerTemplate;
+static std::unique_ptr<CBlockTemplate> minerTemplate;
+static uint256 minerTemplatePrevHash;
+static unsigned int minerTemplateTxUpdated;
+static int64_t minerTemplateTime;
+//! Hands each miner thread the index used to carve up the nonce space
+static std::atomic<int> nMinerThreadIndex(0);
+
+#ifdef ENABLE_WALLET
+static CBlockTemplate* GetSharedBlockTemplate(CReserveKey& reservekey, int32_t nHeight, int32_t gpucount, bool isStake,
+                                              const uint256& hashPrevTip, unsigned int nTransactionsUpdatedLast)
+#else
+static CBlockTemplate* GetSharedBlockTemplate(const uint256& hashPrevTip, unsigned int nTransactionsUpdatedLast)
+#endif
+{
+#ifdef ENABLE_WALLET
+    if (isStake)
+        return CreateNewBlockWithKey(reservekey, nHeight, gpucount, true);
+#endif
+    {
+        LOCK(cs_minerTemplate);
+        if (minerTemplate.get() != NULL && minerTemplatePrevHash == hashPrevTip &&
+            minerTemplateTxUpdated == nTransactionsUpdatedLast && GetTime() - minerTemplateTime < 60)
+            return new CBlockTemplate(*minerTemplate);
+    }
+#ifdef ENABLE_WALLET
+    CBlockTemplate* ptr = CreateNewBlockWithKey(reservekey, nHeight, gpucount, false);
+#else
+    CBlockTemplate* ptr = CreateNewBlockWithKey();
+#endif
+    if (ptr != NULL) {
+        LOCK(cs_minerTemplate);
+        minerTemplate.reset(new CBlockTemplate(*ptr));
+        minerTemplatePrevHash = hashPrevTip;
+        minerTemplateTxUpdated = nTransactionsUpdatedLast;
+        minerTemplateTime = GetTime();
+    }
+    return ptr;
+}
+
 #ifdef ENABLE_WALLET
 void static BitcoinMiner(CWallet *pwallet)
 #else
@@ -1166,6 +1300,7 @@ void static BitcoinMiner()
     LogPrintf("KomodoMiner started\n");
     SetThreadPriority(THREAD_PRIORITY_LOWEST);
     RenameThread("komodo-miner");
+    const int nMinerIndex = nMinerThreadIndex.fetch_add(1) & 0xffff;
     const CChainParams& chainparams = Params();
 
 #ifdef ENABLE_WALLET
@@ -1259,9 +1394,11 @@ void static BitcoinMiner()
 
 #ifdef ENABLE_WALLET
             // notaries always default to staking
-            CBlockTemplate *ptr = CreateNewBlockWithKey(reservekey, pindexPrev->nHeight+1, gpucount, ASSETCHAINS_STAKED != 0 && KOMODO_MININGTHREADS == 0);
+            CBlockTemplate *ptr = GetSharedBlockTemplate(reservekey, pindexPrev->nHeight+1, gpucount,
+                                                         ASSETCHAINS_STAKED != 0 && KOMODO_MININGTHREADS == 0,
+                                                         pindexPrev->GetBlockHash(), nTransactionsUpdatedLast);
 #else
-            CBlockTemplate *ptr = CreateNewBlockWithKey();
+            CBlockTemplate *ptr = GetSharedBlockTemplate(pindexPrev->GetBlockHash(), nTransactionsUpdatedLast);
 #endif
             if ( ptr == 0 )
             {
@@ -1311,6 +1448,14 @@ void static BitcoinMiner()
             if ( (chainName.isKMD() && notaryid >= 0 && Mining_height > nDecemberHardforkHeight ) || (ASSETCHAINS_STAKED != 0 && komodo_newStakerActive(Mining_height, pblock->nTime) != 0) ) //December 2019 hardfork
                 nExtraNonce = 0;
             IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
+            // Each thread searches its own slice of the nonce space: the top
+            // 16 bits were cleared when the template's nonce was randomised,
+            // so stamping the thread index there keeps the ranges disjoint.
+            {
+                arith_uint256 nonce = UintToArith256(pblock->nNonce);
+                nonce |= arith_uint256(nMinerIndex) << 240;
+                pblock->nNonce = ArithToUint256(nonce);
+            }
             //fprintf(stderr,"Running KomodoMiner.%s with %u transactions in block\n",solver.c_str(),(int32_t)pblock->vtx.size());
             LogPrintf("Running KomodoMiner.%s with %u transactions in block (%u bytes)\n",solver.c_str(),pblock->vtx.size(),::GetSerializeSize(*pblock,SER_NETWORK,PROTOCOL_VERSION));
             //
@@ -1697,6 +1842,9 @@ void static BitcoinMiner()
 
         minerThreads = new boost::thread_group();
 
+        // restart the nonce-range assignment for the new thread set
+        nMinerThreadIndex = 0;
+
         for (int i = 0; i < nThreads; i++) {
 
 #ifdef ENABLE_WALLET
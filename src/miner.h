@@ -62,6 +62,14 @@ boost::optional<CScript> GetMinerScriptPubKey();
 CBlockTemplate* CreateNewBlockWithKey();
 #endif
 
+/*****
+ * @brief Append newly arrived mempool transactions to a cached template
+ * @param pblocktemplate the cached template; modified in place
+ * @param pindexPrev the tip the template was built on
+ * @returns false if the template can only be fixed by a full CreateNewBlock rebuild
+ */
+bool UpdateBlockTemplate(CBlockTemplate* pblocktemplate, CBlockIndex* pindexPrev);
+
 #ifdef ENABLE_MINING
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
@@ -40,14 +40,28 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
 #endif
 
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 
+#include <atomic>
+#include <memory>
+
 // Dump addresses to peers.dat every 15 minutes (900s)
 #define DUMP_ADDRESSES_INTERVAL 900
 
+// Dump the ban list to banlist.dat every 15 minutes (900s)
+#define DUMP_BANS_INTERVAL (60 * 15)
+
+// Every how many journaled dumps peers.dat is fully rewritten and the journal folded in
+#define DUMP_ADDRESSES_COMPACT_EVERY 24
+
 #if !defined(HAVE_MSG_NOSIGNAL) && !defined(MSG_NOSIGNAL)
 #define MSG_NOSIGNAL 0
 #endif
@@ -93,10 +107,14 @@ std::string strSubVersion;
 
 vector<CNode*> vNodes;
 CCriticalSection cs_vNodes;
-map<CInv, CDataStream> mapRelay;
-deque<pair<int64_t, CInv> > vRelayExpiration;
+openmap<CInv, std::shared_ptr<const CSerializeData>, CInvMapHasher> mapRelay(RELAY_MAP_CAPACITY);
+/** Fixed ring of (expiry, inv), same capacity as mapRelay so it never grows;
+ *  entries between nRelayExpFront and nRelayExpFront+nRelayExpCount are live */
+static std::vector<std::pair<int64_t, CInv> > vRelayExpiration(RELAY_MAP_CAPACITY);
+static size_t nRelayExpFront = 0;
+static size_t nRelayExpCount = 0;
 CCriticalSection cs_mapRelay;
-limitedmap<CInv, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
+openmap<CInv, int64_t, CInvMapHasher> mapAlreadyAskedFor(MAX_INV_SZ);
 
 static deque<string> vOneShots;
 static CCriticalSection cs_vOneShots;
@@ -117,6 +135,10 @@ static boost::condition_variable messageHandlerCondition;
 static CNodeSignals g_signals;
 CNodeSignals& GetNodeSignals() { return g_signals; }
 
+#ifdef HAVE_SYS_EPOLL_H
+static void EpollUnregister(SOCKET hSocket);
+#endif
+
 void AddOneShot(const std::string& strDest)
 {
     LOCK(cs_vOneShots);
@@ -393,6 +415,7 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest)
     // Connect
     SOCKET hSocket;
     bool proxyConnectionFailed = false;
+    int64_t nConnectStart = GetTimeMillis();
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
@@ -403,6 +426,9 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest)
         }
 
         addrman.Attempt(addrConnect);
+        // remember how long this peer took to accept, so future selection can
+        // favor fast peers right after a restart
+        addrman.Latency(addrConnect, GetTimeMillis() - nConnectStart);
 
         // Add node
         CNode* pnode = new CNode(hSocket, addrConnect, pszDest ? pszDest : "", false);
@@ -431,6 +457,9 @@ void CNode::CloseSocketDisconnect()
     if (hSocket != INVALID_SOCKET)
     {
         LogPrint("net", "disconnecting peer=%d\n", id);
+#ifdef HAVE_SYS_EPOLL_H
+        EpollUnregister(hSocket);
+#endif
         CloseSocket(hSocket);
     }
 
@@ -468,11 +497,15 @@ void CNode::PushVersion()
 
 std::map<CSubNet, int64_t> CNode::setBanned;
 CCriticalSection CNode::cs_setBanned;
+int CNode::nRangedBans = 0;
+bool CNode::setBannedIsDirty = false;
 
 void CNode::ClearBanned()
 {
     LOCK(cs_setBanned);
     setBanned.clear();
+    nRangedBans = 0;
+    setBannedIsDirty = true;
 }
 
 bool CNode::IsBanned(CNetAddr ip)
@@ -480,13 +513,22 @@ bool CNode::IsBanned(CNetAddr ip)
     bool fResult = false;
     {
         LOCK(cs_setBanned);
-        for (std::map<CSubNet, int64_t>::iterator it = setBanned.begin(); it != setBanned.end(); it++)
+        // Single-host bans (the common case, from automatic misbehavior
+        // banning) resolve with one map lookup; the linear range scan only
+        // runs when someone actually banned a subnet.
+        std::map<CSubNet, int64_t>::iterator it = setBanned.find(CSubNet(ip));
+        if (it != setBanned.end() && GetTime() < (*it).second)
+            fResult = true;
+        if (!fResult && nRangedBans > 0)
         {
-            CSubNet subNet = (*it).first;
-            int64_t t = (*it).second;
+            for (it = setBanned.begin(); it != setBanned.end(); it++)
+            {
+                CSubNet subNet = (*it).first;
+                int64_t t = (*it).second;
 
-            if(subNet.Match(ip) && GetTime() < t)
-                fResult = true;
+                if(subNet.Match(ip) && GetTime() < t)
+                    fResult = true;
+            }
         }
     }
     return fResult;
@@ -509,8 +551,7 @@ bool CNode::IsBanned(CSubNet subnet)
 }
 
 void CNode::Ban(const CNetAddr& addr, int64_t bantimeoffset, bool sinceUnixEpoch) {
-    CSubNet subNet(addr.ToString()+(addr.IsIPv4() ? "/32" : "/128"));
-    Ban(subNet, bantimeoffset, sinceUnixEpoch);
+    Ban(CSubNet(addr), bantimeoffset, sinceUnixEpoch);
 }
 
 void CNode::Ban(const CSubNet& subNet, int64_t bantimeoffset, bool sinceUnixEpoch) {
@@ -519,19 +560,34 @@ void CNode::Ban(const CSubNet& subNet, int64_t bantimeoffset, bool sinceUnixEpoc
         banTime = (sinceUnixEpoch ? 0 : GetTime() )+bantimeoffset;
 
     LOCK(cs_setBanned);
-    if (setBanned[subNet] < banTime)
+    std::map<CSubNet, int64_t>::iterator it = setBanned.find(subNet);
+    if (it == setBanned.end())
+    {
         setBanned[subNet] = banTime;
+        if (!subNet.IsSingleIP())
+            nRangedBans++;
+        setBannedIsDirty = true;
+    }
+    else if ((*it).second < banTime)
+    {
+        (*it).second = banTime;
+        setBannedIsDirty = true;
+    }
 }
 
 bool CNode::Unban(const CNetAddr &addr) {
-    CSubNet subNet(addr.ToString()+(addr.IsIPv4() ? "/32" : "/128"));
-    return Unban(subNet);
+    return Unban(CSubNet(addr));
 }
 
 bool CNode::Unban(const CSubNet &subNet) {
     LOCK(cs_setBanned);
     if (setBanned.erase(subNet))
+    {
+        if (!subNet.IsSingleIP())
+            nRangedBans--;
+        setBannedIsDirty = true;
         return true;
+    }
     return false;
 }
 
@@ -541,6 +597,49 @@ void CNode::GetBanned(std::map<CSubNet, int64_t> &banMap)
     banMap = setBanned; //create a thread safe copy
 }
 
+void CNode::SetBanned(const std::map<CSubNet, int64_t> &banMap)
+{
+    LOCK(cs_setBanned);
+    setBanned = banMap;
+    nRangedBans = 0;
+    for (std::map<CSubNet, int64_t>::iterator it = setBanned.begin(); it != setBanned.end(); it++)
+        if (!(*it).first.IsSingleIP())
+            nRangedBans++;
+    setBannedIsDirty = false;
+}
+
+void CNode::SweepBanned()
+{
+    int64_t now = GetTime();
+
+    LOCK(cs_setBanned);
+    std::map<CSubNet, int64_t>::iterator it = setBanned.begin();
+    while (it != setBanned.end())
+    {
+        if ((*it).second < now)
+        {
+            if (!(*it).first.IsSingleIP())
+                nRangedBans--;
+            setBanned.erase(it++);
+            setBannedIsDirty = true;
+        }
+        else
+            ++it;
+    }
+}
+
+bool CNode::BannedSetIsDirty()
+{
+    LOCK(cs_setBanned);
+    return setBannedIsDirty;
+}
+
+void CNode::SetBannedSetDirty(bool dirty)
+{
+    LOCK(cs_setBanned);
+    setBannedIsDirty = dirty;
+}
+
 
 std::vector<CSubNet> CNode::vWhitelistedRange;
 CCriticalSection CNode::cs_vWhitelistedRange;
@@ -576,6 +675,8 @@ void CNode::copyStats(CNodeStats &stats, const std::vector<bool> &m_asmap)
     stats.fInbound = fInbound;
     stats.nStartingHeight = nStartingHeight;
     stats.nSendBytes = nSendBytes;
+    for (int i = 0; i < NUM_TRAFFIC_CLASSES; i++)
+        stats.nSendBytesPerClass[i] = nSendBytesPerClass[i];
     stats.nRecvBytes = nRecvBytes;
     stats.fWhitelisted = fWhitelisted;
 
@@ -633,13 +734,93 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
 
         if (msg.complete()) {
             msg.nTime = GetTimeMicros();
-            messageHandlerCondition.notify_one();
+            messageHandlerCondition.notify_all();
         }
     }
 
     return true;
 }
 
+CBufferPool bufferPool;
+
+size_t CBufferPool::SizeClass(size_t nBytes)
+{
+    if (nBytes <= 4 * 1024) return 0;
+    if (nBytes <= 64 * 1024) return 1;
+    if (nBytes <= 1024 * 1024) return 2;
+    if (nBytes <= 4 * 1024 * 1024) return 3;
+    return nClasses;
+}
+
+size_t CBufferPool::ClassCapacity(size_t nClass)
+{
+    static const size_t nCapacities[nClasses] = {4 * 1024, 64 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+    return nCapacities[nClass];
+}
+
+CSerializeData* CBufferPool::Acquire(size_t nSizeHint)
+{
+    size_t nClass = SizeClass(nSizeHint);
+    if (nClass < nClasses) {
+        LOCK(cs_pool);
+        if (!vFree[nClass].empty()) {
+            CSerializeData* pbuf = vFree[nClass].back();
+            vFree[nClass].pop_back();
+            nPooledBytes -= pbuf->capacity();
+            return pbuf;
+        }
+    }
+    CSerializeData* pbuf = new CSerializeData();
+    pbuf->reserve(nClass < nClasses ? ClassCapacity(nClass) : nSizeHint);
+    return pbuf;
+}
+
+void CBufferPool::Release(CSerializeData* pbuf)
+{
+    if (pbuf == NULL)
+        return;
+    pbuf->clear();
+    size_t nClass = SizeClass(pbuf->capacity());
+    // Only cache buffers whose capacity still matches a class exactly;
+    // anything that was grown past its class (or shrunk) is freed, so
+    // recycling cannot accumulate odd-sized buffers.
+    if (nClass < nClasses && pbuf->capacity() == ClassCapacity(nClass)) {
+        LOCK(cs_pool);
+        if (nPooledBytes + pbuf->capacity() <= MAX_POOLED_BYTES) {
+            vFree[nClass].push_back(pbuf);
+            nPooledBytes += pbuf->capacity();
+            return;
+        }
+    }
+    delete pbuf;
+}
+
+CBufferPool::~CBufferPool()
+{
+    for (size_t nClass = 0; nClass < nClasses; nClass++)
+        BOOST_FOREACH(CSerializeData* pbuf, vFree[nClass])
+            delete pbuf;
+}
+
+//! Wrap a pooled buffer in a shared_ptr whose deleter returns it to the pool,
+//! so shared send buffers recycle automatically when the last peer is done.
+static void ReturnPooledBuffer(CSerializeData* pbuf)
+{
+    bufferPool.Release(pbuf);
+}
+
+static std::shared_ptr<CSerializeData> AcquirePooledBuffer(size_t nSizeHint)
+{
+    return std::shared_ptr<CSerializeData>(bufferPool.Acquire(nSizeHint), ReturnPooledBuffer);
+}
+
+void CNetMessage::ReturnBuffer()
+{
+    CSerializeData* pbuf = new CSerializeData();
+    vRecv.SwapBuffer(*pbuf);
+    bufferPool.Release(pbuf);
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -665,7 +846,11 @@ int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
     if (hdr.nMessageSize > MAX_SIZE)
             return -1;
 
-    // switch state to reading message data
+    // switch state to reading message data, adopting a pooled payload buffer
+    // (capped, so an oversized announced length cannot reserve memory up front)
+    CSerializeData* pbuf = bufferPool.Acquire(std::min(hdr.nMessageSize, 256u * 1024));
+    vRecv.SwapBuffer(*pbuf);
+    bufferPool.Release(pbuf);
     in_data = true;
 
     return nCopy;
@@ -681,34 +866,156 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
         vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
     }
 
+    hasher.Write((const unsigned char*)pch, nCopy);
     memcpy(&vRecv[nDataPos], pch, nCopy);
     nDataPos += nCopy;
 
     return nCopy;
 }
 
+const uint256& CNetMessage::GetMessageHash()
+{
+    assert(complete());
+    if (data_hash.IsNull())
+        hasher.Finalize(data_hash.begin());
+    return data_hash;
+}
 
 
+
+/** Classify a queued wire message by the command in its header. Every
+ * entry in vSendMsg is a complete message, so the command sits right
+ * after the message start bytes (NUL-padded to COMMAND_SIZE). */
+static int MessageTrafficClass(const CSerializeData& data)
+{
+    if (data.size() < CMessageHeader::HEADER_SIZE)
+        return TRAFFIC_RELAY;
+    const char* cmd = &data[MESSAGE_START_SIZE];
+    if (strncmp(cmd, "block", CMessageHeader::COMMAND_SIZE) == 0)
+        return TRAFFIC_BULK;
+    if (strncmp(cmd, "headers", CMessageHeader::COMMAND_SIZE) == 0 ||
+        strncmp(cmd, "getheaders", CMessageHeader::COMMAND_SIZE) == 0 ||
+        strncmp(cmd, "ping", CMessageHeader::COMMAND_SIZE) == 0 ||
+        strncmp(cmd, "pong", CMessageHeader::COMMAND_SIZE) == 0 ||
+        strncmp(cmd, "version", CMessageHeader::COMMAND_SIZE) == 0 ||
+        strncmp(cmd, "verack", CMessageHeader::COMMAND_SIZE) == 0)
+        return TRAFFIC_CONSENSUS;
+    return TRAFFIC_RELAY;
+}
+
+/** Token bucket shared by all peers limiting bulk-class bytes per second.
+ * Budget is tracked in 100ms windows so throttled peers back off briefly
+ * instead of for a whole second. */
+static CCriticalSection cs_bulkSend;
+static int64_t nBulkWindowStart = 0;
+static size_t nBulkWindowBytes = 0;
+
+static size_t BulkSendRate()
+{
+    static const size_t nRate = (size_t)GetArg("-bulksendrate", 0) * 1024 * 1024;
+    return nRate;
+}
+
+//! True when the current window's bulk budget is already spent
+static bool BulkSendThrottled()
+{
+    size_t nRate = BulkSendRate();
+    if (nRate == 0)
+        return false;
+    LOCK(cs_bulkSend);
+    int64_t now = GetTimeMillis();
+    if (now - nBulkWindowStart >= 100) {
+        nBulkWindowStart = now;
+        nBulkWindowBytes = 0;
+        return false;
+    }
+    return nBulkWindowBytes >= nRate / 10;
+}
+
+static void BulkBytesSent(size_t nBytes)
+{
+    if (BulkSendRate() == 0)
+        return;
+    LOCK(cs_bulkSend);
+    nBulkWindowBytes += nBytes;
+}
+
 // requires LOCK(cs_vSend)
 void SocketSendData(CNode *pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
+    std::deque<std::shared_ptr<const CSerializeData> >::iterator it = pnode->vSendMsg.begin();
 
     while (it != pnode->vSendMsg.end()) {
-        const CSerializeData &data = *it;
+        int nBytes;
+        size_t nRequested = 0;
+        // When a bulk block heads the queue and the shared bulk budget for
+        // this window is spent, yield the socket loop to peers with
+        // consensus and relay traffic pending; this peer resumes in a
+        // later pass
+        if (MessageTrafficClass(**it) == TRAFFIC_BULK && BulkSendThrottled())
+            break;
+#ifndef _WIN32
+        // Gather several queued messages into one sendmsg() call. The queued
+        // buffers are immutable (and possibly shared with other peers'
+        // queues), so they are handed to the kernel in place rather than
+        // copied into one contiguous buffer first.
+        static const int SEND_IOV_MAX = 16;
+        struct iovec iov[SEND_IOV_MAX];
+        int nIov = 0;
+        size_t nOffset = pnode->nSendOffset;
+        for (std::deque<std::shared_ptr<const CSerializeData> >::iterator jt = it;
+             jt != pnode->vSendMsg.end() && nIov < SEND_IOV_MAX; jt++) {
+            const CSerializeData &data = **jt;
+            assert(data.size() > nOffset);
+            if (jt != it && MessageTrafficClass(data) == TRAFFIC_BULK && BulkSendThrottled())
+                break; // don't batch past the bulk budget
+            iov[nIov].iov_base = const_cast<char*>(&data[nOffset]);
+            iov[nIov].iov_len = data.size() - nOffset;
+            nRequested += iov[nIov].iov_len;
+            nIov++;
+            nOffset = 0;
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = nIov;
+        nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+        const CSerializeData &data = **it;
         assert(data.size() > pnode->nSendOffset);
-        int nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+        nRequested = data.size() - pnode->nSendOffset;
+        nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], nRequested, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         if (nBytes > 0) {
             pnode->nLastSend = GetTime();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             pnode->RecordBytesSent(nBytes);
-            if (pnode->nSendOffset == data.size()) {
+            // release the fully sent buffers, then leave what remains of a
+            // partially sent one as the new front offset
+            size_t nSent = nBytes;
+            size_t nBulkSent = 0;
+            while (it != pnode->vSendMsg.end() && nSent >= (*it)->size() - pnode->nSendOffset) {
+                size_t nMsgSent = (*it)->size() - pnode->nSendOffset;
+                int cls = MessageTrafficClass(**it);
+                pnode->nSendBytesPerClass[cls] += nMsgSent;
+                if (cls == TRAFFIC_BULK)
+                    nBulkSent += nMsgSent;
+                nSent -= nMsgSent;
+                pnode->nSendSize -= (*it)->size();
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            if (nSent > 0 && it != pnode->vSendMsg.end()) {
+                int cls = MessageTrafficClass(**it);
+                pnode->nSendBytesPerClass[cls] += nSent;
+                if (cls == TRAFFIC_BULK)
+                    nBulkSent += nSent;
+            }
+            if (nBulkSent > 0)
+                BulkBytesSent(nBulkSent);
+            pnode->nSendOffset += nSent;
+            if ((size_t)nBytes < nRequested) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -1012,6 +1319,177 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
     }
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+static int nEpollFd = -1;
+static std::map<SOCKET, uint32_t> mapEpollInterest;
+static CCriticalSection cs_mapEpollInterest;
+
+static void EpollUnregister(SOCKET hSocket)
+{
+    // Called before a socket is closed. The kernel drops closed descriptors
+    // from the epoll set on its own, but our interest map must forget them
+    // too, or a reused descriptor number would be mistaken for an existing
+    // registration and never re-added.
+    LOCK(cs_mapEpollInterest);
+    if (nEpollFd != -1 && mapEpollInterest.erase(hSocket))
+        epoll_ctl(nEpollFd, EPOLL_CTL_DEL, hSocket, NULL);
+}
+
+static void SocketEvents(const std::set<SOCKET>& setRecvInterest,
+                         const std::set<SOCKET>& setSendInterest,
+                         const std::set<SOCKET>& setErrorInterest,
+                         std::set<SOCKET>& setRecvReady,
+                         std::set<SOCKET>& setSendReady,
+                         std::set<SOCKET>& setErrorReady)
+{
+    // Event-driven readiness via a persistent epoll instance. Registrations
+    // are kept across iterations and only adjusted when a socket's interest
+    // changes, so a quiet iteration costs a single epoll_wait() no matter how
+    // many peers are connected, and there is no FD_SETSIZE cap. Sockets are
+    // watched level-triggered: the servicing loop below takes its buffer
+    // locks with TRY_LOCK and may skip a ready socket, which would lose the
+    // wakeup in edge-triggered mode.
+    if (nEpollFd == -1)
+    {
+        nEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (nEpollFd == -1)
+        {
+            LogPrintf("epoll_create1 failed: %s\n", NetworkErrorString(WSAGetLastError()));
+            MilliSleep(50);
+            return;
+        }
+    }
+
+    {
+        LOCK(cs_mapEpollInterest);
+
+        std::map<SOCKET, uint32_t> mapInterest;
+        BOOST_FOREACH(SOCKET hSocket, setRecvInterest)
+            mapInterest[hSocket] |= EPOLLIN;
+        BOOST_FOREACH(SOCKET hSocket, setSendInterest)
+            mapInterest[hSocket] |= EPOLLOUT;
+        BOOST_FOREACH(SOCKET hSocket, setErrorInterest)
+            mapInterest[hSocket] |= 0; // EPOLLERR/EPOLLHUP are always reported
+
+        for (std::map<SOCKET, uint32_t>::iterator it = mapEpollInterest.begin(); it != mapEpollInterest.end();)
+        {
+            if (mapInterest.count(it->first) == 0)
+            {
+                epoll_ctl(nEpollFd, EPOLL_CTL_DEL, it->first, NULL);
+                mapEpollInterest.erase(it++);
+            }
+            else
+                it++;
+        }
+        BOOST_FOREACH(const PAIRTYPE(const SOCKET, uint32_t)& item, mapInterest)
+        {
+            std::map<SOCKET, uint32_t>::iterator it = mapEpollInterest.find(item.first);
+            if (it != mapEpollInterest.end() && it->second == item.second)
+                continue;
+
+            struct epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = item.second;
+            event.data.fd = item.first;
+            if (epoll_ctl(nEpollFd, it == mapEpollInterest.end() ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, item.first, &event) == 0)
+                mapEpollInterest[item.first] = item.second;
+            else
+                LogPrint("net", "epoll_ctl on socket %u failed: %s\n", item.first, NetworkErrorString(WSAGetLastError()));
+        }
+    }
+
+    // The timeout doubles as the housekeeping tick: the disconnection and
+    // inactivity checks in ThreadSocketHandler, and retries of send buffers
+    // filled by other threads, must run even when no socket fires.
+    struct epoll_event events[64];
+    int nEvents = epoll_wait(nEpollFd, events, ARRAYLEN(events), 50);
+    if (nEvents == -1)
+    {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR)
+            LogPrintf("epoll_wait error %s\n", NetworkErrorString(nErr));
+        MilliSleep(50);
+        return;
+    }
+    for (int i = 0; i < nEvents; i++)
+    {
+        if (events[i].events & EPOLLIN)
+            setRecvReady.insert(events[i].data.fd);
+        if (events[i].events & EPOLLOUT)
+            setSendReady.insert(events[i].data.fd);
+        if (events[i].events & (EPOLLERR | EPOLLHUP))
+            setErrorReady.insert(events[i].data.fd);
+    }
+}
+#else
+static void SocketEvents(const std::set<SOCKET>& setRecvInterest,
+                         const std::set<SOCKET>& setSendInterest,
+                         const std::set<SOCKET>& setErrorInterest,
+                         std::set<SOCKET>& setRecvReady,
+                         std::set<SOCKET>& setSendReady,
+                         std::set<SOCKET>& setErrorReady)
+{
+    // select() fallback for platforms without epoll.
+    struct timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = 50000; // frequency to poll pnode->vSend
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+
+    BOOST_FOREACH(SOCKET hSocket, setRecvInterest) {
+        FD_SET(hSocket, &fdsetRecv);
+        hSocketMax = max(hSocketMax, hSocket);
+        have_fds = true;
+    }
+    BOOST_FOREACH(SOCKET hSocket, setSendInterest) {
+        FD_SET(hSocket, &fdsetSend);
+        hSocketMax = max(hSocketMax, hSocket);
+        have_fds = true;
+    }
+    BOOST_FOREACH(SOCKET hSocket, setErrorInterest) {
+        FD_SET(hSocket, &fdsetError);
+        hSocketMax = max(hSocketMax, hSocket);
+        have_fds = true;
+    }
+
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                         &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+
+    if (nSelect == SOCKET_ERROR)
+    {
+        if (have_fds)
+        {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            // report everything readable so the recv path surfaces the
+            // per-socket errors
+            setRecvReady.insert(setRecvInterest.begin(), setRecvInterest.end());
+            setRecvReady.insert(setSendInterest.begin(), setSendInterest.end());
+            setRecvReady.insert(setErrorInterest.begin(), setErrorInterest.end());
+        }
+        MilliSleep(timeout.tv_usec/1000);
+        return;
+    }
+
+    BOOST_FOREACH(SOCKET hSocket, setRecvInterest)
+        if (FD_ISSET(hSocket, &fdsetRecv))
+            setRecvReady.insert(hSocket);
+    BOOST_FOREACH(SOCKET hSocket, setSendInterest)
+        if (FD_ISSET(hSocket, &fdsetSend))
+            setSendReady.insert(hSocket);
+    BOOST_FOREACH(SOCKET hSocket, setErrorInterest)
+        if (FD_ISSET(hSocket, &fdsetError))
+            setErrorReady.insert(hSocket);
+}
+#endif
+
 void ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
@@ -1083,24 +1561,12 @@ void ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
+        std::set<SOCKET> setRecvInterest;
+        std::set<SOCKET> setSendInterest;
+        std::set<SOCKET> setErrorInterest;
 
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+            setRecvInterest.insert(hListenSocket.socket);
 
         {
             LOCK(cs_vNodes);
@@ -1108,18 +1574,16 @@ void ThreadSocketHandler()
             {
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, pnode->hSocket);
-                have_fds = true;
+                setErrorInterest.insert(pnode->hSocket);
 
                 // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
+                // * If there is data to send, watch for send readiness. As this only
                 //   happens when optimistic write failed, we choose to first drain the
                 //   write buffer in this case before receiving more. This avoids
                 //   needlessly queueing received data, if the remote peer is not themselves
                 //   receiving data. This means properly utilizing TCP flow control signaling.
                 // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
+                //   or there is space left in the buffer, watch for receive readiness.
                 // * (if neither of the above applies, there is certainly one message
                 //   in the receiver buffer ready to be processed).
                 // Together, that means that at least one of the following is always possible,
@@ -1130,7 +1594,7 @@ void ThreadSocketHandler()
                 {
                     TRY_LOCK(pnode->cs_vSend, lockSend);
                     if (lockSend && !pnode->vSendMsg.empty()) {
-                        FD_SET(pnode->hSocket, &fdsetSend);
+                        setSendInterest.insert(pnode->hSocket);
                         continue;
                     }
                 }
@@ -1139,35 +1603,24 @@ void ThreadSocketHandler()
                     if (lockRecv && (
                         pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
                         pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pnode->hSocket, &fdsetRecv);
+                        setRecvInterest.insert(pnode->hSocket);
                 }
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        std::set<SOCKET> setRecvReady;
+        std::set<SOCKET> setSendReady;
+        std::set<SOCKET> setErrorReady;
+        SocketEvents(setRecvInterest, setSendInterest, setErrorInterest,
+                     setRecvReady, setSendReady, setErrorReady);
         boost::this_thread::interruption_point();
 
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec/1000);
-        }
-
         //
         // Accept new connections
         //
         BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && setRecvReady.count(hListenSocket.socket))
             {
                 AcceptConnection(hListenSocket);
             }
@@ -1192,7 +1645,7 @@ void ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError))
+            if (setRecvReady.count(pnode->hSocket) || setErrorReady.count(pnode->hSocket))
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                 if (lockRecv)
@@ -1236,7 +1689,7 @@ void ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetSend))
+            if (setSendReady.count(pnode->hSocket))
             {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
                 if (lockSend)
@@ -1279,6 +1732,24 @@ void ThreadSocketHandler()
     }
 }
 
+static void DNSSeedLookup(const CDNSSeedData* pseed, std::atomic<int>* pnFound)
+{
+    vector<CNetAddr> vIPs;
+    vector<CAddress> vAdd;
+    if (LookupHost(pseed->host.c_str(), vIPs))
+    {
+        BOOST_FOREACH(const CNetAddr& ip, vIPs)
+        {
+            int nOneDay = 24*3600;
+            CAddress addr = CAddress(CService(ip, Params().GetDefaultPort()));
+            addr.nTime = GetTime() - 3*nOneDay - GetRand(4*nOneDay); // use a random age between 3 and 7 days old
+            vAdd.push_back(addr);
+            (*pnFound)++;
+        }
+        addrman.Add(vAdd, CNetAddr(pseed->name, true));
+    }
+}
+
 void ThreadDNSAddressSeed()
 {
     // goal: only query DNS seeds if address need is acute
@@ -1294,32 +1765,23 @@ void ThreadDNSAddressSeed()
     }
 
     const vector<CDNSSeedData> &vSeeds = Params().DNSSeeds();
-    int found = 0;
+    std::atomic<int> found(0);
 
     LogPrintf("Loading addresses from DNS seeds (could take a while)\n");
 
+    // Resolve every seed in parallel, so one unresponsive seed no longer
+    // serializes the rest behind its resolver timeout.
+    boost::thread_group seedThreads;
     BOOST_FOREACH(const CDNSSeedData &seed, vSeeds) {
         if (HaveNameProxy()) {
             AddOneShot(seed.host);
         } else {
-            vector<CNetAddr> vIPs;
-            vector<CAddress> vAdd;
-            if (LookupHost(seed.host.c_str(), vIPs))
-            {
-                BOOST_FOREACH(const CNetAddr& ip, vIPs)
-                {
-                    int nOneDay = 24*3600;
-                    CAddress addr = CAddress(CService(ip, Params().GetDefaultPort()));
-                    addr.nTime = GetTime() - 3*nOneDay - GetRand(4*nOneDay); // use a random age between 3 and 7 days old
-                    vAdd.push_back(addr);
-                    found++;
-                }
-            }
-            addrman.Add(vAdd, CNetAddr(seed.name, true));
+            seedThreads.create_thread(boost::bind(&DNSSeedLookup, &seed, &found));
         }
     }
+    seedThreads.join_all();
 
-    LogPrintf("%d addresses found from DNS seeds\n", found);
+    LogPrintf("%d addresses found from DNS seeds\n", (int)found);
 }
 
 
@@ -1327,13 +1789,150 @@ void DumpAddresses()
 {
     int64_t nStart = GetTimeMillis();
 
+    // A full rewrite of peers.dat re-serializes the whole table (and holds
+    // addrman's lock against the connection threads while it does), even when
+    // only a handful of addresses changed. Routine dumps therefore append
+    // just the changes made since the previous dump to peers.journal; the
+    // table is only rewritten wholesale once enough journaled dumps have
+    // accumulated, folding the journal back in.
+    static int nDumpsSinceFull = DUMP_ADDRESSES_COMPACT_EVERY;
+
     CAddrDB adb;
+    std::vector<CAddrJournalEntry> vChanges;
+    bool fJournalUsable = addrman.GetPendingJournal(vChanges);
+
+    if (fJournalUsable && nDumpsSinceFull < DUMP_ADDRESSES_COMPACT_EVERY) {
+        if (vChanges.empty()) {
+            LogPrint("net", "No addrman changes since last dump, skipped peers.dat write\n");
+            return;
+        }
+        if (adb.AppendJournal(vChanges)) {
+            nDumpsSinceFull++;
+            LogPrint("net", "Journaled %u addrman changes to peers.journal  %dms\n",
+                   vChanges.size(), GetTimeMillis() - nStart);
+            return;
+        }
+        // journal could not be written; fall back to a full dump
+    }
+
     adb.Write(addrman);
+    nDumpsSinceFull = 0;
 
     LogPrint("net", "Flushed %d addresses to peers.dat  %dms\n",
            addrman.size(), GetTimeMillis() - nStart);
 }
 
+static void DumpBanlist()
+{
+    int64_t nStart = GetTimeMillis();
+
+    CNode::SweepBanned(); // clean unused entries (if bantime has expired)
+    if (!CNode::BannedSetIsDirty())
+        return;
+
+    CBanDB bandb;
+    std::map<CSubNet, int64_t> banmap;
+    CNode::GetBanned(banmap);
+    if (bandb.Write(banmap))
+        CNode::SetBannedSetDirty(false);
+
+    LogPrint("net", "Flushed %d banned node ips/subnets to banlist.dat  %dms\n",
+           banmap.size(), GetTimeMillis() - nStart);
+}
+
+/**
+ * Outbound connection attempts are handed to a small pool of worker threads
+ * ("netconn"), so a hung resolver or connect timeout never stalls the address
+ * selection loop; the pool size is the budget of attempts in flight.
+ */
+struct CPendingConnection
+{
+    CAddress addr;
+    std::string strDest;
+    bool fOneShot;
+    bool fUseGrant;
+};
+
+static deque<CPendingConnection> dqPendingConnections;
+static set<string> setPendingConnections; //!< queued or in-flight destinations, for dedup
+static CCriticalSection cs_PendingConnections;
+static boost::condition_variable condPendingConnections;
+static int nConnectWorkers = DEFAULT_CONNECT_WORKERS;
+
+static std::string PendingConnectionKey(const CPendingConnection& pending)
+{
+    return pending.strDest.empty() ? pending.addr.ToStringIPPort() : pending.strDest;
+}
+
+//! Queue an outbound connection attempt for the worker pool. Fails when the
+//! same destination is already queued or being attempted.
+static bool QueueNetworkConnection(const CAddress& addrConnect, const char* pszDest = NULL, bool fOneShot = false, bool fUseGrant = true)
+{
+    CPendingConnection pending;
+    pending.addr = addrConnect;
+    if (pszDest)
+        pending.strDest = pszDest;
+    pending.fOneShot = fOneShot;
+    pending.fUseGrant = fUseGrant;
+    {
+        LOCK(cs_PendingConnections);
+        if (!setPendingConnections.insert(PendingConnectionKey(pending)).second)
+            return false;
+        dqPendingConnections.push_back(pending);
+    }
+    condPendingConnections.notify_one();
+    return true;
+}
+
+//! How many attempts are queued or in flight.
+static int PendingConnectionCount()
+{
+    LOCK(cs_PendingConnections);
+    return (int)setPendingConnections.size();
+}
+
+static void ThreadConnectionAttempt()
+{
+    static boost::mutex condition_mutex;
+    while (true)
+    {
+        boost::this_thread::interruption_point();
+
+        CPendingConnection pending;
+        bool fHavePending = false;
+        {
+            LOCK(cs_PendingConnections);
+            if (!dqPendingConnections.empty()) {
+                pending = dqPendingConnections.front();
+                dqPendingConnections.pop_front();
+                fHavePending = true;
+            }
+        }
+        if (!fHavePending) {
+            boost::unique_lock<boost::mutex> lock(condition_mutex);
+            condPendingConnections.timed_wait(lock, boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(500));
+            continue;
+        }
+
+        const char* pszDest = pending.strDest.empty() ? NULL : pending.strDest.c_str();
+        if (pending.fOneShot) {
+            CSemaphoreGrant grant(*semOutbound, true);
+            if (grant && !OpenNetworkConnection(pending.addr, &grant, pszDest, true))
+                AddOneShot(pending.strDest);
+        } else if (!pending.fUseGrant) {
+            OpenNetworkConnection(pending.addr, NULL, pszDest);
+        } else {
+            CSemaphoreGrant grant(*semOutbound);
+            OpenNetworkConnection(pending.addr, &grant, pszDest);
+        }
+
+        {
+            LOCK(cs_PendingConnections);
+            setPendingConnections.erase(PendingConnectionKey(pending));
+        }
+    }
+}
+
 void static ProcessOneShot()
 {
     string strDest;
@@ -1345,11 +1944,8 @@ void static ProcessOneShot()
         vOneShots.pop_front();
     }
     CAddress addr;
-    CSemaphoreGrant grant(*semOutbound, true);
-    if (grant) {
-        if (!OpenNetworkConnection(addr, &grant, strDest.c_str(), true))
-            AddOneShot(strDest);
-    }
+    if (!QueueNetworkConnection(addr, strDest.c_str(), true))
+        AddOneShot(strDest);
 }
 
 void ThreadOpenConnections()
@@ -1363,7 +1959,7 @@ void ThreadOpenConnections()
             BOOST_FOREACH(const std::string& strAddr, mapMultiArgs["-connect"])
             {
                 CAddress addr;
-                OpenNetworkConnection(addr, NULL, strAddr.c_str());
+                QueueNetworkConnection(addr, strAddr.c_str(), false, false);
                 for (int i = 0; i < 10 && i < nLoop; i++)
                 {
                     MilliSleep(500);
@@ -1381,7 +1977,14 @@ void ThreadOpenConnections()
 
         MilliSleep(500);
 
-        CSemaphoreGrant grant(*semOutbound);
+        // Let the workers drain their backlog before selecting more
+        // candidates; the outbound semaphore itself is taken by the worker
+        // that performs the attempt.
+        while (PendingConnectionCount() >= nConnectWorkers)
+        {
+            boost::this_thread::interruption_point();
+            MilliSleep(100);
+        }
         boost::this_thread::interruption_point();
 
         // Add seed nodes if DNS seeds are all down (an infrastructure attack?).
@@ -1448,12 +2051,17 @@ void ThreadOpenConnections()
             if (addr.GetPort() != Params().GetDefaultPort() && nTries < 50)
                 continue;
 
+            // prefer addresses that established quickly for us before; fall
+            // back to unmeasured or slow ones as more selections fail
+            if (addr.GetConnectLatency() > 1500 && nTries < 20)
+                continue;
+
             addrConnect = addr;
             break;
         }
 
         if (addrConnect.IsValid())
-            OpenNetworkConnection(addrConnect, &grant);
+            QueueNetworkConnection(addrConnect);
     }
 }
 
@@ -1563,10 +2171,15 @@ bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant *grantOu
 }
 
 
-void ThreadMessageHandler()
+// Each handler thread owns the peers whose node id hashes to it, so one
+// peer's messages are always processed in order on the same thread while
+// different peers proceed concurrently. Validation stays serialized on
+// cs_main inside ProcessMessages/SendMessages; multiple threads parallelize
+// everything in front of it: checksum verification, deserialization, getdata
+// serving and the per-peer queue handling under the peer's own locks.
+static void ThreadMessageHandler(int nThreadId, int nThreads)
 {
-    boost::mutex condition_mutex;
-    boost::unique_lock<boost::mutex> lock(condition_mutex);
+    static boost::mutex condition_mutex;
 
     SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
     while (true)
@@ -1574,9 +2187,11 @@ void ThreadMessageHandler()
         vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            BOOST_FOREACH(CNode* pnode, vNodesCopy) {
+            BOOST_FOREACH(CNode* pnode, vNodes) {
+                if (pnode->GetId() % nThreads != nThreadId)
+                    continue;
                 pnode->AddRef();
+                vNodesCopy.push_back(pnode);
             }
         }
 
@@ -1627,7 +2242,10 @@ void ThreadMessageHandler()
         }
 
         if (fSleep)
+        {
+            boost::unique_lock<boost::mutex> lock(condition_mutex);
             messageHandlerCondition.timed_wait(lock, boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(100));
+        }
     }
 }
 
@@ -1796,9 +2414,32 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
         CAddrDB adb;
         if (!adb.Read(addrman))
             LogPrintf("Invalid or missing peers.dat; recreating\n");
+
+        // replay changes journaled since the last full dump
+        std::vector<CAddrJournalEntry> vJournal;
+        if (adb.ReadJournal(vJournal)) {
+            BOOST_FOREACH(const CAddrJournalEntry& entry, vJournal)
+                addrman.ReplayJournalEntry(entry);
+            LogPrintf("Replayed %u addrman changes from peers.journal\n", vJournal.size());
+        }
     }
     LogPrintf("Loaded %i addresses from peers.dat  %dms\n",
            addrman.size(), GetTimeMillis() - nStart);
+
+    uiInterface.InitMessage(_("Loading banlist..."));
+    // Load addresses from banlist.dat
+    nStart = GetTimeMillis();
+    {
+        CBanDB bandb;
+        std::map<CSubNet, int64_t> banmap;
+        if (bandb.Read(banmap))
+            CNode::SetBanned(banmap);
+        else
+            LogPrintf("Invalid or missing banlist.dat; recreating\n");
+        LogPrintf("Loaded %d banned node ips/subnets from banlist.dat  %dms\n",
+               banmap.size(), GetTimeMillis() - nStart);
+    }
+
     fAddressesInitialized = true;
 
     if (semOutbound == NULL) {
@@ -1831,14 +2472,26 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Initiate outbound connections from -addnode
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "addcon", &ThreadOpenAddedConnections));
 
+    // Perform the blocking resolve/connect work for outbound attempts
+    nConnectWorkers = GetArg("-connectworkers", DEFAULT_CONNECT_WORKERS);
+    nConnectWorkers = std::max(1, std::min(nConnectWorkers, MAX_CONNECT_WORKERS));
+    for (int i = 0; i < nConnectWorkers; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "netconn", &ThreadConnectionAttempt));
+
     // Initiate outbound connections
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "opencon", &ThreadOpenConnections));
 
-    // Process messages
-    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
+    // Process messages; each handler thread serves a disjoint subset of the
+    // peers so a slow message from one peer cannot stall the others
+    int nMsgHandlerThreads = GetArg("-msghandlerthreads", DEFAULT_MSGHANDLER_THREADS);
+    nMsgHandlerThreads = std::max(1, std::min(nMsgHandlerThreads, MAX_MSGHANDLER_THREADS));
+    for (int i = 0; i < nMsgHandlerThreads; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()> >, "msghand",
+                                              boost::function<void()>(boost::bind(&ThreadMessageHandler, i, nMsgHandlerThreads))));
 
     // Dump network addresses
     scheduler.scheduleEvery(&DumpAddresses, DUMP_ADDRESSES_INTERVAL);
+    scheduler.scheduleEvery(&DumpBanlist, DUMP_BANS_INTERVAL);
 }
 
 bool StopNode()
@@ -1851,6 +2504,7 @@ bool StopNode()
     if (KOMODO_NSPV_FULLNODE && fAddressesInitialized)
     {
         DumpAddresses();
+        DumpBanlist();
         fAddressesInitialized = false;
     }
 
@@ -1896,28 +2550,59 @@ instance_of_cnetcleanup;
 
 void RelayTransaction(const CTransaction& tx)
 {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    CDataStream& ss = GetScratchStream(SER_NETWORK, PROTOCOL_VERSION);
     ss.reserve(10000);
     ss << tx;
     RelayTransaction(tx, ss);
 }
 
+/// One filter shared by every connection: a transaction that was recently
+// queued into all peers' pending inventory does not need to be queued again,
+// no matter how many peers re-announce it. Reset on a timer so the periodic
+// wallet rebroadcast still gets through.
+static std::unique_ptr<CRollingBloomFilter> recentlyAnnouncedFilter;
+static int64_t nAnnounceFilterReset = 0;
+static CCriticalSection cs_recentlyAnnounced;
+
 void RelayTransaction(const CTransaction& tx, const CDataStream& ss)
 {
     CInv inv(MSG_TX, tx.GetHash());
+    {
+        LOCK(cs_recentlyAnnounced);
+        int64_t nNow = GetTime();
+        if (recentlyAnnouncedFilter == nullptr)
+            recentlyAnnouncedFilter.reset(new CRollingBloomFilter(120000, 0.000001));
+        else if (nNow > nAnnounceFilterReset)
+            recentlyAnnouncedFilter->reset();
+        if (nNow > nAnnounceFilterReset)
+            nAnnounceFilterReset = nNow + 10 * 60;
+        if (recentlyAnnouncedFilter->contains(inv.hash))
+            return;
+        recentlyAnnouncedFilter->insert(inv.hash);
+    }
     {
         LOCK(cs_mapRelay);
-        // Expire old relay messages
-        while (!vRelayExpiration.empty() && vRelayExpiration.front().first < GetTime())
+        // Expire old relay messages; when the ring is full the oldest entry
+        // goes early, so neither side of the bookkeeping ever allocates
+        const int64_t nNow = GetTime();
+        while (nRelayExpCount > 0 &&
+               (vRelayExpiration[nRelayExpFront].first < nNow || nRelayExpCount == RELAY_MAP_CAPACITY))
         {
-            mapRelay.erase(vRelayExpiration.front().second);
-            vRelayExpiration.pop_front();
+            mapRelay.erase(vRelayExpiration[nRelayExpFront].second);
+            nRelayExpFront = (nRelayExpFront + 1) & (RELAY_MAP_CAPACITY - 1);
+            nRelayExpCount--;
         }
 
-        // Save original serialized message so newer versions are preserved
-        mapRelay.insert(std::make_pair(inv, ss));
-        vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
+        // Build the wire message once; every peer that requests this inv is
+        // served the same shared buffer
+        const int64_t nExpiry = nNow + 15 * 60;
+        mapRelay.insert(inv, BuildNetMessage(inv.GetCommand(), ss), nExpiry);
+        vRelayExpiration[(nRelayExpFront + nRelayExpCount) & (RELAY_MAP_CAPACITY - 1)] = std::make_pair(nExpiry, inv);
+        nRelayExpCount++;
     }
+    // Extract the data elements bloom matching probes once; every
+    // filter-loaded peer is tested against the same digest
+    std::unique_ptr<CTxBloomDigest> digest;
     LOCK(cs_vNodes);
     BOOST_FOREACH(CNode* pnode, vNodes)
     {
@@ -1926,7 +2611,9 @@ void RelayTransaction(const CTransaction& tx, const CDataStream& ss)
         LOCK(pnode->cs_filter);
         if (pnode->pfilter)
         {
-            if (pnode->pfilter->IsRelevantAndUpdate(tx))
+            if (digest == nullptr)
+                digest.reset(new CTxBloomDigest(tx));
+            if (pnode->pfilter->IsRelevantAndUpdate(tx, *digest))
                 pnode->PushInventory(inv);
         } else pnode->PushInventory(inv);
     }
@@ -1998,6 +2685,7 @@ void CNode::Fuzz(int nChance)
 CAddrDB::CAddrDB()
 {
     pathAddr = GetDataDir() / "peers.dat";
+    pathJournal = GetDataDir() / "peers.journal";
 }
 
 bool CAddrDB::Write(const CAddrMan& addr)
@@ -2035,9 +2723,101 @@ bool CAddrDB::Write(const CAddrMan& addr)
     if (!RenameOver(pathTmp, pathAddr))
         return error("%s: Rename-into-place failed", __func__);
 
+    // the full dump includes everything the journal recorded
+    EraseJournal();
+
+    return true;
+}
+
+bool CAddrDB::AppendJournal(const std::vector<CAddrJournalEntry>& vEntries)
+{
+    if (vEntries.empty())
+        return true;
+
+    // serialize the batch, then frame it with a length prefix and checksum so
+    // a torn append can be detected and discarded on load
+    CDataStream ssBatch(SER_DISK, CLIENT_VERSION);
+    ssBatch << FLATDATA(Params().MessageStart());
+    ssBatch << vEntries;
+    uint256 hash = Hash(ssBatch.begin(), ssBatch.end());
+
+    FILE *file = fopen(pathJournal.string().c_str(), "ab");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s: Failed to open file %s", __func__, pathJournal.string());
+
+    try {
+        fileout << (uint32_t)ssBatch.size();
+        fileout.write(&ssBatch[0], ssBatch.size());
+        fileout << hash;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+
     return true;
 }
 
+bool CAddrDB::ReadJournal(std::vector<CAddrJournalEntry>& vEntries)
+{
+    vEntries.clear();
+
+    // a missing journal is the normal case right after a full dump
+    FILE *file = fopen(pathJournal.string().c_str(), "rb");
+    if (!file)
+        return false;
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+
+    while (true) {
+        uint32_t nSize = 0;
+        try {
+            filein >> nSize;
+        }
+        catch (const std::exception&) {
+            break; // end of journal
+        }
+        if (nSize == 0 || nSize > MAX_SIZE)
+            break;
+        std::vector<char> vchBatch(nSize);
+        uint256 hashIn;
+        try {
+            filein.read(&vchBatch[0], nSize);
+            filein >> hashIn;
+        }
+        catch (const std::exception&) {
+            LogPrintf("%s: discarding torn batch at end of %s\n", __func__, pathJournal.string());
+            break;
+        }
+        if (Hash(vchBatch.begin(), vchBatch.end()) != hashIn) {
+            LogPrintf("%s: checksum mismatch in %s, ignoring rest of journal\n", __func__, pathJournal.string());
+            break;
+        }
+        try {
+            CDataStream ssBatch(vchBatch, SER_DISK, CLIENT_VERSION);
+            unsigned char pchMsgTmp[4];
+            ssBatch >> FLATDATA(pchMsgTmp);
+            if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+                return error("%s: Invalid network magic number", __func__);
+            std::vector<CAddrJournalEntry> vBatch;
+            ssBatch >> vBatch;
+            vEntries.insert(vEntries.end(), vBatch.begin(), vBatch.end());
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s", __func__, e.what());
+        }
+    }
+
+    return !vEntries.empty();
+}
+
+void CAddrDB::EraseJournal()
+{
+    boost::system::error_code ec;
+    boost::filesystem::remove(pathJournal, ec);
+}
+
 bool CAddrDB::Read(CAddrMan& addr)
 {
     // open input file, and associate with CAutoFile
@@ -2092,6 +2872,107 @@ bool CAddrDB::Read(CAddrMan& addr)
     return true;
 }
 
+//
+// CBanDB
+//
+
+CBanDB::CBanDB()
+{
+    pathBanlist = GetDataDir() / "banlist.dat";
+}
+
+bool CBanDB::Write(const std::map<CSubNet, int64_t>& banSet)
+{
+    // Generate random temporary filename
+    unsigned short randv = 0;
+    GetRandBytes((unsigned char*)&randv, sizeof(randv));
+    std::string tmpfn = strprintf("banlist.dat.%04x", randv);
+
+    // serialize banlist, checksum data up to that point, then append csum
+    CDataStream ssBanlist(SER_DISK, CLIENT_VERSION);
+    ssBanlist << FLATDATA(Params().MessageStart());
+    ssBanlist << banSet;
+    uint256 hash = Hash(ssBanlist.begin(), ssBanlist.end());
+    ssBanlist << hash;
+
+    // open temp output file, and associate with CAutoFile
+    boost::filesystem::path pathTmp = GetDataDir() / tmpfn;
+    FILE *file = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s: Failed to open file %s", __func__, pathTmp.string());
+
+    // Write and commit header, data
+    try {
+        fileout << ssBanlist;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+
+    // replace existing banlist.dat, if any, with new banlist.dat.XXXX
+    if (!RenameOver(pathTmp, pathBanlist))
+        return error("%s: Rename-into-place failed", __func__);
+
+    return true;
+}
+
+bool CBanDB::Read(std::map<CSubNet, int64_t>& banSet)
+{
+    // open input file, and associate with CAutoFile
+    FILE *file = fopen(pathBanlist.string().c_str(), "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: Failed to open file %s", __func__, pathBanlist.string());
+
+    // use file size to size memory buffer
+    int fileSize = boost::filesystem::file_size(pathBanlist);
+    int dataSize = fileSize - sizeof(uint256);
+    // Don't try to resize to a negative number if file is small
+    if (dataSize < 0)
+        dataSize = 0;
+    vector<unsigned char> vchData;
+    vchData.resize(dataSize);
+    uint256 hashIn;
+
+    // read data and checksum from file
+    try {
+        filein.read((char *)&vchData[0], dataSize);
+        filein >> hashIn;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    filein.fclose();
+
+    CDataStream ssBanlist(vchData, SER_DISK, CLIENT_VERSION);
+
+    // verify stored checksum matches input data
+    uint256 hashTmp = Hash(ssBanlist.begin(), ssBanlist.end());
+    if (hashIn != hashTmp)
+        return error("%s: Checksum mismatch, data corrupted", __func__);
+
+    unsigned char pchMsgTmp[4];
+    try {
+        // de-serialize file header (network specific magic number) and ..
+        ssBanlist >> FLATDATA(pchMsgTmp);
+
+        // ... verify the network matches ours
+        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+            return error("%s: Invalid network magic number", __func__);
+
+        // de-serialize ban data
+        ssBanlist >> banSet;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    return true;
+}
+
 unsigned int ReceiveFloodSize() { return 1000*GetArg("-maxreceivebuffer", 5*1000); }
 unsigned int SendBufferSize() { return 1000*GetArg("-maxsendbuffer", 1*1000); }
 
@@ -2106,6 +2987,7 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     nLastSend = 0;
     nLastRecv = 0;
     nSendBytes = 0;
+    memset(nSendBytesPerClass, 0, sizeof(nSendBytesPerClass));
     nRecvBytes = 0;
     nTimeConnected = GetTime();
     nTimeOffset = 0;
@@ -2127,8 +3009,10 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     nStartingHeight = -1;
     fGetAddr = false;
     fRelayTxes = false;
+    fPreferCmpctBlocks = false;
     fSentAddr = false;
     pfilter = new CBloomFilter();
+    nNextInvSend = 0;
     nPingNonceSent = 0;
     nPingUsecStart = 0;
     nPingUsecTime = 0;
@@ -2155,8 +3039,16 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
 
 CNode::~CNode()
 {
+#ifdef HAVE_SYS_EPOLL_H
+    if (hSocket != INVALID_SOCKET)
+        EpollUnregister(hSocket);
+#endif
     CloseSocket(hSocket);
 
+    // recycle payload buffers of any messages that were never processed
+    BOOST_FOREACH(CNetMessage& msg, vRecvMsg)
+        msg.ReturnBuffer();
+
     if (pfilter)
         delete pfilter;
 
@@ -2174,9 +3066,9 @@ void CNode::AskFor(const CInv& inv)
     // We're using mapAskFor as a priority queue,
     // the key is the earliest time the request can be sent
     int64_t nRequestTime;
-    limitedmap<CInv, int64_t>::const_iterator it = mapAlreadyAskedFor.find(inv);
-    if (it != mapAlreadyAskedFor.end())
-        nRequestTime = it->second;
+    const int64_t* pnAskedFor = mapAlreadyAskedFor.find(inv);
+    if (pnAskedFor != NULL)
+        nRequestTime = *pnAskedFor;
     else
         nRequestTime = 0;
     LogPrint("net", "askfor %s  %d (%s) peer=%d\n", inv.ToString(), nRequestTime, DateTimeStrFormat("%H:%M:%S", nRequestTime/1000000), id);
@@ -2190,10 +3082,9 @@ void CNode::AskFor(const CInv& inv)
 
     // Each retry is 2 minutes after the last
     nRequestTime = std::max(nRequestTime + 2 * 60 * 1000000, nNow);
-    if (it != mapAlreadyAskedFor.end())
-        mapAlreadyAskedFor.update(it, nRequestTime);
-    else
-        mapAlreadyAskedFor.insert(std::make_pair(inv, nRequestTime));
+    // the request time doubles as the eviction priority: a full probe
+    // window displaces its stalest entry, as limitedmap did globally
+    mapAlreadyAskedFor.insert(inv, nRequestTime, nRequestTime);
     mapAskFor.insert(std::make_pair(nRequestTime, inv));
 }
 
@@ -2237,26 +3128,66 @@ void CNode::EndMessage() RELEASE(cs_vSend)
     unsigned int nSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
     WriteLE32((uint8_t*)&ssSend[CMessageHeader::MESSAGE_SIZE_OFFSET], nSize);
 
-    // Set the checksum
-    uint256 hash = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
+    // Set the checksum. Whitelisted peers that negotiated
+    // FAST_CHECKSUM_VERSION get the cheaper SipHash checksum, which halves
+    // the hashing cost on block-heavy trusted links; everyone else keeps
+    // SHA256d.
     unsigned int nChecksum = 0;
-    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    if (fWhitelisted && nVersion >= FAST_CHECKSUM_VERSION) {
+        nChecksum = FastMessageChecksum(Params().MessageStart(),
+            nSize ? (const unsigned char*)&ssSend[CMessageHeader::HEADER_SIZE] : NULL, nSize);
+    } else {
+        uint256 hash = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
+        memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    }
     assert(ssSend.size () >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
     memcpy((char*)&ssSend[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
 
     LogPrint("net", "(%d bytes) peer=%d\n", nSize, id);
 
-    std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-    ssSend.GetAndClear(*it);
-    nSendSize += (*it).size();
+    std::shared_ptr<CSerializeData> data = AcquirePooledBuffer(ssSend.size());
+    ssSend.GetAndClear(*data);
+    nSendSize += data->size();
+    vSendMsg.push_back(data);
 
     // If write queue empty, attempt "optimistic write"
-    if (it == vSendMsg.begin())
+    if (vSendMsg.size() == 1)
         SocketSendData(this);
 
     LEAVE_CRITICAL_SECTION(cs_vSend);
 }
 
+void CNode::PushSharedMessage(const char* pszCommand, const std::shared_ptr<const CSerializeData>& msg)
+{
+    LOCK(cs_vSend);
+    LogPrint("net", "sending: %s (%d bytes) peer=%d\n", SanitizeString(pszCommand),
+             msg->size() - CMessageHeader::HEADER_SIZE, id);
+
+    nSendSize += msg->size();
+    vSendMsg.push_back(msg);
+
+    // If write queue empty, attempt "optimistic write"
+    if (vSendMsg.size() == 1)
+        SocketSendData(this);
+}
+
+std::shared_ptr<const CSerializeData> BuildNetMessage(const char* pszCommand, const CDataStream& ssPayload)
+{
+    CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+    ssHeader << CMessageHeader(Params().MessageStart(), pszCommand, ssPayload.size());
+
+    // Set the checksum
+    uint256 hash = Hash(ssPayload.begin(), ssPayload.end());
+    unsigned int nChecksum = 0;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    memcpy((char*)&ssHeader[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
+
+    std::shared_ptr<CSerializeData> data = AcquirePooledBuffer(ssHeader.size() + ssPayload.size());
+    data->insert(data->end(), ssHeader.begin(), ssHeader.end());
+    data->insert(data->end(), ssPayload.begin(), ssPayload.end());
+    return data;
+}
+
 void CopyNodeStats(std::vector<CNodeStats>& vstats)
 {
     vstats.clear();
@@ -24,8 +24,8 @@
 #include "bloom.h"
 #include "compat.h"
 #include "hash.h"
-#include "limitedmap.h"
 #include "mruset.h"
+#include "openmap.h"
 #include "netbase.h"
 #include "protocol.h"
 #include "random.h"
@@ -36,6 +36,7 @@
 #include "util.h"
 
 #include <deque>
+#include <memory>
 #include <stdint.h>
 
 #ifndef _WIN32
@@ -61,6 +62,14 @@ static const int PING_INTERVAL = 2 * 60;
 static const int TIMEOUT_INTERVAL = 20 * 60;
 /** The maximum number of entries in an 'inv' protocol message */
 static const unsigned int MAX_INV_SZ = 50000;
+/** -msghandlerthreads default; each handler thread serves a disjoint subset of peers */
+static const int DEFAULT_MSGHANDLER_THREADS = 1;
+/** Upper bound for -msghandlerthreads */
+static const int MAX_MSGHANDLER_THREADS = 16;
+/** -connectworkers default; bounds how many outbound connect/resolve attempts run at once */
+static const int DEFAULT_CONNECT_WORKERS = 4;
+/** Upper bound for -connectworkers */
+static const int MAX_CONNECT_WORKERS = 16;
 /** The maximum number of new addresses to accumulate before announcing. */
 static const unsigned int MAX_ADDR_TO_SEND = 1000;
 /** The maximum rate of address records we're willing to process on average. Can be bypassed using
@@ -173,10 +182,21 @@ extern int nMaxConnections;
 
 extern std::vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
-extern std::map<CInv, CDataStream> mapRelay;
-extern std::deque<std::pair<int64_t, CInv> > vRelayExpiration;
+/** Bucket hash for the relay bookkeeping tables; inv hashes are uniform
+ *  already, so mixing in the type is all that is needed */
+struct CInvMapHasher {
+    size_t operator()(const CInv& inv) const {
+        return (size_t)(inv.hash.GetCheapHash() + (uint64_t)inv.type * 0x9e3779b97f4a7c15ULL);
+    }
+};
+
+/** Relay table capacity, a power of two comfortably above the observed
+ *  steady state (~50k live entries on a busy node) */
+static const size_t RELAY_MAP_CAPACITY = 1 << 16;
+
+extern openmap<CInv, std::shared_ptr<const CSerializeData>, CInvMapHasher> mapRelay;
 extern CCriticalSection cs_mapRelay;
-extern limitedmap<CInv, int64_t> mapAlreadyAskedFor;
+extern openmap<CInv, int64_t, CInvMapHasher> mapAlreadyAskedFor;
 
 extern std::vector<std::string> vAddedNodes;
 extern CCriticalSection cs_vAddedNodes;
@@ -195,6 +215,18 @@ struct LocalServiceInfo {
 extern CCriticalSection cs_mapLocalHost;
 extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
 
+/** Traffic classes for outbound messages, derived from the wire command.
+ * Bulk transfers can be rate-limited (-bulksendrate) so consensus-critical
+ * chatter such as headers and pings is never starved by peers bulk-syncing
+ * the chain. */
+enum TrafficClass
+{
+    TRAFFIC_CONSENSUS = 0, //!< headers, pings and handshake traffic
+    TRAFFIC_RELAY = 1,     //!< tx/inv gossip and everything unclassified
+    TRAFFIC_BULK = 2,      //!< full historical blocks
+    NUM_TRAFFIC_CLASSES = 3,
+};
+
 class CNodeStats
 {
 public:
@@ -210,6 +242,7 @@ public:
     bool fInbound;
     int nStartingHeight;
     uint64_t nSendBytes;
+    uint64_t nSendBytesPerClass[NUM_TRAFFIC_CLASSES];
     uint64_t nRecvBytes;
     bool fWhitelisted;
     double dPingTime;
@@ -225,6 +258,41 @@ public:
 };
 
 
+/**
+ * Size-classed pool of message payload buffers shared by every connection.
+ * With hundreds of peers cycling daily, allocating each send and receive
+ * buffer from the heap fragments it and shows up as RSS growth; recycling
+ * buffers through the pool keeps steady-state network memory bounded and
+ * mostly allocation-free. Buffers are handed back when a message has been
+ * processed, when the last peer sharing a send buffer releases it, and on
+ * CNode destruction.
+ */
+class CBufferPool
+{
+private:
+    //! number of capacity classes; larger buffers are not pooled
+    static const size_t nClasses = 4;
+    CCriticalSection cs_pool;
+    std::vector<CSerializeData*> vFree[nClasses];
+    size_t nPooledBytes;
+
+    static size_t SizeClass(size_t nBytes);
+    static size_t ClassCapacity(size_t nClass);
+
+public:
+    //! Total bytes kept cached across all classes before released buffers are freed.
+    static const size_t MAX_POOLED_BYTES = 32 * 1024 * 1024;
+
+    CBufferPool() : nPooledBytes(0) {}
+    ~CBufferPool();
+
+    //! Get an empty buffer with at least nSizeHint bytes reserved.
+    CSerializeData* Acquire(size_t nSizeHint);
+    //! Hand a buffer back; it is cached or freed depending on pool pressure.
+    void Release(CSerializeData* pbuf);
+};
+
+extern CBufferPool bufferPool;
 
 
 class CNetMessage {
@@ -238,6 +306,9 @@ public:
     CDataStream vRecv;              // received message data
     unsigned int nDataPos;
 
+    CHash256 hasher;                // hashes payload bytes incrementally as they arrive
+    uint256 data_hash;              // memoized SHA256d of the payload, null until finalized
+
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
     CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
@@ -263,6 +334,15 @@ public:
 
     int readHeader(const char *pch, unsigned int nBytes);
     int readData(const char *pch, unsigned int nBytes);
+
+    /** SHA256d of the complete payload. The bytes are fed to the hasher on
+     *  the socket thread as they come off the wire, so by the time the
+     *  message handler verifies the checksum of a multi-megabyte block only
+     *  the finalization round is left to compute. */
+    const uint256& GetMessageHash();
+
+    //! Hand the payload buffer back to the shared pool once the message is no longer needed.
+    void ReturnBuffer();
 };
 
 
@@ -279,8 +359,11 @@ public:
     CDataStream ssSend;
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
+    // complete wire messages queued for sending; the buffers are immutable
+    // and may be shared with the send queues of other peers
     uint64_t nSendBytes;
-    std::deque<CSerializeData> vSendMsg;
+    uint64_t nSendBytesPerClass[NUM_TRAFFIC_CLASSES];
+    std::deque<std::shared_ptr<const CSerializeData> > vSendMsg;
     CCriticalSection cs_vSend;
 
     std::deque<CInv> vRecvGetData;
@@ -319,6 +402,9 @@ public:
     // b) the peer may tell us in its version message that we should not relay tx invs
     //    until it has initialized its bloom filter.
     bool fRelayTxes;
+    // Whether the peer sent us sendcmpct asking for new blocks to be
+    // announced as cmpctblock instead of inv
+    bool fPreferCmpctBlocks;
     bool fSentAddr;
     CSemaphoreGrant grantOutbound;
     CCriticalSection cs_filter;
@@ -331,6 +417,11 @@ protected:
     // Key is IP address, value is banned-until-time
     static std::map<CSubNet, int64_t> setBanned;
     static CCriticalSection cs_setBanned;
+    // How many entries in setBanned cover more than a single host; when zero,
+    // IsBanned(CNetAddr) is a pure map lookup with no range scan
+    static int nRangedBans;
+    // Whether setBanned has changed since the last banlist.dat dump
+    static bool setBannedIsDirty;
 
     // Whitelisted ranges. Any node connecting from these is automatically
     // whitelisted (as well as those connecting to whitelisted binds).
@@ -364,6 +455,11 @@ public:
     // inventory based relay
     mruset<CInv> setInventoryKnown;
     std::vector<CInv> vInventoryToSend;
+    // Block announcements queue separately so they never wait on the
+    // transaction batching window
+    std::vector<CInv> vBlockInvToSend;
+    // Time (in usec) this peer's next batch of transaction invs goes out
+    int64_t nNextInvSend;
     CCriticalSection cs_inventory;
     std::set<uint256> setAskFor;
     std::multimap<int64_t, CInv> mapAskFor;
@@ -470,8 +566,12 @@ public:
     {
         {
             LOCK(cs_inventory);
-            if (!setInventoryKnown.count(inv))
+            if (setInventoryKnown.count(inv))
+                return;
+            if (inv.type == MSG_TX)
                 vInventoryToSend.push_back(inv);
+            else
+                vBlockInvToSend.push_back(inv);
         }
     }
 
@@ -488,6 +588,10 @@ public:
 
     void PushVersion();
 
+    /** Queue a pre-built wire message (header and payload) without copying it.
+     *  The same buffer may be queued to any number of peers; pszCommand is
+     *  only used for logging. */
+    void PushSharedMessage(const char* pszCommand, const std::shared_ptr<const CSerializeData>& msg);
 
     void PushMessage(const char* pszCommand)
     {
@@ -673,6 +777,11 @@ public:
     static bool Unban(const CNetAddr &ip);
     static bool Unban(const CSubNet &ip);
     static void GetBanned(std::map<CSubNet, int64_t> &banmap);
+    static void SetBanned(const std::map<CSubNet, int64_t> &banmap);
+    //! Drop entries whose ban time has passed
+    static void SweepBanned();
+    static bool BannedSetIsDirty();
+    static void SetBannedSetDirty(bool dirty = true);
 
     void copyStats(CNodeStats &stats, const std::vector<bool> &m_asmap);
 
@@ -693,15 +802,39 @@ class CTransaction;
 void RelayTransaction(const CTransaction& tx);
 void RelayTransaction(const CTransaction& tx, const CDataStream& ss);
 
-/** Access to the (IP) address database (peers.dat) */
+/** Serialize a complete wire message (header, length, checksum, payload) once,
+ *  for queueing to many peers by reference via CNode::PushSharedMessage(). */
+std::shared_ptr<const CSerializeData> BuildNetMessage(const char* pszCommand, const CDataStream& ssPayload);
+
+/** Access to the (IP) address database (peers.dat and its change journal) */
+class CAddrJournalEntry;
+
 class CAddrDB
 {
 private:
     boost::filesystem::path pathAddr;
+    boost::filesystem::path pathJournal;
 public:
     CAddrDB();
     bool Write(const CAddrMan& addr);
     bool Read(CAddrMan& addr);
+    //! Append a batch of journaled changes to peers.journal
+    bool AppendJournal(const std::vector<CAddrJournalEntry>& vEntries);
+    //! Read back all complete journal batches (a torn tail batch is ignored)
+    bool ReadJournal(std::vector<CAddrJournalEntry>& vEntries);
+    //! Remove the journal after its contents were folded into a full dump
+    void EraseJournal();
+};
+
+/** Access to the banned-peers database (banlist.dat) */
+class CBanDB
+{
+private:
+    boost::filesystem::path pathBanlist;
+public:
+    CBanDB();
+    bool Write(const std::map<CSubNet, int64_t>& banSet);
+    bool Read(std::map<CSubNet, int64_t>& banSet);
 };
 
 #endif // BITCOIN_NET_H
@@ -148,14 +148,29 @@ class CSubNet
         CSubNet();
         explicit CSubNet(const std::string &strSubnet, bool fAllowLookup = false);
 
+        //! Subnet covering exactly one host
+        explicit CSubNet(const CNetAddr &addr);
+
         bool Match(const CNetAddr &addr) const;
 
+        //! Whether the netmask selects a single address
+        bool IsSingleIP() const;
+
         std::string ToString() const;
         bool IsValid() const;
 
         friend bool operator==(const CSubNet& a, const CSubNet& b);
         friend bool operator!=(const CSubNet& a, const CSubNet& b);
         friend bool operator<(const CSubNet& a, const CSubNet& b);
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(network);
+            READWRITE(FLATDATA(netmask));
+            READWRITE(valid);
+        }
 };
 
 /** A combination of a network address (CNetAddr) and a (TCP) port */
@@ -0,0 +1,117 @@
+// Copyright (c) 2012-2014 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_OPENMAP_H
+#define BITCOIN_OPENMAP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+/** Fixed-capacity open-addressing map.
+ *
+ * All slots are allocated once up front, so steady-state operation does no
+ * allocations, and entries are placed by linear probing within a small window
+ * of their home bucket, so lookup and insert touch at most PROBE_WINDOW
+ * adjacent slots. Every insert carries a priority; when an entry's probe
+ * window has no free slot, the entry with the smallest priority in the window
+ * is overwritten. This approximates limitedmap's keep-the-highest-values
+ * policy per window instead of globally, in exchange for node-based maps'
+ * per-entry allocations and rebalancing.
+ *
+ * The hasher is expected to distribute keys uniformly; the bucket index is
+ * taken directly from its output.
+ */
+template <typename K, typename V, typename Hasher>
+class openmap
+{
+protected:
+    struct Slot {
+        K key;
+        V value;
+        int64_t nPriority;
+        bool fUsed;
+        Slot() : nPriority(0), fUsed(false) {}
+    };
+
+    std::vector<Slot> vSlots;
+    size_t nMask; // slot count - 1; the slot count is a power of two
+    size_t nUsed;
+    Hasher hasher;
+
+    static const size_t PROBE_WINDOW = 8;
+
+    size_t Bucket(const K& key) const { return hasher(key) & nMask; }
+
+public:
+    explicit openmap(size_t nCapacity)
+    {
+        size_t n = 1;
+        while (n < nCapacity)
+            n <<= 1;
+        vSlots.resize(n);
+        nMask = n - 1;
+        nUsed = 0;
+    }
+
+    size_t size() const { return nUsed; }
+    size_t capacity() const { return vSlots.size(); }
+
+    //! Pointer to the value stored for key, or NULL
+    V* find(const K& key)
+    {
+        size_t bucket = Bucket(key);
+        for (size_t i = 0; i < PROBE_WINDOW; i++) {
+            Slot& slot = vSlots[(bucket + i) & nMask];
+            if (slot.fUsed && slot.key == key)
+                return &slot.value;
+        }
+        return NULL;
+    }
+
+    //! Insert a key or overwrite its existing entry. When the probe window
+    //! is full the entry with the smallest priority is displaced.
+    void insert(const K& key, const V& value, int64_t nPriority)
+    {
+        size_t bucket = Bucket(key);
+        Slot* pTarget = NULL;
+        for (size_t i = 0; i < PROBE_WINDOW; i++) {
+            Slot& slot = vSlots[(bucket + i) & nMask];
+            if (slot.fUsed && slot.key == key) {
+                slot.value = value;
+                slot.nPriority = nPriority;
+                return;
+            }
+            if (!slot.fUsed) {
+                if (pTarget == NULL || pTarget->fUsed)
+                    pTarget = &slot; // the first free slot wins
+            } else if (pTarget == NULL ||
+                       (pTarget->fUsed && slot.nPriority < pTarget->nPriority))
+                pTarget = &slot;
+        }
+        if (!pTarget->fUsed)
+            nUsed++;
+        pTarget->key = key;
+        pTarget->value = value;
+        pTarget->nPriority = nPriority;
+        pTarget->fUsed = true;
+    }
+
+    //! Remove a key; the slot's value is reset so held resources are released
+    void erase(const K& key)
+    {
+        size_t bucket = Bucket(key);
+        for (size_t i = 0; i < PROBE_WINDOW; i++) {
+            Slot& slot = vSlots[(bucket + i) & nMask];
+            if (slot.fUsed && slot.key == key) {
+                slot.value = V();
+                slot.fUsed = false;
+                nUsed--;
+                return;
+            }
+        }
+    }
+};
+
+#endif // BITCOIN_OPENMAP_H
@@ -0,0 +1,156 @@
+#include "oraclesdb.h"
+
+#include "cc/CCinclude.h"
+#include "komodo_defs.h"
+#include "main.h"
+#include "primitives/block.h"
+#include "util.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include <map>
+#include <set>
+
+// Database layout:
+//   ('d', COracleDataKey)                      -> std::vector<uint8_t> sample data
+//   ('l', (oracletxid, batonaddr))             -> COracleLatestValue
+//
+// Data keys invert the height so an iterator seeked to the (oracle, baton)
+// prefix walks samples newest-first, which is the order oraclessamples
+// returns and what a pagination cursor resumes from.
+
+bool fOracleIndex = false;
+OraclesDB *poraclesdb = NULL;
+
+OraclesDB::OraclesDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "oracles", nCacheSize, fMemory, fWipe, false, 64) { }
+
+static const char DB_ORACLE_DATA = 'd';
+static const char DB_ORACLE_LATEST = 'l';
+
+//! Extract the (oracle, baton address, data) of one oracle data transaction,
+//! or return false if the transaction is not one.
+static bool GetTxOracleData(const CTransaction &tx, uint256 &oracletxid, std::string &batonaddr, std::vector<uint8_t> &data)
+{
+    uint256 batontxid; CPubKey pk; char destaddr[64];
+    if (tx.vout.size() < 2)
+        return false;
+    if (DecodeOraclesData(tx.vout.back().scriptPubKey, oracletxid, batontxid, pk, data) != 'D')
+        return false;
+    if (Getscriptaddress(destaddr, tx.vout[1].scriptPubKey) == 0)
+        return false;
+    batonaddr = destaddr;
+    return true;
+}
+
+void ConnectOracleIndex(const CBlock &block, int nHeight)
+{
+    CDBBatch batch = CDBBatch(*poraclesdb);
+    int nSamples = 0;
+    for (const CTransaction &tx : block.vtx) {
+        uint256 oracletxid; std::string batonaddr; std::vector<uint8_t> data;
+        if (!GetTxOracleData(tx, oracletxid, batonaddr, data))
+            continue;
+        batch.Write(std::make_pair(DB_ORACLE_DATA, COracleDataKey(oracletxid, batonaddr, nHeight, tx.GetHash())), data);
+
+        COracleLatestValue latest;
+        if (!poraclesdb->Read(std::make_pair(DB_ORACLE_LATEST, std::make_pair(oracletxid, batonaddr)), latest) ||
+            nHeight >= latest.blockHeight) {
+            latest.blockHeight = nHeight;
+            latest.txhash = tx.GetHash();
+            latest.data = data;
+            batch.Write(std::make_pair(DB_ORACLE_LATEST, std::make_pair(oracletxid, batonaddr)), latest);
+        }
+        nSamples++;
+    }
+    if (nSamples > 0) {
+        poraclesdb->WriteBatch(batch, true);
+        LogPrint("oracleindex", "%s: height %d, %d samples indexed\n", __func__, nHeight, nSamples);
+    }
+}
+
+void DisconnectOracleIndex(const CBlock &block, int nHeight)
+{
+    CDBBatch batch = CDBBatch(*poraclesdb);
+    std::map<std::pair<uint256, std::string>, std::set<uint256>> removed;
+    for (const CTransaction &tx : block.vtx) {
+        uint256 oracletxid; std::string batonaddr; std::vector<uint8_t> data;
+        if (!GetTxOracleData(tx, oracletxid, batonaddr, data))
+            continue;
+        batch.Erase(std::make_pair(DB_ORACLE_DATA, COracleDataKey(oracletxid, batonaddr, nHeight, tx.GetHash())));
+        removed[std::make_pair(oracletxid, batonaddr)].insert(tx.GetHash());
+    }
+    if (removed.empty())
+        return;
+
+    // restore the latest pointer per publisher from the newest surviving sample
+    for (std::map<std::pair<uint256, std::string>, std::set<uint256>>::const_iterator it = removed.begin(); it != removed.end(); it++) {
+        boost::scoped_ptr<CDBIterator> pcursor(poraclesdb->NewIterator());
+        pcursor->Seek(std::make_pair(DB_ORACLE_DATA, COracleDataIteratorKey(it->first.first, it->first.second)));
+        bool fFound = false;
+        while (pcursor->Valid()) {
+            std::pair<char, COracleDataKey> key;
+            if (!pcursor->GetKey(key) || key.first != DB_ORACLE_DATA ||
+                key.second.oracletxid != it->first.first || key.second.batonaddr != it->first.second)
+                break;
+            if (it->second.count(key.second.txhash) == 0) {
+                COracleLatestValue latest;
+                latest.blockHeight = key.second.blockHeight;
+                latest.txhash = key.second.txhash;
+                pcursor->GetValue(latest.data);
+                batch.Write(std::make_pair(DB_ORACLE_LATEST, it->first), latest);
+                fFound = true;
+                break;
+            }
+            pcursor->Next();
+        }
+        if (!fFound)
+            batch.Erase(std::make_pair(DB_ORACLE_LATEST, it->first));
+    }
+    poraclesdb->WriteBatch(batch, true);
+}
+
+bool GetOracleLatestData(const uint256 &oracletxid, const std::string &batonaddr, COracleLatestValue &latest)
+{
+    if (!fOracleIndex || poraclesdb == NULL)
+        return false;
+    return poraclesdb->Read(std::make_pair(DB_ORACLE_LATEST, std::make_pair(oracletxid, batonaddr)), latest);
+}
+
+bool ListOracleSamples(const uint256 &oracletxid, const std::string &batonaddr, int32_t num, const std::string &cursor,
+                       std::vector<std::pair<COracleDataKey, std::vector<uint8_t>>> &samples, std::string &nextcursor)
+{
+    nextcursor.clear();
+    if (!fOracleIndex || poraclesdb == NULL)
+        return false;
+
+    boost::scoped_ptr<CDBIterator> pcursor(poraclesdb->NewIterator());
+    if (cursor.empty()) {
+        pcursor->Seek(std::make_pair(DB_ORACLE_DATA, COracleDataIteratorKey(oracletxid, batonaddr)));
+    } else {
+        // cursors are "<height>-<txid>" naming the last sample already returned
+        size_t sep = cursor.find('-');
+        int32_t cursorheight = atoi(cursor.c_str());
+        uint256 cursortxid;
+        if (sep != std::string::npos)
+            cursortxid = Parseuint256((char *)cursor.substr(sep + 1).c_str());
+        pcursor->Seek(std::make_pair(DB_ORACLE_DATA, COracleDataKey(oracletxid, batonaddr, cursorheight, cursortxid)));
+        std::pair<char, COracleDataKey> key;
+        if (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ORACLE_DATA && key.second.txhash == cursortxid)
+            pcursor->Next();
+    }
+    while (pcursor->Valid()) {
+        std::pair<char, COracleDataKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ORACLE_DATA ||
+            key.second.oracletxid != oracletxid || key.second.batonaddr != batonaddr)
+            break;
+        if (num != 0 && (int32_t)samples.size() >= num) {
+            nextcursor = strprintf("%d-%s", samples.back().first.blockHeight, samples.back().first.txhash.GetHex());
+            break;
+        }
+        std::vector<uint8_t> data;
+        if (pcursor->GetValue(data))
+            samples.push_back(std::make_pair(key.second, data));
+        pcursor->Next();
+    }
+    return true;
+}
@@ -0,0 +1,157 @@
+#ifndef ORACLESDB_H
+#define ORACLESDB_H
+
+#include "dbwrapper.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <string>
+#include <vector>
+
+class CBlock;
+
+/** -oracleindex: maintain a per-oracle, per-baton-address, height-ordered
+ * index of oracle data transactions at block connect/disconnect so
+ * oraclessamples no longer walks and decodes the oracle's whole CC address
+ * history per query. */
+extern bool fOracleIndex;
+
+class OraclesDB : public CDBWrapper
+{
+public:
+    OraclesDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+};
+
+extern OraclesDB *poraclesdb;
+
+//! Key of one published oracle sample. Heights are stored inverted and
+//! big-endian so forward LevelDB iteration visits samples newest-first.
+struct COracleDataKey
+{
+    uint256 oracletxid;
+    std::string batonaddr;
+    int32_t blockHeight;
+    uint256 txhash;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 69 + batonaddr.size();
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        oracletxid.Serialize(s);
+        ::Serialize(s, batonaddr);
+        ser_writedata32be(s, 0x7fffffff - blockHeight);
+        txhash.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        oracletxid.Unserialize(s);
+        ::Unserialize(s, batonaddr);
+        blockHeight = 0x7fffffff - ser_readdata32be(s);
+        txhash.Unserialize(s);
+    }
+
+    COracleDataKey(uint256 oracle, const std::string &baton, int32_t height, uint256 txid) {
+        oracletxid = oracle;
+        batonaddr = baton;
+        blockHeight = height;
+        txhash = txid;
+    }
+
+    COracleDataKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        oracletxid.SetNull();
+        batonaddr.clear();
+        blockHeight = 0;
+        txhash.SetNull();
+    }
+};
+
+//! Seek target for iterating one publisher's samples; serializes as a
+//! prefix of COracleDataKey.
+struct COracleDataIteratorKey
+{
+    uint256 oracletxid;
+    std::string batonaddr;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 33 + batonaddr.size();
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        oracletxid.Serialize(s);
+        ::Serialize(s, batonaddr);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        oracletxid.Unserialize(s);
+        ::Unserialize(s, batonaddr);
+    }
+
+    COracleDataIteratorKey(uint256 oracle, const std::string &baton) {
+        oracletxid = oracle;
+        batonaddr = baton;
+    }
+};
+
+//! Newest sample per (oracle, baton address) so price consumers read one key.
+struct COracleLatestValue
+{
+    int32_t blockHeight;
+    uint256 txhash;
+    std::vector<uint8_t> data;
+
+    COracleLatestValue() : blockHeight(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(blockHeight);
+        READWRITE(txhash);
+        READWRITE(data);
+    }
+};
+
+/****
+ * Index all oracle data transactions in a connected block. Must be called
+ * once per connected block, in order.
+ * @param block the connected block
+ * @param nHeight its height
+ */
+void ConnectOracleIndex(const CBlock &block, int nHeight);
+
+/****
+ * Reverse ConnectOracleIndex for a disconnected block, restoring the
+ * previous latest sample per publisher from the remaining index entries.
+ * @param block the block being disconnected
+ * @param nHeight its height
+ */
+void DisconnectOracleIndex(const CBlock &block, int nHeight);
+
+/****
+ * Latest-value fast path: read the newest indexed sample for a publisher.
+ * @param oracletxid the oracle
+ * @param batonaddr the publisher's baton address
+ * @param[out] latest the newest sample
+ * @returns true if the index is enabled and a sample exists
+ */
+bool GetOracleLatestData(const uint256 &oracletxid, const std::string &batonaddr, COracleLatestValue &latest);
+
+/****
+ * List a publisher's samples newest-first with cursor pagination.
+ * @param oracletxid the oracle
+ * @param batonaddr the publisher's baton address
+ * @param num maximum samples to return (0 for all)
+ * @param cursor "" for the newest sample, or a cursor from a previous call
+ * @param[out] samples the page of (key, data) samples
+ * @param[out] nextcursor cursor resuming after this page, "" if exhausted
+ * @returns false if the index is disabled
+ */
+bool ListOracleSamples(const uint256 &oracletxid, const std::string &batonaddr, int32_t num, const std::string &cursor,
+                       std::vector<std::pair<COracleDataKey, std::vector<uint8_t>>> &samples, std::string &nextcursor);
+
+#endif /* ORACLESDB_H */
@@ -452,7 +452,7 @@ void CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
 }
 
 void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
-                                         std::vector<CTxMemPoolEntry>& entries, bool fCurrentEstimate)
+                                         std::vector<const CTxMemPoolEntry*>& entries, bool fCurrentEstimate)
 {
     if (nBlockHeight <= nBestSeenHeight) {
         // Ignore side chains and re-orgs; assuming they are random
@@ -499,7 +499,7 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
 
     // Repopulate the current block states
     for (unsigned int i = 0; i < entries.size(); i++)
-        processBlockTx(nBlockHeight, entries[i]);
+        processBlockTx(nBlockHeight, *entries[i]);
 
     // Update all exponential averages with the current block states
     feeStats.UpdateMovingAverages();
@@ -26,7 +26,9 @@
 #include "chainparams.h"
 #include "crypto/equihash.h"
 #include "primitives/block.h"
+#include "random.h"
 #include "streams.h"
+#include "sync.h"
 #include "uint256.h"
 #include "util.h"
 #include "komodo.h"
@@ -36,6 +38,10 @@
 
 #include "sodium.h"
 
+#include <deque>
+#include <map>
+#include <set>
+
 #ifdef ENABLE_RUST
 #include "librustzcash.h"
 #endif // ENABLE_RUST
@@ -295,6 +301,17 @@ arith_uint256 zawy_TSA_EMA(int32_t height,int32_t tipdiff,arith_uint256 prevTarg
     return(bnTarget);
 }
 
+// The non-adaptive retarget depends only on pindexLast's trailing window, so
+// the result can be reused across getblocktemplate calls and every candidate
+// header building on the same parent instead of re-walking the averaging
+// window each time. Adaptive-PoW chains fold the candidate block time into
+// the target and bypass the cache. Index entries are never freed at runtime,
+// so keying on the pointer is safe.
+#define NEXTWORK_CACHE_SIZE 64
+static CCriticalSection cs_nextworkCache;
+static std::map<const CBlockIndex*,unsigned int> mapNextWorkCache;
+static std::deque<const CBlockIndex*> nextworkCacheOrder; // FIFO eviction
+
 unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params& params)
 {
     arith_uint256 bnLimit;
@@ -307,6 +324,15 @@ unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHead
     if (pindexLast == NULL )
         return nProofOfWorkLimit;
 
+    bool fCacheable = (ASSETCHAINS_ADAPTIVEPOW <= 0);
+    if ( fCacheable )
+    {
+        LOCK(cs_nextworkCache);
+        std::map<const CBlockIndex*,unsigned int>::iterator it = mapNextWorkCache.find(pindexLast);
+        if ( it != mapNextWorkCache.end() )
+            return it->second;
+    }
+
     //{
         // Comparing to pindexLast->nHeight with >= because this function
         // returns the work required for the block after pindexLast.
@@ -498,6 +524,19 @@ unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHead
         nbits = bnTarget.GetCompact();
         nbits = (nbits & 0xfffffffc) | zawyflag;
     }
+    if ( fCacheable )
+    {
+        LOCK(cs_nextworkCache);
+        if ( mapNextWorkCache.insert(std::make_pair(pindexLast,nbits)).second )
+        {
+            nextworkCacheOrder.push_back(pindexLast);
+            while ( nextworkCacheOrder.size() > NEXTWORK_CACHE_SIZE )
+            {
+                mapNextWorkCache.erase(nextworkCacheOrder.front());
+                nextworkCacheOrder.pop_front();
+            }
+        }
+    }
     return(nbits);
 }
 
@@ -550,12 +589,49 @@ unsigned int CalculateNextWorkRequired(arith_uint256 bnAvg,
     return bnNew.GetCompact();
 }
 
+/**
+ * Verified Equihash solutions, keyed by block hash. The same header is
+ * checked from several paths (AcceptBlockHeader, CheckBlock, komodo_checkPOW,
+ * VerifyDB), and the block hash commits to nonce and solution, so a hit means
+ * the exact solution already passed the expansion. Only valid solutions are
+ * memoized; failures stay uncached so they cannot crowd out honest entries.
+ */
+static CCriticalSection cs_equihashCache;
+static std::set<uint256> setVerifiedEquihash;
+
+static bool EquihashCacheContains(const uint256& hash)
+{
+    LOCK(cs_equihashCache);
+    return setVerifiedEquihash.count(hash) != 0;
+}
+
+static void EquihashCacheInsert(const uint256& hash)
+{
+    // 32 bytes per entry; this bound covers a long header burst for ~1MB.
+    static const size_t nMaxCacheSize = 20000;
+
+    LOCK(cs_equihashCache);
+
+    while (setVerifiedEquihash.size() >= nMaxCacheSize)
+    {
+        // Evict a random entry so an attacker cannot target what stays cached.
+        std::set<uint256>::iterator it = setVerifiedEquihash.lower_bound(GetRandHash());
+        if (it == setVerifiedEquihash.end())
+            it = setVerifiedEquihash.begin();
+        setVerifiedEquihash.erase(it);
+    }
+
+    setVerifiedEquihash.insert(hash);
+}
+
 bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams& params)
 {
     if (ASSETCHAINS_ALGO != ASSETCHAINS_EQUIHASH)
         return true;
-    
-    if ( ASSETCHAINS_NK[0] != 0 && ASSETCHAINS_NK[1] != 0 && pblock->GetHash().ToString() == "027e3758c3a65b12aa1046462b486d0a63bfa1beae327897f56c5cfb7daaae71" )
+
+    const uint256 hash = pblock->GetHash();
+
+    if ( ASSETCHAINS_NK[0] != 0 && ASSETCHAINS_NK[1] != 0 && hash.ToString() == "027e3758c3a65b12aa1046462b486d0a63bfa1beae327897f56c5cfb7daaae71" )
         return true;
 
     unsigned int n = params.EquihashN();
@@ -563,9 +639,9 @@ bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams& param
 
     if ( Params().NetworkIDString() == "regtest" )
         return(true);
-    // Hash state
-    crypto_generichash_blake2b_state state;
-    EhInitialiseState(n, k, state);
+
+    if (EquihashCacheContains(hash))
+        return true;
 
     // I = the block header minus nonce and solution.
     CEquihashInput I{*pblock};
@@ -574,15 +650,14 @@ bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams& param
     ss << I;
     ss << pblock->nNonce;
 
-    // H(I||V||...
-    crypto_generichash_blake2b_update(&state, (unsigned char*)&ss[0], ss.size());
-
+    // H(I||V||...) per index, batched through the midstate-based hasher.
     bool isValid;
-    EhIsValidSolution(n, k, state, pblock->nSolution, isValid);
+    EhIsValidSolutionBatch(n, k, (unsigned char*)&ss[0], ss.size(), pblock->nSolution, isValid);
 
     if (!isValid)
         return error("CheckEquihashSolution(): invalid solution");
 
+    EquihashCacheInsert(hash);
     return true;
 }
 
@@ -267,6 +267,15 @@ public:
         return *this;
     }
 
+    prevector(prevector<N, T, Size, Diff>&& other) noexcept : _size(0) {
+        swap(other);
+    }
+
+    prevector& operator=(prevector<N, T, Size, Diff>&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
     size_type size() const {
         return is_direct() ? _size : _size - N - 1;
     }
@@ -87,15 +87,21 @@ uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves,
     bool mutated = false;
     for (int nSize = leaves.size(); nSize > 1; nSize = (nSize + 1) / 2)
     {
-        for (int i = 0; i < nSize; i += 2)
-        {
-            int i2 = std::min(i+1, nSize-1);
-            if (i2 == i + 1 && i2 + 1 == nSize && vMerkleTree[j+i] == vMerkleTree[j+i2]) {
-                // Two identical hashes at the end of the list at a particular level.
-                mutated = true;
-            }
-            vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j+i]),  END(vMerkleTree[j+i]),
-                                       BEGIN(vMerkleTree[j+i2]), END(vMerkleTree[j+i2])));
+        // Two identical hashes at the end of the list at a particular level.
+        if ((nSize & 1) == 0 && vMerkleTree[j+nSize-2] == vMerkleTree[j+nSize-1])
+            mutated = true;
+        // A level's nodes are stored contiguously, so the even pairs form one
+        // contiguous run of 64-byte double-SHA256 inputs; hash them in bulk
+        // through the (possibly SIMD-parallel) SHA256D64 path.
+        int nPairs = nSize / 2;
+        size_t nLevel = vMerkleTree.size();
+        vMerkleTree.resize(nLevel + (nSize + 1) / 2);
+        if (nPairs > 0)
+            SHA256D64(vMerkleTree[nLevel].begin(), vMerkleTree[j].begin(), nPairs);
+        if (nSize & 1) {
+            // Odd node count: the last node is paired with itself.
+            vMerkleTree[nLevel + nPairs] = Hash(BEGIN(vMerkleTree[j+nSize-1]), END(vMerkleTree[j+nSize-1]),
+                                                BEGIN(vMerkleTree[j+nSize-1]), END(vMerkleTree[j+nSize-1]));
         }
         j += nSize;
     }
@@ -113,6 +119,48 @@ uint256 CBlock::BuildMerkleTree(bool* fMutated) const
     return ::BuildMerkleTree(fMutated, leaves, vMerkleTree);
 }
 
+//! Expected node count of a vMerkleTree built over nLeaves leaves.
+static int MerkleTreeNodeCount(int nLeaves)
+{
+    int nCount = 0;
+    for (int nSize = nLeaves; nSize > 1; nSize = (nSize + 1) / 2)
+        nCount += nSize;
+    return nCount + (nLeaves > 0 ? 1 : 0);
+}
+
+uint256 UpdateMerkleLeaf(int nIndex, const uint256 &leaf, int nLeaves, std::vector<uint256> &vMerkleTree)
+{
+    assert(nIndex >= 0 && nIndex < nLeaves);
+    vMerkleTree[nIndex] = leaf;
+    int j = 0;
+    int i = nIndex;
+    for (int nSize = nLeaves; nSize > 1; nSize = (nSize + 1) / 2)
+    {
+        // Recompute only the parent of the changed node; siblings on the path
+        // are untouched. The left child is at the even slot, and an odd-count
+        // level pairs its last node with itself, exactly as in the full build.
+        int nLeft = i & ~1;
+        int nRight = std::min(nLeft + 1, nSize - 1);
+        uint256 parent = Hash(BEGIN(vMerkleTree[j+nLeft]), END(vMerkleTree[j+nLeft]),
+                              BEGIN(vMerkleTree[j+nRight]), END(vMerkleTree[j+nRight]));
+        j += nSize;
+        i >>= 1;
+        vMerkleTree[j+i] = parent;
+    }
+    return vMerkleTree.back();
+}
+
+uint256 CBlock::UpdateCoinbaseMerkleRoot() const
+{
+    // Extranonce rolls change only vtx[0]; when this block object already has
+    // a tree cached for the same transaction count, refresh the coinbase path
+    // in O(log n) hashes instead of rebuilding all interior nodes. Mutation
+    // detection is irrelevant here: the block is our own template.
+    if (vtx.empty() || (int)vMerkleTree.size() != MerkleTreeNodeCount(vtx.size()))
+        return BuildMerkleTree();
+    return UpdateMerkleLeaf(0, vtx[0].GetHash(), vtx.size(), vMerkleTree);
+}
+
 
 std::vector<uint256> GetMerkleBranch(int nIndex, int nLeaves, const std::vector<uint256> &vMerkleTree)
 {
@@ -193,6 +193,11 @@ public:
     // merkle root).
     uint256 BuildMerkleTree(bool* mutated = NULL) const;
 
+    // Refresh the cached merkle tree after a coinbase-only change (extranonce
+    // roll) and return the new root, touching just the coinbase path. Falls
+    // back to a full BuildMerkleTree when no tree is cached for this block.
+    uint256 UpdateCoinbaseMerkleRoot() const;
+
     std::vector<uint256> GetMerkleBranch(int nIndex) const;
     static uint256 CheckMerkleBranch(uint256 hash, const std::vector<uint256>& vMerkleBranch, int nIndex);
     std::string ToString() const;
@@ -204,6 +209,8 @@ uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves,
 
 std::vector<uint256> GetMerkleBranch(int nIndex, int nLeaves, const std::vector<uint256> &vMerkleTree);
 
+uint256 UpdateMerkleLeaf(int nIndex, const uint256 &leaf, int nLeaves, std::vector<uint256> &vMerkleTree);
+
 
 /**
  * Custom serializer for CBlockHeader that omits the nonce and solution, for use
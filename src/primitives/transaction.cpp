@@ -35,7 +35,8 @@ JSDescription::JSDescription(
     CAmount vpub_old,
     CAmount vpub_new,
     bool computeProof,
-    uint256 *esk // payment disclosure
+    uint256 *esk, // payment disclosure
+    ZCSproutDeferredProof *out_deferred
 ) : vpub_old(vpub_old), vpub_new(vpub_new), anchor(anchor)
 {
     std::array<libzcash::SproutNote, ZC_NUM_JS_OUTPUTS> notes;
@@ -55,7 +56,8 @@ JSDescription::JSDescription(
         vpub_new,
         anchor,
         computeProof,
-        esk // payment disclosure
+        esk, // payment disclosure
+        out_deferred
     );
 }
 
@@ -71,7 +73,8 @@ JSDescription JSDescription::Randomized(
     CAmount vpub_new,
     bool computeProof,
     uint256 *esk, // payment disclosure
-    std::function<int(int)> gen
+    std::function<int(int)> gen,
+    ZCSproutDeferredProof *out_deferred
 )
 {
     // Randomize the order of the inputs and outputs
@@ -86,7 +89,8 @@ JSDescription JSDescription::Randomized(
     return JSDescription(
         params, joinSplitPubKey, anchor, inputs, outputs,
         vpub_old, vpub_new, computeProof,
-        esk // payment disclosure
+        esk, // payment disclosure
+        out_deferred
     );
 }
 
@@ -116,6 +120,25 @@ public:
     {
         uint256 h_sig = params.h_sig(jsdesc.randomSeed, jsdesc.nullifiers, joinSplitPubKey);
 
+        if (verifier.BatchingEnabled()) {
+            libzcash::SproutProofStatement statement;
+            std::copy(proof.begin(), proof.end(), statement.proof.begin());
+            statement.anchor = jsdesc.anchor;
+            statement.h_sig = h_sig;
+            statement.mac1 = jsdesc.macs[0];
+            statement.mac2 = jsdesc.macs[1];
+            statement.nullifier1 = jsdesc.nullifiers[0];
+            statement.nullifier2 = jsdesc.nullifiers[1];
+            statement.commitment1 = jsdesc.commitments[0];
+            statement.commitment2 = jsdesc.commitments[1];
+            statement.vpub_old = jsdesc.vpub_old;
+            statement.vpub_new = jsdesc.vpub_new;
+            verifier.QueueSproutProof(statement);
+            // Provisionally valid; ProofVerifier::VerifyBatch() delivers
+            // the real verdict for the whole queue.
+            return true;
+        }
+
         return librustzcash_sprout_verify(
             proof.begin(),
             jsdesc.anchor.begin(),
@@ -259,7 +259,8 @@ public:
             CAmount vpub_old,
             CAmount vpub_new,
             bool computeProof = true, // Set to false in some tests
-            uint256 *esk = nullptr // payment disclosure
+            uint256 *esk = nullptr, // payment disclosure
+            ZCSproutDeferredProof *out_deferred = nullptr // capture proof inputs for later proving
     );
 
     static JSDescription Randomized(
@@ -274,7 +275,8 @@ public:
             CAmount vpub_new,
             bool computeProof = true, // Set to false in some tests
             uint256 *esk = nullptr, // payment disclosure
-            std::function<int(int)> gen = GetRandInt
+            std::function<int(int)> gen = GetRandInt,
+            ZCSproutDeferredProof *out_deferred = nullptr // capture proof inputs for later proving
     );
 
     // Verifies that the JoinSplit proof is correct.
@@ -382,10 +384,15 @@ class SaplingOutPoint : public BaseOutPoint
 {
 public:
     SaplingOutPoint() : BaseOutPoint() {};
-    SaplingOutPoint(uint256 hashIn, uint32_t nIn) : BaseOutPoint(hashIn, nIn) {}; 
+    SaplingOutPoint(uint256 hashIn, uint32_t nIn) : BaseOutPoint(hashIn, nIn) {};
     std::string ToString() const;
 };
 
+/** Outpoints are a raw hash followed by a padding-free little-endian index,
+ *  identical to their serialized form. */
+template <> struct CMemcpySerialize<COutPoint> : std::true_type {};
+template <> struct CMemcpySerialize<SaplingOutPoint> : std::true_type {};
+
 /** An input of a transaction.  It contains the location of the previous
  * transaction's output that it claims and a signature that matches the
  * output's public key.
@@ -21,6 +21,8 @@
 #include "main.h"
 #include "protocol.h"
 
+#include "crypto/siphash.h"
+
 #include "util.h"
 #include "utilstrencodings.h"
 
@@ -33,7 +35,8 @@ static const char* ppszTypeName[] =
     "ERROR",
     "tx",
     "block",
-    "filtered block"
+    "filtered block",
+    "compact block"
 };
 
 CMessageHeader::CMessageHeader(const MessageStartChars& pchMessageStartIn)
@@ -58,6 +61,15 @@ std::string CMessageHeader::GetCommand() const
     return std::string(pchCommand, pchCommand + strnlen(pchCommand, COMMAND_SIZE));
 }
 
+unsigned int FastMessageChecksum(const CMessageHeader::MessageStartChars& pchMessageStart, const unsigned char* pdata, size_t nSize)
+{
+    uint64_t k0 = 0;
+    memcpy(&k0, pchMessageStart, MESSAGE_START_SIZE);
+    k0 |= k0 << 32;
+    uint64_t nHash = CSipHasher(k0, 0x636b736d74736166ULL).Write(pdata, nSize).Finalize();
+    return (unsigned int)(nHash & 0xffffffffULL);
+}
+
 bool CMessageHeader::IsValid(const MessageStartChars& pchMessageStartIn) const
 {
     // Check start string
@@ -140,6 +152,11 @@ bool operator<(const CInv& a, const CInv& b)
     return (a.type < b.type || (a.type == b.type && a.hash < b.hash));
 }
 
+bool operator==(const CInv& a, const CInv& b)
+{
+    return (a.type == b.type && a.hash == b.hash);
+}
+
 bool CInv::IsKnownType() const
 {
     return (type >= 1 && type < (int)ARRAYLEN(ppszTypeName));
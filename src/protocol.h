@@ -80,6 +80,15 @@ public:
     unsigned int nChecksum;
 };
 
+/**
+ * SipHash-based message checksum, used instead of SHA256d between
+ * whitelisted peers that negotiated FAST_CHECKSUM_VERSION (see
+ * ProcessMessages and CNode::EndMessage). Keyed with the network magic so
+ * checksums from different chains cannot be confused; it is an integrity
+ * check for already-trusted links, not a MAC.
+ */
+unsigned int FastMessageChecksum(const CMessageHeader::MessageStartChars& pchMessageStart, const unsigned char* pdata, size_t nSize);
+
 /** nServices flags */
 enum {
     // NODE_NETWORK means that the node is capable of serving the block chain. It is currently
@@ -94,6 +103,9 @@ enum {
     NODE_NSPV = (1 << 30),
     NODE_ADDRINDEX = (1 << 29),
     NODE_SPENTINDEX = (1 << 28),
+    // NODE_COMPACT_BLOCKS means the node understands the sendcmpct/cmpctblock/
+    // getblocktxn/blocktxn messages for BIP152-style block relay
+    NODE_COMPACT_BLOCKS = (1 << 27),
 
     // Bits 24-31 are reserved for temporary experiments. Just pick a bit that
     // isn't getting used, or one not being used much, and notify the
@@ -156,6 +168,7 @@ public:
     }
 
     friend bool operator<(const CInv& a, const CInv& b);
+    friend bool operator==(const CInv& a, const CInv& b);
 
     bool IsKnownType() const;
     const char* GetCommand() const;
@@ -167,12 +180,19 @@ public:
     uint256 hash;
 };
 
+/** A CInv is a padding-free int followed by a raw hash, matching its
+ *  serialized form, so inv/getdata payloads can be block-copied. */
+template <> struct CMemcpySerialize<CInv> : std::true_type {};
+
 enum {
     MSG_TX = 1,
     MSG_BLOCK,
     // Nodes may always request a MSG_FILTERED_BLOCK in a getdata, however,
     // MSG_FILTERED_BLOCK should not appear in any invs except as a part of getdata.
     MSG_FILTERED_BLOCK,
+    // Like MSG_FILTERED_BLOCK, MSG_CMPCT_BLOCK is only valid in getdata;
+    // the response is a cmpctblock message (header + short txids)
+    MSG_CMPCT_BLOCK,
 };
 
 #endif // BITCOIN_PROTOCOL_H
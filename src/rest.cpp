@@ -22,6 +22,8 @@
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "main.h"
+#include "net.h"
+#include "komodo_defs.h"
 #include "httpserver.h"
 #include "rpc/server.h"
 #include "streams.h"
@@ -408,6 +410,71 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+/** Status byte returned by /rest/submittx. The reply is always exactly
+ *  33 bytes: one status byte followed by the 32-byte txid (all-zero when
+ *  the transaction could not even be deserialized), so latency-sensitive
+ *  submitters can post raw serialized bytes and parse the result without
+ *  any hex or JSON round trip. */
+enum SubmitTxStatus {
+    SUBMITTX_ACCEPTED = 0,
+    SUBMITTX_IN_MEMPOOL = 1,
+    SUBMITTX_IN_CHAIN = 2,
+    SUBMITTX_MISSING_INPUTS = 3,
+    SUBMITTX_REJECTED = 4,
+    SUBMITTX_DECODE_FAILED = 5,
+};
+
+static bool rest_submittx(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    if (req->GetRequestMethod() != HTTPRequest::POST)
+        return RESTERR(req, HTTP_BAD_METHOD, "only POST is allowed");
+    if ( !KOMODO_NSPV_FULLNODE )
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "not available in nSPV mode");
+
+    std::string strBody = req->ReadBody();
+    if (strBody.empty())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Error: empty request");
+
+    unsigned char status = SUBMITTX_ACCEPTED;
+    uint256 hashTx;
+    CTransaction tx;
+    try {
+        CDataStream ssTx(strBody.data(), strBody.data() + strBody.size(), SER_NETWORK, PROTOCOL_VERSION);
+        ssTx >> tx;
+    } catch (const std::exception&) {
+        status = SUBMITTX_DECODE_FAILED;
+    }
+
+    if (status != SUBMITTX_DECODE_FAILED) {
+        hashTx = tx.GetHash();
+        {
+            LOCK(cs_main);
+            const CCoins* existingCoins = pcoinsTip->AccessCoins(hashTx);
+            if (mempool.exists(hashTx))
+                status = SUBMITTX_IN_MEMPOOL;
+            else if (existingCoins && existingCoins->nHeight < 1000000000)
+                status = SUBMITTX_IN_CHAIN;
+            else {
+                CValidationState state;
+                bool fMissingInputs = false;
+                if (!AcceptToMemoryPool(mempool, state, tx, false, &fMissingInputs, true))
+                    status = fMissingInputs ? SUBMITTX_MISSING_INPUTS : SUBMITTX_REJECTED;
+            }
+        }
+        if (status == SUBMITTX_ACCEPTED || status == SUBMITTX_IN_MEMPOOL)
+            RelayTransaction(tx);
+    }
+
+    CDataStream ssResp(SER_NETWORK, PROTOCOL_VERSION);
+    ssResp << status << hashTx;
+
+    req->WriteHeader("Content-Type", "application/octet-stream");
+    req->WriteReply(HTTP_OK, ssResp.str());
+    return true;
+}
+
 static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -616,6 +683,7 @@ static const struct {
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/submittx", rest_submittx},
 };
 
 bool StartREST()
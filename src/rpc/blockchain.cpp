@@ -26,6 +26,7 @@
 #include "Gulden/auto_checkpoints.h"
 #include "crosschain.h"
 #include "base58.h"
+#include "blockfilter.h"
 #include "consensus/validation.h"
 #include "cc/eval.h"
 #include "main.h"
@@ -33,6 +34,7 @@
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
+#include "txdb.h"
 #include "util.h"
 #include "script/script.h"
 #include "script/script_error.h"
@@ -325,12 +327,12 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
         {
             UniValue objTx(UniValue::VOBJ);
             TxToJSON(tx, uint256(), objTx);
-            txs.push_back(objTx);
+            txs.push_back(std::move(objTx));
         }
         else
             txs.push_back(tx.GetHash().GetHex());
     }
-    result.push_back(Pair("tx", txs));
+    result.push_back(Pair("tx", std::move(txs)));
     result.push_back(Pair("time", block.GetBlockTime()));
     result.push_back(Pair("nonce", block.nNonce.GetHex()));
     result.push_back(Pair("solution", HexStr(block.nSolution)));
@@ -367,6 +369,11 @@ UniValue getblockcount(const UniValue& params, bool fHelp, const CPubKey& mypk)
             + HelpExampleRpc("getblockcount", "")
         );
 
+    // served from the published tip snapshot, no cs_main needed
+    CBlockIndex* tip = pindexPublishedTip.load();
+    if (tip)
+        return tip->nHeight;
+
     LOCK(cs_main);
     return chainActive.Height();
 }
@@ -384,6 +391,10 @@ UniValue getbestblockhash(const UniValue& params, bool fHelp, const CPubKey& myp
             + HelpExampleRpc("getbestblockhash", "")
         );
 
+    CBlockIndex* tip = pindexPublishedTip.load();
+    if (tip)
+        return tip->GetBlockHash().GetHex();
+
     LOCK(cs_main);
     return chainActive.Tip()->GetBlockHash().GetHex();
 }
@@ -401,6 +412,12 @@ UniValue getdifficulty(const UniValue& params, bool fHelp, const CPubKey& mypk)
             + HelpExampleRpc("getdifficulty", "")
         );
 
+    // the tip's pprev ancestry is immutable, so the difficulty calculation
+    // can walk it from the published tip without cs_main
+    CBlockIndex* tip = pindexPublishedTip.load();
+    if (tip)
+        return GetNetworkDifficulty(tip);
+
     LOCK(cs_main);
     return GetNetworkDifficulty();
 }
@@ -451,26 +468,26 @@ bool mytxid_inmempool(uint256 txid)
 
 UniValue mempoolToJSON(bool fVerbose = false)
 {
+    // Serialize from an immutable snapshot instead of the live pool, so a
+    // large mempool scrape never holds mempool.cs against AcceptToMemoryPool
+    CTxMemPoolSnapshotRef snap = mempool.GetSnapshot();
     if (fVerbose)
     {
-        LOCK(mempool.cs);
+        int nCurrentHeight = chainActive.Height();
         UniValue o(UniValue::VOBJ);
-        BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
+        BOOST_FOREACH(const CTxMemPoolSnapshotEntry& e, snap->vEntries)
         {
-            const uint256& hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
-            info.push_back(Pair("size", (int)e.GetTxSize()));
-            info.push_back(Pair("fee", ValueFromAmount(e.GetFee())));
-            info.push_back(Pair("time", e.GetTime()));
-            info.push_back(Pair("height", (int)e.GetHeight()));
-            info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
-            info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
-            const CTransaction& tx = e.GetTx();
+            info.push_back(Pair("size", (int)e.nTxSize));
+            info.push_back(Pair("fee", ValueFromAmount(e.nFee)));
+            info.push_back(Pair("time", e.nTime));
+            info.push_back(Pair("height", (int)e.nHeight));
+            info.push_back(Pair("startingpriority", e.dPriority));
+            info.push_back(Pair("currentpriority", e.dPriority + (nCurrentHeight - (int)e.nHeight) * e.dPriorityPerHeight));
             set<string> setDepends;
-            BOOST_FOREACH(const CTxIn& txin, tx.vin)
+            BOOST_FOREACH(const uint256& dep, e.vDepends)
             {
-                if (mempool.exists(txin.prevout.hash))
-                    setDepends.insert(txin.prevout.hash.ToString());
+                setDepends.insert(dep.ToString());
             }
 
             UniValue depends(UniValue::VARR);
@@ -479,19 +496,16 @@ UniValue mempoolToJSON(bool fVerbose = false)
                 depends.push_back(dep);
             }
 
-            info.push_back(Pair("depends", depends));
-            o.push_back(Pair(hash.ToString(), info));
+            info.push_back(Pair("depends", std::move(depends)));
+            o.push_back(Pair(e.hash.ToString(), std::move(info)));
         }
         return o;
     }
     else
     {
-        vector<uint256> vtxid;
-        mempool.queryHashes(vtxid);
-
         UniValue a(UniValue::VARR);
-        BOOST_FOREACH(const uint256& hash, vtxid)
-            a.push_back(hash.ToString());
+        BOOST_FOREACH(const CTxMemPoolSnapshotEntry& e, snap->vEntries)
+            a.push_back(e.hash.ToString());
 
         return a;
     }
@@ -529,7 +543,8 @@ UniValue getrawmempool(const UniValue& params, bool fHelp, const CPubKey& mypk)
             + HelpExampleRpc("getrawmempool", "true")
         );
 
-    LOCK(cs_main);
+    // No cs_main: the snapshot is self-contained and chainActive.Height()
+    // (for currentpriority) is an atomic-enough read of the tip height
 
     bool fVerbose = false;
     if (params.size() > 0)
@@ -680,9 +695,19 @@ UniValue getblockhash(const UniValue& params, bool fHelp, const CPubKey& mypk)
             + HelpExampleRpc("getblockhash", "1000")
         );
 
+    int nHeight = params[0].get_int();
+
+    // GetAncestor only follows the immutable pprev/pskip links, so the
+    // active chain as of the published tip can be indexed without cs_main
+    CBlockIndex* tip = pindexPublishedTip.load();
+    if (tip) {
+        if (nHeight < 0 || nHeight > tip->nHeight)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        return tip->GetAncestor(nHeight)->GetBlockHash().GetHex();
+    }
+
     LOCK(cs_main);
 
-    int nHeight = params[0].get_int();
     if (nHeight < 0 || nHeight > chainActive.Height())
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
 
@@ -827,6 +852,43 @@ UniValue getblockheader(const UniValue& params, bool fHelp, const CPubKey& mypk)
     }
 }
 
+UniValue getblockfilter(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getblockfilter \"blockhash\"\n"
+            "\nRetrieve the compact filter for a block. Requires -blockfilterindex.\n"
+            "\nArguments:\n"
+            "1. \"blockhash\"     (string, required) The block hash\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"hex\",  (string) the hex-encoded Golomb-coded filter data\n"
+            "  \"hash\" : \"hash\"    (string) the double-SHA256 hash of the filter data\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+        );
+
+    uint256 hash(uint256S(params[0].get_str()));
+
+    {
+        LOCK(cs_main);
+        if (mapBlockIndex.count(hash) == 0)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    }
+
+    std::vector<unsigned char> vchFilter;
+    if (!GetBlockFilter(hash, vchFilter))
+        throw JSONRPCError(RPC_MISC_ERROR, "No filter available for block (is -blockfilterindex enabled?)");
+
+    CBlockFilter filter(hash, vchFilter);
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("filter", HexStr(vchFilter.begin(), vchFilter.end())));
+    result.push_back(Pair("hash", filter.GetHash().GetHex()));
+    return result;
+}
+
 UniValue getblock(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
@@ -963,7 +1025,9 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp, const CPubKey& mypk
         throw runtime_error(
             "gettxoutsetinfo\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Served from incrementally maintained statistics when available; the\n"
+            "first call on a pre-existing chainstate scans the whole database to\n"
+            "seed them, which may take some time.\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
@@ -971,7 +1035,8 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp, const CPubKey& mypk
             "  \"transactions\": n,      (numeric) The number of transactions\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
             "  \"bytes_serialized\": n,  (numeric) The serialized size\n"
-            "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
+            "  \"hash_rolling\": \"hash\",      (string) rolling set hash, comparable across nodes at the same height\n"
+            "  \"hash_serialized\": \"hash\",   (string) The serialized hash (only when a full scan was performed)\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
             "\nExamples:\n"
@@ -981,8 +1046,26 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp, const CPubKey& mypk
 
     UniValue ret(UniValue::VOBJ);
 
-    CCoinsStats stats;
     FlushStateToDisk();
+
+    CCoinsSetStats incstats;
+    if (pcoinsdbview->GetSetStats(incstats)) {
+        LOCK(cs_main);
+        uint256 hashBlock = pcoinsdbview->GetBestBlock();
+        BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+        ret.push_back(Pair("height", mi != mapBlockIndex.end() ? (int64_t)mi->second->nHeight : (int64_t)-1));
+        ret.push_back(Pair("bestblock", hashBlock.GetHex()));
+        ret.push_back(Pair("transactions", (int64_t)incstats.nTransactions));
+        ret.push_back(Pair("txouts", (int64_t)incstats.nTransactionOutputs));
+        ret.push_back(Pair("bytes_serialized", (int64_t)incstats.nSerializedSize));
+        ret.push_back(Pair("hash_rolling", incstats.hashRolling.GetHex()));
+        ret.push_back(Pair("total_amount", ValueFromAmount(incstats.nTotalAmount)));
+        return ret;
+    }
+
+    // First call on a chainstate that predates the incremental statistics:
+    // do the full scan once, which also seeds them.
+    CCoinsStats stats;
     if (pcoinsTip->GetStats(stats)) {
         ret.push_back(Pair("height", (int64_t)stats.nHeight));
         ret.push_back(Pair("bestblock", stats.hashBlock.GetHex()));
@@ -996,6 +1079,116 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp, const CPubKey& mypk
 }
 
 
+UniValue dumpchainstate(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "dumpchainstate \"filename\"\n"
+            "\nWrites the whole chainstate (UTXO set, anchors, nullifiers) and block index to a\n"
+            "snapshot file committed to by a single content hash. A new node can bootstrap from\n"
+            "the file with -loadsnapshot=<filename>, verifying it against the published content\n"
+            "hash instead of replaying every block. Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"filename\"    (string, required) absolute path, or a path relative to the data directory\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filename\": \"xxxx\",     (string) full path of the snapshot file\n"
+            "  \"contenthash\": \"xxxx\",  (string) hash committing to the snapshot contents\n"
+            "  \"bestblock\": \"xxxx\",    (string) hash of the block the snapshot represents\n"
+            "  \"height\": n,            (numeric) height of that block\n"
+            "  \"records\": n            (numeric) number of database records written\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumpchainstate", "\"snapshot.dat\"")
+            + HelpExampleRpc("dumpchainstate", "\"snapshot.dat\"")
+        );
+
+    boost::filesystem::path path(params[0].get_str());
+    if (!path.is_complete())
+        path = GetDataDir() / path;
+
+    LOCK(cs_main);
+    // The dump iterates the databases directly, so the in-memory cache must
+    // be flushed first for the snapshot to reflect the current tip.
+    FlushStateToDisk();
+
+    uint256 hashContent;
+    uint64_t nRecords = 0;
+    std::string strError;
+    if (!WriteChainstateSnapshot(path, pcoinsTip, pblocktree, hashContent, nRecords, strError))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, strError);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("filename", path.string()));
+    ret.push_back(Pair("contenthash", hashContent.GetHex()));
+    ret.push_back(Pair("bestblock", pcoinsTip->GetBestBlock().GetHex()));
+    ret.push_back(Pair("height", chainActive.Height()));
+    ret.push_back(Pair("records", (int64_t)nRecords));
+    return ret;
+}
+
+UniValue getvalidationstats(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getvalidationstats\n"
+            "\nReturns per-stage block connection timing collected since startup: where\n"
+            "ConnectBlock/ConnectTip time goes (input connection, script verification, index\n"
+            "writes, flush, ...), as averages, rolling percentiles over the last 128 blocks\n"
+            "and a log2 latency histogram per stage. The counters are always on and reading\n"
+            "them does not block validation.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"stage\": {                (one entry per stage, e.g. \"verify\", \"total\")\n"
+            "    \"blocks\": n,            (numeric) blocks timed\n"
+            "    \"totalms\": n,           (numeric) accumulated milliseconds\n"
+            "    \"avgms\": n,             (numeric) mean milliseconds per block\n"
+            "    \"p50ms\": n,             (numeric) median over the rolling window\n"
+            "    \"p90ms\": n,             (numeric) 90th percentile over the rolling window\n"
+            "    \"p99ms\": n,             (numeric) 99th percentile over the rolling window\n"
+            "    \"histogram\": [          (array) non-empty latency buckets\n"
+            "      { \"maxus\": n, \"count\": n }, ...\n"
+            "    ]\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getvalidationstats", "")
+            + HelpExampleRpc("getvalidationstats", "")
+        );
+
+    UniValue ret(UniValue::VOBJ);
+    for (int stage = 0; stage < NUM_VALIDATION_STAGES; stage++) {
+        uint64_t count = 0, sumUsec = 0;
+        std::vector<uint64_t> buckets;
+        std::vector<uint32_t> samples;
+        GetValidationStageStats(stage, count, sumUsec, buckets, samples);
+
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("blocks", count));
+        obj.push_back(Pair("totalms", sumUsec * 0.001));
+        obj.push_back(Pair("avgms", count > 0 ? sumUsec * 0.001 / count : 0.0));
+        if (!samples.empty()) {
+            std::sort(samples.begin(), samples.end());
+            size_t last = samples.size() - 1;
+            obj.push_back(Pair("p50ms", samples[std::min(last, samples.size() / 2)] * 0.001));
+            obj.push_back(Pair("p90ms", samples[std::min(last, (samples.size() * 9) / 10)] * 0.001));
+            obj.push_back(Pair("p99ms", samples[std::min(last, (samples.size() * 99) / 100)] * 0.001));
+        }
+        UniValue hist(UniValue::VARR);
+        for (size_t b = 0; b < buckets.size(); b++) {
+            if (buckets[b] == 0)
+                continue;
+            UniValue entry(UniValue::VOBJ);
+            entry.push_back(Pair("maxus", (uint64_t)1 << (b + 1)));
+            entry.push_back(Pair("count", buckets[b]));
+            hist.push_back(entry);
+        }
+        obj.push_back(Pair("histogram", hist));
+        ret.push_back(Pair(ValidationStageName(stage), obj));
+    }
+    return ret;
+}
+
 UniValue kvsearch(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     UniValue ret(UniValue::VOBJ); uint32_t flags; uint8_t value[IGUANA_MAXSCRIPTSIZE*8],key[IGUANA_MAXSCRIPTSIZE*8]; int32_t duration,j,height,valuesize,keylen; uint256 refpubkey; static uint256 zeroes;
@@ -1342,6 +1535,149 @@ void NetworkUpgradeDescPushBack(
     }
 }
 
+/** The tip-dependent (and expensive) pieces of the getblockchaininfo reply.
+ * Monitoring setups poll this RPC every second across many asset chains, so
+ * the summary is rebuilt under cs_main only when nChainTipSequence moves and
+ * handed out by shared_ptr otherwise, like the mempool snapshot. */
+struct CBlockchainInfoSummary
+{
+    int nHeight;
+    std::string strBestBlockHash;
+    double dDifficulty;
+    double dProgress;      //!< measured verification progress estimate
+    int64_t nSyncEta;      //!< estimated seconds of syncing left (-1 = unknown)
+    std::string strChainWork;
+    uint64_t nCommitments;
+    bool fHaveSyncCheckpoint;
+    UniValue syncCheckpoint;
+    UniValue chainSupply;
+    UniValue valuePools;
+    UniValue softforks;
+    UniValue upgrades;
+    UniValue consensus;
+    int nPruneHeight;      //!< -1 unless running pruned
+    UniValue syncCheckpointUpgrade;
+};
+static CCriticalSection cs_blockchainInfoSummary;
+static std::shared_ptr<const CBlockchainInfoSummary> blockchainInfoSummary;
+static uint64_t nBlockchainInfoBuiltAt = 0;
+
+static std::shared_ptr<const CBlockchainInfoSummary> GetBlockchainInfoSummary()
+{
+    uint64_t nSeq = nChainTipSequence.load();
+    {
+        LOCK(cs_blockchainInfoSummary);
+        if (blockchainInfoSummary && nBlockchainInfoBuiltAt == nSeq)
+            return blockchainInfoSummary;
+    }
+
+    std::shared_ptr<CBlockchainInfoSummary> fresh = std::make_shared<CBlockchainInfoSummary>();
+    {
+        LOCK(cs_main);
+        CBlockIndex* tip = chainActive.Tip();
+
+        fresh->nHeight = (int)chainActive.Height();
+        fresh->strBestBlockHash = tip->GetBlockHash().GetHex();
+        fresh->dDifficulty = (double)GetNetworkDifficulty();
+        fresh->dProgress = EstimateVerificationProgress(tip);
+        fresh->nSyncEta = EstimateSyncTimeLeft(tip);
+        fresh->strChainWork = tip->nChainWork.GetHex();
+
+        SproutMerkleTree tree;
+        pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), tree);
+        fresh->nCommitments = static_cast<uint64_t>(tree.size());
+
+        int64_t timestamp = komodo_heightstamp(fresh->nHeight);
+        fresh->fHaveSyncCheckpoint = false;
+        {
+            LOCK(Checkpoints::cs_hashSyncCheckpoint);
+            if (Checkpoints::IsSyncCheckpointUpgradeActive(fresh->nHeight, timestamp)) {
+                CBlockIndex *psyncCheckpoint = Checkpoints::GetLastSyncCheckpoint();
+                UniValue blockinfo(UniValue::VOBJ);
+                if (psyncCheckpoint) {
+                    blockinfo.push_back(Pair("height", psyncCheckpoint->nHeight));
+                    blockinfo.push_back(Pair("blockHash", psyncCheckpoint->phashBlock ? (*psyncCheckpoint->phashBlock).GetHex() : uint256().GetHex()));
+                }
+                fresh->fHaveSyncCheckpoint = true;
+                fresh->syncCheckpoint = blockinfo;
+            }
+        }
+
+        fresh->chainSupply = ValuePoolDesc(boost::none, tip->nChainTotalSupply, boost::none);
+        UniValue valuePools(UniValue::VARR);
+        valuePools.push_back(ValuePoolDesc(std::string("transparent"), tip->nChainTransparentValue, boost::none));
+        valuePools.push_back(ValuePoolDesc(std::string("sprout"), tip->nChainSproutValue, boost::none));
+        valuePools.push_back(ValuePoolDesc(std::string("sapling"), tip->nChainSaplingValue, boost::none));
+        valuePools.push_back(ValuePoolDesc(std::string("burned"), tip->nChainTotalBurned, boost::none));
+        fresh->valuePools = valuePools;
+
+        const Consensus::Params& consensusParams = Params().GetConsensus();
+        UniValue softforks(UniValue::VARR);
+        softforks.push_back(SoftForkDesc("bip34", 2, tip, consensusParams));
+        softforks.push_back(SoftForkDesc("bip66", 3, tip, consensusParams));
+        softforks.push_back(SoftForkDesc("bip65", 4, tip, consensusParams));
+        fresh->softforks = softforks;
+
+        UniValue upgrades(UniValue::VOBJ);
+        for (int i = Consensus::UPGRADE_OVERWINTER; i < Consensus::MAX_NETWORK_UPGRADES; i++) {
+            NetworkUpgradeDescPushBack(upgrades, consensusParams, Consensus::UpgradeIndex(i), tip->nHeight);
+        }
+        fresh->upgrades = upgrades;
+
+        UniValue consensus(UniValue::VOBJ);
+        consensus.push_back(Pair("chaintip", HexInt(CurrentEpochBranchId(tip->nHeight, consensusParams))));
+        consensus.push_back(Pair("nextblock", HexInt(CurrentEpochBranchId(tip->nHeight + 1, consensusParams))));
+        fresh->consensus = consensus;
+
+        fresh->nPruneHeight = -1;
+        if (fPruneMode)
+        {
+            CBlockIndex *block = tip;
+            while (block && block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA))
+                block = block->pprev;
+
+            fresh->nPruneHeight = block->nHeight;
+        }
+
+        // sync checkpoint and dpow status
+        UniValue syncCheckpointUpgrade(UniValue::VOBJ);
+        bool isSunsettingActive = IsSunsettingActive(tip->nHeight, tip->GetBlockTime()); // dPoW is active when !isSunsettingActive
+        syncCheckpointUpgrade.push_back(Pair("dpow_active", !isSunsettingActive ? "true" : "false"));
+
+        Checkpoints::CSyncChkParams syncChkParams;
+        bool isSyncCheckpointActive = Checkpoints::IsSyncCheckpointUpgradeActive(syncChkParams, tip->nHeight, tip->GetBlockTime());
+        syncCheckpointUpgrade.push_back(Pair("sync_checkpoint_active", isSyncCheckpointActive));
+        bool fValidParams = (!syncChkParams.masterPubKey.empty() && syncChkParams.activeAt != -1);
+        syncCheckpointUpgrade.push_back(Pair("sync_checkpoint_expected", fValidParams));
+
+        if (fValidParams) {
+            if (syncChkParams.activeAt < LOCKTIME_THRESHOLD) {
+                syncCheckpointUpgrade.push_back(Pair("activation_height", syncChkParams.activeAt));
+            } else {
+                syncCheckpointUpgrade.push_back(Pair("activation_timestamp", syncChkParams.activeAt));
+                syncCheckpointUpgrade.push_back(Pair("activation_timestamp_utc", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", syncChkParams.activeAt)));
+            }
+            syncCheckpointUpgrade.push_back(Pair("masterpubKey", syncChkParams.masterPubKey));
+
+            if (isSyncCheckpointActive) {
+                if (TryInitSyncCheckpoint(syncChkParams)) {
+                    syncCheckpointUpgrade.push_back(Pair("init", true));
+                } else {
+                    syncCheckpointUpgrade.push_back(Pair("init", false));
+                }
+            }
+        }
+        fresh->syncCheckpointUpgrade = syncCheckpointUpgrade;
+    }
+
+    LOCK(cs_blockchainInfoSummary);
+    // nSeq was sampled before cs_main was taken, so a tip change racing the
+    // rebuild leaves a stale sequence behind and the next call rebuilds
+    blockchainInfoSummary = fresh;
+    nBlockchainInfoBuiltAt = nSeq;
+    return blockchainInfoSummary;
+}
+
 UniValue getblockchaininfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     if (fHelp || params.size() != 0)
@@ -1357,7 +1693,8 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp, const CPubKey& my
             "  \"headers\": xxxxxx,        (numeric) the current number of headers we have validated\n"
             "  \"bestblockhash\": \"...\", (string) the hash of the currently best block\n"
             "  \"difficulty\": xxxxxx,     (numeric) the current difficulty\n"
-            "  \"verificationprogress\": xxxx, (numeric) estimate of verification progress [0..1]\n"
+            "  \"verificationprogress\": xxxx, (numeric) estimate of verification progress [0..1], measured from the chain's own recent tx rate\n"
+            "  \"estimatedtimeleft\": xxxx,    (numeric) estimated seconds of syncing left at the measured verification throughput; 0 when caught up, -1 when no estimate is available yet\n"
             "  \"chainwork\": \"xxxx\"     (string) total amount of work in active chain, in hexadecimal\n"
             "  \"commitments\": xxxxxx,    (numeric) the current number of note commitments in the commitment tree\n"
             "  \"syncCheckpoint\": {\n"
@@ -1418,109 +1755,43 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp, const CPubKey& my
             + HelpExampleRpc("getblockchaininfo", "")
         );
 
-    LOCK(cs_main);
+    std::shared_ptr<const CBlockchainInfoSummary> summary = GetBlockchainInfoSummary();
+
     double progress;
     if ( chainName.isKMD() ) {
-        progress = Checkpoints::GuessVerificationProgress(Params().Checkpoints(), chainActive.Tip());
+        progress = summary->dProgress;
     } else {
         int32_t longestchain = KOMODO_LONGESTCHAIN;
-	    progress = (longestchain > 0 ) ? (double) chainActive.Height() / longestchain : 1.0;
+        // prefer the network's longest chain when peers have told us about
+        // it; otherwise fall back to the measured estimate
+	    progress = (longestchain > 0 ) ? (double) summary->nHeight / longestchain : summary->dProgress;
     }
     UniValue obj(UniValue::VOBJ);
     obj.push_back(Pair("chain",                 Params().NetworkIDString()));
-    obj.push_back(Pair("blocks",                (int)chainActive.Height()));
+    obj.push_back(Pair("blocks",                summary->nHeight));
     obj.push_back(Pair("synced",                KOMODO_INSYNC!=0));
     obj.push_back(Pair("headers",               pindexBestHeader ? pindexBestHeader->nHeight : -1));
-    obj.push_back(Pair("bestblockhash",         chainActive.Tip()->GetBlockHash().GetHex()));
-    obj.push_back(Pair("difficulty",            (double)GetNetworkDifficulty()));
+    obj.push_back(Pair("bestblockhash",         summary->strBestBlockHash));
+    obj.push_back(Pair("difficulty",            summary->dDifficulty));
     obj.push_back(Pair("verificationprogress",  progress));
-    obj.push_back(Pair("chainwork",             chainActive.Tip()->nChainWork.GetHex()));
+    obj.push_back(Pair("estimatedtimeleft",     summary->nSyncEta));
+    obj.push_back(Pair("chainwork",             summary->strChainWork));
     obj.push_back(Pair("pruned",                fPruneMode));
+    obj.push_back(Pair("commitments",           summary->nCommitments));
 
-    SproutMerkleTree tree;
-    pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), tree);
-    obj.push_back(Pair("commitments",           static_cast<uint64_t>(tree.size())));
+    if (summary->fHaveSyncCheckpoint)
+        obj.push_back(Pair("syncCheckpoint", summary->syncCheckpoint));
 
-    int nHeight = chainActive.Height();
-    int64_t timestamp = komodo_heightstamp(nHeight);
-    {
-        LOCK(Checkpoints::cs_hashSyncCheckpoint);
-        if (Checkpoints::IsSyncCheckpointUpgradeActive(nHeight, timestamp)) {
-            CBlockIndex *psyncCheckpoint = Checkpoints::GetLastSyncCheckpoint();
-            UniValue blockinfo(UniValue::VOBJ);
-            if (psyncCheckpoint) {
-                blockinfo.push_back(Pair("height", psyncCheckpoint->nHeight));
-                blockinfo.push_back(Pair("blockHash", psyncCheckpoint->phashBlock ? (*psyncCheckpoint->phashBlock).GetHex() : uint256().GetHex()));
-            }
-            obj.push_back(Pair("syncCheckpoint", blockinfo));
-        }
-    }
-
-    CBlockIndex* tip = chainActive.Tip();
-    obj.pushKV("chainSupply", ValuePoolDesc(boost::none, tip->nChainTotalSupply, boost::none));
-    UniValue valuePools(UniValue::VARR);
-    valuePools.push_back(ValuePoolDesc(std::string("transparent"), tip->nChainTransparentValue, boost::none));
-    valuePools.push_back(ValuePoolDesc(std::string("sprout"), tip->nChainSproutValue, boost::none));
-    valuePools.push_back(ValuePoolDesc(std::string("sapling"), tip->nChainSaplingValue, boost::none));
-    valuePools.push_back(ValuePoolDesc(std::string("burned"), tip->nChainTotalBurned, boost::none));
-    obj.push_back(Pair("valuePools",            valuePools));
-
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    UniValue softforks(UniValue::VARR);
-    softforks.push_back(SoftForkDesc("bip34", 2, tip, consensusParams));
-    softforks.push_back(SoftForkDesc("bip66", 3, tip, consensusParams));
-    softforks.push_back(SoftForkDesc("bip65", 4, tip, consensusParams));
-    obj.push_back(Pair("softforks",             softforks));
-
-    UniValue upgrades(UniValue::VOBJ);
-    for (int i = Consensus::UPGRADE_OVERWINTER; i < Consensus::MAX_NETWORK_UPGRADES; i++) {
-        NetworkUpgradeDescPushBack(upgrades, consensusParams, Consensus::UpgradeIndex(i), tip->nHeight);
-    }
-    obj.push_back(Pair("upgrades", upgrades));
-
-    UniValue consensus(UniValue::VOBJ);
-    consensus.push_back(Pair("chaintip", HexInt(CurrentEpochBranchId(tip->nHeight, consensusParams))));
-    consensus.push_back(Pair("nextblock", HexInt(CurrentEpochBranchId(tip->nHeight + 1, consensusParams))));
-    obj.push_back(Pair("consensus", consensus));
-
-    if (fPruneMode)
-    {
-        CBlockIndex *block = chainActive.Tip();
-        while (block && block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA))
-            block = block->pprev;
-
-        obj.push_back(Pair("pruneheight",        block->nHeight));
-    }
+    obj.pushKV("chainSupply", summary->chainSupply);
+    obj.push_back(Pair("valuePools",            summary->valuePools));
+    obj.push_back(Pair("softforks",             summary->softforks));
+    obj.push_back(Pair("upgrades", summary->upgrades));
+    obj.push_back(Pair("consensus", summary->consensus));
 
-    // sync checkpoint and dpow status
-    UniValue syncCheckpointUpgrade(UniValue::VOBJ);
-    bool isSunsettingActive = IsSunsettingActive(tip->nHeight, tip->GetBlockTime()); // dPoW is active when !isSunsettingActive
-    syncCheckpointUpgrade.push_back(Pair("dpow_active", !isSunsettingActive ? "true" : "false"));
+    if (summary->nPruneHeight >= 0)
+        obj.push_back(Pair("pruneheight",        summary->nPruneHeight));
 
-    Checkpoints::CSyncChkParams syncChkParams;
-    bool isSyncCheckpointActive = Checkpoints::IsSyncCheckpointUpgradeActive(syncChkParams, tip->nHeight, tip->GetBlockTime());
-    syncCheckpointUpgrade.push_back(Pair("sync_checkpoint_active", isSyncCheckpointActive));
-    bool fValidParams = (!syncChkParams.masterPubKey.empty() && syncChkParams.activeAt != -1);
-    syncCheckpointUpgrade.push_back(Pair("sync_checkpoint_expected", fValidParams));
-
-    if (fValidParams) {
-        if (syncChkParams.activeAt < LOCKTIME_THRESHOLD) {
-            syncCheckpointUpgrade.push_back(Pair("activation_height", syncChkParams.activeAt));
-        } else {
-            syncCheckpointUpgrade.push_back(Pair("activation_timestamp", syncChkParams.activeAt));
-            syncCheckpointUpgrade.push_back(Pair("activation_timestamp_utc", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", syncChkParams.activeAt)));
-        }
-        syncCheckpointUpgrade.push_back(Pair("masterpubKey", syncChkParams.masterPubKey));
-
-        if (isSyncCheckpointActive) {
-            if (TryInitSyncCheckpoint(syncChkParams)) {
-                syncCheckpointUpgrade.push_back(Pair("init", true));
-            } else {
-                syncCheckpointUpgrade.push_back(Pair("init", false));
-            }
-        }
-    }
-    obj.push_back(Pair("syncCheckpointUpgrade", syncCheckpointUpgrade));
+    obj.push_back(Pair("syncCheckpointUpgrade", summary->syncCheckpointUpgrade));
 
     return obj;
 }
@@ -1769,10 +2040,11 @@ UniValue z_gettreestate(const UniValue& params, bool fHelp, const CPubKey& mypk)
 
 UniValue mempoolInfoToJSON()
 {
+    CTxMemPoolSnapshotRef snap = mempool.GetSnapshot();
     UniValue ret(UniValue::VOBJ);
-    ret.push_back(Pair("size", (int64_t) mempool.size()));
-    ret.push_back(Pair("bytes", (int64_t) mempool.GetTotalTxSize()));
-    ret.push_back(Pair("usage", (int64_t) mempool.DynamicMemoryUsage()));
+    ret.push_back(Pair("size", (int64_t) snap->vEntries.size()));
+    ret.push_back(Pair("bytes", (int64_t) snap->nTotalTxSize));
+    ret.push_back(Pair("usage", (int64_t) snap->nDynamicUsage));
 
     if (Params().NetworkIDString() == "regtest") {
         ret.push_back(Pair("fullyNotified", mempool.IsFullyNotified()));
@@ -1967,6 +2239,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockcount",          &getblockcount,          true  },
     { "blockchain",         "getblock",               &getblock,               true  },
     { "blockchain",         "getblockhash",           &getblockhash,           true  },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         true  },
     { "blockchain",         "getblockheader",         &getblockheader,         true  },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
     { "blockchain",         "z_gettreestate",         &z_gettreestate,         true  },
@@ -1976,6 +2249,8 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "dumpchainstate",         &dumpchainstate,         true  },
+    { "blockchain",         "getvalidationstats",     &getvalidationstats,     true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
 
     /* Not shown in help */
@@ -604,6 +604,7 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp, const CPubKey& myp
             "           \"support\"           (string) client side supported feature, 'longpoll', 'coinbasetxn', 'coinbasevalue', 'proposal', 'serverlist', 'workid'\n"
             "           ,...\n"
             "         ]\n"
+            "       \"templateid\":n         (numeric, optional) templateid of the previous response; if it is still current, 'transactions' only contains transactions added since then\n"
             "     }\n"
             "\n"
 
@@ -642,7 +643,9 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp, const CPubKey& myp
             "  \"sizelimit\" : n,                  (numeric) limit of block size\n"
             "  \"curtime\" : ttt,                  (numeric) current timestamp in seconds since epoch (Jan 1 1970 GMT)\n"
             "  \"bits\" : \"xxx\",                 (string) compressed target of next block\n"
-            "  \"height\" : n                      (numeric) The height of the next block\n"
+            "  \"height\" : n,                     (numeric) The height of the next block\n"
+            "  \"templateid\" : n,                 (numeric) id of this template generation, pass it back to receive delta responses\n"
+            "  \"deltafrom\" : n                   (numeric, optional) present when 'transactions' is a delta against the given templateid\n"
             "}\n"
 
             "\nExamples:\n"
@@ -669,6 +672,7 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp, const CPubKey& myp
     UniValue lpval = NullUniValue;
     // TODO: Re-enable coinbasevalue once a specification has been written
     bool coinbasetxn = true;
+    uint64_t nClientTemplateId = 0;
     std::string strMode;
     if (params.size() > 0)
     {
@@ -683,6 +687,11 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp, const CPubKey& myp
         else
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid mode");
         lpval = find_value(oparam, "longpollid");
+        // Clients that echo back the templateid of their previous response
+        // receive only the transactions appended since that template
+        const UniValue& tidval = find_value(oparam, "templateid");
+        if (tidval.isNum())
+            nClientTemplateId = tidval.get_int64();
 
         if (strMode == "disablecb")
             coinbasetxn = false;
@@ -793,8 +802,34 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp, const CPubKey& myp
     static CBlockIndex* pindexPrev;
     static int64_t nStart;
     static CBlockTemplate* pblocktemplate;
-    if (pindexPrev != chainActive.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
+    // Each template generation gets an id; incremental updates only ever
+    // append, so "everything a client with generation id X has not seen" is
+    // the tail of the template beyond the size recorded when X was created.
+    static uint64_t nTemplateId;
+    static std::vector<std::pair<uint64_t, size_t> > vTemplateGenerations;
+    // Full rebuilds re-sort the whole mempool; with pools polling every few
+    // seconds that is almost always wasted work, so between rebuilds newly
+    // arrived transactions are appended to the cached template in place.
+    static const int64_t nTemplateRebuildInterval = 60;
+
+    bool fRebuildTemplate = pblocktemplate == NULL || pindexPrev != chainActive.Tip() ||
+                            GetTime() - nStart > nTemplateRebuildInterval;
+    if (!fRebuildTemplate && mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast)
+    {
+        nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
+        size_t nTxBefore = pblocktemplate->block.vtx.size();
+        if (UpdateBlockTemplate(pblocktemplate, pindexPrev))
+        {
+            if (pblocktemplate->block.vtx.size() != nTxBefore)
+            {
+                nTemplateId++;
+                vTemplateGenerations.push_back(std::make_pair(nTemplateId, pblocktemplate->block.vtx.size()));
+            }
+        }
+        else
+            fRebuildTemplate = true;
+    }
+    if (fRebuildTemplate)
     {
         // Clear pindexPrev so future calls make a new block, despite any failures from here on
         pindexPrev = NULL;
@@ -823,6 +858,10 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp, const CPubKey& myp
 
         // Need to update only after we know CreateNewBlockWithKey succeeded
         pindexPrev = pindexPrevNew;
+
+        nTemplateId++;
+        vTemplateGenerations.clear();
+        vTemplateGenerations.push_back(std::make_pair(nTemplateId, pblocktemplate->block.vtx.size()));
     }
     CBlock* pblock = &pblocktemplate->block; // pointer for convenience
 
@@ -832,6 +871,17 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp, const CPubKey& myp
 
     UniValue aCaps(UniValue::VARR); aCaps.push_back("proposal");
 
+    // If the client's previous template generation is still a prefix of the
+    // current one, it only needs the transactions beyond that generation's
+    // recorded size; an unknown (e.g. pre-rebuild) id gets the full list.
+    size_t nDeltaOffset = 0;
+    if (nClientTemplateId != 0)
+    {
+        for (size_t j = 0; j < vTemplateGenerations.size(); j++)
+            if (vTemplateGenerations[j].first == nClientTemplateId)
+                nDeltaOffset = vTemplateGenerations[j].second;
+    }
+
     UniValue txCoinbase = NullUniValue;
     UniValue transactions(UniValue::VARR);
     map<uint256, int64_t> setTxIndex;
@@ -843,6 +893,11 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp, const CPubKey& myp
         //if (tx.IsCoinBase() && !coinbasetxn)
         //    continue;
 
+        // Transactions the delta client already has are skipped, but still
+        // get their index recorded above so "depends" stays consistent
+        if (!tx.IsCoinBase() && (size_t)(i - 1) < nDeltaOffset)
+            continue;
+
         UniValue entry(UniValue::VOBJ);
 
         entry.push_back(Pair("data", EncodeHexTx(tx)));
@@ -902,6 +957,9 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp, const CPubKey& myp
       //  result.push_back(Pair("coinbasevalue", (int64_t)pblock->vtx[0].vout[0].nValue));
     //}
     result.push_back(Pair("longpollid", chainActive.Tip()->GetBlockHash().GetHex() + i64tostr(nTransactionsUpdatedLast)));
+    result.push_back(Pair("templateid", nTemplateId));
+    if (nDeltaOffset > 0)
+        result.push_back(Pair("deltafrom", nClientTemplateId));
     if ( ASSETCHAINS_STAKED != 0 )
     {
         arith_uint256 POWtarget; int32_t PoSperc;
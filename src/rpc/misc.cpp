@@ -827,6 +827,68 @@ UniValue setmocktime(const UniValue& params, bool fHelp, const CPubKey& mypk)
     return NullUniValue;
 }
 
+UniValue getlockstats(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getlockstats ( reset )\n"
+            "\nReturns lock wait and hold times aggregated per LOCK call site.\n"
+            "Only collects data when the daemon is started with -lockstats.\n"
+            "\nArguments:\n"
+            "1. reset      (boolean, optional, default=false) Zero the counters after reading them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"enabled\" : true|false,     (boolean) whether -lockstats is on\n"
+            "  \"overflow\" : n,             (numeric) acquisitions dropped because the call-site table was full\n"
+            "  \"locks\" : [                 (array) one entry per call site, busiest first\n"
+            "    {\n"
+            "      \"name\" : \"cs_main\",     (string) the lock expression at the call site\n"
+            "      \"site\" : \"file:line\",   (string) source location of the LOCK\n"
+            "      \"locks\" : n,            (numeric) acquisitions\n"
+            "      \"contended\" : n,        (numeric) acquisitions that had to wait\n"
+            "      \"waitms\" : x.xxx,       (numeric) total time spent waiting, in milliseconds\n"
+            "      \"maxwaitms\" : x.xxx,    (numeric) longest single wait\n"
+            "      \"holdms\" : x.xxx,       (numeric) total time the lock was held\n"
+            "      \"maxholdms\" : x.xxx     (numeric) longest single hold\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getlockstats", "")
+            + HelpExampleRpc("getlockstats", "true")
+        );
+
+    std::vector<CLockStat> vStats;
+    uint64_t nOverflow = 0;
+    GetLockStats(vStats, nOverflow);
+    std::sort(vStats.begin(), vStats.end(),
+              [](const CLockStat& a, const CLockStat& b) { return a.nWaitMicros > b.nWaitMicros; });
+
+    UniValue locks(UniValue::VARR);
+    BOOST_FOREACH(const CLockStat& stat, vStats) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("name", stat.mutexName));
+        entry.push_back(Pair("site", strprintf("%s:%d", stat.sourceFile, stat.sourceLine)));
+        entry.push_back(Pair("locks", stat.nLocks));
+        entry.push_back(Pair("contended", stat.nContended));
+        entry.push_back(Pair("waitms", stat.nWaitMicros / 1000.0));
+        entry.push_back(Pair("maxwaitms", stat.nMaxWaitMicros / 1000.0));
+        entry.push_back(Pair("holdms", stat.nHoldMicros / 1000.0));
+        entry.push_back(Pair("maxholdms", stat.nMaxHoldMicros / 1000.0));
+        locks.push_back(entry);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("enabled", fLockStats));
+    result.push_back(Pair("overflow", nOverflow));
+    result.push_back(Pair("locks", locks));
+
+    if (params.size() > 0 && params[0].get_bool())
+        ResetLockStats();
+
+    return result;
+}
+
 bool getAddressFromIndex(const int &type, const uint160 &hash, std::string &address)
 {
     if (type == 2) {
@@ -841,6 +903,26 @@ bool getAddressFromIndex(const int &type, const uint160 &hash, std::string &addr
     return true;
 }
 
+/**
+ * Memoizing wrapper around getAddressFromIndex for result-rendering loops.
+ * Index scans emit long runs of rows for the same (type, hash), and
+ * base58check-encoding every row separately dominated large responses;
+ * the memo encodes each distinct address once per call.
+ */
+static bool getAddressFromIndexCached(std::map<std::pair<int, uint160>, std::string> &memo,
+                                      const int &type, const uint160 &hash, std::string &address)
+{
+    std::map<std::pair<int, uint160>, std::string>::const_iterator it = memo.find(std::make_pair(type, hash));
+    if (it != memo.end()) {
+        address = it->second;
+        return true;
+    }
+    if (!getAddressFromIndex(type, hash, address))
+        return false;
+    memo[std::make_pair(type, hash)] = address;
+    return true;
+}
+
 bool getAddressesFromParams(const UniValue& params, std::vector<std::pair<uint160, int> > &addresses)
 {
     bool ccVout = false;
@@ -937,12 +1019,13 @@ UniValue getaddressmempool(const UniValue& params, bool fHelp, const CPubKey& my
     std::sort(indexes.begin(), indexes.end(), timestampSort);
 
     UniValue result(UniValue::VARR);
+    std::map<std::pair<int, uint160>, std::string> addressMemo;
 
     for (std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> >::iterator it = indexes.begin();
          it != indexes.end(); it++) {
 
         std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.addressBytes, address)) {
+        if (!getAddressFromIndexCached(addressMemo, it->first.type, it->first.addressBytes, address)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
         }
 
@@ -1019,11 +1102,12 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp, const CPubKey& mypk
     std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
 
     UniValue utxos(UniValue::VARR);
+    std::map<std::pair<int, uint160>, std::string> addressMemo;
 
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
         UniValue output(UniValue::VOBJ);
         std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
+        if (!getAddressFromIndexCached(addressMemo, it->first.type, it->first.hashBytes, address)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
         }
 
@@ -1065,6 +1149,12 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp, const CPubKey& myp
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
             "  \"chainInfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
+            "  \"limit\" (number, optional) Return at most this many deltas per call; requires a single\n"
+            "      address, and the reply becomes {\"deltas\": [...], \"cursor\": n, \"done\": true|false}\n"
+            "      where cursor is the start height to pass on the next call\n"
+            "  \"byheight\" (boolean, optional) Serve the query from the height-partitioned index\n"
+            "      (requires -addressheightindex and start/end); one sequential scan over the range\n"
+            "      regardless of how many addresses are given, with deltas ordered by height\n"
             "}\n"
             "\nCCvout (optional) Return CCvouts instead of normal vouts\n"
             "\nResult:\n"
@@ -1106,31 +1196,71 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp, const CPubKey& myp
         }
     }
 
+    int nLimit = 0;
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    if (limitValue.isNum()) {
+        nLimit = limitValue.get_int();
+        if (nLimit <= 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be greater than zero");
+        }
+    }
+
     std::vector<std::pair<uint160, int> > addresses;
 
     if (!getAddressesFromParams(params, addresses)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    if (nLimit > 0) {
+        // results are grouped per address, so a height cursor is only
+        // meaningful over a single address' history
+        if (addresses.size() != 1) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit requires a single address");
+        }
+        // pin the scan to a definite range so the cursor has an end to reach
+        if (start <= 0)
+            start = 1;
+        if (end <= 0) {
+            LOCK(cs_main);
+            end = chainActive.Height();
+        }
+    }
+
+    bool fByHeight = false;
+    UniValue byHeightValue = find_value(params[0].get_obj(), "byheight");
+    if (byHeightValue.isBool()) {
+        fByHeight = byHeightValue.get_bool();
+    }
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
+    if (fByHeight) {
+        if (nLimit > 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is not supported with byheight");
+        }
+        if (start <= 0 || end <= 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "byheight requires start and end");
         }
+        std::vector<std::pair<CAddressIndexKey, CAmount> > rangeIndex;
+        if (!GetAddressHeightIndex(start, end, rangeIndex)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address height index not available (requires -addressheightindex)");
+        }
+        // one sequential scan over the range; keep only the requested addresses
+        std::set<std::pair<uint160, int> > setAddresses(addresses.begin(), addresses.end());
+        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = rangeIndex.begin(); it != rangeIndex.end(); it++) {
+            if (setAddresses.count(std::make_pair(it->first.hashBytes, (int)it->first.type)))
+                addressIndex.push_back(*it);
+        }
+    } else if (!GetAddressIndex(addresses, addressIndex, start, end, (size_t)nLimit)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
     }
 
     UniValue deltas(UniValue::VARR);
+    std::map<std::pair<int, uint160>, std::string> addressMemo;
 
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
         std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
+        if (!getAddressFromIndexCached(addressMemo, it->first.type, it->first.hashBytes, address)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
         }
 
@@ -1144,6 +1274,11 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp, const CPubKey& myp
         deltas.push_back(delta);
     }
 
+    // fewer entries than the cap means the scan reached the end of the range;
+    // otherwise resume from the height after the last one returned
+    bool fDone = (nLimit == 0 || (int)addressIndex.size() < nLimit);
+    int nCursor = addressIndex.empty() ? end + 1 : addressIndex.back().first.blockHeight + 1;
+
     UniValue result(UniValue::VOBJ);
 
     if (includeChainInfo && start > 0 && end > 0) {
@@ -1169,6 +1304,16 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp, const CPubKey& myp
         result.push_back(Pair("start", startInfo));
         result.push_back(Pair("end", endInfo));
 
+        if (nLimit > 0) {
+            result.push_back(Pair("cursor", nCursor));
+            result.push_back(Pair("done", fDone));
+        }
+
+        return result;
+    } else if (nLimit > 0) {
+        result.push_back(Pair("deltas", deltas));
+        result.push_back(Pair("cursor", nCursor));
+        result.push_back(Pair("done", fDone));
         return result;
     } else {
         return deltas;
@@ -1275,6 +1420,21 @@ UniValue getnotarypayinfo(const UniValue& params, bool fHelp, const CPubKey& myp
     return result;
 }
 
+/****
+ * Running totals per address so getaddressbalance only scans index entries
+ * added since the previous call instead of re-summing the full history.
+ * The stored block hash detects reorgs, which force a full rescan.
+ */
+struct CAddressBalanceCacheEntry
+{
+    int nHeight;       //!< chain height the totals are valid through
+    uint256 blockHash; //!< hash of chainActive[nHeight] when cached
+    CAmount balance;
+    CAmount received;
+};
+static CCriticalSection cs_addressBalanceCache;
+static std::map<std::pair<uint160, int>, CAddressBalanceCacheEntry> mapAddressBalanceCache;
+
 UniValue getaddressbalance(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     if (fHelp ||params.size() > 2 || params.size() == 0)
@@ -1306,22 +1466,69 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp, const CPubKey& my
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    CAmount balance = 0;
+    CAmount received = 0;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        CAddressBalanceCacheEntry entry;
+        entry.nHeight = 0;
+        entry.balance = 0;
+        entry.received = 0;
+
+        {
+            LOCK(cs_addressBalanceCache);
+            std::map<std::pair<uint160, int>, CAddressBalanceCacheEntry>::iterator mi = mapAddressBalanceCache.find(*it);
+            if (mi != mapAddressBalanceCache.end())
+                entry = mi->second;
         }
-    }
 
-    CAmount balance = 0;
-    CAmount received = 0;
+        int nTipHeight;
+        uint256 tipHash;
+        int nStart = 1;
+        {
+            LOCK(cs_main);
+            nTipHeight = chainActive.Height();
+            if (nTipHeight < 0)
+                continue;
+            tipHash = chainActive[nTipHeight]->GetBlockHash();
+            // reuse the cached totals only if the block they were computed
+            // through is still on the active chain
+            if (entry.nHeight > 0 && entry.nHeight <= nTipHeight &&
+                chainActive[entry.nHeight]->GetBlockHash() == entry.blockHash) {
+                nStart = entry.nHeight + 1;
+            } else {
+                entry.balance = 0;
+                entry.received = 0;
+            }
+        }
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+        if (nStart <= nTipHeight) {
+            std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, nStart, nTipHeight)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+            for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator jt = addressIndex.begin(); jt != addressIndex.end(); jt++) {
+                // a block may connect while we scan; entries past the tip we
+                // pinned above would be double counted on the next call
+                if (jt->first.blockHeight > nTipHeight)
+                    continue;
+                if (jt->second > 0) {
+                    entry.received += jt->second;
+                }
+                entry.balance += jt->second;
+            }
+        }
+
+        entry.nHeight = nTipHeight;
+        entry.blockHash = tipHash;
+
+        {
+            LOCK(cs_addressBalanceCache);
+            mapAddressBalanceCache[*it] = entry;
         }
-        balance += it->second;
+
+        balance += entry.balance;
+        received += entry.received;
     }
 
     UniValue result(UniValue::VOBJ);
@@ -1332,30 +1539,37 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp, const CPubKey& my
 
 }
 
-UniValue komodo_snapshot(int top);
+UniValue komodo_snapshot(int top, int from);
 
 UniValue getsnapshot(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
-    UniValue result(UniValue::VOBJ); int64_t total; int32_t top = 0;
+    UniValue result(UniValue::VOBJ); int64_t total; int32_t top = 0; int32_t from = 0;
 
     if (params.size() > 0 && !params[0].isNull()) {
         top = atoi(params[0].get_str().c_str());
-        if ( top < 0 ) 
+        if ( top < 0 )
         {
             if ( KOMODO_SNAPSHOT_INTERVAL == 0 )
                 throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, top must be a positive integer");
-            else 
+            else
                 top = -1;
         }
     }
+    if (params.size() > 1 && !params[1].isNull()) {
+        from = atoi(params[1].get_str().c_str());
+        if ( from < 0 )
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, from must be a positive integer");
+    }
 
-    if ( fHelp || params.size() > 1)
+    if ( fHelp || params.size() > 2)
     {
         throw runtime_error(
                             "getsnapshot\n"
 			    "\nReturns a snapshot of (address,amount) pairs at current height (requires addressindex to be enabled).\n"
 			    "\nArguments:\n"
 			    "  \"top\" (number, optional) Only return this many addresses, i.e. top N richlist\n"
+			    "  \"from\" (number, optional) Skip this many addresses of the sorted list first, for\n"
+			    "      streaming the snapshot in pages; the reply reports \"next\" and \"done\"\n"
 			    "\nResult:\n"
 			    "{\n"
 			    "   \"addresses\": [\n"
@@ -1382,7 +1596,7 @@ UniValue getsnapshot(const UniValue& params, bool fHelp, const CPubKey& mypk)
 			    + HelpExampleRpc("getsnapshot", "1000")
                             );
     }
-    result = komodo_snapshot(top);
+    result = komodo_snapshot(top, from);
     if ( result.size() > 0 ) {
         result.push_back(Pair("end_time", (int) time(NULL)));
     } else {
@@ -1406,6 +1620,9 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp, const CPubKey& mypk
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many index entries per call; requires a\n"
+            "      single address, and the reply becomes {\"txids\": [...], \"cursor\": n, \"done\": true|false}\n"
+            "      where cursor is the start height to pass on the next call\n"
             "}\n"
             "\nCCvout (optional) Return CCvouts instead of normal vouts\n"
             "\nResult:\n"
@@ -1426,6 +1643,7 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp, const CPubKey& mypk
 
     int start = 0;
     int end = 0;
+    int nLimit = 0;
     if (params[0].isObject()) {
         UniValue startValue = find_value(params[0].get_obj(), "start");
         UniValue endValue = find_value(params[0].get_obj(), "end");
@@ -1433,20 +1651,32 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp, const CPubKey& mypk
             start = startValue.get_int();
             end = endValue.get_int();
         }
+        UniValue limitValue = find_value(params[0].get_obj(), "limit");
+        if (limitValue.isNum()) {
+            nLimit = limitValue.get_int();
+            if (nLimit <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be greater than zero");
+            }
+        }
+    }
+
+    if (nLimit > 0) {
+        // a height cursor only pages one address' history
+        if (addresses.size() != 1) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit requires a single address");
+        }
+        if (start <= 0)
+            start = 1;
+        if (end <= 0) {
+            LOCK(cs_main);
+            end = chainActive.Height();
+        }
     }
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
+    if (!GetAddressIndex(addresses, addressIndex, start, end, (size_t)nLimit)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
     }
 
     std::set<std::pair<int, std::string> > txids;
@@ -1471,10 +1701,256 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp, const CPubKey& mypk
         }
     }
 
+    if (nLimit > 0) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("txids", result));
+        page.push_back(Pair("cursor", addressIndex.empty() ? end + 1 : addressIndex.back().first.blockHeight + 1));
+        page.push_back(Pair("done", (int)addressIndex.size() < nLimit));
+        return page;
+    }
+
     return result;
 
 }
 
+UniValue watchaddress(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() > 2 || params.size() < 1)
+        throw runtime_error(
+            "watchaddress (ccvout)\n"
+            "\nRegisters an address(es) with the watch index. Confirmed activity is recorded\n"
+            "from the next connected block onward; no wallet is involved and no rescan is\n"
+            "performed, so history prior to registration is not available (use addressindex\n"
+            "for that). Registrations persist across restarts.\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "}\n"
+            "\nCCvout (optional) Watch the CCvout form of the address\n"
+            "\nResult:\n"
+            "\"watching\"  (number) The total number of watched addresses\n"
+            "\nExamples:\n"
+            + HelpExampleCli("watchaddress", "\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"")
+            + HelpExampleRpc("watchaddress", "\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"")
+        );
+
+    std::vector<std::pair<uint160, int> > addresses;
+
+    if (!getAddressesFromParams(params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    for (std::vector<std::pair<uint160, int> >::const_iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!WatchAddress(it->first, it->second)) {
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to register watch address");
+        }
+    }
+
+    std::map<std::pair<uint160, int>, int64_t> watched;
+    GetWatchedAddresses(watched);
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("watching", (uint64_t)watched.size()));
+    return result;
+}
+
+UniValue unwatchaddress(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() > 2 || params.size() < 1)
+        throw runtime_error(
+            "unwatchaddress (ccvout)\n"
+            "\nRemoves an address(es) from the watch index. History already recorded for the\n"
+            "address is kept and remains queryable with getwatchhistory.\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "}\n"
+            "\nCCvout (optional) Unwatch the CCvout form of the address\n"
+            "\nResult:\n"
+            "\"watching\"  (number) The remaining number of watched addresses\n"
+            "\nExamples:\n"
+            + HelpExampleCli("unwatchaddress", "\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"")
+            + HelpExampleRpc("unwatchaddress", "\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"")
+        );
+
+    std::vector<std::pair<uint160, int> > addresses;
+
+    if (!getAddressesFromParams(params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    for (std::vector<std::pair<uint160, int> >::const_iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!UnwatchAddress(it->first, it->second)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address is not watched");
+        }
+    }
+
+    std::map<std::pair<uint160, int>, int64_t> watched;
+    GetWatchedAddresses(watched);
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("watching", (uint64_t)watched.size()));
+    return result;
+}
+
+UniValue listwatchedaddresses(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "listwatchedaddresses\n"
+            "\nReturns the addresses registered with the watch index.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\"  (string) The base58check encoded address\n"
+            "    \"registered\"  (number) Registration time (unix seconds); activity is\n"
+            "        recorded from the block connected after this point\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("listwatchedaddresses", "")
+            + HelpExampleRpc("listwatchedaddresses", "")
+        );
+
+    std::map<std::pair<uint160, int>, int64_t> watched;
+    GetWatchedAddresses(watched);
+
+    UniValue result(UniValue::VARR);
+    for (std::map<std::pair<uint160, int>, int64_t>::const_iterator it = watched.begin(); it != watched.end(); it++) {
+        std::string address;
+        if (!getAddressFromIndex(it->first.second, it->first.first, address)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+        }
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("address", address));
+        entry.push_back(Pair("registered", it->second));
+        result.push_back(entry);
+    }
+
+    return result;
+}
+
+UniValue getwatchhistory(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() > 2 || params.size() < 1)
+        throw runtime_error(
+            "getwatchhistory (ccvout)\n"
+            "\nReturns the recorded watch index entries for an address(es). Only activity\n"
+            "since the address was registered with watchaddress is available.\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "  \"start\" (number) The start block height\n"
+            "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many entries per call; requires a\n"
+            "      single address, and the reply becomes {\"history\": [...], \"cursor\": n, \"done\": true|false}\n"
+            "      where cursor is the start height to pass on the next call\n"
+            "}\n"
+            "\nCCvout (optional) Query the CCvout form of the address\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\"  (string) The base58check encoded address\n"
+            "    \"txid\"  (string) The related txid\n"
+            "    \"height\"  (number) The block height\n"
+            "    \"index\"  (number) The related input or output index\n"
+            "    \"satoshis\"  (number) The difference of satoshis\n"
+            "    \"spending\"  (boolean) Whether the entry spends the address' funds\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getwatchhistory", "'{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}'")
+            + HelpExampleRpc("getwatchhistory", "{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}")
+        );
+
+    std::vector<std::pair<uint160, int> > addresses;
+
+    if (!getAddressesFromParams(params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    int start = 0;
+    int end = 0;
+    int nLimit = 0;
+    if (params[0].isObject()) {
+        UniValue startValue = find_value(params[0].get_obj(), "start");
+        UniValue endValue = find_value(params[0].get_obj(), "end");
+        if (startValue.isNum() && endValue.isNum()) {
+            start = startValue.get_int();
+            end = endValue.get_int();
+        }
+        UniValue limitValue = find_value(params[0].get_obj(), "limit");
+        if (limitValue.isNum()) {
+            nLimit = limitValue.get_int();
+            if (nLimit <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be greater than zero");
+            }
+        }
+    }
+
+    if (nLimit > 0) {
+        // a height cursor only pages one address' history
+        if (addresses.size() != 1) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit requires a single address");
+        }
+        if (start <= 0)
+            start = 1;
+        if (end <= 0) {
+            LOCK(cs_main);
+            end = chainActive.Height();
+        }
+    }
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > watchIndex;
+
+    if (!GetWatchIndex(addresses, watchIndex, start, end, (size_t)nLimit)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    UniValue result(UniValue::VARR);
+    std::map<std::pair<int, uint160>, std::string> addressMemo;
+
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = watchIndex.begin(); it != watchIndex.end(); it++) {
+        std::string address;
+        if (!getAddressFromIndexCached(addressMemo, it->first.type, it->first.hashBytes, address)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+        }
+
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("address", address));
+        entry.push_back(Pair("txid", it->first.txhash.GetHex()));
+        entry.push_back(Pair("height", (int)it->first.blockHeight));
+        entry.push_back(Pair("index", (int)it->first.index));
+        entry.push_back(Pair("satoshis", it->second));
+        entry.push_back(Pair("spending", it->first.spending));
+        result.push_back(entry);
+    }
+
+    if (nLimit > 0) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("history", result));
+        page.push_back(Pair("cursor", watchIndex.empty() ? end + 1 : watchIndex.back().first.blockHeight + 1));
+        page.push_back(Pair("done", (int)watchIndex.size() < nLimit));
+        return page;
+    }
+
+    return result;
+}
+
 UniValue getspentinfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
 
@@ -1643,6 +2119,7 @@ static const CRPCCommand commands[] =
     { "util",               "createmultisig",         &createmultisig,         true  },
     { "util",               "verifymessage",          &verifymessage,          true  },
     { "util",               "getcheckpoint",          &getcheckpoint,          true  },
+    { "util",               "getlockstats",           &getlockstats,           true  },
 
     /* Not shown in help */
     { "hidden",             "setmocktime",            &setmocktime,            true  },
@@ -93,6 +93,9 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
             "    \"lastsend\": ttt,           (numeric) The time in seconds since epoch (Jan 1 1970 GMT) of the last send\n"
             "    \"lastrecv\": ttt,           (numeric) The time in seconds since epoch (Jan 1 1970 GMT) of the last receive\n"
             "    \"bytessent\": n,            (numeric) The total bytes sent\n"
+            "    \"bytessent_consensus\": n,  (numeric) Bytes sent as consensus-critical traffic (headers, pings)\n"
+            "    \"bytessent_relay\": n,      (numeric) Bytes sent as tx/inv relay traffic\n"
+            "    \"bytessent_bulk\": n,       (numeric) Bytes sent as bulk block transfer\n"
             "    \"bytesrecv\": n,            (numeric) The total bytes received\n"
             "    \"conntime\": ttt,           (numeric) The connection time in seconds since epoch (Jan 1 1970 GMT)\n"
             "  \"timeoffset\": xxxxx,         (numeric) the time offset (deprecated; always 0)\n"
@@ -141,6 +144,9 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
         obj.push_back(Pair("lastsend", stats.nLastSend));
         obj.push_back(Pair("lastrecv", stats.nLastRecv));
         obj.push_back(Pair("bytessent", stats.nSendBytes));
+        obj.push_back(Pair("bytessent_consensus", stats.nSendBytesPerClass[TRAFFIC_CONSENSUS]));
+        obj.push_back(Pair("bytessent_relay", stats.nSendBytesPerClass[TRAFFIC_RELAY]));
+        obj.push_back(Pair("bytessent_bulk", stats.nSendBytesPerClass[TRAFFIC_BULK]));
         obj.push_back(Pair("bytesrecv", stats.nRecvBytes));
         obj.push_back(Pair("conntime", stats.nTimeConnected));
         obj.push_back(Pair("timeoffset",    0));
@@ -357,12 +357,12 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
             UniValue o(UniValue::VOBJ);
             o.push_back(Pair("asm", ScriptToAsmStr(txin.scriptSig, true)));
             o.push_back(Pair("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end())));
-            in.push_back(Pair("scriptSig", o));
+            in.push_back(Pair("scriptSig", std::move(o)));
         }
         in.push_back(Pair("sequence", (int64_t)txin.nSequence));
-        vin.push_back(in);
+        vin.push_back(std::move(in));
     }
-    entry.push_back(Pair("vin", vin));
+    entry.push_back(Pair("vin", std::move(vin)));
     UniValue vout(UniValue::VARR);
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     CBlockIndex *tipindex;//,*pindex = it->second;
@@ -381,13 +381,13 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
         out.push_back(Pair("n", (int64_t)i));
         UniValue o(UniValue::VOBJ);
         ScriptPubKeyToJSON(txout.scriptPubKey, o, true);
-        out.push_back(Pair("scriptPubKey", o));
-        vout.push_back(out);
+        out.push_back(Pair("scriptPubKey", std::move(o)));
+        vout.push_back(std::move(out));
     }
-    entry.push_back(Pair("vout", vout));
+    entry.push_back(Pair("vout", std::move(vout)));
 
     UniValue vjoinsplit = TxJoinSplitToJSON(tx);
-    entry.push_back(Pair("vjoinsplit", vjoinsplit));
+    entry.push_back(Pair("vjoinsplit", std::move(vjoinsplit)));
 
     if (tx.fOverwintered && tx.nVersion >= SAPLING_TX_VERSION) {
         entry.push_back(Pair("valueBalance", ValueFromAmount(tx.valueBalance)));
@@ -558,6 +558,46 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp, const CPubKey& my
     return result;
 }
 
+UniValue gettransactionbatch(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "gettransactionbatch [\"txid\",...]\n"
+            "\nFetches several raw transactions in one call. Requires -txindex. The requested\n"
+            "transactions are read in block file order instead of request order, so large\n"
+            "randomly-ordered batches avoid pathological seek behavior.\n"
+            "\nArguments:\n"
+            "1. \"txids\"         (array, required) the transaction ids\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"txid\": \"hex\",   (string) serialized transaction data, or null if not found\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("gettransactionbatch", "'[\"mytxid1\",\"mytxid2\"]'")
+            + HelpExampleRpc("gettransactionbatch", "[\"mytxid1\",\"mytxid2\"]")
+        );
+
+    UniValue txids = params[0].get_array();
+
+    if (!fTxIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "gettransactionbatch requires -txindex");
+
+    std::vector<uint256> vtxid;
+    vtxid.reserve(txids.size());
+    for (size_t i = 0; i < txids.size(); i++)
+        vtxid.push_back(ParseHashV(txids[i], "txid"));
+
+    std::vector<CTransaction> vtx;
+    std::vector<uint256> vhashBlock;
+    GetTransactions(vtxid, vtx, vhashBlock);
+
+    UniValue result(UniValue::VOBJ);
+    for (size_t i = 0; i < vtxid.size(); i++)
+        result.push_back(Pair(vtxid[i].GetHex(), vtx[i].IsNull() ? NullUniValue : UniValue(EncodeHexTx(vtx[i]))));
+    return result;
+}
+
 UniValue gettxoutproof(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     if (fHelp || (params.size() != 1 && params.size() != 2))
@@ -1349,6 +1389,7 @@ static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
     { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
+    { "rawtransactions",    "gettransactionbatch",    &gettransactionbatch,    true  },
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true  },
     { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
     { "rawtransactions",    "decodescript",           &decodescript,           true  },
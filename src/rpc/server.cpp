@@ -20,6 +20,7 @@
 
 #include "rpc/server.h"
 
+#include "httpserver.h"
 #include "init.h"
 #include "key_io.h"
 #include "random.h"
@@ -30,6 +31,7 @@
 #include "asyncrpcqueue.h"
 #include "assetchain.h"
 
+#include <atomic>
 #include <memory>
 
 #include <univalue.h>
@@ -66,6 +68,60 @@ static struct CRPCSignals
     boost::signals2::signal<void (const CRPCCommand&)> PostCommand;
 } g_rpcSignals;
 
+/**
+ * Per-method RPC call statistics. The counters are plain atomics so the call
+ * path stays lock-free; cs_rpcStats only guards the name -> entry map, which
+ * is consulted once per call to resolve the entry pointer. Entries are never
+ * freed, so a resolved pointer stays valid without the lock.
+ */
+static const int RPC_LATENCY_BUCKETS = 20;
+
+struct RPCMethodStats
+{
+    std::atomic<uint64_t> nCalls;
+    std::atomic<uint64_t> nErrors;
+    std::atomic<uint64_t> nTotalMicros;
+    std::atomic<uint64_t> nMaxMicros;
+    //! bucket i counts calls that took [2^(i-1), 2^i) microseconds
+    //! (bucket 0: sub-microsecond; last bucket: everything slower)
+    std::atomic<uint64_t> nBucket[RPC_LATENCY_BUCKETS];
+
+    RPCMethodStats() : nCalls(0), nErrors(0), nTotalMicros(0), nMaxMicros(0)
+    {
+        for (int i = 0; i < RPC_LATENCY_BUCKETS; i++)
+            nBucket[i] = 0;
+    }
+};
+
+static CCriticalSection cs_rpcStats;
+static std::map<std::string, RPCMethodStats*> mapRpcStats;
+
+static RPCMethodStats* GetMethodStats(const std::string& strMethod)
+{
+    LOCK(cs_rpcStats);
+    RPCMethodStats*& entry = mapRpcStats[strMethod];
+    if (entry == NULL)
+        entry = new RPCMethodStats();
+    return entry;
+}
+
+static void RPCRecordCall(RPCMethodStats* stats, int64_t nMicros, bool fError)
+{
+    if (nMicros < 0)
+        nMicros = 0;
+    stats->nCalls.fetch_add(1, std::memory_order_relaxed);
+    if (fError)
+        stats->nErrors.fetch_add(1, std::memory_order_relaxed);
+    stats->nTotalMicros.fetch_add((uint64_t)nMicros, std::memory_order_relaxed);
+    uint64_t nPrevMax = stats->nMaxMicros.load(std::memory_order_relaxed);
+    while ((uint64_t)nMicros > nPrevMax &&
+           !stats->nMaxMicros.compare_exchange_weak(nPrevMax, (uint64_t)nMicros)) {}
+    int nBucket = 0;
+    while (nBucket < RPC_LATENCY_BUCKETS - 1 && (uint64_t)nMicros >= ((uint64_t)1 << nBucket))
+        nBucket++;
+    stats->nBucket[nBucket].fetch_add(1, std::memory_order_relaxed);
+}
+
 void RPCServer::OnStarted(boost::function<void ()> slot)
 {
     g_rpcSignals.Started.connect(slot);
@@ -283,18 +339,117 @@ UniValue stop(const UniValue& params, bool fHelp, const CPubKey& mypk)
     return buf;
 }
 
+UniValue getrpcstats(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getrpcstats\n"
+            "\nReturns per-method RPC call counts and latency statistics, plus the\n"
+            "current depth of the HTTP work queue. Latency buckets are powers of two\n"
+            "in microseconds: bucket i counts calls that took between 2^(i-1) and 2^i\n"
+            "microseconds; the last bucket collects everything slower.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"workqueuedepth\": n,        (numeric) requests waiting for an RPC worker\n"
+            "  \"methods\": {\n"
+            "    \"getblock\": {\n"
+            "      \"calls\": n,             (numeric) completed calls\n"
+            "      \"errors\": n,            (numeric) calls that returned an error\n"
+            "      \"totalms\": x,           (numeric) total time spent, milliseconds\n"
+            "      \"avgms\": x,             (numeric) mean latency, milliseconds\n"
+            "      \"maxms\": x,             (numeric) worst latency, milliseconds\n"
+            "      \"buckets\": [n, ...]     (array) latency histogram, see above\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcstats", "")
+            + HelpExampleRpc("getrpcstats", "")
+        );
+
+    std::vector<std::pair<std::string, RPCMethodStats*> > vStats;
+    {
+        LOCK(cs_rpcStats);
+        vStats.assign(mapRpcStats.begin(), mapRpcStats.end());
+    }
+
+    UniValue methods(UniValue::VOBJ);
+    BOOST_FOREACH(const PAIRTYPE(std::string, RPCMethodStats*)& item, vStats)
+    {
+        const RPCMethodStats* stats = item.second;
+        uint64_t nCalls = stats->nCalls.load();
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("calls", nCalls));
+        entry.push_back(Pair("errors", stats->nErrors.load()));
+        entry.push_back(Pair("totalms", stats->nTotalMicros.load() / 1000.0));
+        entry.push_back(Pair("avgms", nCalls ? stats->nTotalMicros.load() / 1000.0 / nCalls : 0.0));
+        entry.push_back(Pair("maxms", stats->nMaxMicros.load() / 1000.0));
+        UniValue buckets(UniValue::VARR);
+        for (int i = 0; i < RPC_LATENCY_BUCKETS; i++)
+            buckets.push_back(stats->nBucket[i].load());
+        entry.push_back(Pair("buckets", buckets));
+        methods.push_back(Pair(item.first, entry));
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("workqueuedepth", (uint64_t)HTTPWorkQueueDepth()));
+    ret.push_back(Pair("methods", methods));
+    return ret;
+}
+
+std::string RPCMetricsPrometheusText()
+{
+    std::vector<std::pair<std::string, RPCMethodStats*> > vStats;
+    {
+        LOCK(cs_rpcStats);
+        vStats.assign(mapRpcStats.begin(), mapRpcStats.end());
+    }
+
+    std::string out;
+    out += "# TYPE komodod_rpc_workqueue_depth gauge\n";
+    out += strprintf("komodod_rpc_workqueue_depth %u\n", (unsigned int)HTTPWorkQueueDepth());
+    out += "# TYPE komodod_rpc_calls_total counter\n";
+    BOOST_FOREACH(const PAIRTYPE(std::string, RPCMethodStats*)& item, vStats)
+        out += strprintf("komodod_rpc_calls_total{method=\"%s\"} %llu\n",
+                         item.first, (unsigned long long)item.second->nCalls.load());
+    out += "# TYPE komodod_rpc_errors_total counter\n";
+    BOOST_FOREACH(const PAIRTYPE(std::string, RPCMethodStats*)& item, vStats)
+        out += strprintf("komodod_rpc_errors_total{method=\"%s\"} %llu\n",
+                         item.first, (unsigned long long)item.second->nErrors.load());
+    out += "# TYPE komodod_rpc_latency_microseconds histogram\n";
+    BOOST_FOREACH(const PAIRTYPE(std::string, RPCMethodStats*)& item, vStats)
+    {
+        const RPCMethodStats* stats = item.second;
+        uint64_t nCumulative = 0;
+        for (int i = 0; i < RPC_LATENCY_BUCKETS - 1; i++)
+        {
+            nCumulative += stats->nBucket[i].load();
+            out += strprintf("komodod_rpc_latency_microseconds_bucket{method=\"%s\",le=\"%llu\"} %llu\n",
+                             item.first, (unsigned long long)1 << i, (unsigned long long)nCumulative);
+        }
+        out += strprintf("komodod_rpc_latency_microseconds_bucket{method=\"%s\",le=\"+Inf\"} %llu\n",
+                         item.first, (unsigned long long)stats->nCalls.load());
+        out += strprintf("komodod_rpc_latency_microseconds_sum{method=\"%s\"} %llu\n",
+                         item.first, (unsigned long long)stats->nTotalMicros.load());
+        out += strprintf("komodod_rpc_latency_microseconds_count{method=\"%s\"} %llu\n",
+                         item.first, (unsigned long long)stats->nCalls.load());
+    }
+    return out;
+}
+
 /**
  * Call Table
  */
 static const CRPCCommand vRPCCommands[] =
-{ //  category              name                      actor (function)         okSafeMode
-  //  --------------------- ------------------------  -----------------------  ----------
+{ //  category              name                      actor (function)         okSafeMode, readOnly
+  //  --------------------- ------------------------  -----------------------  ----------------------
     /* Overall control/query calls */
     { "control",            "help",                   &help,                   true  },
     { "control",            "getiguanajson",          &getiguanajson,          true  },
     { "control",            "getnotarysendmany",      &getnotarysendmany,      true  },
     { "control",            "geterablockheights",     &geterablockheights,     true  },
     { "control",            "stop",                   &stop,                   true  },
+    { "control",            "getrpcstats",            &getrpcstats,            true, true },
 
     /* P2P networking */
     { "network",            "getnetworkinfo",         &getnetworkinfo,         true  },
@@ -313,21 +468,21 @@ static const CRPCCommand vRPCCommands[] =
     /* Block chain and UTXO */
     { "blockchain",         "coinsupply",             &coinsupply,             true  },
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
-    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
-    { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
+    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true, true  },
+    { "blockchain",         "getblockcount",          &getblockcount,          true, true  },
+    { "blockchain",         "getblock",               &getblock,               true, true  },
     { "blockchain",         "getblockdeltas",         &getblockdeltas,         false },
     { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
-    { "blockchain",         "getblockhash",           &getblockhash,           true  },
-    { "blockchain",         "getblockheader",         &getblockheader,         true  },
+    { "blockchain",         "getblockhash",           &getblockhash,           true, true  },
+    { "blockchain",         "getblockheader",         &getblockheader,         true, true  },
     { "blockchain",         "getlastsegidstakes",     &getlastsegidstakes,     true  },
-    { "blockchain",         "getchaintips",           &getchaintips,           true  },
-    { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
-    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
-    { "blockchain",         "gettxout",               &gettxout,               true  },
-    { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
-    { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
+    { "blockchain",         "getchaintips",           &getchaintips,           true, true  },
+    { "blockchain",         "getdifficulty",          &getdifficulty,          true, true  },
+    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true, true  },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true, true  },
+    { "blockchain",         "gettxout",               &gettxout,               true, true  },
+    { "blockchain",         "gettxoutproof",          &gettxoutproof,          true, true  },
+    { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true, true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
     { "blockchain",         "getspentinfo",           &getspentinfo,           false },
@@ -390,9 +545,9 @@ static const CRPCCommand vRPCCommands[] =
 
     /* Raw transactions */
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true  },
-    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
-    { "rawtransactions",    "decodescript",           &decodescript,           true  },
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
+    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true, true  },
+    { "rawtransactions",    "decodescript",           &decodescript,           true, true  },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true, true  },
     { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false },
     { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false }, /* uses wallet if enabled */
 #ifdef ENABLE_WALLET
@@ -472,6 +627,7 @@ static const CRPCCommand vRPCCommands[] =
     { "oracles",       "oraclesdata",      &oraclesdata,        true },
     { "oracles",       "oraclessample",   &oraclessample,     true },
     { "oracles",       "oraclessamples",   &oraclessamples,     true },
+    { "oracles",       "oracleslatest",    &oracleslatest,      true },
 
     // Payments
     { "payments",       "paymentsaddress",   &paymentsaddress,       true },
@@ -524,6 +680,7 @@ static const CRPCCommand vRPCCommands[] =
     { "tokens",       "mytokenorders",    &mytokenorders,     true },
     { "tokens",       "tokenaddress",     &tokenaddress,      true },
     { "tokens",       "tokenbalance",     &tokenbalance,      true },
+    { "tokens",       "tokenbalancebatch", &tokenbalancebatch, true },
     { "tokens",       "tokencreate",      &tokencreate,       true },
     { "tokens",       "tokentransfer",    &tokentransfer,     true },
     { "tokens",       "tokenbid",         &tokenbid,          true },
@@ -547,6 +704,12 @@ static const CRPCCommand vRPCCommands[] =
     { "addressindex",       "getaddressbalance",      &getaddressbalance,      false },
     { "addressindex",       "getsnapshot",            &getsnapshot,            false },
 
+    /* Watch index (wallet-independent address tracking) */
+    { "watchindex",         "watchaddress",           &watchaddress,           true  },
+    { "watchindex",         "unwatchaddress",         &unwatchaddress,         true  },
+    { "watchindex",         "listwatchedaddresses",   &listwatchedaddresses,   true  },
+    { "watchindex",         "getwatchhistory",        &getwatchhistory,        false },
+
     /* Utility functions */
     { "util",               "createmultisig",         &createmultisig,         true  },
     { "util",               "validateaddress",        &validateaddress,        true  }, /* uses wallet if enabled */
@@ -680,20 +843,16 @@ bool StartRPC()
     fRPCRunning = true;
     g_rpcSignals.Started();
 
-    // Launch one async rpc worker.  The ability to launch multiple workers is not recommended at present and thus the option is disabled.
-    getAsyncRPCQueue()->addWorker();
-/*
+    // Launch the async rpc workers. Operations whose conflict keys intersect
+    // (e.g. two z_sendmany from the same address) are still serialized by the
+    // queue, so extra workers only parallelize independent operations.
     int n = GetArg("-rpcasyncthreads", 1);
-    if (n<1) {
+    if (n < 1) {
         LogPrintf("ERROR: Invalid value %d for -rpcasyncthreads.  Must be at least 1.\n", n);
-        strerr = strprintf(_("An error occurred while setting up the Async RPC threads, invalid parameter value of %d (must be at least 1)."), n);
-        uiInterface.ThreadSafeMessageBox(strerr, "", CClientUIInterface::MSG_ERROR);
-        StartShutdown();
-        return;
+        n = 1;
     }
     for (int i = 0; i < n; i++)
         getAsyncRPCQueue()->addWorker();
-*/
     return true;
 }
 
@@ -795,11 +954,61 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
+/** Whether a batch element invokes a handler marked read-only in the
+ * dispatch table, and may therefore run concurrently with its peers. */
+static bool RPCIsReadOnly(const UniValue& req)
+{
+    if (!req.isObject())
+        return false;
+    UniValue valMethod = find_value(req, "method");
+    if (!valMethod.isStr())
+        return false;
+    const CRPCCommand* pcmd = tableRPC[valMethod.get_str()];
+    return pcmd != NULL && pcmd->readOnly;
+}
+
 std::string JSONRPCExecBatch(const UniValue& vReq)
 {
+    std::vector<UniValue> vResults(vReq.size());
+
+    // Elements with read-only handlers run concurrently so batch latency is
+    // bounded by the slowest call; everything else runs in submission order
+    // on this thread afterwards
+    std::vector<size_t> vConcurrent;
+    std::vector<size_t> vSerial;
+    for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++) {
+        if (RPCIsReadOnly(vReq[reqIdx]))
+            vConcurrent.push_back(reqIdx);
+        else
+            vSerial.push_back(reqIdx);
+    }
+
+    int nThreads = (int)std::min((size_t)GetNumCores(), vConcurrent.size());
+    if (nThreads >= 2) {
+        std::atomic<size_t> nNext(0);
+        auto worker = [&vReq, &vResults, &vConcurrent, &nNext]() {
+            size_t n;
+            while ((n = nNext.fetch_add(1)) < vConcurrent.size()) {
+                size_t reqIdx = vConcurrent[n];
+                vResults[reqIdx] = JSONRPCExecOne(vReq[reqIdx]);
+            }
+        };
+        boost::thread_group threads;
+        for (int t = 1; t < nThreads; t++)
+            threads.create_thread(worker);
+        worker();
+        threads.join_all();
+    } else {
+        BOOST_FOREACH(size_t reqIdx, vConcurrent)
+            vResults[reqIdx] = JSONRPCExecOne(vReq[reqIdx]);
+    }
+    BOOST_FOREACH(size_t reqIdx, vSerial)
+        vResults[reqIdx] = JSONRPCExecOne(vReq[reqIdx]);
+
+    // Replies go back in request order regardless of execution order
     UniValue ret(UniValue::VARR);
-    for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    for (size_t reqIdx = 0; reqIdx < vResults.size(); reqIdx++)
+        ret.push_back(std::move(vResults[reqIdx]));
 
     return ret.write() + "\n";
 }
@@ -822,13 +1031,25 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
 
     g_rpcSignals.PreCommand(*pcmd);
 
+    RPCMethodStats* stats = GetMethodStats(strMethod);
+    int64_t nStart = GetTimeMicros();
+
     try
     {
         // Execute
-        return pcmd->actor(params, false, CPubKey());
+        UniValue result = pcmd->actor(params, false, CPubKey());
+        RPCRecordCall(stats, GetTimeMicros() - nStart, false);
+        return result;
+    }
+    catch (const UniValue& e)
+    {
+        // JSONRPCError from the handler
+        RPCRecordCall(stats, GetTimeMicros() - nStart, true);
+        throw;
     }
     catch (const std::exception& e)
     {
+        RPCRecordCall(stats, GetTimeMicros() - nStart, true);
         throw JSONRPCError(RPC_MISC_ERROR, e.what());
     }
 
@@ -142,6 +142,10 @@ public:
     std::string name;
     rpcfn_type actor;
     bool okSafeMode;
+    //! Handler has no side effects and takes any locks it needs itself, so
+    //! several batch elements calling it may execute concurrently. Commands
+    //! without an explicit entry in the dispatch table default to false.
+    bool readOnly;
 };
 
 /**
@@ -200,6 +204,8 @@ bool StartRPC();
 void InterruptRPC();
 void StopRPC();
 std::string JSONRPCExecBatch(const UniValue& vReq);
+/** Per-method call/latency metrics in Prometheus text exposition format */
+std::string RPCMetricsPrometheusText();
 
 extern std::string experimentalDisabledHelpMsg(const std::string& rpc, const std::string& enableArg);
 
@@ -208,6 +214,10 @@ extern UniValue getaddressmempool(const UniValue& params, bool fHelp, const CPub
 extern UniValue getaddressutxos(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue getaddressdeltas(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue getaddresstxids(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue watchaddress(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue unwatchaddress(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue listwatchedaddresses(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue getwatchhistory(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue getsnapshot(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue getaddressbalance(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue getpeerinfo(const UniValue& params, bool fHelp, const CPubKey& mypk);
@@ -246,6 +256,7 @@ extern UniValue tokenlist(const UniValue& params, bool fHelp, const CPubKey& myp
 extern UniValue tokenorders(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue mytokenorders(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue tokenbalance(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue tokenbalancebatch(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue assetsaddress(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue tokenaddress(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue tokencreate(const UniValue& params, bool fHelp, const CPubKey& mypk);
@@ -274,6 +285,7 @@ extern UniValue oraclessubscribe(const UniValue& params, bool fHelp, const CPubK
 extern UniValue oraclesdata(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue oraclessample(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue oraclessamples(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue oracleslatest(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue paymentsaddress(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue payments_release(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue payments_fund(const UniValue& params, bool fHelp, const CPubKey& mypk);
@@ -1182,6 +1182,9 @@ uint256 GetShieldedOutputsHash(const CTransaction& txTo) {
 } // anon namespace
 
 PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
+    : sighashMidstate(SER_GETHASH, 0, ZCASH_PREVOUTS_HASH_PERSONALIZATION), // placeholder until PrepareSighash
+      sighashMidstateBranchId(0),
+      fSighashMidstateSet(false)
 {
     hashPrevouts = GetPrevoutHash(txTo);
     hashSequence = GetSequenceHash(txTo);
@@ -1204,6 +1207,43 @@ SigVersion SignatureHashVersion(const CTransaction& txTo)
     }
 }
 
+void PrecomputedTransactionData::PrepareSighash(const CTransaction& txTo, uint32_t consensusBranchId)
+{
+    auto sigversion = SignatureHashVersion(txTo);
+    if (sigversion != SIGVERSION_OVERWINTER && sigversion != SIGVERSION_SAPLING)
+        return;
+
+    uint32_t leConsensusBranchId = htole32(consensusBranchId);
+    unsigned char personalization[16] = {};
+    memcpy(personalization, "ZcashSigHash", 12);
+    memcpy(personalization+12, &leConsensusBranchId, 4);
+
+    // The same writes SignatureHash performs before the per-input data, for
+    // SIGHASH_ALL: every sub-hash is included, with the zero hash standing
+    // in for absent shielded components exactly as there.
+    CBLAKE2bWriter ss(SER_GETHASH, 0, personalization);
+    ss << txTo.GetHeader();
+    ss << txTo.nVersionGroupId;
+    ss << hashPrevouts;
+    ss << hashSequence;
+    ss << hashOutputs;
+    ss << (txTo.vjoinsplit.empty() ? uint256() : hashJoinSplits);
+    if (sigversion == SIGVERSION_SAPLING) {
+        ss << (txTo.vShieldedSpend.empty() ? uint256() : hashShieldedSpends);
+        ss << (txTo.vShieldedOutput.empty() ? uint256() : hashShieldedOutputs);
+    }
+    ss << txTo.nLockTime;
+    ss << txTo.nExpiryHeight;
+    if (sigversion == SIGVERSION_SAPLING) {
+        ss << txTo.valueBalance;
+    }
+    ss << (int)SIGHASH_ALL;
+
+    sighashMidstate = ss;
+    sighashMidstateBranchId = consensusBranchId;
+    fSighashMidstateSet = true;
+}
+
 /*****
  * Generate a signature hash 
  * @param scriptCode the scriptPubKey
@@ -1232,6 +1272,21 @@ uint256 SignatureHash(
     auto sigversion = SignatureHashVersion(txTo);
 
     if (sigversion == SIGVERSION_OVERWINTER || sigversion == SIGVERSION_SAPLING) {
+        // The whole prefix before the per-input data is fixed for SIGHASH_ALL
+        // under one branch id; resume from the primed midstate and hash only
+        // this input's contribution.
+        if (cache && cache->fSighashMidstateSet && nHashType == SIGHASH_ALL &&
+            cache->sighashMidstateBranchId == consensusBranchId) {
+            CBLAKE2bWriter ss = cache->sighashMidstate;
+            if (nIn != NOT_AN_INPUT) {
+                ss << txTo.vin[nIn].prevout;
+                ss << static_cast<const CScriptBase&>(scriptCode);
+                ss << amount;
+                ss << txTo.vin[nIn].nSequence;
+            }
+            return ss.GetHash();
+        }
+
         uint256 hashPrevouts;
         uint256 hashSequence;
         uint256 hashOutputs;
@@ -1492,10 +1547,73 @@ bool EvalCryptoConditionSig(
         return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
 
     stack.push_back(vchPushValue);
-    
+
     return true;
 }
 
+/*****
+ * Match a pay-to-pubkey-hash spend: a scriptSig made of exactly two direct
+ * pushes (signature, then pubkey) against the 25-byte P2PKH template. Direct
+ * pushes of two or more bytes always satisfy CheckMinimalPush, so a match
+ * carries no flag-dependent parsing behaviour.
+ * @param scriptSig the spending script
+ * @param scriptPubKey the script being spent
+ * @param[out] vchSig the pushed signature
+ * @param[out] vchPubKey the pushed pubkey
+ * @returns true if both scripts fit the template
+ */
+bool static MatchP2PKHSpend(
+    const CScript& scriptSig,
+    const CScript& scriptPubKey,
+    valtype& vchSig,
+    valtype& vchPubKey)
+{
+    if (!scriptPubKey.IsPayToPublicKeyHash())
+        return false;
+
+    CScript::const_iterator pc = scriptSig.begin();
+    opcodetype opcode;
+    if (!scriptSig.GetOp(pc, opcode, vchSig) || opcode != vchSig.size() || vchSig.size() < 2)
+        return false;
+    if (!scriptSig.GetOp(pc, opcode, vchPubKey) || opcode != vchPubKey.size() || vchPubKey.size() < 2)
+        return false;
+    return pc == scriptSig.end();
+}
+
+/*****
+ * Execute a matched P2PKH spend without dispatching through EvalScript. The
+ * template is fixed, so the opcode stream is known up front: the checks below
+ * are DUP / HASH160 / EQUALVERIFY / CHECKSIG in interpreter order, producing
+ * the same error codes the general loop would.
+ * @param vchSig the signature from the scriptSig
+ * @param vchPubKey the pubkey from the scriptSig
+ * @param scriptPubKey the script being spent (also the signed scriptCode)
+ * @param flags script verification flags
+ * @param checker the signature checker
+ * @param consensusBranchId the branch id
+ * @param serror filled with the script error on failure
+ * @returns true if the spend verifies
+ */
+bool static VerifyP2PKHSpend(
+    const valtype& vchSig,
+    const valtype& vchPubKey,
+    const CScript& scriptPubKey,
+    unsigned int flags,
+    const BaseSignatureChecker& checker,
+    uint32_t consensusBranchId,
+    ScriptError* serror)
+{
+    valtype vchHash(20);
+    CHash160().Write(begin_ptr(vchPubKey), vchPubKey.size()).Finalize(begin_ptr(vchHash));
+    if (memcmp(begin_ptr(vchHash), &scriptPubKey[3], 20) != 0)
+        return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+    if (!CheckSignatureEncoding(vchSig, flags, serror) || !CheckPubKeyEncoding(vchPubKey, flags, serror))
+        // serror is set
+        return false;
+    if (!checker.CheckSig(vchSig, vchPubKey, scriptPubKey, consensusBranchId))
+        return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+    return set_success(serror);
+}
 
 bool VerifyScript(
     const CScript& scriptSig,
@@ -1511,6 +1629,15 @@ bool VerifyScript(
         return set_error(serror, SCRIPT_ERR_SIG_PUSHONLY);
     }
 
+    // Fast path for the dominant spend type. P2PKH inputs dwarf everything
+    // else during initial block download, and their opcode stream never
+    // varies, so skip GetOp tokenization and the dispatch loop entirely.
+    {
+        valtype vchSig, vchPubKey;
+        if (MatchP2PKHSpend(scriptSig, scriptPubKey, vchSig, vchPubKey))
+            return VerifyP2PKHSpend(vchSig, vchPubKey, scriptPubKey, flags, checker, consensusBranchId, serror);
+    }
+
     vector<vector<unsigned char> > stack, stackCopy;
     if (IsCryptoConditionsEnabled() && scriptPubKey.IsPayToCryptoCondition()) {
         if (!EvalCryptoConditionSig(stack, scriptSig, serror))
@@ -21,6 +21,7 @@
 #ifndef BITCOIN_SCRIPT_INTERPRETER_H
 #define BITCOIN_SCRIPT_INTERPRETER_H
 
+#include "hash.h"
 #include "script_error.h"
 #include "primitives/transaction.h"
 #include "script/cc.h"
@@ -110,7 +111,20 @@ struct PrecomputedTransactionData
 {
     uint256 hashPrevouts, hashSequence, hashOutputs, hashJoinSplits, hashShieldedSpends, hashShieldedOutputs;
 
+    //! Midstate of the v3/v4 sighash over everything before the per-input
+    //! data, primed by PrepareSighash for SIGHASH_ALL under one consensus
+    //! branch. Written once before verification starts and read-only after
+    //! that, so parallel per-input checks can share it safely.
+    CBLAKE2bWriter sighashMidstate;
+    uint32_t sighashMidstateBranchId;
+    bool fSighashMidstateSet;
+
     PrecomputedTransactionData(const CTransaction& tx);
+
+    //! Capture the SIGHASH_ALL sighash prefix for consensusBranchId, making
+    //! the per-input sighash cost independent of input count. Only
+    //! meaningful for Overwinter/Sapling transactions; a no-op otherwise.
+    void PrepareSighash(const CTransaction& tx, uint32_t consensusBranchId);
 };
 
 enum SigVersion
@@ -396,6 +396,11 @@ protected:
 public:
     CScript() { }
     CScript(const CScript& b) : CScriptBase(b.begin(), b.end()) { }
+    // Moving steals the heap buffer (or copies the inline bytes), so growing
+    // vectors of CTxIn/CTxOut no longer reallocates every script.
+    CScript(CScript&& b) noexcept : CScriptBase(std::move(b)) { }
+    CScript& operator=(const CScript& b) = default;
+    CScript& operator=(CScript&& b) noexcept { CScriptBase::operator=(std::move(b)); return *this; }
     CScript(const_iterator pbegin, const_iterator pend) : CScriptBase(pbegin, pend) { }
     CScript(std::vector<unsigned char>::const_iterator pbegin, std::vector<unsigned char>::const_iterator pend) : CScriptBase(pbegin, pend) { }
     CScript(const unsigned char* pbegin, const unsigned char* pend) : CScriptBase(pbegin, pend) { }
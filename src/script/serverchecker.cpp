@@ -22,6 +22,7 @@
 #include "script/cc.h"
 #include "cc/eval.h"
 
+#include "hash.h"
 #include "pubkey.h"
 #include "random.h"
 #include "uint256.h"
@@ -90,6 +91,58 @@ public:
     }
 };
 
+/**
+ * Verified crypto-condition cache, the sigcache analogue for CC spends: a
+ * fulfillment whose signature tree already verified against a sighash in
+ * mempool acceptance does not need its secp256k1/ed25519 trees re-verified
+ * in block connection. Only the context-free work is cached — Eval nodes
+ * consult chain state through RunCCEval and are re-run on every check.
+ */
+class CConditionCache
+{
+private:
+    //! conddata_type is (signature hash, condition binary hash, fulfillment binary hash):
+    typedef boost::tuple<uint256, uint256, uint256> conddata_type;
+    std::set<conddata_type> setValid;
+    boost::shared_mutex cs_conditioncache;
+
+public:
+    bool
+    Get(const uint256 &hash, const uint256 &condHash, const uint256 &ffillHash)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_conditioncache);
+
+        conddata_type k(hash, condHash, ffillHash);
+        return setValid.count(k) != 0;
+    }
+
+    void Set(const uint256 &hash, const uint256 &condHash, const uint256 &ffillHash)
+    {
+        // CC fulfillments are bulkier than plain signatures but the entries
+        // cached here are fixed-size digests, so the sigcache bound works
+        // here too (~100 bytes per entry).
+        int64_t nMaxCacheSize = GetArg("-maxconditioncachesize", 50000);
+        if (nMaxCacheSize <= 0) return;
+
+        boost::unique_lock<boost::shared_mutex> lock(cs_conditioncache);
+
+        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
+        {
+            // Evict a random entry, for the same DoS reasons as the
+            // signature cache above.
+            uint256 randomHash = GetRandHash();
+            std::set<conddata_type>::iterator it =
+                setValid.lower_bound(conddata_type(randomHash, uint256(), uint256()));
+            if (it == setValid.end())
+                it = setValid.begin();
+            setValid.erase(*it);
+        }
+
+        conddata_type k(hash, condHash, ffillHash);
+        setValid.insert(k);
+    }
+};
+
 }
 
 bool ServerTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
@@ -107,6 +160,58 @@ bool ServerTransactionSignatureChecker::VerifySignature(const std::vector<unsign
     return true;
 }
 
+int ServerTransactionSignatureChecker::CheckCryptoCondition(
+        const std::vector<unsigned char>& condBin,
+        const std::vector<unsigned char>& ffillBin,
+        const CScript& scriptCode,
+        uint32_t consensusBranchId) const
+{
+    static CConditionCache conditionCache;
+
+    // Hash type is one byte tacked on to the end of the fulfillment
+    if (ffillBin.empty())
+        return false;
+
+    CC *cond;
+    int error = cc_readFulfillmentBinaryExt((unsigned char*)ffillBin.data(), ffillBin.size()-1, &cond);
+    if (error || !cond) return -1;
+
+    if (!IsSupportedCryptoCondition(cond) || !IsSignedCryptoCondition(cond)) {
+        cc_free(cond);
+        return 0;
+    }
+
+    uint256 sighash;
+    int nHashType = ffillBin.back();
+    try {
+        sighash = SignatureHash(CCPubKey(cond), *txTo, nIn, nHashType, amount, consensusBranchId, this->txdata);
+    } catch (const std::logic_error& ex) {
+        cc_free(cond);
+        return 0;
+    }
+
+    VerifyEval eval = [] (CC *cond, void *checker) {
+        return ((TransactionSignatureChecker*)checker)->CheckEvalCondition(cond);
+    };
+
+    uint256 condHash = Hash(condBin.begin(), condBin.end());
+    uint256 ffillHash = Hash(ffillBin.begin(), ffillBin.end());
+
+    int out;
+    if (conditionCache.Get(sighash, condHash, ffillHash)) {
+        // The condition/fulfillment pair already verified against this
+        // sighash; only the chain-state-dependent Eval nodes need re-running.
+        out = cc_verifyEval(cond, eval, (void*)this);
+    } else {
+        out = cc_verify(cond, (const unsigned char*)&sighash, 32, 0,
+                        condBin.data(), condBin.size(), eval, (void*)this);
+        if (out && store)
+            conditionCache.Set(sighash, condHash, ffillHash);
+    }
+    cc_free(cond);
+    return out;
+}
+
 /*
  * The reason that these functions are here is that the what used to be the
  * CachingTransactionSignatureChecker, now the ServerTransactionSignatureChecker,
@@ -27,6 +27,7 @@
 #ifdef _WIN32
 #undef __cpuid
 #endif
+#include <boost/foreach.hpp>
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
 
@@ -36,40 +37,73 @@ namespace {
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * The cache is split into independently-locked shards selected by the
+ * signature hash, so parallel script-check threads that miss on different
+ * shards no longer serialize on a single writer lock when inserting.
  */
 class CSignatureCache
 {
-private:
-     //! sigdata_type is (signature hash, signature, public key):
+public:
+    //! sigdata_type is (signature hash, signature, public key):
     typedef boost::tuple<uint256, std::vector<unsigned char>, CPubKey> sigdata_type;
-    std::set< sigdata_type> setValid;
-    boost::shared_mutex cs_sigcache;
+
+    //! Number of shards; enough that 16+ threads rarely collide, while
+    //! keeping the per-shard eviction sets reasonably deep.
+    static const size_t nShards = 16;
+
+private:
+    struct CSigCacheShard {
+        std::set<sigdata_type> setValid;
+        boost::shared_mutex cs_sigcache;
+    };
+    CSigCacheShard shards[nShards];
+
+    //! Maximum entries per shard; bounds total memory to roughly
+    //! nShards * nShardLimit * 200 bytes.
+    static int64_t ShardLimit()
+    {
+        // -sigcachesize bounds each shard directly; the legacy
+        // -maxsigcachesize remains as a whole-cache bound for existing
+        // configurations. Neither can change after startup.
+        static const int64_t nLimit = GetArg("-sigcachesize",
+            GetArg("-maxsigcachesize", 50000) / (int64_t)nShards);
+        return nLimit;
+    }
 
 public:
+    static size_t ShardFor(const uint256& hash)
+    {
+        return (size_t)(hash.GetCheapHash() % nShards);
+    }
+
     bool
     Get(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        CSigCacheShard& shard = shards[ShardFor(hash)];
+        boost::shared_lock<boost::shared_mutex> lock(shard.cs_sigcache);
 
         sigdata_type k(hash, vchSig, pubKey);
-        std::set<sigdata_type>::iterator mi = setValid.find(k);
-        if (mi != setValid.end())
+        std::set<sigdata_type>::iterator mi = shard.setValid.find(k);
+        if (mi != shard.setValid.end())
             return true;
         return false;
     }
 
-    void Set(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    //! Insert a batch of entries that all map to the same shard.
+    void SetBatch(size_t nShard, std::vector<sigdata_type>& vEntries)
     {
         // DoS prevention: limit cache size to less than 10MB
         // (~200 bytes per cache entry times 50,000 entries)
         // Since there can be no more than 20,000 signature operations per block
         // 50,000 is a reasonable default.
-        int64_t nMaxCacheSize = GetArg("-maxsigcachesize", 50000);
-        if (nMaxCacheSize <= 0) return;
+        int64_t nShardLimit = ShardLimit();
+        if (nShardLimit <= 0) return;
 
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        CSigCacheShard& shard = shards[nShard];
+        boost::unique_lock<boost::shared_mutex> lock(shard.cs_sigcache);
 
-        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
+        while (static_cast<int64_t>(shard.setValid.size()) + static_cast<int64_t>(vEntries.size()) > nShardLimit)
         {
             // Evict a random entry. Random because that helps
             // foil would-be DoS attackers who might try to pre-generate
@@ -78,22 +112,34 @@ public:
             uint256 randomHash = GetRandHash();
             std::vector<unsigned char> unused;
             std::set<sigdata_type>::iterator it =
-                setValid.lower_bound(sigdata_type(randomHash, unused, unused));
-            if (it == setValid.end())
-                it = setValid.begin();
-            setValid.erase(*it);
+                shard.setValid.lower_bound(sigdata_type(randomHash, unused, unused));
+            if (it == shard.setValid.end())
+                it = shard.setValid.begin();
+            shard.setValid.erase(*it);
         }
 
-        sigdata_type k(hash, vchSig, pubKey);
-        setValid.insert(k);
+        BOOST_FOREACH (sigdata_type& k, vEntries)
+            shard.setValid.insert(k);
+        vEntries.clear();
     }
 };
 
+/**
+ * Per-thread buffer of freshly verified signatures awaiting insertion into
+ * the shared cache. Parallel script-check threads used to take the exclusive
+ * cache lock once per signature; buffering insertions lets each thread take
+ * it once per nSigBatchSize signatures instead. Entries only become visible
+ * to other threads once the owning thread's buffer flushes, which merely
+ * delays a cache hit and never affects verification results.
+ */
+static const size_t nSigBatchSize = 32;
+
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     static CSignatureCache signatureCache;
+    static thread_local std::vector<CSignatureCache::sigdata_type> vPendingWrites;
 
     if (signatureCache.Get(sighash, vchSig, pubkey))
         return true;
@@ -101,7 +147,19 @@ bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsig
     if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
         return false;
 
-    if (store)
-        signatureCache.Set(sighash, vchSig, pubkey);
+    if (store) {
+        vPendingWrites.push_back(CSignatureCache::sigdata_type(sighash, vchSig, pubkey));
+        if (vPendingWrites.size() >= nSigBatchSize) {
+            // Group the buffered entries by shard so each shard's writer
+            // lock is taken at most once per flush.
+            std::vector<CSignatureCache::sigdata_type> vShardEntries[CSignatureCache::nShards];
+            BOOST_FOREACH (CSignatureCache::sigdata_type& entry, vPendingWrites)
+                vShardEntries[CSignatureCache::ShardFor(entry.get<0>())].push_back(entry);
+            vPendingWrites.clear();
+            for (size_t i = 0; i < CSignatureCache::nShards; i++)
+                if (!vShardEntries[i].empty())
+                    signatureCache.SetBatch(i, vShardEntries[i]);
+        }
+    }
     return true;
 }
@@ -25,9 +25,13 @@
 #include "util.h"
 #include "utilstrencodings.h"
 #include "script/cc.h"
+#include "sync.h"
 
 #include <boost/foreach.hpp>
 
+#include <deque>
+#include <map>
+
 using namespace std;
 
 typedef vector<unsigned char> valtype;
@@ -212,7 +216,17 @@ static bool MatchMultisig(const CScript& script, unsigned int& required, std::ve
  * @param[out] vSolutionsRet results
  * @returns true on success
  */
-bool Solver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::vector<unsigned char> >& vSolutionsRet)
+/** Memoized classifications, keyed by the script itself. Hot scriptPubKeys
+ *  (exchange addresses, notary outputs) are classified over and over by
+ *  mempool policy, wallet ismine checks and the address indexer; the scripts
+ *  are a couple of dozen bytes so map lookups beat re-parsing. Read-mostly,
+ *  hence the shared lock. */
+#define SOLVER_CACHE_SIZE 4096
+static CSharedCriticalSection cs_solverCache;
+static std::map<CScript, std::pair<txnouttype, std::vector<valtype> > > mapSolverCache;
+static std::deque<CScript> solverCacheOrder; // FIFO eviction
+
+static bool SolverUncached(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::vector<unsigned char> >& vSolutionsRet)
 {
     vSolutionsRet.clear();
 
@@ -271,6 +285,7 @@ bool Solver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::v
                 }
                 return true;
             }
+            typeRet = TX_CRYPTOCONDITION;
             return false;
         }
     }
@@ -303,6 +318,38 @@ bool Solver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::v
     return false;
 }
 
+bool Solver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::vector<unsigned char> >& vSolutionsRet)
+{
+    {
+        READ_LOCK(cs_solverCache);
+        std::map<CScript, std::pair<txnouttype, std::vector<valtype> > >::iterator it = mapSolverCache.find(scriptPubKey);
+        if (it != mapSolverCache.end())
+        {
+            typeRet = it->second.first;
+            vSolutionsRet = it->second.second;
+            return(typeRet != TX_NONSTANDARD);
+        }
+    }
+    bool ret = SolverUncached(scriptPubKey, typeRet, vSolutionsRet);
+    // crypto-condition classification depends on komodo_is_vSolutionsFixActive(),
+    // which flips at a fork height, so those results are not memoized
+    if ( typeRet != TX_CRYPTOCONDITION )
+    {
+        WRITE_LOCK(cs_solverCache);
+        if ( mapSolverCache.count(scriptPubKey) == 0 )
+        {
+            while ( mapSolverCache.size() >= SOLVER_CACHE_SIZE )
+            {
+                mapSolverCache.erase(solverCacheOrder.front());
+                solverCacheOrder.pop_front();
+            }
+            mapSolverCache[scriptPubKey] = std::make_pair(typeRet, vSolutionsRet);
+            solverCacheOrder.push_back(scriptPubKey);
+        }
+    }
+    return(ret);
+}
+
 int ScriptSigArgsExpected(txnouttype t, const std::vector<std::vector<unsigned char> >& vSolutions)
 {
     switch (t)
@@ -35,6 +35,7 @@
 #include <stdint.h>
 #include <string>
 #include <string.h>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -516,6 +517,31 @@ public:
 template<typename I>
 CVarInt<I> WrapVarInt(I& n) { return CVarInt<I>(n); }
 
+/**
+ * Opt-in trait marking types whose serialized form is byte-for-byte identical
+ * to their in-memory representation on little-endian machines: every field is
+ * written in declaration order as raw little-endian bytes, and the type has no
+ * padding. Vectors of such types are then (un)serialized as a single block
+ * copy, the same way vectors of unsigned char already are, instead of walking
+ * each element through the generic path.
+ *
+ * Only specialize this for types where the equivalence genuinely holds. Types
+ * that reorder bytes for database iteration order (e.g. CAddressIndexKey) or
+ * use variable-length encodings (e.g. CDiskTxPos) must stay on the generic
+ * path.
+ */
+template <typename T>
+struct CMemcpySerialize : std::false_type {};
+
+#ifdef WORDS_BIGENDIAN
+/** The layout equivalence only holds on little-endian machines. */
+template <typename T>
+struct CMemcpySerializeEnabled : std::false_type {};
+#else
+template <typename T>
+struct CMemcpySerializeEnabled : CMemcpySerialize<T> {};
+#endif
+
 /**
  * Forward declarations
  */
@@ -543,9 +569,11 @@ template<typename Stream, unsigned int N, typename T> inline void Unserialize(St
  */
 template<typename Stream, typename T, typename A> void Serialize_impl(Stream& os, const std::vector<T, A>& v, const unsigned char&);
 template<typename Stream, typename T, typename A> void Serialize_impl(Stream& os, const std::vector<T, A>& v, const bool&);
+template<typename Stream, typename T, typename A> typename std::enable_if<CMemcpySerializeEnabled<T>::value>::type Serialize_impl(Stream& os, const std::vector<T, A>& v, const T&);
 template<typename Stream, typename T, typename A, typename V> void Serialize_impl(Stream& os, const std::vector<T, A>& v, const V&);
 template<typename Stream, typename T, typename A> inline void Serialize(Stream& os, const std::vector<T, A>& v);
 template<typename Stream, typename T, typename A> void Unserialize_impl(Stream& is, std::vector<T, A>& v, const unsigned char&);
+template<typename Stream, typename T, typename A> typename std::enable_if<CMemcpySerializeEnabled<T>::value>::type Unserialize_impl(Stream& is, std::vector<T, A>& v, const T&);
 template<typename Stream, typename T, typename A, typename V> void Unserialize_impl(Stream& is, std::vector<T, A>& v, const V&);
 template<typename Stream, typename T, typename A> inline void Unserialize(Stream& is, std::vector<T, A>& v);
 
@@ -731,6 +759,16 @@ void Serialize_impl(Stream& os, const std::vector<T, A>& v, const bool&)
     }
 }
 
+template<typename Stream, typename T, typename A>
+typename std::enable_if<CMemcpySerializeEnabled<T>::value>::type Serialize_impl(Stream& os, const std::vector<T, A>& v, const T&)
+{
+    // Types opted in via CMemcpySerialize serialize as one opaque blob,
+    // exactly like vectors of unsigned char above.
+    WriteCompactSize(os, v.size());
+    if (!v.empty())
+        os.write((char*)&v[0], v.size() * sizeof(T));
+}
+
 template<typename Stream, typename T, typename A, typename V>
 void Serialize_impl(Stream& os, const std::vector<T, A>& v, const V&)
 {
@@ -762,6 +800,22 @@ void Unserialize_impl(Stream& is, std::vector<T, A>& v, const unsigned char&)
     }
 }
 
+template<typename Stream, typename T, typename A>
+typename std::enable_if<CMemcpySerializeEnabled<T>::value>::type Unserialize_impl(Stream& is, std::vector<T, A>& v, const T&)
+{
+    // Limit size per read so bogus size value won't cause out of memory
+    v.clear();
+    unsigned int nSize = ReadCompactSize(is);
+    unsigned int i = 0;
+    while (i < nSize)
+    {
+        unsigned int blk = std::min(nSize - i, (unsigned int)(1 + 4999999 / sizeof(T)));
+        v.resize(i + blk);
+        is.read((char*)&v[i], blk * sizeof(T));
+        i += blk;
+    }
+}
+
 template<typename Stream, typename T, typename A, typename V>
 void Unserialize_impl(Stream& is, std::vector<T, A>& v, const V&)
 {
@@ -0,0 +1,597 @@
+// Copyright (c) 2016 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "stratum.h"
+
+#include "arith_uint256.h"
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "key_io.h"
+#include "main.h"
+#include "metrics.h"
+#include "miner.h"
+#include "pow.h"
+#include "script/standard.h"
+#include "streams.h"
+#include "ui_interface.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+#include "version.h"
+
+#include <univalue.h>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+#include <event2/util.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** Share-rate window the per-connection retarget aims for, in seconds. */
+static const int64_t STRATUM_RETARGET_INTERVAL = 60;
+/** Desired seconds between shares from one connection. */
+static const int64_t STRATUM_SECONDS_PER_SHARE = 15;
+/** How many past jobs stay valid for submits on an unchanged tip. */
+static const size_t STRATUM_MAX_JOBS = 4;
+/** Drop a connection whose pending input exceeds this. */
+static const size_t STRATUM_MAX_LINE_SIZE = 100000;
+/** How often the job is refreshed against the mempool, in seconds. */
+static const int STRATUM_JOB_REFRESH_SECONDS = 10;
+
+/** Per-connection miner state. All stratum state below is confined to the
+ * stratum event thread: reads, submits, tip notifications and the refresh
+ * timer all run as events on that loop, so no lock guards it and the
+ * thread never holds anything while it takes cs_main. */
+struct StratumClient
+{
+    struct bufferevent* bev;
+    std::string strWorker;
+    bool fSubscribed;
+    bool fAuthorized;
+    //! 4-byte prefix of the 32-byte block nonce reserved for this connection;
+    //! the miner fills in the remaining 28 bytes, so connections search
+    //! disjoint nonce ranges of the same template.
+    uint32_t nNonce1;
+    arith_uint256 shareTarget;
+    int64_t nLastRetarget;
+    int64_t nSharesSinceRetarget;
+    uint64_t nSharesAccepted;
+    uint64_t nSharesRejected;
+
+    StratumClient() : bev(NULL), fSubscribed(false), fAuthorized(false), nNonce1(0),
+                      nLastRetarget(0), nSharesSinceRetarget(0),
+                      nSharesAccepted(0), nSharesRejected(0) {}
+};
+
+static struct event_base* stratumBase = NULL;
+static std::vector<struct evconnlistener*> stratumListeners;
+static struct event* stratumTimer = NULL;
+static boost::thread threadStratum;
+
+static std::map<struct bufferevent*, StratumClient> mapStratumClients;
+static uint32_t nNextNonce1 = 1;
+
+// Current job state. One template is shared by every connection per tip;
+// the connection-specific part of the search space lives entirely in the
+// nonce, so the merkle root is identical for all of them and a tip change
+// is the only thing that invalidates outstanding work.
+static std::map<std::string, std::shared_ptr<CBlockTemplate> > mapStratumJobs;
+static std::deque<std::string> dequeJobIds;
+static std::string strCurrentJob;
+static uint64_t nJobCounter = 0;
+static uint256 hashJobPrevBlock;
+static unsigned int nJobTxUpdated = 0;
+
+static CScript scriptStratumPayout;
+static arith_uint256 defaultShareTarget;
+
+static std::string HexInt4(uint32_t n)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << n;
+    return HexStr(ss.begin(), ss.end());
+}
+
+static std::string HexUint256(const uint256& h)
+{
+    return HexStr(h.begin(), h.end());
+}
+
+static void StratumSendLine(StratumClient& client, const std::string& strLine)
+{
+    bufferevent_write(client.bev, strLine.data(), strLine.size());
+    bufferevent_write(client.bev, "\n", 1);
+}
+
+static void StratumSendReply(StratumClient& client, const UniValue& id, const UniValue& result, const UniValue& error)
+{
+    UniValue reply(UniValue::VOBJ);
+    reply.push_back(Pair("id", id));
+    reply.push_back(Pair("result", result));
+    reply.push_back(Pair("error", error));
+    StratumSendLine(client, reply.write());
+}
+
+static UniValue StratumError(int code, const std::string& message)
+{
+    UniValue error(UniValue::VARR);
+    error.push_back(code);
+    error.push_back(message);
+    error.push_back(NullUniValue);
+    return error;
+}
+
+static void StratumSendTarget(StratumClient& client)
+{
+    UniValue params(UniValue::VARR);
+    params.push_back(ArithToUint256(client.shareTarget).GetHex());
+    UniValue req(UniValue::VOBJ);
+    req.push_back(Pair("id", NullUniValue));
+    req.push_back(Pair("method", "mining.set_target"));
+    req.push_back(Pair("params", params));
+    StratumSendLine(client, req.write());
+}
+
+static std::string StratumNotifyLine(const CBlock& block, const std::string& strJobId, bool fClean)
+{
+    UniValue params(UniValue::VARR);
+    params.push_back(strJobId);
+    params.push_back(HexInt4((uint32_t)block.nVersion));
+    params.push_back(HexUint256(block.hashPrevBlock));
+    params.push_back(HexUint256(block.hashMerkleRoot));
+    params.push_back(HexUint256(block.hashFinalSaplingRoot));
+    params.push_back(HexInt4(block.nTime));
+    params.push_back(HexInt4(block.nBits));
+    params.push_back(UniValue(fClean));
+    UniValue req(UniValue::VOBJ);
+    req.push_back(Pair("id", NullUniValue));
+    req.push_back(Pair("method", "mining.notify"));
+    req.push_back(Pair("params", params));
+    return req.write();
+}
+
+/** Rebuild the shared job if the tip moved (clean) or, at most every timer
+ * tick, if the mempool gained transactions. Pushes mining.notify to every
+ * subscribed connection. */
+static void UpdateStratumJob(bool fTipChanged)
+{
+    uint256 hashTip;
+    {
+        LOCK(cs_main);
+        if (chainActive.Tip() == NULL)
+            return;
+        if (IsInitialBlockDownload())
+            return;
+        hashTip = chainActive.Tip()->GetBlockHash();
+    }
+    bool fClean = (hashJobPrevBlock != hashTip);
+    if (!fClean && nJobTxUpdated == mempool.GetTransactionsUpdated())
+        return;
+    if (mapStratumClients.empty()) {
+        // Nobody to work for: drop stale jobs and rebuild on first subscribe
+        mapStratumJobs.clear();
+        dequeJobIds.clear();
+        strCurrentJob.clear();
+        hashJobPrevBlock.SetNull();
+        return;
+    }
+
+    std::shared_ptr<CBlockTemplate> tmpl(CreateNewBlock(CPubKey(), scriptStratumPayout, KOMODO_MAXGPUCOUNT, false));
+    if (tmpl == nullptr) {
+        LogPrint("stratum", "stratum: CreateNewBlock failed, keeping previous job\n");
+        return;
+    }
+
+    if (fClean) {
+        mapStratumJobs.clear();
+        dequeJobIds.clear();
+    }
+    strCurrentJob = strprintf("%llx", (unsigned long long)++nJobCounter);
+    mapStratumJobs[strCurrentJob] = tmpl;
+    dequeJobIds.push_back(strCurrentJob);
+    while (dequeJobIds.size() > STRATUM_MAX_JOBS) {
+        mapStratumJobs.erase(dequeJobIds.front());
+        dequeJobIds.pop_front();
+    }
+    hashJobPrevBlock = tmpl->block.hashPrevBlock;
+    nJobTxUpdated = mempool.GetTransactionsUpdated();
+
+    std::string strLine = StratumNotifyLine(tmpl->block, strCurrentJob, fClean);
+    int nNotified = 0;
+    for (std::map<struct bufferevent*, StratumClient>::iterator it = mapStratumClients.begin();
+         it != mapStratumClients.end(); ++it) {
+        if (it->second.fSubscribed) {
+            StratumSendLine(it->second, strLine);
+            nNotified++;
+        }
+    }
+    LogPrint("stratum", "stratum: new job %s (clean=%d, %u txs) sent to %d connections\n",
+             strCurrentJob, fClean, tmpl->block.vtx.size(), nNotified);
+}
+
+/** Doubling/halving retarget towards one share per connection every
+ * STRATUM_SECONDS_PER_SHARE seconds, evaluated once per window. */
+static void StratumMaybeRetarget(StratumClient& client)
+{
+    int64_t now = GetTime();
+    if (client.nLastRetarget == 0) {
+        client.nLastRetarget = now;
+        return;
+    }
+    int64_t elapsed = now - client.nLastRetarget;
+    if (elapsed < STRATUM_RETARGET_INTERVAL)
+        return;
+    int64_t interval = client.nSharesSinceRetarget > 0 ? elapsed / client.nSharesSinceRetarget : elapsed;
+    arith_uint256 target = client.shareTarget;
+    if (interval > 2 * STRATUM_SECONDS_PER_SHARE)
+        target <<= 1; // too few shares: make them easier
+    else if (interval * 2 < STRATUM_SECONDS_PER_SHARE)
+        target >>= 1; // share flood: make them harder
+    arith_uint256 bnLimit = UintToArith256(Params().GetConsensus().powLimit);
+    if (target > bnLimit)
+        target = bnLimit;
+    client.nLastRetarget = now;
+    client.nSharesSinceRetarget = 0;
+    if (target != client.shareTarget) {
+        client.shareTarget = target;
+        StratumSendTarget(client);
+    }
+}
+
+static void StratumHandleSubmit(StratumClient& client, const UniValue& id, const UniValue& params)
+{
+    if (!client.fSubscribed || params.size() < 5) {
+        StratumSendReply(client, id, false, StratumError(24, "Not subscribed"));
+        return;
+    }
+    std::string strJobId = params[1].get_str();
+    std::map<std::string, std::shared_ptr<CBlockTemplate> >::iterator mi = mapStratumJobs.find(strJobId);
+    if (mi == mapStratumJobs.end()) {
+        client.nSharesRejected++;
+        StratumSendReply(client, id, false, StratumError(21, "Job not found"));
+        return;
+    }
+
+    std::vector<unsigned char> vTime = ParseHex(params[2].get_str());
+    std::vector<unsigned char> vNonce2 = ParseHex(params[3].get_str());
+    std::vector<unsigned char> vSolution = ParseHex(params[4].get_str());
+    if (vTime.size() != 4 || vNonce2.size() != 28) {
+        client.nSharesRejected++;
+        StratumSendReply(client, id, false, StratumError(20, "Malformed share"));
+        return;
+    }
+
+    CBlock block = mi->second->block;
+    memcpy(&block.nTime, vTime.data(), 4);
+    std::vector<unsigned char> vNonce(32);
+    memcpy(vNonce.data(), &client.nNonce1, 4);
+    memcpy(vNonce.data() + 4, vNonce2.data(), 28);
+    block.nNonce = uint256(vNonce);
+    block.nSolution = vSolution;
+
+    if (!CheckEquihashSolution(&block, Params())) {
+        client.nSharesRejected++;
+        StratumSendReply(client, id, false, StratumError(23, "Invalid solution"));
+        return;
+    }
+    arith_uint256 bnHash = UintToArith256(block.GetHash());
+    if (bnHash > client.shareTarget) {
+        client.nSharesRejected++;
+        StratumSendReply(client, id, false, StratumError(23, "High hash"));
+        return;
+    }
+
+    client.nSharesAccepted++;
+    client.nSharesSinceRetarget++;
+    StratumSendReply(client, id, true, NullUniValue);
+    StratumMaybeRetarget(client);
+
+    arith_uint256 bnBlockTarget;
+    bool fNegative, fOverflow;
+    bnBlockTarget.SetCompact(block.nBits, &fNegative, &fOverflow);
+    if (!fNegative && !fOverflow && bnHash <= bnBlockTarget) {
+        int32_t nHeight = 0;
+        {
+            LOCK(cs_main);
+            BlockMap::iterator bi = mapBlockIndex.find(block.hashPrevBlock);
+            if (bi != mapBlockIndex.end())
+                nHeight = bi->second->nHeight + 1;
+        }
+        LogPrintf("stratum: connection %s found block %s\n", client.strWorker, block.GetHash().GetHex());
+        CValidationState state;
+        if (!ProcessNewBlock(1, nHeight, state, NULL, &block, true, NULL))
+            LogPrintf("stratum: block %s was not accepted\n", block.GetHash().GetHex());
+        else
+            TrackMinedBlock(block.GetHash());
+    }
+}
+
+static void StratumDisconnect(struct bufferevent* bev)
+{
+    std::map<struct bufferevent*, StratumClient>::iterator it = mapStratumClients.find(bev);
+    if (it != mapStratumClients.end()) {
+        LogPrint("stratum", "stratum: disconnecting %s (%llu accepted / %llu rejected shares)\n",
+                 it->second.strWorker,
+                 (unsigned long long)it->second.nSharesAccepted,
+                 (unsigned long long)it->second.nSharesRejected);
+        mapStratumClients.erase(it);
+    }
+    bufferevent_free(bev);
+}
+
+static void StratumProcessLine(StratumClient& client, const std::string& strLine)
+{
+    UniValue request;
+    if (!request.read(strLine) || !request.isObject()) {
+        StratumSendReply(client, NullUniValue, NullUniValue, StratumError(20, "Parse error"));
+        return;
+    }
+    UniValue id = find_value(request, "id");
+    UniValue method = find_value(request, "method");
+    UniValue params = find_value(request, "params");
+    if (!method.isStr())
+        return;
+    std::string strMethod = method.get_str();
+
+    if (strMethod == "mining.subscribe") {
+        client.fSubscribed = true;
+        UniValue result(UniValue::VARR);
+        result.push_back(NullUniValue); // no session resumption
+        result.push_back(HexStr((unsigned char*)&client.nNonce1, (unsigned char*)&client.nNonce1 + 4));
+        StratumSendReply(client, id, result, NullUniValue);
+        StratumSendTarget(client);
+        if (!strCurrentJob.empty())
+            StratumSendLine(client, StratumNotifyLine(mapStratumJobs[strCurrentJob]->block, strCurrentJob, true));
+        else
+            UpdateStratumJob(true);
+    } else if (strMethod == "mining.authorize") {
+        if (params.isArray() && params.size() > 0 && params[0].isStr())
+            client.strWorker = params[0].get_str();
+        client.fAuthorized = true;
+        StratumSendReply(client, id, true, NullUniValue);
+    } else if (strMethod == "mining.extranonce.subscribe") {
+        StratumSendReply(client, id, true, NullUniValue);
+    } else if (strMethod == "mining.suggest_target") {
+        if (params.isArray() && params.size() > 0 && params[0].isStr()) {
+            arith_uint256 suggested = UintToArith256(uint256S(params[0].get_str()));
+            arith_uint256 bnLimit = UintToArith256(Params().GetConsensus().powLimit);
+            if (suggested != 0 && suggested <= bnLimit) {
+                client.shareTarget = suggested;
+                StratumSendTarget(client);
+            }
+        }
+        StratumSendReply(client, id, true, NullUniValue);
+    } else if (strMethod == "mining.submit") {
+        StratumHandleSubmit(client, id, params);
+    } else {
+        StratumSendReply(client, id, NullUniValue, StratumError(20, "Unknown method"));
+    }
+}
+
+static void stratum_read_cb(struct bufferevent* bev, void* ctx)
+{
+    std::map<struct bufferevent*, StratumClient>::iterator it = mapStratumClients.find(bev);
+    if (it == mapStratumClients.end())
+        return;
+    struct evbuffer* input = bufferevent_get_input(bev);
+    char* cline;
+    size_t len;
+    while ((cline = evbuffer_readln(input, &len, EVBUFFER_EOL_ANY)) != NULL) {
+        std::string strLine(cline, len);
+        free(cline);
+        if (!strLine.empty())
+            StratumProcessLine(it->second, strLine);
+    }
+    if (evbuffer_get_length(input) > STRATUM_MAX_LINE_SIZE) {
+        LogPrint("stratum", "stratum: dropping connection with oversized request\n");
+        StratumDisconnect(bev);
+    }
+}
+
+static void stratum_event_cb(struct bufferevent* bev, short events, void* ctx)
+{
+    if (events & (BEV_EVENT_EOF | BEV_EVENT_ERROR))
+        StratumDisconnect(bev);
+}
+
+static void stratum_accept_cb(struct evconnlistener* listener, evutil_socket_t fd,
+                              struct sockaddr* addr, int socklen, void* ctx)
+{
+    struct bufferevent* bev = bufferevent_socket_new(stratumBase, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (bev == NULL) {
+        evutil_closesocket(fd);
+        return;
+    }
+    StratumClient& client = mapStratumClients[bev];
+    client.bev = bev;
+    client.nNonce1 = nNextNonce1++;
+    client.shareTarget = defaultShareTarget;
+    bufferevent_setcb(bev, stratum_read_cb, NULL, stratum_event_cb, NULL);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+    LogPrint("stratum", "stratum: accepted connection (nonce1=%08x)\n", client.nNonce1);
+}
+
+static void stratum_timer_cb(evutil_socket_t fd, short what, void* ctx)
+{
+    UpdateStratumJob(false);
+}
+
+static void stratum_tip_cb(evutil_socket_t fd, short what, void* ctx)
+{
+    UpdateStratumJob(true);
+}
+
+/** Runs on the validation thread: bounce the job rebuild onto the stratum
+ * event loop so template creation never blocks tip processing. */
+static void stratum_NotifyBlockTip(const uint256& hash)
+{
+    if (stratumBase == NULL)
+        return;
+    struct timeval tv = {0, 0};
+    event_base_once(stratumBase, -1, EV_TIMEOUT, stratum_tip_cb, NULL, &tv);
+}
+
+static bool StratumBindAddresses()
+{
+    int defaultPort = GetArg("-stratumport", DEFAULT_STRATUM_PORT);
+    std::vector<std::pair<std::string, uint16_t> > endpoints;
+
+    if (mapArgs.count("-stratumbind")) {
+        const std::vector<std::string>& vbind = mapMultiArgs["-stratumbind"];
+        for (std::vector<std::string>::const_iterator i = vbind.begin(); i != vbind.end(); ++i) {
+            int port = defaultPort;
+            std::string host;
+            SplitHostPort(*i, port, host);
+            endpoints.push_back(std::make_pair(host, port));
+        }
+    } else { // Default to loopback; a pool front-end is expected to sit in front
+        endpoints.push_back(std::make_pair("::1", defaultPort));
+        endpoints.push_back(std::make_pair("127.0.0.1", defaultPort));
+    }
+
+    for (std::vector<std::pair<std::string, uint16_t> >::iterator i = endpoints.begin(); i != endpoints.end(); ++i) {
+        std::string strEndpoint = i->first.find(':') != std::string::npos ?
+                strprintf("[%s]:%d", i->first, i->second) : strprintf("%s:%d", i->first, i->second);
+        struct sockaddr_storage ss;
+        int sslen = sizeof(ss);
+        if (evutil_parse_sockaddr_port(strEndpoint.c_str(), (struct sockaddr*)&ss, &sslen) != 0) {
+            LogPrintf("stratum: could not parse endpoint %s\n", strEndpoint);
+            continue;
+        }
+        struct evconnlistener* listener = evconnlistener_new_bind(stratumBase, stratum_accept_cb, NULL,
+                LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1, (struct sockaddr*)&ss, sslen);
+        if (listener) {
+            LogPrint("stratum", "Binding stratum on %s\n", strEndpoint);
+            stratumListeners.push_back(listener);
+        } else {
+            LogPrintf("Binding stratum on %s failed.\n", strEndpoint);
+        }
+    }
+    return !stratumListeners.empty();
+}
+
+bool InitStratumServer()
+{
+    std::string strAddress = GetArg("-stratumaddress", "");
+    CTxDestination dest = DecodeDestination(strAddress);
+    if (!IsValidDestination(dest)) {
+        LogPrintf("stratum: -stratum requires a valid -stratumaddress for the coinbase payout\n");
+        return false;
+    }
+    scriptStratumPayout = GetScriptForDestination(dest);
+
+    int64_t nDiff = std::max(GetArg("-stratumdiff", DEFAULT_STRATUM_DIFF), (int64_t)1);
+    defaultShareTarget = UintToArith256(Params().GetConsensus().powLimit) / nDiff;
+
+    // The HTTP server normally sets libevent's threading up first, but
+    // repeating it is harmless and keeps the two independent.
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+
+    stratumBase = event_base_new();
+    if (!stratumBase) {
+        LogPrintf("stratum: couldn't create an event_base\n");
+        return false;
+    }
+    if (!StratumBindAddresses()) {
+        LogPrintf("Unable to bind any endpoint for stratum server\n");
+        event_base_free(stratumBase);
+        stratumBase = NULL;
+        return false;
+    }
+    LogPrint("stratum", "Initialized stratum server\n");
+    return true;
+}
+
+static void ThreadStratum(struct event_base* base)
+{
+    RenameThread("zcash-stratum");
+    LogPrint("stratum", "Entering stratum event loop\n");
+    event_base_dispatch(base);
+    // Event loop will be interrupted by StopStratumServer()
+    LogPrint("stratum", "Exited stratum event loop\n");
+}
+
+bool StartStratumServer()
+{
+    if (stratumBase == NULL)
+        return false;
+    LogPrintf("stratum: starting stratum server\n");
+
+    // Periodic refresh keeps the job current against the mempool; tip
+    // changes push a clean job immediately via the new-tip signal.
+    stratumTimer = event_new(stratumBase, -1, EV_PERSIST, stratum_timer_cb, NULL);
+    struct timeval tv = {STRATUM_JOB_REFRESH_SECONDS, 0};
+    event_add(stratumTimer, &tv);
+
+    uiInterface.NotifyBlockTip.connect(&stratum_NotifyBlockTip);
+    threadStratum = boost::thread(boost::bind(&ThreadStratum, stratumBase));
+    return true;
+}
+
+void InterruptStratumServer()
+{
+    LogPrint("stratum", "Interrupting stratum server\n");
+    for (size_t i = 0; i < stratumListeners.size(); i++)
+        evconnlistener_disable(stratumListeners[i]);
+}
+
+void StopStratumServer()
+{
+    if (stratumBase == NULL)
+        return;
+    LogPrint("stratum", "Stopping stratum server\n");
+    uiInterface.NotifyBlockTip.disconnect(&stratum_NotifyBlockTip);
+    event_base_loopexit(stratumBase, NULL);
+    if (!threadStratum.try_join_for(boost::chrono::milliseconds(2000))) {
+        LogPrintf("Stratum event loop did not exit within allotted time, sending loopbreak\n");
+        event_base_loopbreak(stratumBase);
+        threadStratum.join();
+    }
+    // The loop has exited, so the per-connection state is ours to free.
+    for (std::map<struct bufferevent*, StratumClient>::iterator it = mapStratumClients.begin();
+         it != mapStratumClients.end(); ++it)
+        bufferevent_free(it->first);
+    mapStratumClients.clear();
+    mapStratumJobs.clear();
+    dequeJobIds.clear();
+    for (size_t i = 0; i < stratumListeners.size(); i++)
+        evconnlistener_free(stratumListeners[i]);
+    stratumListeners.clear();
+    if (stratumTimer) {
+        event_free(stratumTimer);
+        stratumTimer = NULL;
+    }
+    event_base_free(stratumBase);
+    stratumBase = NULL;
+    LogPrint("stratum", "Stopped stratum server\n");
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2016 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef BITCOIN_STRATUM_H
+#define BITCOIN_STRATUM_H
+
+/** Default TCP port for the -stratum listener. */
+static const int DEFAULT_STRATUM_PORT = 3333;
+/** Default share difficulty handed to new connections. */
+static const int DEFAULT_STRATUM_DIFF = 1;
+
+/** Initialize the stratum server: decode -stratumaddress and bind the
+ * listening sockets. Returns false on misconfiguration. */
+bool InitStratumServer();
+/** Start the stratum event-loop thread. Call after InitStratumServer. */
+bool StartStratumServer();
+/** Stop accepting new connections. */
+void InterruptStratumServer();
+/** Disconnect clients and tear the server down. */
+void StopStratumServer();
+
+#endif // BITCOIN_STRATUM_H
@@ -133,6 +133,11 @@ public:
         Init(nTypeIn, nVersionIn);
     }
 
+    CBaseDataStream(vector_type&& vchIn, int nTypeIn, int nVersionIn) : vch(std::move(vchIn))
+    {
+        Init(nTypeIn, nVersionIn);
+    }
+
     CBaseDataStream(const std::vector<char>& vchIn, int nTypeIn, int nVersionIn) : vch(vchIn.begin(), vchIn.end())
     {
         Init(nTypeIn, nVersionIn);
@@ -365,6 +370,12 @@ public:
         d.insert(d.end(), begin(), end());
         clear();
     }
+
+    //! Swap the underlying buffer with an external one, resetting the read position.
+    void SwapBuffer(vector_type& d) {
+        vch.swap(d);
+        nReadPos = 0;
+    }
 };
 
 class CDataStream : public CBaseDataStream<CSerializeData>
@@ -383,6 +394,9 @@ public:
     CDataStream(const vector_type& vchIn, int nTypeIn, int nVersionIn) :
             CBaseDataStream(vchIn, nTypeIn, nVersionIn) { }
 
+    CDataStream(vector_type&& vchIn, int nTypeIn, int nVersionIn) :
+            CBaseDataStream(std::move(vchIn), nTypeIn, nVersionIn) { }
+
     CDataStream(const std::vector<char>& vchIn, int nTypeIn, int nVersionIn) :
             CBaseDataStream(vchIn, nTypeIn, nVersionIn) { }
 
@@ -395,8 +409,62 @@ public:
 
 };
 
+/** Hand out a thread-local scratch CDataStream for short-lived serialization
+ * in hot paths. The underlying buffer keeps its high-water capacity across
+ * calls, so block- and transaction-sized messages are serialized into memory
+ * allocated once per thread instead of once per message. The stream is reset
+ * on every call: callers must be done with the previous scratch stream on
+ * this thread before requesting another, and must not serialize objects that
+ * themselves request one.
+ */
+inline CDataStream& GetScratchStream(int nTypeIn, int nVersionIn)
+{
+    static thread_local CDataStream ss(SER_NETWORK, 0);
+    ss.clear();
+    ss.SetType(nTypeIn);
+    ss.SetVersion(nVersionIn);
+    return ss;
+}
+
+/** Minimal read-only stream over a caller-owned memory buffer.
+ *
+ * Deserializes in place instead of copying the bytes into a CDataStream
+ * first; the buffer must stay valid for the lifetime of the stream.
+ */
+class CMemoryReadStream
+{
+protected:
+    const int nType;
+    const int nVersion;
+    const unsigned char* pch;
+    size_t nSize;
+    size_t nReadPos;
+
+public:
+    CMemoryReadStream(const unsigned char* pchIn, size_t nSizeIn, int nTypeIn, int nVersionIn)
+        : nType(nTypeIn), nVersion(nVersionIn), pch(pchIn), nSize(nSizeIn), nReadPos(0) {}
+
+    int GetType() const { return nType; }
+    int GetVersion() const { return nVersion; }
+    size_t size() const { return nSize - nReadPos; }
+    bool empty() const { return nSize == nReadPos; }
 
+    void read(char* pchDest, size_t nReadSize)
+    {
+        if (nReadSize > nSize - nReadPos)
+            throw std::ios_base::failure("CMemoryReadStream::read(): end of data");
+        memcpy(pchDest, pch + nReadPos, nReadSize);
+        nReadPos += nReadSize;
+    }
 
+    template<typename T>
+    CMemoryReadStream& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+};
 
 
 
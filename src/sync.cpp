@@ -24,6 +24,8 @@
 
 #include <stdio.h>
 
+#include <atomic>
+
 #include <boost/foreach.hpp>
 #include <boost/thread.hpp>
 
@@ -195,3 +197,129 @@ void AssertLockHeldInternal(const char* pszName, const char* pszFile, int nLine,
 }
 
 #endif /* DEBUG_LOCKORDER */
+
+//
+// Runtime lock statistics (-lockstats).
+//
+// Aggregates lock wait and hold times per call site into a small
+// open-addressed table. Call sites are identified by the string-literal
+// pointers the LOCK macros already pass in, so the hot path is a hash of
+// two pointers and a line number, a few pointer compares and relaxed
+// atomic adds: no allocation and no additional lock. Unlike
+// DEBUG_LOCKORDER this is cheap enough to leave on in production.
+//
+
+bool fLockStats = false;
+
+namespace {
+
+const size_t LOCKSTATS_SLOTS = 512; //!< must be a power of two
+
+//! Sentinel pszFile value marking a slot another thread is still initializing.
+const char* const LOCKSTATS_CLAIMED = (const char*)1;
+
+struct LockStatSlot {
+    std::atomic<const char*> pszFile; //!< claimed via CAS; real value published last
+    const char* pszName;
+    int nLine;
+    std::atomic<uint64_t> nLocks;
+    std::atomic<uint64_t> nContended;
+    std::atomic<uint64_t> nWaitMicros;
+    std::atomic<uint64_t> nMaxWaitMicros;
+    std::atomic<uint64_t> nHoldMicros;
+    std::atomic<uint64_t> nMaxHoldMicros;
+};
+
+// Static storage, so everything starts zeroed before any LOCK runs.
+LockStatSlot lockStatSlots[LOCKSTATS_SLOTS];
+std::atomic<uint64_t> nLockStatOverflow;
+
+void UpdateMax(std::atomic<uint64_t>& nMax, uint64_t nVal)
+{
+    uint64_t nPrev = nMax.load(std::memory_order_relaxed);
+    while (nVal > nPrev && !nMax.compare_exchange_weak(nPrev, nVal, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+void* LockStatsEnter(const char* pszName, const char* pszFile, int nLine, int64_t nWaitMicros)
+{
+    // pszName disambiguates the two locks a LOCK2 takes on the same line.
+    size_t nPos = (((uintptr_t)pszFile >> 4) ^ ((uintptr_t)pszName >> 4)) * 0x9E3779B9U + (size_t)nLine;
+    for (size_t nProbe = 0; nProbe < 16; nProbe++) {
+        LockStatSlot& slot = lockStatSlots[(nPos + nProbe) & (LOCKSTATS_SLOTS - 1)];
+        const char* file = slot.pszFile.load(std::memory_order_acquire);
+        if (file == NULL) {
+            const char* expected = NULL;
+            if (slot.pszFile.compare_exchange_strong(expected, LOCKSTATS_CLAIMED, std::memory_order_acquire)) {
+                slot.pszName = pszName;
+                slot.nLine = nLine;
+                slot.pszFile.store(pszFile, std::memory_order_release);
+                file = pszFile;
+            } else
+                file = expected;
+        }
+        if (file == LOCKSTATS_CLAIMED)
+            continue;
+        if (file == pszFile && slot.pszName == pszName && slot.nLine == nLine) {
+            slot.nLocks.fetch_add(1, std::memory_order_relaxed);
+            if (nWaitMicros > 0) {
+                slot.nContended.fetch_add(1, std::memory_order_relaxed);
+                slot.nWaitMicros.fetch_add(nWaitMicros, std::memory_order_relaxed);
+                UpdateMax(slot.nMaxWaitMicros, nWaitMicros);
+            }
+            return &slot;
+        }
+    }
+    nLockStatOverflow.fetch_add(1, std::memory_order_relaxed);
+    return NULL;
+}
+
+void LockStatsLeave(void* pEntry, int64_t nHoldMicros)
+{
+    LockStatSlot* slot = (LockStatSlot*)pEntry;
+    if (nHoldMicros < 0)
+        nHoldMicros = 0;
+    slot->nHoldMicros.fetch_add(nHoldMicros, std::memory_order_relaxed);
+    UpdateMax(slot->nMaxHoldMicros, nHoldMicros);
+}
+
+void GetLockStats(std::vector<CLockStat>& vStats, uint64_t& nOverflow)
+{
+    vStats.clear();
+    for (size_t i = 0; i < LOCKSTATS_SLOTS; i++) {
+        const LockStatSlot& slot = lockStatSlots[i];
+        const char* file = slot.pszFile.load(std::memory_order_acquire);
+        if (file == NULL || file == LOCKSTATS_CLAIMED)
+            continue;
+        CLockStat stat;
+        stat.mutexName = slot.pszName;
+        stat.sourceFile = file;
+        stat.sourceLine = slot.nLine;
+        stat.nLocks = slot.nLocks.load(std::memory_order_relaxed);
+        stat.nContended = slot.nContended.load(std::memory_order_relaxed);
+        stat.nWaitMicros = slot.nWaitMicros.load(std::memory_order_relaxed);
+        stat.nMaxWaitMicros = slot.nMaxWaitMicros.load(std::memory_order_relaxed);
+        stat.nHoldMicros = slot.nHoldMicros.load(std::memory_order_relaxed);
+        stat.nMaxHoldMicros = slot.nMaxHoldMicros.load(std::memory_order_relaxed);
+        vStats.push_back(stat);
+    }
+    nOverflow = nLockStatOverflow.load(std::memory_order_relaxed);
+}
+
+void ResetLockStats()
+{
+    // Keep the call sites (locks held right now still point into the table),
+    // only zero the counters.
+    for (size_t i = 0; i < LOCKSTATS_SLOTS; i++) {
+        LockStatSlot& slot = lockStatSlots[i];
+        slot.nLocks.store(0, std::memory_order_relaxed);
+        slot.nContended.store(0, std::memory_order_relaxed);
+        slot.nWaitMicros.store(0, std::memory_order_relaxed);
+        slot.nMaxWaitMicros.store(0, std::memory_order_relaxed);
+        slot.nHoldMicros.store(0, std::memory_order_relaxed);
+        slot.nMaxHoldMicros.store(0, std::memory_order_relaxed);
+    }
+    nLockStatOverflow.store(0, std::memory_order_relaxed);
+}
@@ -22,12 +22,18 @@
 #define BITCOIN_SYNC_H
 
 #include "threadsafety.h"
+#include "utiltime.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
 
 #undef __cpuid
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
 
 
 ////////////////////////////////////////////////
@@ -96,6 +102,37 @@ typedef AnnotatedMixin<boost::recursive_mutex> CCriticalSection;
 /** Wrapped boost mutex: supports waiting but not recursive locking */
 typedef AnnotatedMixin<boost::mutex> CWaitableCriticalSection;
 
+/**
+ * Wrapped boost shared mutex: many concurrent readers or one exclusive
+ * writer, NOT recursive in either mode. Use READ_LOCK/WRITE_LOCK. Only
+ * suitable for read-mostly data that a thread never re-acquires while
+ * already holding it; cs_main in particular cannot be converted because
+ * its callers rely on recursive acquisition.
+ */
+class CAPABILITY("mutex") CSharedCriticalSection : public boost::shared_mutex
+{
+public:
+    void lock() ACQUIRE()
+    {
+        boost::shared_mutex::lock();
+    }
+
+    void unlock() RELEASE()
+    {
+        boost::shared_mutex::unlock();
+    }
+
+    void lock_shared() ACQUIRE_SHARED()
+    {
+        boost::shared_mutex::lock_shared();
+    }
+
+    void unlock_shared() RELEASE_SHARED()
+    {
+        boost::shared_mutex::unlock_shared();
+    }
+};
+
 /** Just a typedef for boost::condition_variable, can be wrapped later if desired */
 typedef boost::condition_variable CConditionVariable;
 
@@ -115,16 +152,59 @@ void static inline AssertLockHeldInternal(const char* pszName, const char* pszFi
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/** Whether -lockstats is enabled; when false the only overhead is one branch per LOCK. */
+extern bool fLockStats;
+
+/** One aggregated row of the -lockstats call-site table (see getlockstats). */
+struct CLockStat
+{
+    std::string mutexName;   //!< the #cs text the LOCK macro captured
+    std::string sourceFile;
+    int sourceLine;
+    uint64_t nLocks;         //!< total acquisitions from this call site
+    uint64_t nContended;     //!< acquisitions that had to wait
+    uint64_t nWaitMicros;    //!< total time spent waiting, in microseconds
+    uint64_t nMaxWaitMicros;
+    uint64_t nHoldMicros;    //!< total time the lock was held, in microseconds
+    uint64_t nMaxHoldMicros;
+};
+
+/** Record an acquisition (and any wait it incurred) for a call site. Returns an
+ * opaque table entry to pass to LockStatsLeave, or NULL if the table is full. */
+void* LockStatsEnter(const char* pszName, const char* pszFile, int nLine, int64_t nWaitMicros);
+/** Record how long the lock acquired via LockStatsEnter was held. */
+void LockStatsLeave(void* pEntry, int64_t nHoldMicros);
+/** Snapshot the call-site table; nOverflow counts acquisitions that did not fit. */
+void GetLockStats(std::vector<CLockStat>& vStats, uint64_t& nOverflow);
+/** Zero all counters, keeping the call sites themselves. */
+void ResetLockStats();
+
 /** Wrapper around boost::unique_lock<Mutex> */
 template <typename Mutex>
 class SCOPED_CAPABILITY CMutexLock
 {
 private:
     boost::unique_lock<Mutex> lock;
+    void* pLockStat;          //!< -lockstats table entry, NULL when disabled
+    int64_t nLockStatEntered; //!< acquisition time in microseconds, for hold accounting
 
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
+        if (fLockStats) {
+            int64_t nWaitMicros = 0;
+            if (!lock.try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
+                PrintLockContention(pszName, pszFile, nLine);
+#endif
+                int64_t nStart = GetTimeMicros();
+                lock.lock();
+                nWaitMicros = GetTimeMicros() - nStart;
+            }
+            pLockStat = LockStatsEnter(pszName, pszFile, nLine, nWaitMicros);
+            nLockStatEntered = GetTimeMicros();
+            return;
+        }
 #ifdef DEBUG_LOCKCONTENTION
         if (!lock.try_lock()) {
             PrintLockContention(pszName, pszFile, nLine);
@@ -141,11 +221,15 @@ private:
         lock.try_lock();
         if (!lock.owns_lock())
             LeaveCritical();
+        else if (fLockStats) {
+            pLockStat = LockStatsEnter(pszName, pszFile, nLine, 0);
+            nLockStatEntered = GetTimeMicros();
+        }
         return lock.owns_lock();
     }
 
 public:
-    CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) ACQUIRE(mutexIn) : lock(mutexIn, boost::defer_lock)
+    CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) ACQUIRE(mutexIn) : lock(mutexIn, boost::defer_lock), pLockStat(NULL), nLockStatEntered(0)
     {
         if (fTry)
             TryEnter(pszName, pszFile, nLine);
@@ -153,7 +237,7 @@ public:
             Enter(pszName, pszFile, nLine);
     }
 
-    CMutexLock(Mutex* pmutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) ACQUIRE(pmutexIn)
+    CMutexLock(Mutex* pmutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) ACQUIRE(pmutexIn) : pLockStat(NULL), nLockStatEntered(0)
     {
         if (!pmutexIn) return;
 
@@ -166,8 +250,11 @@ public:
 
     ~CMutexLock() RELEASE()
     {
-        if (lock.owns_lock())
+        if (lock.owns_lock()) {
+            if (pLockStat)
+                LockStatsLeave(pLockStat, GetTimeMicros() - nLockStatEntered);
             LeaveCritical();
+        }
     }
 
     operator bool()
@@ -182,6 +269,87 @@ typedef CMutexLock<CCriticalSection> CCriticalBlock;
 #define LOCK2(cs1, cs2) CCriticalBlock criticalblock1(cs1, #cs1, __FILE__, __LINE__), criticalblock2(cs2, #cs2, __FILE__, __LINE__)
 #define TRY_LOCK(cs, name) CCriticalBlock name(cs, #cs, __FILE__, __LINE__, true)
 
+/** RAII shared (reader) side of a CSharedCriticalSection. Registered with the
+ *  DEBUG_LOCKORDER tracker like an exclusive acquisition, so lock ordering
+ *  violations involving shared holders are still reported. */
+class SCOPED_CAPABILITY CReadBlock
+{
+private:
+    boost::shared_lock<boost::shared_mutex> lock;
+    void* pLockStat;          //!< -lockstats table entry, NULL when disabled
+    int64_t nLockStatEntered; //!< acquisition time in microseconds, for hold accounting
+
+public:
+    CReadBlock(CSharedCriticalSection& mutexIn, const char* pszName, const char* pszFile, int nLine) ACQUIRE_SHARED(mutexIn) : lock(mutexIn, boost::defer_lock), pLockStat(NULL), nLockStatEntered(0)
+    {
+        EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
+        if (fLockStats) {
+            int64_t nWaitMicros = 0;
+            if (!lock.try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
+                PrintLockContention(pszName, pszFile, nLine);
+#endif
+                int64_t nStart = GetTimeMicros();
+                lock.lock();
+                nWaitMicros = GetTimeMicros() - nStart;
+            }
+            pLockStat = LockStatsEnter(pszName, pszFile, nLine, nWaitMicros);
+            nLockStatEntered = GetTimeMicros();
+        } else
+            lock.lock();
+    }
+
+    ~CReadBlock() RELEASE()
+    {
+        if (lock.owns_lock()) {
+            if (pLockStat)
+                LockStatsLeave(pLockStat, GetTimeMicros() - nLockStatEntered);
+            LeaveCritical();
+        }
+    }
+};
+
+/** RAII exclusive (writer) side of a CSharedCriticalSection. */
+class SCOPED_CAPABILITY CWriteBlock
+{
+private:
+    boost::unique_lock<boost::shared_mutex> lock;
+    void* pLockStat;
+    int64_t nLockStatEntered;
+
+public:
+    CWriteBlock(CSharedCriticalSection& mutexIn, const char* pszName, const char* pszFile, int nLine) ACQUIRE(mutexIn) : lock(mutexIn, boost::defer_lock), pLockStat(NULL), nLockStatEntered(0)
+    {
+        EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
+        if (fLockStats) {
+            int64_t nWaitMicros = 0;
+            if (!lock.try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
+                PrintLockContention(pszName, pszFile, nLine);
+#endif
+                int64_t nStart = GetTimeMicros();
+                lock.lock();
+                nWaitMicros = GetTimeMicros() - nStart;
+            }
+            pLockStat = LockStatsEnter(pszName, pszFile, nLine, nWaitMicros);
+            nLockStatEntered = GetTimeMicros();
+        } else
+            lock.lock();
+    }
+
+    ~CWriteBlock() RELEASE()
+    {
+        if (lock.owns_lock()) {
+            if (pLockStat)
+                LockStatsLeave(pLockStat, GetTimeMicros() - nLockStatEntered);
+            LeaveCritical();
+        }
+    }
+};
+
+#define READ_LOCK(cs) CReadBlock readblock(cs, #cs, __FILE__, __LINE__)
+#define WRITE_LOCK(cs) CWriteBlock writeblock(cs, #cs, __FILE__, __LINE__)
+
 #define ENTER_CRITICAL_SECTION(cs)                            \
     {                                                         \
         EnterCritical(#cs, __FILE__, __LINE__, (void*)(&cs)); \
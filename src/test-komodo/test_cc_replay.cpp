@@ -0,0 +1,187 @@
+#include <cryptoconditions.h>
+#include <gtest/gtest.h>
+
+#include "cc/eval.h"
+#include "core_io.h"
+#include "main.h"
+#include "primitives/transaction.h"
+#include "script/cc.h"
+#include "utiltime.h"
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Deterministic replay harness for CC contract performance testing.
+ *
+ * Feed it a capture of raw transactions (one hex tx per line, as printed by
+ * getrawtransaction; '#' starts a comment) via KOMODO_CC_REPLAY_FILE and it
+ * replays every CC eval node in the capture against an Eval whose tx lookups
+ * resolve from the capture itself, so no live chain is needed. Include the
+ * parent transactions the contracts reference in the capture for realistic
+ * validation paths. Per-evalcode call counts, validity and timing are printed
+ * at the end.
+ *
+ *   KOMODO_CC_REPLAY_FILE     capture file to replay (test is a no-op without it)
+ *   KOMODO_CC_REPLAY_AMPLIFY  replay each CC input N times, simulating N
+ *                             duplicate transfers for capacity planning (default 1)
+ *   KOMODO_CC_REPLAY_HEIGHT   height reported to validators (default 0)
+ */
+
+namespace TestCCReplay {
+
+class EvalReplay : public Eval
+{
+public:
+    std::map<uint256, CTransaction> txs;
+    int32_t nHeight;
+
+    EvalReplay() : nHeight(0) {}
+
+    bool GetTxUnconfirmed(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock) const
+    {
+        auto r = txs.find(hash);
+        if (r == txs.end())
+            return false;
+        txOut = r->second;
+        hashBlock.SetNull();
+        return true;
+    }
+
+    bool GetTxConfirmed(const uint256 &hash, CTransaction &txOut, CBlockIndex &block) const
+    {
+        uint256 hashBlock;
+        if (!GetTxUnconfirmed(hash, txOut, hashBlock))
+            return false;
+        block = CBlockIndex();
+        block.nHeight = nHeight;
+        return true;
+    }
+
+    unsigned int GetCurrentHeight() const
+    {
+        return nHeight;
+    }
+};
+
+struct ReplayStats
+{
+    uint64_t nCalls;
+    uint64_t nValid;
+    int64_t nMicros;
+    ReplayStats() : nCalls(0), nValid(0), nMicros(0) {}
+};
+
+struct ReplayCtx
+{
+    EvalReplay* eval;
+    const CTransaction* tx;
+    unsigned int nIn;
+    std::map<uint8_t, ReplayStats>* stats;
+};
+
+// callback for cc_verifyEval: dispatch one eval node and time it per evalcode
+static int ReplayEvalNode(CC* cond, void* vctx)
+{
+    ReplayCtx* ctx = (ReplayCtx*) vctx;
+    uint8_t ecode = cond->codeLength > 0 ? cond->code[0] : 0;
+    ctx->eval->state = CValidationState();
+    int64_t nStart = GetTimeMicros();
+    bool out = ctx->eval->Dispatch(cond, *ctx->tx, ctx->nIn);
+    ReplayStats& entry = (*ctx->stats)[ecode];
+    entry.nMicros += GetTimeMicros() - nStart;
+    entry.nCalls++;
+    if (out)
+        entry.nValid++;
+    return out;
+}
+
+// CC spends carry the fulfillment as the single push of the scriptSig
+static bool GetFulfillmentPush(const CScript& scriptSig, std::vector<unsigned char>& ffillBin)
+{
+    CScript::const_iterator pc = scriptSig.begin();
+    opcodetype opcode;
+    if (!scriptSig.GetOp(pc, opcode, ffillBin))
+        return false;
+    return pc == scriptSig.end() && ffillBin.size() > 1;
+}
+
+TEST(TestCCReplay, ReplayCapturedCCValidations)
+{
+    const char* file = getenv("KOMODO_CC_REPLAY_FILE");
+    if (file == NULL) {
+        printf("TestCCReplay: set KOMODO_CC_REPLAY_FILE to a capture of hex raw "
+               "transactions to replay CC validations; nothing to do\n");
+        return;
+    }
+
+    int nAmplify = 1;
+    if (const char* amp = getenv("KOMODO_CC_REPLAY_AMPLIFY"))
+        nAmplify = atoi(amp);
+    if (nAmplify < 1)
+        nAmplify = 1;
+
+    EvalReplay eval;
+    if (const char* ht = getenv("KOMODO_CC_REPLAY_HEIGHT"))
+        eval.nHeight = atoi(ht);
+
+    uint32_t oldCC = ASSETCHAINS_CC;
+    ASSETCHAINS_CC = 1;
+
+    std::ifstream in(file);
+    ASSERT_TRUE(in.good()) << "cannot open " << file;
+    std::vector<CTransaction> vReplay;
+    std::string line;
+    int nLine = 0;
+    while (std::getline(in, line)) {
+        nLine++;
+        if (line.empty() || line[0] == '#')
+            continue;
+        CTransaction tx;
+        ASSERT_TRUE(DecodeHexTx(tx, line)) << file << ":" << nLine << " is not a hex transaction";
+        eval.txs[tx.GetHash()] = tx;
+        vReplay.push_back(tx);
+    }
+    ASSERT_FALSE(vReplay.empty()) << file << " contains no transactions";
+
+    std::map<uint8_t, ReplayStats> stats;
+    uint64_t nCCInputs = 0;
+    int64_t nWallStart = GetTimeMicros();
+    for (const CTransaction& tx : vReplay) {
+        for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+            std::vector<unsigned char> ffillBin;
+            if (!GetFulfillmentPush(tx.vin[nIn].scriptSig, ffillBin))
+                continue;
+            CC* cond;
+            // hash type is one byte tacked on to the end of the fulfillment
+            if (cc_readFulfillmentBinaryExt(ffillBin.data(), ffillBin.size()-1, &cond) || !cond)
+                continue;
+            nCCInputs++;
+            ReplayCtx ctx = { &eval, &tx, nIn, &stats };
+            for (int rep = 0; rep < nAmplify; rep++)
+                cc_verifyEval(cond, ReplayEvalNode, &ctx);
+            cc_free(cond);
+        }
+    }
+    int64_t nWallMicros = GetTimeMicros() - nWallStart;
+
+    printf("TestCCReplay: %u txs, %llu CC inputs, amplify x%d, %.3f s total\n",
+           (unsigned)vReplay.size(), (unsigned long long)nCCInputs, nAmplify,
+           nWallMicros / 1000000.0);
+    printf("%-16s %10s %10s %12s %10s\n", "evalcode", "calls", "valid", "total ms", "avg us");
+    for (const auto& it : stats) {
+        printf("%-16s %10llu %10llu %12.1f %10.1f\n",
+               EvalToStr(it.first).data(),
+               (unsigned long long)it.second.nCalls,
+               (unsigned long long)it.second.nValid,
+               it.second.nMicros / 1000.0,
+               it.second.nCalls ? (double)it.second.nMicros / it.second.nCalls : 0.0);
+    }
+    EXPECT_GT(nCCInputs, 0u) << "capture contains no CC spends";
+
+    ASSETCHAINS_CC = oldCC;
+}
+
+} // namespace TestCCReplay
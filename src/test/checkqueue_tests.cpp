@@ -0,0 +1,91 @@
+// Copyright (c) 2012-2014 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "checkqueue.h"
+#include "test/test_bitcoin.h"
+
+#include <atomic>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(checkqueue_tests, BasicTestingSetup)
+
+static std::atomic<unsigned int> nChecksRun(0);
+
+struct FakeCheck {
+    bool fFail;
+    FakeCheck() : fFail(false) {}
+    bool operator()()
+    {
+        nChecksRun.fetch_add(1);
+        return !fFail;
+    }
+    void swap(FakeCheck& check) { std::swap(fFail, check.fFail); }
+};
+
+//! Push nChecks checks (nBad of them failing) through a queue served by
+//! nWorkers threads and return what Wait() reported.
+static bool RunQueue(unsigned int nChecks, unsigned int nBad, int nWorkers)
+{
+    CCheckQueue<FakeCheck> queue(16, 64); // small ring to exercise the full-ring path
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nWorkers; i++)
+        threadGroup.create_thread(boost::bind(&CCheckQueue<FakeCheck>::Thread, &queue));
+    nChecksRun.store(0);
+    bool fRet;
+    {
+        CCheckQueueControl<FakeCheck> control(&queue);
+        unsigned int nQueued = 0;
+        while (nQueued < nChecks) {
+            unsigned int nNow = std::min(17U, nChecks - nQueued);
+            std::vector<FakeCheck> vChecks(nNow);
+            for (unsigned int i = 0; i < nNow; i++)
+                vChecks[i].fFail = (nQueued + i) < nBad;
+            control.Add(vChecks);
+            nQueued += nNow;
+        }
+        fRet = control.Wait();
+    }
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    BOOST_CHECK(nChecksRun.load() <= nChecks);
+    return fRet;
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_all_ok)
+{
+    BOOST_CHECK(RunQueue(0, 0, 3));
+    BOOST_CHECK(RunQueue(1, 0, 3));
+    BOOST_CHECK(RunQueue(1000, 0, 3));
+    BOOST_CHECK(RunQueue(1000, 0, 0)); // master drains everything itself
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_failure)
+{
+    BOOST_CHECK(!RunQueue(1, 1, 3));
+    BOOST_CHECK(!RunQueue(1000, 1, 3));
+    BOOST_CHECK(!RunQueue(1000, 1000, 3));
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_reuse)
+{
+    // A failed run must not poison the result of the next run.
+    CCheckQueue<FakeCheck> queue(16, 64);
+    {
+        CCheckQueueControl<FakeCheck> control(&queue);
+        std::vector<FakeCheck> vChecks(5);
+        vChecks[2].fFail = true;
+        control.Add(vChecks);
+        BOOST_CHECK(!control.Wait());
+    }
+    {
+        CCheckQueueControl<FakeCheck> control(&queue);
+        std::vector<FakeCheck> vChecks(5);
+        control.Add(vChecks);
+        BOOST_CHECK(control.Wait());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,10 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "crypto/siphash.h"
+#include "crypto/eh_blake2b.h"
+#include "compat/endian.h"
+#include "sodium.h"
 #include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
@@ -248,4 +252,59 @@ BOOST_AUTO_TEST_CASE(hmac_sha512_testvectors) {
                    "b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58");
 }
 
+BOOST_AUTO_TEST_CASE(siphash_testvectors) {
+    // Vectors from the SipHash reference implementation, key
+    // 000102...0e0f, input the byte sequence 00, 01, 02, ...
+    CSipHasher hasher(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL);
+    BOOST_CHECK_EQUAL(hasher.Finalize(), 0x726fdb47dd0e0e31ull);
+    static const unsigned char t0[] = {0};
+    hasher.Write(t0, 1);
+    BOOST_CHECK_EQUAL(hasher.Finalize(), 0x74f839c593dc67fdull);
+    static const unsigned char t1[] = {1, 2, 3, 4, 5, 6, 7};
+    hasher.Write(t1, 7);
+    BOOST_CHECK_EQUAL(hasher.Finalize(), 0x93f5f5799a932462ull);
+    hasher.Write(0x0F0E0D0C0B0A0908ULL);
+    BOOST_CHECK_EQUAL(hasher.Finalize(), 0x3f2acc7f57c29bdbull);
+
+    // The uint256 specialization must agree with the byte-wise path.
+    uint256 val = GetRandHash();
+    CSipHasher full(0x1122334455667788ULL, 0x99AABBCCDDEEFF00ULL);
+    full.Write(val.begin(), 32);
+    BOOST_CHECK_EQUAL(full.Finalize(), SipHashUint256(0x1122334455667788ULL, 0x99AABBCCDDEEFF00ULL, val));
+}
+
+BOOST_AUTO_TEST_CASE(eh_blake2b_matches_sodium) {
+    // The batched Equihash hasher must agree with libsodium's BLAKE2b for a
+    // header-shaped input (140 bytes of I||V) and the Zcash personalization.
+    unsigned char personal[16];
+    memcpy(personal, "ZcashPoW", 8);
+    uint32_t le_N = htole32(200), le_K = htole32(9);
+    memcpy(personal+8, &le_N, 4);
+    memcpy(personal+12, &le_K, 4);
+
+    unsigned char input[140];
+    for (size_t i = 0; i < sizeof(input); i++)
+        input[i] = (unsigned char)(i * 7 + 1);
+
+    eh_blake2b::MidState mid;
+    eh_blake2b::InitMidState(mid, 50, personal, input, sizeof(input));
+
+    uint32_t g[7] = {0, 1, 2, 42, 1000, 123456, 0x1fffff};
+    unsigned char out[7][50];
+    eh_blake2b::HashMany(mid, g, 7, out[0], 50);
+
+    for (int i = 0; i < 7; i++) {
+        crypto_generichash_blake2b_state state;
+        crypto_generichash_blake2b_init_salt_personal(&state, NULL, 0, 50, NULL, personal);
+        crypto_generichash_blake2b_update(&state, input, sizeof(input));
+        uint32_t lei = htole32(g[i]);
+        crypto_generichash_blake2b_update(&state, (const unsigned char*)&lei, 4);
+        unsigned char expect[50];
+        crypto_generichash_blake2b_final(&state, expect, 50);
+        BOOST_CHECK(memcmp(out[i], expect, 50) == 0);
+    }
+
+    BOOST_CHECK(eh_blake2b::SelfTest());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -47,4 +47,20 @@ BOOST_AUTO_TEST_CASE(murmurhash3)
 #undef T
 }
 
+BOOST_AUTO_TEST_CASE(murmurhash3_multi)
+{
+    // MurmurHash3Multi must agree with MurmurHash3 for every seed.
+    const char* vstrData[] = {"", "00", "ff", "0011", "001122334455667788", "00112233445566778899aabbccddeeff"};
+    unsigned int vSeeds[50];
+    unsigned int vHashes[50];
+    for (unsigned int i = 0; i < 50; i++)
+        vSeeds[i] = i * 0xFBA4C795 + 0xdeadbeef;
+    for (unsigned int j = 0; j < sizeof(vstrData)/sizeof(vstrData[0]); j++) {
+        vector<unsigned char> vData = ParseHex(vstrData[j]);
+        MurmurHash3Multi(vSeeds, 50, vData, vHashes);
+        for (unsigned int i = 0; i < 50; i++)
+            BOOST_CHECK_EQUAL(vHashes[i], MurmurHash3(vSeeds[i], vData));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -212,6 +212,130 @@ BOOST_AUTO_TEST_CASE(RemoveWithoutBranchId) {
     BOOST_CHECK_EQUAL(pool.size(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolPackageTrackingTest)
+{
+    // Test the incrementally maintained ancestor/descendant package state
+
+    TestMemPoolEntryHelper entry;
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(2);
+    for (int i = 0; i < 2; i++)
+    {
+        txParent.vout[i].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        txParent.vout[i].nValue = 33000LL;
+    }
+    CMutableTransaction txChild[2];
+    for (int i = 0; i < 2; i++)
+    {
+        txChild[i].vin.resize(1);
+        txChild[i].vin[0].scriptSig = CScript() << OP_11;
+        txChild[i].vin[0].prevout.hash = txParent.GetHash();
+        txChild[i].vin[0].prevout.n = i;
+        txChild[i].vout.resize(1);
+        txChild[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        txChild[i].vout[0].nValue = 11000LL;
+    }
+    CMutableTransaction txGrandChild;
+    txGrandChild.vin.resize(1);
+    txGrandChild.vin[0].scriptSig = CScript() << OP_11;
+    txGrandChild.vin[0].prevout.hash = txChild[0].GetHash();
+    txGrandChild.vin[0].prevout.n = 0;
+    txGrandChild.vout.resize(1);
+    txGrandChild.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txGrandChild.vout[0].nValue = 5000LL;
+
+    CTxMemPool pool(CFeeRate(0));
+    pool.addUnchecked(txParent.GetHash(), entry.Fee(10000LL).FromTx(txParent));
+    pool.addUnchecked(txChild[0].GetHash(), entry.Fee(5000LL).FromTx(txChild[0]));
+    pool.addUnchecked(txChild[1].GetHash(), entry.Fee(4000LL).FromTx(txChild[1]));
+    pool.addUnchecked(txGrandChild.GetHash(), entry.Fee(1000LL).FromTx(txGrandChild));
+
+    CTxMemPool::indexed_transaction_set::const_iterator parentit = pool.mapTx.find(txParent.GetHash());
+    CTxMemPool::indexed_transaction_set::const_iterator child0it = pool.mapTx.find(txChild[0].GetHash());
+    CTxMemPool::indexed_transaction_set::const_iterator child1it = pool.mapTx.find(txChild[1].GetHash());
+    CTxMemPool::indexed_transaction_set::const_iterator grandit = pool.mapTx.find(txGrandChild.GetHash());
+
+    // the parent covers the whole package
+    BOOST_CHECK_EQUAL(parentit->GetCountWithDescendants(), 4);
+    BOOST_CHECK_EQUAL(parentit->GetFeesWithDescendants(), 20000LL);
+    BOOST_CHECK_EQUAL(parentit->GetSizeWithDescendants(),
+            parentit->GetTxSize() + child0it->GetTxSize() + child1it->GetTxSize() + grandit->GetTxSize());
+    // chains below and above each entry
+    BOOST_CHECK_EQUAL(child0it->GetCountWithDescendants(), 2);
+    BOOST_CHECK_EQUAL(child0it->GetCountWithAncestors(), 2);
+    BOOST_CHECK_EQUAL(child1it->GetCountWithDescendants(), 1);
+    BOOST_CHECK_EQUAL(grandit->GetCountWithAncestors(), 3);
+    BOOST_CHECK_EQUAL(grandit->GetFeesWithAncestors(), 16000LL);
+
+    // removing child 0 takes the grandchild with it and unwinds their
+    // contribution from the remaining entries
+    std::list<CTransaction> removed;
+    pool.remove(txChild[0], removed, true);
+    BOOST_CHECK_EQUAL(removed.size(), 2);
+    BOOST_CHECK_EQUAL(parentit->GetCountWithDescendants(), 2);
+    BOOST_CHECK_EQUAL(parentit->GetFeesWithDescendants(), 14000LL);
+    BOOST_CHECK_EQUAL(child1it->GetCountWithAncestors(), 2);
+
+    // removing the parent (as when it confirms) leaves the child standalone
+    removed.clear();
+    pool.remove(txParent, removed, false);
+    BOOST_CHECK_EQUAL(removed.size(), 1);
+    BOOST_CHECK_EQUAL(child1it->GetCountWithAncestors(), 1);
+    BOOST_CHECK_EQUAL(child1it->GetFeesWithAncestors(), 4000LL);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolSnapshotTest)
+{
+    // Snapshots are immutable copies, reused until the pool changes
+
+    TestMemPoolEntryHelper entry;
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(1);
+    txParent.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txParent.vout[0].nValue = 33000LL;
+    CMutableTransaction txChild;
+    txChild.vin.resize(1);
+    txChild.vin[0].scriptSig = CScript() << OP_11;
+    txChild.vin[0].prevout.hash = txParent.GetHash();
+    txChild.vin[0].prevout.n = 0;
+    txChild.vout.resize(1);
+    txChild.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txChild.vout[0].nValue = 11000LL;
+
+    CTxMemPool pool(CFeeRate(0));
+    pool.addUnchecked(txParent.GetHash(), entry.Fee(10000LL).FromTx(txParent));
+    pool.addUnchecked(txChild.GetHash(), entry.Fee(5000LL).FromTx(txChild));
+
+    CTxMemPoolSnapshotRef snap = pool.GetSnapshot();
+    BOOST_CHECK_EQUAL(snap->vEntries.size(), 2);
+    BOOST_CHECK_EQUAL(snap->nTotalTxSize, pool.GetTotalTxSize());
+    // an unchanged pool hands back the same snapshot object
+    BOOST_CHECK(pool.GetSnapshot() == snap);
+    // the child's snapshot entry records its in-mempool parent
+    for (const CTxMemPoolSnapshotEntry& e : snap->vEntries)
+    {
+        if (e.hash == txChild.GetHash())
+        {
+            BOOST_CHECK_EQUAL(e.vDepends.size(), 1);
+            BOOST_CHECK(e.vDepends[0] == txParent.GetHash());
+        }
+        else
+            BOOST_CHECK_EQUAL(e.vDepends.size(), 0);
+    }
+
+    // a removal invalidates the cached snapshot but not copies already held
+    std::list<CTransaction> removed;
+    pool.remove(txChild, removed, true);
+    CTxMemPoolSnapshotRef snap2 = pool.GetSnapshot();
+    BOOST_CHECK(snap2 != snap);
+    BOOST_CHECK_EQUAL(snap2->vEntries.size(), 1);
+    BOOST_CHECK_EQUAL(snap->vEntries.size(), 2);
+}
+
 // Test that nCheckFrequency is set correctly when calling setSanityCheck().
 // https://github.com/zcash/zcash/issues/3134
 BOOST_AUTO_TEST_CASE(SetSanityCheck) {
@@ -58,6 +58,10 @@ BOOST_AUTO_TEST_CASE(pmt_test1)
             nHeight++;
         }
 
+        // flattened full tree, for the prebuilt-tree constructor
+        std::vector<uint256> vFullTree;
+        BuildMerkleTree(NULL, vTxid, vFullTree);
+
         // check with random subsets with inclusion chances 1, 1/2, 1/4, ..., 1/128
         for (int att = 1; att < 15; att++) {
             // build random subset of txid's
@@ -77,6 +81,12 @@ BOOST_AUTO_TEST_CASE(pmt_test1)
             CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
             ss << pmt1;
 
+            // the prebuilt-tree constructor must produce an identical encoding
+            CPartialMerkleTree pmt1b(vFullTree, nTx, vMatch);
+            CDataStream ssb(SER_NETWORK, PROTOCOL_VERSION);
+            ssb << pmt1b;
+            BOOST_CHECK(std::string(ss.begin(), ss.end()) == std::string(ssb.begin(), ssb.end()));
+
             // verify CPartialMerkleTree's size guarantees
             unsigned int n = std::min<unsigned int>(nTx, 1 + vMatchTxid1.size()*nHeight);
             BOOST_CHECK(ss.size() <= 10 + (258*n+7)/8);
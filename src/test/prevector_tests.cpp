@@ -214,4 +214,33 @@ BOOST_AUTO_TEST_CASE(PrevectorTestInt)
     }
 }
 
+BOOST_AUTO_TEST_CASE(PrevectorTestMove)
+{
+    // Both the inline (<= N) and heap-backed (> N) representations must
+    // survive move construction and move assignment, leaving the source
+    // reusable.
+    for (int size : {3, 8, 20}) {
+        prevector<8, int> a;
+        for (int i = 0; i < size; i++) {
+            a.push_back(i * 7);
+        }
+        prevector<8, int> expected(a);
+
+        prevector<8, int> b(std::move(a));
+        BOOST_CHECK(b == expected);
+
+        prevector<8, int> c;
+        c.push_back(42);
+        c = std::move(b);
+        BOOST_CHECK(c == expected);
+
+        a = prevector<8, int>(expected);
+        BOOST_CHECK(a == expected);
+
+        a.swap(c);
+        BOOST_CHECK(a == expected);
+        BOOST_CHECK(c == expected);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
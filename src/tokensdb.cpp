@@ -0,0 +1,142 @@
+#include "tokensdb.h"
+
+#include "cc/CCinclude.h"
+#include "main.h"
+#include "primitives/block.h"
+#include "util.h"
+
+#include <map>
+#include <utility>
+
+// Database layout:
+//   ('b', (tokenid, address)) -> int64_t   running balance per CC address
+//   ('o', COutPoint)          -> CTokenOutpointValue
+//
+// The outpoint records let spends be debited without re-fetching the funding
+// transaction; they are only erased when their creating block disconnects, so
+// a reorg can replay cleanly in either direction.
+
+bool fTokenIndex = false;
+TokensDB *ptokensdb = NULL;
+
+TokensDB::TokensDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "tokens", nCacheSize, fMemory, fWipe, false, 64) { }
+
+static const char DB_TOKEN_BALANCE = 'b';
+static const char DB_TOKEN_OUTPOINT = 'o';
+
+typedef std::map<std::pair<uint256, std::string>, int64_t> TokenBalanceDeltas;
+
+//! Decode the token id a transaction operates on, or return 0 if it is not a
+//! token transaction. Token transactions carry their opreturn in the last vout.
+static uint8_t GetTxTokenId(const CTransaction &tx, uint256 &tokenid)
+{
+    if (tx.vout.empty())
+        return 0;
+    uint8_t evalcode;
+    std::vector<CPubKey> voutPubkeys;
+    std::vector<std::pair<uint8_t, vscript_t>> oprets;
+    uint8_t funcid = DecodeTokenOpRet(tx.vout.back().scriptPubKey, evalcode, tokenid, voutPubkeys, oprets);
+    if (funcid == 'c')
+        tokenid = tx.GetHash(); // a create is its own token id
+    return funcid;
+}
+
+typedef std::map<COutPoint, CTokenOutpointValue> TokenOutpointMap;
+
+//! Accumulate the balance deltas and outpoint records for one block's token
+//! transactions; positive deltas credit vouts, negative deltas debit spends.
+//! Spends of vouts created earlier in the same block resolve against
+//! mapOutputs, which is why it is consulted before the database.
+static void ScanBlockTokens(const CBlock &block, TokenBalanceDeltas &deltas, TokenOutpointMap &mapOutputs)
+{
+    for (const CTransaction &tx : block.vtx) {
+        // debit any spent token vout, whether or not the spender decodes
+        // (a token can only leave an address by being spent)
+        if (!tx.IsCoinBase()) {
+            for (const CTxIn &vin : tx.vin) {
+                CTokenOutpointValue prev;
+                TokenOutpointMap::const_iterator mi = mapOutputs.find(vin.prevout);
+                if (mi != mapOutputs.end())
+                    prev = mi->second;
+                else if (!ptokensdb->Read(std::make_pair(DB_TOKEN_OUTPOINT, vin.prevout), prev))
+                    continue;
+                deltas[std::make_pair(prev.tokenid, prev.address)] -= prev.satoshis;
+            }
+        }
+        uint256 tokenid;
+        if (GetTxTokenId(tx, tokenid) != 0 && !tokenid.IsNull()) {
+            // credit every CC vout of the token transaction
+            for (unsigned int n = 0; n < tx.vout.size(); n++) {
+                const CTxOut &out = tx.vout[n];
+                if (out.nValue <= 0 || !out.scriptPubKey.IsPayToCryptoCondition())
+                    continue;
+                char destaddr[64];
+                if (!Getscriptaddress(destaddr, out.scriptPubKey))
+                    continue;
+                CTokenOutpointValue val;
+                val.tokenid = tokenid;
+                val.address = destaddr;
+                val.satoshis = out.nValue;
+                mapOutputs[COutPoint(tx.GetHash(), n)] = val;
+                deltas[std::make_pair(tokenid, val.address)] += out.nValue;
+            }
+        }
+    }
+}
+
+//! Apply accumulated deltas to the stored balances inside a batch.
+static void WriteBalanceDeltas(const TokenBalanceDeltas &deltas, CDBBatch &batch, bool fReverse)
+{
+    for (TokenBalanceDeltas::const_iterator it = deltas.begin(); it != deltas.end(); it++) {
+        int64_t balance = 0;
+        ptokensdb->Read(std::make_pair(DB_TOKEN_BALANCE, it->first), balance);
+        balance += fReverse ? -it->second : it->second;
+        if (balance > 0)
+            batch.Write(std::make_pair(DB_TOKEN_BALANCE, it->first), balance);
+        else
+            batch.Erase(std::make_pair(DB_TOKEN_BALANCE, it->first));
+    }
+}
+
+void ConnectTokenIndex(const CBlock &block, int nHeight)
+{
+    TokenBalanceDeltas deltas;
+    TokenOutpointMap mapOutputs;
+    ScanBlockTokens(block, deltas, mapOutputs);
+    if (deltas.empty() && mapOutputs.empty())
+        return;
+
+    CDBBatch batch = CDBBatch(*ptokensdb);
+    for (TokenOutpointMap::const_iterator it = mapOutputs.begin(); it != mapOutputs.end(); it++)
+        batch.Write(std::make_pair(DB_TOKEN_OUTPOINT, it->first), it->second);
+    WriteBalanceDeltas(deltas, batch, false);
+    ptokensdb->WriteBatch(batch, true);
+    LogPrint("tokenindex", "%s: height %d, %u token vouts, %u balances touched\n",
+             __func__, nHeight, mapOutputs.size(), deltas.size());
+}
+
+void DisconnectTokenIndex(const CBlock &block)
+{
+    TokenBalanceDeltas deltas;
+    TokenOutpointMap mapOutputs;
+    ScanBlockTokens(block, deltas, mapOutputs);
+    if (deltas.empty() && mapOutputs.empty())
+        return;
+
+    CDBBatch batch = CDBBatch(*ptokensdb);
+    WriteBalanceDeltas(deltas, batch, true);
+    for (TokenOutpointMap::const_iterator it = mapOutputs.begin(); it != mapOutputs.end(); it++)
+        batch.Erase(std::make_pair(DB_TOKEN_OUTPOINT, it->first));
+    ptokensdb->WriteBatch(batch, true);
+    LogPrint("tokenindex", "%s: %u token vouts removed, %u balances touched\n",
+             __func__, mapOutputs.size(), deltas.size());
+}
+
+bool GetTokenIndexBalance(const uint256 &tokenid, const std::string &address, int64_t &balance)
+{
+    balance = 0;
+    if (!fTokenIndex || ptokensdb == NULL)
+        return false;
+    ptokensdb->Read(std::make_pair(DB_TOKEN_BALANCE, std::make_pair(tokenid, address)), balance);
+    return true;
+}
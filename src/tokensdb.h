@@ -0,0 +1,68 @@
+#ifndef TOKENSDB_H
+#define TOKENSDB_H
+
+#include "dbwrapper.h"
+#include "uint256.h"
+
+#include <string>
+#include <vector>
+
+class CBlock;
+
+/** -tokenindex: maintain tokenid -> (address -> balance) totals at block
+ * connect/disconnect so token balance queries do not re-scan and re-decode
+ * the CC address UTXO set on every call. */
+extern bool fTokenIndex;
+
+class TokensDB : public CDBWrapper
+{
+public:
+    TokensDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+};
+
+extern TokensDB *ptokensdb;
+
+//! Metadata remembered per token vout so spends can be debited without
+//! re-fetching and re-decoding the funding transaction.
+struct CTokenOutpointValue
+{
+    uint256 tokenid;
+    std::string address; //!< CC address holding the vout
+    int64_t satoshis;
+
+    CTokenOutpointValue() : satoshis(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(tokenid);
+        READWRITE(address);
+        READWRITE(satoshis);
+    }
+};
+
+/****
+ * Credit and debit token balances for all token transactions in a connected
+ * block. Must be called exactly once per connected block, in order.
+ * @param block the connected block
+ * @param nHeight its height
+ */
+void ConnectTokenIndex(const CBlock &block, int nHeight);
+
+/****
+ * Reverse ConnectTokenIndex for a disconnected block.
+ * @param block the block being disconnected
+ */
+void DisconnectTokenIndex(const CBlock &block);
+
+/****
+ * Read an indexed balance.
+ * @param tokenid the token
+ * @param address the CC address
+ * @param[out] balance the indexed balance (0 if the key is absent)
+ * @returns false if the token index is disabled
+ */
+bool GetTokenIndexBalance(const uint256 &tokenid, const std::string &address, int64_t &balance);
+
+#endif /* TOKENSDB_H */
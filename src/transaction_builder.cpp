@@ -4,6 +4,8 @@
 
 #include "transaction_builder.h"
 
+#include "init.h"
+
 #include "main.h"
 #include "pubkey.h"
 #include "script/sign.h"
@@ -167,6 +169,7 @@ boost::optional<CTransaction> TransactionBuilder::Build()
     // Sapling spends and outputs
     //
 
+    ZC_LoadParamsOnDemand(); // no-op unless the load was deferred on an -ac_public chain
     auto ctx = librustzcash_sapling_proving_ctx_init();
 
     // Create Sapling SpendDescriptions
@@ -26,9 +26,11 @@
 #include "main.h"
 #include "pow.h"
 #include "uint256.h"
+#include "util.h"
 #include "core_io.h"
 #include "komodo_bitcoind.h"
 
+#include <algorithm>
 #include <stdint.h>
 
 #include <boost/thread.hpp>
@@ -45,6 +47,8 @@ static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_ADDRESSINDEX = 'd';
+static const char DB_ADDRESSHEIGHTINDEX = 'D';
+static const char DB_BLOCKFILTER = 'g';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_TIMESTAMPINDEX = 'S';
 static const char DB_BLOCKHASHINDEX = 'z';
@@ -57,13 +61,63 @@ static const char DB_BEST_SAPLING_ANCHOR = 'z';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_BLOCK_INDEX_SIZE = 'n';
+static const char DB_UTXO_STATS = 'U';
+static const char DB_WATCHADDRESS = 'w';
+static const char DB_WATCHINDEX = 'W';
+static const char DB_SYNC_TXRATE = 'y';
+
+//! Hash of one (txid, coins) record for the rolling set hash
+static uint256 CoinsEntryHash(const uint256 &txid, const CCoins &coins)
+{
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << txid;
+    ss << coins;
+    return ss.GetHash();
+}
+
+static void XorInto(uint256 &acc, const uint256 &h)
+{
+    for (size_t i = 0; i < acc.size(); i++)
+        *(acc.begin() + i) ^= *(h.begin() + i);
+}
 
+//! Fold one coin record into (or out of) the running statistics; removal is
+//! exact because the rolling hash XOR is its own inverse
+static void UpdateSetStats(CCoinsSetStats &stats, const uint256 &txid, const CCoins &coins, bool fAdd)
+{
+    uint64_t nOutputs = 0;
+    CAmount nValue = 0;
+    for (unsigned int i = 0; i < coins.vout.size(); i++) {
+        if (!coins.vout[i].IsNull()) {
+            nOutputs++;
+            nValue += coins.vout[i].nValue;
+        }
+    }
+    uint64_t nSize = 32 + ::GetSerializeSize(coins, SER_DISK, CLIENT_VERSION);
+    if (fAdd) {
+        stats.nTransactions++;
+        stats.nTransactionOutputs += nOutputs;
+        stats.nSerializedSize += nSize;
+        stats.nTotalAmount += nValue;
+    } else {
+        stats.nTransactions--;
+        stats.nTransactionOutputs -= nOutputs;
+        stats.nSerializedSize -= nSize;
+        stats.nTotalAmount -= nValue;
+    }
+    XorInto(stats.hashRolling, CoinsEntryHash(txid, coins));
+}
 
 CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe) {
+    // A wiped database is an empty set, whose statistics are exactly the
+    // zero-initialized defaults, so a reindex grows them from scratch
+    fSetStatsValid = db.Read(DB_UTXO_STATS, setStats) || fWipe;
 }
 
 CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe)
 {
+    fSetStatsValid = db.Read(DB_UTXO_STATS, setStats) || fWipe;
 }
 
 
@@ -91,6 +145,30 @@ bool CCoinsViewDB::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree
     return read;
 }
 
+//! Entries kept in the sapling anchor membership cache (32 bytes each)
+static const size_t MAX_SAPLING_ANCHOR_CACHE = 4096;
+
+bool CCoinsViewDB::HaveSaplingAnchorAt(const uint256 &rt) const {
+    if (rt == SaplingMerkleTree::empty_root())
+        return true;
+    {
+        LOCK(cs_saplingAnchorCache);
+        if (setSaplingAnchorCache.count(rt) != 0)
+            return true;
+    }
+    if (!db.Exists(make_pair(DB_SAPLING_ANCHOR, rt)))
+        return false;
+    LOCK(cs_saplingAnchorCache);
+    if (setSaplingAnchorCache.insert(rt).second) {
+        saplingAnchorCacheOrder.push_back(rt);
+        while (saplingAnchorCacheOrder.size() > MAX_SAPLING_ANCHOR_CACHE) {
+            setSaplingAnchorCache.erase(saplingAnchorCacheOrder.front());
+            saplingAnchorCacheOrder.pop_front();
+        }
+    }
+    return true;
+}
+
 bool CCoinsViewDB::GetNullifier(const uint256 &nf, ShieldedType type) const {
     bool spent = false;
     char dbChar;
@@ -184,22 +262,61 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
                               CNullifiersMap &mapSproutNullifiers,
                               CNullifiersMap &mapSaplingNullifiers) {
     CDBBatch batch(db);
-    size_t count = 0;
+    size_t count = mapCoins.size();
     size_t changed = 0;
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
-        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            if (it->second.coins.IsPruned())
-                batch.Erase(make_pair(DB_COINS, it->first));
-            else
-                batch.Write(make_pair(DB_COINS, it->first), it->second.coins);
-            changed++;
+    // Gather the dirty entries and feed them to the batch in key order. The
+    // cache map is unordered, and handing LevelDB a multi-gigabyte batch in
+    // random key order makes every memtable flush overlap the whole key space,
+    // maximizing compaction work; sorted input produces nearly disjoint
+    // sstables instead. The iterators stay valid since nothing is erased
+    // until after the batch is built.
+    std::vector<CCoinsMap::iterator> vDirty;
+    vDirty.reserve(count);
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY)
+            vDirty.push_back(it);
+    }
+    std::sort(vDirty.begin(), vDirty.end(),
+              [](const CCoinsMap::iterator& a, const CCoinsMap::iterator& b) { return a->first < b->first; });
+    CCoinsSetStats statsNew;
+    bool fUpdateStats = false;
+    {
+        LOCK(cs_setStats);
+        if (fSetStatsValid) {
+            statsNew = setStats;
+            fUpdateStats = true;
+        }
+    }
+    for (const CCoinsMap::iterator& it : vDirty) {
+        if (fUpdateStats) {
+            // Fold this record's delta into the running statistics. FRESH
+            // entries have no database predecessor to subtract; the others
+            // need the old record, which validation read moments ago, so the
+            // lookup is served from LevelDB's warm caches.
+            CCoins coinsOld;
+            if (!(it->second.flags & CCoinsCacheEntry::FRESH) && db.Read(make_pair(DB_COINS, it->first), coinsOld))
+                UpdateSetStats(statsNew, it->first, coinsOld, false);
+            if (!it->second.coins.IsPruned())
+                UpdateSetStats(statsNew, it->first, it->second.coins, true);
         }
-        count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (it->second.coins.IsPruned())
+            batch.Erase(make_pair(DB_COINS, it->first));
+        else
+            batch.Write(make_pair(DB_COINS, it->first), it->second.coins);
+        changed++;
     }
+    mapCoins.clear();
 
     ::BatchWriteAnchors<CAnchorsSproutMap, CAnchorsSproutMap::iterator, CAnchorsSproutCacheEntry, SproutMerkleTree>(batch, mapSproutAnchors, DB_SPROUT_ANCHOR);
+    {
+        // Anchors being erased (reorg) must also leave the membership cache,
+        // and the map is consumed by BatchWriteAnchors below.
+        LOCK(cs_saplingAnchorCache);
+        for (CAnchorsSaplingMap::const_iterator it = mapSaplingAnchors.begin(); it != mapSaplingAnchors.end(); it++) {
+            if ((it->second.flags & CAnchorsSaplingCacheEntry::DIRTY) && !it->second.entered)
+                setSaplingAnchorCache.erase(it->first);
+        }
+    }
     ::BatchWriteAnchors<CAnchorsSaplingMap, CAnchorsSaplingMap::iterator, CAnchorsSaplingCacheEntry, SaplingMerkleTree>(batch, mapSaplingAnchors, DB_SAPLING_ANCHOR);
 
     ::BatchWriteNullifiers(batch, mapSproutNullifiers, DB_NULLIFIER);
@@ -211,9 +328,16 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
         batch.Write(DB_BEST_SPROUT_ANCHOR, hashSproutAnchor);
     if (!hashSaplingAnchor.IsNull())
         batch.Write(DB_BEST_SAPLING_ANCHOR, hashSaplingAnchor);
+    if (fUpdateStats)
+        batch.Write(DB_UTXO_STATS, statsNew);
 
     LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
-    return db.WriteBatch(batch);
+    bool fOk = db.WriteBatch(batch);
+    if (fOk && fUpdateStats) {
+        LOCK(cs_setStats);
+        setStats = statsNew;
+    }
+    return fOk;
 }
 
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) 
@@ -251,6 +375,7 @@ bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
     stats.hashBlock = GetBestBlock();
     ss << stats.hashBlock;
     CAmount nTotalAmount = 0;
+    CCoinsSetStats seed;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char, uint256> key;
@@ -269,6 +394,7 @@ bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
                 }
                 stats.nSerializedSize += 32 + pcursor->GetValueSize();
                 ss << VARINT(0);
+                UpdateSetStats(seed, key.second, coins, true);
             } else {
                 return error("CCoinsViewDB::GetStats() : unable to read value");
             }
@@ -283,9 +409,117 @@ bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
     }
     stats.hashSerialized = ss.GetHash();
     stats.nTotalAmount = nTotalAmount;
+    {
+        // Seed the incrementally maintained statistics from the scan just
+        // performed, so future queries are instant; a const_cast for the
+        // same reason as the iterator above.
+        CCoinsViewDB *self = const_cast<CCoinsViewDB*>(this);
+        LOCK(self->cs_setStats);
+        if (self->db.Write(DB_UTXO_STATS, seed)) {
+            self->setStats = seed;
+            self->fSetStatsValid = true;
+        }
+    }
+    return true;
+}
+
+bool CCoinsViewDB::GetSetStats(CCoinsSetStats &stats) const
+{
+    LOCK(cs_setStats);
+    if (!fSetStatsValid)
+        return false;
+    stats = setStats;
+    return true;
+}
+
+//! Serialize one raw (key, value) record into a snapshot file, mirroring the
+//! bytes into the running content hash.
+static void WriteSnapshotRecord(CAutoFile &fileout, CHashWriter &hasher, unsigned char chTag,
+                                const CDataStream &ssKey, const CDataStream &ssValue, CDataStream &ssRec)
+{
+    ssRec.clear();
+    ssRec << chTag;
+    ssRec << std::vector<unsigned char>(ssKey.begin(), ssKey.end());
+    ssRec << std::vector<unsigned char>(ssValue.begin(), ssValue.end());
+    fileout.write(&ssRec[0], ssRec.size());
+    hasher.write(&ssRec[0], ssRec.size());
+}
+
+bool CCoinsViewDB::WriteSnapshot(CAutoFile &fileout, CHashWriter &hasher, uint64_t &nRecords) const {
+    /* As in GetStats, leveldb has no const iterators, so const-cast for
+       read-only access. */
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+    pcursor->SeekToFirst();
+    CDataStream ssRec(SER_DISK, CLIENT_VERSION);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        if (!pcursor->GetKeyDataStream(ssKey) || !pcursor->GetValueDataStream(ssValue))
+            return error("CCoinsViewDB::WriteSnapshot() : unable to read record");
+        WriteSnapshotRecord(fileout, hasher, SNAPSHOT_REC_CHAINSTATE, ssKey, ssValue, ssRec);
+        nRecords++;
+        pcursor->Next();
+    }
     return true;
 }
 
+bool CCoinsViewDB::ImportSnapshotRecords(const std::vector<CSnapshotRecord> &vRecords) {
+    CDBBatch batch(db);
+    for (const CSnapshotRecord& record : vRecords)
+        batch.WriteRaw(record.first, record.second);
+    return db.WriteBatch(batch);
+}
+
+bool CBlockTreeDB::WriteBlockIndexSnapshot(CAutoFile &fileout, CHashWriter &hasher, uint64_t &nRecords) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(make_pair(DB_BLOCK_INDEX, uint256()));
+    CDataStream ssRec(SER_DISK, CLIENT_VERSION);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        if (!pcursor->GetKeyDataStream(ssKey))
+            return error("%s: unable to read key", __func__);
+        if (ssKey.size() == 0 || ssKey[0] != DB_BLOCK_INDEX)
+            break;
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        if (!pcursor->GetValueDataStream(ssValue))
+            return error("%s: unable to read value", __func__);
+        WriteSnapshotRecord(fileout, hasher, SNAPSHOT_REC_BLOCKINDEX, ssKey, ssValue, ssRec);
+        nRecords++;
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ImportSnapshotBlockIndex(const std::vector<CSnapshotRecord> &vRecords) {
+    CDBBatch batch(*this);
+    for (const CSnapshotRecord& record : vRecords) {
+        try {
+            CDataStream ssKey((const char*)record.first.data(),
+                              (const char*)record.first.data() + record.first.size(), SER_DISK, CLIENT_VERSION);
+            std::pair<char, uint256> key;
+            ssKey >> key;
+            if (key.first != DB_BLOCK_INDEX)
+                return error("%s: unexpected key prefix", __func__);
+            CDataStream ssValue((const char*)record.second.data(),
+                                (const char*)record.second.data() + record.second.size(), SER_DISK, CLIENT_VERSION);
+            CDiskBlockIndex diskindex;
+            ssValue >> diskindex;
+            // No block or undo files come with a snapshot: store the entry the
+            // way PruneOneBlockFile leaves pruned entries behind.
+            diskindex.nStatus &= ~(BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO);
+            diskindex.nFile = 0;
+            diskindex.nDataPos = 0;
+            diskindex.nUndoPos = 0;
+            batch.Write(make_pair(DB_BLOCK_INDEX, key.second), diskindex);
+        } catch (const std::exception&) {
+            return error("%s: failed to decode block index record", __func__);
+        }
+    }
+    return WriteBatch(batch, true);
+}
+
 /***
  * Write a batch of records and sync
  * @param fileInfo the records to write
@@ -299,6 +533,8 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
         batch.Write(make_pair(DB_BLOCK_FILES, it.first), *it.second);
     }
     batch.Write(DB_LAST_BLOCK, nLastFile);
+    // Keep the presize hint for the next load current with every index flush.
+    batch.Write(DB_BLOCK_INDEX_SIZE, (uint64_t)mapBlockIndex.size());
     for (const auto& it : blockinfo) {
         std::pair<char, uint256> key = make_pair(DB_BLOCK_INDEX, it->GetBlockHash());
         try {
@@ -332,8 +568,29 @@ bool CBlockTreeDB::ReadDiskBlockIndex(const uint256 &blockhash, CDiskBlockIndex
     return Read(make_pair(DB_BLOCK_INDEX, blockhash), dbindex);
 }
 
+//! Entries kept in the txid position cache (~70 bytes each)
+static const size_t MAX_TXINDEX_CACHE = 100000;
+
 bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) const {
-    return Read(make_pair(DB_TXINDEX, txid), pos);
+    {
+        LOCK(cs_txIndexCache);
+        std::map<uint256, CDiskTxPos>::const_iterator it = mapTxIndexCache.find(txid);
+        if (it != mapTxIndexCache.end()) {
+            pos = it->second;
+            return true;
+        }
+    }
+    if (!Read(make_pair(DB_TXINDEX, txid), pos))
+        return false;
+    LOCK(cs_txIndexCache);
+    if (mapTxIndexCache.size() >= MAX_TXINDEX_CACHE) {
+        std::map<uint256, CDiskTxPos>::iterator itEvict = mapTxIndexCache.lower_bound(txid);
+        if (itEvict == mapTxIndexCache.end())
+            itEvict = mapTxIndexCache.begin();
+        mapTxIndexCache.erase(itEvict);
+    }
+    mapTxIndexCache[txid] = pos;
+    return true;
 }
 
 bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >&vect) {
@@ -408,28 +665,168 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
 
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
+        if (fAddressHeightIndexing)
+            batch.Write(make_pair(DB_ADDRESSHEIGHTINDEX, CAddressHeightIndexKey(it->first)), it->second);
+    }
+    if (!WriteBatch(batch))
+        return false;
+    ApplySnapshotDeltas(vect, false);
+    return true;
 }
 
 bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
+        if (fAddressHeightIndexing)
+            batch.Erase(make_pair(DB_ADDRESSHEIGHTINDEX, CAddressHeightIndexKey(it->first)));
+    }
+    if (!WriteBatch(batch))
+        return false;
+    ApplySnapshotDeltas(vect, true);
+    return true;
 }
 
-bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
-                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
+bool CBlockTreeDB::WriteIndexUpdates(const std::vector<std::pair<uint256, CDiskTxPos> > &txIndex,
+                                     const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                     const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &addressUnspentIndex,
+                                     const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &spentIndex,
+                                     const CTimestampIndexKey *ptimestampIndex,
+                                     const CTimestampBlockIndexKey *pblockhashIndex,
+                                     const CTimestampBlockIndexValue *plogicalts) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<uint256,CDiskTxPos> >::const_iterator it=txIndex.begin(); it!=txIndex.end(); it++)
+        batch.Write(make_pair(DB_TXINDEX, it->first), it->second);
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+        batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
+        if (fAddressHeightIndexing)
+            batch.Write(make_pair(DB_ADDRESSHEIGHTINDEX, CAddressHeightIndexKey(it->first)), it->second);
+    }
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=addressUnspentIndex.begin(); it!=addressUnspentIndex.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
+        } else {
+            batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+        }
+    }
+    for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=spentIndex.begin(); it!=spentIndex.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(make_pair(DB_SPENTINDEX, it->first));
+        } else {
+            batch.Write(make_pair(DB_SPENTINDEX, it->first), it->second);
+        }
+    }
+    if (ptimestampIndex)
+        batch.Write(make_pair(DB_TIMESTAMPINDEX, *ptimestampIndex), 0);
+    if (pblockhashIndex)
+        batch.Write(make_pair(DB_BLOCKHASHINDEX, *pblockhashIndex), *plogicalts);
+    if (!WriteBatch(batch))
+        return false;
+    if (!addressIndex.empty())
+        ApplySnapshotDeltas(addressIndex, false);
+    return true;
+}
 
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+bool CBlockTreeDB::EraseIndexUpdates(const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                     const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &addressUnspentIndex) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+        batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
+        if (fAddressHeightIndexing)
+            batch.Erase(make_pair(DB_ADDRESSHEIGHTINDEX, CAddressHeightIndexKey(it->first)));
+    }
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=addressUnspentIndex.begin(); it!=addressUnspentIndex.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
+        } else {
+            batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+        }
+    }
+    if (!WriteBatch(batch))
+        return false;
+    if (!addressIndex.empty())
+        ApplySnapshotDeltas(addressIndex, true);
+    return true;
+}
+
+void CBlockTreeDB::ApplySnapshotDeltas(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, bool fUndo)
+{
+    LOCK(cs_snapshotAggregate);
+    if (!fSnapshotAggregateValid)
+        return;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = vect.begin(); it != vect.end(); it++) {
+        CAmount nDelta = fUndo ? -it->second : it->second;
+        if (nDelta == 0) // zero-value outputs are skipped, as in the baseline scan
+            continue;
+        std::pair<uint160, int> key = std::make_pair(it->first.hashBytes, (int)it->first.type);
+        std::pair<CAmount, int64_t> &entry = mapSnapshotAggregate[key];
+        entry.first += nDelta;
+        // each positive delta is one utxo created, each negative one spent
+        entry.second += (nDelta > 0) ? 1 : -1;
+        if (entry.first == 0 && entry.second <= 0)
+            mapSnapshotAggregate.erase(key);
+    }
+}
+
+bool CBlockTreeDB::BuildSnapshotAggregate()
+{
+    AssertLockHeld(cs_snapshotAggregate);
+    mapSnapshotAggregate.clear();
+    boost::scoped_ptr<CDBIterator> iter(NewIterator());
+
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev())
+    {
+        boost::this_thread::interruption_point();
+        try
+        {
+            pair<char, CAddressIndexIteratorKey> keyObj;
+            iter->GetKey(keyObj);
+            char chType = keyObj.first;
+            CAddressIndexIteratorKey indexKey = keyObj.second;
+
+            if (chType == DB_ADDRESSUNSPENTINDEX)
+            {
+                try {
+                    CAmount nValue;
+                    iter->GetValue(nValue);
+                    if ( nValue == 0 )
+                        continue;
+                    std::pair<CAmount, int64_t> &entry = mapSnapshotAggregate[std::make_pair(indexKey.hashBytes, (int)indexKey.type)];
+                    entry.first += nValue;
+                    entry.second++;
+                }
+                catch (const std::exception& e)
+                {
+                    fprintf(stderr, "DONE %s: LevelDB addressindex exception! - %s\n", __func__, e.what());
+                    return false;
+                }
+            }
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "DONE reading index entries\n");
+            break;
+        }
+    }
+    return true;
+}
+
+/****
+ * Scan one address' records on an existing iterator. Shared by the single- and
+ * multi-address ReadAddressIndex variants so a request for several addresses
+ * can reuse one LevelDB iterator instead of opening one per address; the watch
+ * index stores the same record shape under its own prefix and reuses the scan.
+ */
+static bool ScanAddressIndex(CDBIterator *pcursor, char chPrefix, uint160 addressHash, int type,
+                             std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                             int start, int end, size_t nMaxEntries) {
 
     if (start > 0 && end > 0) {
-        pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
+        pcursor->Seek(make_pair(chPrefix, CAddressIndexIteratorHeightKey(type, addressHash, start)));
     } else {
-        pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+        pcursor->Seek(make_pair(chPrefix, CAddressIndexIteratorKey(type, addressHash)));
     }
 
     while (pcursor->Valid()) {
@@ -440,10 +837,16 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
             char chType = keyObj.first;
             CAddressIndexKey indexKey = keyObj.second;
 
-            if (chType == DB_ADDRESSINDEX && indexKey.hashBytes == addressHash) {
+            if (chType == chPrefix && indexKey.hashBytes == addressHash) {
                 if (end > 0 && indexKey.blockHeight > end) {
                     break;
                 }
+                // once the cap is reached, finish out the current height so a
+                // block's entries are never split across two pages
+                if (nMaxEntries > 0 && addressIndex.size() >= nMaxEntries &&
+                    indexKey.blockHeight > addressIndex.back().first.blockHeight) {
+                    break;
+                }
                 try {
                     CAmount nValue;
                     pcursor->GetValue(nValue);
@@ -464,6 +867,129 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
+                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                    int start, int end, size_t nMaxEntries) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    return ScanAddressIndex(pcursor.get(), DB_ADDRESSINDEX, addressHash, type, addressIndex, start, end, nMaxEntries);
+}
+
+bool CBlockTreeDB::ReadAddressIndex(const std::vector<std::pair<uint160, int> > &addresses,
+                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                    int start, int end, size_t nMaxEntries) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    for (std::vector<std::pair<uint160, int> >::const_iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (nMaxEntries > 0 && addressIndex.size() >= nMaxEntries)
+            break;
+        if (!ScanAddressIndex(pcursor.get(), DB_ADDRESSINDEX, it->first, it->second, addressIndex, start, end, nMaxEntries))
+            return false;
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::WriteWatchAddress(const uint160 &addressHash, int type, int64_t nRegistered) {
+    return Write(make_pair(DB_WATCHADDRESS, make_pair(addressHash, type)), nRegistered);
+}
+
+bool CBlockTreeDB::EraseWatchAddress(const uint160 &addressHash, int type) {
+    return Erase(make_pair(DB_WATCHADDRESS, make_pair(addressHash, type)));
+}
+
+bool CBlockTreeDB::LoadWatchAddresses(std::map<std::pair<uint160, int>, int64_t> &addresses) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(DB_WATCHADDRESS);
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, pair<uint160, int> > keyObj;
+            if (!pcursor->GetKey(keyObj) || keyObj.first != DB_WATCHADDRESS)
+                break;
+            int64_t nRegistered;
+            pcursor->GetValue(nRegistered);
+            addresses[keyObj.second] = nRegistered;
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            return error("failed to load watch addresses");
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::WriteWatchIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Write(make_pair(DB_WATCHINDEX, it->first), it->second);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseWatchIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Erase(make_pair(DB_WATCHINDEX, it->first));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadWatchIndex(const std::vector<std::pair<uint160, int> > &addresses,
+                                  std::vector<std::pair<CAddressIndexKey, CAmount> > &watchIndex,
+                                  int start, int end, size_t nMaxEntries) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    for (std::vector<std::pair<uint160, int> >::const_iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (nMaxEntries > 0 && watchIndex.size() >= nMaxEntries)
+            break;
+        if (!ScanAddressIndex(pcursor.get(), DB_WATCHINDEX, it->first, it->second, watchIndex, start, end, nMaxEntries))
+            return false;
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::WriteBlockFilter(const uint256 &blockhash, const std::vector<unsigned char> &vchFilter) {
+    return Write(make_pair(DB_BLOCKFILTER, blockhash), vchFilter);
+}
+
+bool CBlockTreeDB::ReadBlockFilter(const uint256 &blockhash, std::vector<unsigned char> &vchFilter) const {
+    return Read(make_pair(DB_BLOCKFILTER, blockhash), vchFilter);
+}
+
+bool CBlockTreeDB::ReadAddressHeightIndex(int start, int end,
+                                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_ADDRESSHEIGHTINDEX, CAddressHeightIndexIteratorKey(start)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, CAddressHeightIndexKey> keyObj;
+            pcursor->GetKey(keyObj);
+            if (keyObj.first != DB_ADDRESSHEIGHTINDEX)
+                break;
+            if (end > 0 && keyObj.second.blockHeight > end)
+                break;
+            CAmount nValue;
+            pcursor->GetValue(nValue);
+            addressIndex.push_back(make_pair(keyObj.second.ToAddressIndexKey(), nValue));
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+
+    return true;
+}
+
 bool getAddressFromIndex(const int &type, const uint160 &hash, std::string &address);
 
 #define DECLARE_IGNORELIST std::map <std::string,int> ignoredMap = { \
@@ -582,30 +1108,90 @@ bool CBlockTreeDB::Snapshot2(std::map <std::string, CAmount> &addressAmounts, Un
 
 extern std::vector <std::pair<CAmount, CTxDestination>> vAddressSnapshot; // daily snapshot
 
-UniValue CBlockTreeDB::Snapshot(int top)
+UniValue CBlockTreeDB::Snapshot(int top, int from)
 {
     std::vector <std::pair<CAmount, std::string>> vaddr;
-    std::map <std::string, CAmount> addressAmounts;
     UniValue result(UniValue::VOBJ);
     UniValue addressesSorted(UniValue::VARR);
     result.push_back(Pair("start_time", (int) time(NULL)));
 
-    if ( (vAddressSnapshot.size() > 0 && top < 0) || (Snapshot2(addressAmounts,&result) && top >= 0) )
+    bool fOk = true;
+    if ( top >= 0 )
     {
-        if ( top > -1 )
+        // serve from the incrementally maintained aggregate; the full
+        // unspent index walk only happens the first time (or never, once
+        // the aggregate survives from startup)
+        int64_t total = 0; int64_t totalAddresses = 0; std::string address;
+        int64_t utxos = 0; int64_t ignoredAddresses = 0, cryptoConditionsUTXOs = 0, cryptoConditionsTotals = 0;
+        DECLARE_IGNORELIST
+
+        // copy the raw aggregate under its lock; conversion and sorting run
+        // without blocking the ConnectBlock delta updates
+        std::vector<std::pair<std::pair<uint160, int>, std::pair<CAmount, int64_t> > > vAggregate;
         {
-            for (std::pair<std::string, CAmount> element : addressAmounts)
-                vaddr.push_back( make_pair(element.second, element.first) );
-            std::sort(vaddr.rbegin(), vaddr.rend());
+            LOCK(cs_snapshotAggregate);
+            if (!fSnapshotAggregateValid)
+            {
+                fOk = BuildSnapshotAggregate();
+                fSnapshotAggregateValid = fOk;
+            }
+            if (fOk)
+                vAggregate.assign(mapSnapshotAggregate.begin(), mapSnapshotAggregate.end());
         }
-        else 
+        if (fOk)
         {
-            for ( auto address : vAddressSnapshot )
-                vaddr.push_back(make_pair(address.first, CBitcoinAddress(address.second).ToString()));
-            top = vAddressSnapshot.size();
+            for (std::vector<std::pair<std::pair<uint160, int>, std::pair<CAmount, int64_t> > >::const_iterator it = vAggregate.begin(); it != vAggregate.end(); it++)
+            {
+                if ( it->second.first <= 0 )
+                    continue;
+                if ( it->first.second == 3 )
+                {
+                    cryptoConditionsUTXOs += it->second.second;
+                    cryptoConditionsTotals += it->second.first;
+                    total += it->second.first;
+                    continue;
+                }
+                getAddressFromIndex(it->first.second, it->first.first, address);
+                std::map <std::string, int>::iterator ignored = ignoredMap.find(address);
+                if (ignored != ignoredMap.end())
+                {
+                    ignoredAddresses++;
+                    continue;
+                }
+                vaddr.push_back(make_pair(it->second.first, address));
+                totalAddresses++;
+                utxos += it->second.second;
+                total += it->second.first;
+            }
+            std::sort(vaddr.rbegin(), vaddr.rend());
+
+            // totals cover the whole aggregate even when the address list is paged
+            result.push_back(make_pair("total", (double) (total)/ COIN ));
+            result.push_back(make_pair("average",(double) (total/COIN) / totalAddresses ));
+            result.push_back(make_pair("utxos", utxos));
+            result.push_back(make_pair("total_addresses", totalAddresses ));
+            result.push_back(make_pair("ignored_addresses", ignoredAddresses));
+            result.push_back(make_pair("skipped_cc_utxos", cryptoConditionsUTXOs));
+            result.push_back(make_pair("cc_utxo_value", (double) cryptoConditionsTotals / COIN));
+            result.push_back(make_pair("total_includeCCvouts", (double) (total+cryptoConditionsTotals)/ COIN ));
+            result.push_back(make_pair("ending_height", chainActive.Height()));
         }
+    }
+    else if ( vAddressSnapshot.size() > 0 )
+    {
+        for ( auto address : vAddressSnapshot )
+            vaddr.push_back(make_pair(address.first, CBitcoinAddress(address.second).ToString()));
+        top = vAddressSnapshot.size();
+        from = 0;
+    }
+    else fOk = false;
+
+    if ( fOk )
+    {
+        if ( from < 0 )
+            from = 0;
         int topN = 0;
-        for (std::vector<std::pair<CAmount, std::string>>::iterator it = vaddr.begin(); it!=vaddr.end(); ++it)
+        for (std::vector<std::pair<CAmount, std::string>>::iterator it = vaddr.begin() + std::min((size_t)from, vaddr.size()); it!=vaddr.end(); ++it)
         {
           	UniValue obj(UniValue::VOBJ);
           	obj.push_back( make_pair("addr", it->second.c_str() ) );
@@ -621,6 +1207,10 @@ UniValue CBlockTreeDB::Snapshot(int top)
         }
     	// Array of all addreses with balances
         result.push_back(make_pair("addresses", addressesSorted));
+        // cursor for streaming the remainder of the sorted list in pages
+        result.push_back(make_pair("from", from));
+        result.push_back(make_pair("next", (int64_t)(from + topN)));
+        result.push_back(make_pair("done", (size_t)(from + topN) >= vaddr.size()));
     } else result.push_back(make_pair("error", "problem doing snapshot"));
     return(result);
 }
@@ -694,6 +1284,22 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) const {
     return true;
 }
 
+bool CBlockTreeDB::WriteBlockIndexSizeHint(uint64_t nSize) {
+    return Write(DB_BLOCK_INDEX_SIZE, nSize);
+}
+
+bool CBlockTreeDB::ReadBlockIndexSizeHint(uint64_t &nSize) const {
+    return Read(DB_BLOCK_INDEX_SIZE, nSize);
+}
+
+bool CBlockTreeDB::WriteSyncTxRate(uint64_t nMilliTxPerSec) {
+    return Write(DB_SYNC_TXRATE, nMilliTxPerSec);
+}
+
+bool CBlockTreeDB::ReadSyncTxRate(uint64_t &nMilliTxPerSec) const {
+    return Read(DB_SYNC_TXRATE, nMilliTxPerSec);
+}
+
 void komodo_index2pubkey33(uint8_t *pubkey33,CBlockIndex *pindex,int32_t height);
 
 bool CBlockTreeDB::blockOnchainActive(const uint256 &hash) {
@@ -707,76 +1313,324 @@ bool CBlockTreeDB::blockOnchainActive(const uint256 &hash) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts()
+namespace {
+
+/** One block index record staged by a LoadBlockIndexGuts worker: the object
+ * itself lives in the worker's arena, the hashes are kept so linkage into
+ * mapBlockIndex can happen afterwards on one thread. */
+struct CStagedBlockIndex
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    uint256 hash;
+    uint256 hashPrev;
+    CBlockIndex* pindex;
+};
 
-    pcursor->Seek(make_pair(DB_BLOCK_INDEX, uint256()));
+} // namespace
 
-    // Load mapBlockIndex
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
+bool CBlockTreeDB::LoadBlockIndexGuts()
+{
+    // Presize mapBlockIndex from the entry count recorded by the previous
+    // run, so loading (and the header sync that follows) does not stall on
+    // rehashes every time the map crosses a growth threshold.
+    uint64_t nSizeHint = 0;
+    if (ReadBlockIndexSizeHint(nSizeHint) && nSizeHint > mapBlockIndex.size())
+        mapBlockIndex.rehash((size_t)(nSizeHint / mapBlockIndex.max_load_factor()) + 1);
+
+    // Phase 1: block hashes are uniformly distributed, so shard the keyspace
+    // by leading byte and deserialize each range on its own thread. Workers
+    // only touch their own arena and staging vector; mapBlockIndex and chain
+    // linkage are built afterwards on this thread.
+    int nShards = std::max(1, std::min(GetNumCores(), 8));
+    std::vector<std::deque<CBlockIndex> > vArenas(nShards);
+    std::vector<std::vector<CStagedBlockIndex> > vStaged(nShards);
+    std::vector<std::string> vErrors(nShards);
+
+    auto LoadShard = [&](int nShard) {
+        unsigned char chFirst = (unsigned char)((nShard * 256) / nShards);
+        unsigned int nLimit = ((nShard + 1) * 256) / nShards; // 256 for the last shard
+        boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+        uint256 hashStart;
+        *hashStart.begin() = chFirst;
+        pcursor->Seek(make_pair(DB_BLOCK_INDEX, hashStart));
+        while (pcursor->Valid()) {
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX)
+                break;
+            if ((unsigned int)*key.second.begin() >= nLimit)
+                break;
             CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = InsertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = InsertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->hashSproutAnchor     = diskindex.hashSproutAnchor;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->hashFinalSaplingRoot   = diskindex.hashFinalSaplingRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                // the Equihash solution will be loaded lazily from the dbindex entry
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nCachedBranchId = diskindex.nCachedBranchId;
-                pindexNew->nTx            = diskindex.nTx;
-                pindexNew->nChainSupplyDelta  = diskindex.nChainSupplyDelta;
-                pindexNew->nTransparentValue = diskindex.nTransparentValue;
-                pindexNew->nBurnedAmountDelta = diskindex.nBurnedAmountDelta;
-                pindexNew->nSproutValue   = diskindex.nSproutValue;
-                pindexNew->nSaplingValue  = diskindex.nSaplingValue;
-                pindexNew->segid          = diskindex.segid;
-                pindexNew->nNotaryPay     = diskindex.nNotaryPay;
-
-                if ( 0 ) // POW will be checked before any block is connected
-                {
-                    // Consistency checks
-                    CBlockHeader header;
-                    {
-                        LOCK(cs_main);
-                        try {
-                            header = pindexNew->GetBlockHeader();
-                        } catch (const runtime_error&) {
-                            return error("LoadBlockIndex(): failed to read index entry: diskindex hash = %s",
-                                diskindex.GetBlockHash().ToString());
-                        }
+            if (!pcursor->GetValue(diskindex)) {
+                vErrors[nShard] = "failed to read value";
+                return;
+            }
+            // Construct block index object
+            vArenas[nShard].emplace_back();
+            CBlockIndex* pindexNew = &vArenas[nShard].back();
+            pindexNew->nHeight = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->hashSproutAnchor     = diskindex.hashSproutAnchor;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->hashFinalSaplingRoot   = diskindex.hashFinalSaplingRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            // the Equihash solution will be loaded lazily from the dbindex entry
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nCachedBranchId = diskindex.nCachedBranchId;
+            pindexNew->nTx            = diskindex.nTx;
+            pindexNew->nChainSupplyDelta  = diskindex.nChainSupplyDelta;
+            pindexNew->nTransparentValue = diskindex.nTransparentValue;
+            pindexNew->nBurnedAmountDelta = diskindex.nBurnedAmountDelta;
+            pindexNew->nSproutValue   = diskindex.nSproutValue;
+            pindexNew->nSaplingValue  = diskindex.nSaplingValue;
+            pindexNew->segid          = diskindex.segid;
+            pindexNew->nNotaryPay     = diskindex.nNotaryPay;
+            CStagedBlockIndex staged;
+            staged.hash = diskindex.GetBlockHash();
+            staged.hashPrev = diskindex.hashPrev;
+            staged.pindex = pindexNew;
+            vStaged[nShard].push_back(staged);
+            pcursor->Next();
+        }
+    };
+
+    if (nShards == 1) {
+        LoadShard(0);
+    } else {
+        boost::thread_group threads;
+        for (int i = 0; i < nShards; i++)
+            threads.create_thread([&LoadShard, i] { LoadShard(i); });
+        threads.join_all();
+    }
+    boost::this_thread::interruption_point();
+    for (int i = 0; i < nShards; i++) {
+        if (!vErrors[i].empty())
+            return error("LoadBlockIndex() : %s", vErrors[i].c_str());
+    }
+
+    // Phase 2: bulk-insert every loaded entry, then resolve pprev links;
+    // InsertBlockIndex only creates placeholders for hashes with no record
+    // of their own, exactly as the incremental path did.
+    for (int i = 0; i < nShards; i++) {
+        for (const CStagedBlockIndex& staged : vStaged[i]) {
+            BlockMap::iterator mi = mapBlockIndex.insert(make_pair(staged.hash, staged.pindex)).first;
+            staged.pindex->phashBlock = &(mi->first);
+        }
+        AdoptBlockIndexArena(vArenas[i]);
+    }
+    for (int i = 0; i < nShards; i++) {
+        for (const CStagedBlockIndex& staged : vStaged[i])
+            staged.pindex->pprev = InsertBlockIndex(staged.hashPrev);
+    }
+
+    return true;
+}
+
+//! Identifies chainstate snapshot files; bump the trailing digit together
+//! with SNAPSHOT_VERSION on incompatible format changes
+static const char SNAPSHOT_MAGIC[8] = { 'K', 'M', 'D', 'S', 'N', 'A', 'P', '1' };
+//! Records applied per write batch during snapshot import
+static const size_t SNAPSHOT_IMPORT_BATCH = 10000;
+
+bool WriteChainstateSnapshot(const boost::filesystem::path &path, CCoinsView *coinsview, CBlockTreeDB *blocktree,
+                             uint256 &hashContent, uint64_t &nRecords, std::string &strError)
+{
+    FILE* file = fopen(path.string().c_str(), "wb");
+    if (!file) {
+        strError = strprintf("unable to open %s for writing", path.string());
+        return false;
+    }
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+
+    uint256 hashBestBlock = coinsview->GetBestBlock();
+    int32_t nHeight = 0;
+    {
+        LOCK(cs_main);
+        BlockMap::iterator mi = mapBlockIndex.find(hashBestBlock);
+        if (mi != mapBlockIndex.end() && mi->second)
+            nHeight = mi->second->nHeight;
+    }
+
+    try {
+        CDataStream ssHeader(SER_DISK, CLIENT_VERSION);
+        ssHeader.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        ssHeader << SNAPSHOT_VERSION;
+        ssHeader.write((const char*)&Params().MessageStart()[0], MESSAGE_START_SIZE);
+        ssHeader << hashBestBlock;
+        ssHeader << nHeight;
+        fileout.write(&ssHeader[0], ssHeader.size());
+        hasher.write(&ssHeader[0], ssHeader.size());
+
+        nRecords = 0;
+        if (!coinsview->WriteSnapshot(fileout, hasher, nRecords)) {
+            strError = "failed to dump chainstate records";
+            return false;
+        }
+        if (!blocktree->WriteBlockIndexSnapshot(fileout, hasher, nRecords)) {
+            strError = "failed to dump block index records";
+            return false;
+        }
+
+        fileout << SNAPSHOT_REC_END;
+        hasher << SNAPSHOT_REC_END;
+        hashContent = hasher.GetHash();
+        fileout << hashContent;
+    } catch (const std::exception& e) {
+        strError = strprintf("error writing %s: %s", path.string(), e.what());
+        return false;
+    }
+    FileCommit(fileout.Get());
+    LogPrintf("Wrote chainstate snapshot %s: %u records, best block %s (height %d), content hash %s\n",
+              path.string(), nRecords, hashBestBlock.ToString(), nHeight, hashContent.ToString());
+    return true;
+}
+
+bool LoadChainstateSnapshot(const boost::filesystem::path &path, CCoinsViewDB *coinsview, CBlockTreeDB *blocktree,
+                            const uint256 &hashExpected, std::string &strError)
+{
+    FILE* file = fopen(path.string().c_str(), "rb");
+    if (!file) {
+        strError = strprintf("unable to open %s for reading", path.string());
+        return false;
+    }
+
+    // Pass 1: hash everything up to the trailing content hash and verify it,
+    // both against the hash stored in the file and against the trusted hash,
+    // before a single record is written.
+    {
+        if (fseek(file, 0, SEEK_END) != 0) {
+            strError = "seek failed";
+            fclose(file);
+            return false;
+        }
+        long nFileSize = ftell(file);
+        rewind(file);
+        if (nFileSize < (long)(sizeof(SNAPSHOT_MAGIC) + 4 + MESSAGE_START_SIZE + 32 + 4 + 1 + 32)) {
+            strError = strprintf("%s is too short to be a snapshot file", path.string());
+            fclose(file);
+            return false;
+        }
+        CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+        std::vector<char> buf(65536);
+        long nRemaining = nFileSize - 32;
+        while (nRemaining > 0) {
+            size_t nRead = fread(buf.data(), 1, std::min((long)buf.size(), nRemaining), file);
+            if (nRead == 0) {
+                strError = strprintf("error reading %s", path.string());
+                fclose(file);
+                return false;
+            }
+            hasher.write(buf.data(), nRead);
+            nRemaining -= nRead;
+        }
+        uint256 hashFile;
+        if (fread(hashFile.begin(), 1, 32, file) != 32) {
+            strError = strprintf("error reading %s", path.string());
+            fclose(file);
+            return false;
+        }
+        uint256 hashContent = hasher.GetHash();
+        if (hashContent != hashFile) {
+            strError = strprintf("%s is corrupt: content hash %s does not match stored hash %s",
+                                 path.string(), hashContent.ToString(), hashFile.ToString());
+            fclose(file);
+            return false;
+        }
+        if (!hashExpected.IsNull() && hashContent != hashExpected) {
+            strError = strprintf("snapshot content hash %s does not match the expected hash %s",
+                                 hashContent.ToString(), hashExpected.ToString());
+            fclose(file);
+            return false;
+        }
+        rewind(file);
+    }
+
+    // Pass 2: parse the verified records and apply them in batches.
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    try {
+        char pchMagic[sizeof(SNAPSHOT_MAGIC)];
+        filein.read(pchMagic, sizeof(pchMagic));
+        if (memcmp(pchMagic, SNAPSHOT_MAGIC, sizeof(pchMagic)) != 0) {
+            strError = strprintf("%s is not a snapshot file", path.string());
+            return false;
+        }
+        uint32_t nVersion;
+        filein >> nVersion;
+        if (nVersion != SNAPSHOT_VERSION) {
+            strError = strprintf("unsupported snapshot version %u", nVersion);
+            return false;
+        }
+        unsigned char pchMessageStart[MESSAGE_START_SIZE];
+        filein.read((char*)pchMessageStart, MESSAGE_START_SIZE);
+        if (memcmp(pchMessageStart, &Params().MessageStart()[0], MESSAGE_START_SIZE) != 0) {
+            strError = "snapshot was taken on a different network";
+            return false;
+        }
+        uint256 hashBestBlock;
+        int32_t nHeight;
+        filein >> hashBestBlock;
+        filein >> nHeight;
+        LogPrintf("Importing chainstate snapshot %s: best block %s (height %d)\n",
+                  path.string(), hashBestBlock.ToString(), nHeight);
+
+        uint64_t nRecords = 0;
+        std::vector<CSnapshotRecord> vCoinsRecords, vIndexRecords;
+        while (true) {
+            boost::this_thread::interruption_point();
+            unsigned char chTag;
+            filein >> chTag;
+            if (chTag == SNAPSHOT_REC_END)
+                break;
+            CSnapshotRecord record;
+            filein >> record.first;
+            filein >> record.second;
+            if (chTag == SNAPSHOT_REC_CHAINSTATE) {
+                vCoinsRecords.push_back(record);
+                if (vCoinsRecords.size() >= SNAPSHOT_IMPORT_BATCH) {
+                    if (!coinsview->ImportSnapshotRecords(vCoinsRecords)) {
+                        strError = "failed to write chainstate records";
+                        return false;
                     }
-                    if (header.GetHash() != pindexNew->GetBlockHash())
-                        return error("LoadBlockIndex(): block header inconsistency detected: on-disk = %s, in-memory = %s",
-                                    diskindex.ToString(),  pindexNew->ToString());
-
-                    uint8_t pubkey33[33];
-                    komodo_index2pubkey33(pubkey33,pindexNew,pindexNew->nHeight);
-                    if (!CheckProofOfWork(header,pubkey33,pindexNew->nHeight,Params().GetConsensus()))
-                        return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
+                    vCoinsRecords.clear();
+                }
+            } else if (chTag == SNAPSHOT_REC_BLOCKINDEX) {
+                vIndexRecords.push_back(record);
+                if (vIndexRecords.size() >= SNAPSHOT_IMPORT_BATCH) {
+                    if (!blocktree->ImportSnapshotBlockIndex(vIndexRecords)) {
+                        strError = "failed to write block index records";
+                        return false;
+                    }
+                    vIndexRecords.clear();
                 }
-                pcursor->Next();
             } else {
-                return error("LoadBlockIndex() : failed to read value");
+                strError = strprintf("unknown snapshot record tag %u", chTag);
+                return false;
             }
-        } else {
-            break;
+            nRecords++;
         }
+        if (!vCoinsRecords.empty() && !coinsview->ImportSnapshotRecords(vCoinsRecords)) {
+            strError = "failed to write chainstate records";
+            return false;
+        }
+        if (!vIndexRecords.empty() && !blocktree->ImportSnapshotBlockIndex(vIndexRecords)) {
+            strError = "failed to write block index records";
+            return false;
+        }
+        // The snapshot carries index entries but no block or undo files, so
+        // the node must behave exactly like one whose files were pruned.
+        if (!blocktree->WriteFlag("prunedblockfiles", true)) {
+            strError = "failed to set the pruned flag";
+            return false;
+        }
+        LogPrintf("Imported %u chainstate snapshot records\n", nRecords);
+    } catch (const std::exception& e) {
+        strError = strprintf("error reading %s: %s", path.string(), e.what());
+        return false;
     }
-
     return true;
 }
 
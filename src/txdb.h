@@ -25,12 +25,16 @@
 #include "coins.h"
 #include "dbwrapper.h"
 
+#include <deque>
 #include <map>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 #include <univalue.h>
 
+#include <boost/filesystem/path.hpp>
+
 class CBlockFileInfo;
 class CBlockIndex;
 struct CDiskTxPos;
@@ -48,6 +52,46 @@ struct CSpentIndexValue;
 class uint256;
 class CDiskBlockIndex;
 
+//! Version number written into chainstate snapshot files
+static const uint32_t SNAPSHOT_VERSION = 1;
+//! Snapshot record tags: end-of-records marker, raw chainstate record,
+//! raw block index record
+static const unsigned char SNAPSHOT_REC_END = 0x00;
+static const unsigned char SNAPSHOT_REC_CHAINSTATE = 0x01;
+static const unsigned char SNAPSHOT_REC_BLOCKINDEX = 0x02;
+//! A raw (key, value) database record as framed in a snapshot file
+typedef std::pair<std::vector<unsigned char>, std::vector<unsigned char> > CSnapshotRecord;
+
+/**
+ * UTXO set statistics maintained incrementally as flushes are written, so
+ * gettxoutsetinfo does not have to scan and hash the whole chainstate. The
+ * record is persisted in the same batch as the coin changes it accounts for,
+ * keeping it crash-consistent with the database.
+ */
+struct CCoinsSetStats
+{
+    uint64_t nTransactions;
+    uint64_t nTransactionOutputs;
+    uint64_t nSerializedSize;
+    CAmount nTotalAmount;
+    //! XOR of per-record hashes; order independent, so records can be added
+    //! and removed in any order as the set evolves
+    uint256 hashRolling;
+
+    CCoinsSetStats() : nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nTransactions);
+        READWRITE(nTransactionOutputs);
+        READWRITE(nSerializedSize);
+        READWRITE(nTotalAmount);
+        READWRITE(hashRolling);
+    }
+};
+
 //! -dbcache default (MiB)
 static const int64_t nDefaultDbCache = 450;
 //! max. -dbcache (MiB)
@@ -68,6 +112,7 @@ public:
 
     bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
+    bool HaveSaplingAnchorAt(const uint256 &rt) const;
     bool GetNullifier(const uint256 &nf, ShieldedType type) const;
     /***
      * @param txid the transaction id
@@ -92,6 +137,45 @@ public:
                     CNullifiersMap &mapSproutNullifiers,
                     CNullifiersMap &mapSaplingNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+    /****
+     * Copy out the incrementally maintained set statistics
+     * @param stats filled in on success
+     * @returns false until a full GetStats scan (or reindex from genesis) has
+     *          seeded them
+     */
+    bool GetSetStats(CCoinsSetStats &stats) const;
+    /****
+     * Stream every raw chainstate record (coins, anchors, nullifiers, best
+     * block/anchor) into a snapshot file, feeding the same bytes to the hasher
+     * @param fileout the open snapshot file
+     * @param hasher running hash over the snapshot contents
+     * @param nRecords incremented once per record written
+     * @returns true on success
+     */
+    bool WriteSnapshot(CAutoFile &fileout, CHashWriter &hasher, uint64_t &nRecords) const;
+    /****
+     * Apply a chunk of raw records taken from a verified snapshot file
+     * @param vRecords the records
+     * @returns true on success
+     */
+    bool ImportSnapshotRecords(const std::vector<CSnapshotRecord> &vRecords);
+
+    //! Point lookups served by the underlying database, for the dbcache governor
+    uint64_t GetDbReadCount() const { return db.GetReadCount(); }
+
+private:
+    //! Bounded positive membership cache for HaveSaplingAnchorAt; spend
+    //! validation checks anchors far more often than new tree states appear.
+    //! Anchors erased by a reorg are purged in BatchWrite.
+    mutable CCriticalSection cs_saplingAnchorCache;
+    mutable std::set<uint256> setSaplingAnchorCache;
+    mutable std::deque<uint256> saplingAnchorCacheOrder; // FIFO eviction
+
+    //! Incrementally maintained set statistics; invalid until seeded by a
+    //! full GetStats scan (mutable so the scan can seed them)
+    mutable CCriticalSection cs_setStats;
+    mutable CCoinsSetStats setStats;
+    mutable bool fSetStatsValid;
 };
 
 
@@ -226,11 +310,137 @@ public:
      * @param addressIndex the address index / amount records found
      * @param start the starting index
      * @param end the end
+     * @param nMaxEntries stop after this many records (0 = no limit); the
+     *        scan runs through the end of the height it stopped on, so a
+     *        block's entries never straddle two pages
      * @returns true on success
      */
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
+                          int start = 0, int end = 0, size_t nMaxEntries = 0);
+    /****
+     * Read address index records for several addresses with one shared
+     * iterator (one seek per address instead of one iterator per address)
+     * @param addresses (hash, type) pairs to look for, scanned in order
+     * @param addressIndex the address index / amount records found
+     * @param start the starting index
+     * @param end the end
+     * @param nMaxEntries stop after this many records (0 = no limit)
+     * @returns true on success
+     */
+    bool ReadAddressIndex(const std::vector<std::pair<uint160, int> > &addresses,
+                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                          int start = 0, int end = 0, size_t nMaxEntries = 0);
+    /****
+     * Register an address with the watch index (independent of the wallet
+     * and of -addressindex; matches are recorded from registration onward)
+     * @param addressHash the address to watch
+     * @param type the address type
+     * @param nRegistered registration time, reported by listwatchedaddresses
+     * @returns true on success
+     */
+    bool WriteWatchAddress(const uint160 &addressHash, int type, int64_t nRegistered);
+    /****
+     * Remove an address from the watch index registry; already recorded
+     * history entries are kept
+     * @param addressHash the address
+     * @param type the address type
+     * @returns true on success
+     */
+    bool EraseWatchAddress(const uint160 &addressHash, int type);
+    /****
+     * Read the registered watch addresses; called once at startup to seed
+     * the in-memory set consulted during block connection
+     * @param addresses (hash, type) -> registration time
+     * @returns true on success
+     */
+    bool LoadWatchAddresses(std::map<std::pair<uint160, int>, int64_t> &addresses);
+    /****
+     * Write a batch of watch index records (same record shape as the
+     * address index, under the watch index prefix)
+     * @param vect the records to write
+     * @returns true on success
+     */
+    bool WriteWatchIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    /****
+     * Remove a batch of watch index records (block disconnect)
+     * @param vect the records to erase
+     * @returns true on success
+     */
+    bool EraseWatchIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    /****
+     * Read watch index records for several addresses with one shared
+     * iterator; same pagination rules as ReadAddressIndex
+     * @param addresses (hash, type) pairs to look for, scanned in order
+     * @param watchIndex the watch index / amount records found
+     * @param start the starting height
+     * @param end the ending height
+     * @param nMaxEntries stop after this many records (0 = no limit)
+     * @returns true on success
+     */
+    bool ReadWatchIndex(const std::vector<std::pair<uint160, int> > &addresses,
+                        std::vector<std::pair<CAddressIndexKey, CAmount> > &watchIndex,
+                        int start = 0, int end = 0, size_t nMaxEntries = 0);
+    /****
+     * Read every address index record between two heights from the
+     * height-partitioned mirror (requires -addressheightindex); one
+     * sequential scan regardless of how many addresses are involved
+     * @param start the starting height
+     * @param end the ending height (0 = no upper bound)
+     * @param addressIndex the address index / amount records found
+     * @returns true on success
+     */
+    bool ReadAddressHeightIndex(int start, int end,
+                                std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex);
+    /****
+     * Turn maintenance of the height-partitioned address index mirror on or
+     * off; set from the stored "addressheightindex" flag at startup
+     * @param fEnabled whether address index writes are mirrored
+     */
+    void SetAddressHeightIndexing(bool fEnabled) { fAddressHeightIndexing = fEnabled; }
+    /****
+     * Store a block's compact filter (requires -blockfilterindex)
+     * @param blockhash the block the filter covers
+     * @param vchFilter the encoded filter
+     * @returns true on success
+     */
+    bool WriteBlockFilter(const uint256 &blockhash, const std::vector<unsigned char> &vchFilter);
+    /****
+     * Fetch a block's compact filter
+     * @param blockhash the block
+     * @param vchFilter the encoded filter found
+     * @returns true on success
+     */
+    bool ReadBlockFilter(const uint256 &blockhash, std::vector<unsigned char> &vchFilter) const;
+    /****
+     * Write every index update a connected block produced (tx, address,
+     * address unspent, spent and timestamp indexes) in one batch commit,
+     * instead of one LevelDB batch per index
+     * @param txIndex txid / position records (empty when -txindex is off)
+     * @param addressIndex address index / amount records
+     * @param addressUnspentIndex address unspent records (null value = erase)
+     * @param spentIndex spent index records (null value = erase)
+     * @param ptimestampIndex timestamp record, or nullptr
+     * @param pblockhashIndex block hash / logical timestamp key, or nullptr
+     * @param plogicalts logical timestamp for pblockhashIndex
+     * @returns true on success
+     */
+    bool WriteIndexUpdates(const std::vector<std::pair<uint256, CDiskTxPos> > &txIndex,
+                           const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                           const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &addressUnspentIndex,
+                           const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &spentIndex,
+                           const CTimestampIndexKey *ptimestampIndex,
+                           const CTimestampBlockIndexKey *pblockhashIndex,
+                           const CTimestampBlockIndexValue *plogicalts);
+    /****
+     * Revert the address index updates of a disconnected block in one batch
+     * commit (erases the address index records, rewrites the unspent records)
+     * @param addressIndex the address index / amount records to erase
+     * @param addressUnspentIndex address unspent records (null value = erase)
+     * @returns true on success
+     */
+    bool EraseIndexUpdates(const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                           const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &addressUnspentIndex);
     /****
      * Write a timestamp entry to the db
      * @param timestampIndex the record to write
@@ -275,6 +485,50 @@ public:
      * @returns true on success
      */
     bool ReadFlag(const std::string &name, bool &fValue) const;
+    /***
+     * Record how many block index entries exist, used to presize
+     * mapBlockIndex on the next load
+     * @param nSize the entry count
+     * @returns true on success
+     */
+    bool WriteBlockIndexSizeHint(uint64_t nSize);
+    /***
+     * Read the block index entry count recorded by a previous run
+     * @param nSize the entry count
+     * @returns true on success
+     */
+    bool ReadBlockIndexSizeHint(uint64_t &nSize) const;
+    /***
+     * Record the measured sync verification throughput so restarts start
+     * with a seeded estimate instead of guessing from constants
+     * @param nMilliTxPerSec throughput in thousandths of a tx per second
+     * @returns true on success
+     */
+    bool WriteSyncTxRate(uint64_t nMilliTxPerSec);
+    /***
+     * Read the verification throughput recorded by a previous run
+     * @param nMilliTxPerSec throughput in thousandths of a tx per second
+     * @returns true on success
+     */
+    bool ReadSyncTxRate(uint64_t &nMilliTxPerSec) const;
+    /****
+     * Stream every raw block index record into a snapshot file, feeding the
+     * same bytes to the hasher
+     * @param fileout the open snapshot file
+     * @param hasher running hash over the snapshot contents
+     * @param nRecords incremented once per record written
+     * @returns true on success
+     */
+    bool WriteBlockIndexSnapshot(CAutoFile &fileout, CHashWriter &hasher, uint64_t &nRecords);
+    /****
+     * Apply a chunk of raw block index records from a verified snapshot file.
+     * A snapshot carries no block or undo files, so every entry is rewritten
+     * with BLOCK_HAVE_DATA/BLOCK_HAVE_UNDO cleared, as if its files had been
+     * pruned
+     * @param vRecords the records
+     * @returns true on success
+     */
+    bool ImportSnapshotBlockIndex(const std::vector<CSnapshotRecord> &vRecords);
     /****
      * Load the block headers from disk
      * NOTE: this does no consistency check beyond verifying records exist
@@ -290,9 +544,11 @@ public:
     /****
      * Get a snapshot
      * @param top max number of results, sorted by amount descending (aka richlist)
+     * @param from skip this many addresses of the sorted list before emitting
+     *        results, so large snapshots can be streamed in pages
      * @returns the data ( a collection of (addr, amount, segid) )
      */
-    UniValue Snapshot(int top);
+    UniValue Snapshot(int top, int from = 0);
     /****
      * Get a snapshot
      * @param addressAmounts the results
@@ -300,6 +556,63 @@ public:
      * @returns true on success
      */
     bool Snapshot2(std::map <std::string, CAmount> &addressAmounts, UniValue *ret);
+
+private:
+    //! Guards the transaction position cache below
+    mutable CCriticalSection cs_txIndexCache;
+    //! txid -> location for recently looked-up transactions. A confirmed
+    //! transaction's location in the block files never changes, so entries
+    //! never need invalidation; the cache is bounded by evicting the map
+    //! neighbour of each new key (txids are uniform, so that is as good as
+    //! random eviction)
+    mutable std::map<uint256, CDiskTxPos> mapTxIndexCache;
+
+    //! Guards the lazily built unspent-balance aggregate below
+    CCriticalSection cs_snapshotAggregate;
+    //! (address hash, type) -> (unspent balance, utxo count). Built by the
+    //! first Snapshot call with a full unspent index scan, then kept current
+    //! by the WriteAddressIndex/EraseAddressIndex delta vectors, so rich-list
+    //! generation stops re-walking the whole index
+    std::map<std::pair<uint160, int>, std::pair<CAmount, int64_t> > mapSnapshotAggregate;
+    bool fSnapshotAggregateValid = false;
+
+    //! Apply (or with fUndo, revert) a block's address index deltas to the aggregate
+    void ApplySnapshotDeltas(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, bool fUndo);
+    //! Rebuild the aggregate from the unspent index; caller holds cs_snapshotAggregate
+    bool BuildSnapshotAggregate();
+
+    //! Whether address index writes are mirrored under the height-first layout
+    bool fAddressHeightIndexing = false;
 };
 
+/****
+ * Write the whole chainstate and block index to a snapshot file committed to
+ * by a single content hash, for bootstrapping new nodes (see -loadsnapshot)
+ * @param path where to write the file
+ * @param coinsview the chainstate to dump (must be flushed to disk first)
+ * @param blocktree the block index database
+ * @param hashContent the resulting content hash
+ * @param nRecords the number of records written
+ * @param strError set on failure
+ * @returns true on success
+ */
+bool WriteChainstateSnapshot(const boost::filesystem::path &path, CCoinsView *coinsview, CBlockTreeDB *blocktree,
+                             uint256 &hashContent, uint64_t &nRecords, std::string &strError);
+
+/****
+ * Populate empty chainstate and block index databases from a snapshot file.
+ * The whole file is hashed and checked against hashExpected before anything
+ * is written; afterwards the node is flagged as pruned, since the snapshot
+ * carries no block or undo files
+ * @param path the snapshot file
+ * @param coinsview the (empty) chainstate database
+ * @param blocktree the (empty) block index database
+ * @param hashExpected required content hash (null skips the trust check,
+ *        the internal consistency hash is still enforced)
+ * @param strError set on failure
+ * @returns true on success
+ */
+bool LoadChainstateSnapshot(const boost::filesystem::path &path, CCoinsViewDB *coinsview, CBlockTreeDB *blocktree,
+                            const uint256 &hashExpected, std::string &strError);
+
 #endif // BITCOIN_TXDB_H
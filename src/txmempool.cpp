@@ -42,6 +42,12 @@ CTxMemPoolEntry::CTxMemPoolEntry():
     hadNoDependencies(false), spendsCoinbase(false)
 {
     nHeight = MEMPOOL_HEIGHT;
+    nCountWithDescendants = 1;
+    nSizeWithDescendants = 0;
+    nFeesWithDescendants = 0;
+    nCountWithAncestors = 1;
+    nSizeWithAncestors = 0;
+    nFeesWithAncestors = 0;
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
@@ -56,6 +62,29 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
     nModSize = tx.CalculateModifiedSize(nTxSize);
     nUsageSize = RecursiveDynamicUsage(tx);
     feeRate = CFeeRate(nFee, nTxSize);
+
+    // package state starts as the entry alone; CTxMemPool folds in the
+    // in-mempool relatives when the entry is added
+    nCountWithDescendants = 1;
+    nSizeWithDescendants = nTxSize;
+    nFeesWithDescendants = nFee;
+    nCountWithAncestors = 1;
+    nSizeWithAncestors = nTxSize;
+    nFeesWithAncestors = nFee;
+}
+
+void CTxMemPoolEntry::UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
+{
+    nSizeWithDescendants += modifySize;
+    nFeesWithDescendants += modifyFee;
+    nCountWithDescendants += modifyCount;
+}
+
+void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
+{
+    nSizeWithAncestors += modifySize;
+    nFeesWithAncestors += modifyFee;
+    nCountWithAncestors += modifyCount;
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry& other)
@@ -72,6 +101,31 @@ CTxMemPoolEntry::GetPriority(unsigned int currentHeight) const
     return dResult;
 }
 
+CColdTxEntry::CColdTxEntry(const CTxMemPoolEntry& entry) :
+    nFee(entry.GetFee()), nTxSize(entry.GetTxSize()), nTime(entry.GetTime()),
+    dPriority(entry.GetPriority(entry.GetHeight())), nHeight(entry.GetHeight()),
+    hadNoDependencies(entry.WasClearAtEntry()), spendsCoinbase(entry.GetSpendsCoinbase()),
+    nBranchId(entry.GetValidatedBranchId()), nExpiryHeight(entry.GetTx().nExpiryHeight),
+    feeRate(entry.GetFeeRate())
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << entry.GetTx();
+    vchTx.assign(ss.begin(), ss.end());
+}
+
+CTransaction CColdTxEntry::GetTx() const
+{
+    CTransaction tx;
+    CDataStream ss(vchTx, SER_NETWORK, PROTOCOL_VERSION);
+    ss >> tx;
+    return tx;
+}
+
+size_t CColdTxEntry::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(vchTx);
+}
+
 CTxMemPool::CTxMemPool(const CFeeRate& _minRelayFee) :
     nTransactionsUpdated(0)
 {
@@ -139,13 +193,121 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
         mapSaplingNullifiers[spendDescription.nullifier] = &tx;
     }
     nTransactionsUpdated++;
+    nSnapshotSequence++;
     totalTxSize += entry.GetTxSize();
     cachedInnerUsage += entry.DynamicMemoryUsage();
     minerPolicyEstimator->processTransaction(entry, fCurrentEstimate);
+    UpdatePackagesForAdded(hash, entry);
 
     return true;
 }
 
+void CTxMemPool::CalculateAncestors(const uint256& hash, std::set<uint256>& setAncestors) const
+{
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        txlinksMap::const_iterator it = mapLinks.find(queue.front());
+        queue.pop_front();
+        if (it == mapLinks.end())
+            continue;
+        BOOST_FOREACH(const uint256& parent, it->second.parents) {
+            if (setAncestors.insert(parent).second)
+                queue.push_back(parent);
+        }
+    }
+}
+
+void CTxMemPool::CalculateDescendants(const uint256& hash, std::set<uint256>& setDescendants) const
+{
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        txlinksMap::const_iterator it = mapLinks.find(queue.front());
+        queue.pop_front();
+        if (it == mapLinks.end())
+            continue;
+        BOOST_FOREACH(const uint256& child, it->second.children) {
+            if (setDescendants.insert(child).second)
+                queue.push_back(child);
+        }
+    }
+}
+
+void CTxMemPool::UpdatePackagesForAdded(const uint256& hash, const CTxMemPoolEntry& entry)
+{
+    AssertLockHeld(cs);
+    // a new entry can have in-mempool parents but never in-mempool children,
+    // since children are only accepted once their parents are in the pool
+    TxLinks& links = mapLinks[hash];
+    BOOST_FOREACH(const CTxIn& txin, entry.GetTx().vin) {
+        if (mapTx.count(txin.prevout.hash)) {
+            links.parents.insert(txin.prevout.hash);
+            mapLinks[txin.prevout.hash].children.insert(hash);
+        }
+    }
+
+    std::set<uint256> setAncestors;
+    CalculateAncestors(hash, setAncestors);
+    int64_t nSizeAncestors = 0;
+    int64_t nCountAncestors = 0;
+    CAmount nFeesAncestors = 0;
+    int64_t nSize = entry.GetTxSize();
+    CAmount nFee = entry.GetFee();
+    BOOST_FOREACH(const uint256& ancestor, setAncestors) {
+        indexed_transaction_set::iterator it = mapTx.find(ancestor);
+        assert(it != mapTx.end());
+        nSizeAncestors += it->GetTxSize();
+        nFeesAncestors += it->GetFee();
+        nCountAncestors++;
+        mapTx.modify(it, [nSize, nFee](CTxMemPoolEntry& e) { e.UpdateDescendantState(nSize, nFee, 1); });
+    }
+    indexed_transaction_set::iterator it = mapTx.find(hash);
+    mapTx.modify(it, [nSizeAncestors, nFeesAncestors, nCountAncestors](CTxMemPoolEntry& e) {
+        e.UpdateAncestorState(nSizeAncestors, nFeesAncestors, nCountAncestors);
+    });
+}
+
+void CTxMemPool::UpdatePackagesForRemoved(const uint256& hash)
+{
+    AssertLockHeld(cs);
+    indexed_transaction_set::iterator entryit = mapTx.find(hash);
+    if (entryit == mapTx.end())
+        return;
+    int64_t nSize = entryit->GetTxSize();
+    CAmount nFee = entryit->GetFee();
+
+    std::set<uint256> setAncestors;
+    std::set<uint256> setDescendants;
+    CalculateAncestors(hash, setAncestors);
+    CalculateDescendants(hash, setDescendants);
+    BOOST_FOREACH(const uint256& ancestor, setAncestors) {
+        indexed_transaction_set::iterator it = mapTx.find(ancestor);
+        if (it != mapTx.end())
+            mapTx.modify(it, [nSize, nFee](CTxMemPoolEntry& e) { e.UpdateDescendantState(-nSize, -nFee, -1); });
+    }
+    BOOST_FOREACH(const uint256& descendant, setDescendants) {
+        indexed_transaction_set::iterator it = mapTx.find(descendant);
+        if (it != mapTx.end())
+            mapTx.modify(it, [nSize, nFee](CTxMemPoolEntry& e) { e.UpdateAncestorState(-nSize, -nFee, -1); });
+    }
+
+    txlinksMap::iterator linksit = mapLinks.find(hash);
+    if (linksit != mapLinks.end()) {
+        BOOST_FOREACH(const uint256& parent, linksit->second.parents) {
+            txlinksMap::iterator pit = mapLinks.find(parent);
+            if (pit != mapLinks.end())
+                pit->second.children.erase(hash);
+        }
+        BOOST_FOREACH(const uint256& child, linksit->second.children) {
+            txlinksMap::iterator cit = mapLinks.find(child);
+            if (cit != mapLinks.end())
+                cit->second.parents.erase(hash);
+        }
+        mapLinks.erase(linksit);
+    }
+}
+
 void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
     LOCK(cs);
@@ -334,6 +496,16 @@ bool CTxMemPool::removeSpentIndex(const uint256 txhash)
 }
 
 void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& removed, bool fRecursive)
+{
+    removeInternal(origTx, &removed, fRecursive);
+}
+
+void CTxMemPool::remove(const CTransaction &origTx, bool fRecursive)
+{
+    removeInternal(origTx, NULL, fRecursive);
+}
+
+void CTxMemPool::removeInternal(const CTransaction &origTx, std::list<CTransaction>* removed, bool fRecursive)
 {
     // Remove transaction from memory pool
     {
@@ -357,7 +529,10 @@ void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& rem
             uint256 hash = txToRemove.front();
             txToRemove.pop_front();
             if (!mapTx.count(hash))
+            {
+                removeCold(hash); // no-op unless the entry was demoted
                 continue;
+            }
             const CTransaction& tx = mapTx.find(hash)->GetTx();
             if (fRecursive) {
                 for (unsigned int i = 0; i < tx.vout.size(); i++) {
@@ -378,11 +553,14 @@ void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& rem
             for (const SpendDescription &spendDescription : tx.vShieldedSpend) {
                 mapSaplingNullifiers.erase(spendDescription.nullifier);
             }
-            removed.push_back(tx);
+            if (removed)
+                removed->push_back(tx);
             totalTxSize -= mapTx.find(hash)->GetTxSize();
             cachedInnerUsage -= mapTx.find(hash)->DynamicMemoryUsage();
+            UpdatePackagesForRemoved(hash);
             mapTx.erase(hash);
             nTransactionsUpdated++;
+            nSnapshotSequence++;
             minerPolicyEstimator->removeTx(hash);
             removeAddressIndex(hash);
             removeSpentIndex(hash);
@@ -390,10 +568,135 @@ void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& rem
     }
 }
 
+void CTxMemPool::demoteUnchecked(const uint256& hash)
+{
+    AssertLockHeld(cs);
+    indexed_transaction_set::iterator it = mapTx.find(hash);
+    if (it == mapTx.end())
+        return;
+    const CTransaction& tx = it->GetTx();
+    CColdTxEntry cold(*it);
+    if (!tx.IsCoinImport()) {
+        BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+            mapNextTx.erase(txin.prevout);
+            mapColdNextTx[txin.prevout] = hash;
+        }
+    }
+    mapRecentlyAddedTx.erase(hash);
+    totalTxSize -= it->GetTxSize();
+    cachedInnerUsage -= it->DynamicMemoryUsage();
+    UpdatePackagesForRemoved(hash);
+    mapTx.erase(hash);
+    minerPolicyEstimator->removeTx(hash);
+    removeAddressIndex(hash);
+    removeSpentIndex(hash);
+    coldTxSize += cold.nTxSize;
+    coldTxUsage += cold.DynamicMemoryUsage();
+    mapColdTx[hash] = cold;
+    nTransactionsUpdated++;
+    nSnapshotSequence++;
+}
+
+void CTxMemPool::removeCold(const uint256& hash)
+{
+    AssertLockHeld(cs);
+    std::map<uint256, CColdTxEntry>::iterator it = mapColdTx.find(hash);
+    if (it == mapColdTx.end())
+        return;
+    try {
+        CTransaction tx = it->second.GetTx();
+        BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+            std::map<COutPoint, uint256>::iterator nit = mapColdNextTx.find(txin.prevout);
+            if (nit != mapColdNextTx.end() && nit->second == hash)
+                mapColdNextTx.erase(nit);
+        }
+    } catch (const std::exception&) {
+        // Unreadable payload: sweep its spends the slow way
+        for (std::map<COutPoint, uint256>::iterator nit = mapColdNextTx.begin(); nit != mapColdNextTx.end();) {
+            if (nit->second == hash)
+                mapColdNextTx.erase(nit++);
+            else
+                ++nit;
+        }
+    }
+    coldTxSize -= it->second.nTxSize;
+    coldTxUsage -= it->second.DynamicMemoryUsage();
+    mapColdTx.erase(it);
+    nTransactionsUpdated++;
+    nSnapshotSequence++;
+}
+
+void CTxMemPool::TrimToBudget()
+{
+    if (nMaxMemoryUsage == 0)
+        return;
+    LOCK(cs);
+    if (DynamicMemoryUsage() <= nMaxMemoryUsage)
+        return;
+    // Walk up from the cheap end of the fee-rate index collecting entries
+    // that are safe to demote: nothing depends on them, they have no
+    // shielded components, and the reorg revalidation in removeForReorg
+    // never needs to look at their deserialized form. Demotion mutates
+    // the index, so gather the hashes first.
+    std::vector<uint256> vCandidates;
+    indexed_transaction_set::nth_index<1>::type& feeIndex = mapTx.get<1>();
+    for (indexed_transaction_set::nth_index<1>::type::reverse_iterator rit = feeIndex.rbegin(); rit != feeIndex.rend(); ++rit) {
+        const CTransaction& tx = rit->GetTx();
+        if (rit->GetCountWithDescendants() != 1 || rit->GetCountWithAncestors() != 1)
+            continue;
+        if (!tx.vjoinsplit.empty() || !tx.vShieldedSpend.empty() || !tx.vShieldedOutput.empty())
+            continue;
+        if (tx.nLockTime != 0 || rit->GetSpendsCoinbase())
+            continue;
+        vCandidates.push_back(tx.GetHash());
+    }
+    for (size_t i = 0; i < vCandidates.size() && DynamicMemoryUsage() > nMaxMemoryUsage; i++)
+        demoteUnchecked(vCandidates[i]);
+}
+
+void CTxMemPool::PromoteColdTransactions()
+{
+    if (nMaxMemoryUsage == 0)
+        return;
+    AssertLockHeld(cs);
+    // Refill to just under the budget so the next acceptance does not
+    // immediately demote what was just promoted
+    while (!mapColdTx.empty() && DynamicMemoryUsage() < nMaxMemoryUsage - nMaxMemoryUsage / 10) {
+        std::map<uint256, CColdTxEntry>::iterator best = mapColdTx.end();
+        for (std::map<uint256, CColdTxEntry>::iterator it = mapColdTx.begin(); it != mapColdTx.end(); ++it) {
+            if (best == mapColdTx.end() || best->second.feeRate < it->second.feeRate)
+                best = it;
+        }
+        uint256 hash = best->first;
+        CTransaction tx;
+        try {
+            tx = best->second.GetTx();
+        } catch (const std::exception&) {
+            removeCold(hash);
+            continue;
+        }
+        CTxMemPoolEntry entry(tx, best->second.nFee, best->second.nTime, best->second.dPriority,
+                              best->second.nHeight, best->second.hadNoDependencies,
+                              best->second.spendsCoinbase, best->second.nBranchId);
+        removeCold(hash);
+        addUnchecked(hash, entry, false);
+    }
+}
+
 void CTxMemPool::removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMemPoolHeight, int flags)
 {
     // Remove transactions spending a coinbase which are now immature and no-longer-final transactions
     LOCK(cs);
+    // Cold entries skip the revalidation below; conservatively drop the
+    // whole tier on a reorg and let re-relay restore what is still valid
+    if (!mapColdTx.empty()) {
+        mapColdTx.clear();
+        mapColdNextTx.clear();
+        coldTxSize = 0;
+        coldTxUsage = 0;
+        nTransactionsUpdated++;
+        nSnapshotSequence++;
+    }
     list<CTransaction> transactionsToRemove;
     for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
         const CTransaction& tx = it->GetTx();
@@ -416,8 +719,7 @@ void CTxMemPool::removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMem
         }
     }
     BOOST_FOREACH(const CTransaction& tx, transactionsToRemove) {
-        list<CTransaction> removed;
-        remove(tx, removed, true);
+        remove(tx, true);
     }
 }
 
@@ -457,8 +759,7 @@ void CTxMemPool::removeWithAnchor(const uint256 &invalidRoot, ShieldedType type)
     }
 
     BOOST_FOREACH(const CTransaction& tx, transactionsToRemove) {
-        list<CTransaction> removed;
-        remove(tx, removed, true);
+        remove(tx, true);
     }
 }
 
@@ -476,6 +777,16 @@ void CTxMemPool::removeConflicts(const CTransaction &tx, std::list<CTransaction>
                 remove(txConflict, removed, true);
             }
         }
+        std::map<COutPoint, uint256>::iterator cit = mapColdNextTx.find(txin.prevout);
+        if (cit != mapColdNextTx.end() && cit->second != tx.GetHash()) {
+            std::map<uint256, CColdTxEntry>::iterator colt = mapColdTx.find(cit->second);
+            if (colt != mapColdTx.end()) {
+                try {
+                    removed.push_back(colt->second.GetTx());
+                } catch (const std::exception&) {}
+                removeCold(colt->first);
+            }
+        }
     }
 
     BOOST_FOREACH(const JSDescription &joinsplit, tx.vjoinsplit) {
@@ -524,10 +835,16 @@ void CTxMemPool::removeExpired(unsigned int nBlockHeight)
         }
     }
     for (const CTransaction& tx : transactionsToRemove) {
-        list<CTransaction> removed;
-        remove(tx, removed, true);
+        remove(tx, true);
         LogPrint("mempool", "Removing expired txid: %s\n", tx.GetHash().ToString());
     }
+    std::vector<uint256> coldExpired;
+    for (std::map<uint256, CColdTxEntry>::const_iterator it = mapColdTx.begin(); it != mapColdTx.end(); ++it) {
+        if (it->second.nExpiryHeight != 0 && nBlockHeight > it->second.nExpiryHeight)
+            coldExpired.push_back(it->first);
+    }
+    for (const uint256& hash : coldExpired)
+        removeCold(hash);
 }
 
 /**
@@ -537,24 +854,27 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, unsigned i
                                 std::list<CTransaction>& conflicts, bool fCurrentEstimate)
 {
     LOCK(cs);
-    std::vector<CTxMemPoolEntry> entries;
+    std::vector<const CTxMemPoolEntry*> entries;
     BOOST_FOREACH(const CTransaction& tx, vtx)
     {
         uint256 hash = tx.GetHash();
 
         indexed_transaction_set::iterator i = mapTx.find(hash);
         if (i != mapTx.end())
-            entries.push_back(*i);
+            entries.push_back(&*i);
     }
+    // Update policy estimates before the entries are erased; this avoids
+    // copying every confirmed CTxMemPoolEntry (and its transaction) just to
+    // keep them alive past removal
+    minerPolicyEstimator->processBlock(nBlockHeight, entries, fCurrentEstimate);
     BOOST_FOREACH(const CTransaction& tx, vtx)
     {
-        std::list<CTransaction> dummy;
-        remove(tx, dummy, false);
+        remove(tx, false);
         removeConflicts(tx, conflicts);
         ClearPrioritisation(tx.GetHash());
     }
-    // After the txs in the new block have been removed from the mempool, update policy estimates
-    minerPolicyEstimator->processBlock(nBlockHeight, entries, fCurrentEstimate);
+    // A block freed up space; pull the best cold entries back into the hot pool
+    PromoteColdTransactions();
 }
 
 /**
@@ -574,9 +894,16 @@ void CTxMemPool::removeWithoutBranchId(uint32_t nMemPoolBranchId)
     }
 
     for (const CTransaction& tx : transactionsToRemove) {
-        std::list<CTransaction> removed;
-        remove(tx, removed, true);
+        remove(tx, true);
+    }
+
+    std::vector<uint256> coldToRemove;
+    for (std::map<uint256, CColdTxEntry>::const_iterator it = mapColdTx.begin(); it != mapColdTx.end(); ++it) {
+        if (it->second.nBranchId != nMemPoolBranchId)
+            coldToRemove.push_back(it->first);
     }
+    for (const uint256& hash : coldToRemove)
+        removeCold(hash);
 }
 
 void CTxMemPool::clear()
@@ -584,9 +911,15 @@ void CTxMemPool::clear()
     LOCK(cs);
     mapTx.clear();
     mapNextTx.clear();
+    mapLinks.clear();
+    mapColdTx.clear();
+    mapColdNextTx.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
+    coldTxSize = 0;
+    coldTxUsage = 0;
     ++nTransactionsUpdated;
+    nSnapshotSequence++;
 }
 
 void CTxMemPool::check(const CCoinsViewCache *pcoins) const
@@ -631,6 +964,23 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
             assert(it3->second.n == i);
             i++;
         }
+        // Check that the cached descendant package state matches a fresh walk.
+        {
+            std::set<uint256> setDescendants;
+            CalculateDescendants(tx.GetHash(), setDescendants);
+            uint64_t nCountCheck = setDescendants.size() + 1;
+            uint64_t nSizeCheck = it->GetTxSize();
+            CAmount nFeesCheck = it->GetFee();
+            BOOST_FOREACH(const uint256& descendant, setDescendants) {
+                indexed_transaction_set::const_iterator it2 = mapTx.find(descendant);
+                assert(it2 != mapTx.end());
+                nSizeCheck += it2->GetTxSize();
+                nFeesCheck += it2->GetFee();
+            }
+            assert(it->GetCountWithDescendants() == nCountCheck);
+            assert(it->GetSizeWithDescendants() == nSizeCheck);
+            assert(it->GetFeesWithDescendants() == nFeesCheck);
+        }
 
         boost::unordered_map<uint256, SproutMerkleTree, CCoinsKeyHasher> intermediates;
 
@@ -731,9 +1081,59 @@ void CTxMemPool::queryHashes(vector<uint256>& vtxid)
     vtxid.clear();
 
     LOCK(cs);
-    vtxid.reserve(mapTx.size());
+    vtxid.reserve(mapTx.size() + mapColdTx.size());
     for (indexed_transaction_set::iterator mi = mapTx.begin(); mi != mapTx.end(); ++mi)
         vtxid.push_back(mi->GetTx().GetHash());
+    // cold entries are still part of the relay set
+    for (std::map<uint256, CColdTxEntry>::const_iterator mi = mapColdTx.begin(); mi != mapColdTx.end(); ++mi)
+        vtxid.push_back(mi->first);
+}
+
+CTxMemPoolSnapshotRef CTxMemPool::GetSnapshot() const
+{
+    uint64_t nSeq = nSnapshotSequence.load();
+    {
+        LOCK(cs_snapshot);
+        if (snapshot && nSnapshotBuiltAt == nSeq)
+            return snapshot;
+    }
+    // Stale (or first use): rebuild under cs. Concurrent callers may race and
+    // build duplicate snapshots, which is harmless - each gets a valid copy.
+    std::shared_ptr<CTxMemPoolSnapshot> fresh = std::make_shared<CTxMemPoolSnapshot>();
+    uint64_t nSeqBuilt;
+    {
+        LOCK(cs);
+        nSeqBuilt = nSnapshotSequence.load();
+        fresh->nTotalTxSize = totalTxSize;
+        fresh->nDynamicUsage = DynamicMemoryUsage();
+        fresh->vEntries.reserve(mapTx.size());
+        for (indexed_transaction_set::const_iterator mi = mapTx.begin(); mi != mapTx.end(); ++mi)
+        {
+            const CTxMemPoolEntry &e = *mi;
+            CTxMemPoolSnapshotEntry s;
+            s.hash = e.GetTx().GetHash();
+            s.nTxSize = e.GetTxSize();
+            s.nFee = e.GetFee();
+            s.nTime = e.GetTime();
+            s.nHeight = e.GetHeight();
+            s.dPriority = e.GetPriority(s.nHeight);
+            s.dPriorityPerHeight = e.GetPriority(s.nHeight + 1) - s.dPriority;
+            BOOST_FOREACH(const CTxIn& txin, e.GetTx().vin)
+            {
+                if (mapTx.count(txin.prevout.hash))
+                    s.vDepends.push_back(txin.prevout.hash);
+            }
+            fresh->vEntries.push_back(s);
+        }
+    }
+    LOCK(cs_snapshot);
+    // Keep whichever build reflects the later sequence
+    if (!snapshot || nSeqBuilt >= nSnapshotBuiltAt)
+    {
+        snapshot = fresh;
+        nSnapshotBuiltAt = nSeqBuilt;
+    }
+    return snapshot;
 }
 
 bool CTxMemPool::lookup(uint256 hash, CTransaction& result) const
@@ -745,6 +1145,19 @@ bool CTxMemPool::lookup(uint256 hash, CTransaction& result) const
     return true;
 }
 
+bool CTxMemPool::lookupCold(uint256 hash, CTransaction& result) const
+{
+    LOCK(cs);
+    std::map<uint256, CColdTxEntry>::const_iterator i = mapColdTx.find(hash);
+    if (i == mapColdTx.end()) return false;
+    try {
+        result = i->second.GetTx();
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
 CFeeRate CTxMemPool::estimateFee(int nBlocks) const
 {
     LOCK(cs);
@@ -908,5 +1321,6 @@ bool CCoinsViewMemPool::HaveCoins(const uint256 &txid) const {
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 6 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 6 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 6 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + cachedInnerUsage
+         + memusage::DynamicUsage(mapColdTx) + memusage::DynamicUsage(mapColdNextTx) + coldTxUsage;
 }
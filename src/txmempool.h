@@ -21,7 +21,10 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <atomic>
 #include <list>
+#include <memory>
+#include <set>
 
 #include "addressindex.h"
 #include "spentindex.h"
@@ -70,6 +73,16 @@ private:
     bool spendsCoinbase; //! keep track of transactions that spend a coinbase
     uint32_t nBranchId; //! Branch ID this transaction is known to commit to, cached for efficiency
 
+    //! Package tracking: aggregates over this entry plus all of its in-mempool
+    //! descendants (resp. ancestors), maintained incrementally by CTxMemPool
+    //! on add/remove so package queries never re-walk the dependency graph.
+    uint64_t nCountWithDescendants;
+    uint64_t nSizeWithDescendants;
+    CAmount nFeesWithDescendants;
+    uint64_t nCountWithAncestors;
+    uint64_t nSizeWithAncestors;
+    CAmount nFeesWithAncestors;
+
 public:
     CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
                     int64_t _nTime, double _dPriority, unsigned int _nHeight,
@@ -89,6 +102,18 @@ public:
 
     bool GetSpendsCoinbase() const { return spendsCoinbase; }
     uint32_t GetValidatedBranchId() const { return nBranchId; }
+
+    //! Adjust the cached descendant package state (deltas may be negative)
+    void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+    //! Adjust the cached ancestor package state (deltas may be negative)
+    void UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+
+    uint64_t GetCountWithDescendants() const { return nCountWithDescendants; }
+    uint64_t GetSizeWithDescendants() const { return nSizeWithDescendants; }
+    CAmount GetFeesWithDescendants() const { return nFeesWithDescendants; }
+    uint64_t GetCountWithAncestors() const { return nCountWithAncestors; }
+    uint64_t GetSizeWithAncestors() const { return nSizeWithAncestors; }
+    CAmount GetFeesWithAncestors() const { return nFeesWithAncestors; }
 };
 
 // extracts a TxMemPoolEntry's transaction hash
@@ -114,6 +139,61 @@ public:
 
 class CBlockPolicyEstimator;
 
+/** One entry of an immutable mempool snapshot, carrying everything the
+ * verbose mempool RPCs report so they never need the live entry. */
+struct CTxMemPoolSnapshotEntry
+{
+    uint256 hash;
+    size_t nTxSize;
+    CAmount nFee;
+    int64_t nTime;
+    unsigned int nHeight;
+    double dPriority;          //!< priority at the entry height
+    double dPriorityPerHeight; //!< priority growth per block since entry
+    std::vector<uint256> vDepends; //!< in-mempool parents at snapshot time
+};
+
+/** An immutable point-in-time copy of the mempool contents. Readers hold it
+ * by shared_ptr, so a snapshot stays valid while the pool changes under it. */
+struct CTxMemPoolSnapshot
+{
+    std::vector<CTxMemPoolSnapshotEntry> vEntries;
+    uint64_t nTotalTxSize = 0;
+    size_t nDynamicUsage = 0;
+};
+typedef std::shared_ptr<const CTxMemPoolSnapshot> CTxMemPoolSnapshotRef;
+
+/**
+ * A demoted mempool entry. The transaction is kept in serialized form and
+ * only the metadata needed for relay, conflict removal and re-admission
+ * stays resident; everything derived from the deserialized transaction
+ * (mempool index entries, package links) is dropped on demotion and
+ * rebuilt if the entry is promoted back into the hot pool.
+ */
+class CColdTxEntry
+{
+public:
+    std::vector<unsigned char> vchTx; //! serialized transaction
+    CAmount nFee;
+    size_t nTxSize;
+    int64_t nTime;
+    double dPriority;
+    unsigned int nHeight;
+    bool hadNoDependencies;
+    bool spendsCoinbase;
+    uint32_t nBranchId;
+    uint32_t nExpiryHeight;
+    CFeeRate feeRate;
+
+    CColdTxEntry() : nFee(0), nTxSize(0), nTime(0), dPriority(0.0), nHeight(0),
+                     hadNoDependencies(false), spendsCoinbase(false), nBranchId(0), nExpiryHeight(0) {}
+    explicit CColdTxEntry(const CTxMemPoolEntry& entry);
+
+    //! Deserialize the stored transaction
+    CTransaction GetTx() const;
+    size_t DynamicMemoryUsage() const;
+};
+
 /** An inpoint - a combination of a transaction and an index n into its vin */
 class CInPoint
 {
@@ -187,8 +267,55 @@ private:
     typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
     mapSpentIndexInserted mapSpentInserted;
 
+    //! In-mempool dependency links, one record per pool entry
+    struct TxLinks
+    {
+        std::set<uint256> parents;
+        std::set<uint256> children;
+    };
+    typedef std::map<uint256, TxLinks> txlinksMap;
+    txlinksMap mapLinks;
+
+    //! Link a newly added entry to its in-mempool parents and fold its size,
+    //! fee and count into the package state of every affected entry
+    void UpdatePackagesForAdded(const uint256& hash, const CTxMemPoolEntry& entry);
+    //! Subtract an entry about to be removed from the package state of its
+    //! remaining ancestors and descendants, then drop its links
+    void UpdatePackagesForRemoved(const uint256& hash);
+
+    //! Shared worker for both remove() overloads; collects the removed
+    //! transactions into *removed only when it is non-NULL
+    void removeInternal(const CTransaction &origTx, std::list<CTransaction>* removed, bool fRecursive);
+
+    //! Cold tier: lowest-feerate entries demoted to serialized form when the
+    //! pool exceeds its memory budget. Guarded by cs like the hot maps.
+    std::map<uint256, CColdTxEntry> mapColdTx;
+    uint64_t coldTxSize = 0; //! sum of cold tx' byte sizes
+    uint64_t coldTxUsage = 0; //! cached dynamic usage of the serialized cold payloads
+    size_t nMaxMemoryUsage = 0; //! resident memory budget in bytes; 0 disables the cold tier
+
+    //! Demote one hot entry to the cold tier; the caller verified it has no
+    //! in-pool relatives and no shielded components
+    void demoteUnchecked(const uint256& hash);
+    //! Drop a cold entry together with its mapColdNextTx records
+    void removeCold(const uint256& hash);
+    //! Re-admit best-feerate cold entries while the pool has room; called
+    //! after blocks free up space
+    void PromoteColdTransactions();
+
+    //! Bumped (without cs) on every content change; a snapshot whose recorded
+    //! sequence still matches is current and can be handed out as-is
+    std::atomic<uint64_t> nSnapshotSequence{0};
+    //! Guards the two cached snapshot fields below (never held while cs is)
+    mutable CCriticalSection cs_snapshot;
+    mutable CTxMemPoolSnapshotRef snapshot;
+    mutable uint64_t nSnapshotBuiltAt = 0;
+
 public:
     std::map<COutPoint, CInPoint> mapNextTx;
+    //! Outpoints spent by cold-tier transactions, kept so conflict checks
+    //! still cover the full relay set
+    std::map<COutPoint, uint256> mapColdNextTx;
     std::map<uint256, std::pair<double, CAmount> > mapDeltas;
 
     CTxMemPool(const CFeeRate& _minRelayFee);
@@ -213,6 +340,9 @@ public:
     bool getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
     bool removeSpentIndex(const uint256 txhash);
     void remove(const CTransaction &tx, std::list<CTransaction>& removed, bool fRecursive = false);
+    //! Overload for callers that do not need the removed transactions back;
+    //! avoids copying every removed transaction into a throwaway list.
+    void remove(const CTransaction &tx, bool fRecursive = false);
     void removeWithAnchor(const uint256 &invalidRoot, ShieldedType type);
     void removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMemPoolHeight, int flags);
     void removeConflicts(const CTransaction &tx, std::list<CTransaction>& removed);
@@ -221,7 +351,18 @@ public:
                         std::list<CTransaction>& conflicts, bool fCurrentEstimate = true);
     void removeWithoutBranchId(uint32_t nMemPoolBranchId);
     void clear();
+    //! Collect the txids of all in-mempool ancestors of hash (not including hash)
+    void CalculateAncestors(const uint256& hash, std::set<uint256>& setAncestors) const;
+    //! Collect the txids of all in-mempool descendants of hash (not including hash)
+    void CalculateDescendants(const uint256& hash, std::set<uint256>& setDescendants) const;
     void queryHashes(std::vector<uint256>& vtxid);
+    /**
+     * Return an immutable snapshot of the pool contents, rebuilding it only
+     * when the pool has changed since the last one was built. Callers read
+     * the result without holding cs, so heavy consumers (monitoring RPCs)
+     * no longer stall transaction acceptance.
+     */
+    CTxMemPoolSnapshotRef GetSnapshot() const;
     void pruneSpent(const uint256& hash, CCoins &coins);
     unsigned int GetTransactionsUpdated() const;
     void AddTransactionsUpdated(unsigned int n);
@@ -250,7 +391,7 @@ public:
     uint64_t GetTotalTxSize()
     {
         LOCK(cs);
-        return totalTxSize;
+        return totalTxSize + coldTxSize;
     }
 
     bool exists(uint256 hash) const
@@ -261,6 +402,22 @@ public:
 
     bool lookup(uint256 hash, CTransaction& result) const;
 
+    /** Set the resident memory budget (0 disables the cold tier) */
+    void SetMaxMemoryUsage(size_t nBytes) { nMaxMemoryUsage = nBytes; }
+
+    /** Demote lowest-feerate entries to the cold tier until the pool fits
+     * its memory budget; a no-op when no budget is configured */
+    void TrimToBudget();
+
+    bool existsCold(uint256 hash) const
+    {
+        LOCK(cs);
+        return (mapColdTx.count(hash) != 0);
+    }
+
+    /** Look up a cold-tier transaction, inflating it on demand */
+    bool lookupCold(uint256 hash, CTransaction& result) const;
+
     /** Estimate fee rate needed to get into the next nBlocks */
     CFeeRate estimateFee(int nBlocks) const;
 
@@ -32,12 +32,23 @@ base_blob<BITS>::base_blob(const std::vector<unsigned char>& vch)
     memcpy(data, &vch[0], sizeof(data));
 }
 
+template <unsigned int BITS>
+void base_blob<BITS>::GetHex(char* psz) const
+{
+    static const char hexmap[16] = {'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f'};
+    for (unsigned int i = 0; i < sizeof(data); i++) {
+        unsigned char b = data[sizeof(data) - i - 1];
+        psz[i * 2] = hexmap[b >> 4];
+        psz[i * 2 + 1] = hexmap[b & 15];
+    }
+    psz[sizeof(data) * 2] = '\0';
+}
+
 template <unsigned int BITS>
 std::string base_blob<BITS>::GetHex() const
 {
     char psz[sizeof(data) * 2 + 1];
-    for (unsigned int i = 0; i < sizeof(data); i++)
-        sprintf(psz + i * 2, "%02x", data[sizeof(data) - i - 1]);
+    GetHex(psz);
     return std::string(psz, psz + sizeof(data) * 2);
 }
 
@@ -84,6 +95,7 @@ std::string base_blob<BITS>::ToString() const
 
 // Explicit instantiations for base_blob<160>
 template base_blob<160>::base_blob(const std::vector<unsigned char>&);
+template void base_blob<160>::GetHex(char*) const;
 template std::string base_blob<160>::GetHex() const;
 template std::string base_blob<160>::ToString() const;
 template void base_blob<160>::SetHex(const char*);
@@ -91,6 +103,7 @@ template void base_blob<160>::SetHex(const std::string&);
 
 // Explicit instantiations for base_blob<256>
 template base_blob<256>::base_blob(const std::vector<unsigned char>&);
+template void base_blob<256>::GetHex(char*) const;
 template std::string base_blob<256>::GetHex() const;
 template std::string base_blob<256>::ToString() const;
 template void base_blob<256>::SetHex(const char*);
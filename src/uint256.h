@@ -21,6 +21,8 @@
 #ifndef BITCOIN_UINT256_H
 #define BITCOIN_UINT256_H
 
+#include "serialize.h"
+
 #include <assert.h>
 #include <cstring>
 #include <stdexcept>
@@ -61,6 +63,9 @@ public:
     friend inline bool operator<(const base_blob& a, const base_blob& b) { return memcmp(a.data, b.data, sizeof(a.data)) < 0; }
 
     std::string GetHex() const;
+    //! Allocation-free variant: writes the 2*WIDTH hex digits plus a NUL
+    //! terminator into psz, which must hold at least 2*WIDTH+1 bytes.
+    void GetHex(char* psz) const;
     void SetHex(const char* psz);
     void SetHex(const std::string& str);
     std::string ToString() const;
@@ -153,6 +158,11 @@ public:
     uint64_t GetHash(const uint256& salt) const;
 };
 
+/** Opaque blobs serialize as their raw bytes, so vectors of them can be
+ *  (un)serialized as single block copies. */
+template <> struct CMemcpySerialize<uint160> : std::true_type {};
+template <> struct CMemcpySerialize<uint256> : std::true_type {};
+
 /* uint256 from const char *.
  * This is a separate function because the constructor uint256(const char*) can result
  * in dangerously catching uint256(0).
@@ -86,6 +86,7 @@ public:
     bool isObject() const { return (typ == VOBJ); }
 
     bool push_back(const UniValue& val);
+    bool push_back(UniValue&& val);
     bool push_back(const std::string& val_) {
         UniValue tmpVal(VSTR, val_);
         return push_back(tmpVal);
@@ -113,7 +114,9 @@ public:
     bool push_backV(const std::vector<UniValue>& vec);
 
     void __pushKV(const std::string& key, const UniValue& val);
+    void __pushKV(std::string&& key, UniValue&& val);
     bool pushKV(const std::string& key, const UniValue& val);
+    bool pushKV(std::string&& key, UniValue&& val);
     bool pushKV(const std::string& key, const std::string& val_) {
         UniValue tmpVal(VSTR, val_);
         return pushKV(key, tmpVal);
@@ -160,6 +163,7 @@ private:
     std::vector<UniValue> values;
 
     bool findKey(const std::string& key, size_t& retIdx) const;
+    void writeStream(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
 
@@ -177,9 +181,12 @@ public:
     const UniValue& get_array() const;
 
     enum VType type() const { return getType(); }
-    bool push_back(std::pair<std::string,UniValue> pear) {
+    bool push_back(const std::pair<std::string,UniValue>& pear) {
         return pushKV(pear.first, pear.second);
     }
+    bool push_back(std::pair<std::string,UniValue>&& pear) {
+        return pushKV(std::move(pear.first), std::move(pear.second));
+    }
     friend const UniValue& find_value( const UniValue& obj, const std::string& name);
 };
 
@@ -242,11 +249,22 @@ static inline std::pair<std::string,UniValue> Pair(const char *cKey, const UniVa
     return std::make_pair(key, uVal);
 }
 
+static inline std::pair<std::string,UniValue> Pair(const char *cKey, UniValue&& uVal)
+{
+    std::string key(cKey);
+    return std::make_pair(key, std::move(uVal));
+}
+
 static inline std::pair<std::string,UniValue> Pair(std::string key, const UniValue& uVal)
 {
     return std::make_pair(key, uVal);
 }
 
+static inline std::pair<std::string,UniValue> Pair(std::string key, UniValue&& uVal)
+{
+    return std::make_pair(std::move(key), std::move(uVal));
+}
+
 enum jtokentype {
     JTOK_ERR        = -1,
     JTOK_NONE       = 0,                           // eof
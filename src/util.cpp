@@ -33,6 +33,7 @@
 #include "komodo_globals.h"
 
 #include <stdarg.h>
+#include <atomic>
 #include <sstream>
 #include <vector>
 #include <stdio.h>
@@ -299,10 +300,151 @@ static std::string LogTimestampStr(const std::string &str, bool *fStartedNewLine
     return strStamped;
 }
 
+/** Timestamp a message and write it to the (possibly not yet opened) debug
+ * log. Shared by the synchronous LogPrintStr path and the async writer
+ * thread; serialized by mutexDebugLog. */
+static int LogWriteStr(const std::string &str)
+{
+    static bool fStartedNewLine = true;
+    int ret = 0;
+
+    boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+    boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+
+    string strTimestamped = LogTimestampStr(str, &fStartedNewLine);
+
+    // buffer if we haven't opened the log yet
+    if (fileout == NULL) {
+        assert(vMsgsBeforeOpenLog);
+        ret = strTimestamped.length();
+        vMsgsBeforeOpenLog->push_back(strTimestamped);
+    }
+    else
+    {
+        // reopen the log file, if requested
+        if (fReopenDebugLog) {
+            fReopenDebugLog = false;
+            boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
+            if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
+                setbuf(fileout, NULL); // unbuffered
+        }
+
+        ret = FileWriteStr(strTimestamped, fileout);
+    }
+    return ret;
+}
+
+/**
+ * Asynchronous log backend (-logasync). Callers hand the formatted message
+ * to a bounded lock-free ring (Vyukov-style sequence-stamped cells) and the
+ * dedicated writer thread does the timestamping and file I/O, so the socket
+ * and validation threads never block on the debug.log mutex or on disk.
+ * When the ring is full the message is counted rather than queued, and the
+ * writer reports how many were lost; logging can therefore never stall the
+ * caller. Category filtering is unchanged: LogPrint still returns before
+ * formatting when the category is off.
+ */
+static const size_t LOG_RING_SIZE = 4096; // must be a power of two
+namespace {
+struct LogRingCell {
+    std::atomic<size_t> seq;
+    std::string str;
+};
+} // anon namespace
+static LogRingCell* logRing = NULL;
+static std::atomic<size_t> logRingHead(0);
+static size_t logRingTail = 0; // writer thread only
+static std::atomic<uint64_t> nLogMsgsDropped(0);
+static std::atomic<bool> fLogAsync(false);
+static std::atomic<bool> fStopLogWriter(false);
+static boost::thread* logWriterThread = NULL;
+static boost::mutex mutexLogWriter;
+static boost::condition_variable condLogWriter;
+
+static bool LogRingEnqueue(std::string&& str)
+{
+    size_t pos = logRingHead.load(std::memory_order_relaxed);
+    for (;;) {
+        LogRingCell& cell = logRing[pos & (LOG_RING_SIZE - 1)];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (logRingHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.str = std::move(str);
+                cell.seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false; // ring full
+        } else {
+            pos = logRingHead.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+static bool LogRingDequeue(std::string& str)
+{
+    LogRingCell& cell = logRing[logRingTail & (LOG_RING_SIZE - 1)];
+    size_t seq = cell.seq.load(std::memory_order_acquire);
+    if ((intptr_t)seq - (intptr_t)(logRingTail + 1) < 0)
+        return false;
+    str = std::move(cell.str);
+    cell.str.clear();
+    cell.seq.store(logRingTail + LOG_RING_SIZE, std::memory_order_release);
+    logRingTail++;
+    return true;
+}
+
+static void LogDrainRing()
+{
+    std::string str;
+    while (LogRingDequeue(str))
+        LogWriteStr(str);
+    uint64_t nDropped = nLogMsgsDropped.exchange(0, std::memory_order_relaxed);
+    if (nDropped > 0)
+        LogWriteStr(strprintf("*** async logger dropped %llu messages\n", (unsigned long long)nDropped));
+}
+
+static void ThreadLogWriter()
+{
+    RenameThread("zcash-logwriter");
+    while (!fStopLogWriter.load(std::memory_order_acquire)) {
+        LogDrainRing();
+        boost::unique_lock<boost::mutex> lock(mutexLogWriter);
+        condLogWriter.timed_wait(lock, boost::posix_time::milliseconds(100));
+    }
+}
+
+void StartAsyncDebugLog()
+{
+    if (logRing != NULL)
+        return;
+    logRing = new LogRingCell[LOG_RING_SIZE];
+    for (size_t i = 0; i < LOG_RING_SIZE; i++)
+        logRing[i].seq.store(i, std::memory_order_relaxed);
+    fStopLogWriter.store(false);
+    logWriterThread = new boost::thread(&ThreadLogWriter);
+    fLogAsync.store(true, std::memory_order_release);
+}
+
+void StopAsyncDebugLog()
+{
+    if (logWriterThread == NULL)
+        return;
+    // Send new messages back through the synchronous path, then stop the
+    // writer and drain whatever is still queued so nothing is lost.
+    fLogAsync.store(false, std::memory_order_release);
+    fStopLogWriter.store(true, std::memory_order_release);
+    condLogWriter.notify_one();
+    logWriterThread->join();
+    delete logWriterThread;
+    logWriterThread = NULL;
+    LogDrainRing();
+}
+
 int LogPrintStr(const std::string &str)
 {
     int ret = 0; // Returns total number of characters written
-    static bool fStartedNewLine = true;
     if (fPrintToConsole)
     {
         // print to console
@@ -311,29 +453,16 @@ int LogPrintStr(const std::string &str)
     }
     else if (fPrintToDebugLog)
     {
-        boost::call_once(&DebugPrintInit, debugPrintInitFlag);
-        boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
-
-        string strTimestamped = LogTimestampStr(str, &fStartedNewLine);
-
-        // buffer if we haven't opened the log yet
-        if (fileout == NULL) {
-            assert(vMsgsBeforeOpenLog);
-            ret = strTimestamped.length();
-            vMsgsBeforeOpenLog->push_back(strTimestamped);
-        }
-        else
-        {
-            // reopen the log file, if requested
-            if (fReopenDebugLog) {
-                fReopenDebugLog = false;
-                boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
-                if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
-                    setbuf(fileout, NULL); // unbuffered
-            }
-
-            ret = FileWriteStr(strTimestamped, fileout);
+        if (fLogAsync.load(std::memory_order_acquire)) {
+            ret = str.length();
+            std::string strCopy(str);
+            if (LogRingEnqueue(std::move(strCopy)))
+                condLogWriter.notify_one();
+            else
+                nLogMsgsDropped.fetch_add(1, std::memory_order_relaxed);
+            return ret;
         }
+        ret = LogWriteStr(str);
     }
     return ret;
 }
@@ -830,6 +959,19 @@ void FileCommit(FILE *fileout)
 #endif
 }
 
+/**
+ * Tell the kernel a file's cached pages will not be re-read, so sequentially
+ * written block data does not evict hot chainstate/LevelDB pages during IBD.
+ * Advisory only; callers should flush first so dirty pages are not dropped
+ * back onto the writeback path. No-op where unsupported.
+ */
+void FileEvictCache(FILE *fileout)
+{
+#if defined(POSIX_FADV_DONTNEED)
+    posix_fadvise(fileno(fileout), 0, 0, POSIX_FADV_DONTNEED);
+#endif
+}
+
 bool TruncateFile(FILE *file, unsigned int length) {
 #if defined(WIN32)
     return _chsize(_fileno(file), length) == 0;
@@ -134,6 +134,7 @@ const boost::filesystem::path &ZC_GetParamsDir();
 void PrintExceptionContinue(const std::exception *pex, const char* pszThread);
 void ParseParameters(int argc, const char*const argv[]);
 void FileCommit(FILE *fileout);
+void FileEvictCache(FILE *fileout);
 bool TruncateFile(FILE *file, unsigned int length);
 int RaiseFileDescriptorLimit(int nMinFD);
 void AllocateFileRange(FILE *file, unsigned int offset, unsigned int length);
@@ -184,6 +185,13 @@ boost::filesystem::path GetSpecialFolderPath(int nFolder, bool fCreate = true);
 #endif
 boost::filesystem::path GetTempPath();
 void OpenDebugLog();
+/** Route debug.log writes through a bounded lock-free ring drained by a
+ * dedicated writer thread (-logasync). Overflow drops messages and reports
+ * the count instead of ever blocking the caller. */
+void StartAsyncDebugLog();
+/** Stop the async writer and drain anything still queued; subsequent
+ * messages take the synchronous path again. */
+void StopAsyncDebugLog();
 void ShrinkDebugFile();
 void runCommand(const std::string& strCommand);
 const boost::filesystem::path GetExportDir();
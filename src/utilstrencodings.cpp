@@ -88,6 +88,90 @@ signed char HexDigit(char c)
     return p_util_hexdigit[(unsigned char)c];
 }
 
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(__GNUC__)
+#define HEX_CONV_SSSE3
+#include <cpuid.h>
+#include <immintrin.h>
+
+namespace
+{
+
+bool HaveSSSE3()
+{
+    static const bool fHave = [] {
+        unsigned int eax, ebx, ecx, edx;
+        return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1 << 9)) != 0;
+    }();
+    return fHave;
+}
+
+// The target attributes let these build without -mssse3, so availability can
+// stay a pure runtime decision like it is for the SHA256 backends.
+
+/** Encode whole 16-byte blocks as 32 hex chars each via a pshufb nibble
+ * lookup, advancing the arguments past whatever was consumed. */
+__attribute__((target("ssse3")))
+void HexEncodeSSSE3(const unsigned char*& pch, size_t& len, char*& out)
+{
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i lut = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                      '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    while (len >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)pch);
+        __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi64(v, 4), mask));
+        __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, mask));
+        _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi8(hi, lo));
+        pch += 16;
+        out += 32;
+        len -= 16;
+    }
+}
+
+/** Decode the longest leading run of whole 32-char hex blocks into vch and
+ * return how many input chars were consumed. Stops at the first block that
+ * contains anything other than hex digits (whitespace, the terminator, junk)
+ * so the scalar loop can take over with its usual semantics. */
+__attribute__((target("ssse3")))
+size_t HexDecodeSSSE3(const char* psz, size_t len, std::vector<unsigned char>& vch)
+{
+    size_t consumed = 0;
+    const __m128i mul = _mm_set1_epi16(0x0110);
+    while (len - consumed >= 32) {
+        __m128i v[2];
+        __m128i ok = _mm_set1_epi8(-1);
+        for (int i = 0; i < 2; i++) {
+            __m128i c = _mm_loadu_si128((const __m128i*)(psz + consumed + 16 * i));
+            // Classify against the original chars; lowercasing first would
+            // let control chars alias onto the digits.
+            __m128i fDigit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                           _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+            __m128i fLower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)),
+                                           _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), c));
+            __m128i fUpper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)),
+                                           _mm_cmpgt_epi8(_mm_set1_epi8('F' + 1), c));
+            __m128i fAlpha = _mm_or_si128(fLower, fUpper);
+            __m128i lc = _mm_or_si128(c, _mm_set1_epi8(0x20));
+            ok = _mm_and_si128(ok, _mm_or_si128(fDigit, fAlpha));
+            v[i] = _mm_or_si128(_mm_and_si128(fDigit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+                                _mm_and_si128(fAlpha, _mm_sub_epi8(lc, _mm_set1_epi8('a' - 10))));
+        }
+        if (_mm_movemask_epi8(ok) != 0xffff)
+            break;
+        // Each char pair becomes hi*16+lo in a 16-bit lane, then packs down
+        // to the 16 output bytes.
+        __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(v[0], mul), _mm_maddubs_epi16(v[1], mul));
+        unsigned char buf[16];
+        _mm_storeu_si128((__m128i*)buf, bytes);
+        vch.insert(vch.end(), buf, buf + 16);
+        consumed += 32;
+    }
+    return consumed;
+}
+
+} // namespace
+#endif // x86_64 && __GNUC__
+
 bool IsHex(const string& str)
 {
     for(std::string::const_iterator it(str.begin()); it != str.end(); ++it)
@@ -102,6 +186,10 @@ vector<unsigned char> ParseHex(const char* psz)
 {
     // convert hex dump to vector
     vector<unsigned char> vch;
+#ifdef HEX_CONV_SSSE3
+    if (HaveSSSE3())
+        psz += HexDecodeSSSE3(psz, strlen(psz), vch);
+#endif
     while (true)
     {
         while (isspace(*psz))
@@ -124,6 +212,25 @@ vector<unsigned char> ParseHex(const string& str)
     return ParseHex(str.c_str());
 }
 
+string HexStrBytes(const unsigned char* pch, size_t len)
+{
+    static const char hexmap[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
+                                     '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+    string rv(len * 2, '\0');
+    if (len == 0)
+        return rv;
+    char* out = &rv[0];
+#ifdef HEX_CONV_SSSE3
+    if (HaveSSSE3())
+        HexEncodeSSSE3(pch, len, out);
+#endif
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = hexmap[pch[i] >> 4];
+        out[2 * i + 1] = hexmap[pch[i] & 15];
+    }
+    return rv;
+}
+
 string EncodeBase64(const unsigned char* pch, size_t len)
 {
     static const char *pbase64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
@@ -43,6 +43,14 @@ std::string HexInt(uint32_t val);
 uint32_t ParseHexToUInt32(const std::string& str);
 std::vector<unsigned char> ParseHex(const char* psz);
 std::vector<unsigned char> ParseHex(const std::string& str);
+/**
+* Hex-encode a contiguous byte buffer (SSE-accelerated where the host
+* supports it); HexStr forwards the common unspaced case here
+* @param[in] pch    Start of the buffer
+* @param[in] len    Buffer length in bytes
+* @return           The lower-case hex representation
+*/
+std::string HexStrBytes(const unsigned char* pch, size_t len);
 signed char HexDigit(char c);
 bool IsHex(const std::string& str);
 std::vector<unsigned char> DecodeBase64(const char* p, bool* pfInvalid = NULL);
@@ -84,6 +92,10 @@ bool ParseDouble(const std::string& str, double *out);
 template<typename T>
 std::string HexStr(const T itbegin, const T itend, bool fSpaces=false)
 {
+    // Every in-tree caller iterates over contiguous byte storage, so the
+    // unspaced case can hand the whole buffer to the bulk routine.
+    if (!fSpaces && itend > itbegin && sizeof(*itbegin) == 1)
+        return HexStrBytes((const unsigned char*)&itbegin[0], itend - itbegin);
     std::string rv;
     static const char hexmap[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
                                      '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
@@ -5,8 +5,15 @@
 
 #include "validationinterface.h"
 
+#include "primitives/transaction.h"
+
 static CMainSignals g_signals;
 
+void CValidationInterface::SyncBlockTransactions(const std::vector<CTransaction> &vtx, const CBlock *pblock) {
+    for (const CTransaction &tx : vtx)
+        SyncTransaction(tx, pblock);
+}
+
 CMainSignals& GetMainSignals()
 {
     return g_signals;
@@ -15,6 +22,7 @@ CMainSignals& GetMainSignals()
 void RegisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
     g_signals.SyncTransaction.connect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2));
+    g_signals.SyncBlockTransactions.connect(boost::bind(&CValidationInterface::SyncBlockTransactions, pwalletIn, _1, _2));
     g_signals.EraseTransaction.connect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
     g_signals.UpdatedTransaction.connect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
     g_signals.RescanWallet.connect(boost::bind(&CValidationInterface::RescanWallet, pwalletIn));
@@ -31,6 +39,7 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.SetBestChain.disconnect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
     g_signals.UpdatedTransaction.disconnect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
     g_signals.EraseTransaction.disconnect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
+    g_signals.SyncBlockTransactions.disconnect(boost::bind(&CValidationInterface::SyncBlockTransactions, pwalletIn, _1, _2));
     g_signals.SyncTransaction.disconnect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2));
     g_signals.RescanWallet.disconnect(boost::bind(&CValidationInterface::RescanWallet, pwalletIn));
     g_signals.UpdatedBlockTip.disconnect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
@@ -43,6 +52,7 @@ void UnregisterAllValidationInterfaces() {
     g_signals.SetBestChain.disconnect_all_slots();
     g_signals.UpdatedTransaction.disconnect_all_slots();
     g_signals.EraseTransaction.disconnect_all_slots();
+    g_signals.SyncBlockTransactions.disconnect_all_slots();
     g_signals.SyncTransaction.disconnect_all_slots();
     g_signals.RescanWallet.disconnect_all_slots();
     g_signals.UpdatedBlockTip.disconnect_all_slots();
@@ -52,6 +62,10 @@ void SyncWithWallets(const CTransaction &tx, const CBlock *pblock) {
     g_signals.SyncTransaction(tx, pblock);
 }
 
+void SyncWithWallets(const std::vector<CTransaction> &vtx, const CBlock *pblock) {
+    g_signals.SyncBlockTransactions(vtx, pblock);
+}
+
 void EraseFromWallets(const uint256 &hash) {
     g_signals.EraseTransaction(hash);
 }
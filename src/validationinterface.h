@@ -8,6 +8,8 @@
 
 #include <boost/signals2/signal.hpp>
 
+#include <vector>
+
 #include "zcash/IncrementalMerkleTree.hpp"
 
 class CBlock;
@@ -28,6 +30,10 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 void UnregisterAllValidationInterfaces();
 /** Push an updated transaction to all registered wallets */
 void SyncWithWallets(const CTransaction& tx, const CBlock* pblock = NULL);
+/** Push a connected block's transactions to all registered wallets in one
+ * notification, so a wallet can take its lock and batch its database writes
+ * once per block instead of once per transaction */
+void SyncWithWallets(const std::vector<CTransaction>& vtx, const CBlock* pblock);
 /** Erase a transaction from all registered wallets */
 void EraseFromWallets(const uint256 &hash);
 /** Rescan all registered wallets */
@@ -37,6 +43,8 @@ class CValidationInterface {
 protected:
     virtual void UpdatedBlockTip(const CBlockIndex *pindex) {}
     virtual void SyncTransaction(const CTransaction &tx, const CBlock *pblock) {}
+    //! Default implementation forwards each transaction to SyncTransaction
+    virtual void SyncBlockTransactions(const std::vector<CTransaction> &vtx, const CBlock *pblock);
     virtual void EraseFromWallet(const uint256 &hash) {}
     virtual void RescanWallet() {}
     virtual void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added) {}
@@ -54,6 +62,8 @@ struct CMainSignals {
     boost::signals2::signal<void (const CBlockIndex *)> UpdatedBlockTip;
     /** Notifies listeners of updated transaction data (transaction, and optionally the block it is found in. */
     boost::signals2::signal<void (const CTransaction &, const CBlock *)> SyncTransaction;
+    /** Notifies listeners of all transactions of a connected block in one call. */
+    boost::signals2::signal<void (const std::vector<CTransaction> &, const CBlock *)> SyncBlockTransactions;
     /** Notifies listeners of an erased transaction. */
     boost::signals2::signal<void (const uint256 &)> EraseTransaction;
     /** Notifies listeners of the need to rescan the wallet. */
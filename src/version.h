@@ -24,7 +24,7 @@
  * network protocol versioning
  */
 
-static const int PROTOCOL_VERSION = 170014;
+static const int PROTOCOL_VERSION = 170015;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -43,6 +43,9 @@ static const int CADDR_TIME_VERSION = 31402;
 //! BIP 0031, pong message, is enabled for all versions AFTER this one
 static const int BIP0031_VERSION = 60000;
 
+//! SipHash message checksums between whitelisted peers, from this version
+static const int FAST_CHECKSUM_VERSION = 170015;
+
 //! "mempool" command, enhanced "getdata" behavior starts with this version
 static const int MEMPOOL_GD_VERSION = 60002;
 
@@ -41,6 +41,7 @@
 #include "zcash/IncrementalMerkleTree.hpp"
 #include "komodo_bitcoind.h"
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <string>
@@ -476,6 +477,7 @@ bool AsyncRPCOperation_mergetoaddress::main_impl()
 
         UniValue obj(UniValue::VOBJ);
         obj = perform_joinsplit(info);
+        obj = prove_deferred_joinsplits(obj);
         sign_send_raw_transaction(obj);
         return true;
     }
@@ -775,11 +777,85 @@ bool AsyncRPCOperation_mergetoaddress::main_impl()
     assert(zInputsDeque.size() == 0);
     assert(vpubNewProcessed);
 
+    obj = prove_deferred_joinsplits(obj);
     sign_send_raw_transaction(obj);
     return true;
 }
 
 
+UniValue AsyncRPCOperation_mergetoaddress::prove_deferred_joinsplits(UniValue obj)
+{
+    if (vDeferredProofs_.empty()) {
+        return obj;
+    }
+
+    LogPrint("zrpc", "%s: generating %d joinsplit proofs concurrently\n",
+             getId(), vDeferredProofs_.size());
+
+    // Every captured statement is independent, so shard them across a
+    // prover pool; the calling thread takes part as well
+    std::vector<libzcash::GrothProof> vProofs(vDeferredProofs_.size());
+    std::atomic<size_t> nNext(0);
+    const auto prover = [&] {
+        size_t k;
+        while ((k = nNext.fetch_add(1)) < vDeferredProofs_.size()) {
+            vProofs[k] = vDeferredProofs_[k].second.prove();
+        }
+    };
+    size_t nThreads = std::min((size_t)GetNumCores(), vDeferredProofs_.size());
+    std::vector<std::thread> provers;
+    for (size_t t = 1; t < nThreads; t++) {
+        provers.emplace_back(prover);
+    }
+    prover();
+    for (std::thread& t : provers) {
+        t.join();
+    }
+
+    // Patch the proofs into the transaction and verify them
+    CMutableTransaction mtx(tx_);
+    for (size_t k = 0; k < vDeferredProofs_.size(); k++) {
+        mtx.vjoinsplit[vDeferredProofs_[k].first].proof = vProofs[k];
+    }
+    auto verifier = libzcash::ProofVerifier::Strict();
+    for (const JSDescription& jsdesc : mtx.vjoinsplit) {
+        if (!(jsdesc.Verify(*pzcashParams, verifier, joinSplitPubKey_))) {
+            throw std::runtime_error("error verifying joinsplit");
+        }
+    }
+
+    // The joinsplit signature commits to the proofs, so re-sign
+    CScript scriptCode;
+    CTransaction signTx(mtx);
+    uint256 dataToBeSigned = SignatureHash(scriptCode, signTx, NOT_AN_INPUT, SIGHASH_ALL, 0, consensusBranchId_);
+    if (!(crypto_sign_detached(&mtx.joinSplitSig[0], NULL,
+                               dataToBeSigned.begin(), 32,
+                               joinSplitPrivKey_) == 0)) {
+        throw std::runtime_error("crypto_sign_detached failed");
+    }
+    if (!(crypto_sign_verify_detached(&mtx.joinSplitSig[0],
+                                      dataToBeSigned.begin(), 32,
+                                      mtx.joinSplitPubKey.begin()) == 0)) {
+        throw std::runtime_error("crypto_sign_verify_detached failed");
+    }
+
+    tx_ = CTransaction(mtx);
+    vDeferredProofs_.clear();
+
+    // Replace the raw transaction hex with the proved and re-signed one
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << tx_;
+    UniValue patched(UniValue::VOBJ);
+    for (size_t i = 0; i < obj.size(); i++) {
+        if (obj.getKeys()[i] == "rawtxn") {
+            continue;
+        }
+        patched.push_back(Pair(obj.getKeys()[i], obj.getValues()[i]));
+    }
+    patched.push_back(Pair("rawtxn", HexStr(ss.begin(), ss.end())));
+    return patched;
+}
+
 extern UniValue signrawtransaction(const UniValue& params, bool fHelp, const CPubKey& mypk);
 
 /**
@@ -927,23 +1003,43 @@ UniValue AsyncRPCOperation_mergetoaddress::perform_joinsplit(
     uint256 esk; // payment disclosure - secret
 
     assert(mtx.fOverwintered && (mtx.nVersion >= SAPLING_TX_VERSION));
-    JSDescription jsdesc = JSDescription::Randomized(
-                                                     *pzcashParams,
-                                                     joinSplitPubKey_,
-                                                     anchor,
-                                                     inputs,
-                                                     outputs,
-                                                     inputMap,
-                                                     outputMap,
-                                                     info.vpub_old,
-                                                     info.vpub_new,
-                                                     !this->testmode,
-                                                     &esk); // parameter expects pointer to esk, so pass in address
-    {
+    JSDescription jsdesc;
+    if (this->testmode) {
+        jsdesc = JSDescription::Randomized(
+                                           *pzcashParams,
+                                           joinSplitPubKey_,
+                                           anchor,
+                                           inputs,
+                                           outputs,
+                                           inputMap,
+                                           outputMap,
+                                           info.vpub_old,
+                                           info.vpub_new,
+                                           false,
+                                           &esk); // parameter expects pointer to esk, so pass in address
         auto verifier = libzcash::ProofVerifier::Strict();
         if (!(jsdesc.Verify(*pzcashParams, verifier, joinSplitPubKey_))) {
             throw std::runtime_error("error verifying joinsplit");
         }
+    } else {
+        // Capture the proof inputs instead of proving here; the statements
+        // are independent, so prove_deferred_joinsplits generates them all
+        // concurrently (and verifies and re-signs) once the chain is built
+        vDeferredProofs_.push_back(std::make_pair(tx_.vjoinsplit.size(), ZCSproutDeferredProof()));
+        jsdesc = JSDescription::Randomized(
+                                           *pzcashParams,
+                                           joinSplitPubKey_,
+                                           anchor,
+                                           inputs,
+                                           outputs,
+                                           inputMap,
+                                           outputMap,
+                                           info.vpub_old,
+                                           info.vpub_new,
+                                           true,
+                                           &esk, // parameter expects pointer to esk, so pass in address
+                                           GetRandInt,
+                                           &vDeferredProofs_.back().second);
     }
 
     mtx.vjoinsplit.push_back(jsdesc);
@@ -88,9 +88,25 @@ public:
     AsyncRPCOperation_mergetoaddress& operator=(AsyncRPCOperation_mergetoaddress&&) = delete;      // Move assign
     
     virtual void main();
-    
+
     virtual UniValue getStatus() const;
-    
+
+    virtual std::set<std::string> getConflictKeys() const {
+        // Inputs were already selected when the operation was constructed,
+        // so the outpoints themselves identify what will be spent
+        std::set<std::string> keys;
+        for (const MergeToAddressInputUTXO& utxo : utxoInputs_) {
+            keys.insert(std::get<0>(utxo).ToString());
+        }
+        for (const MergeToAddressInputSproutNote& note : sproutNoteInputs_) {
+            keys.insert(std::get<0>(note).ToString());
+        }
+        for (const MergeToAddressInputSaplingNote& note : saplingNoteInputs_) {
+            keys.insert(std::get<0>(note).ToString());
+        }
+        return keys;
+    }
+
     bool testmode = false; // Set to true to disable sending txs and generating proofs
     
     bool paymentDisclosureMode = true; // Set to true to save esk for encrypted notes in payment disclosure database.
@@ -138,6 +154,15 @@ private:
                                std::vector<boost::optional<SproutWitness>> witnesses,
                                uint256 anchor);
     
+    // JoinSplit statements captured by perform_joinsplit for concurrent
+    // proving, paired with the vjoinsplit index each proof belongs to
+    std::vector<std::pair<size_t, ZCSproutDeferredProof>> vDeferredProofs_;
+
+    // Prove all captured joinsplit statements on a thread pool, patch the
+    // proofs into tx_, verify them and re-sign; returns obj with its rawtxn
+    // field replaced by the proved transaction
+    UniValue prove_deferred_joinsplits(UniValue obj);
+
     void sign_send_raw_transaction(UniValue obj); // throws exception if there was an error
     
     void lock_utxos();
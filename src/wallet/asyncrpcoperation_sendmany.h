@@ -88,6 +88,12 @@ public:
 
     virtual UniValue getStatus() const;
 
+    virtual std::set<std::string> getConflictKeys() const {
+        // Notes and utxos are selected from the source address inside main(),
+        // so two sends from the same address must not run concurrently
+        return std::set<std::string>({fromaddress_});
+    }
+
     bool testmode = false;  // Set to true to disable sending txs and generating proofs
 
     bool paymentDisclosureMode = true; // Set to true to save esk for encrypted notes in payment disclosure database.
@@ -142,6 +148,15 @@ private:
         std::vector<boost::optional < SproutWitness>> witnesses,
         uint256 anchor);
 
+    // JoinSplit statements captured by perform_joinsplit for concurrent
+    // proving, paired with the vjoinsplit index each proof belongs to
+    std::vector<std::pair<size_t, ZCSproutDeferredProof>> vDeferredProofs_;
+
+    // Prove all captured joinsplit statements on a thread pool, patch the
+    // proofs into tx_, verify them and re-sign; returns obj with its rawtxn
+    // field replaced by the proved transaction
+    UniValue prove_deferred_joinsplits(UniValue obj);
+
     void sign_send_raw_transaction(UniValue obj);     // throws exception if there was an error
 
     // payment disclosure!
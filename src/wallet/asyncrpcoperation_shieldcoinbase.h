@@ -77,6 +77,15 @@ public:
 
     virtual UniValue getStatus() const;
 
+    virtual std::set<std::string> getConflictKeys() const {
+        // The coinbase utxos to shield were selected up front
+        std::set<std::string> keys;
+        for (const ShieldCoinbaseUTXO& utxo : inputs_) {
+            keys.insert(COutPoint(utxo.txid, utxo.vout).ToString());
+        }
+        return keys;
+    }
+
     bool testmode = false;  // Set to true to disable sending txs and generating proofs
     bool paymentDisclosureMode = true; // Set to true to save esk for encrypted notes in payment disclosure database.
 
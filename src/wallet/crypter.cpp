@@ -32,6 +32,17 @@
 
 using namespace libzcash;
 
+CCrypter::~CCrypter()
+{
+    CleanKey();
+
+    if (pCipherCtx)
+        EVP_CIPHER_CTX_free(pCipherCtx);
+
+    LockedPageManager::Instance().UnlockRange(&chKey[0], sizeof chKey);
+    LockedPageManager::Instance().UnlockRange(&chIV[0], sizeof chIV);
+}
+
 bool CCrypter::SetKeyFromPassphrase(const SecureString& strKeyData, const std::vector<unsigned char>& chSalt, const unsigned int nRounds, const unsigned int nDerivationMethod)
 {
     if (nRounds < 1 || chSalt.size() != WALLET_CRYPTO_SALT_SIZE)
@@ -78,12 +89,13 @@ bool CCrypter::Encrypt(const CKeyingMaterial& vchPlaintext, std::vector<unsigned
 
     bool fOk = true;
 
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    assert(ctx);
-    if (fOk) fOk = EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, chKey, chIV) != 0;
-    if (fOk) fOk = EVP_EncryptUpdate(ctx, &vchCiphertext[0], &nCLen, &vchPlaintext[0], nLen) != 0;
-    if (fOk) fOk = EVP_EncryptFinal_ex(ctx, (&vchCiphertext[0]) + nCLen, &nFLen) != 0;
-    EVP_CIPHER_CTX_free(ctx);
+    // reuse the crypter's context; EVP_EncryptInit_ex reinitializes it
+    if (!pCipherCtx)
+        pCipherCtx = EVP_CIPHER_CTX_new();
+    assert(pCipherCtx);
+    if (fOk) fOk = EVP_EncryptInit_ex(pCipherCtx, EVP_aes_256_cbc(), NULL, chKey, chIV) != 0;
+    if (fOk) fOk = EVP_EncryptUpdate(pCipherCtx, &vchCiphertext[0], &nCLen, &vchPlaintext[0], nLen) != 0;
+    if (fOk) fOk = EVP_EncryptFinal_ex(pCipherCtx, (&vchCiphertext[0]) + nCLen, &nFLen) != 0;
 
     if (!fOk) return false;
 
@@ -104,12 +116,13 @@ bool CCrypter::Decrypt(const std::vector<unsigned char>& vchCiphertext, CKeyingM
 
     bool fOk = true;
 
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    assert(ctx);
-    if (fOk) fOk = EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, chKey, chIV) != 0;
-    if (fOk) fOk = EVP_DecryptUpdate(ctx, &vchPlaintext[0], &nPLen, &vchCiphertext[0], nLen) != 0;
-    if (fOk) fOk = EVP_DecryptFinal_ex(ctx, (&vchPlaintext[0]) + nPLen, &nFLen) != 0;
-    EVP_CIPHER_CTX_free(ctx);
+    // reuse the crypter's context; EVP_DecryptInit_ex reinitializes it
+    if (!pCipherCtx)
+        pCipherCtx = EVP_CIPHER_CTX_new();
+    assert(pCipherCtx);
+    if (fOk) fOk = EVP_DecryptInit_ex(pCipherCtx, EVP_aes_256_cbc(), NULL, chKey, chIV) != 0;
+    if (fOk) fOk = EVP_DecryptUpdate(pCipherCtx, &vchPlaintext[0], &nPLen, &vchCiphertext[0], nLen) != 0;
+    if (fOk) fOk = EVP_DecryptFinal_ex(pCipherCtx, (&vchPlaintext[0]) + nPLen, &nFLen) != 0;
 
     if (!fOk) return false;
 
@@ -221,6 +234,7 @@ bool CCryptoKeyStore::Lock()
     {
         LOCK(cs_KeyStore);
         vMasterKey.clear();
+        mapUnlockedKeys.clear(); // CKey cleanses its key bytes on destruction
     }
 
     NotifyStatusChanged(this);
@@ -257,6 +271,10 @@ bool CCryptoKeyStore::Unlock(const CKeyingMaterial& vMasterKeyIn)
                 break;
             }
             keyPass = true;
+            // the thorough first unlock decrypts every key anyway; retain
+            // them so signing does not redo the work (GetKey fills in any
+            // the quick path skips)
+            mapUnlockedKeys[(*mi).first] = key;
             if (fDecryptionThoroughlyChecked)
                 break;
         }
@@ -296,7 +314,10 @@ bool CCryptoKeyStore::Unlock(const CKeyingMaterial& vMasterKeyIn)
             assert(false);
         }
         if (keyFail || !keyPass)
+        {
+            mapUnlockedKeys.clear();
             return false;
+        }
         vMasterKey = vMasterKeyIn;
         fDecryptionThoroughlyChecked = true;
     }
@@ -412,12 +433,22 @@ bool CCryptoKeyStore::GetKey(const CKeyID &address, CKey& keyOut) const
         if (!IsCrypted())
             return CBasicKeyStore::GetKey(address, keyOut);
 
+        KeyMap::const_iterator ku = mapUnlockedKeys.find(address);
+        if (ku != mapUnlockedKeys.end())
+        {
+            keyOut = (*ku).second;
+            return true;
+        }
+
         CryptedKeyMap::const_iterator mi = mapCryptedKeys.find(address);
         if (mi != mapCryptedKeys.end())
         {
             const CPubKey &vchPubKey = (*mi).second.first;
             const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
-            return DecryptKey(vMasterKey, vchCryptedSecret, vchPubKey, keyOut);
+            if (!DecryptKey(vMasterKey, vchCryptedSecret, vchPubKey, keyOut))
+                return false;
+            mapUnlockedKeys[address] = keyOut;
+            return true;
         }
     }
     return false;
@@ -96,6 +96,8 @@ public:
             CBaseDataStream(vchIn, nTypeIn, nVersionIn) { }
 };
 
+struct evp_cipher_ctx_st;
+
 /** Encryption/decryption context with key information */
 class CCrypter
 {
@@ -103,6 +105,9 @@ private:
     unsigned char chKey[WALLET_CRYPTO_KEY_SIZE];
     unsigned char chIV[WALLET_CRYPTO_KEY_SIZE];
     bool fKeySet;
+    //! reusable cipher context, created on first use and kept for the
+    //! lifetime of the crypter so each operation skips the EVP allocation
+    struct evp_cipher_ctx_st* pCipherCtx;
 
 public:
     bool SetKeyFromPassphrase(const SecureString &strKeyData, const std::vector<unsigned char>& chSalt, const unsigned int nRounds, const unsigned int nDerivationMethod);
@@ -120,6 +125,7 @@ public:
     CCrypter()
     {
         fKeySet = false;
+        pCipherCtx = NULL;
 
         // Try to keep the key data out of swap (and be a bit over-careful to keep the IV that we don't even use out of swap)
         // Note that this does nothing about suspend-to-disk (which will put all our key data on disk)
@@ -128,13 +134,8 @@ public:
         LockedPageManager::Instance().LockRange(&chIV[0], sizeof chIV);
     }
 
-    ~CCrypter()
-    {
-        CleanKey();
-
-        LockedPageManager::Instance().UnlockRange(&chKey[0], sizeof chKey);
-        LockedPageManager::Instance().UnlockRange(&chIV[0], sizeof chIV);
-    }
+    //! defined in crypter.cpp, where the cipher context can be freed
+    ~CCrypter();
 };
 
 /** Keystore which keeps the private keys encrypted.
@@ -150,6 +151,11 @@ private:
 
     CKeyingMaterial vMasterKey;
 
+    //! Plaintext copies of the crypted keys, kept only while the wallet is
+    //! unlocked so per-signature key access is a map lookup instead of an
+    //! AES decryption. CKey memlocks its own key bytes. Guarded by cs_KeyStore.
+    mutable KeyMap mapUnlockedKeys;
+
     //! if fUseCrypto is true, mapKeys, mapSproutSpendingKeys, and mapSaplingSpendingKeys must be empty
     //! if fUseCrypto is false, vMasterKey must be empty
     bool fUseCrypto;
@@ -28,6 +28,7 @@
 #include "netbase.h"
 #include "rpc/server.h"
 #include "timedata.h"
+#include "tokensdb.h"
 #include "transaction_builder.h"
 #include "util.h"
 #include "utilmoneystr.h"
@@ -1854,15 +1855,19 @@ UniValue listtransactions(const UniValue& params, bool fHelp, const CPubKey& myp
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
-    if (fHelp || params.size() > 4)
+    if (fHelp || params.size() > 5)
         throw runtime_error(
-            "listtransactions ( \"account\" count from includeWatchonly)\n"
+            "listtransactions ( \"account\" count from includeWatchonly cursor)\n"
             "\nReturns up to 'count' most recent transactions skipping the first 'from' transactions for account 'account'.\n"
             "\nArguments:\n"
             "1. \"account\"    (string, optional) DEPRECATED. The account name. Should be \"*\".\n"
             "2. count          (numeric, optional, default=10) The number of transactions to return\n"
             "3. from           (numeric, optional, default=0) The number of transactions to skip\n"
             "4. includeWatchonly (bool, optional, default=false) Include transactions to watchonly addresses (see 'importaddress')\n"
+            "5. cursor         (numeric, optional) Page through the wallet newest to oldest: pass -1 for the\n"
+            "                   first page, then the \"cursor\" value from the previous reply. When given, 'from'\n"
+            "                   is ignored and the reply is an object {\"transactions\":[...],\"cursor\":n,\"done\":bool}\n"
+            "                   so large wallets can be walked without materializing the skipped entries\n"
             "\nResult:\n"
             "[\n"
             "  {\n"
@@ -1922,6 +1927,12 @@ UniValue listtransactions(const UniValue& params, bool fHelp, const CPubKey& myp
     if(params.size() > 3)
         if(params[3].get_bool())
             filter = filter | ISMINE_WATCH_ONLY;
+    bool fPaged = false;
+    int64_t nCursor = -1;
+    if (params.size() > 4) {
+        fPaged = true;
+        nCursor = params[4].get_int64();
+    }
 
     if (nCount < 0)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
@@ -1933,6 +1944,46 @@ UniValue listtransactions(const UniValue& params, bool fHelp, const CPubKey& myp
     std::list<CAccountingEntry> acentries;
     CWallet::TxItems txOrdered = pwalletMain->OrderedTxItems(acentries, strAccount);
 
+    if (fPaged)
+    {
+        // Cursor pagination: emit entries with an order position strictly
+        // below the cursor, so each page only materializes its own entries
+        // no matter how deep into the wallet the walk has gotten
+        int64_t nLastPos = -1;
+        bool fDone = true;
+        for (CWallet::TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
+        {
+            if (nCursor >= 0 && (*it).first >= nCursor)
+                continue;
+            // A transaction can expand to several entries which must not be
+            // split across pages (the cursor is per order position), so
+            // check the page size before expanding, not after
+            if ((int)ret.size() >= nCount) {
+                fDone = false;
+                break;
+            }
+            CWalletTx *const pwtx = (*it).second.first;
+            if (pwtx != 0)
+                ListTransactions(*pwtx, strAccount, 0, true, ret, filter);
+            CAccountingEntry *const pacentry = (*it).second.second;
+            if (pacentry != 0)
+                AcentryToJSON(*pacentry, strAccount, ret);
+            nLastPos = (*it).first;
+        }
+
+        // Keep the oldest-to-newest order of the unpaged call within a page
+        vector<UniValue> arrTmp = ret.getValues();
+        std::reverse(arrTmp.begin(), arrTmp.end());
+        UniValue page(UniValue::VARR);
+        page.push_backV(arrTmp);
+
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("transactions", page));
+        result.push_back(Pair("cursor", nLastPos));
+        result.push_back(Pair("done", fDone));
+        return result;
+    }
+
     // iterate backwards until we have nCount items to return:
     for (CWallet::TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
     {
@@ -2720,12 +2771,29 @@ UniValue getwalletinfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
             "  \"unlocked_until\": ttt,      (numeric) the timestamp in seconds since epoch (midnight Jan 1 1970 GMT) that the wallet is unlocked for transfers, or 0 if the wallet is locked\n"
             "  \"paytxfee\": x.xxxx,         (numeric) the transaction fee configuration, set in " + CURRENCY_UNIT + "/kB\n"
             "  \"seedfp\": \"uint256\",        (string) the BLAKE2b-256 hash of the HD seed\n"
+            "  \"rescanning\": true|false,   (boolean) whether a wallet rescan is in progress; if so only rescan fields are returned\n"
+            "  \"rescan_height\": xxxxxx,    (numeric, optional) the block height the rescan is currently at\n"
+            "  \"rescan_progress\": x.xxxx,  (numeric, optional) fraction of the rescan completed\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getwalletinfo", "")
             + HelpExampleRpc("getwalletinfo", "")
         );
 
+    // A rescan holds cs_wallet for its whole duration, so report its
+    // progress without taking the locks instead of blocking until it is done
+    int nRescanHeight = pwalletMain->nRescanHeight.load();
+    if (nRescanHeight >= 0) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("rescanning", true));
+        obj.push_back(Pair("rescan_height", nRescanHeight));
+        int nStart = pwalletMain->nRescanStartHeight.load();
+        int nTip = pwalletMain->nRescanTipHeight.load();
+        if (nTip > nStart)
+            obj.push_back(Pair("rescan_progress", (double)(nRescanHeight - nStart) / (double)(nTip - nStart)));
+        return obj;
+    }
+
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
     UniValue obj(UniValue::VOBJ);
@@ -2742,6 +2810,7 @@ UniValue getwalletinfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
     uint256 seedFp = pwalletMain->GetHDChain().seedFp;
     if (!seedFp.IsNull())
          obj.push_back(Pair("seedfp", seedFp.GetHex()));
+    obj.push_back(Pair("rescanning", false));
     return obj;
 }
 
@@ -2775,9 +2844,9 @@ UniValue listunspent(const UniValue& params, bool fHelp, const CPubKey& mypk)
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
-    if (fHelp || params.size() > 3)
+    if (fHelp || params.size() > 5)
         throw runtime_error(
-            "listunspent ( minconf maxconf  [\"address\",...] )\n"
+            "listunspent ( minconf maxconf  [\"address\",...] count \"cursor\" )\n"
             "\nReturns array of unspent transaction outputs\n"
             "with between minconf and maxconf (inclusive) confirmations.\n"
             "Optionally filter to only include txouts paid to specified addresses.\n"
@@ -2791,6 +2860,9 @@ UniValue listunspent(const UniValue& params, bool fHelp, const CPubKey& mypk)
             "      \"address\"   (string) " + chainName.ToString() + " address\n"
             "      ,...\n"
             "    ]\n"
+            "4. count            (numeric, optional, default=0) If positive, return at most this many outputs per call\n"
+            "                     and wrap the reply in an object {\"unspent\":[...],\"cursor\":\"txid:vout\",\"done\":bool}\n"
+            "5. \"cursor\"       (string, optional) The \"cursor\" value from the previous reply; resume after that output\n"
             "\nResult\n"
             "[                   (array of json object)\n"
             "  {\n"
@@ -2814,7 +2886,7 @@ UniValue listunspent(const UniValue& params, bool fHelp, const CPubKey& mypk)
             + HelpExampleRpc("listunspent", "6, 9999999 \"[\\\"RD6GgnrMpPaTSMn8vai6yiGA7mN4QGPV\\\",\\\"RD6GgnrMpPaTSMn8vai6yiGA7mN4QGPV\\\"]\"")
         );
 
-    RPCTypeCheck(params, boost::assign::list_of(UniValue::VNUM)(UniValue::VNUM)(UniValue::VARR));
+    RPCTypeCheck(params, boost::assign::list_of(UniValue::VNUM)(UniValue::VNUM)(UniValue::VARR)(UniValue::VNUM)(UniValue::VSTR));
 
     int nMinDepth = 1;
     if (params.size() > 0)
@@ -2824,6 +2896,23 @@ UniValue listunspent(const UniValue& params, bool fHelp, const CPubKey& mypk)
     if (params.size() > 1)
         nMaxDepth = params[1].get_int();
 
+    int nPageSize = 0;
+    if (params.size() > 3)
+        nPageSize = params[3].get_int();
+
+    uint256 cursorTxid;
+    int nCursorVout = -1;
+    bool fHaveCursor = false;
+    if (params.size() > 4) {
+        std::string strCursor = params[4].get_str();
+        size_t sep = strCursor.find(':');
+        if (sep == std::string::npos)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "cursor must be of the form \"txid:vout\"");
+        cursorTxid.SetHex(strCursor.substr(0, sep));
+        nCursorVout = atoi(strCursor.substr(sep + 1).c_str());
+        fHaveCursor = true;
+    }
+
     std::set<CTxDestination> destinations;
     if (params.size() > 2) {
         UniValue inputs = params[2].get_array();
@@ -2844,7 +2933,21 @@ UniValue listunspent(const UniValue& params, bool fHelp, const CPubKey& mypk)
     assert(pwalletMain != NULL);
     LOCK2(cs_main, pwalletMain->cs_wallet);
     pwalletMain->AvailableCoins(vecOutputs, false, NULL, true);
+    bool fDone = true;
+    std::string strLastKey;
     BOOST_FOREACH(const COutput& out, vecOutputs) {
+        // AvailableCoins walks the unspent index in ascending (txid, vout)
+        // order, so a cursor can resume by key comparison instead of
+        // counting past everything already returned
+        if (fHaveCursor) {
+            const uint256& txid = out.tx->GetHash();
+            if (txid < cursorTxid || (txid == cursorTxid && out.i <= nCursorVout))
+                continue;
+        }
+        if (nPageSize > 0 && (int)results.size() >= nPageSize) {
+            fDone = false;
+            break;
+        }
         int nDepth    = out.tx->GetDepthInMainChain();
         if( nMinDepth > 1 ) {
             int nHeight    = tx_height(out.tx->GetHash());
@@ -2904,6 +3007,16 @@ UniValue listunspent(const UniValue& params, bool fHelp, const CPubKey& mypk)
         entry.push_back(Pair("confirmations",komodo_dpowconfs(txheight,out.nDepth)));
         entry.push_back(Pair("spendable", out.fSpendable));
         results.push_back(entry);
+        strLastKey = strprintf("%s:%d", out.tx->GetHash().GetHex(), out.i);
+    }
+
+    if (nPageSize > 0) {
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("unspent", results));
+        if (!strLastKey.empty())
+            result.push_back(Pair("cursor", strLastKey));
+        result.push_back(Pair("done", fDone));
+        return result;
     }
     return results;
 }
@@ -3303,6 +3416,13 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp, const CPubKey& mypk)
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
             }
             sample_times.push_back(benchmark_connectblock_slow());
+        } else if (benchmarktype == "connectblockrange") {
+            // Number of recent blocks to replay through ConnectBlock
+            int nBlocks = 100;
+            if (params.size() >= 3) {
+                nBlocks = params[2].get_int();
+            }
+            sample_times.push_back(benchmark_connectblock_range(nBlocks));
         } else if (benchmarktype == "sendtoaddress") {
             if (Params().NetworkIDString() != "regtest") {
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
@@ -3815,6 +3935,12 @@ CAmount getBalanceTaddr(std::string transparentAddress, int minDepth=1, bool ign
 }
 
 CAmount getBalanceZaddr(std::string address, int minDepth = 1, bool ignoreUnspendable=true) {
+    // The all-addresses walk behind z_gettotalbalance is the common caller
+    // (monitoring polls it); serve it from the wallet's cached aggregate
+    if (address.empty() && minDepth == 1 && ignoreUnspendable) {
+        return pwalletMain->GetShieldedBalance();
+    }
+
     CAmount balance = 0;
     std::vector<CSproutNotePlaintextEntry> sproutEntries;
     std::vector<SaplingNoteEntry> saplingEntries;
@@ -6799,15 +6925,29 @@ UniValue oraclessample(const UniValue& params, bool fHelp, const CPubKey& mypk)
 
 UniValue oraclessamples(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
-    UniValue result(UniValue::VOBJ); uint256 txid; int32_t num; char *batonaddr;
-    if ( fHelp || params.size() != 3 )
-        throw runtime_error("oraclessamples oracletxid batonaddress num\n");
+    UniValue result(UniValue::VOBJ); uint256 txid; int32_t num; char *batonaddr; std::string cursor;
+    if ( fHelp || params.size() < 3 || params.size() > 4 )
+        throw runtime_error("oraclessamples oracletxid batonaddress num [cursor]\n");
     if ( ensure_CCrequirements(EVAL_ORACLES) < 0 )
         throw runtime_error(CC_REQUIREMENTS_MSG);
     txid = Parseuint256((char *)params[0].get_str().c_str());
     batonaddr = (char *)params[1].get_str().c_str();
     num = atoi((char *)params[2].get_str().c_str());
-    return(OracleDataSamples(txid,batonaddr,num));
+    if ( params.size() == 4 )
+        cursor = params[3].get_str();
+    return(OracleDataSamples(txid,batonaddr,num,cursor));
+}
+
+UniValue oracleslatest(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    UniValue result(UniValue::VOBJ); uint256 txid; char *batonaddr;
+    if ( fHelp || params.size() != 2 )
+        throw runtime_error("oracleslatest oracletxid batonaddress\n");
+    if ( ensure_CCrequirements(EVAL_ORACLES) < 0 )
+        throw runtime_error(CC_REQUIREMENTS_MSG);
+    txid = Parseuint256((char *)params[0].get_str().c_str());
+    batonaddr = (char *)params[1].get_str().c_str();
+    return(OracleLatestSample(txid,batonaddr));
 }
 
 UniValue oraclesdata(const UniValue& params, bool fHelp, const CPubKey& mypk)
@@ -7276,6 +7416,51 @@ UniValue tokenbalance(const UniValue& params, bool fHelp, const CPubKey& mypk)
     return(result);
 }
 
+UniValue tokenbalancebatch(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "tokenbalancebatch '[{\"tokenid\":\"id\",\"address\":\"ccaddress\"},...]'\n"
+            "\nReads token balances from the -tokenindex database in one call,\n"
+            "without rescanning the CC address UTXO set per balance.\n"
+            "\nArguments:\n"
+            "1. queries      (array, required) Array of objects with tokenid and CC address\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"tokenid\" : \"id\",        (string)\n"
+            "    \"address\" : \"ccaddress\", (string)\n"
+            "    \"balance\" : n            (numeric) indexed balance in token satoshis\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("tokenbalancebatch", "'[{\"tokenid\":\"f7a...\",\"address\":\"RTok...\"}]'")
+        );
+
+    if (!fTokenIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "tokenbalancebatch requires -tokenindex");
+
+    UniValue queries = params[0].get_array();
+    UniValue result(UniValue::VARR);
+    for (size_t i = 0; i < queries.size(); i++) {
+        const UniValue& query = queries[i];
+        uint256 tokenid = Parseuint256((char *)query["tokenid"].get_str().c_str());
+        std::string address = query["address"].get_str();
+        if (tokenid.IsNull())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid tokenid");
+
+        int64_t balance = 0;
+        GetTokenIndexBalance(tokenid, address, balance);
+
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("tokenid", query["tokenid"].get_str()));
+        entry.push_back(Pair("address", address));
+        entry.push_back(Pair("balance", balance));
+        result.push_back(entry);
+    }
+    return result;
+}
+
 UniValue tokencreate(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     UniValue result(UniValue::VOBJ);
@@ -46,6 +46,9 @@
 #include "komodo_globals.h"
 
 #include <assert.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
@@ -144,14 +147,22 @@ SaplingPaymentAddress CWallet::GenerateNewSaplingZKey()
     if (!GetHDSeed(seed))
         throw std::runtime_error("CWallet::GenerateNewSaplingZKey(): HD seed not found");
 
-    auto m = libzcash::SaplingExtendedSpendingKey::Master(seed);
     uint32_t bip44CoinType = Params().BIP44CoinType();
 
-    // We use a fixed keypath scheme of m/32'/coin_type'/account'
-    // Derive m/32'
-    auto m_32h = m.Derive(32 | ZIP32_HARDENED_KEY_LIMIT);
-    // Derive m/32'/coin_type'
-    auto m_32h_cth = m_32h.Derive(bip44CoinType | ZIP32_HARDENED_KEY_LIMIT);
+    // We use a fixed keypath scheme of m/32'/coin_type'/account'. The two
+    // upper levels are the same for every key from this seed, so derive
+    // them once and only re-derive the account level per key.
+    libzcash::SaplingExtendedSpendingKey m_32h_cth;
+    if (cachedSaplingParentKey && cachedSaplingParentKey->first == hdChain.seedFp) {
+        m_32h_cth = cachedSaplingParentKey->second;
+    } else {
+        auto m = libzcash::SaplingExtendedSpendingKey::Master(seed);
+        // Derive m/32'
+        auto m_32h = m.Derive(32 | ZIP32_HARDENED_KEY_LIMIT);
+        // Derive m/32'/coin_type'
+        m_32h_cth = m_32h.Derive(bip44CoinType | ZIP32_HARDENED_KEY_LIMIT);
+        cachedSaplingParentKey = std::make_pair(hdChain.seedFp, m_32h_cth);
+    }
 
     // Derive account key at next index, skip keys already known to the wallet
     libzcash::SaplingExtendedSpendingKey xsk;
@@ -250,7 +261,7 @@ bool CWallet::AddSproutZKey(const libzcash::SproutSpendingKey &key)
     return true;
 }
 
-CPubKey CWallet::GenerateNewKey()
+CPubKey CWallet::GenerateNewKey(CWalletDB* pwalletdb)
 {
     AssertLockHeld(cs_wallet); // mapKeyMetadata
     bool fCompressed = CanSupportFeature(FEATURE_COMPRPUBKEY); // default to compressed public keys if we want 0.6.0 wallets
@@ -271,12 +282,17 @@ CPubKey CWallet::GenerateNewKey()
     if (!nTimeFirstKey || nCreationTime < nTimeFirstKey)
         nTimeFirstKey = nCreationTime;
 
-    if (!AddKeyPubKey(secret, pubkey))
+    if (!AddKeyPubKeyWithDB(pwalletdb, secret, pubkey))
         throw std::runtime_error("CWallet::GenerateNewKey(): AddKey failed");
     return pubkey;
 }
 
 bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
+{
+    return AddKeyPubKeyWithDB(NULL, secret, pubkey);
+}
+
+bool CWallet::AddKeyPubKeyWithDB(CWalletDB* pwalletdb, const CKey& secret, const CPubKey &pubkey)
 {
     AssertLockHeld(cs_wallet); // mapKeyMetadata
     if (!CCryptoKeyStore::AddKeyPubKey(secret, pubkey))
@@ -291,6 +307,12 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
     if (!fFileBacked)
         return true;
     if (!IsCrypted()) {
+        // Write through the caller's database handle when one is supplied,
+        // so bulk key generation can share a single transaction
+        if (pwalletdb)
+            return pwalletdb->WriteKey(pubkey,
+                                       secret.GetPrivKey(),
+                                       mapKeyMetadata[pubkey.GetID()]);
         return CWalletDB(strWalletFile).WriteKey(pubkey,
                                                  secret.GetPrivKey(),
                                                  mapKeyMetadata[pubkey.GetID()]);
@@ -593,10 +615,22 @@ void CWallet::ChainTip(const CBlockIndex *pindex,
         DecrementNoteWitnesses(pindex);
     }
     UpdateSaplingNullifierNoteMapForBlock(pblock);
+    {
+        // Depths, coinbase maturity and accrued interest all move with the
+        // tip, so cached balance aggregates go stale on every (dis)connect
+        LOCK(cs_wallet);
+        InvalidateBalanceCaches();
+    }
+    // Commit the wallet records batched while this block's transactions
+    // were being synced
+    FlushDBBatch();
 }
 
 void CWallet::SetBestChain(const CBlockLocator& loc)
 {
+    // Transaction records batched for the tip block must reach the database
+    // before the best-chain locator that says we have processed it
+    FlushDBBatch();
     CWalletDB walletdb(strWalletFile);
     SetBestChainINTERNAL(walletdb, loc);
 }
@@ -774,8 +808,36 @@ set<uint256> CWallet::GetConflicts(const uint256& txid) const
     return result;
 }
 
+CWalletDB* CWallet::GetBatchedWalletDB()
+{
+    AssertLockHeld(cs_wallet);
+    if (!pwalletdbBatch && fFileBacked) {
+        // Do not flush the wallet here for performance reasons
+        CWalletDB *pdb = new CWalletDB(strWalletFile, "r+", false);
+        if (pdb->TxnBegin()) {
+            pwalletdbBatch = pdb;
+        } else {
+            // fall back to unbatched writes
+            delete pdb;
+        }
+    }
+    return pwalletdbBatch;
+}
+
+void CWallet::FlushDBBatch() const
+{
+    LOCK(cs_wallet);
+    if (pwalletdbBatch) {
+        if (!pwalletdbBatch->TxnCommit())
+            pwalletdbBatch->TxnAbort();
+        delete pwalletdbBatch;
+        pwalletdbBatch = NULL;
+    }
+}
+
 void CWallet::Flush(bool shutdown)
 {
+    FlushDBBatch();
     bitdb->Flush(shutdown);
 }
 
@@ -921,6 +983,14 @@ void CWallet::AddToTransparentSpends(const COutPoint& outpoint, const uint256& w
 {
     mapTxSpends.insert(make_pair(outpoint, wtxid));
 
+    // the outpoint is no longer a coin-selection candidate
+    TxUnspentMap::iterator itUnspent = mapWalletUnspent.find(outpoint.hash);
+    if (itUnspent != mapWalletUnspent.end()) {
+        itUnspent->second.erase(outpoint.n);
+        if (itUnspent->second.empty())
+            mapWalletUnspent.erase(itUnspent);
+    }
+
     pair<TxSpends::iterator, TxSpends::iterator> range;
     range = mapTxSpends.equal_range(outpoint);
     SyncMetaData<COutPoint>(range);
@@ -944,6 +1014,14 @@ void CWallet::AddToSaplingSpends(const uint256& nullifier, const uint256& wtxid)
     SyncMetaData<uint256>(range);
 }
 
+void CWallet::AddUnspentOutpoints(const CWalletTx& wtx)
+{
+    const uint256& hash = wtx.GetHash();
+    for (unsigned int i = 0; i < wtx.vout.size(); i++)
+        if (IsMine(wtx.vout[i]) != ISMINE_NO && !IsSpent(hash, i))
+            mapWalletUnspent[hash][i]; // creates an empty interest-cache slot
+}
+
 void CWallet::AddToSpends(const uint256& wtxid)
 {
     assert(mapWallet.count(wtxid));
@@ -1008,8 +1086,8 @@ void CopyPreviousWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nW
     }
 }
 
-template<typename NoteDataMap>
-void AppendNoteCommitment(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const uint256& note_commitment)
+template<typename NoteDataMap, typename Witness>
+void CollectWitnessesToIncrement(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, std::vector<std::pair<Witness*, size_t> >& vToIncrement)
 {
     for (auto& item : noteDataMap) {
         auto* nd = &(item.second);
@@ -1017,13 +1095,43 @@ void AppendNoteCommitment(NoteDataMap& noteDataMap, int indexHeight, int64_t nWi
             // Check the validity of the cache
             // See comment in CopyPreviousWitnesses about validity.
             assert(nWitnessCacheSize >= nd->witnesses.size());
-            nd->witnesses.front().append(note_commitment);
+            vToIncrement.push_back(std::make_pair(&nd->witnesses.front(), (size_t)0));
+        }
+    }
+}
+
+/** Advance each collected witness past the commitments it has not yet seen.
+ * Every witness is independent, so the work is sharded across worker threads
+ * once the note count justifies the spawn cost. The second member of each
+ * pair is the index of the first commitment the witness still needs. */
+template<typename Witness>
+void BatchAppendNoteCommitments(std::vector<std::pair<Witness*, size_t> >& vToIncrement, const std::vector<uint256>& vCommitments)
+{
+    if (vToIncrement.empty() || vCommitments.empty())
+        return;
+    const auto worker = [&vToIncrement, &vCommitments](size_t nBegin, size_t nEnd) {
+        for (size_t k = nBegin; k < nEnd; k++) {
+            Witness* witness = vToIncrement[k].first;
+            for (size_t c = vToIncrement[k].second; c < vCommitments.size(); c++)
+                witness->append(vCommitments[c]);
         }
+    };
+    size_t nThreads = GetNumCores();
+    if (nThreads < 2 || vToIncrement.size() < 64) {
+        worker(0, vToIncrement.size());
+        return;
     }
+    boost::thread_group threads;
+    size_t nChunk = (vToIncrement.size() + nThreads - 1) / nThreads;
+    for (size_t nBegin = 0; nBegin < vToIncrement.size(); nBegin += nChunk) {
+        size_t nEnd = std::min(nBegin + nChunk, vToIncrement.size());
+        threads.create_thread([&worker, nBegin, nEnd] { worker(nBegin, nEnd); });
+    }
+    threads.join_all();
 }
 
 template<typename OutPoint, typename NoteData, typename Witness>
-void WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const OutPoint& key, const Witness& witness)
+Witness* WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const OutPoint& key, const Witness& witness)
 {
     if (noteDataMap.count(key) && noteDataMap[key].witnessHeight < indexHeight) {
         auto* nd = &(noteDataMap[key]);
@@ -1049,7 +1157,9 @@ void WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeigh
         nd->witnessHeight = indexHeight - 1;
         // Check the validity of the cache
         assert(nWitnessCacheSize >= nd->witnesses.size());
+        return &nd->witnesses.front();
     }
+    return nullptr;
 }
 
 
@@ -1089,6 +1199,17 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
         pblock = &block;
     }
 
+    // Collect the witnesses to advance and the block's commitments once,
+    // instead of walking every wallet transaction per commitment
+    std::vector<std::pair<SproutWitness*, size_t> > vSproutToIncrement;
+    std::vector<std::pair<SaplingWitness*, size_t> > vSaplingToIncrement;
+    for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
+        ::CollectWitnessesToIncrement(wtxItem.second.mapSproutNoteData, pindex->nHeight, nWitnessCacheSize, vSproutToIncrement);
+        ::CollectWitnessesToIncrement(wtxItem.second.mapSaplingNoteData, pindex->nHeight, nWitnessCacheSize, vSaplingToIncrement);
+    }
+    std::vector<uint256> vSproutCommitments;
+    std::vector<uint256> vSaplingCommitments;
+
     for (const CTransaction& tx : pblock->vtx) {
         auto hash = tx.GetHash();
         bool txIsOurs = mapWallet.count(hash);
@@ -1098,16 +1219,16 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
             for (uint8_t j = 0; j < jsdesc.commitments.size(); j++) {
                 const uint256& note_commitment = jsdesc.commitments[j];
                 sproutTree.append(note_commitment);
+                vSproutCommitments.push_back(note_commitment);
 
-                // Increment existing witnesses
-                for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-                    ::AppendNoteCommitment(wtxItem.second.mapSproutNoteData, pindex->nHeight, nWitnessCacheSize, note_commitment);
-                }
-
-                // If this is our note, witness it
+                // If this is our note, witness it; the fresh witness still
+                // needs the commitments that follow it in this block
                 if (txIsOurs) {
                     JSOutPoint jsoutpt {hash, i, j};
-                    ::WitnessNoteIfMine(mapWallet[hash].mapSproutNoteData, pindex->nHeight, nWitnessCacheSize, jsoutpt, sproutTree.witness());
+                    SproutWitness* witness = ::WitnessNoteIfMine(mapWallet[hash].mapSproutNoteData, pindex->nHeight, nWitnessCacheSize, jsoutpt, sproutTree.witness());
+                    if (witness) {
+                        vSproutToIncrement.push_back(std::make_pair(witness, vSproutCommitments.size()));
+                    }
                 }
             }
         }
@@ -1115,20 +1236,24 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
         for (uint32_t i = 0; i < tx.vShieldedOutput.size(); i++) {
             const uint256& note_commitment = tx.vShieldedOutput[i].cm;
             saplingTree.append(note_commitment);
-
-            // Increment existing witnesses
-            for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-                ::AppendNoteCommitment(wtxItem.second.mapSaplingNoteData, pindex->nHeight, nWitnessCacheSize, note_commitment);
-            }
+            vSaplingCommitments.push_back(note_commitment);
 
             // If this is our note, witness it
             if (txIsOurs) {
                 SaplingOutPoint outPoint {hash, i};
-                ::WitnessNoteIfMine(mapWallet[hash].mapSaplingNoteData, pindex->nHeight, nWitnessCacheSize, outPoint, saplingTree.witness());
+                SaplingWitness* witness = ::WitnessNoteIfMine(mapWallet[hash].mapSaplingNoteData, pindex->nHeight, nWitnessCacheSize, outPoint, saplingTree.witness());
+                if (witness) {
+                    vSaplingToIncrement.push_back(std::make_pair(witness, vSaplingCommitments.size()));
+                }
             }
         }
     }
 
+    // Advance all witnesses in one batched (and, for large wallets,
+    // parallel) pass over the block's commitments
+    ::BatchAppendNoteCommitments(vSproutToIncrement, vSproutCommitments);
+    ::BatchAppendNoteCommitments(vSaplingToIncrement, vSaplingCommitments);
+
     // Update witness heights
     for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
         ::UpdateWitnessHeights(wtxItem.second.mapSproutNoteData, pindex->nHeight, nWitnessCacheSize);
@@ -1347,11 +1472,19 @@ void CWallet::MarkDirty()
 {
     {
         LOCK(cs_wallet);
+        InvalidateBalanceCaches();
         BOOST_FOREACH(PAIRTYPE(const uint256, CWalletTx)& item, mapWallet)
             item.second.MarkDirty();
     }
 }
 
+void CWallet::InvalidateBalanceCaches() const
+{
+    AssertLockHeld(cs_wallet);
+    fBalanceCached = false;
+    fShieldedBalanceCached = false;
+}
+
 /**
  * Ensure that every note in the wallet (for which we possess a spending key)
  * has a cached nullifier.
@@ -1485,10 +1618,12 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
         mapWallet[hash].BindWallet(this);
         UpdateNullifierNoteMapWithTx(mapWallet[hash]);
         AddToSpends(hash);
+        AddUnspentOutpoints(mapWallet[hash]);
     }
     else
     {
         LOCK(cs_wallet);
+        InvalidateBalanceCaches();
         // Inserts only if not already there, returns tx inserted or tx found
         pair<map<uint256, CWalletTx>::iterator, bool> ret = mapWallet.insert(make_pair(hash, wtxIn));
         CWalletTx& wtx = (*ret.first).second;
@@ -1546,6 +1681,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
                              wtxIn.hashBlock.ToString());
             }
             AddToSpends(hash);
+            AddUnspentOutpoints(wtx);
         }
 
         bool fUpdated = false;
@@ -1719,6 +1855,13 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
 
             // Do not flush the wallet here for performance reasons
             // this is safe, as in case of a crash, we rescan the necessary blocks on startup through our SetBestChain-mechanism
+            if (pblock) {
+                // Coalesce the writes for a block's transactions into one db
+                // transaction; ChainTip commits it once the block is synced
+                CWalletDB* pbatchdb = GetBatchedWalletDB();
+                if (pbatchdb)
+                    return AddToWallet(wtx, false, pbatchdb);
+            }
             CWalletDB walletdb(strWalletFile, "r+", false);
 
             return AddToWallet(wtx, false, &walletdb);
@@ -1736,6 +1879,17 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
     MarkAffectedTransactionsDirty(tx);
 }
 
+void CWallet::SyncBlockTransactions(const std::vector<CTransaction>& vtx, const CBlock* pblock)
+{
+    // One cs_wallet acquisition for the whole block; the individual records
+    // go into the walletdb batch that ChainTip commits once the block is in
+    LOCK(cs_wallet);
+    for (const CTransaction& tx : vtx) {
+        if (AddToWalletIfInvolvingMe(tx, pblock, true))
+            MarkAffectedTransactionsDirty(tx);
+    }
+}
+
 void CWallet::MarkAffectedTransactionsDirty(const CTransaction& tx)
 {
     // If a transaction changes 'conflicted' state, that changes the balance
@@ -1770,6 +1924,8 @@ void CWallet::EraseFromWallet(const uint256 &hash)
         return;
     {
         LOCK(cs_wallet);
+        InvalidateBalanceCaches();
+        mapWalletUnspent.erase(hash);
         if (mapWallet.erase(hash))
             CWalletDB(strWalletFile).EraseTx(hash);
     }
@@ -1816,6 +1972,31 @@ boost::optional<uint256> CWallet::GetSproutNoteNullifier(const JSDescription &js
     return ret;
 }
 
+/** Run func(i) for each index in [0, nTasks). Trial decryption of distinct
+ * outputs is embarrassingly parallel, so the indices are sharded across
+ * worker threads when the number of decrypt attempts justifies the spawn
+ * cost; small workloads stay on the calling (validation) thread. */
+template<typename Func>
+static void ForEachShieldedOutput(size_t nTasks, size_t nTrialDecrypts, const Func& func)
+{
+    size_t nThreads = GetNumCores();
+    if (nThreads < 2 || nTasks < 2 || nTrialDecrypts < 8) {
+        for (size_t i = 0; i < nTasks; i++)
+            func(i);
+        return;
+    }
+    std::atomic<size_t> nNext(0);
+    boost::thread_group threads;
+    for (size_t t = std::min(nThreads, nTasks); t > 0; t--) {
+        threads.create_thread([&] {
+            size_t i;
+            while ((i = nNext.fetch_add(1)) < nTasks)
+                func(i);
+        });
+    }
+    threads.join_all();
+}
+
 /**
  * Finds all output notes in the given transaction that have been sent to
  * PaymentAddresses in this wallet.
@@ -1829,36 +2010,51 @@ mapSproutNoteData_t CWallet::FindMySproutNotes(const CTransaction &tx) const
     LOCK(cs_SpendingKeyStore);
     uint256 hash = tx.GetHash();
 
-    mapSproutNoteData_t noteData;
+    // Flatten the ciphertexts into one task list, computing each
+    // joinsplit's h_sig once up front
+    std::vector<std::pair<size_t, uint8_t> > vTasks;
+    std::vector<uint256> vhSig(tx.vjoinsplit.size());
     for (size_t i = 0; i < tx.vjoinsplit.size(); i++) {
-        auto hSig = tx.vjoinsplit[i].h_sig(*pzcashParams, tx.joinSplitPubKey);
+        vhSig[i] = tx.vjoinsplit[i].h_sig(*pzcashParams, tx.joinSplitPubKey);
         for (uint8_t j = 0; j < tx.vjoinsplit[i].ciphertexts.size(); j++) {
-            for (const NoteDecryptorMap::value_type& item : mapNoteDecryptors) {
-                try {
-                    auto address = item.first;
-                    JSOutPoint jsoutpt {hash, i, j};
-                    auto nullifier = GetSproutNoteNullifier(
-                        tx.vjoinsplit[i],
-                        address,
-                        item.second,
-                        hSig, j);
-                    if (nullifier) {
-                        SproutNoteData nd {address, *nullifier};
-                        noteData.insert(std::make_pair(jsoutpt, nd));
-                    } else {
-                        SproutNoteData nd {address};
-                        noteData.insert(std::make_pair(jsoutpt, nd));
-                    }
-                    break;
-                } catch (const note_decryption_failed &err) {
-                    // Couldn't decrypt with this decryptor
-                } catch (const std::exception &exc) {
-                    // Unexpected failure
-                    LogPrintf("FindMySproutNotes(): Unexpected error while testing decrypt:\n");
-                    LogPrintf("%s\n", exc.what());
+            vTasks.push_back(std::make_pair(i, j));
+        }
+    }
+
+    std::vector<boost::optional<SproutNoteData>> vFound(vTasks.size());
+    ::ForEachShieldedOutput(vTasks.size(), vTasks.size() * mapNoteDecryptors.size(), [&](size_t k) {
+        size_t i = vTasks[k].first;
+        uint8_t j = vTasks[k].second;
+        for (const NoteDecryptorMap::value_type& item : mapNoteDecryptors) {
+            try {
+                auto address = item.first;
+                auto nullifier = GetSproutNoteNullifier(
+                    tx.vjoinsplit[i],
+                    address,
+                    item.second,
+                    vhSig[i], j);
+                if (nullifier) {
+                    vFound[k] = SproutNoteData {address, *nullifier};
+                } else {
+                    vFound[k] = SproutNoteData {address};
                 }
+                break;
+            } catch (const note_decryption_failed &err) {
+                // Couldn't decrypt with this decryptor
+            } catch (const std::exception &exc) {
+                // Unexpected failure
+                LogPrintf("FindMySproutNotes(): Unexpected error while testing decrypt:\n");
+                LogPrintf("%s\n", exc.what());
             }
         }
+    });
+
+    mapSproutNoteData_t noteData;
+    for (size_t k = 0; k < vTasks.size(); k++) {
+        if (vFound[k]) {
+            JSOutPoint jsoutpt {hash, vTasks[k].first, vTasks[k].second};
+            noteData.insert(std::make_pair(jsoutpt, *vFound[k]));
+        }
     }
     return noteData;
 }
@@ -1880,44 +2076,50 @@ std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> CWallet::FindMySap
     mapSaplingNoteData_t noteData;
     SaplingIncomingViewingKeyMap viewingKeysToAdd;
 
+    uint32_t nOutputs = (uint32_t)tx.vShieldedOutput.size();
+    size_t nKeys = mapSaplingFullViewingKeys.size() + mapSaplingIncomingViewingKeys.size();
+    std::vector<boost::optional<SaplingIncomingViewingKey>> vFound(nOutputs);
+    std::vector<boost::optional<SaplingPaymentAddress>> vAddressToAdd(nOutputs);
+
     // Protocol Spec: 4.19 Block Chain Scanning (Sapling)
-    for (uint32_t i = 0; i < tx.vShieldedOutput.size(); ++i) {
+    ::ForEachShieldedOutput(nOutputs, nOutputs * nKeys, [&](size_t i) {
         const OutputDescription output = tx.vShieldedOutput[i];
-        bool found = false;
         for (auto it = mapSaplingFullViewingKeys.begin(); it != mapSaplingFullViewingKeys.end(); ++it) {
             SaplingIncomingViewingKey ivk = it->first;
             auto result = SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cm);
             if (result) {
                 auto address = ivk.address(result.get().d);
                 if (address && mapSaplingIncomingViewingKeys.count(address.get()) == 0) {
-                    viewingKeysToAdd[address.get()] = ivk;
+                    vAddressToAdd[i] = address.get();
                 }
-                // We don't cache the nullifier here as computing it requires knowledge of the note position
-                // in the commitment tree, which can only be determined when the transaction has been mined.
-                SaplingOutPoint op {hash, i};
-                SaplingNoteData nd;
-                nd.ivk = ivk;
-                noteData.insert(std::make_pair(op, nd));
-                found = true;
-                break;
+                vFound[i] = ivk;
+                return;
             }
         }
-        if (!found) {
-            for (auto it = mapSaplingIncomingViewingKeys.begin(); it != mapSaplingIncomingViewingKeys.end(); ++it) {
-                SaplingIncomingViewingKey ivk = it-> second;
-                auto result = SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cm);
-                if (!result) {
-                    continue;
-                }
-                // We don't cache the nullifier here as computing it requires knowledge of the note position
-                // in the commitment tree, which can only be determined when the transaction has been mined.
-                SaplingOutPoint op {hash, i};
-                SaplingNoteData nd;
-                nd.ivk = ivk;
-                noteData.insert(std::make_pair(op, nd));
-                break;
+        for (auto it = mapSaplingIncomingViewingKeys.begin(); it != mapSaplingIncomingViewingKeys.end(); ++it) {
+            SaplingIncomingViewingKey ivk = it-> second;
+            auto result = SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cm);
+            if (!result) {
+                continue;
             }
+            vFound[i] = ivk;
+            return;
         }
+    });
+
+    for (uint32_t i = 0; i < nOutputs; ++i) {
+        if (!vFound[i]) {
+            continue;
+        }
+        if (vAddressToAdd[i]) {
+            viewingKeysToAdd[*vAddressToAdd[i]] = *vFound[i];
+        }
+        // We don't cache the nullifier here as computing it requires knowledge of the note position
+        // in the commitment tree, which can only be determined when the transaction has been mined.
+        SaplingOutPoint op {hash, i};
+        SaplingNoteData nd;
+        nd.ivk = *vFound[i];
+        noteData.insert(std::make_pair(op, nd));
     }
 
     return std::make_pair(noteData, viewingKeysToAdd);
@@ -2729,6 +2931,87 @@ void CWallet::WitnessNoteCommitment(std::vector<uint256> commitments,
     }
 }
 
+/** Number of blocks rescan reader threads keep decoded ahead of the scan position */
+static const size_t RESCAN_READAHEAD = 32;
+
+/**
+ * Reads and deserializes chunks of blocks on background threads during a
+ * rescan. The scan itself has to consume blocks in chain order (witness
+ * caches and spend tracking depend on it), but the disk reads and block
+ * deserialization dominate rescan time on an archive node and are
+ * independent per block, so a few readers keep a bounded window of decoded
+ * blocks ready ahead of the consumer. Readers only touch block files and
+ * need no chain or wallet locks.
+ */
+class CRescanBlockReader
+{
+public:
+    CRescanBlockReader(const std::vector<CBlockIndex*>& vChainIn) : vChain(vChainIn)
+    {
+        // Disk-bound work; a handful of readers is enough to keep the scan fed
+        int nThreads = std::max(1, std::min(4, GetNumCores()));
+        for (int t = 0; t < nThreads; t++)
+            threads.create_thread([this] { ReadLoop(); });
+    }
+
+    ~CRescanBlockReader()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            fAbort = true;
+        }
+        condRead.notify_all();
+        threads.join_all();
+    }
+
+    //! Deliver the block at chain offset n, blocking until a reader has it.
+    //! Must be called for every offset in increasing order.
+    void Take(size_t n, CBlock& block)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        nConsume = n;
+        condRead.notify_all();
+        std::map<size_t, CBlock>::iterator it;
+        while ((it = mapBlocks.find(n)) == mapBlocks.end())
+            condReady.wait(lock);
+        block = std::move(it->second);
+        mapBlocks.erase(it);
+    }
+
+private:
+    void ReadLoop()
+    {
+        while (true) {
+            size_t n;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (!fAbort && nRead < vChain.size() && nRead >= nConsume + RESCAN_READAHEAD)
+                    condRead.wait(lock);
+                if (fAbort || nRead >= vChain.size())
+                    return;
+                n = nRead++;
+            }
+            CBlock block;
+            ReadBlockFromDisk(block, vChain[n], 1);
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                mapBlocks[n] = std::move(block);
+            }
+            condReady.notify_all();
+        }
+    }
+
+    const std::vector<CBlockIndex*>& vChain;
+    boost::thread_group threads;
+    std::mutex mutex;
+    std::condition_variable condRead;     //!< wakes readers when the window advances
+    std::condition_variable condReady;    //!< wakes the consumer when a block lands
+    std::map<size_t, CBlock> mapBlocks;   //!< decoded blocks not yet consumed
+    size_t nRead = 0;                     //!< next chain offset to hand to a reader
+    size_t nConsume = 0;                  //!< offset the consumer is waiting on
+    bool fAbort = false;
+};
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
@@ -2755,13 +3038,27 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
         double dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
         double dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
-        while (pindex)
+
+        // Collect the remaining chain up front so reader threads can fetch
+        // and deserialize blocks ahead of the scan position
+        std::vector<CBlockIndex*> vChain;
+        for (CBlockIndex* p = pindex; p != NULL; p = chainActive.Next(p))
+            vChain.push_back(p);
+        CRescanBlockReader reader(vChain);
+
+        if (!vChain.empty()) {
+            nRescanStartHeight = vChain.front()->nHeight;
+            nRescanTipHeight = vChain.back()->nHeight;
+        }
+        for (size_t nOffset = 0; nOffset < vChain.size(); nOffset++)
         {
+            pindex = vChain[nOffset];
+            nRescanHeight = pindex->nHeight;
             if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
                 ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
 
             CBlock block;
-            ReadBlockFromDisk(block, pindex,1);
+            reader.Take(nOffset, block);
             BOOST_FOREACH(CTransaction& tx, block.vtx)
             {
                 if (AddToWalletIfInvolvingMe(tx, &block, fUpdate)) {
@@ -2783,12 +3080,14 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
             // Increment note witness caches
             ChainTip(pindex, &block, sproutTree, saplingTree, true);
 
-            pindex = chainActive.Next(pindex);
             if (GetTime() >= nNow + 60) {
                 nNow = GetTime();
                 LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex));
             }
         }
+        nRescanHeight = -1;
+        nRescanStartHeight = -1;
+        nRescanTipHeight = -1;
 
         // After rescanning, persist Sapling note data that might have changed, e.g. nullifiers.
         // Do not flush the wallet here for performance reasons.
@@ -3159,12 +3458,44 @@ CAmount CWallet::GetBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        if (fBalanceCached)
+            return nCachedBalance;
+        // Transactions without unspent outputs of ours contribute no
+        // available credit, so only the unspent index needs to be walked
+        for (TxUnspentMap::const_iterator it = mapWalletUnspent.begin(); it != mapWalletUnspent.end(); ++it)
         {
-            const CWalletTx* pcoin = &(*it).second;
+            map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(it->first);
+            if (mi == mapWallet.end())
+                continue;
+            const CWalletTx* pcoin = &(*mi).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit();
         }
+        nCachedBalance = nTotal;
+        fBalanceCached = true;
+    }
+
+    return nTotal;
+}
+
+CAmount CWallet::GetShieldedBalance()
+{
+    CAmount nTotal = 0;
+    {
+        LOCK2(cs_main, cs_wallet);
+        if (fShieldedBalanceCached)
+            return nCachedShieldedBalance;
+        std::vector<CSproutNotePlaintextEntry> sproutEntries;
+        std::vector<SaplingNoteEntry> saplingEntries;
+        GetFilteredNotes(sproutEntries, saplingEntries, "", 1, true, true);
+        for (auto & entry : sproutEntries) {
+            nTotal += CAmount(entry.plaintext.value());
+        }
+        for (auto & entry : saplingEntries) {
+            nTotal += CAmount(entry.note.value());
+        }
+        nCachedShieldedBalance = nTotal;
+        fShieldedBalanceCached = true;
     }
 
     return nTotal;
@@ -3254,10 +3585,15 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        // Walk only transactions that still have unspent outputs of ours,
+        // instead of every transaction the wallet has ever seen
+        for (TxUnspentMap::iterator it = mapWalletUnspent.begin(); it != mapWalletUnspent.end(); ++it)
         {
             const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(wtxid);
+            if (mi == mapWallet.end())
+                continue;
+            const CWalletTx* pcoin = &(*mi).second;
 
             if (!CheckFinalTx(*pcoin))
                 continue;
@@ -3275,26 +3611,45 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
             if (nDepth < 0)
                 continue;
 
-            for (int i = 0; i < pcoin->vout.size(); i++)
+            for (std::map<unsigned int, CCachedInterest>::iterator itOut = it->second.begin(); itOut != it->second.end(); ++itOut)
             {
+                if (itOut->first >= pcoin->vout.size())
+                    continue;
+                int i = (int)itOut->first;
                 isminetype mine = IsMine(pcoin->vout[i]);
                 if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    !IsLockedCoin((*it).first, i) && (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected((*it).first, i)))
+                    !IsLockedCoin(wtxid, i) && (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
+                    (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected(wtxid, i)))
                 {
                     if ( !IS_MODE_EXCHANGEWALLET )
                     {
-                        uint32_t locktime; int32_t txheight; CBlockIndex *tipindex;
+                        CBlockIndex *tipindex;
                         if ( chainName.isKMD() && chainActive.Tip() != 0 && chainActive.Tip()->nHeight >= 60000 )
                         {
                             if ( pcoin->vout[i].nValue >= 10*COIN )
                             {
                                 if ( (tipindex= chainActive.Tip()) != 0 )
                                 {
-                                    komodo_accrued_interest(&txheight,&locktime,wtxid,i,0,pcoin->vout[i].nValue,(int32_t)tipindex->nHeight);
-                                    interest = komodo_interestnew(txheight,pcoin->vout[i].nValue,locktime,tipindex->nTime);
-                                } 
-                                else 
+                                    // interest accrues per minute, so the cached value
+                                    // stays valid until the tip time moves materially
+                                    CCachedInterest& cached = itOut->second;
+                                    if ( cached.nTipTime != 0 && tipindex->nTime >= cached.nTipTime &&
+                                         tipindex->nTime - cached.nTipTime < 60 )
+                                        interest = cached.nValue;
+                                    else
+                                    {
+                                        // the wallet already holds the tx; its height and
+                                        // locktime do not need a GetTransaction round trip
+                                        CBlockIndex *txblkindex = komodo_getblockindex(pcoin->hashBlock);
+                                        if ( txblkindex != nullptr )
+                                            interest = komodo_interestnew(txblkindex->nHeight,pcoin->vout[i].nValue,pcoin->nLockTime,tipindex->nTime);
+                                        else
+                                            interest = 0;
+                                        cached.nValue = interest;
+                                        cached.nTipTime = tipindex->nTime;
+                                    }
+                                }
+                                else
                                     interest = 0;
                                 if ( interest != 0 )
                                 {
@@ -4200,12 +4555,16 @@ bool CWallet::NewKeyPool()
             return false;
 
         int64_t nKeys = max(GetArg("-keypool", 100), (int64_t)0);
+        if (nKeys > 0 && !walletdb.TxnBegin())
+            return false;
         for (int i = 0; i < nKeys; i++)
         {
             int64_t nIndex = i+1;
-            walletdb.WritePool(nIndex, CKeyPool(GenerateNewKey()));
+            walletdb.WritePool(nIndex, CKeyPool(GenerateNewKey(&walletdb)));
             setKeyPool.insert(nIndex);
         }
+        if (nKeys > 0 && !walletdb.TxnCommit())
+            return false;
         LogPrintf("CWallet::NewKeyPool wrote %d new keys\n", nKeys);
     }
     return true;
@@ -4228,16 +4587,27 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         else
             nTargetSize = max(GetArg("-keypool", 100), (int64_t) 0);
 
+        if (setKeyPool.size() >= (nTargetSize + 1))
+            return true;
+
+        // Generate the whole batch inside one database transaction;
+        // committing each key separately dominated large keypool top-ups
+        if (!walletdb.TxnBegin())
+            throw runtime_error("TopUpKeyPool(): cannot start database transaction");
+        unsigned int nAdded = 0;
         while (setKeyPool.size() < (nTargetSize + 1))
         {
             int64_t nEnd = 1;
             if (!setKeyPool.empty())
                 nEnd = *(--setKeyPool.end()) + 1;
-            if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey())))
+            if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey(&walletdb))))
                 throw runtime_error("TopUpKeyPool(): writing generated key failed");
             setKeyPool.insert(nEnd);
-            LogPrintf("keypool added key %d, size=%u\n", nEnd, setKeyPool.size());
+            nAdded++;
         }
+        if (!walletdb.TxnCommit())
+            throw runtime_error("TopUpKeyPool(): committing generated keys failed");
+        LogPrintf("keypool added %u keys, size=%u\n", nAdded, setKeyPool.size());
     }
     return true;
 }
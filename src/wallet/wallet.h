@@ -42,6 +42,7 @@
 #include "base58.h"
 
 #include <algorithm>
+#include <atomic>
 #include <map>
 #include <set>
 #include <stdexcept>
@@ -753,6 +754,18 @@ private:
 
     CWalletDB *pwalletdbEncryption;
 
+    /**
+     * Open database handle carrying the batched-write transaction, or NULL
+     * when no batch is in progress. Wallet records produced while connecting
+     * a block are coalesced into this single db transaction instead of each
+     * paying for its own commit; FlushDBBatch() commits it. Mutable so the
+     * batch can be flushed from const contexts such as BackupWallet.
+     */
+    mutable CWalletDB *pwalletdbBatch;
+
+    //! Lazily open the batched-write transaction; NULL if it cannot be started.
+    CWalletDB* GetBatchedWalletDB();
+
     //! the current wallet version: clients below this version are not able to load the wallet
     int nWalletVersion;
 
@@ -784,6 +797,49 @@ private:
     void AddToSaplingSpends(const uint256& nullifier, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /** Cached komodo_interestnew result for one unspent outpoint. */
+    struct CCachedInterest {
+        uint64_t nValue;   //!< accrued interest at nTipTime
+        uint32_t nTipTime; //!< tip time the value was computed against, 0 when never computed
+        CCachedInterest() : nValue(0), nTipTime(0) {}
+    };
+    /**
+     * Live index of wallet outpoints that are ours and not known to be
+     * spent, so coin selection and balance computation do not have to walk
+     * every transaction the wallet has ever seen. Maintained by
+     * AddToWallet/AddToTransparentSpends and rebuilt as transactions are
+     * loaded. The mapped value caches the accrued KMD interest per outpoint.
+     * Protected by cs_wallet; mutable because the interest cache is
+     * refreshed from const accessors.
+     */
+    typedef std::map<uint256, std::map<unsigned int, CCachedInterest> > TxUnspentMap;
+    mutable TxUnspentMap mapWalletUnspent;
+
+    //! Register wtx's outputs that are ours and unspent in mapWalletUnspent.
+    void AddUnspentOutpoints(const CWalletTx& wtx);
+
+    /**
+     * Lazily computed balance aggregates, guarded by cs_wallet. Every event
+     * that can move funds — a transaction added or updated, an erase, a
+     * reorg, a new tip changing depths or accrued interest — invalidates
+     * them, so between wallet events the balance RPCs are O(1) reads.
+     */
+    mutable bool fBalanceCached;
+    mutable CAmount nCachedBalance;
+    mutable bool fShieldedBalanceCached;
+    mutable CAmount nCachedShieldedBalance;
+
+    //! Drop the cached balance aggregates; requires cs_wallet.
+    void InvalidateBalanceCaches() const;
+
+    /**
+     * Cached m/32'/coin_type' level of the wallet's ZIP 32 Sapling key path,
+     * keyed by seed fingerprint so a seed change invalidates it. Re-deriving
+     * the hardened path from the master key for every new address dominates
+     * bulk Sapling key creation.
+     */
+    boost::optional<std::pair<uint256, libzcash::SaplingExtendedSpendingKey>> cachedSaplingParentKey;
+
 public:
     /*
      * Size of the incremental witness cache for the notes in our wallet.
@@ -793,6 +849,16 @@ public:
     int64_t nWitnessCacheSize;
     bool needsRescan = false;
 
+    /**
+     * Progress of a running ScanForWalletTransactions, for getwalletinfo.
+     * The rescan holds cs_wallet for its whole duration, so these are
+     * atomics that can be read without taking the lock. nRescanHeight is
+     * the height currently being scanned, or -1 when no rescan is running.
+     */
+    std::atomic<int> nRescanHeight{-1};
+    std::atomic<int> nRescanStartHeight{-1};
+    std::atomic<int> nRescanTipHeight{-1};
+
     void ClearNoteWitnessCache();
 
 protected:
@@ -902,6 +968,7 @@ public:
 
     ~CWallet()
     {
+        FlushDBBatch();
         delete pwalletdbEncryption;
         pwalletdbEncryption = NULL;
     }
@@ -913,12 +980,17 @@ public:
         fFileBacked = false;
         nMasterKeyMaxID = 0;
         pwalletdbEncryption = NULL;
+        pwalletdbBatch = NULL;
         nOrderPosNext = 0;
         nNextResend = 0;
         nLastResend = 0;
         nTimeFirstKey = 0;
         fBroadcastTransactions = false;
         nWitnessCacheSize = 0;
+        fBalanceCached = false;
+        nCachedBalance = 0;
+        fShieldedBalanceCached = false;
+        nCachedShieldedBalance = 0;
     }
 
     /**
@@ -1021,9 +1093,12 @@ public:
      * keystore implementation
      * Generate a new key
      */
-    CPubKey GenerateNewKey();
+    CPubKey GenerateNewKey(CWalletDB* pwalletdb = NULL);
     //! Adds a key to the store, and saves it to disk.
     bool AddKeyPubKey(const CKey& key, const CPubKey &pubkey);
+    //! Like AddKeyPubKey, but saves through the given database handle (if
+    //! any) so bulk key generation can batch its writes in one transaction.
+    bool AddKeyPubKeyWithDB(CWalletDB* pwalletdb, const CKey& key, const CPubKey &pubkey);
     //! Adds a key to the store, without saving it to disk (used by LoadWallet)
     bool LoadKey(const CKey& key, const CPubKey &pubkey) { return CCryptoKeyStore::AddKeyPubKey(key, pubkey); }
     //! Load metadata (used by LoadWallet)
@@ -1137,6 +1212,7 @@ public:
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb);
     void EraseFromWallet(const uint256 &hash);
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
+    void SyncBlockTransactions(const std::vector<CTransaction>& vtx, const CBlock* pblock);
     void RescanWallet();
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
     void WitnessNoteCommitment(
@@ -1148,6 +1224,8 @@ public:
     void ResendWalletTransactions(int64_t nBestBlockTime);
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime);
     CAmount GetBalance() const;
+    //! Total value of unspent shielded notes with at least one confirmation.
+    CAmount GetShieldedBalance();
     CAmount GetUnconfirmedBalance() const;
     CAmount GetImmatureBalance() const;
     CAmount GetWatchOnlyBalance() const;
@@ -1248,6 +1326,9 @@ public:
     //! Flush wallet (bitdb flush)
     void Flush(bool shutdown=false);
 
+    //! Commit any batched wallet writes still waiting in pwalletdbBatch.
+    void FlushDBBatch() const;
+
     //! Verify the wallet database and perform salvage if required
     static bool Verify(const std::string& walletFile, std::string& warningString, std::string& errorString);
 
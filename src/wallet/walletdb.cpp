@@ -24,6 +24,7 @@
 #include "key_io.h"
 #include "main.h"
 #include "protocol.h"
+#include "scheduler.h"
 #include "serialize.h"
 #include "sync.h"
 #include "util.h"
@@ -1112,72 +1113,74 @@ DBErrors CWalletDB::ZapWalletTx(CWallet* pwallet, vector<CWalletTx>& vWtx)
     return DB_LOAD_OK;
 }
 
-void ThreadFlushWalletDB(const string& strFile)
+static void FlushWalletDB(const string& strFile)
 {
-    // Make this thread recognisable as the wallet flushing thread
-    RenameThread("zcash-wallet");
+    static unsigned int nLastSeen = nWalletDBUpdated;
+    static unsigned int nLastFlushed = nWalletDBUpdated;
+    static int64_t nLastWalletUpdate = GetTime();
 
-    static bool fOneThread;
-    if (fOneThread)
-        return;
-    fOneThread = true;
-    if (!GetBoolArg("-flushwallet", true))
-        return;
-
-    unsigned int nLastSeen = nWalletDBUpdated;
-    unsigned int nLastFlushed = nWalletDBUpdated;
-    int64_t nLastWalletUpdate = GetTime();
-    while (true)
+    if (nLastSeen != nWalletDBUpdated)
     {
-        MilliSleep(500);
+        nLastSeen = nWalletDBUpdated;
+        nLastWalletUpdate = GetTime();
+    }
 
-        if (nLastSeen != nWalletDBUpdated)
+    if (nLastFlushed != nWalletDBUpdated && GetTime() - nLastWalletUpdate >= 2)
+    {
+        TRY_LOCK(bitdb->cs_db,lockDb);
+        if (lockDb)
         {
-            nLastSeen = nWalletDBUpdated;
-            nLastWalletUpdate = GetTime();
-        }
+            // Don't do this if any databases are in use
+            int nRefCount = 0;
+            map<string, int>::iterator mi = bitdb->mapFileUseCount.begin();
+            while (mi != bitdb->mapFileUseCount.end())
+            {
+                nRefCount += (*mi).second;
+                mi++;
+            }
 
-        if (nLastFlushed != nWalletDBUpdated && GetTime() - nLastWalletUpdate >= 2)
-        {
-            TRY_LOCK(bitdb->cs_db,lockDb);
-            if (lockDb)
+            if (nRefCount == 0)
             {
-                // Don't do this if any databases are in use
-                int nRefCount = 0;
-                map<string, int>::iterator mi = bitdb->mapFileUseCount.begin();
-                while (mi != bitdb->mapFileUseCount.end())
+                boost::this_thread::interruption_point();
+                map<string, int>::iterator mi = bitdb->mapFileUseCount.find(strFile);
+                if (mi != bitdb->mapFileUseCount.end())
                 {
-                    nRefCount += (*mi).second;
-                    mi++;
-                }
+                    LogPrint("db", "Flushing wallet.dat\n");
+                    nLastFlushed = nWalletDBUpdated;
+                    int64_t nStart = GetTimeMillis();
 
-                if (nRefCount == 0)
-                {
-                    boost::this_thread::interruption_point();
-                    map<string, int>::iterator mi = bitdb->mapFileUseCount.find(strFile);
-                    if (mi != bitdb->mapFileUseCount.end())
-                    {
-                        LogPrint("db", "Flushing wallet.dat\n");
-                        nLastFlushed = nWalletDBUpdated;
-                        int64_t nStart = GetTimeMillis();
-
-                        // Flush wallet.dat so it's self contained
-                        bitdb->CloseDb(strFile);
-                        bitdb->CheckpointLSN(strFile);
-
-                        bitdb->mapFileUseCount.erase(mi++);
-                        LogPrint("db", "Flushed wallet.dat %dms\n", GetTimeMillis() - nStart);
-                    }
+                    // Flush wallet.dat so it's self contained
+                    bitdb->CloseDb(strFile);
+                    bitdb->CheckpointLSN(strFile);
+
+                    bitdb->mapFileUseCount.erase(mi++);
+                    LogPrint("db", "Flushed wallet.dat %dms\n", GetTimeMillis() - nStart);
                 }
             }
         }
     }
 }
 
+void ScheduleWalletDBFlush(CScheduler& scheduler, const string& strFile)
+{
+    static bool fScheduled;
+    if (fScheduled)
+        return;
+    fScheduled = true;
+    if (!GetBoolArg("-flushwallet", true))
+        return;
+
+    // Piggyback on the task scheduler instead of running a dedicated
+    // polling thread; the wakeups coalesce with other periodic work.
+    scheduler.scheduleEvery(boost::bind(&FlushWalletDB, strFile), 1);
+}
+
 bool BackupWallet(const CWallet& wallet, const string& strDest)
 {
     if (!wallet.fFileBacked)
         return false;
+    // Make sure batched writes are in the database before it is copied
+    wallet.FlushDBBatch();
     while (true)
     {
         {
@@ -39,6 +39,7 @@ class CAccountingEntry;
 struct CBlockLocator;
 class CKeyPool;
 class CMasterKey;
+class CScheduler;
 class CScript;
 class CWallet;
 class CWalletTx;
@@ -223,6 +224,6 @@ private:
 };
 
 bool BackupWallet(const CWallet& wallet, const std::string& strDest);
-void ThreadFlushWalletDB(const std::string& strFile);
+void ScheduleWalletDBFlush(CScheduler& scheduler, const std::string& strFile);
 
 #endif // BITCOIN_WALLET_WALLETDB_H
@@ -44,7 +44,8 @@ public:
         uint64_t vpub_new,
         const uint256& rt,
         bool computeProof,
-        uint256 *out_esk // Payment disclosure
+        uint256 *out_esk, // Payment disclosure
+        SproutDeferredProof<NumInputs, NumOutputs> *out_deferred
     ) {
         if (vpub_old > MAX_MONEY) {
             throw std::invalid_argument("nonsensical vpub_old value");
@@ -160,55 +161,78 @@ public:
             out_macs[i] = PRF_pk(inputs[i].key, i, h_sig);
         }
 
-        if (!computeProof) {
+        SproutDeferredProof<NumInputs, NumOutputs> statement;
+        statement.phi = phi;
+        statement.rt = rt;
+        statement.h_sig = h_sig;
+        statement.inputs = inputs;
+        statement.out_notes = out_notes;
+        statement.vpub_old = vpub_old;
+        statement.vpub_new = vpub_new;
+
+        if (out_deferred != nullptr) {
+            // Hand the statement to the caller to prove later
+            *out_deferred = statement;
             return GrothProof();
         }
 
-        GrothProof proof;
-
-        CDataStream ss1(SER_NETWORK, PROTOCOL_VERSION);
-        ss1 << inputs[0].witness.path();
-        std::vector<unsigned char> auth1(ss1.begin(), ss1.end());
-
-        CDataStream ss2(SER_NETWORK, PROTOCOL_VERSION);
-        ss2 << inputs[1].witness.path();
-        std::vector<unsigned char> auth2(ss2.begin(), ss2.end());
-
-        librustzcash_sprout_prove(
-            proof.begin(),
-
-            phi.begin(),
-            rt.begin(),
-            h_sig.begin(),
-
-            inputs[0].key.begin(),
-            inputs[0].note.value(),
-            inputs[0].note.rho.begin(),
-            inputs[0].note.r.begin(),
-            auth1.data(),
-
-            inputs[1].key.begin(),
-            inputs[1].note.value(),
-            inputs[1].note.rho.begin(),
-            inputs[1].note.r.begin(),
-            auth2.data(),
-
-            out_notes[0].a_pk.begin(),
-            out_notes[0].value(),
-            out_notes[0].r.begin(),
-
-            out_notes[1].a_pk.begin(),
-            out_notes[1].value(),
-            out_notes[1].r.begin(),
-
-            vpub_old,
-            vpub_new
-        );
+        if (!computeProof) {
+            return GrothProof();
+        }
 
-        return proof;
+        return statement.prove();
     }
 };
 
+template<size_t NumInputs, size_t NumOutputs>
+GrothProof SproutDeferredProof<NumInputs, NumOutputs>::prove() const
+{
+    GrothProof proof;
+
+    // Reuse the auth path encoding buffers between proofs; the serialized
+    // witness path has a fixed size, so each thread's buffers reach steady
+    // state after its first proof
+    static thread_local CDataStream ss1(SER_NETWORK, PROTOCOL_VERSION);
+    static thread_local CDataStream ss2(SER_NETWORK, PROTOCOL_VERSION);
+    ss1.clear();
+    ss1 << inputs[0].witness.path();
+    ss2.clear();
+    ss2 << inputs[1].witness.path();
+
+    librustzcash_sprout_prove(
+        proof.begin(),
+
+        phi.begin(),
+        rt.begin(),
+        h_sig.begin(),
+
+        inputs[0].key.begin(),
+        inputs[0].note.value(),
+        inputs[0].note.rho.begin(),
+        inputs[0].note.r.begin(),
+        (const unsigned char*)&ss1[0],
+
+        inputs[1].key.begin(),
+        inputs[1].note.value(),
+        inputs[1].note.rho.begin(),
+        inputs[1].note.r.begin(),
+        (const unsigned char*)&ss2[0],
+
+        out_notes[0].a_pk.begin(),
+        out_notes[0].value(),
+        out_notes[0].r.begin(),
+
+        out_notes[1].a_pk.begin(),
+        out_notes[1].value(),
+        out_notes[1].r.begin(),
+
+        vpub_old,
+        vpub_new
+    );
+
+    return proof;
+}
+
 template<size_t NumInputs, size_t NumOutputs>
 JoinSplit<NumInputs, NumOutputs>* JoinSplit<NumInputs, NumOutputs>::Prepared()
 {
@@ -268,5 +292,7 @@ JSInput::JSInput() : witness(SproutMerkleTree().witness()),
 
 template class JoinSplit<ZC_NUM_JS_INPUTS,
                          ZC_NUM_JS_OUTPUTS>;
+template class SproutDeferredProof<ZC_NUM_JS_INPUTS,
+                                   ZC_NUM_JS_OUTPUTS>;
 
 }
@@ -51,6 +51,28 @@ public:
     SproutNote note(const uint252& phi, const uint256& r, size_t i, const uint256& h_sig) const;
 };
 
+/**
+ * The private inputs of a single JoinSplit statement, captured while the
+ * description is assembled so the SNARK itself can be generated later,
+ * possibly on another thread. The captured statement is self-contained:
+ * proving it does not touch the transaction it will be patched back into,
+ * so statements from one joinsplit chain can be proved concurrently.
+ */
+template<size_t NumInputs, size_t NumOutputs>
+class SproutDeferredProof {
+public:
+    uint252 phi;
+    uint256 rt;
+    uint256 h_sig;
+    std::array<JSInput, NumInputs> inputs;
+    std::array<SproutNote, NumOutputs> out_notes;
+    uint64_t vpub_old = 0;
+    uint64_t vpub_new = 0;
+
+    // Generate the Groth proof for the captured statement.
+    GrothProof prove() const;
+};
+
 template<size_t NumInputs, size_t NumOutputs>
 class JoinSplit {
 public:
@@ -82,7 +104,11 @@ public:
         // For paymentdisclosure, we need to retrieve the esk.
         // Reference as non-const parameter with default value leads to compile error.
         // So use pointer for simplicity.
-        uint256 *out_esk = nullptr
+        uint256 *out_esk = nullptr,
+        // When non-null, the proof inputs are captured here instead of the
+        // SNARK being generated now; the returned proof is a placeholder and
+        // the caller is responsible for patching in out_deferred->prove().
+        SproutDeferredProof<NumInputs, NumOutputs> *out_deferred = nullptr
     ) = 0;
 
 protected:
@@ -94,4 +120,7 @@ protected:
 typedef libzcash::JoinSplit<ZC_NUM_JS_INPUTS,
                             ZC_NUM_JS_OUTPUTS> ZCJoinSplit;
 
+typedef libzcash::SproutDeferredProof<ZC_NUM_JS_INPUTS,
+                                      ZC_NUM_JS_OUTPUTS> ZCSproutDeferredProof;
+
 #endif // ZC_JOINSPLIT_H_
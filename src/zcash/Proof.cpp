@@ -1,9 +1,13 @@
 #include "Proof.hpp"
 
 #include "crypto/common.h"
+#include "librustzcash.h"
 
 #include <boost/static_assert.hpp>
+#include <algorithm>
+#include <atomic>
 #include <mutex>
+#include <thread>
 
 namespace libzcash {
 
@@ -15,4 +19,59 @@ ProofVerifier ProofVerifier::Disabled() {
     return ProofVerifier(false);
 }
 
+ProofVerifier ProofVerifier::Batched() {
+    return ProofVerifier(true, true);
+}
+
+void ProofVerifier::QueueSproutProof(const SproutProofStatement& statement) {
+    deferred.push_back(statement);
+}
+
+bool ProofVerifier::VerifyBatch() {
+    if (deferred.empty()) {
+        return true;
+    }
+
+    std::atomic<bool> all_valid(true);
+    std::atomic<size_t> next(0);
+
+    auto worker = [this, &all_valid, &next]() {
+        size_t i;
+        while ((i = next.fetch_add(1)) < deferred.size()) {
+            if (!all_valid.load()) {
+                break;
+            }
+            const SproutProofStatement& s = deferred[i];
+            if (!librustzcash_sprout_verify(
+                    s.proof.data(),
+                    s.anchor.begin(),
+                    s.h_sig.begin(),
+                    s.mac1.begin(),
+                    s.mac2.begin(),
+                    s.nullifier1.begin(),
+                    s.nullifier2.begin(),
+                    s.commitment1.begin(),
+                    s.commitment2.begin(),
+                    s.vpub_old,
+                    s.vpub_new)) {
+                all_valid.store(false);
+            }
+        }
+    };
+
+    size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    threads = std::min(threads, deferred.size());
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; t++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& th : workers) {
+        th.join();
+    }
+
+    deferred.clear();
+    return all_valid.load();
+}
+
 }
@@ -4,6 +4,9 @@
 #include "serialize.h"
 #include "uint256.h"
 
+#include <array>
+#include <vector>
+
 namespace libzcash {
 
 const unsigned char G1_PREFIX_MASK = 0x02;
@@ -202,11 +205,34 @@ public:
 
 void initialize_curve_params();
 
+/**
+ * The public inputs of one Groth16 joinsplit proof check, captured when a
+ * batching verifier defers the pairing work. The proof array is sized for
+ * GROTH_PROOF_SIZE; the constant itself lives in JoinSplit.hpp, which
+ * includes this header.
+ */
+struct SproutProofStatement {
+    std::array<unsigned char, 48 + 96 + 48> proof;
+    uint256 anchor;
+    uint256 h_sig;
+    uint256 mac1;
+    uint256 mac2;
+    uint256 nullifier1;
+    uint256 nullifier2;
+    uint256 commitment1;
+    uint256 commitment2;
+    uint64_t vpub_old;
+    uint64_t vpub_new;
+};
+
 class ProofVerifier {
 private:
     bool perform_verification;
+    bool batch_verification;
+    std::vector<SproutProofStatement> deferred;
 
-    ProofVerifier(bool perform_verification) : perform_verification(perform_verification) { }
+    ProofVerifier(bool perform_verification, bool batch_verification = false) :
+        perform_verification(perform_verification), batch_verification(batch_verification) { }
 
 public:
     // ProofVerifier should never be copied
@@ -224,6 +250,22 @@ public:
     // such as during reindexing.
     static ProofVerifier Disabled();
 
+    // Creates a verification context that queues Groth16 joinsplit proofs
+    // instead of checking them inline; VerifyBatch() then checks the whole
+    // queue on worker threads. Used in block connection, where all of a
+    // block's proofs are known before a verdict is needed.
+    static ProofVerifier Batched();
+
+    bool BatchingEnabled() const { return batch_verification; }
+
+    // Record a deferred proof check; only valid on a batching verifier.
+    void QueueSproutProof(const SproutProofStatement& statement);
+
+    // Verify every queued proof, spreading the pairing checks over the
+    // available cores, and clear the queue. Returns false if any proof in
+    // the batch is invalid.
+    bool VerifyBatch();
+
     template <typename VerificationKey,
               typename ProcessedVerificationKey,
               typename PrimaryInput,
@@ -93,6 +93,7 @@ double benchmark_sleep()
 
 double benchmark_create_joinsplit()
 {
+    ZC_LoadParamsOnDemand(); // no-op unless the load was deferred on an -ac_public chain
     uint256 joinSplitPubKey;
 
     /* Get the anchor of an empty commitment tree. */
@@ -415,6 +416,77 @@ double benchmark_connectblock_slow()
     return duration;
 }
 
+double benchmark_connectblock_range(int nBlocks)
+{
+    // Replay the most recent nBlocks of the active chain through ConnectBlock
+    // against a throwaway cache layered over the real chainstate: the blocks
+    // are first disconnected inside the cache, then reconnected one at a time
+    // with fJustCheck set, so all of the deserialization, UTXO and script
+    // verification work happens but nothing is flushed and no index or dPoW
+    // state is touched. Run with -debug=bench for the per-stage breakdown
+    // ConnectBlock already logs.
+    AssertLockHeld(cs_main);
+    CBlockIndex* pindexTip = chainActive.Tip();
+    if (nBlocks < 1 || !pindexTip || pindexTip->nHeight <= nBlocks)
+        throw new std::runtime_error("Not enough blocks in the active chain");
+
+    std::vector<CBlockIndex*> vReplay;
+    for (CBlockIndex* pindex = pindexTip; (int)vReplay.size() < nBlocks; pindex = pindex->pprev)
+        vReplay.push_back(pindex);
+
+    CCoinsViewCache view(pcoinsTip);
+
+    // DisconnectBlock erases address/spent index entries when the indexes are
+    // enabled; mask the flags so the rewind stays confined to the cache.
+    bool fAddressIndexSaved = fAddressIndex;
+    bool fSpentIndexSaved = fSpentIndex;
+    fAddressIndex = false;
+    fSpentIndex = false;
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (CBlockIndex* pindex : vReplay) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, false)) {
+            fAddressIndex = fAddressIndexSaved;
+            fSpentIndex = fSpentIndexSaved;
+            throw new std::runtime_error("Failed to read block from disk");
+        }
+        CValidationState state;
+        if (!DisconnectBlock(block, state, pindex, view)) {
+            fAddressIndex = fAddressIndexSaved;
+            fSpentIndex = fSpentIndexSaved;
+            throw new std::runtime_error("DisconnectBlock failed");
+        }
+    }
+    fAddressIndex = fAddressIndexSaved;
+    fSpentIndex = fSpentIndexSaved;
+    double rewind = timer_stop(tv_start);
+
+    // Reconnect oldest-first, timing only the ConnectBlock calls.
+    double elapsed = 0;
+    size_t nTxTotal = 0;
+    for (std::vector<CBlockIndex*>::reverse_iterator it = vReplay.rbegin(); it != vReplay.rend(); ++it) {
+        CBlockIndex* pindex = *it;
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, false))
+            throw new std::runtime_error("Failed to read block from disk");
+        nTxTotal += block.vtx.size();
+        CValidationState state;
+        timer_start(tv_start);
+        if (!ConnectBlock(block, state, pindex, view, true))
+            throw new std::runtime_error(strprintf("ConnectBlock failed at height %d: %s",
+                                                   pindex->nHeight, state.GetRejectReason()).c_str());
+        elapsed += timer_stop(tv_start);
+    }
+
+    LogPrintf("benchmark: replayed %d blocks (%u tx) from height %d in %.3fs (%.1f tx/s), rewind took %.3fs\n",
+              nBlocks, nTxTotal, vReplay.back()->nHeight, elapsed,
+              elapsed > 0 ? nTxTotal / elapsed : 0.0, rewind);
+
+    return elapsed;
+}
+
 extern UniValue getnewaddress(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcwallet.cpp
 extern UniValue sendtoaddress(const UniValue& params, bool fHelp, const CPubKey& mypk);
 
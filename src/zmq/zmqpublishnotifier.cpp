@@ -13,6 +13,8 @@ static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
 static const char *MSG_CHECKEDBLOCK = "checkedblock";
+static const char *MSG_BLOCKPOS  = "blockpos";
+static const char *MSG_RAWTXBATCH = "rawtxbatch";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -196,6 +198,57 @@ bool CZMQPublishCheckedBlockNotifier::NotifyBlock(const CBlock& block)
     return SendMessage(MSG_CHECKEDBLOCK, &(*ss.begin()), ss.size());
 }
 
+// Publish where the already-serialized block bytes live on disk instead of
+// pushing them through the socket again: a co-located consumer can pread()
+// them straight out of the blk file WriteBlockToDisk produced. Payload is
+// the 32 byte block hash (RPC byte order) followed by LE32 height, file
+// number and data offset within that file.
+bool CZMQPublishBlockPosNotifier::NotifyBlock(const CBlockIndex *pindex)
+{
+    LogPrint("zmq", "zmq: Publish blockpos %s\n", pindex->GetBlockHash().GetHex());
+
+    CDiskBlockPos pos;
+    {
+        LOCK(cs_main);
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+            return true; // nothing on disk to point at (pruned), not an error
+        pos = pindex->GetBlockPos();
+    }
+
+    uint256 hash = pindex->GetBlockHash();
+    unsigned char data[32 + 3 * sizeof(uint32_t)];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    WriteLE32(&data[32], (uint32_t)pindex->nHeight);
+    WriteLE32(&data[36], (uint32_t)pos.nFile);
+    WriteLE32(&data[40], (uint32_t)pos.nPos);
+    return SendMessage(MSG_BLOCKPOS, data, sizeof(data));
+}
+
+// One message per connected block carrying every transaction, so consumers
+// that index per block don't reassemble thousands of individual rawtx
+// messages. Payload is the serialized vtx vector (compact-size count, then
+// each transaction).
+bool CZMQPublishRawTransactionBatchNotifier::NotifyBlock(const CBlockIndex *pindex)
+{
+    LogPrint("zmq", "zmq: Publish rawtxbatch %s\n", pindex->GetBlockHash().GetHex());
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    {
+        LOCK(cs_main);
+        CBlock block;
+        if(!ReadBlockFromDisk(block, pindex,1))
+        {
+            zmqError("Can't read block from disk");
+            return false;
+        }
+
+        ss << block.vtx;
+    }
+
+    return SendMessage(MSG_RAWTXBATCH, &(*ss.begin()), ss.size());
+}
+
 bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
 {
     uint256 hash = transaction.GetHash();
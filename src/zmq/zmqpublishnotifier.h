@@ -58,4 +58,16 @@ public:
     bool NotifyBlock(const CBlock &block);
 };
 
+class CZMQPublishBlockPosNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlock(const CBlockIndex *pindex);
+};
+
+class CZMQPublishRawTransactionBatchNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlock(const CBlockIndex *pindex);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
@@ -0,0 +1,138 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "zmqreplication.h"
+#include "zmqconfig.h"
+
+#include "main.h"
+#include "streams.h"
+#include "util.h"
+#include "version.h"
+
+#include <atomic>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+static std::atomic<bool> zmqReplicationInterrupted(false);
+
+/* Receive one frame into vch; returns false on timeout/error. fMore is set
+   when further frames of the same multipart message are pending. */
+static bool ZMQRecvFrame(void *psocket, std::vector<uint8_t> &vch, bool &fMore)
+{
+    zmq_msg_t msg;
+    zmq_msg_init(&msg);
+    if (zmq_msg_recv(&msg, psocket, 0) < 0)
+    {
+        zmq_msg_close(&msg);
+        return false;
+    }
+    vch.assign((uint8_t *)zmq_msg_data(&msg), (uint8_t *)zmq_msg_data(&msg) + zmq_msg_size(&msg));
+    fMore = zmq_msg_more(&msg) != 0;
+    zmq_msg_close(&msg);
+    return true;
+}
+
+static void ZMQHandleReplicatedBlock(const std::vector<uint8_t> &data)
+{
+    CBlock block;
+    try {
+        CDataStream ss(data, SER_NETWORK, PROTOCOL_VERSION);
+        ss >> block;
+    } catch (const std::exception &e) {
+        LogPrint("zmq", "zmq: replication dropped undecodable block (%s)\n", e.what());
+        return;
+    }
+    // ProcessNewBlock deduplicates against blocks that also arrived over p2p
+    CValidationState state;
+    if (!ProcessNewBlock(0, 0, state, NULL, &block, true, NULL))
+        LogPrint("zmq", "zmq: replicated block %s rejected: %s\n", block.GetHash().ToString(), state.GetRejectReason());
+}
+
+static void ZMQHandleReplicatedTransaction(const std::vector<uint8_t> &data)
+{
+    CTransaction tx;
+    try {
+        CDataStream ss(data, SER_NETWORK, PROTOCOL_VERSION);
+        ss >> tx;
+    } catch (const std::exception &e) {
+        LogPrint("zmq", "zmq: replication dropped undecodable tx (%s)\n", e.what());
+        return;
+    }
+    uint256 hashTx = tx.GetHash();
+    {
+        LOCK(cs_main);
+        if (mempool.exists(hashTx))
+            return;
+        CValidationState state;
+        bool fMissingInputs = false;
+        // the publisher also emits txs as they are mined; those fail here
+        // harmlessly once the replicated block connects
+        if (!AcceptToMemoryPool(mempool, state, tx, false, &fMissingInputs))
+            LogPrint("zmq", "zmq: replicated tx %s not accepted: %s\n", hashTx.ToString(), state.GetRejectReason());
+    }
+}
+
+static void ThreadZMQReplication(std::string address)
+{
+    RenameThread("zmq-replicate");
+    void *pcontext = zmq_init(1);
+    if (pcontext == NULL)
+    {
+        zmqError("Unable to initialize replication context");
+        return;
+    }
+    void *psocket = zmq_socket(pcontext, ZMQ_SUB);
+    if (psocket == NULL)
+    {
+        zmqError("Unable to open replication socket");
+        zmq_ctx_destroy(pcontext);
+        return;
+    }
+    int timeout = 1000; // wake up regularly to notice shutdown
+    zmq_setsockopt(psocket, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+    zmq_setsockopt(psocket, ZMQ_SUBSCRIBE, "rawblock", 8);
+    zmq_setsockopt(psocket, ZMQ_SUBSCRIBE, "rawtx", 5);
+    if (zmq_connect(psocket, address.c_str()) != 0)
+    {
+        zmqError("Unable to connect replication socket");
+        zmq_close(psocket);
+        zmq_ctx_destroy(pcontext);
+        return;
+    }
+    LogPrintf("zmq: replication subscriber connected to %s\n", address);
+    while (!zmqReplicationInterrupted)
+    {
+        std::vector<uint8_t> topic, body, frame;
+        bool fMore = false;
+        if (!ZMQRecvFrame(psocket, topic, fMore))
+            continue; // timeout or transient error, re-check the interrupt flag
+        if (fMore && !ZMQRecvFrame(psocket, body, fMore))
+            continue;
+        while (fMore) // drain the trailing sequence number frame(s)
+        {
+            if (!ZMQRecvFrame(psocket, frame, fMore))
+                break;
+        }
+        std::string strTopic(topic.begin(), topic.end());
+        if (strTopic == "rawblock")
+            ZMQHandleReplicatedBlock(body);
+        else if (strTopic == "rawtx")
+            ZMQHandleReplicatedTransaction(body);
+    }
+    zmq_close(psocket);
+    zmq_ctx_destroy(pcontext);
+    LogPrintf("zmq: replication subscriber stopped\n");
+}
+
+bool StartZMQReplication(const std::string &address, boost::thread_group &threadGroup)
+{
+    zmqReplicationInterrupted = false;
+    threadGroup.create_thread(boost::bind(&ThreadZMQReplication, address));
+    return true;
+}
+
+void InterruptZMQReplication()
+{
+    zmqReplicationInterrupted = true;
+}
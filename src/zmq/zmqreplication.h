@@ -0,0 +1,25 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ZMQ_ZMQREPLICATION_H
+#define BITCOIN_ZMQ_ZMQREPLICATION_H
+
+#include <string>
+
+namespace boost
+{
+class thread_group;
+} // namespace boost
+
+/** Start the hot-standby replication subscriber (-zmqreplicationsource).
+ *  Connects a SUB socket to an active node's rawblock/rawtx publishers and
+ *  feeds the received data into block processing and mempool acceptance, so
+ *  a standby daemon keeps a warm chainstate and mempool and failover does
+ *  not start minutes behind. */
+bool StartZMQReplication(const std::string &address, boost::thread_group &threadGroup);
+
+/** Ask the replication thread to exit at its next receive timeout. */
+void InterruptZMQReplication();
+
+#endif // BITCOIN_ZMQ_ZMQREPLICATION_H